@@ -75,6 +75,17 @@ Esys_Initialize(
     TSS2_TCTI_CONTEXT *tcti,
     TSS2_ABI_VERSION *abiVersion);
 
+size_t
+Esys_GetContextSize(void);
+
+TSS2_RC
+Esys_InitializeEx(
+    ESYS_CONTEXT **esys_context,
+    void *storage,
+    size_t storage_size,
+    TSS2_TCTI_CONTEXT *tcti,
+    TSS2_ABI_VERSION *abiVersion);
+
 void
 Esys_Finalize(
     ESYS_CONTEXT **context);
@@ -95,6 +106,93 @@ Esys_SetTimeout(
     ESYS_CONTEXT *esys_context,
     int32_t timeout);
 
+TSS2_RC
+Esys_SetMetadataCache(
+    ESYS_CONTEXT *esys_context,
+    const char *path);
+
+/* How commands answered with TPM2_RC_RETRY, TPM2_RC_TESTING or
+ * TPM2_RC_YIELDED are resubmitted. All times are in milliseconds. */
+typedef struct {
+    uint32_t maxSubmissions; /* Submissions of a command including the first. */
+    uint32_t initialDelay;   /* Delay before the first resubmission. */
+    uint32_t maxDelay;       /* Upper bound of the delay. */
+    uint32_t backoffFactor;  /* Factor applied to the delay per resubmission. */
+    uint32_t jitter;         /* Random deviation of the delay in percent. */
+    uint32_t deadline;       /* Time after the first such response code after
+                                which no resubmission is started (0: none). */
+} ESYS_RESUBMISSION_POLICY;
+
+TSS2_RC
+Esys_SetResubmissionPolicy(
+    ESYS_CONTEXT *esys_context,
+    const ESYS_RESUBMISSION_POLICY *policy);
+
+typedef struct ESYS_EXECUTOR ESYS_EXECUTOR;
+
+/* Calls the _Finish() function of the operation submitted to an executor. */
+typedef TSS2_RC (*ESYS_EXECUTOR_FINISH)(
+    ESYS_CONTEXT *esys_context,
+    void *userdata);
+
+/* Called by an executor with the result of a completed operation. */
+typedef void (*ESYS_EXECUTOR_CALLBACK)(
+    ESYS_CONTEXT *esys_context,
+    TSS2_RC rc,
+    void *userdata);
+
+TSS2_RC
+Esys_Executor_Initialize(
+    ESYS_EXECUTOR **executor);
+
+void
+Esys_Executor_Finalize(
+    ESYS_EXECUTOR **executor);
+
+TSS2_RC
+Esys_Executor_Submit(
+    ESYS_EXECUTOR *executor,
+    ESYS_CONTEXT *esys_context,
+    ESYS_EXECUTOR_FINISH finish,
+    ESYS_EXECUTOR_CALLBACK callback,
+    void *userdata);
+
+TSS2_RC
+Esys_Executor_Run(
+    ESYS_EXECUTOR *executor,
+    int32_t timeout);
+
+/* Reads up to size bytes of the data hashed by Esys_SequenceHash into buffer.
+ * Storing 0 in bytes_read signals the end of the data. */
+typedef TSS2_RC (*ESYS_SEQUENCE_READ)(
+    void *userdata,
+    uint8_t *buffer,
+    size_t size,
+    size_t *bytes_read);
+
+TSS2_RC
+Esys_SequenceHash(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR hmacKey,
+    ESYS_TR shandle1,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    ESYS_SEQUENCE_READ reader,
+    void *userdata,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation);
+
+TSS2_RC
+Esys_SequenceHashFd(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR hmacKey,
+    ESYS_TR shandle1,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    int fd,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation);
+
 TSS2_RC
 Esys_TR_Serialize(
     ESYS_CONTEXT *esys_context,
@@ -109,6 +207,22 @@ Esys_TR_Deserialize(
     size_t buffer_size,
     ESYS_TR *esys_handle);
 
+/* Omit the auth values of the objects from the state of Esys_SaveState. */
+#define ESYS_SAVE_STATE_NO_AUTH 0x00000001U
+
+TSS2_RC
+Esys_SaveState(
+    ESYS_CONTEXT *esys_context,
+    uint32_t flags,
+    uint8_t **buffer,
+    size_t *buffer_size);
+
+TSS2_RC
+Esys_RestoreState(
+    ESYS_CONTEXT *esys_context,
+    uint8_t const *buffer,
+    size_t buffer_size);
+
 TSS2_RC
 Esys_TR_FromTPMPublic_Async(
     ESYS_CONTEXT *esysContext,
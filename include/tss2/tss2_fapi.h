@@ -726,6 +726,18 @@ TSS2_RC Fapi_SetPolicyActionCB(
     Fapi_CB_PolicyAction callback,
     void                *userData);
 
+typedef TSS2_RC (*Fapi_CB_NvChunk)(
+    char     const *nvPath,
+    size_t          offset,
+    uint8_t  const *data,
+    size_t          dataSize,
+    void           *userData);
+
+TSS2_RC Fapi_SetNvChunkCB(
+    FAPI_CONTEXT   *context,
+    Fapi_CB_NvChunk callback,
+    void           *userData);
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,6 +15,44 @@ typedef const char *(*TSS2_RC_HANDLER)(TSS2_RC rc);
 
 const char *Tss2_RC_Decode(TSS2_RC rc);
 
+/* Formats of the codes decoded by Tss2_RC_DecodeStruct. */
+#define TSS2_RC_INFO_FORMAT_TSS         0 /* A TSS layer code. */
+#define TSS2_RC_INFO_FORMAT_0           1 /* A TPM format 0 code. */
+#define TSS2_RC_INFO_FORMAT_1           2 /* A TPM format 1 code. */
+
+/* What the index of a TPM format 1 code refers to. */
+#define TSS2_RC_INFO_SUBJECT_NONE       0
+#define TSS2_RC_INFO_SUBJECT_HANDLE     1
+#define TSS2_RC_INFO_SUBJECT_SESSION    2
+#define TSS2_RC_INFO_SUBJECT_PARAMETER  3
+
+/* Flags of a TPM format 0 code. */
+#define TSS2_RC_INFO_WARNING            0x01 /* The S bit: a warning. */
+#define TSS2_RC_INFO_VENDOR             0x02 /* The T bit: vendor defined. */
+#define TSS2_RC_INFO_TPM12              0x04 /* The V bit is clear: TPM 1.2. */
+
+typedef struct {
+    uint8_t layer;    /* The layer number. */
+    uint8_t format;   /* One of TSS2_RC_INFO_FORMAT_*. */
+    uint16_t base;    /* The code without layer, index and P bit; compares
+                         equal to TPM2_RC_* and TSS2_BASE_RC_* values. */
+    uint8_t subject;  /* One of TSS2_RC_INFO_SUBJECT_* for format 1 codes. */
+    uint8_t index;    /* The 1-based handle, session or parameter number, or
+                         0 if unspecified. */
+    uint8_t flags;    /* TSS2_RC_INFO_* flags for format 0 codes. */
+} TSS2_RC_INFO;
+
+void Tss2_RC_DecodeStruct(TSS2_RC rc, TSS2_RC_INFO *info);
+
+typedef struct {
+    const char *layer;       /* The layer name, or NULL. */
+    const char *prefix;      /* The handle, session or parameter, or the
+                                severity and version, of a TPM code. */
+    const char *description; /* The description, or NULL if unknown. */
+} TSS2_RC_STRINGS;
+
+void Tss2_RC_DecodeStrings(TSS2_RC rc, TSS2_RC_STRINGS *strings);
+
 TSS2_RC_HANDLER Tss2_RC_SetHandler(uint8_t layer, const char *name, TSS2_RC_HANDLER handler);
 
 #ifdef __cplusplus
@@ -70,6 +70,18 @@ TSS2_RC Tss2_Sys_GetCpBuffer(
     size_t *cpBufferUsedSize,
     const uint8_t **cpBuffer);
 
+typedef TSS2_RC (*TSS2_SYS_CP_CALLBACK)(
+    TPM2_CC commandCode,
+    size_t offset,
+    const uint8_t *data,
+    size_t size,
+    void *userData);
+
+TSS2_RC Tss2_Sys_SetCpCallback(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_CP_CALLBACK callback,
+    void *userData);
+
 TSS2_RC Tss2_Sys_SetCmdAuths(
     TSS2_SYS_CONTEXT *sysContext,
     const TSS2L_SYS_AUTH_COMMAND *cmdAuthsArray);
@@ -180,6 +180,11 @@ Esys_ActivateCredential_Async(
     r = esys_GetResourceObject(esysContext, keyHandle, &keyHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyHandle unknown.");
 
+    /* Set up the sessions and hash the parameters while they are marshalled */
+    r = init_session_tab(esysContext, shandle1, shandle2, shandle3);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Initialize session resources");
+    iesys_begin_cp_stream(esysContext, activateHandleNode, keyHandleNode, NULL);
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ActivateCredential_Prepare(esysContext->sys,
                                             (activateHandleNode == NULL)
@@ -191,9 +196,7 @@ Esys_ActivateCredential_Async(
                                             credentialBlob, secret);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
 
-    /* Calculate the cpHash Values */
-    r = init_session_tab(esysContext, shandle1, shandle2, shandle3);
-    return_state_if_error(r, _ESYS_STATE_INIT, "Initialize session resources");
+    /* Calculate the session values */
     if (activateHandleNode != NULL)
         iesys_compute_session_value(esysContext->session_tab[0],
                     &activateHandleNode->rsrc.name, &activateHandleNode->auth);
@@ -288,7 +291,7 @@ Esys_ActivateCredential_Finish(
     }
 
     /*Receive the TPM response and handle resubmissions if necessary. */
-    r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
+    r = iesys_execute_finish(esysContext);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
         LOG_DEBUG("A layer below returned TRY_AGAIN: %" PRIx32, r);
         esysContext->state = _ESYS_STATE_SENT;
@@ -299,13 +302,13 @@ Esys_ActivateCredential_Finish(
     if (r == TPM2_RC_RETRY || r == TPM2_RC_TESTING || r == TPM2_RC_YIELDED) {
         LOG_DEBUG("TPM returned RETRY, TESTING or YIELDED, which triggers a "
             "resubmission: %" PRIx32, r);
-        if (esysContext->submissionCount++ >= _ESYS_MAX_SUBMISSIONS) {
+        if (iesys_resubmission_exhausted(esysContext)) {
             LOG_WARNING("Maximum number of (re)submissions has been reached.");
             esysContext->state = _ESYS_STATE_INIT;
             goto error_cleanup;
         }
         esysContext->state = _ESYS_STATE_RESUBMISSION;
-        r = Tss2_Sys_ExecuteAsync(esysContext->sys);
+        r = iesys_resubmit(esysContext);
         if (r != TSS2_RC_SUCCESS) {
             LOG_WARNING("Error attempting to resubmit");
             /* We do not set esysContext->state here but inherit the most recent
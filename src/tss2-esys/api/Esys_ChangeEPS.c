@@ -14,6 +14,7 @@
 
 #include "esys_types.h"
 #include "esys_iutil.h"
+#include "esys_mdcache.h"
 #include "esys_mu.h"
 #define LOGMODULE esys
 #include "util/log.h"
@@ -166,15 +167,18 @@ Esys_ChangeEPS_Async(
     r = esys_GetResourceObject(esysContext, authHandle, &authHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "authHandle unknown.");
 
+    /* Set up the sessions and hash the parameters while they are marshalled */
+    r = init_session_tab(esysContext, shandle1, shandle2, shandle3);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Initialize session resources");
+    iesys_begin_cp_stream(esysContext, authHandleNode, NULL, NULL);
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ChangeEPS_Prepare(esysContext->sys,
                                    (authHandleNode == NULL) ? TPM2_RH_NULL
                                     : authHandleNode->rsrc.handle);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
 
-    /* Calculate the cpHash Values */
-    r = init_session_tab(esysContext, shandle1, shandle2, shandle3);
-    return_state_if_error(r, _ESYS_STATE_INIT, "Initialize session resources");
+    /* Calculate the session values */
     if (authHandleNode != NULL)
         iesys_compute_session_value(esysContext->session_tab[0],
                     &authHandleNode->rsrc.name, &authHandleNode->auth);
@@ -254,7 +258,7 @@ Esys_ChangeEPS_Finish(
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
     /*Receive the TPM response and handle resubmissions if necessary. */
-    r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
+    r = iesys_execute_finish(esysContext);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
         LOG_DEBUG("A layer below returned TRY_AGAIN: %" PRIx32, r);
         esysContext->state = _ESYS_STATE_SENT;
@@ -265,13 +269,13 @@ Esys_ChangeEPS_Finish(
     if (r == TPM2_RC_RETRY || r == TPM2_RC_TESTING || r == TPM2_RC_YIELDED) {
         LOG_DEBUG("TPM returned RETRY, TESTING or YIELDED, which triggers a "
             "resubmission: %" PRIx32, r);
-        if (esysContext->submissionCount++ >= _ESYS_MAX_SUBMISSIONS) {
+        if (iesys_resubmission_exhausted(esysContext)) {
             LOG_WARNING("Maximum number of (re)submissions has been reached.");
             esysContext->state = _ESYS_STATE_INIT;
             return r;
         }
         esysContext->state = _ESYS_STATE_RESUBMISSION;
-        r = Tss2_Sys_ExecuteAsync(esysContext->sys);
+        r = iesys_resubmit(esysContext);
         if (r != TSS2_RC_SUCCESS) {
             LOG_WARNING("Error attempting to resubmit");
             /* We do not set esysContext->state here but inherit the most recent
@@ -309,6 +313,9 @@ Esys_ChangeEPS_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+    /* The persistent objects of the hierarchy are gone, drop their cached metadata */
+    iesys_mdcache_clear(esysContext);
+
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
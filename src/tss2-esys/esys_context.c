@@ -8,16 +8,72 @@
 #include <config.h>
 #endif
 #include <stdlib.h>
+#include <string.h>
 
 #include "tss2_esys.h"
 #include "tss2_tctildr.h"
 
 #include "esys_iutil.h"
+#include "esys_mdcache.h"
 #include "tss2-tcti/tctildr-interface.h"
 #define LOGMODULE esys
 #include "util/log.h"
 #include "util/aux_util.h"
 
+/** The offset of the SAPI context within storage passed to Esys_InitializeEx.
+ *
+ * Rounded up so that the SAPI context is aligned as if it had been returned by
+ * malloc.
+ */
+#define ESYS_SYS_CONTEXT_ALIGN 16
+#define ESYS_SYS_CONTEXT_OFFSET \
+    ((sizeof(ESYS_CONTEXT) + ESYS_SYS_CONTEXT_ALIGN - 1) / \
+     ESYS_SYS_CONTEXT_ALIGN * ESYS_SYS_CONTEXT_ALIGN)
+
+/** Initialize the SAPI context and the crypto backend of an ESYS_CONTEXT.
+ *
+ * Common part of Esys_Initialize and Esys_InitializeEx. The memory of the
+ * ESYS_CONTEXT and of the SAPI context must already be provided.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param syssize [in] The size of the memory of the SAPI context.
+ * @param tcti [in] The TCTI context used to connect to the TPM.
+ * @param abiVersion [in,out] The abi version to check (may be NULL).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the crypto backend can't be
+ *         initialized.
+ * @retval TSS2_SYS_RC_* for SAPI errors.
+ */
+static TSS2_RC
+esys_initialize_context(ESYS_CONTEXT * esys_context, size_t syssize,
+                        TSS2_TCTI_CONTEXT * tcti,
+                        TSS2_ABI_VERSION * abiVersion)
+{
+    TSS2_RC r;
+
+    /* Initialize the ESAPI */
+    r = Tss2_Sys_Initialize(esys_context->sys, syssize, tcti, abiVersion);
+    return_if_error(r, "During syscontext initialization");
+
+    /* Hash the command parameters while SAPI marshals them */
+    r = Tss2_Sys_SetCpCallback(esys_context->sys, iesys_cp_stream_callback,
+                               esys_context);
+    return_if_error(r, "Set cp callback");
+
+    /* Use random number for initial esys handle value to provide pseudo
+       namespace for handles */
+    esys_context->esys_handle_cnt = ESYS_TR_MIN_OBJECT + (rand() % 6000000);
+
+    /* Initialize crypto backend. */
+    r = iesys_initialize_crypto();
+    return_if_error(r, "Initialize crypto backend.");
+
+    /* Resubmit commands right away by default. */
+    r = iesys_set_resubmission_policy(esys_context, NULL);
+    return_if_error(r, "Initialize resubmission policy.");
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** Initialize an ESYS_CONTEXT for further use.
  *
  * Initialize an ESYS_CONTEXT that holds all the state and metadata information
@@ -69,17 +125,8 @@ Esys_Initialize(ESYS_CONTEXT ** esys_context, TSS2_TCTI_CONTEXT * tcti,
         goto_if_error(r, "Initialize default tcti.", cleanup_return);
     }
 
-    /* Initialize the ESAPI */
-    r = Tss2_Sys_Initialize((*esys_context)->sys, syssize, tcti, abiVersion);
-    goto_if_error(r, "During syscontext initialization", cleanup_return);
-
-    /* Use random number for initial esys handle value to provide pseudo
-       namespace for handles */
-    (*esys_context)->esys_handle_cnt = ESYS_TR_MIN_OBJECT + (rand() % 6000000);
-
-    /* Initialize crypto backend. */
-    r = iesys_initialize_crypto();
-    goto_if_error(r, "Initialize crypto backend.", cleanup_return);
+    r = esys_initialize_context(*esys_context, syssize, tcti, abiVersion);
+    goto_if_error(r, "Initialize esys context.", cleanup_return);
 
     return TSS2_RC_SUCCESS;
 
@@ -97,6 +144,74 @@ cleanup_return:
     return r;
 }
 
+/** Return the size of the storage needed by Esys_InitializeEx.
+ *
+ * The storage holds the ESYS_CONTEXT together with its SAPI context.
+ * @retval The number of bytes to pass to Esys_InitializeEx.
+ */
+size_t
+Esys_GetContextSize(void)
+{
+    return ESYS_SYS_CONTEXT_OFFSET + Tss2_Sys_GetContextSize(0);
+}
+
+/** Initialize an ESYS_CONTEXT in caller provided storage.
+ *
+ * Like Esys_Initialize, but the ESYS_CONTEXT and its SAPI context are placed
+ * in storage provided by the caller, and the TCTI must already be initialized.
+ * Once the crypto backend has been initialized by a previous context, this
+ * function neither allocates memory nor loads any library. This is intended
+ * for applications that create and finalize many short-lived contexts.
+ * Esys_Finalize finalizes the context but does not free the storage; the TCTI
+ * is not finalized either.
+ * @param esys_context [out] The ESYS_CONTEXT (points into storage).
+ * @param storage [in] The memory for the context, aligned as if returned by
+ *        malloc. It must stay valid until Esys_Finalize was called.
+ * @param storage_size [in] The size of storage, at least
+ *        Esys_GetContextSize().
+ * @param tcti [in] The TCTI context used to connect to the TPM.
+ * @param abiVersion [in,out] The abi version to check and the abi version
+ *        supported by this implementation (may be NULL).
+ * @retval TSS2_ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esys_context, storage or tcti is NULL.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_CONTEXT if storage_size is too small.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_InitializeEx(ESYS_CONTEXT ** esys_context, void *storage,
+                  size_t storage_size, TSS2_TCTI_CONTEXT * tcti,
+                  TSS2_ABI_VERSION * abiVersion)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ctx;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    *esys_context = NULL;
+    _ESYS_ASSERT_NON_NULL(storage);
+    _ESYS_ASSERT_NON_NULL(tcti);
+
+    if (storage_size < Esys_GetContextSize()) {
+        LOG_ERROR("Storage of %zu bytes too small, %zu bytes needed.",
+                  storage_size, Esys_GetContextSize());
+        return TSS2_ESYS_RC_INSUFFICIENT_CONTEXT;
+    }
+
+    ctx = storage;
+    memset(ctx, 0, sizeof(ESYS_CONTEXT));
+    ctx->caller_storage = true;
+    ctx->tcti_app_param = tcti;
+    ctx->sys = (TSS2_SYS_CONTEXT *) ((uint8_t *) storage +
+                                     ESYS_SYS_CONTEXT_OFFSET);
+
+    r = esys_initialize_context(ctx, storage_size - ESYS_SYS_CONTEXT_OFFSET,
+                                tcti, abiVersion);
+    return_if_error(r, "Initialize esys context.");
+
+    *esys_context = ctx;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Finalize an ESYS_CONTEXT
  *
  * After interactions with the TPM the context holding the metadata needs to be
@@ -131,6 +246,17 @@ Esys_Finalize(ESYS_CONTEXT ** esys_context)
 
     /* Finalize the syscontext */
     Tss2_Sys_Finalize((*esys_context)->sys);
+
+    iesys_mdcache_free(*esys_context);
+    iesys_free_resubmission(*esys_context);
+    iesys_crypto_sym_free(&(*esys_context)->sym_context);
+    iesys_abort_cp_stream(*esys_context);
+
+    /* Storage provided to Esys_InitializeEx is owned by the application. */
+    if ((*esys_context)->caller_storage) {
+        *esys_context = NULL;
+        return;
+    }
     free((*esys_context)->sys);
 
     /* If no tcti context was provided during initialization, then we need to
@@ -182,11 +308,16 @@ Esys_GetPollHandles(ESYS_CONTEXT * esys_context,
 {
     TSS2_RC r;
     TSS2_TCTI_CONTEXT *tcti_context;
+    TSS2_TCTI_POLL_HANDLE timer;
+    size_t timers;
 
     _ESYS_ASSERT_NON_NULL(esys_context);
     _ESYS_ASSERT_NON_NULL(handles);
     _ESYS_ASSERT_NON_NULL(count);
 
+    /* The resubmission timer is appended to the handles of the tcti. */
+    timers = iesys_resubmission_poll_handle(esys_context, &timer) ? 1 : 0;
+
     /* Get the tcti-context to use */
     r = Tss2_Sys_GetTctiContext(esys_context->sys, &tcti_context);
     return_if_error(r, "Invalid SAPI or TCTI context.");
@@ -194,12 +325,14 @@ Esys_GetPollHandles(ESYS_CONTEXT * esys_context,
     /* Allocate the memory to hold the poll handles */
     r = Tss2_Tcti_GetPollHandles(tcti_context, NULL, count);
     return_if_error(r, "Error getting poll handle count.");
-    *handles = calloc(*count, sizeof(TSS2_TCTI_POLL_HANDLE));
+    *handles = calloc(*count + timers, sizeof(TSS2_TCTI_POLL_HANDLE));
     return_if_null(*handles, "Out of memory.", TSS2_ESYS_RC_MEMORY);
 
     /* Retrieve the poll handles */
     r = Tss2_Tcti_GetPollHandles(tcti_context, *handles, count);
     return_if_error(r, "Error getting poll handles.");
+    if (timers > 0)
+        (*handles)[(*count)++] = timer;
     return r;
 }
 
@@ -220,6 +353,56 @@ Esys_SetTimeout(ESYS_CONTEXT * esys_context, int32_t timeout)
     return TSS2_RC_SUCCESS;
 }
 
+/** Set the metadata cache of Esys_TR_FromTPMPublic.
+ *
+ * Enables a cache file for the metadata (name and public area) of persistent
+ * objects and NV indices. Esys_TR_FromTPMPublic then serves cached handles
+ * without sending TPM2_ReadPublic or TPM2_NV_ReadPublic; only the first call
+ * per context reads the TPM's clock to check that the cache belongs to the
+ * same TPM and that it has not been cleared or reset since. Commands that
+ * change or delete persistent objects or NV indices update the cache.
+ * The cache file can be shared by several processes using the same TPM; their
+ * changes are serialized by a lock on the file path.lock, which is created
+ * next to it. The cache file must be protected like the keystore of the
+ * application, since its contents are trusted in place of the TPM's answers.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param path [in] The path of the cache file, or NULL to disable the cache.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the path can not be copied.
+ */
+TSS2_RC
+Esys_SetMetadataCache(ESYS_CONTEXT * esys_context, const char *path)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    return iesys_mdcache_set_path(esys_context, path);
+}
+
+/** Set the resubmission policy of Esys commands.
+ *
+ * Commands answered with TPM2_RC_YIELDED, TPM2_RC_TESTING or TPM2_RC_RETRY
+ * are resubmitted up to maxSubmissions times. Each resubmission is delayed
+ * by an exponential backoff starting at initialDelay and spread by a random
+ * jitter. The asynchronous _Finish() functions do not block for the delay
+ * beyond the timeout of the context but return TSS2_ESYS_RC_TRY_AGAIN. On
+ * Linux, Esys_GetPollHandles then also returns a timer handle that becomes
+ * readable when the resubmission is due.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param policy [in] The policy, or NULL to resubmit immediately up to five
+ *        times (the default).
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the policy is invalid.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the timer can not be created.
+ */
+TSS2_RC
+Esys_SetResubmissionPolicy(ESYS_CONTEXT * esys_context,
+                           const ESYS_RESUBMISSION_POLICY *policy)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    return iesys_set_resubmission_policy(esys_context, policy);
+}
+
 /** Helper function that returns sys contest from the give esys context.
  *
  * Function returns sys contest from the give esys context.
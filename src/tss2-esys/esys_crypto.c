@@ -60,6 +60,61 @@ iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t * size)
     return TSS2_RC_SUCCESS;
 }
 
+/** Hash a batch of independent messages with one hash algorithm.
+ *
+ * If the multi-buffer kernel supports hashAlg on this platform, the
+ * messages are hashed in parallel lanes by iesys_crypto_mb_hash(). Otherwise
+ * they are hashed one after the other with the crypto backend.
+ *
+ * @param[in] hashAlg The hash algorithm.
+ * @param[in,out] jobs The messages and the buffers for their digests. Every
+ *                digest buffer must hold a digest of hashAlg.
+ * @param[in] n_jobs The number of entries in jobs.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if jobs is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if hashAlg is unknown.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if the backend does not support hashAlg.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_hash_batch(
+    TPM2_ALG_ID hashAlg,
+    IESYS_CRYPTO_MB_JOB *jobs,
+    size_t n_jobs)
+{
+    TSS2_RC r;
+    IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
+    size_t i, digest_size, size;
+
+    LOG_TRACE("call: hashAlg=%"PRIu16" jobs=%p n_jobs=%zu", hashAlg, jobs, n_jobs);
+    return_if_null(jobs, "jobs is NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = iesys_crypto_hash_get_digest_size(hashAlg, &digest_size);
+    return_if_error(r, "Get digest size");
+
+    if (iesys_crypto_mb_supported(hashAlg)) {
+        iesys_crypto_mb_hash(hashAlg, jobs, n_jobs);
+        return TSS2_RC_SUCCESS;
+    }
+
+    for (i = 0; i < n_jobs; i++) {
+        r = iesys_crypto_hash_start(&cryptoContext, hashAlg);
+        return_if_error(r, "Error hash start");
+
+        r = iesys_crypto_hash_update(cryptoContext, jobs[i].buffer, jobs[i].size);
+        goto_if_error(r, "Error hash update", error_cleanup);
+
+        size = digest_size;
+        r = iesys_crypto_hash_finish(&cryptoContext, jobs[i].digest, &size);
+        return_if_error(r, "Error hash finish");
+    }
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    iesys_crypto_hash_abort(&cryptoContext);
+    return r;
+}
+
 /** Compute the command or response parameter hash.
  *
  * These hashes are needed for the computation of the HMAC used for the
@@ -525,14 +580,41 @@ iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
 }
 
 
+/** Set once the crypto backend has been initialized successfully. Accessed
+ *  with acquire/release semantics, so a thread that sees it set also sees the
+ *  state written by iesys_crypto_init(). */
+#if !defined(_MSC_VER) || defined(__INTEL_COMPILER)
+static bool crypto_initialized = false;
+#define crypto_initialized_load() \
+    __atomic_load_n(&crypto_initialized, __ATOMIC_ACQUIRE)
+#define crypto_initialized_store() \
+    __atomic_store_n(&crypto_initialized, true, __ATOMIC_RELEASE)
+#else
+/* Visual Studio gives volatile accesses acquire/release semantics */
+static volatile bool crypto_initialized = false;
+#define crypto_initialized_load() (crypto_initialized)
+#define crypto_initialized_store() (crypto_initialized = true)
+#endif
+
 /** Initialize crypto backend.
  *
- * Initialize internal tables of crypto backend.
+ * Initialize internal tables of crypto backend. The backend is only
+ * initialized once per process; later calls return immediately. Concurrent
+ * first calls may both initialize the backend, which is harmless.
  *
  * @retval TSS2_RC_SUCCESS ong success.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE if backend can't be initialized.
  */
 TSS2_RC
 iesys_initialize_crypto() {
-    return iesys_crypto_init();
+    TSS2_RC r;
+
+    if (crypto_initialized_load())
+        return TSS2_RC_SUCCESS;
+
+    r = iesys_crypto_init();
+    return_if_error(r, "Initialize crypto backend.");
+
+    crypto_initialized_store();
+    return TSS2_RC_SUCCESS;
 }
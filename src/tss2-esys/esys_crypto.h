@@ -9,6 +9,7 @@
 #include <stddef.h>
 #include "tss2_tpm2_types.h"
 #include "tss2-sys/sysapi_util.h"
+#include "esys_crypto_mb.h"
 #ifdef OSSL
 #include "esys_crypto_ossl.h"
 #else
@@ -23,6 +24,11 @@ extern "C" {
 
 TSS2_RC iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t *size);
 
+TSS2_RC iesys_crypto_hash_batch(
+    TPM2_ALG_ID hashAlg,
+    IESYS_CRYPTO_MB_JOB *jobs,
+    size_t n_jobs);
+
 TSS2_RC iesys_crypto_pHash(
     TPM2_ALG_ID alg,
     const uint8_t rcBuffer[4],
@@ -1069,6 +1069,120 @@ iesys_cryptogcry_sym_aes_decrypt(uint8_t * key,
     return r;
 }
 
+/** Reusable state for AES-CFB parameter encryption. */
+struct _IESYS_CRYPTO_SYM_CONTEXT {
+    gcry_cipher_hd_t cipher_hd;      /**< Re-keyed for every operation. */
+    int algo;                        /**< The algorithm of cipher_hd or 0. */
+};
+
+/** Encrypt or decrypt data in place with AES in CFB mode.
+ *
+ * The context is created on first use and kept by the caller. Later calls
+ * only re-key its cipher handle, which is reopened only if the key size
+ * changes.
+ * @param[in,out] context The symmetric crypto context (callee-allocated if
+ *                NULL, free with iesys_cryptogcry_sym_free()).
+ * @param[in] encrypt true to encrypt, false to decrypt.
+ * @param[in] key key used for AES.
+ * @param[in] key_bits Key size in bits.
+ * @param[in,out] buffer Data to be encrypted or decrypted in place.
+ * @param[in] buffer_size size of the data.
+ * @param[in] iv The initialization vector of AES_BLOCK_SIZE_IN_BYTES.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for NULL parameters.
+ * @retval TSS2_ESYS_RC_BAD_VALUE for an invalid key size.
+ * @retval TSS2_ESYS_RC_MEMORY if the context can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptogcry_sym_aes_cfb(IESYS_CRYPTO_SYM_CONTEXT_BLOB ** context,
+                             bool encrypt,
+                             uint8_t * key,
+                             TPMI_AES_KEY_BITS key_bits,
+                             uint8_t * buffer,
+                             size_t buffer_size,
+                             uint8_t * iv)
+{
+    gcry_error_t err;
+    int algo;
+
+    if (context == NULL || key == NULL || buffer == NULL) {
+        LOG_ERROR("Bad reference");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    switch (key_bits) {
+    case 128:
+        algo = GCRY_CIPHER_AES128;
+        break;
+    case 192:
+        algo = GCRY_CIPHER_AES192;
+        break;
+    case 256:
+        algo = GCRY_CIPHER_AES256;
+        break;
+    default:
+        LOG_ERROR("Illegal key length.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    if (*context == NULL) {
+        *context = calloc(1, sizeof(IESYS_CRYPTO_SYM_CONTEXT_BLOB));
+        return_if_null(*context, "Out of memory", TSS2_ESYS_RC_MEMORY);
+    }
+
+    if ((*context)->algo != algo) {
+        if ((*context)->algo != 0)
+            gcry_cipher_close((*context)->cipher_hd);
+        (*context)->algo = 0;
+        err = gcry_cipher_open(&(*context)->cipher_hd, algo,
+                               GCRY_CIPHER_MODE_CFB, 0);
+        if (err != GPG_ERR_NO_ERROR) {
+            LOG_ERROR("Opening gcrypt context");
+            return TSS2_ESYS_RC_GENERAL_FAILURE;
+        }
+        (*context)->algo = algo;
+    }
+
+    err = gcry_cipher_setkey((*context)->cipher_hd, key, key_bits / 8);
+    if (err == GPG_ERR_NO_ERROR)
+        err = gcry_cipher_setiv((*context)->cipher_hd, iv,
+                                AES_BLOCK_SIZE_IN_BYTES);
+    if (err != GPG_ERR_NO_ERROR) {
+        LOG_ERROR("Setting key and iv");
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+
+    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
+    if (encrypt)
+        err = gcry_cipher_encrypt((*context)->cipher_hd, buffer, buffer_size,
+                                  NULL, 0);
+    else
+        err = gcry_cipher_decrypt((*context)->cipher_hd, buffer, buffer_size,
+                                  NULL, 0);
+    if (err != GPG_ERR_NO_ERROR) {
+        LOG_ERROR("Function gcry_cipher_%s", encrypt ? "encrypt" : "decrypt");
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free a symmetric crypto context.
+ *
+ * @param[in,out] context The context. Will be set to NULL.
+ */
+void
+iesys_cryptogcry_sym_free(IESYS_CRYPTO_SYM_CONTEXT_BLOB ** context)
+{
+    if (context == NULL || *context == NULL)
+        return;
+
+    if ((*context)->algo != 0)
+        gcry_cipher_close((*context)->cipher_hd);
+    SAFE_FREE(*context);
+}
+
 /** Initialize gcrypt crypto backend.
  *
  * Initialize gcrypt internal tables.
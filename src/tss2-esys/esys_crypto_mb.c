@@ -0,0 +1,356 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "esys_crypto_mb.h"
+
+/*
+ * Multi-buffer SHA-256: the messages of IESYS_CRYPTO_MB_LANES jobs are
+ * compressed together, one 32 bit lane of a vector per message. The kernel
+ * uses the vector extension of GCC and clang, so the compiler emits SSE2,
+ * NEON or AltiVec code as available. On x86 further copies of the kernel are
+ * compiled for AVX2 and for AVX-512VL, which has a rotate instruction, and
+ * selected at runtime. Other compilers get no kernel and callers fall back
+ * to hashing the messages one by one.
+ */
+#if defined(__GNUC__)
+#define SHA256_MB_KERNEL
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_MB_KERNEL_AVX2
+#if defined(__clang__) || __GNUC__ >= 6
+#define SHA256_MB_KERNEL_AVX512
+#endif
+#endif
+
+#if IESYS_CRYPTO_MB_LANES != 8
+#error "The message loading of sha256_mb_compress() assumes 8 lanes"
+#endif
+
+typedef uint32_t mb_vec __attribute__((vector_size(4 * IESYS_CRYPTO_MB_LANES)));
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x) (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define BSIG1(x) (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define SSIG0(x) (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+/* Extend the message schedule in place; w[i & 15] holds W[i - 16] before
+ * the update. */
+#define SHA256_MB_SCHEDULE(i) \
+    (w[(i) & 15] += SSIG1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + \
+                    SSIG0(w[((i) - 15) & 15]))
+
+/* One round; the callers rotate the roles of the working variables instead
+ * of moving their values. */
+#define SHA256_MB_ROUND(a, b, c, d, e, f, g, h, i, wi) do { \
+        t1 = h + BSIG1(e) + CH(e, f, g) + sha256_k[i] + (wi); \
+        t2 = BSIG0(a) + MAJ(a, b, c); \
+        d += t1; \
+        h = t1 + t2; \
+    } while (0)
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_h0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** The state of a message being hashed in one lane.
+ */
+typedef struct {
+    IESYS_CRYPTO_MB_JOB *job;   /**< The job of the lane or NULL if idle */
+    size_t block;               /**< The next block to be compressed */
+    size_t n_full;              /**< Number of blocks read from the message */
+    size_t n_blocks;            /**< Number of blocks including the padding */
+    uint8_t tail[128];          /**< The padded end of the message */
+} SHA256_MB_LANE;
+
+typedef void (*SHA256_MB_COMPRESS)(
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES]);
+
+static inline uint32_t
+load_be32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+           ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static inline void
+store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+/** Compress one block of every lane.
+ *
+ * Inlined into one wrapper per instruction set, so the vector operations
+ * are compiled for the instruction set of the wrapper.
+ *
+ * @param[in,out] state The chaining values; state[i][l] is word i of lane l.
+ * @param[in] blocks The next 64 byte block of every lane.
+ */
+static inline __attribute__((always_inline)) void
+sha256_mb_compress(
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES])
+{
+    mb_vec a, b, c, d, e, f, g, h, t1, t2, w[16];
+    size_t i;
+
+    memcpy(&a, state[0], sizeof(mb_vec));
+    memcpy(&b, state[1], sizeof(mb_vec));
+    memcpy(&c, state[2], sizeof(mb_vec));
+    memcpy(&d, state[3], sizeof(mb_vec));
+    memcpy(&e, state[4], sizeof(mb_vec));
+    memcpy(&f, state[5], sizeof(mb_vec));
+    memcpy(&g, state[6], sizeof(mb_vec));
+    memcpy(&h, state[7], sizeof(mb_vec));
+
+    for (i = 0; i < 16; i++) {
+        w[i] = (mb_vec) {
+            load_be32(&blocks[0][4 * i]), load_be32(&blocks[1][4 * i]),
+            load_be32(&blocks[2][4 * i]), load_be32(&blocks[3][4 * i]),
+            load_be32(&blocks[4][4 * i]), load_be32(&blocks[5][4 * i]),
+            load_be32(&blocks[6][4 * i]), load_be32(&blocks[7][4 * i])
+        };
+    }
+
+    for (i = 0; i < 16; i += 8) {
+        SHA256_MB_ROUND(a, b, c, d, e, f, g, h, i + 0, w[i + 0]);
+        SHA256_MB_ROUND(h, a, b, c, d, e, f, g, i + 1, w[i + 1]);
+        SHA256_MB_ROUND(g, h, a, b, c, d, e, f, i + 2, w[i + 2]);
+        SHA256_MB_ROUND(f, g, h, a, b, c, d, e, i + 3, w[i + 3]);
+        SHA256_MB_ROUND(e, f, g, h, a, b, c, d, i + 4, w[i + 4]);
+        SHA256_MB_ROUND(d, e, f, g, h, a, b, c, i + 5, w[i + 5]);
+        SHA256_MB_ROUND(c, d, e, f, g, h, a, b, i + 6, w[i + 6]);
+        SHA256_MB_ROUND(b, c, d, e, f, g, h, a, i + 7, w[i + 7]);
+    }
+    for (; i < 64; i += 8) {
+        SHA256_MB_ROUND(a, b, c, d, e, f, g, h, i + 0, SHA256_MB_SCHEDULE(i + 0));
+        SHA256_MB_ROUND(h, a, b, c, d, e, f, g, i + 1, SHA256_MB_SCHEDULE(i + 1));
+        SHA256_MB_ROUND(g, h, a, b, c, d, e, f, i + 2, SHA256_MB_SCHEDULE(i + 2));
+        SHA256_MB_ROUND(f, g, h, a, b, c, d, e, i + 3, SHA256_MB_SCHEDULE(i + 3));
+        SHA256_MB_ROUND(e, f, g, h, a, b, c, d, i + 4, SHA256_MB_SCHEDULE(i + 4));
+        SHA256_MB_ROUND(d, e, f, g, h, a, b, c, i + 5, SHA256_MB_SCHEDULE(i + 5));
+        SHA256_MB_ROUND(c, d, e, f, g, h, a, b, i + 6, SHA256_MB_SCHEDULE(i + 6));
+        SHA256_MB_ROUND(b, c, d, e, f, g, h, a, i + 7, SHA256_MB_SCHEDULE(i + 7));
+    }
+
+#define SHA256_MB_ADD(i, v) do { \
+        mb_vec s; \
+        memcpy(&s, state[i], sizeof(mb_vec)); \
+        s += v; \
+        memcpy(state[i], &s, sizeof(mb_vec)); \
+    } while (0)
+    SHA256_MB_ADD(0, a);
+    SHA256_MB_ADD(1, b);
+    SHA256_MB_ADD(2, c);
+    SHA256_MB_ADD(3, d);
+    SHA256_MB_ADD(4, e);
+    SHA256_MB_ADD(5, f);
+    SHA256_MB_ADD(6, g);
+    SHA256_MB_ADD(7, h);
+#undef SHA256_MB_ADD
+}
+
+static void
+sha256_mb_compress_generic(
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES])
+{
+    sha256_mb_compress(state, blocks);
+}
+
+#ifdef SHA256_MB_KERNEL_AVX2
+__attribute__((target("avx2"))) static void
+sha256_mb_compress_avx2(
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES])
+{
+    sha256_mb_compress(state, blocks);
+}
+#endif /* SHA256_MB_KERNEL_AVX2 */
+
+#ifdef SHA256_MB_KERNEL_AVX512
+__attribute__((target("avx2,avx512f,avx512vl"))) static void
+sha256_mb_compress_avx512(
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES])
+{
+    sha256_mb_compress(state, blocks);
+}
+#endif /* SHA256_MB_KERNEL_AVX512 */
+
+/** Select the kernel for the CPU we are running on.
+ */
+static SHA256_MB_COMPRESS
+sha256_mb_kernel(void)
+{
+#ifdef SHA256_MB_KERNEL_AVX2
+    __builtin_cpu_init();
+#ifdef SHA256_MB_KERNEL_AVX512
+    if (__builtin_cpu_supports("avx512vl"))
+        return sha256_mb_compress_avx512;
+#endif /* SHA256_MB_KERNEL_AVX512 */
+    if (__builtin_cpu_supports("avx2"))
+        return sha256_mb_compress_avx2;
+#endif /* SHA256_MB_KERNEL_AVX2 */
+    return sha256_mb_compress_generic;
+}
+
+/** Assign a job to an idle lane and reset the chaining values of the lane.
+ */
+static void
+sha256_mb_lane_start(
+    SHA256_MB_LANE *lane,
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES],
+    size_t l,
+    IESYS_CRYPTO_MB_JOB *job)
+{
+    size_t i, rest = job->size % 64;
+    uint64_t bits = (uint64_t) job->size * 8;
+
+    lane->job = job;
+    lane->block = 0;
+    lane->n_full = job->size / 64;
+    lane->n_blocks = lane->n_full + (rest + 9 > 64 ? 2 : 1);
+
+    memset(&lane->tail[0], 0, sizeof(lane->tail));
+    if (rest)
+        memcpy(&lane->tail[0], &job->buffer[lane->n_full * 64], rest);
+    lane->tail[rest] = 0x80;
+    store_be32(&lane->tail[(lane->n_blocks - lane->n_full) * 64 - 8],
+               (uint32_t) (bits >> 32));
+    store_be32(&lane->tail[(lane->n_blocks - lane->n_full) * 64 - 4],
+               (uint32_t) bits);
+
+    for (i = 0; i < 8; i++)
+        state[i][l] = sha256_h0[i];
+}
+
+/** Compute the SHA-256 digests of a batch of messages.
+ *
+ * Every lane takes the next job as soon as its current message is
+ * finished, so messages of different lengths can be mixed. Lanes without
+ * a job compress a dummy block.
+ */
+static void
+sha256_mb_hash(IESYS_CRYPTO_MB_JOB *jobs, size_t n_jobs)
+{
+    static const uint8_t idle[64];
+    SHA256_MB_COMPRESS compress = sha256_mb_kernel();
+    SHA256_MB_LANE lanes[IESYS_CRYPTO_MB_LANES];
+    uint32_t state[8][IESYS_CRYPTO_MB_LANES];
+    const uint8_t *blocks[IESYS_CRYPTO_MB_LANES];
+    SHA256_MB_LANE *lane;
+    size_t i, l, next = 0, active = 0;
+
+    memset(&lanes, 0, sizeof(lanes));
+    memset(&state, 0, sizeof(state));
+
+    for (;;) {
+        for (l = 0; l < IESYS_CRYPTO_MB_LANES; l++) {
+            if (!lanes[l].job && next < n_jobs) {
+                sha256_mb_lane_start(&lanes[l], state, l, &jobs[next++]);
+                active += 1;
+            }
+        }
+        if (active == 0)
+            break;
+
+        for (l = 0; l < IESYS_CRYPTO_MB_LANES; l++) {
+            lane = &lanes[l];
+            if (!lane->job)
+                blocks[l] = &idle[0];
+            else if (lane->block < lane->n_full)
+                blocks[l] = &lane->job->buffer[lane->block * 64];
+            else
+                blocks[l] = &lane->tail[(lane->block - lane->n_full) * 64];
+        }
+
+        compress(state, blocks);
+
+        for (l = 0; l < IESYS_CRYPTO_MB_LANES; l++) {
+            lane = &lanes[l];
+            if (!lane->job || ++lane->block < lane->n_blocks)
+                continue;
+            for (i = 0; i < 8; i++)
+                store_be32(&lane->job->digest[4 * i], state[i][l]);
+            lane->job = NULL;
+            active -= 1;
+        }
+    }
+}
+#endif /* __GNUC__ */
+
+/** Check whether iesys_crypto_mb_hash() supports a hash algorithm.
+ *
+ * @param[in] hashAlg The hash algorithm.
+ * @retval true if the messages can be hashed with the multi-buffer kernel.
+ * @retval false if the caller has to hash the messages one by one.
+ */
+bool
+iesys_crypto_mb_supported(TPM2_ALG_ID hashAlg)
+{
+#ifdef SHA256_MB_KERNEL
+    return hashAlg == TPM2_ALG_SHA256;
+#else
+    (void) hashAlg;
+    return false;
+#endif /* SHA256_MB_KERNEL */
+}
+
+/** Hash a batch of independent messages with one hash algorithm.
+ *
+ * Up to IESYS_CRYPTO_MB_LANES messages are processed in parallel with SIMD
+ * instructions. The digest of a job must not overlap the message of another
+ * job of the batch.
+ *
+ * @param[in] hashAlg The hash algorithm. It has to be supported according to
+ *            iesys_crypto_mb_supported(), otherwise no digest is computed.
+ * @param[in,out] jobs The messages and the buffers for their digests.
+ * @param[in] n_jobs The number of entries in jobs.
+ */
+void
+iesys_crypto_mb_hash(
+    TPM2_ALG_ID hashAlg,
+    IESYS_CRYPTO_MB_JOB *jobs,
+    size_t n_jobs)
+{
+#ifdef SHA256_MB_KERNEL
+    if (hashAlg == TPM2_ALG_SHA256)
+        sha256_mb_hash(jobs, n_jobs);
+#else
+    (void) hashAlg;
+    (void) jobs;
+    (void) n_jobs;
+#endif /* SHA256_MB_KERNEL */
+}
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+#ifndef ESYS_CRYPTO_MB_H
+#define ESYS_CRYPTO_MB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tss2_tpm2_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of messages hashed in parallel by the multi-buffer kernel */
+#define IESYS_CRYPTO_MB_LANES 8
+
+/** One message of a batch of independent hash computations.
+ */
+typedef struct IESYS_CRYPTO_MB_JOB {
+    const uint8_t *buffer;      /**< The message */
+    size_t size;                /**< The length of the message */
+    uint8_t *digest;            /**< Receives the digest of the message */
+} IESYS_CRYPTO_MB_JOB;
+
+bool iesys_crypto_mb_supported(TPM2_ALG_ID hashAlg);
+
+void iesys_crypto_mb_hash(
+    TPM2_ALG_ID hashAlg,
+    IESYS_CRYPTO_MB_JOB *jobs,
+    size_t n_jobs);
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif /* ESYS_CRYPTO_MB_H */
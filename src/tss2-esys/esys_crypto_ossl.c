@@ -942,6 +942,155 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
     return r;
 }
 
+/** Reusable state for AES-CFB parameter encryption. */
+struct _IESYS_CRYPTO_SYM_CONTEXT {
+    EVP_CIPHER_CTX *ossl_context;    /**< Re-keyed for every operation. */
+    const EVP_CIPHER *cipher;        /**< The cipher the context is set up for. */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_CIPHER *fetched[3];          /**< AES-128/192/256-CFB, fetched once. */
+#endif
+};
+
+/** Return the AES-CFB cipher for a key size.
+ *
+ * With OpenSSL 3 the cipher is fetched from the provider once per context
+ * instead of being looked up implicitly on every initialization.
+ * @param[in,out] context The symmetric crypto context.
+ * @param[in] key_bits Key size in bits.
+ * @retval The cipher or NULL if the key size is not supported.
+ */
+static const EVP_CIPHER *
+iesys_cryptossl_get_aes_cfb(IESYS_CRYPTO_SYM_CONTEXT_BLOB *context,
+                            TPMI_AES_KEY_BITS key_bits)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static const char *names[] = { "AES-128-CFB", "AES-192-CFB", "AES-256-CFB" };
+    int i;
+
+    switch (key_bits) {
+    case 128:
+        i = 0;
+        break;
+    case 192:
+        i = 1;
+        break;
+    case 256:
+        i = 2;
+        break;
+    default:
+        return NULL;
+    }
+    if (context->fetched[i] == NULL)
+        context->fetched[i] = EVP_CIPHER_fetch(NULL, names[i], NULL);
+    return context->fetched[i];
+#else
+    (void)context;
+    switch (key_bits) {
+    case 128:
+        return EVP_aes_128_cfb();
+    case 192:
+        return EVP_aes_192_cfb();
+    case 256:
+        return EVP_aes_256_cfb();
+    default:
+        return NULL;
+    }
+#endif
+}
+
+/** Encrypt or decrypt data in place with AES in CFB mode.
+ *
+ * The context is created on first use and kept by the caller. Later calls
+ * only re-key it, so that no cipher context is allocated per operation.
+ * @param[in,out] context The symmetric crypto context (callee-allocated if
+ *                NULL, free with iesys_cryptossl_sym_free()).
+ * @param[in] encrypt true to encrypt, false to decrypt.
+ * @param[in] key key used for AES.
+ * @param[in] key_bits Key size in bits.
+ * @param[in,out] buffer Data to be encrypted or decrypted in place.
+ * @param[in] buffer_size size of the data.
+ * @param[in] iv The initialization vector of AES_BLOCK_SIZE_IN_BYTES.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for NULL parameters.
+ * @retval TSS2_ESYS_RC_BAD_VALUE for an invalid key size.
+ * @retval TSS2_ESYS_RC_MEMORY if the context can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_sym_aes_cfb(IESYS_CRYPTO_SYM_CONTEXT_BLOB ** context,
+                            bool encrypt,
+                            uint8_t * key,
+                            TPMI_AES_KEY_BITS key_bits,
+                            uint8_t * buffer,
+                            size_t buffer_size,
+                            uint8_t * iv)
+{
+    const EVP_CIPHER *cipher_alg;
+    int cipher_len;
+
+    if (context == NULL || key == NULL || buffer == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    }
+
+    if (*context == NULL) {
+        *context = calloc(1, sizeof(IESYS_CRYPTO_SYM_CONTEXT_BLOB));
+        return_if_null(*context, "Out of memory", TSS2_ESYS_RC_MEMORY);
+        if (!((*context)->ossl_context = EVP_CIPHER_CTX_new())) {
+            SAFE_FREE(*context);
+            return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
+                         "Initialize cipher context");
+        }
+    }
+
+    cipher_alg = iesys_cryptossl_get_aes_cfb(*context, key_bits);
+    if (cipher_alg == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES algorithm not implemented or illegal key size.");
+    }
+
+    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
+
+    /* Only re-key the context if it is already set up for the cipher. */
+    if (1 != EVP_CipherInit_ex((*context)->ossl_context,
+                               cipher_alg == (*context)->cipher ?
+                               NULL : cipher_alg,
+                               NULL, key, iv, encrypt ? 1 : 0)) {
+        (*context)->cipher = NULL;
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
+                     "Initialize cipher operation");
+    }
+    (*context)->cipher = cipher_alg;
+
+    if (1 != EVP_CipherUpdate((*context)->ossl_context, buffer, &cipher_len,
+                              buffer, buffer_size)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "Cipher update");
+    }
+    if (1 != EVP_CipherFinal_ex((*context)->ossl_context, buffer + cipher_len,
+                                &cipher_len)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "Cipher final");
+    }
+    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free a symmetric crypto context.
+ *
+ * @param[in,out] context The context. Will be set to NULL.
+ */
+void
+iesys_cryptossl_sym_free(IESYS_CRYPTO_SYM_CONTEXT_BLOB ** context)
+{
+    if (context == NULL || *context == NULL)
+        return;
+
+    OSSL_FREE((*context)->ossl_context, EVP_CIPHER_CTX);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    for (size_t i = 0; i < 3; i++)
+        OSSL_FREE((*context)->fetched[i], EVP_CIPHER);
+#endif
+    SAFE_FREE(*context);
+}
+
 /** Encrypt data with AES.
  *
  * @param[in] key key used for AES.
@@ -968,65 +1117,29 @@ iesys_cryptossl_sym_aes_encrypt(uint8_t * key,
                                 size_t buffer_size,
                                 uint8_t * iv)
 {
-    TSS2_RC r = TSS2_RC_SUCCESS;
-    const EVP_CIPHER  *cipher_alg = NULL;
-    EVP_CIPHER_CTX *ctx = NULL;
-    int cipher_len;
+    IESYS_CRYPTO_SYM_CONTEXT_BLOB *context = NULL;
+    TSS2_RC r;
 
     if (key == NULL || buffer == NULL) {
         return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
     }
 
-    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
-
     /* Parameter blk_len needed for other crypto libraries */
     (void)blk_len;
 
-    if (key_bits == 128 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_128_cfb();
-    else if (key_bits == 192 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_192_cfb();
-    else if (key_bits == 256 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_256_cfb();
-    else {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES algorithm not implemented or illegal mode (CFB expected).",
-                   cleanup);
+    if (tpm_mode != TPM2_ALG_CFB) {
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES algorithm not implemented or illegal mode (CFB expected).");
     }
 
     if (tpm_sym_alg != TPM2_ALG_AES) {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES encrypt called with wrong algorithm.", cleanup);
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES encrypt called with wrong algorithm.");
     }
 
-    /* Create and initialize the context */
-    if(!(ctx = EVP_CIPHER_CTX_new())) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher context", cleanup);
-    }
-
-    if (1 != EVP_EncryptInit_ex(ctx, cipher_alg, NULL, key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher operation", cleanup);
-    }
-    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Set key and iv", cleanup);
-    }
-
-    /* Perform the encryption */
-    if (1 != EVP_EncryptUpdate(ctx, buffer, &cipher_len, buffer, buffer_size)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt update", cleanup);
-    }
-
-    if (1 != EVP_EncryptFinal_ex(ctx, buffer, &cipher_len)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt final", cleanup);
-    }
-    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
-
- cleanup:
-
-    OSSL_FREE(ctx,EVP_CIPHER_CTX);
-
+    r = iesys_cryptossl_sym_aes_cfb(&context, true, key, key_bits, buffer,
+                                    buffer_size, iv);
+    iesys_cryptossl_sym_free(&context);
     return r;
 }
 
@@ -1056,10 +1169,8 @@ iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
                                 size_t buffer_size,
                                 uint8_t * iv)
 {
-    TSS2_RC r = TSS2_RC_SUCCESS;
-    const EVP_CIPHER *cipher_alg = NULL;
-    EVP_CIPHER_CTX *ctx = NULL;
-    int cipher_len = 0;
+    IESYS_CRYPTO_SYM_CONTEXT_BLOB *context = NULL;
+    TSS2_RC r;
 
     /* Parameter blk_len needed for other crypto libraries */
     (void)blk_len;
@@ -1069,52 +1180,19 @@ iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
     }
 
     if (tpm_sym_alg != TPM2_ALG_AES) {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES encrypt called with wrong algorithm.", cleanup);
-    }
-
-    if (key_bits == 128 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_128_cfb();
-    else if (key_bits == 192 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_192_cfb();
-    else if (key_bits == 256 && tpm_mode == TPM2_ALG_CFB)
-        cipher_alg = EVP_aes_256_cfb();
-    else {
-
-        goto_error(r, TSS2_ESYS_RC_NOT_IMPLEMENTED,
-                   "AES algorithm not implemented.", cleanup);
-    }
-
-    /* Create and initialize the context */
-    if(!(ctx = EVP_CIPHER_CTX_new())) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher context", cleanup);
-    }
-
-    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
-
-    if (1 != EVP_DecryptInit_ex(ctx, cipher_alg, NULL, key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher operation", cleanup);
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Set key and iv", cleanup);
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES encrypt called with wrong algorithm.");
     }
 
-    /* Perform the decryption */
-    if (1 != EVP_DecryptUpdate(ctx, buffer, &cipher_len, buffer, buffer_size)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt update", cleanup);
-    }
-
-    if (1 != EVP_DecryptFinal_ex(ctx, buffer, &cipher_len)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt final", cleanup);
+    if (tpm_mode != TPM2_ALG_CFB ||
+        (key_bits != 128 && key_bits != 192 && key_bits != 256)) {
+        return_error(TSS2_ESYS_RC_NOT_IMPLEMENTED,
+                     "AES algorithm not implemented.");
     }
-    LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
-
- cleanup:
 
-    OSSL_FREE(ctx,EVP_CIPHER_CTX);
+    r = iesys_cryptossl_sym_aes_cfb(&context, false, key, key_bits, buffer,
+                                    buffer_size, iv);
+    iesys_cryptossl_sym_free(&context);
     return r;
 }
 
@@ -6,6 +6,7 @@
 #ifndef ESYS_CRYPTO_OSSL_H
 #define ESYS_CRYPTO_OSSL_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "tss2_tpm2_types.h"
 #include "tss2-sys/sysapi_util.h"
@@ -17,6 +18,7 @@ extern "C" {
 #define OSSL_FREE(S,TYPE) if((S) != NULL) {TYPE##_free((void*) (S)); (S)=NULL;}
 
 typedef struct _IESYS_CRYPTO_CONTEXT IESYS_CRYPTO_CONTEXT_BLOB;
+typedef struct _IESYS_CRYPTO_SYM_CONTEXT IESYS_CRYPTO_SYM_CONTEXT_BLOB;
 
 TSS2_RC iesys_cryptossl_hash_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -120,6 +122,17 @@ TSS2_RC iesys_cryptossl_sym_aes_decrypt(
     size_t dst_size,
     uint8_t *iv);
 
+TSS2_RC iesys_cryptossl_sym_aes_cfb(
+    IESYS_CRYPTO_SYM_CONTEXT_BLOB **context,
+    bool encrypt,
+    uint8_t *key,
+    TPMI_AES_KEY_BITS key_bits,
+    uint8_t *buffer,
+    size_t buffer_size,
+    uint8_t *iv);
+
+void iesys_cryptossl_sym_free(IESYS_CRYPTO_SYM_CONTEXT_BLOB **context);
+
 TSS2_RC iesys_cryptossl_get_ecdh_point(
     TPM2B_PUBLIC *key,
     size_t max_out_size,
@@ -132,6 +145,8 @@ TSS2_RC iesys_cryptossl_get_ecdh_point(
 #define iesys_crypto_get_ecdh_point iesys_cryptossl_get_ecdh_point
 #define iesys_crypto_sym_aes_encrypt iesys_cryptossl_sym_aes_encrypt
 #define iesys_crypto_sym_aes_decrypt iesys_cryptossl_sym_aes_decrypt
+#define iesys_crypto_sym_aes_cfb iesys_cryptossl_sym_aes_cfb
+#define iesys_crypto_sym_free iesys_cryptossl_sym_free
 
 TSS2_RC iesys_cryptossl_init();
 
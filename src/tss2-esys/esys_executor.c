@@ -0,0 +1,340 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** The number of events fetched by one epoll_wait() call. */
+#define EXECUTOR_EVENTS_MAX 64
+
+/** An operation submitted to an executor. */
+typedef struct EXECUTOR_OP EXECUTOR_OP;
+struct EXECUTOR_OP {
+    ESYS_CONTEXT *esys_context;      /**< The context of the operation. */
+    ESYS_EXECUTOR_FINISH finish;     /**< Calls the _Finish() function. */
+    ESYS_EXECUTOR_CALLBACK callback; /**< Receives the result. */
+    void *userdata;                  /**< Passed to finish and callback. */
+    TSS2_TCTI_POLL_HANDLE *handles;  /**< The registered poll handles. */
+    size_t count;                    /**< The number of poll handles. */
+    bool done;                       /**< Completed within the current batch. */
+    EXECUTOR_OP *prev;               /**< Previous operation of the list. */
+    EXECUTOR_OP *next;               /**< Next operation of the list. */
+};
+
+/** The state of an executor. */
+struct ESYS_EXECUTOR {
+    int epoll;                       /**< The epoll instance. */
+    EXECUTOR_OP *ops;                /**< The pending operations. */
+    EXECUTOR_OP *completed;          /**< Operations to free after a batch. */
+};
+
+/** Free an operation. */
+static void
+executor_op_free(EXECUTOR_OP *op)
+{
+    SAFE_FREE(op->handles);
+    free(op);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/** Remove the poll handles of an operation from the epoll instance.
+ *
+ * @param[in] executor The executor.
+ * @param[in] op The operation.
+ * @param[in] count The number of poll handles that were registered.
+ */
+static void
+executor_unregister(ESYS_EXECUTOR *executor, EXECUTOR_OP *op, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (epoll_ctl(executor->epoll, EPOLL_CTL_DEL, op->handles[i].fd,
+                      NULL) != 0)
+            LOG_WARNING("Removing fd %i from epoll failed: %s",
+                        op->handles[i].fd, strerror(errno));
+    }
+}
+
+/** Unlink an operation from the list of pending operations. */
+static void
+executor_unlink(ESYS_EXECUTOR *executor, EXECUTOR_OP *op)
+{
+    if (op->prev)
+        op->prev->next = op->next;
+    else
+        executor->ops = op->next;
+    if (op->next)
+        op->next->prev = op->prev;
+    op->prev = op->next = NULL;
+}
+
+/** Let an operation try to finish after one of its handles became ready.
+ *
+ * The _Finish() function is called with a timeout of 0. Unless it asks to be
+ * called again, the operation is removed and its callback receives the result.
+ * The operation itself is freed after the current batch of events, since
+ * further events of the batch may still refer to it.
+ * @param[in,out] executor The executor.
+ * @param[in,out] op The operation.
+ */
+static void
+executor_dispatch(ESYS_EXECUTOR *executor, EXECUTOR_OP *op)
+{
+    ESYS_CONTEXT *esys_context = op->esys_context;
+    int32_t timeout = esys_context->timeout;
+    TSS2_RC r;
+
+    if (op->done)
+        return;
+
+    esys_context->timeout = 0;
+    r = op->finish(esys_context, op->userdata);
+    esys_context->timeout = timeout;
+    if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN)
+        return;
+
+    executor_unregister(executor, op, op->count);
+    executor_unlink(executor, op);
+    op->done = true;
+    op->next = executor->completed;
+    executor->completed = op;
+
+    /* The callback may already submit the next operation of the context. */
+    op->callback(esys_context, r, op->userdata);
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+/** Create an executor.
+ *
+ * An executor waits for the responses of operations of many ESYS contexts on
+ * a single thread. Operations are started with the _Async() function of a
+ * command and handed over with Esys_Executor_Submit(); Esys_Executor_Run()
+ * then calls their _Finish() functions once the poll handles of their TCTIs
+ * become ready and passes the results to their callbacks.
+ * The executor is based on epoll and is not available on other platforms.
+ * @param[out] executor The executor (callee-allocated, use
+ *             Esys_Executor_Finalize()).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if executor is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the memory can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if epoll can not be initialized.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if epoll is not available.
+ */
+TSS2_RC
+Esys_Executor_Initialize(ESYS_EXECUTOR **executor)
+{
+    _ESYS_ASSERT_NON_NULL(executor);
+    *executor = NULL;
+
+#ifdef HAVE_SYS_EPOLL_H
+    *executor = calloc(1, sizeof(ESYS_EXECUTOR));
+    return_if_null(*executor, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    (*executor)->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if ((*executor)->epoll < 0) {
+        LOG_ERROR("Creating the epoll instance failed: %s", strerror(errno));
+        SAFE_FREE(*executor);
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+    return TSS2_RC_SUCCESS;
+#else
+    LOG_ERROR("The executor requires epoll.");
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+#endif
+}
+
+/** Free an executor.
+ *
+ * Pending operations are dropped without calling their callbacks; their
+ * contexts stay in the state of a sent command.
+ * @param[in,out] executor The executor. Will be set to NULL.
+ */
+void
+Esys_Executor_Finalize(ESYS_EXECUTOR **executor)
+{
+    EXECUTOR_OP *op;
+
+    if (executor == NULL || *executor == NULL)
+        return;
+
+#ifdef HAVE_SYS_EPOLL_H
+    close((*executor)->epoll);
+#endif
+    while ((op = (*executor)->ops) != NULL) {
+        LOG_WARNING("Dropping pending operation of context %p.",
+                    (void *) op->esys_context);
+        (*executor)->ops = op->next;
+        executor_op_free(op);
+    }
+    SAFE_FREE(*executor);
+}
+
+/** Submit an operation to an executor.
+ *
+ * The command must have been sent with its _Async() function. The executor
+ * calls finish, which shall call the _Finish() function of the command, each
+ * time a poll handle of the context becomes ready until it returns something
+ * other than TSS2_BASE_RC_TRY_AGAIN, and then passes that result to callback.
+ * Only one operation per context can be pending at a time. The TCTI of the
+ * context must provide poll handles.
+ * @param[in,out] executor The executor.
+ * @param[in,out] esys_context The context with the sent command.
+ * @param[in] finish The function completing the command.
+ * @param[in] callback The function receiving the result.
+ * @param[in] userdata Passed to finish and callback.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if no command of the context was sent.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if an operation of the context is pending.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if the TCTI has no poll handles.
+ * @retval TSS2_ESYS_RC_MEMORY if the memory can not be allocated.
+ * @retval TSS2_RCs produced by Esys_GetPollHandles.
+ */
+TSS2_RC
+Esys_Executor_Submit(ESYS_EXECUTOR *executor, ESYS_CONTEXT *esys_context,
+                     ESYS_EXECUTOR_FINISH finish,
+                     ESYS_EXECUTOR_CALLBACK callback, void *userdata)
+{
+    _ESYS_ASSERT_NON_NULL(executor);
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(finish);
+    _ESYS_ASSERT_NON_NULL(callback);
+
+#ifdef HAVE_SYS_EPOLL_H
+    TSS2_RC r;
+    EXECUTOR_OP *op;
+    struct epoll_event event;
+    size_t i;
+
+    if (esys_context->state != _ESYS_STATE_SENT) {
+        LOG_ERROR("No command of context %p was sent.", (void *) esys_context);
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+
+    op = calloc(1, sizeof(EXECUTOR_OP));
+    return_if_null(op, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    op->esys_context = esys_context;
+    op->finish = finish;
+    op->callback = callback;
+    op->userdata = userdata;
+
+    r = Esys_GetPollHandles(esys_context, &op->handles, &op->count);
+    goto_if_error(r, "Get poll handles", error_cleanup);
+    if (op->count == 0) {
+        LOG_ERROR("The TCTI of context %p has no poll handles.",
+                  (void *) esys_context);
+        r = TSS2_ESYS_RC_NOT_IMPLEMENTED;
+        goto error_cleanup;
+    }
+
+    for (i = 0; i < op->count; i++) {
+        memset(&event, 0, sizeof(event));
+        event.events = (op->handles[i].events & POLLIN ? EPOLLIN : 0) |
+                       (op->handles[i].events & POLLPRI ? EPOLLPRI : 0) |
+                       (op->handles[i].events & POLLOUT ? EPOLLOUT : 0);
+        event.data.ptr = op;
+        if (epoll_ctl(executor->epoll, EPOLL_CTL_ADD, op->handles[i].fd,
+                      &event) != 0) {
+            /* The handles of a context are already registered (EEXIST) if
+               an operation of the context is pending. */
+            LOG_ERROR("Adding fd %i to epoll failed: %s", op->handles[i].fd,
+                      strerror(errno));
+            r = (errno == EEXIST) ? TSS2_ESYS_RC_BAD_VALUE :
+                                    TSS2_ESYS_RC_GENERAL_FAILURE;
+            executor_unregister(executor, op, i);
+            goto error_cleanup;
+        }
+    }
+
+    op->next = executor->ops;
+    if (executor->ops)
+        executor->ops->prev = op;
+    executor->ops = op;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    executor_op_free(op);
+    return r;
+#else
+    (void) userdata;
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+#endif
+}
+
+/** Run an executor.
+ *
+ * Waits for the poll handles of the pending operations and completes the
+ * operations whose handles become ready, calling their callbacks. Returns
+ * once no operation is pending, including operations submitted by the
+ * callbacks, or when the timeout expires.
+ * @param[in,out] executor The executor.
+ * @param[in] timeout The timeout in ms, 0 to only handle ready operations or
+ *            -1 to wait until all operations completed.
+ * @retval TSS2_RC_SUCCESS if no operation is pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if operations are still pending after the
+ *         timeout.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if executor is NULL.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if waiting for the handles failed.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if epoll is not available.
+ */
+TSS2_RC
+Esys_Executor_Run(ESYS_EXECUTOR *executor, int32_t timeout)
+{
+    _ESYS_ASSERT_NON_NULL(executor);
+
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event events[EXECUTOR_EVENTS_MAX];
+    uint64_t end = iesys_time_ms() + (timeout > 0 ? timeout : 0);
+    uint64_t now;
+    EXECUTOR_OP *op;
+    int wait = timeout;
+    int n, i;
+
+    while (executor->ops != NULL) {
+        n = epoll_wait(executor->epoll, &events[0], EXECUTOR_EVENTS_MAX, wait);
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("Waiting for the poll handles failed: %s",
+                      strerror(errno));
+            return TSS2_ESYS_RC_GENERAL_FAILURE;
+        }
+
+        for (i = 0; i < n; i++)
+            executor_dispatch(executor, events[i].data.ptr);
+        while ((op = executor->completed) != NULL) {
+            executor->completed = op->next;
+            executor_op_free(op);
+        }
+
+        if (timeout >= 0 && executor->ops != NULL) {
+            now = iesys_time_ms();
+            if (now >= end)
+                return TSS2_ESYS_RC_TRY_AGAIN;
+            wait = (int) (end - now);
+        }
+    }
+    return TSS2_RC_SUCCESS;
+#else
+    (void) timeout;
+    return TSS2_ESYS_RC_NOT_IMPLEMENTED;
+#endif
+}
@@ -6,6 +6,7 @@
 #ifndef ESYS_INT_H
 #define ESYS_INT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "esys_types.h"
 
@@ -104,6 +105,10 @@ typedef struct {
     ESYS_TR flushHandle;
 } FlushContext_IN;
 
+typedef struct {
+    ESYS_TR objectHandle;
+} ReadPublic_IN;
+
 /** Union for input parameters.
  *
  * The input parameters of a command need to be stored if they are needed
@@ -124,6 +129,7 @@ typedef union {
     Policy_IN Policy;
     NV_IN NV;
     FlushContext_IN FlushContext;
+    ReadPublic_IN ReadPublic;
 } IESYS_CMD_IN_PARAM;
 
 /** The states for the ESAPI's internal state machine */
@@ -139,6 +145,67 @@ enum _ESYS_STATE {
                                    ESAPI code. */
 };
 
+/** The steps of an Esys_TR_FromTPMPublic served by the metadata cache. */
+enum _ESYS_MDCACHE_STEP {
+    _ESYS_MDCACHE_IDLE = 0,   /**< The metadata is read from the TPM. */
+    _ESYS_MDCACHE_CLOCK,      /**< TPM2_ReadClock was sent to learn the
+                                   identity of the TPM. */
+    _ESYS_MDCACHE_HIT         /**< The metadata was found in the cache, no
+                                   command was sent. */
+};
+
+/** The state of the metadata cache of Esys_TR_FromTPMPublic.
+ *
+ * The cache file is only used once the TPM's resetCount, restartCount and
+ * clock have been read, which happens once per context.
+ */
+typedef struct {
+    char *path;                   /**< The cache file or NULL if disabled. */
+    bool identity_valid;          /**< The clock values below were read. */
+    UINT32 resetCount;            /**< The TPM's resetCount. */
+    UINT32 restartCount;          /**< The TPM's restartCount. */
+    UINT64 clock;                 /**< The TPM's clock at the time of reading. */
+    enum _ESYS_MDCACHE_STEP step; /**< The step of the pending lookup. */
+    ESYS_TR shandle[3];           /**< The sessions of the pending lookup. */
+} IESYS_MDCACHE;
+
+/** The state of delayed resubmissions.
+ *
+ * A resubmission that has to wait is only sent by the next _Finish call once
+ * it is due. On Linux a timerfd that expires at that time is added to the
+ * poll handles.
+ */
+typedef struct {
+    ESYS_RESUBMISSION_POLICY policy; /**< The policy of the context. */
+    uint64_t start;               /**< When the first resubmission of the
+                                       current command was requested (ms). */
+    uint64_t due;                 /**< When the pending resubmission is due
+                                       (ms). */
+    uint32_t delay;               /**< The delay without jitter of the last
+                                       resubmission (ms). */
+    bool pending;                 /**< A resubmission waits to be sent. */
+    bool has_timer;               /**< timer was created. */
+    int timer;                    /**< The timerfd expiring at due. */
+} IESYS_RESUBMISSION;
+
+/** The cpHashes computed while SAPI prepares a command.
+ *
+ * iesys_begin_cp_stream() arms the stream before the SAPI _Prepare call. The
+ * SAPI cp callback then starts one hash context per session hash algorithm
+ * and feeds every parameter into them right after it has been marshalled.
+ * iesys_compute_cp_hashtab() only finishes these contexts instead of reading
+ * the command buffer again.
+ */
+typedef struct {
+    bool armed;                   /**< Hash the parameters of the next
+                                       prepared command. */
+    const TPM2B_NAME *names[3];   /**< The names of the authorized objects. */
+    TPM2_ALG_ID alg[3];           /**< The hash algorithm of each context. */
+    struct _IESYS_CRYPTO_CONTEXT *context[3]; /**< The hash contexts. */
+    uint8_t num;                  /**< The number of started contexts. */
+    size_t size;                  /**< The number of parameter bytes hashed. */
+} IESYS_CP_STREAM;
+
 /** The data structure holding internal state information.
  *
  * Each ESYS_CONTEXT respresents a logically independent connection to the TPM.
@@ -176,12 +243,25 @@ struct ESYS_CONTEXT {
                                       automatically loaded. */
     IESYS_SESSION *enc_session;  /**< Ptr to the enc param session.
                                       Used to restore session attributes */
+    bool caller_storage;         /**< The context lives in storage provided to
+                                      Esys_InitializeEx() and is not freed. */
+    IESYS_MDCACHE mdcache;       /**< The metadata cache of
+                                      Esys_TR_FromTPMPublic. */
+    IESYS_RESUBMISSION resubmission; /**< The resubmission policy and the
+                                          pending resubmission. */
+    struct _IESYS_CRYPTO_SYM_CONTEXT *sym_context; /**< The cipher context
+                                          re-keyed for parameter encryption
+                                          and decryption. */
+    UINT32 inputBufferSize;      /**< The TPM2_PT_INPUT_BUFFER of the TPM, or 0
+                                      before Esys_SequenceHash queried it. */
+    IESYS_CP_STREAM cp_stream;   /**< The cpHashes computed during the SAPI
+                                      prepare of the current command. */
 };
 
 /** The number of authomatic resubmissions.
  *
- * The number of resubmissions before a TPM's TPM2_RC_YIELDED is forwarded to
- * the application.
+ * The default number of resubmissions before a TPM's TPM2_RC_YIELDED is
+ * forwarded to the application.
  */
 #define _ESYS_MAX_SUBMISSIONS 5
 
@@ -8,6 +8,15 @@
 #endif
 
 #include <inttypes.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
 
 #include "tss2_esys.h"
 #include "esys_mu.h"
@@ -186,6 +195,192 @@ iesys_compute_encrypt_nonce(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Prepare the computation of the cp hashes during the SAPI prepare.
+ *
+ * Records the names of the objects with an auth index, so that the parameters
+ * can be hashed by iesys_cp_stream_callback() while SAPI marshals them. Must
+ * be called after init_session_tab() and right before the SAPI _Prepare
+ * function. Nothing is armed if no session needs a cp hash or if a decrypt
+ * session will encrypt the first parameter after the prepare;
+ * iesys_compute_cp_hashtab() then reads the command buffer instead.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] h1, h2, h3 The objects with an auth index (may be NULL).
+ */
+void
+iesys_begin_cp_stream(ESYS_CONTEXT * esys_context,
+                      RSRC_NODE_T * h1, RSRC_NODE_T * h2, RSRC_NODE_T * h3)
+{
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
+    RSRC_NODE_T *objects[] = { h1, h2, h3 };
+    bool hashed = false;
+
+    iesys_abort_cp_stream(esys_context);
+
+    for (int i = 0; i < 3; i++) {
+        RSRC_NODE_T *session = esys_context->session_tab[i];
+        if (session == NULL)
+            continue;
+        if (session->rsrc.misc.rsrc_session.sessionAttributes &
+            TPMA_SESSION_DECRYPT)
+            return;
+        hashed = true;
+    }
+    if (!hashed)
+        return;
+
+    for (int i = 0; i < 3; i++)
+        stream->names[i] = (objects[i] != NULL) ? &objects[i]->rsrc.name : NULL;
+    stream->armed = true;
+}
+
+/** Release the hash contexts of the cp stream and disarm it.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ */
+void
+iesys_abort_cp_stream(ESYS_CONTEXT * esys_context)
+{
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
+
+    for (int i = 0; i < stream->num; i++)
+        iesys_crypto_hash_abort(&stream->context[i]);
+    stream->num = 0;
+    stream->size = 0;
+    stream->armed = false;
+}
+
+/** Start one hash context per session hash algorithm for the cp stream.
+ *
+ * The contexts are fed with the command code and the names, so that only the
+ * parameters remain to be hashed.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] commandCode The command code of the prepared command.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if a hash algorithm is not implemented.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+static TSS2_RC
+iesys_start_cp_stream(ESYS_CONTEXT * esys_context, TPM2_CC commandCode)
+{
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
+    uint8_t ccBuffer[4];
+    TSS2_RC r;
+
+    r = Tss2_MU_TPM2_CC_Marshal(commandCode, &ccBuffer[0], sizeof(ccBuffer),
+                                NULL);
+    return_if_error(r, "Marshal command code");
+
+    for (int i = 0; i < 3; i++) {
+        RSRC_NODE_T *session = esys_context->session_tab[i];
+        IESYS_CRYPTO_CONTEXT_BLOB **context = &stream->context[stream->num];
+        bool started = false;
+        TPM2_ALG_ID alg;
+
+        if (session == NULL)
+            continue;
+        /* One hash per algorithm, as in iesys_compute_cp_hashtab() */
+        alg = session->rsrc.misc.rsrc_session.authHash;
+        for (int j = 0; j < stream->num; j++)
+            if (stream->alg[j] == alg)
+                started = true;
+        if (started)
+            continue;
+
+        r = iesys_crypto_hash_start(context, alg);
+        return_if_error(r, "Start cp hash");
+        stream->alg[stream->num] = alg;
+        stream->num += 1;
+
+        r = iesys_crypto_hash_update(*context, &ccBuffer[0], sizeof(ccBuffer));
+        return_if_error(r, "Hash command code");
+        for (int j = 0; j < 3; j++) {
+            if (stream->names[j] == NULL)
+                continue;
+            r = iesys_crypto_hash_update2b(*context,
+                                           (TPM2B *) stream->names[j]);
+            return_if_error(r, "Hash name");
+        }
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** SAPI cp callback feeding the parameters into the cp hashes.
+ *
+ * Registered with Tss2_Sys_SetCpCallback() during the initialization of the
+ * context. SAPI calls it with every parameter right after marshalling it, so
+ * each byte is hashed once while it is still in the cache. Errors are not
+ * returned to SAPI; the stream is aborted and the cp hashes are computed from
+ * the command buffer by iesys_compute_cp_hashtab(), which reports the error.
+ * @param[in] commandCode The command code of the prepared command.
+ * @param[in] offset The offset of data in the command parameters.
+ * @param[in] data The parameters marshalled since the last call.
+ * @param[in] size The size of data.
+ * @param[in,out] userData The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS always.
+ */
+TSS2_RC
+iesys_cp_stream_callback(TPM2_CC commandCode, size_t offset,
+                         const uint8_t * data, size_t size, void *userData)
+{
+    ESYS_CONTEXT *esys_context = userData;
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    if (!stream->armed)
+        return TSS2_RC_SUCCESS;
+
+    if (offset == 0) {
+        for (int i = 0; i < stream->num; i++)
+            iesys_crypto_hash_abort(&stream->context[i]);
+        stream->num = 0;
+        stream->size = 0;
+        r = iesys_start_cp_stream(esys_context, commandCode);
+    } else if (offset != stream->size) {
+        r = TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+
+    for (int i = 0; i < stream->num && r == TSS2_RC_SUCCESS && size > 0; i++)
+        r = iesys_crypto_hash_update(stream->context[i], data, size);
+
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_DEBUG("cp hash not streamed, computing it later");
+        iesys_abort_cp_stream(esys_context);
+        return TSS2_RC_SUCCESS;
+    }
+    stream->size += size;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Finish the cp hashes computed while SAPI prepared the command.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT; the stream is disarmed.
+ * @param[out] cp_hash_tab The cp hashes, one per hash algorithm.
+ * @param[out] cpHashNum The number of entries in cp_hash_tab.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+static TSS2_RC
+iesys_finish_cp_stream(ESYS_CONTEXT * esys_context,
+                       HASH_TAB_ITEM cp_hash_tab[3], uint8_t * cpHashNum)
+{
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    *cpHashNum = 0;
+    for (int i = 0; i < stream->num && r == TSS2_RC_SUCCESS; i++) {
+        cp_hash_tab[i].alg = stream->alg[i];
+        cp_hash_tab[i].size = sizeof(TPMU_HA);
+        r = iesys_crypto_hash_finish(&stream->context[i],
+                                     &cp_hash_tab[i].digest[0],
+                                     &cp_hash_tab[i].size);
+        if (r == TSS2_RC_SUCCESS)
+            *cpHashNum += 1;
+    }
+    iesys_abort_cp_stream(esys_context);
+    return_if_error(r, "crypto cpHash");
+    return TSS2_RC_SUCCESS;
+}
+
 /** Computation of the command parameter(cp) hashes.
  *
  * The command parameter(cp) hash of the command is computed for every
@@ -194,6 +389,8 @@ iesys_compute_encrypt_nonce(ESYS_CONTEXT * esys_context,
  * The names of objects with an auth index and the command buffer are used
  * to compute the cp hash with the hash algorithm of the corresponding session.
  * The result is stored in table together with the used hash algorithm.
+ * If the parameters were hashed while SAPI marshalled them (see
+ * iesys_begin_cp_stream()), these hashes are only finished.
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] name1 The name of the first object with an auth index.
  * @param[in] name2 The name of the second object with an auth index.
@@ -215,6 +412,7 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
                          const TPM2B_NAME * name3,
                          HASH_TAB_ITEM cp_hash_tab[3], uint8_t * cpHashNum)
 {
+    IESYS_CP_STREAM *stream = &esys_context->cp_stream;
     uint8_t ccBuffer[4];
     TSS2_RC r = Tss2_Sys_GetCommandCode(esys_context->sys, &ccBuffer[0]);
     return_if_error(r, "Error: get command code");
@@ -222,6 +420,14 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
     size_t cpBuffer_size;
     r = Tss2_Sys_GetCpBuffer(esys_context->sys, &cpBuffer_size, &cpBuffer);
     return_if_error(r, "Error: get cp buffer");
+
+    /* The parameters were already hashed while they were marshalled. */
+    if (stream->armed && stream->num > 0 && stream->size == cpBuffer_size &&
+        stream->names[0] == name1 && stream->names[1] == name2 &&
+        stream->names[2] == name3)
+        return iesys_finish_cp_stream(esys_context, cp_hash_tab, cpHashNum);
+    iesys_abort_cp_stream(esys_context);
+
     *cpHashNum = 0;
     for (int i = 0; i < 3; i++) {
         RSRC_NODE_T *session = esys_context->session_tab[i];
@@ -682,8 +888,10 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
             if (paramSize == 0)
                 continue;
 
-            BYTE encrypt_buffer[paramSize];
-            memcpy(&encrypt_buffer[0], paramBuffer, paramSize);
+            /* The parameter is encrypted in place in the command buffer of
+               the SAPI context, like Tss2_Sys_SetDecryptParam would copy
+               it there. */
+            BYTE *encrypt_buffer = (BYTE *) paramBuffer;
             LOGBLOB_DEBUG(paramBuffer, paramSize, "param to encrypt");
 
             /* AES encryption with key derived with KDFa */
@@ -702,13 +910,10 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                 return_if_error(r, "while computing KDFa");
 
                 size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-                r = iesys_crypto_sym_aes_encrypt(&symKey[0],
-                                                 symDef->algorithm,
-                                                 symDef->keyBits.aes,
-                                                 symDef->mode.aes,
-                                                 AES_BLOCK_SIZE_IN_BYTES,
-                                                 &encrypt_buffer[0], paramSize,
-                                                 &symKey[aes_off]);
+                r = iesys_crypto_sym_aes_cfb(&esys_context->sym_context, true,
+                                             &symKey[0], symDef->keyBits.aes,
+                                             &encrypt_buffer[0], paramSize,
+                                             &symKey[aes_off]);
                 return_if_error(r, "AES encryption not possible");
             }
             /* XOR obfuscation of parameter */
@@ -726,10 +931,6 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                 return_error(TSS2_ESYS_RC_BAD_VALUE,
                              "Invalid symmetric algorithm (should be XOR or AES)");
             }
-            r = Tss2_Sys_SetDecryptParam(esys_context->sys, paramSize,
-                                         &encrypt_buffer[0]);
-            return_if_error(r, "Set encrypt parameter not possible");
-
         }
     }
     return r;
@@ -774,8 +975,9 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
     r = Tss2_Sys_GetEncryptParam(esys_context->sys, &p2BSize, &ciphertext);
     return_if_error(r, "Getting encrypt param");
 
-    UINT8 plaintext[p2BSize];
-    memcpy(&plaintext[0], ciphertext, p2BSize);
+    /* The parameter is decrypted in place in the response buffer of the
+       SAPI context. */
+    UINT8 *plaintext = (UINT8 *) ciphertext;
 
     if (symDef->algorithm == TPM2_ALG_AES) {
         /* Parameter decryption with a symmetric AES key derived by KDFa */
@@ -802,17 +1004,11 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
                       "IESYS encrypt KDFa key");
 
         size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-        r = iesys_crypto_sym_aes_decrypt(&symKey[0],
-                                     symDef->algorithm,
-                                     symDef->keyBits.aes,
-                                     symDef->mode.aes,
-                                     AES_BLOCK_SIZE_IN_BYTES,
+        r = iesys_crypto_sym_aes_cfb(&esys_context->sym_context, false,
+                                     &symKey[0], symDef->keyBits.aes,
                                      &plaintext[0], p2BSize,
                                      &symKey[aes_off]);
         return_if_error(r, "Decryption error");
-
-        r = Tss2_Sys_SetEncryptParam(esys_context->sys, p2BSize, &plaintext[0]);
-        return_if_error(r, "Setting plaintext");
     } else if (symDef->algorithm == TPM2_ALG_XOR) {
         /* Parameter decryption with XOR obfuscation */
         r = iesys_xor_parameter_obfuscation(rsrc_session->authHash,
@@ -823,9 +1019,6 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context)
                                             &plaintext[0],
                                             p2BSize);
         return_if_error(r, "XOR obfuscation not possible.");
-
-        r = Tss2_Sys_SetEncryptParam(esys_context->sys, p2BSize, &plaintext[0]);
-        return_if_error(r, "Setting plaintext");
     } else {
         return_error(TSS2_ESYS_RC_BAD_VALUE,
                      "Invalid symmetric algorithm (should be XOR or AES)");
@@ -1119,6 +1312,7 @@ iesys_check_sequence_async(ESYS_CONTEXT * esys_context)
         return TSS2_ESYS_RC_BAD_SEQUENCE;
     }
     esys_context->submissionCount = 1;
+    iesys_abort_cp_stream(esys_context);
     return TSS2_RC_SUCCESS;
 }
 
@@ -1523,3 +1717,259 @@ iesys_tpm_error(TSS2_RC r)
              (r & TSS2_RC_LAYER_MASK) == TSS2_RESMGR_TPM_RC_LAYER ||
              (r & TSS2_RC_LAYER_MASK) == TSS2_RESMGR_RC_LAYER));
 }
+
+/** Return a monotonic time in milliseconds. */
+uint64_t
+iesys_time_ms(void)
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+#endif
+}
+
+/** Sleep for a number of milliseconds. */
+static void
+iesys_sleep_ms(uint64_t ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD) ms);
+#else
+    struct timespec delay = {
+        .tv_sec = (time_t) (ms / 1000),
+        .tv_nsec = (long) (ms % 1000) * 1000000
+    };
+
+    while (nanosleep(&delay, &delay) != 0)
+        ;
+#endif
+}
+
+/** Set the resubmission policy of a context.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] policy The policy or NULL for the default of _ESYS_MAX_SUBMISSIONS
+ *            immediate resubmissions.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the policy is invalid.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the timer can not be created.
+ */
+TSS2_RC
+iesys_set_resubmission_policy(ESYS_CONTEXT *esys_context,
+                              const ESYS_RESUBMISSION_POLICY *policy)
+{
+    IESYS_RESUBMISSION *resubmission = &esys_context->resubmission;
+    ESYS_RESUBMISSION_POLICY defaults = {
+        .maxSubmissions = _ESYS_MAX_SUBMISSIONS,
+        .backoffFactor = 1,
+    };
+
+    if (policy == NULL)
+        policy = &defaults;
+    if (policy->maxSubmissions == 0 || policy->backoffFactor == 0 ||
+        policy->jitter > 100 || policy->maxDelay < policy->initialDelay) {
+        LOG_ERROR("Invalid resubmission policy.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+#ifdef HAVE_SYS_TIMERFD_H
+    if (policy->initialDelay > 0 && !resubmission->has_timer) {
+        resubmission->timer = timerfd_create(CLOCK_MONOTONIC,
+                                             TFD_NONBLOCK | TFD_CLOEXEC);
+        if (resubmission->timer < 0) {
+            LOG_ERROR("Creating the resubmission timer failed.");
+            return TSS2_ESYS_RC_GENERAL_FAILURE;
+        }
+        resubmission->has_timer = true;
+    }
+#endif
+    resubmission->policy = *policy;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release the resources of the resubmission policy. */
+void
+iesys_free_resubmission(ESYS_CONTEXT *esys_context)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+    if (esys_context->resubmission.has_timer)
+        close(esys_context->resubmission.timer);
+#endif
+    esys_context->resubmission.has_timer = false;
+}
+
+/** Return the poll handle of the resubmission timer.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[out] handle The poll handle of the timer.
+ * @retval true if the context has a timer.
+ * @retval false otherwise.
+ */
+bool
+iesys_resubmission_poll_handle(ESYS_CONTEXT *esys_context,
+                               TSS2_TCTI_POLL_HANDLE *handle)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+    if (esys_context->resubmission.has_timer) {
+        handle->fd = esys_context->resubmission.timer;
+        handle->events = POLLIN;
+        handle->revents = 0;
+        return true;
+    }
+#else
+    (void) esys_context;
+    (void) handle;
+#endif
+    return false;
+}
+
+/** Arm or disarm the resubmission timer. */
+static void
+iesys_set_resubmission_timer(ESYS_CONTEXT *esys_context, uint64_t delay)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+    IESYS_RESUBMISSION *resubmission = &esys_context->resubmission;
+    struct itimerspec timeout = { { 0, 0 }, { 0, 0 } };
+    uint64_t expirations;
+
+    if (!resubmission->has_timer)
+        return;
+    if (delay == 0) {
+        /* Disarm the timer and consume a pending expiration. */
+        if (read(resubmission->timer, &expirations, sizeof(expirations)) < 0)
+            LOG_TRACE("No expiration of the resubmission timer pending.");
+    } else {
+        timeout.it_value.tv_sec = (time_t) (delay / 1000);
+        timeout.it_value.tv_nsec = (long) (delay % 1000) * 1000000;
+    }
+    if (timerfd_settime(resubmission->timer, 0, &timeout, NULL) != 0)
+        LOG_WARNING("Setting the resubmission timer failed.");
+#else
+    (void) esys_context;
+    (void) delay;
+#endif
+}
+
+/** Check whether a command may not be resubmitted any more.
+ *
+ * Counts the submission and computes the delay of the next resubmission
+ * according to the resubmission policy.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @retval true if the maximum number of submissions was reached or the next
+ *         resubmission would start after the deadline.
+ * @retval false if the command shall be resubmitted with iesys_resubmit().
+ */
+bool
+iesys_resubmission_exhausted(ESYS_CONTEXT *esys_context)
+{
+    IESYS_RESUBMISSION *resubmission = &esys_context->resubmission;
+    const ESYS_RESUBMISSION_POLICY *policy = &resubmission->policy;
+    TPM2B_NONCE random = { 0 };
+    uint64_t now, delay;
+    uint32_t deviation;
+
+    if (esys_context->submissionCount++ >= (int) policy->maxSubmissions)
+        return true;
+    if (policy->initialDelay == 0) {
+        resubmission->due = 0;
+        return false;
+    }
+
+    now = iesys_time_ms();
+    if (esys_context->submissionCount == 2) {
+        resubmission->start = now;
+        resubmission->delay = policy->initialDelay;
+    } else {
+        delay = (uint64_t) resubmission->delay * policy->backoffFactor;
+        resubmission->delay = (uint32_t) (delay < policy->maxDelay ?
+                                          delay : policy->maxDelay);
+    }
+
+    delay = resubmission->delay;
+    if (policy->jitter > 0 &&
+        iesys_crypto_random2b(&random, sizeof(deviation)) == TSS2_RC_SUCCESS) {
+        memcpy(&deviation, &random.buffer[0], sizeof(deviation));
+        /* Spread the delay over delay +/- jitter percent. */
+        delay = delay * (100 - policy->jitter +
+                         deviation % (2 * policy->jitter + 1)) / 100;
+    }
+
+    if (policy->deadline > 0 &&
+        now + delay > resubmission->start + policy->deadline) {
+        LOG_WARNING("Resubmission deadline of %" PRIu32 " ms reached.",
+                    policy->deadline);
+        return true;
+    }
+    resubmission->due = now + delay;
+    return false;
+}
+
+/** Resubmit the current command.
+ *
+ * The command is sent right away if no delay is due. Otherwise it is sent by
+ * the next call of iesys_execute_finish() once the delay has passed.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Tss2_Sys_ExecuteAsync.
+ */
+TSS2_RC
+iesys_resubmit(ESYS_CONTEXT *esys_context)
+{
+    IESYS_RESUBMISSION *resubmission = &esys_context->resubmission;
+    uint64_t now;
+
+    if (resubmission->due > 0) {
+        now = iesys_time_ms();
+        if (now < resubmission->due) {
+            LOG_DEBUG("Resubmission delayed by %" PRIu64 " ms.",
+                      resubmission->due - now);
+            resubmission->pending = true;
+            iesys_set_resubmission_timer(esys_context, resubmission->due - now);
+            return TSS2_RC_SUCCESS;
+        }
+    }
+    return Tss2_Sys_ExecuteAsync(esys_context->sys);
+}
+
+/** Receive the response of the current command.
+ *
+ * Sends a delayed resubmission first once it is due. If it is not due within
+ * the timeout of the context, TSS2_ESYS_RC_TRY_AGAIN is returned without
+ * sending anything.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if a resubmission is not yet due.
+ * @retval TSS2_RCs produced by Tss2_Sys_ExecuteAsync or
+ *         Tss2_Sys_ExecuteFinish.
+ */
+TSS2_RC
+iesys_execute_finish(ESYS_CONTEXT *esys_context)
+{
+    IESYS_RESUBMISSION *resubmission = &esys_context->resubmission;
+    int32_t timeout = esys_context->timeout;
+    uint64_t now, wait;
+    TSS2_RC r;
+
+    if (resubmission->pending) {
+        now = iesys_time_ms();
+        if (now < resubmission->due) {
+            wait = resubmission->due - now;
+            if (timeout >= 0 && (uint64_t) timeout < wait) {
+                iesys_sleep_ms((uint64_t) timeout);
+                return TSS2_ESYS_RC_TRY_AGAIN;
+            }
+            iesys_sleep_ms(wait);
+            if (timeout >= 0)
+                timeout -= (int32_t) wait;
+        }
+        resubmission->pending = false;
+        iesys_set_resubmission_timer(esys_context, 0);
+        r = Tss2_Sys_ExecuteAsync(esys_context->sys);
+        return_if_error(r, "Error attempting to resubmit");
+    }
+    return Tss2_Sys_ExecuteFinish(esys_context->sys, timeout);
+}
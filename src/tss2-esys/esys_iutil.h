@@ -45,6 +45,21 @@ TSS2_RC iesys_compute_cp_hashtab(
     HASH_TAB_ITEM cp_hash_tab[3],
     uint8_t *cpHashNum);
 
+void iesys_begin_cp_stream(
+    ESYS_CONTEXT *esysContext,
+    RSRC_NODE_T *h1,
+    RSRC_NODE_T *h2,
+    RSRC_NODE_T *h3);
+
+TSS2_RC iesys_cp_stream_callback(
+    TPM2_CC commandCode,
+    size_t offset,
+    const uint8_t *data,
+    size_t size,
+    void *userData);
+
+void iesys_abort_cp_stream(ESYS_CONTEXT *esysContext);
+
 TSS2_RC iesys_compute_rp_hashtab(
     ESYS_CONTEXT *esysContext,
     const uint8_t *rpBuffer,
@@ -150,6 +165,28 @@ TSS2_RC iesys_get_name(
 bool iesys_tpm_error(
     TSS2_RC r);
 
+uint64_t iesys_time_ms(void);
+
+TSS2_RC iesys_set_resubmission_policy(
+    ESYS_CONTEXT *esys_context,
+    const ESYS_RESUBMISSION_POLICY *policy);
+
+void iesys_free_resubmission(
+    ESYS_CONTEXT *esys_context);
+
+bool iesys_resubmission_poll_handle(
+    ESYS_CONTEXT *esys_context,
+    TSS2_TCTI_POLL_HANDLE *handle);
+
+bool iesys_resubmission_exhausted(
+    ESYS_CONTEXT *esys_context);
+
+TSS2_RC iesys_resubmit(
+    ESYS_CONTEXT *esys_context);
+
+TSS2_RC iesys_execute_finish(
+    ESYS_CONTEXT *esys_context);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
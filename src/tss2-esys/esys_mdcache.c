@@ -0,0 +1,806 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/locking.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "tss2_esys.h"
+#include "esys_mu.h"
+
+#include "esys_iutil.h"
+#include "esys_mdcache.h"
+#include "esys_crypto.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * The cache file consists of a header followed by the entries:
+ *
+ *   UINT32 magic, UINT32 version, UINT32 resetCount, UINT32 restartCount,
+ *   UINT64 clock, UINT32 count
+ *   count * (UINT32 handle, UINT16 size, BYTE[size] IESYS_RESOURCE)
+ *
+ * All numbers are big endian. The entries are valid for the TPM as long as it
+ * reports the same resetCount and restartCount and a clock that is not smaller
+ * than the stored one. TPM2_Clear sets all three back to zero, and a different
+ * TPM is unlikely to match all of them.
+ *
+ * Every change reads the file, merges the change and renames a new file over
+ * it. These steps are serialized between processes by a lock on the file
+ * <path>.lock, which unlike the cache file itself is never replaced, so no
+ * change of one process is lost by a concurrent change of another one.
+ * Lookups do not take the lock, since the rename is atomic.
+ *
+ * The lock has to exclude the threads of a process as well. Open file
+ * description locks do, since they belong to the descriptor. Where they are
+ * not available, the lock is taken with lockf(), whose locks belong to the
+ * process and are all released when any descriptor of the file is closed, so
+ * the threads are serialized by mdcache_mutex first. One mutex is used for
+ * all paths, since different paths can name the same lock file.
+ */
+#define MDCACHE_HEADER_SIZE (4 * sizeof(UINT32) + sizeof(UINT64) + sizeof(UINT32))
+#define MDCACHE_ENTRY_HEADER_SIZE (sizeof(UINT32) + sizeof(UINT16))
+#define MDCACHE_FILE_MAX (MDCACHE_HEADER_SIZE + IESYS_MDCACHE_ENTRIES_MAX * \
+                          (MDCACHE_ENTRY_HEADER_SIZE + ESYS_MAX_SIZE_METADATA))
+
+/** The contents of a parsed cache file. */
+typedef struct {
+    uint8_t *data;        /**< The file contents. */
+    size_t size;          /**< The size of data. */
+    UINT32 resetCount;    /**< The resetCount the entries belong to. */
+    UINT32 restartCount;  /**< The restartCount the entries belong to. */
+    UINT64 clock;         /**< The smallest clock the entries are valid for. */
+    UINT32 count;         /**< The number of entries. */
+} MDCACHE_FILE;
+
+/** Read a whole file into memory.
+ *
+ * @param[in] path The file to read.
+ * @param[out] data The file contents (callee-allocated).
+ * @param[out] size The size of the file.
+ * @retval true if the file was read.
+ * @retval false if the file does not exist or can not be read.
+ */
+static bool
+mdcache_read_file(const char *path, uint8_t **data, size_t *size)
+{
+    FILE *stream;
+    uint8_t *buffer = NULL, *tmp;
+    size_t capacity = 0, length = 0, n;
+
+    stream = fopen(path, "rb");
+    if (stream == NULL)
+        return false;
+
+    do {
+        if (length == capacity) {
+            capacity = capacity ? 2 * capacity : 4096;
+            if (capacity > MDCACHE_FILE_MAX + 1)
+                capacity = MDCACHE_FILE_MAX + 1;
+            tmp = realloc(buffer, capacity);
+            if (tmp == NULL) {
+                LOG_WARNING("Out of memory reading %s", path);
+                goto error;
+            }
+            buffer = tmp;
+        }
+        n = fread(&buffer[length], 1, capacity - length, stream);
+        length += n;
+    } while (n > 0 && length <= MDCACHE_FILE_MAX);
+
+    if (ferror(stream) || length > MDCACHE_FILE_MAX) {
+        LOG_WARNING("Can not read metadata cache %s", path);
+        goto error;
+    }
+    fclose(stream);
+    *data = buffer;
+    *size = length;
+    return true;
+
+error:
+    fclose(stream);
+    free(buffer);
+    return false;
+}
+
+/** Read and parse the cache file.
+ *
+ * A missing or corrupted file is treated like an empty cache.
+ * @param[in] path The cache file.
+ * @param[out] file The parsed file. data has to be freed by the caller if
+ *             true is returned.
+ * @retval true if a valid cache file was read.
+ * @retval false otherwise.
+ */
+static bool
+mdcache_load(const char *path, MDCACHE_FILE *file)
+{
+    TSS2_RC r;
+    UINT32 magic, version, i, handle;
+    UINT16 entry_size;
+    size_t offset = 0;
+
+    memset(file, 0, sizeof(*file));
+    if (!mdcache_read_file(path, &file->data, &file->size))
+        return false;
+
+    r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset, &magic);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset, &version);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset,
+                                     &file->resetCount);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset,
+                                     &file->restartCount);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT64_Unmarshal(file->data, file->size, &offset,
+                                     &file->clock);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset,
+                                     &file->count);
+    if (r != TSS2_RC_SUCCESS || magic != IESYS_MDCACHE_MAGIC ||
+        version != IESYS_MDCACHE_VERSION ||
+        file->count > IESYS_MDCACHE_ENTRIES_MAX)
+        goto error;
+
+    for (i = 0; i < file->count; i++) {
+        r = Tss2_MU_UINT32_Unmarshal(file->data, file->size, &offset, &handle);
+        if (r == TSS2_RC_SUCCESS)
+            r = Tss2_MU_UINT16_Unmarshal(file->data, file->size, &offset,
+                                         &entry_size);
+        if (r != TSS2_RC_SUCCESS || entry_size > file->size - offset)
+            goto error;
+        offset += entry_size;
+    }
+    if (offset != file->size)
+        goto error;
+    return true;
+
+error:
+    LOG_WARNING("Ignoring corrupted metadata cache %s", path);
+    SAFE_FREE(file->data);
+    return false;
+}
+
+/** Read the entry at an offset of a parsed cache file.
+ *
+ * The entries were validated by mdcache_load, so this can not fail.
+ * @param[in] file The parsed file.
+ * @param[in,out] offset The offset of the entry; advanced to the next entry.
+ * @param[out] handle The TPM handle of the entry.
+ * @param[out] data The marshalled IESYS_RESOURCE.
+ * @param[out] size The size of data.
+ */
+static void
+mdcache_entry(const MDCACHE_FILE *file, size_t *offset, TPM2_HANDLE *handle,
+              const uint8_t **data, size_t *size)
+{
+    UINT16 entry_size = 0;
+
+    Tss2_MU_UINT32_Unmarshal(file->data, file->size, offset, handle);
+    Tss2_MU_UINT16_Unmarshal(file->data, file->size, offset, &entry_size);
+    *data = &file->data[*offset];
+    *size = entry_size;
+    *offset += entry_size;
+}
+
+/** Find the entry of a TPM handle.
+ *
+ * @param[in] file The parsed file.
+ * @param[in] tpm_handle The TPM handle to look for.
+ * @param[out] data The marshalled IESYS_RESOURCE.
+ * @param[out] size The size of data.
+ * @retval true if the handle has an entry.
+ * @retval false otherwise.
+ */
+static bool
+mdcache_find(const MDCACHE_FILE *file, TPM2_HANDLE tpm_handle,
+             const uint8_t **data, size_t *size)
+{
+    size_t offset = MDCACHE_HEADER_SIZE;
+    TPM2_HANDLE handle;
+    UINT32 i;
+
+    for (i = 0; i < file->count; i++) {
+        mdcache_entry(file, &offset, &handle, data, size);
+        if (handle == tpm_handle)
+            return true;
+    }
+    return false;
+}
+
+/** Check whether the entries of a file belong to the TPM of the context. */
+static bool
+mdcache_identity_matches(ESYS_CONTEXT *esys_context, const MDCACHE_FILE *file)
+{
+    IESYS_MDCACHE *mdcache = &esys_context->mdcache;
+
+    return mdcache->identity_valid &&
+        file->resetCount == mdcache->resetCount &&
+        file->restartCount == mdcache->restartCount &&
+        file->clock <= mdcache->clock;
+}
+
+/** Check whether an entry is removed while the file is written. */
+static bool
+mdcache_drops(TPM2_HANDLE handle, TPM2_HANDLE drop_handle, int drop_type)
+{
+    return handle == drop_handle ||
+        (drop_type >= 0 && handle >> TPM2_HR_SHIFT == (TPM2_HANDLE) drop_type);
+}
+
+/** Replace the cache file atomically.
+ *
+ * The new contents are written to a temporary file next to the cache file,
+ * which is then renamed over it.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] data The new file contents.
+ * @param[in] size The size of data.
+ */
+static void
+mdcache_replace(ESYS_CONTEXT *esys_context, const uint8_t *data, size_t size)
+{
+    const char *path = esys_context->mdcache.path;
+    TPM2B_NONCE nonce;
+    char *tmp_path;
+    FILE *stream;
+    size_t i, length, offset;
+    bool written;
+
+    length = strlen(path) + 1 + 2 * 8 + sizeof(".tmp");
+    tmp_path = malloc(length);
+    if (tmp_path == NULL) {
+        LOG_WARNING("Out of memory writing the metadata cache.");
+        return;
+    }
+    /* The random suffix keeps concurrent writers apart. */
+    if (iesys_crypto_random2b(&nonce, 8) != TSS2_RC_SUCCESS) {
+        LOG_WARNING("Can not name the temporary metadata cache file.");
+        free(tmp_path);
+        return;
+    }
+    offset = snprintf(tmp_path, length, "%s.", path);
+    for (i = 0; i < 8; i++)
+        offset += snprintf(&tmp_path[offset], length - offset, "%02x",
+                           nonce.buffer[i]);
+    snprintf(&tmp_path[offset], length - offset, ".tmp");
+
+    stream = fopen(tmp_path, "wb");
+    if (stream == NULL) {
+        LOG_WARNING("Can not create %s", tmp_path);
+        free(tmp_path);
+        return;
+    }
+    written = fwrite(data, 1, size, stream) == size;
+    written = (fclose(stream) == 0) && written;
+    if (written && rename(tmp_path, path) != 0) {
+        /* rename() does not replace existing files everywhere. */
+        remove(path);
+        written = rename(tmp_path, path) == 0;
+    }
+    if (!written) {
+        LOG_WARNING("Can not write metadata cache %s", path);
+        remove(tmp_path);
+    }
+    free(tmp_path);
+}
+
+/** A lock taken by mdcache_lock(). */
+typedef struct {
+    int fd;               /**< The lock file or -1 if not locked. */
+    bool mutex;           /**< mdcache_mutex is held. */
+} MDCACHE_LOCK;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t mdcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#ifndef _WIN32
+/** Lock an open lock file with lockf().
+ *
+ * mdcache_mutex is taken before, see the description of the file format.
+ * @param[in,out] lock The lock with the open lock file.
+ * @retval 0 on success, -1 otherwise.
+ */
+static int
+mdcache_lockf(MDCACHE_LOCK *lock)
+{
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&mdcache_mutex);
+    lock->mutex = true;
+#endif
+    while (lockf(lock->fd, F_LOCK, 0) != 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return 0;
+}
+#endif
+
+/** Release a lock taken by mdcache_lock().
+ *
+ * @param[in,out] lock The lock.
+ */
+static void
+mdcache_unlock(MDCACHE_LOCK *lock)
+{
+    if (lock->fd >= 0) {
+#ifdef _WIN32
+        _locking(lock->fd, _LK_UNLCK, 1);
+        _close(lock->fd);
+#else
+        /* Closing the file releases the lock. */
+        close(lock->fd);
+#endif
+        lock->fd = -1;
+    }
+#ifdef HAVE_PTHREAD
+    if (lock->mutex)
+        pthread_mutex_unlock(&mdcache_mutex);
+#endif
+    lock->mutex = false;
+}
+
+/** Take the lock serializing the changes of the cache file.
+ *
+ * If the lock file can not be used, the change is made without the lock.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[out] lock The lock to be released by mdcache_unlock().
+ */
+static void
+mdcache_lock(ESYS_CONTEXT *esys_context, MDCACHE_LOCK *lock)
+{
+    const char *path = esys_context->mdcache.path;
+    char *lock_path;
+    size_t length;
+    int r = -1;
+
+    lock->fd = -1;
+    lock->mutex = false;
+
+    length = strlen(path) + sizeof(".lock");
+    lock_path = malloc(length);
+    if (lock_path == NULL) {
+        LOG_WARNING("Out of memory locking the metadata cache.");
+        return;
+    }
+    snprintf(lock_path, length, "%s.lock", path);
+
+#ifdef _WIN32
+    lock->fd = _open(lock_path, _O_RDWR | _O_CREAT | _O_BINARY,
+                     _S_IREAD | _S_IWRITE);
+    if (lock->fd >= 0)
+        r = _locking(lock->fd, _LK_LOCK, 1);
+#else
+    lock->fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (lock->fd >= 0) {
+#ifdef F_OFD_SETLKW
+        struct flock fl = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+
+        do {
+            r = fcntl(lock->fd, F_OFD_SETLKW, &fl);
+        } while (r != 0 && errno == EINTR);
+        /* Kernels before Linux 3.15 do not know open file description locks. */
+        if (r != 0 && errno == EINVAL)
+            r = mdcache_lockf(lock);
+#else
+        r = mdcache_lockf(lock);
+#endif
+    }
+#endif
+    if (r != 0) {
+        LOG_WARNING("Can not lock metadata cache %s", lock_path);
+        mdcache_unlock(lock);
+    }
+    free(lock_path);
+}
+
+/** Write the cache file.
+ *
+ * The entries of file are kept except for the dropped ones, and rsrc is
+ * appended. If the cache is full, the oldest entries are dropped.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] file The current file contents or NULL to start from scratch
+ *            with the identity of the context.
+ * @param[in] drop_handle The TPM handle to drop.
+ * @param[in] drop_type The handle type to drop or -1.
+ * @param[in] rsrc The metadata to append or NULL.
+ */
+static void
+mdcache_write(ESYS_CONTEXT *esys_context, const MDCACHE_FILE *file,
+              TPM2_HANDLE drop_handle, int drop_type,
+              const IESYS_RESOURCE *rsrc)
+{
+    IESYS_MDCACHE *mdcache = &esys_context->mdcache;
+    TSS2_RC r;
+    uint8_t *data;
+    const uint8_t *entry;
+    size_t capacity, offset = 0, entry_offset, entry_size, rsrc_offset;
+    size_t skip = 0;
+    UINT32 i, count = 0, kept = 0;
+    TPM2_HANDLE handle;
+
+    capacity = MDCACHE_HEADER_SIZE + MDCACHE_ENTRY_HEADER_SIZE +
+        ESYS_MAX_SIZE_METADATA;
+    if (file != NULL)
+        capacity += file->size;
+    data = malloc(capacity);
+    if (data == NULL) {
+        LOG_WARNING("Out of memory writing the metadata cache.");
+        return;
+    }
+
+    if (file != NULL) {
+        entry_offset = MDCACHE_HEADER_SIZE;
+        for (i = 0; i < file->count; i++) {
+            mdcache_entry(file, &entry_offset, &handle, &entry, &entry_size);
+            if (!mdcache_drops(handle, drop_handle, drop_type))
+                kept++;
+        }
+        if (rsrc != NULL && kept >= IESYS_MDCACHE_ENTRIES_MAX)
+            skip = kept - IESYS_MDCACHE_ENTRIES_MAX + 1;
+    }
+
+    r = Tss2_MU_UINT32_Marshal(IESYS_MDCACHE_MAGIC, data, capacity, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(IESYS_MDCACHE_VERSION, data, capacity,
+                                   &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(file ? file->resetCount
+                                   : mdcache->resetCount,
+                                   data, capacity, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(file ? file->restartCount
+                                   : mdcache->restartCount,
+                                   data, capacity, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT64_Marshal(file ? file->clock : mdcache->clock,
+                                   data, capacity, &offset);
+    /* The count is filled in below. */
+    offset += sizeof(UINT32);
+
+    if (file != NULL) {
+        entry_offset = MDCACHE_HEADER_SIZE;
+        for (i = 0; r == TSS2_RC_SUCCESS && i < file->count; i++) {
+            mdcache_entry(file, &entry_offset, &handle, &entry, &entry_size);
+            if (mdcache_drops(handle, drop_handle, drop_type))
+                continue;
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            memcpy(&data[offset], entry - MDCACHE_ENTRY_HEADER_SIZE,
+                   MDCACHE_ENTRY_HEADER_SIZE + entry_size);
+            offset += MDCACHE_ENTRY_HEADER_SIZE + entry_size;
+            count++;
+        }
+    }
+
+    if (r == TSS2_RC_SUCCESS && rsrc != NULL) {
+        r = Tss2_MU_UINT32_Marshal(rsrc->handle, data, capacity, &offset);
+        rsrc_offset = offset + sizeof(UINT16);
+        if (r == TSS2_RC_SUCCESS)
+            r = iesys_MU_IESYS_RESOURCE_Marshal(rsrc, data, capacity,
+                                                &rsrc_offset);
+        if (r == TSS2_RC_SUCCESS)
+            r = Tss2_MU_UINT16_Marshal((UINT16) (rsrc_offset - offset -
+                                                 sizeof(UINT16)),
+                                       data, capacity, &offset);
+        offset = rsrc_offset;
+        count++;
+    }
+
+    entry_offset = MDCACHE_HEADER_SIZE - sizeof(UINT32);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(count, data, capacity, &entry_offset);
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_WARNING("Can not marshal the metadata cache: 0x%08" PRIx32, r);
+        free(data);
+        return;
+    }
+
+    mdcache_replace(esys_context, data, offset);
+    free(data);
+}
+
+/** Enable, change or disable the metadata cache of a context.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] path The cache file or NULL to disable the cache.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the path can not be copied.
+ */
+TSS2_RC
+iesys_mdcache_set_path(ESYS_CONTEXT *esys_context, const char *path)
+{
+    char *copy = NULL;
+    size_t length;
+
+    if (path != NULL) {
+        length = strlen(path) + 1;
+        copy = malloc(length);
+        return_if_null(copy, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+        memcpy(copy, path, length);
+    }
+    iesys_mdcache_free(esys_context);
+    esys_context->mdcache.path = copy;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release the metadata cache state of a context.
+ *
+ * The identity of the TPM is forgotten as well and read again on the next use.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ */
+void
+iesys_mdcache_free(ESYS_CONTEXT *esys_context)
+{
+    SAFE_FREE(esys_context->mdcache.path);
+    esys_context->mdcache.identity_valid = false;
+}
+
+/** Check whether the metadata of a TPM handle is cached.
+ *
+ * Only persistent objects and NV indices live long enough to be cached.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] tpm_handle The TPM handle.
+ * @retval true if the cache is enabled and covers the handle.
+ * @retval false otherwise.
+ */
+bool
+iesys_mdcache_applies(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle)
+{
+    return esys_context->mdcache.path != NULL &&
+        (tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_PERSISTENT ||
+         tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_NV_INDEX);
+}
+
+/** Record the identity of the TPM.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] clock_info The clock values returned by TPM2_ReadClock.
+ */
+void
+iesys_mdcache_set_identity(ESYS_CONTEXT *esys_context,
+                           const TPMS_CLOCK_INFO *clock_info)
+{
+    esys_context->mdcache.resetCount = clock_info->resetCount;
+    esys_context->mdcache.restartCount = clock_info->restartCount;
+    esys_context->mdcache.clock = clock_info->clock;
+    esys_context->mdcache.identity_valid = true;
+}
+
+/** Look up the metadata of a TPM handle.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] tpm_handle The TPM handle.
+ * @param[out] rsrc The cached metadata.
+ * @retval true if the metadata was found.
+ * @retval false otherwise.
+ */
+bool
+iesys_mdcache_lookup(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle,
+                     IESYS_RESOURCE *rsrc)
+{
+    MDCACHE_FILE file;
+    const uint8_t *data;
+    size_t size, offset = 0;
+    IESYS_RESOURCE cached;
+    bool found = false;
+
+    if (!iesys_mdcache_applies(esys_context, tpm_handle) ||
+        !esys_context->mdcache.identity_valid)
+        return false;
+    if (!mdcache_load(esys_context->mdcache.path, &file))
+        return false;
+
+    if (mdcache_identity_matches(esys_context, &file) &&
+        mdcache_find(&file, tpm_handle, &data, &size) &&
+        iesys_MU_IESYS_RESOURCE_Unmarshal(data, size, &offset, &cached)
+            == TSS2_RC_SUCCESS &&
+        offset == size && cached.handle == tpm_handle) {
+        *rsrc = cached;
+        found = true;
+    }
+    free(file.data);
+    LOG_DEBUG("Metadata of 0x%08" PRIx32 " %s", tpm_handle,
+              found ? "found in cache" : "not cached");
+    return found;
+}
+
+/** Store the metadata of a TPM handle.
+ *
+ * If the cache file belongs to a different TPM identity, its entries are
+ * discarded.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] rsrc The metadata read from the TPM.
+ */
+void
+iesys_mdcache_store(ESYS_CONTEXT *esys_context, const IESYS_RESOURCE *rsrc)
+{
+    MDCACHE_FILE file;
+    MDCACHE_LOCK lock;
+
+    if (!iesys_mdcache_applies(esys_context, rsrc->handle) ||
+        !esys_context->mdcache.identity_valid)
+        return;
+
+    mdcache_lock(esys_context, &lock);
+    if (mdcache_load(esys_context->mdcache.path, &file) &&
+        mdcache_identity_matches(esys_context, &file)) {
+        mdcache_write(esys_context, &file, rsrc->handle, -1, rsrc);
+    } else {
+        mdcache_write(esys_context, NULL, rsrc->handle, -1, rsrc);
+    }
+    mdcache_unlock(&lock);
+    free(file.data);
+}
+
+/** Update cached metadata that was changed by a command.
+ *
+ * Nothing is stored if the handle is not cached yet.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] rsrc The new metadata.
+ */
+void
+iesys_mdcache_update(ESYS_CONTEXT *esys_context, const IESYS_RESOURCE *rsrc)
+{
+    MDCACHE_FILE file;
+    uint8_t buffer[ESYS_MAX_SIZE_METADATA];
+    const uint8_t *data;
+    size_t size, offset = 0;
+    MDCACHE_LOCK lock;
+
+    if (!iesys_mdcache_applies(esys_context, rsrc->handle))
+        return;
+
+    mdcache_lock(esys_context, &lock);
+    if (mdcache_load(esys_context->mdcache.path, &file)) {
+        if (mdcache_find(&file, rsrc->handle, &data, &size)) {
+            if (!mdcache_identity_matches(esys_context, &file) ||
+                iesys_MU_IESYS_RESOURCE_Marshal(rsrc, &buffer[0], sizeof(buffer),
+                                                &offset) != TSS2_RC_SUCCESS) {
+                mdcache_write(esys_context, &file, rsrc->handle, -1, NULL);
+            } else if (offset != size || memcmp(data, &buffer[0], size) != 0) {
+                mdcache_write(esys_context, &file, rsrc->handle, -1, rsrc);
+            }
+        }
+        free(file.data);
+    }
+    mdcache_unlock(&lock);
+}
+
+/** Drop cached metadata whose name differs from the TPM's.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] tpm_handle The TPM handle.
+ * @param[in] name The name reported by the TPM.
+ */
+void
+iesys_mdcache_check_name(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle,
+                         const TPM2B_NAME *name)
+{
+    MDCACHE_FILE file;
+    const uint8_t *data;
+    size_t size, offset = 0;
+    IESYS_RESOURCE cached;
+    MDCACHE_LOCK lock;
+
+    if (!iesys_mdcache_applies(esys_context, tpm_handle))
+        return;
+
+    mdcache_lock(esys_context, &lock);
+    if (mdcache_load(esys_context->mdcache.path, &file)) {
+        if (mdcache_find(&file, tpm_handle, &data, &size) &&
+            (iesys_MU_IESYS_RESOURCE_Unmarshal(data, size, &offset, &cached)
+                 != TSS2_RC_SUCCESS ||
+             cached.name.size != name->size ||
+             memcmp(&cached.name.name[0], &name->name[0], name->size) != 0)) {
+            LOG_DEBUG("Name of 0x%08" PRIx32 " changed, dropping cache entry",
+                      tpm_handle);
+            mdcache_write(esys_context, &file, tpm_handle, -1, NULL);
+        }
+        free(file.data);
+    }
+    mdcache_unlock(&lock);
+}
+
+/** Drop the cached metadata of a TPM handle.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] tpm_handle The TPM handle.
+ */
+void
+iesys_mdcache_remove(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle)
+{
+    MDCACHE_FILE file;
+    const uint8_t *data;
+    size_t size;
+    MDCACHE_LOCK lock;
+
+    if (!iesys_mdcache_applies(esys_context, tpm_handle))
+        return;
+
+    mdcache_lock(esys_context, &lock);
+    if (mdcache_load(esys_context->mdcache.path, &file)) {
+        if (mdcache_find(&file, tpm_handle, &data, &size))
+            mdcache_write(esys_context, &file, tpm_handle, -1, NULL);
+        free(file.data);
+    }
+    mdcache_unlock(&lock);
+}
+
+/** Drop the cached metadata of all handles of a type.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] type The handle type, e.g. TPM2_HT_NV_INDEX.
+ */
+void
+iesys_mdcache_remove_type(ESYS_CONTEXT *esys_context, TPM2_HT type)
+{
+    MDCACHE_FILE file;
+    size_t offset = MDCACHE_HEADER_SIZE, size;
+    const uint8_t *data;
+    TPM2_HANDLE handle;
+    UINT32 i;
+    MDCACHE_LOCK lock;
+
+    if (esys_context->mdcache.path == NULL)
+        return;
+
+    mdcache_lock(esys_context, &lock);
+    if (mdcache_load(esys_context->mdcache.path, &file)) {
+        for (i = 0; i < file.count; i++) {
+            mdcache_entry(&file, &offset, &handle, &data, &size);
+            if (handle >> TPM2_HR_SHIFT == type) {
+                mdcache_write(esys_context, &file, TPM2_RH_UNASSIGNED, type,
+                              NULL);
+                break;
+            }
+        }
+        free(file.data);
+    }
+    mdcache_unlock(&lock);
+}
+
+/** Drop all cached metadata.
+ *
+ * The identity of the TPM is read again on the next use, since TPM2_Clear
+ * resets the clock.
+ * @param[in] esys_context The ESYS_CONTEXT.
+ */
+void
+iesys_mdcache_clear(ESYS_CONTEXT *esys_context)
+{
+    MDCACHE_LOCK lock;
+
+    esys_context->mdcache.identity_valid = false;
+    if (esys_context->mdcache.path == NULL)
+        return;
+    mdcache_lock(esys_context, &lock);
+    if (remove(esys_context->mdcache.path) == 0)
+        LOG_DEBUG("Metadata cache %s removed", esys_context->mdcache.path);
+    mdcache_unlock(&lock);
+}
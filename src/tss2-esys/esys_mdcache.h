@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+#ifndef ESYS_MDCACHE_H
+#define ESYS_MDCACHE_H
+
+#include <stdbool.h>
+
+#include "tss2_esys.h"
+#include "esys_int.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The magic of the metadata cache file ('EMDC'). */
+#define IESYS_MDCACHE_MAGIC 0x454d4443U
+
+/** The version of the metadata cache file format. */
+#define IESYS_MDCACHE_VERSION 1
+
+/** The maximum number of entries of the metadata cache file. */
+#define IESYS_MDCACHE_ENTRIES_MAX 4096
+
+TSS2_RC
+iesys_mdcache_set_path(
+    ESYS_CONTEXT *esys_context,
+    const char *path);
+
+void
+iesys_mdcache_free(
+    ESYS_CONTEXT *esys_context);
+
+bool
+iesys_mdcache_applies(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HANDLE tpm_handle);
+
+void
+iesys_mdcache_set_identity(
+    ESYS_CONTEXT *esys_context,
+    const TPMS_CLOCK_INFO *clock_info);
+
+bool
+iesys_mdcache_lookup(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HANDLE tpm_handle,
+    IESYS_RESOURCE *rsrc);
+
+void
+iesys_mdcache_store(
+    ESYS_CONTEXT *esys_context,
+    const IESYS_RESOURCE *rsrc);
+
+void
+iesys_mdcache_update(
+    ESYS_CONTEXT *esys_context,
+    const IESYS_RESOURCE *rsrc);
+
+void
+iesys_mdcache_check_name(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HANDLE tpm_handle,
+    const TPM2B_NAME *name);
+
+void
+iesys_mdcache_remove(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HANDLE tpm_handle);
+
+void
+iesys_mdcache_remove_type(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HT type);
+
+void
+iesys_mdcache_clear(
+    ESYS_CONTEXT *esys_context);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ESYS_MDCACHE_H */
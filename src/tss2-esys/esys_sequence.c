@@ -0,0 +1,303 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** Determine the size of the chunks sent with TPM2_SequenceUpdate.
+ *
+ * The TPM2_PT_INPUT_BUFFER property is queried once per context and limited
+ * to TPM2_MAX_DIGEST_BUFFER, the size of a TPM2B_MAX_BUFFER.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[out] size The chunk size.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Esys_GetCapability().
+ */
+static TSS2_RC
+sequence_chunk_size(ESYS_CONTEXT *esys_context, UINT16 *size)
+{
+    TPMS_CAPABILITY_DATA *capability_data = NULL;
+    TPMI_YES_NO more_data;
+    TPML_TAGGED_TPM_PROPERTY *properties;
+    TSS2_RC r;
+
+    if (esys_context->inputBufferSize == 0) {
+        r = Esys_GetCapability(esys_context,
+                               ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                               TPM2_CAP_TPM_PROPERTIES, TPM2_PT_INPUT_BUFFER, 1,
+                               &more_data, &capability_data);
+        return_if_error(r, "Get capability TPM2_PT_INPUT_BUFFER");
+
+        properties = &capability_data->data.tpmProperties;
+        if (properties->count > 0 &&
+            properties->tpmProperty[0].property == TPM2_PT_INPUT_BUFFER &&
+            properties->tpmProperty[0].value > 0) {
+            esys_context->inputBufferSize = properties->tpmProperty[0].value;
+        } else {
+            LOG_WARNING("TPM2_PT_INPUT_BUFFER not reported, using %i bytes.",
+                        TPM2_MAX_DIGEST_BUFFER);
+            esys_context->inputBufferSize = TPM2_MAX_DIGEST_BUFFER;
+        }
+        Esys_Free(capability_data);
+    }
+
+    if (esys_context->inputBufferSize < TPM2_MAX_DIGEST_BUFFER)
+        *size = (UINT16) esys_context->inputBufferSize;
+    else
+        *size = TPM2_MAX_DIGEST_BUFFER;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Fill a buffer with the next chunk of the data.
+ *
+ * The read callback is called until the chunk is full or the end of the data
+ * is reached.
+ *
+ * @param[in] reader The read callback.
+ * @param[in] userdata The userdata of the callback.
+ * @param[out] buffer The chunk.
+ * @param[in] size The chunk size.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the callback returned too many bytes.
+ * @retval TSS2_RCs produced by the callback.
+ */
+static TSS2_RC
+sequence_read(ESYS_SEQUENCE_READ reader, void *userdata,
+              TPM2B_MAX_BUFFER *buffer, UINT16 size)
+{
+    size_t bytes_read;
+    TSS2_RC r;
+
+    buffer->size = 0;
+    while (buffer->size < size) {
+        bytes_read = 0;
+        r = reader(userdata, &buffer->buffer[buffer->size],
+                   size - buffer->size, &bytes_read);
+        return_if_error(r, "Read callback");
+        if (bytes_read == 0)
+            break;
+        if (bytes_read > (size_t) (size - buffer->size)) {
+            LOG_ERROR("Read callback returned %zu bytes, requested %u.",
+                      bytes_read, size - buffer->size);
+            return TSS2_ESYS_RC_BAD_VALUE;
+        }
+        buffer->size += (UINT16) bytes_read;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Wait for the response of Esys_SequenceUpdate_Async().
+ *
+ * Blocks independent of the timeout of the context, like the synchronous
+ * ESAPI functions do.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Esys_SequenceUpdate_Finish().
+ */
+static TSS2_RC
+sequence_update_finish(ESYS_CONTEXT *esys_context)
+{
+    int32_t timeout = esys_context->timeout;
+    TSS2_RC r;
+
+    esys_context->timeout = -1;
+    do {
+        r = Esys_SequenceUpdate_Finish(esys_context);
+    } while ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    esys_context->timeout = timeout;
+    return r;
+}
+
+/** Hash or HMAC a stream of data with a TPM sequence.
+ *
+ * Starts a hash sequence, or an HMAC sequence if hmacKey is given, and sends
+ * the data obtained from the read callback with TPM2_SequenceUpdate in chunks
+ * of TPM2_PT_INPUT_BUFFER bytes. The next chunk is read while the TPM
+ * processes the previous one. The last chunk is sent with
+ * TPM2_SequenceComplete.
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] hmacKey The HMAC key, or ESYS_TR_NONE for a hash sequence.
+ * @param[in] shandle1 The session authorizing hmacKey and the sequence,
+ *            e.g. ESYS_TR_PASSWORD.
+ * @param[in] hashAlg The hash algorithm, or TPM2_ALG_NULL for the scheme of
+ *            hmacKey.
+ * @param[in] hierarchy The hierarchy of the validation ticket, or
+ *            ESYS_TR_RH_NULL for none.
+ * @param[in] reader The callback providing the data.
+ * @param[in] userdata The userdata passed to reader.
+ * @param[out] result The digest.
+ *             (callee-allocated)
+ * @param[out] validation The validation ticket; may be NULL.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esys_context, reader or result are
+ *         NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if reader returned more bytes than requested.
+ * @retval TSS2_RCs produced by reader and the ESAPI sequence commands.
+ */
+TSS2_RC
+Esys_SequenceHash(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR hmacKey,
+    ESYS_TR shandle1,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    ESYS_SEQUENCE_READ reader,
+    void *userdata,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation)
+{
+    TPM2B_AUTH auth = { .size = 0 };
+    TPM2B_MAX_BUFFER buffers[2];
+    TPM2B_MAX_BUFFER *current = &buffers[0], *next = &buffers[1], *tmp;
+    ESYS_TR sequence = ESYS_TR_NONE;
+    UINT16 chunk_size;
+    TSS2_RC r, r_read;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(reader);
+    _ESYS_ASSERT_NON_NULL(result);
+
+    r = sequence_chunk_size(esys_context, &chunk_size);
+    return_if_error(r, "Determine chunk size");
+
+    if (hmacKey == ESYS_TR_NONE)
+        r = Esys_HashSequenceStart(esys_context,
+                                   ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                   &auth, hashAlg, &sequence);
+    else
+        r = Esys_HMAC_Start(esys_context, hmacKey,
+                            shandle1, ESYS_TR_NONE, ESYS_TR_NONE,
+                            &auth, hashAlg, &sequence);
+    return_if_error(r, "Start sequence");
+
+    /* The chunk after the current one is read ahead, so that the last chunk
+       is known and can be sent with TPM2_SequenceComplete. */
+    r = sequence_read(reader, userdata, current, chunk_size);
+    goto_if_error(r, "Read data", error_flush);
+    next->size = 0;
+    if (current->size == chunk_size) {
+        r = sequence_read(reader, userdata, next, chunk_size);
+        goto_if_error(r, "Read data", error_flush);
+    }
+
+    while (next->size > 0) {
+        r = Esys_SequenceUpdate_Async(esys_context, sequence,
+                                      shandle1, ESYS_TR_NONE, ESYS_TR_NONE,
+                                      current);
+        goto_if_error(r, "Sequence update", error_flush);
+
+        /* The chunk is marshalled into the command buffer; reuse its buffer
+           for reading ahead while the TPM processes it. */
+        current->size = 0;
+        r_read = TSS2_RC_SUCCESS;
+        if (next->size == chunk_size)
+            r_read = sequence_read(reader, userdata, current, chunk_size);
+
+        r = sequence_update_finish(esys_context);
+        goto_if_error(r, "Sequence update", error_flush);
+        r = r_read;
+        goto_if_error(r, "Read data", error_flush);
+
+        tmp = current;
+        current = next;
+        next = tmp;
+    }
+
+    r = Esys_SequenceComplete(esys_context, sequence,
+                              shandle1, ESYS_TR_NONE, ESYS_TR_NONE,
+                              current, hierarchy, result, validation);
+    goto_if_error(r, "Sequence complete", error_flush);
+
+    return TSS2_RC_SUCCESS;
+
+error_flush:
+    if (Esys_FlushContext(esys_context, sequence) != TSS2_RC_SUCCESS)
+        LOG_WARNING("Flushing the sequence object failed.");
+    return r;
+}
+
+/** Read callback of Esys_SequenceHashFd(). */
+static TSS2_RC
+sequence_read_fd(void *userdata, uint8_t *buffer, size_t size,
+                 size_t *bytes_read)
+{
+    int fd = *(int *) userdata;
+#ifdef _WIN32
+    int n;
+
+    n = _read(fd, buffer, (unsigned int) size);
+#else
+    ssize_t n;
+
+    do {
+        n = read(fd, buffer, size);
+    } while (n < 0 && errno == EINTR);
+#endif
+    if (n < 0) {
+        LOG_ERROR("Reading from fd %i failed: %s", fd, strerror(errno));
+        return TSS2_ESYS_RC_IO_ERROR;
+    }
+    *bytes_read = (size_t) n;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Hash or HMAC the data of a file descriptor with a TPM sequence.
+ *
+ * Reads fd until its end and hashes the data like Esys_SequenceHash().
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] hmacKey The HMAC key, or ESYS_TR_NONE for a hash sequence.
+ * @param[in] shandle1 The session authorizing hmacKey and the sequence,
+ *            e.g. ESYS_TR_PASSWORD.
+ * @param[in] hashAlg The hash algorithm, or TPM2_ALG_NULL for the scheme of
+ *            hmacKey.
+ * @param[in] hierarchy The hierarchy of the validation ticket, or
+ *            ESYS_TR_RH_NULL for none.
+ * @param[in] fd The file descriptor to read.
+ * @param[out] result The digest.
+ *             (callee-allocated)
+ * @param[out] validation The validation ticket; may be NULL.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esys_context or result are NULL.
+ * @retval TSS2_ESYS_RC_IO_ERROR if reading fd failed.
+ * @retval TSS2_RCs produced by the ESAPI sequence commands.
+ */
+TSS2_RC
+Esys_SequenceHashFd(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR hmacKey,
+    ESYS_TR shandle1,
+    TPMI_ALG_HASH hashAlg,
+    ESYS_TR hierarchy,
+    int fd,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation)
+{
+    return Esys_SequenceHash(esys_context, hmacKey, shandle1, hashAlg,
+                             hierarchy, sequence_read_fd, &fd, result,
+                             validation);
+}
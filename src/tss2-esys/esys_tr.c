@@ -8,10 +8,13 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include "tss2_esys.h"
 #include "esys_mu.h"
 
 #include "esys_iutil.h"
+#include "esys_mdcache.h"
 #define LOGMODULE esys
 #include "util/log.h"
 #include "util/aux_util.h"
@@ -40,24 +43,26 @@ Esys_TR_Serialize(ESYS_CONTEXT * esys_context,
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     RSRC_NODE_T *esys_object;
+    uint8_t rsrc_buffer[sizeof(IESYS_RESOURCE)];
     size_t offset = 0;
     *buffer_size = 0;
 
     r = esys_GetResourceObject(esys_context, esys_handle, &esys_object);
     return_if_error(r, "Get resource object");
 
-    r = iesys_MU_IESYS_RESOURCE_Marshal(&esys_object->rsrc, NULL, SIZE_MAX,
-                                        buffer_size);
+    /* The marshalled object never exceeds its host representation, so it is
+       marshalled once into a stack buffer of that size and only the result
+       is copied into a buffer of the exact size. */
+    r = iesys_MU_IESYS_RESOURCE_Marshal(&esys_object->rsrc, &rsrc_buffer[0],
+                                        sizeof(rsrc_buffer), &offset);
     return_if_error(r, "Marshal resource object");
 
-    *buffer = malloc(*buffer_size);
+    *buffer = malloc(offset);
     return_if_null(*buffer, "Buffer could not be allocated",
                    TSS2_ESYS_RC_MEMORY);
 
-    r = iesys_MU_IESYS_RESOURCE_Marshal(&esys_object->rsrc, *buffer,
-                                        *buffer_size, &offset);
-    return_if_error(r, "Marshal resource object");
-
+    memcpy(*buffer, &rsrc_buffer[0], offset);
+    *buffer_size = offset;
     return TSS2_RC_SUCCESS;
 };
 
@@ -99,10 +104,268 @@ Esys_TR_Deserialize(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Magic number "ESYS" at the start of a state blob. */
+#define ESYS_STATE_MAGIC 0x45535953U
+
+/** Version of the state blob format written by Esys_SaveState. */
+#define ESYS_STATE_VERSION 1U
+
+/** Upper bound of the marshalled size of one resource node. */
+#define ESYS_STATE_NODE_MAX (sizeof(UINT32) + sizeof(TPM2B_AUTH) + \
+                             sizeof(IESYS_RESOURCE))
+
+static RSRC_NODE_T *
+esys_state_find(RSRC_NODE_T *list, ESYS_TR esys_handle)
+{
+    for (; list != NULL; list = list->next) {
+        if (list->esys_handle == esys_handle)
+            return list;
+    }
+    return NULL;
+}
+
+/** Serialization of all ESYS_TR objects of a context into one byte buffer.
+ *
+ * Serialize the metadata of every ESYS_TR object of the context, including
+ * the global objects for hierarchies and PCRs that are in use, such that they
+ * can be restored with Esys_RestoreState by a later program without querying
+ * the TPM again. The ESYS_TR numbers are kept.
+ * Note: The metadata of sessions includes the session key. The auth values
+ * are omitted if ESYS_SAVE_STATE_NO_AUTH is passed.
+ * @param esys_context [in] The ESYS_CONTEXT.
+ * @param flags [in] ESYS_SAVE_STATE_NO_AUTH or 0.
+ * @param buffer [out] The buffer containing the serialized metadata.
+ *        (caller-callocated) Shall be freed using free().
+ * @param buffer_size [out] The size of the buffer parameter.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a pointer parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if unknown flags are passed.
+ * @retval TSS2_ESYS_RC_MEMORY if the buffer can't be allocated.
+ * @retval TSS2_RCs produced by lower layers of the software stack.
+ */
+TSS2_RC
+Esys_SaveState(ESYS_CONTEXT * esys_context, uint32_t flags,
+               uint8_t ** buffer, size_t * buffer_size)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *node;
+    UINT32 count = 0;
+    size_t offset = 0, capacity;
+    uint8_t *grown;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+    _ESYS_ASSERT_NON_NULL(buffer_size);
+    if (flags & ~ESYS_SAVE_STATE_NO_AUTH)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Unknown flags.");
+
+    for (node = esys_context->rsrc_list; node != NULL; node = node->next)
+        count++;
+
+    /* The buffer is grown on demand, so every node is marshalled once. */
+    capacity = 5 * sizeof(UINT32) + ESYS_STATE_NODE_MAX;
+    *buffer = malloc(capacity);
+    return_if_null(*buffer, "Buffer could not be allocated",
+                   TSS2_ESYS_RC_MEMORY);
+
+    r = Tss2_MU_UINT32_Marshal(ESYS_STATE_MAGIC, *buffer, capacity, &offset);
+    goto_if_error(r, "Marshal magic", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal(ESYS_STATE_VERSION, *buffer, capacity, &offset);
+    goto_if_error(r, "Marshal version", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal(flags, *buffer, capacity, &offset);
+    goto_if_error(r, "Marshal flags", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal(esys_context->esys_handle_cnt, *buffer, capacity,
+                               &offset);
+    goto_if_error(r, "Marshal handle counter", error_cleanup);
+    r = Tss2_MU_UINT32_Marshal(count, *buffer, capacity, &offset);
+    goto_if_error(r, "Marshal count", error_cleanup);
+
+    for (node = esys_context->rsrc_list; node != NULL; node = node->next) {
+        if (capacity - offset < ESYS_STATE_NODE_MAX) {
+            capacity = 2 * capacity + ESYS_STATE_NODE_MAX;
+            grown = realloc(*buffer, capacity);
+            goto_if_null(grown, "Buffer could not be allocated",
+                         TSS2_ESYS_RC_MEMORY, error_cleanup);
+            *buffer = grown;
+        }
+        r = Tss2_MU_UINT32_Marshal(node->esys_handle, *buffer, capacity,
+                                   &offset);
+        goto_if_error(r, "Marshal ESYS_TR", error_cleanup);
+        if (!(flags & ESYS_SAVE_STATE_NO_AUTH)) {
+            r = Tss2_MU_TPM2B_AUTH_Marshal(&node->auth, *buffer, capacity,
+                                           &offset);
+            goto_if_error(r, "Marshal auth value", error_cleanup);
+        }
+        r = iesys_MU_IESYS_RESOURCE_Marshal(&node->rsrc, *buffer, capacity,
+                                            &offset);
+        goto_if_error(r, "Marshal resource object", error_cleanup);
+    }
+
+    grown = realloc(*buffer, offset);
+    if (grown != NULL)
+        *buffer = grown;
+    *buffer_size = offset;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    SAFE_FREE(*buffer);
+    return r;
+}
+
+/** Deserialization of all ESYS_TR objects from a byte buffer.
+ *
+ * Restore the ESYS_TR objects serialized by Esys_SaveState into a context,
+ * keeping their ESYS_TR numbers. No TPM commands are executed. The metadata
+ * of global objects (hierarchies, PCRs) replaces the one in the context. The
+ * buffer is checked completely before the context is changed.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param buffer [in] The buffer written by Esys_SaveState.
+ * @param buffer_size [in] The size of the buffer parameter.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a pointer parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is in progress.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if the buffer is not a state of a supported
+ *         version.
+ * @retval TSS2_ESYS_RC_BAD_TR if an ESYS_TR of the state is already in use
+ *         by an object of the context.
+ * @retval TSS2_ESYS_RC_MEMORY if the objects can not be allocated.
+ * @retval TSS2_RCs produced by lower layers of the software stack.
+ */
+TSS2_RC
+Esys_RestoreState(ESYS_CONTEXT * esys_context, uint8_t const *buffer,
+                  size_t buffer_size)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *list = NULL, *node, *next, *existing;
+    UINT32 magic, version, flags, handle_cnt, count, i;
+    size_t offset = 0;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    _ESYS_ASSERT_NON_NULL(buffer);
+    if (esys_context->state != _ESYS_STATE_INIT)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "Command in progress.");
+
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &magic);
+    return_if_error(r, "Unmarshal magic");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &version);
+    return_if_error(r, "Unmarshal version");
+    if (magic != ESYS_STATE_MAGIC || version != ESYS_STATE_VERSION) {
+        LOG_ERROR("Unsupported state (magic 0x%08"PRIx32", version %"PRIu32")",
+                  magic, version);
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &flags);
+    return_if_error(r, "Unmarshal flags");
+    if (flags & ~ESYS_SAVE_STATE_NO_AUTH)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Unknown flags.");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &handle_cnt);
+    return_if_error(r, "Unmarshal handle counter");
+    r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset, &count);
+    return_if_error(r, "Unmarshal count");
+
+    for (i = 0; i < count; i++) {
+        node = calloc(1, sizeof(RSRC_NODE_T));
+        goto_if_null(node, "Out of memory.", TSS2_ESYS_RC_MEMORY,
+                     error_cleanup);
+        node->next = list;
+        list = node;
+
+        r = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &offset,
+                                     &node->esys_handle);
+        goto_if_error(r, "Unmarshal ESYS_TR", error_cleanup);
+        if (!(flags & ESYS_SAVE_STATE_NO_AUTH)) {
+            r = Tss2_MU_TPM2B_AUTH_Unmarshal(buffer, buffer_size, &offset,
+                                             &node->auth);
+            goto_if_error(r, "Unmarshal auth value", error_cleanup);
+        }
+        r = iesys_MU_IESYS_RESOURCE_Unmarshal(buffer, buffer_size, &offset,
+                                              &node->rsrc);
+        goto_if_error(r, "Unmarshal resource object", error_cleanup);
+
+        if (node->esys_handle == ESYS_TR_NONE ||
+            esys_state_find(node->next, node->esys_handle) != NULL) {
+            goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Invalid ESYS_TR in state.",
+                       error_cleanup);
+        }
+        if (node->esys_handle >= ESYS_TR_MIN_OBJECT &&
+            esys_state_find(esys_context->rsrc_list, node->esys_handle)) {
+            LOG_ERROR("ESYS_TR 0x%"PRIx32" already in use.", node->esys_handle);
+            r = TSS2_ESYS_RC_BAD_TR;
+            goto error_cleanup;
+        }
+    }
+    if (offset != buffer_size) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Trailing data after state.",
+                   error_cleanup);
+    }
+
+    for (node = list; node != NULL; node = next) {
+        next = node->next;
+        existing = esys_state_find(esys_context->rsrc_list, node->esys_handle);
+        if (existing == NULL) {
+            node->next = esys_context->rsrc_list;
+            esys_context->rsrc_list = node;
+            continue;
+        }
+        existing->rsrc = node->rsrc;
+        if (!(flags & ESYS_SAVE_STATE_NO_AUTH))
+            existing->auth = node->auth;
+        free(node);
+    }
+    if (handle_cnt > esys_context->esys_handle_cnt)
+        esys_context->esys_handle_cnt = handle_cnt;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    for (node = list; node != NULL; node = next) {
+        next = node->next;
+        free(node);
+    }
+    return r;
+}
+
+/** Send the command reading the metadata of a TPM handle.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT
+ * @param esys_handle [in] The ESYS_TR object receiving the metadata.
+ * @param tpm_handle [in] The TPM handle of the object.
+ * @param shandle1 [in,out] A session for securing the TPM command (optional).
+ * @param shandle2 [in,out] A session for securing the TPM command (optional).
+ * @param shandle3 [in,out] A session for securing the TPM command (optional).
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval TSS2_RCs produced by Esys_ReadPublic_Async or
+ *         Esys_NV_ReadPublic_Async.
+ */
+static TSS2_RC
+esys_read_public_async(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle,
+                       TPM2_HANDLE tpm_handle, ESYS_TR shandle1,
+                       ESYS_TR shandle2, ESYS_TR shandle3)
+{
+    TSS2_RC r;
+
+    if (tpm_handle >= TPM2_NV_INDEX_FIRST && tpm_handle <= TPM2_NV_INDEX_LAST) {
+        r = Esys_NV_ReadPublic_Async(esys_context, esys_handle, shandle1,
+                                     shandle2, shandle3);
+        return_if_error(r, "Error NV_ReadPublic");
+
+    } else if(tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_LOADED_SESSION
+            || tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_SAVED_SESSION) {
+        // no readpublic call for loaded or saved sessions.
+        r = TSS2_RC_SUCCESS;
+    } else {
+        r = Esys_ReadPublic_Async(esys_context, esys_handle, shandle1, shandle2,
+                                  shandle3);
+        return_if_error(r, "Error ReadPublic");
+    }
+    return r;
+}
+
 /** Start synchronous creation of an ESYS_TR object from TPM metadata.
  *
  * This function starts the asynchronous retrieval of metadata from the TPM in
  * order to create a new ESYS_TR object.
+ * If a metadata cache was set with Esys_SetMetadataCache and holds the
+ * metadata, no command is sent and the _Finish function returns immediately.
  * @param esys_context [in,out] The ESYS_CONTEXT
  * @param tpm_handle [in] The handle of the TPM object to represent as ESYS_TR.
  * @param shandle1 [in,out] A session for securing the TPM command (optional).
@@ -139,21 +402,30 @@ Esys_TR_FromTPMPublic_Async(ESYS_CONTEXT * esys_context,
 
     esysHandleNode->rsrc.handle = tpm_handle;
     esys_context->esys_handle = esys_handle;
-
-    if (tpm_handle >= TPM2_NV_INDEX_FIRST && tpm_handle <= TPM2_NV_INDEX_LAST) {
-        r = Esys_NV_ReadPublic_Async(esys_context, esys_handle, shandle1,
-                                     shandle2, shandle3);
-        goto_if_error(r, "Error NV_ReadPublic", error_cleanup);
-
-    } else if(tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_LOADED_SESSION
-            || tpm_handle >> TPM2_HR_SHIFT == TPM2_HT_SAVED_SESSION) {
-        // no readpublic call for loaded or saved sessions.
-        r = TSS2_RC_SUCCESS;
-    } else {
-        r = Esys_ReadPublic_Async(esys_context, esys_handle, shandle1, shandle2,
-                                  shandle3);
-        goto_if_error(r, "Error ReadPublic", error_cleanup);
+    esys_context->mdcache.step = _ESYS_MDCACHE_IDLE;
+
+    if (iesys_mdcache_applies(esys_context, tpm_handle)) {
+        if (!esys_context->mdcache.identity_valid) {
+            /* The cache is only trusted once the TPM's identity is known. */
+            esys_context->mdcache.shandle[0] = shandle1;
+            esys_context->mdcache.shandle[1] = shandle2;
+            esys_context->mdcache.shandle[2] = shandle3;
+            r = Esys_ReadClock_Async(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                                     ESYS_TR_NONE);
+            goto_if_error(r, "Error ReadClock", error_cleanup);
+            esys_context->mdcache.step = _ESYS_MDCACHE_CLOCK;
+            return r;
+        }
+        if (iesys_mdcache_lookup(esys_context, tpm_handle,
+                                 &esysHandleNode->rsrc)) {
+            esys_context->mdcache.step = _ESYS_MDCACHE_HIT;
+            return TSS2_RC_SUCCESS;
+        }
     }
+
+    r = esys_read_public_async(esys_context, esys_handle, tpm_handle, shandle1,
+                               shandle2, shandle3);
+    goto_if_error(r, "Error read public", error_cleanup);
     return r;
  error_cleanup:
     Esys_TR_Close(esys_context, &esys_handle);
@@ -197,6 +469,47 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
     r = esys_GetResourceObject(esys_context, objectHandle, &objectHandleNode);
     goto_if_error(r, "get resource", error_cleanup);
 
+    if (esys_context->mdcache.step == _ESYS_MDCACHE_HIT) {
+        esys_context->mdcache.step = _ESYS_MDCACHE_IDLE;
+        *object = objectHandle;
+        return TSS2_RC_SUCCESS;
+    }
+
+    if (esys_context->mdcache.step == _ESYS_MDCACHE_CLOCK) {
+        TPMS_TIME_INFO *currentTime = NULL;
+        r = Esys_ReadClock_Finish(esys_context, &currentTime);
+        if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
+            LOG_DEBUG("A layer below returned TRY_AGAIN: %" PRIx32
+                      " => resubmitting command", r);
+            return r;
+        }
+        esys_context->mdcache.step = _ESYS_MDCACHE_IDLE;
+        if (r == TSS2_RC_SUCCESS) {
+            iesys_mdcache_set_identity(esys_context, &currentTime->clockInfo);
+            SAFE_FREE(currentTime);
+            if (iesys_mdcache_lookup(esys_context,
+                                     objectHandleNode->rsrc.handle,
+                                     &objectHandleNode->rsrc)) {
+                *object = objectHandle;
+                return TSS2_RC_SUCCESS;
+            }
+        } else if (esys_context->state != _ESYS_STATE_INIT) {
+            goto_if_error(r, "Error ReadClock", error_cleanup);
+        } else {
+            LOG_WARNING("ReadClock failed, metadata cache not used: %" PRIx32,
+                        r);
+        }
+
+        /* The metadata is not cached, read it from the TPM. */
+        r = esys_read_public_async(esys_context, objectHandle,
+                                   objectHandleNode->rsrc.handle,
+                                   esys_context->mdcache.shandle[0],
+                                   esys_context->mdcache.shandle[1],
+                                   esys_context->mdcache.shandle[2]);
+        goto_if_error(r, "Error read public", error_cleanup);
+        return TSS2_ESYS_RC_TRY_AGAIN;
+    }
+
     if (objectHandleNode->rsrc.handle >= TPM2_NV_INDEX_FIRST
         && objectHandleNode->rsrc.handle <= TPM2_NV_INDEX_LAST) {
         TPM2B_NV_PUBLIC *nvPublic;
@@ -237,6 +550,7 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
         SAFE_FREE(name);
         SAFE_FREE(qualifiedName);
     }
+    iesys_mdcache_store(esys_context, &objectHandleNode->rsrc);
     *object = objectHandle;
     return TSS2_RC_SUCCESS;
 
@@ -19,6 +19,8 @@
 #include "tss2_tctildr.h"
 #include "fapi_int.h"
 #include "fapi_util.h"
+#include "fapi_crypto.h"
+#include "ifapi_timing.h"
 #include "tss2_esys.h"
 #define LOGMODULE fapi
 #include "util/log.h"
@@ -57,6 +59,7 @@ Fapi_Finalize(
         Esys_Finalize(&((*context)->esys));
         if (tcti) {
             LOG_TRACE("Finalizing TCTI");
+            tcti = ifapi_timing_tcti_unwrap(tcti);
             Tss2_TctiLdr_Finalize(&tcti);
         }
     }
@@ -84,6 +87,12 @@ Fapi_Finalize(
 
     /* Finalize the eventlog module. */
     SAFE_FREE((*context)->eventlog.log_dir);
+    SAFE_FREE((*context)->eventlog.log);
+    ifapi_eventlog_replay_cleanup(&(*context)->eventlog.replay);
+    ifapi_drbg_cleanup(&(*context)->drbg);
+
+    /* Finalize the I/O module; stops the workers if no context is left. */
+    ifapi_io_cleanup(&(*context)->io);
 
     /* Finalize all remaining object of the context. */
     ifapi_free_objects(*context);
@@ -307,8 +307,8 @@ Fapi_GetEsysBlob_Finish(
             goto_if_error(r, "Error esys context save", error_cleanup);
 
             *length = 0;
-            r = Tss2_MU_TPMS_CONTEXT_Marshal(key_context, NULL, SIZE_MAX, length);
-            goto_if_error(r, "Marshaling context", error_cleanup);
+            r = Tss2_MU_TPMS_CONTEXT_Size(key_context, length);
+            goto_if_error(r, "Computing context size", error_cleanup);
 
             *data = malloc(*length);
             goto_if_null2(*data, "Out of memory", r, TSS2_FAPI_RC_MEMORY,
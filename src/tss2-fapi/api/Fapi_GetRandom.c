@@ -14,6 +14,7 @@
 #include "tss2_fapi.h"
 #include "fapi_int.h"
 #include "fapi_util.h"
+#include "fapi_crypto.h"
 #include "tss2_esys.h"
 #define LOGMODULE fapi
 #include "util/log.h"
@@ -24,6 +25,15 @@
  * Creates an array with a specified number of bytes. May execute the underlying
  * TPM command multiple times if the requested number of bytes is too big.
  *
+ * If the configuration sets "random_source" to "drbg", the bytes are produced
+ * by a local HMAC_DRBG (NIST SP 800-90A) that is seeded from the TPM and
+ * reseeded after "drbg_reseed_bytes" bytes (default 1 MiB) or after
+ * "drbg_reseed_interval" seconds (default 60, 0 for no limit). Requests are
+ * then served at memory speed, but the security of the bytes rests on the
+ * generator instead of the TPM: its state is kept in the memory of the
+ * process, so anybody who can read that memory can predict the output until
+ * the next reseed.
+ *
  * @param[in,out] context The FAPI_CONTEXT
  * @param[in] numBytes The number of bytes requested from the TPM
  * @param[out] data The array of random bytes returned from the TPM
@@ -153,6 +163,24 @@ Fapi_GetRandom_Async(
     command->numBytes = numBytes;
     command->data = NULL;
 
+    /* If the seed of the local random bit generator covers the request, no
+       TPM command and thus no session is needed. */
+    if (context->config.random_source == IFAPI_RANDOM_SOURCE_DRBG &&
+        ifapi_drbg_available(&context->drbg, context->config.drbg_reseed_bytes,
+                             context->config.drbg_reseed_interval) >= numBytes) {
+        command->data = calloc(numBytes, 1);
+        return_if_null(command->data, "FAPI out of memory.", TSS2_FAPI_RC_MEMORY);
+
+        r = ifapi_drbg_generate(&context->drbg, command->data, numBytes);
+        if (r != TSS2_RC_SUCCESS)
+            SAFE_FREE(command->data);
+        return_if_error(r, "Generate random data");
+
+        context->state = GET_RANDOM_CLEANUP;
+        LOG_TRACE("finished");
+        return TSS2_RC_SUCCESS;
+    }
+
     /* Start a session for integrity protection and encryption of random data. */
     r = ifapi_get_sessions_async(context,
                                  IFAPI_SESSION_GENEK | IFAPI_SESSION1,
@@ -240,6 +268,8 @@ Fapi_GetRandom_Finish(
         statecasedefault(context->state);
     }
 
+    *data = command->data;
+
     /* Cleanup any intermediate results and state stored in the context. */
     context->state = _FAPI_STATE_INIT;
     ifapi_cleanup_ifapi_object(&context->createPrimary.pkey_object);
@@ -23,6 +23,8 @@
 #include "fapi_int.h"
 #include "fapi_util.h"
 #include "ifapi_json_deserialize.h"
+#include "ifapi_snapshot.h"
+#include "ifapi_timing.h"
 #define LOGMODULE fapi
 #include "util/log.h"
 #include "util/aux_util.h"
@@ -126,6 +128,20 @@ Fapi_Initialize_Async(
     return_if_null(*context, "Out of memory.", TSS2_FAPI_RC_MEMORY);
     memset(*context, 0, sizeof(FAPI_CONTEXT));
 
+    /* A snapshot of a previous initialization replaces reading the config
+       file and the profiles if none of them has changed since. */
+    IFAPI_INITIALIZE *command = &(*context)->cmd.Initialize;
+    command->snapshot_file = ifapi_snapshot_get_file();
+    if (command->snapshot_file &&
+            ifapi_snapshot_load(command->snapshot_file, ifapi_config_get_file(),
+                                &(*context)->config, &(*context)->profiles,
+                                &command->snapshot_nv_buffer_max) == TSS2_RC_SUCCESS) {
+        command->snapshot_loaded = true;
+        (*context)->state = INITIALIZE_INIT_MODULES;
+        LOG_TRACE("finished");
+        return TSS2_RC_SUCCESS;
+    }
+
     /* Initialize the context */
     r = ifapi_config_initialize_async(&(*context)->io);
     goto_if_error(r, "Could not initialize FAPI context", cleanup_return);
@@ -134,8 +150,10 @@ Fapi_Initialize_Async(
     (*context)->state = INITIALIZE_READ;
 
 cleanup_return:
-    if (r)
+    if (r) {
+        ifapi_io_cleanup(&(*context)->io);
         SAFE_FREE(*context);
+    }
     LOG_TRACE("finished");
     return r;
 }
@@ -177,7 +195,8 @@ Fapi_Initialize_Finish(
     check_not_null(*context);
 
     /* Helpful alias pointers */
-    TPMS_CAPABILITY_DATA **capability = &(*context)->cmd.Initialize.capability;
+    IFAPI_INITIALIZE *command = &(*context)->cmd.Initialize;
+    TPMS_CAPABILITY_DATA **capability = &command->capability;
 
     switch ((*context)->state) {
     statecase((*context)->state, INITIALIZE_READ);
@@ -185,16 +204,20 @@ Fapi_Initialize_Finish(
         r = ifapi_config_initialize_finish(&(*context)->io, &(*context)->config);
         return_try_again(r);
         goto_if_error(r, "Could not finish initialization", cleanup_return);
+        fallthrough;
 
+    statecase((*context)->state, INITIALIZE_INIT_MODULES);
         /* Initialize the event log module. */
-        r = ifapi_eventlog_initialize(&((*context)->eventlog), (*context)->config.log_dir);
+        r = ifapi_eventlog_initialize(&((*context)->eventlog), (*context)->config.log_dir,
+                                      (*context)->config.replay_threads);
         goto_if_error(r, "Initializing evenlog module", cleanup_return);
 
         /* Initialize the keystore. */
         r = ifapi_keystore_initialize(&((*context)->keystore),
                                       (*context)->config.keystore_dir,
                                       (*context)->config.user_dir,
-                                      (*context)->config.profile_name);
+                                      (*context)->config.profile_name,
+                                      (*context)->config.keystore_format);
         goto_if_error2(r, "Keystore could not be initialized.", cleanup_return);
 
         /* Initialize the policy store. */
@@ -218,6 +241,10 @@ Fapi_Initialize_Finish(
         r = Tss2_TctiLdr_Initialize((*context)->config.tcti, &fapi_tcti);
         goto_if_error(r, "Initializing TCTI.", cleanup_return);
 
+        /* Measure the time waited for the TPM if the timing hooks are on. */
+        r = ifapi_timing_tcti_wrap(&fapi_tcti);
+        goto_if_error(r, "Wrapping TCTI.", cleanup_return);
+
         /* Initialize an ESYS context using this Tcti. */
         r = Esys_Initialize(&((*context)->esys), fapi_tcti, NULL);
         goto_if_error(r, "Initialize esys context.", cleanup_return);
@@ -228,6 +255,14 @@ Fapi_Initialize_Finish(
             LOG_ERROR("Esys_Startup FAILED! Response Code : 0x%x", r);
             return r;
         }
+
+        /* The TPM properties of the snapshot were queried through the same
+           TCTI configuration. */
+        if (command->snapshot_nv_buffer_max != 0) {
+            (*context)->nv_buffer_max = command->snapshot_nv_buffer_max;
+            (*context)->state = INITIALIZE_READ_PROFILE_INIT;
+            return TSS2_FAPI_RC_TRY_AGAIN;
+        }
         fallthrough;
 
     statecase((*context)->state, INITIALIZE_GET_CAP);
@@ -264,6 +299,10 @@ Fapi_Initialize_Finish(
         fallthrough;
 
     statecase((*context)->state, INITIALIZE_READ_PROFILE_INIT);
+        /* The profiles of the snapshot are already loaded. */
+        if (command->snapshot_loaded)
+            break;
+
         /* Initialize the proviles module that loads cryptographic profiles.
            The default profile is taken from config. */
         r = ifapi_profiles_initialize_async(&(*context)->profiles, &(*context)->io,
@@ -283,6 +322,16 @@ Fapi_Initialize_Finish(
     statecasedefault((*context)->state);
     }
 
+    /* Store the result of a full initialization for the next one. Failing
+       to do so only costs the next initialization its warm start. */
+    if (command->snapshot_file && !command->snapshot_loaded) {
+        r = ifapi_snapshot_save(command->snapshot_file, ifapi_config_get_file(),
+                                &(*context)->config, &(*context)->profiles,
+                                (*context)->nv_buffer_max);
+        if (r != TSS2_RC_SUCCESS)
+            LOG_WARNING("Snapshot %s not written.", command->snapshot_file);
+    }
+
     (*context)->state = _FAPI_STATE_INIT;
     SAFE_FREE(*capability);
     LOG_TRACE("finished");
@@ -295,9 +344,12 @@ cleanup_return:
         Esys_Finalize(&(*context)->esys);
     }
     if (fapi_tcti) {
+        fapi_tcti = ifapi_timing_tcti_unwrap(fapi_tcti);
         Tss2_TctiLdr_Finalize(&fapi_tcti);
     }
 
+    ifapi_io_cleanup(&(*context)->io);
+
     /* Free the context memory in case of an error. */
     free(*context);
     *context = NULL;
@@ -168,6 +168,7 @@ Fapi_NvRead_Async(
     return_if_error(r, "Initialize NvRead");
 
     memset(command, 0, sizeof(IFAPI_NV_Cmds));
+    command->report_chunks = true;
 
     /* Copy parameters to context for use during _Finish. */
     strdup_check(command->nvPath, nvPath, r, error_cleanup);
@@ -184,6 +185,7 @@ Fapi_NvRead_Async(
 error_cleanup:
     /* Cleanup duplicated input parameters that were copied before. */
     SAFE_FREE(command->nvPath);
+    command->report_chunks = false;
     return r;
 }
 
@@ -332,6 +334,7 @@ error_cleanup:
     ifapi_cleanup_ifapi_object(context->loadKey.key_object);
     ifapi_cleanup_ifapi_object(&context->createPrimary.pkey_object);
     SAFE_FREE(command->nvPath);
+    command->report_chunks = false;
     //SAFE_FREE(context->nv_cmd.tes);
     ifapi_session_clean(context);
     LOG_TRACE("finished");
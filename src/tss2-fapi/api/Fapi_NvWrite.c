@@ -176,6 +176,7 @@ Fapi_NvWrite_Async(
     memset(&context->nv_cmd, 0, sizeof(IFAPI_NV_Cmds));
     command->offset = 0;
     command->data = NULL;
+    command->report_chunks = true;
 
 
     /* Copy parameters to context for use during _Finish. */
@@ -198,6 +199,7 @@ Fapi_NvWrite_Async(
 error_cleanup:
     /* Cleanup duplicated input parameters that were copied before. */
     SAFE_FREE(command->nvPath);
+    command->report_chunks = false;
     SAFE_FREE(command->data);
     return r;
 }
@@ -301,6 +303,7 @@ error_cleanup:
     ifapi_cleanup_ifapi_object(&context->createPrimary.pkey_object);
     SAFE_FREE(context->nv_cmd.write_data);
     SAFE_FREE(command->nvPath);
+    command->report_chunks = false;
     SAFE_FREE(command->data);
     SAFE_FREE(jso);
     ifapi_session_clean(context);
@@ -506,6 +506,7 @@ Fapi_Provision_Finish(FAPI_CONTEXT *context)
             nvCmd->numBytes = nvPublic->nvPublic.dataSize;
             nvCmd->esys_handle = command->esys_nv_cert_handle;
             nvCmd->offset = 0;
+            nvCmd->report_chunks = false;
             command->pem_cert = NULL;
             context->session1 = ESYS_TR_PASSWORD;
             context->session2 = ESYS_TR_NONE;
@@ -288,13 +288,12 @@ Fapi_VerifyQuote_Finish(
             /* If logData was provided then the pcr_digests need to be recalculated
                and verified against the quote_info. */
 
-            /* Parse the logData JSON. */
-            command->event_list = json_tokener_parse(context->cmd.pcr.logData);
-            return_if_null(command->event_list, "Json error.", TSS2_FAPI_RC_BAD_VALUE);
-
-            /* Recalculate and verify the PCR digests. */
-            r = ifapi_calculate_pcr_digest(command->event_list,
-                                           &command->fapi_quote_info, &pcr_digest);
+            /* Recalculate and verify the PCR digests. The events are parsed
+               from logData one at a time. Events already replayed by an
+               earlier verification of the same log are skipped. */
+            r = ifapi_calculate_pcr_digest(command->logData,
+                                           &command->fapi_quote_info, &pcr_digest,
+                                           &context->eventlog.replay);
 
             goto_if_error(r, "Verify event list.", error_cleanup);
 
@@ -308,8 +307,6 @@ error_cleanup:
     /* Cleanup any intermediate results and state stored in the context. */
     if (key_object.objectType)
         ifapi_cleanup_ifapi_object(&key_object);
-    if (command->event_list)
-        json_object_put(command->event_list);
     ifapi_cleanup_ifapi_object(&context->loadKey.auth_object);
     ifapi_cleanup_ifapi_object(context->loadKey.key_object);
     ifapi_cleanup_ifapi_object(&context->createPrimary.pkey_object);
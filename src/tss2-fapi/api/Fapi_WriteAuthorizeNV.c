@@ -271,6 +271,7 @@ Fapi_WriteAuthorizeNv_Finish(
             /* Store these data in the context to be used for re-entry on nv_write. */
             nvCmd->data = &nvBuffer[0];
             nvCmd->numBytes = command->hash_size + sizeof(TPMI_ALG_HASH);
+            nvCmd->report_chunks = false;
             fallthrough;
 
         statecase(context->state, WRITE_AUTHORIZE_NV_WRITE_NV_RAM)
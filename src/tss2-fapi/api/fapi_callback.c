@@ -178,3 +178,50 @@ Fapi_SetPolicyActionCB(
     LOG_TRACE("finished");
     return TSS2_RC_SUCCESS;
 }
+
+/**
+ * Fapi_SetNvChunkCB() registers an application-defined function as a callback
+ * that shall be called for every chunk transferred by Fapi_NvRead() and
+ * Fapi_NvWrite().
+ *
+ * NV data is transferred in chunks of at most TPM2_PT_NV_BUFFER_MAX bytes. The
+ * callback receives each chunk together with its offset in the NV index as
+ * soon as the TPM has processed it. If further chunks follow, the command for
+ * the next chunk has already been sent to the TPM when the callback is invoked,
+ * so the application can consume the data while the TPM is busy. An error
+ * returned by the callback aborts the NV operation with this error.
+ *
+ * @param[in,out] context The FAPI_CONTEXT
+ * @param[in] callback The callback function for transferred NV chunks
+ * @param[in] userData A pointer that is provided to all callback invocations
+ *
+ * @retval TSS2_RC_SUCCESS: if the function call was a success.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE: if the context is NULL.
+ * @retval TSS2_FAPI_RC_BAD_CONTEXT: if context corruption is detected.
+ * @retval TSS2_FAPI_RC_MEMORY: if the FAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE: if the synchronous or Async functions are
+ *         called while the context has another asynchronous operation
+ *         outstanding, or the Finish function is called while the context does
+ *         not have an appropriate asynchronous operation outstanding.
+ * @retval TSS2_FAPI_RC_IO_ERROR: if the data cannot be saved.
+ */
+TSS2_RC
+Fapi_SetNvChunkCB(
+    FAPI_CONTEXT                *context,
+    Fapi_CB_NvChunk              callback,
+    void                        *userData)
+{
+    LOG_TRACE("called for context:%p", context);
+    LOG_TRACE("Callback %p Userdata %p", callback, userData);
+
+    /* Check for NULL parameters */
+    check_not_null(context);
+
+    /* Store the callback and userdata pointer. */
+    context->callbacks.nvChunk = callback;
+    context->callbacks.nvChunkData = userData;
+
+    LOG_TRACE("finished");
+    return TSS2_RC_SUCCESS;
+}
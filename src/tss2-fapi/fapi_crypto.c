@@ -9,6 +9,7 @@
 #endif
 
 #include <string.h>
+#include <time.h>
 
 #include <openssl/evp.h>
 #include <openssl/aes.h>
@@ -23,6 +24,8 @@
 #include "fapi_util.h"
 #include "util/aux_util.h"
 #include "fapi_crypto.h"
+#include "ifapi_curl_cache.h"
+#include "ifapi_timing.h"
 #define LOGMODULE fapi
 #include "util/log.h"
 
@@ -1217,6 +1220,7 @@ ifapi_verify_signature_quote(
     BIO *bufio = NULL;
     EVP_PKEY_CTX *pctx = NULL;
     EVP_MD_CTX *mdctx = NULL;
+    uint64_t start = ifapi_timing_start();
 
     /* Check whether or not the key is valid */
     if (keyObject->objectType == IFAPI_KEY_OBJ) {
@@ -1288,6 +1292,7 @@ error_cleanup:
     SAFE_FREE(public_pem_key);
     EVP_PKEY_free(publicKey);
     BIO_free(bufio);
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
     return r;
 }
 
@@ -1327,6 +1332,7 @@ ifapi_verify_signature(
     int pem_size;
     EVP_PKEY *publicKey = NULL;
     BIO *bufio = NULL;
+    uint64_t start = ifapi_timing_start();
 
     /* Check whether or not the key is valid */
     if (keyObject->objectType == IFAPI_KEY_OBJ) {
@@ -1371,6 +1377,7 @@ error_cleanup:
     EVP_PKEY_free(publicKey);
     if (bufio)
         BIO_free(bufio);
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
     return r;
 }
 
@@ -1462,6 +1469,7 @@ ifapi_crypto_hash_start(IFAPI_CRYPTO_CONTEXT_BLOB **context,
     IFAPI_CRYPTO_CONTEXT *mycontext = NULL;
     mycontext = calloc(1, sizeof(IFAPI_CRYPTO_CONTEXT));
     return_if_null(mycontext, "Out of memory", TSS2_FAPI_RC_MEMORY);
+    uint64_t start = ifapi_timing_start();
 
     if (!(mycontext->osslHashAlgorithm = get_ossl_hash_md(hashAlgorithm))) {
         goto_error(r, TSS2_FAPI_RC_BAD_VALUE,
@@ -1488,12 +1496,14 @@ ifapi_crypto_hash_start(IFAPI_CRYPTO_CONTEXT_BLOB **context,
 
     *context = (IFAPI_CRYPTO_CONTEXT_BLOB *) mycontext;
 
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
     return TSS2_RC_SUCCESS;
 
 cleanup:
     if (mycontext->osslContext)
         EVP_MD_CTX_destroy(mycontext->osslContext);
     SAFE_FREE(mycontext);
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
 
     return r;
 }
@@ -1524,7 +1534,10 @@ ifapi_crypto_hash_update(IFAPI_CRYPTO_CONTEXT_BLOB *context,
     IFAPI_CRYPTO_CONTEXT *mycontext = (IFAPI_CRYPTO_CONTEXT *) context;
     LOGBLOB_DEBUG(buffer, size, "Updating hash with");
 
-    if (1 != EVP_DigestUpdate(mycontext->osslContext, buffer, size)) {
+    uint64_t start = ifapi_timing_start();
+    int updated = EVP_DigestUpdate(mycontext->osslContext, buffer, size);
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
+    if (1 != updated) {
         return_error(TSS2_FAPI_RC_GENERAL_FAILURE, "OSSL hash update");
     }
 
@@ -1556,8 +1569,11 @@ ifapi_crypto_hash_finish(IFAPI_CRYPTO_CONTEXT_BLOB **context,
               context, digest, digestSize);
     /* Compute the digest */
     IFAPI_CRYPTO_CONTEXT *mycontext = *context;
-    if (1 != EVP_DigestFinal_ex(mycontext->osslContext, digest,
-                                &computedDigestSize)) {
+    uint64_t start = ifapi_timing_start();
+    int finished = EVP_DigestFinal_ex(mycontext->osslContext, digest,
+                                      &computedDigestSize);
+    ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
+    if (1 != finished) {
         return_error(TSS2_FAPI_RC_GENERAL_FAILURE, "OSSL error.");
     }
 
@@ -1601,6 +1617,57 @@ ifapi_crypto_hash_abort(IFAPI_CRYPTO_CONTEXT_BLOB **context)
     *context = NULL;
 }
 
+/**
+ * Computes the digests of a batch of independent messages.
+ *
+ * For algorithms supported by the multi-buffer kernel of ESYS the messages
+ * are hashed in parallel SIMD lanes, otherwise one after the other.
+ *
+ * @param[in] hashAlgorithm The hash algorithm for all messages.
+ * @param[in,out] jobs The messages and the buffers for their digests.
+ * @param[in] n_jobs The number of entries in jobs.
+ *
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if jobs is NULL
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the hash algorithm is not supported
+ * @retval TSS2_FAPI_RC_MEMORY if memory cannot be allocated
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+TSS2_RC
+ifapi_crypto_hash_batch(
+    TPM2_ALG_ID hashAlgorithm,
+    IESYS_CRYPTO_MB_JOB *jobs,
+    size_t n_jobs)
+{
+    TSS2_RC r;
+    IFAPI_CRYPTO_CONTEXT_BLOB *cryptoContext;
+    size_t i;
+
+    return_if_null(jobs, "jobs is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
+
+    if (iesys_crypto_mb_supported(hashAlgorithm)) {
+        uint64_t start = ifapi_timing_start();
+        iesys_crypto_mb_hash(hashAlgorithm, jobs, n_jobs);
+        ifapi_timing_stop(IFAPI_TIMING_CRYPTO, start);
+        return TSS2_RC_SUCCESS;
+    }
+
+    for (i = 0; i < n_jobs; i++) {
+        r = ifapi_crypto_hash_start(&cryptoContext, hashAlgorithm);
+        return_if_error(r, "crypto hash start");
+
+        HASH_UPDATE_BUFFER(cryptoContext, jobs[i].buffer, jobs[i].size,
+                           r, error_cleanup);
+        r = ifapi_crypto_hash_finish(&cryptoContext, jobs[i].digest, NULL);
+        return_if_error(r, "crypto hash finish");
+    }
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    ifapi_crypto_hash_abort(&cryptoContext);
+    return r;
+}
+
 /**
  * Get url to download crl from certificate.
  * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
@@ -1619,6 +1686,8 @@ get_crl_from_cert(X509 *cert, X509_CRL **crl)
     int nid = NID_crl_distribution_points;
     STACK_OF(DIST_POINT) * dist_points = (STACK_OF(DIST_POINT) *)X509_get_ext_d2i(cert, nid, NULL, NULL);
     int curl_rc;
+    const ASN1_TIME *next_update;
+    int days, seconds;
 
     *crl = NULL;
     for (int i = 0; i < sk_DIST_POINT_num(dist_points); i++)
@@ -1652,6 +1721,16 @@ get_crl_from_cert(X509 *cert, X509_CRL **crl)
         goto_error(r, TSS2_FAPI_RC_BAD_VALUE, "Can't convert crl.", cleanup);
     }
 
+    /* A cached CRL must not be used after the issuer publishes the next one. */
+#if OPENSSL_VERSION_NUMBER < 0x10100000
+    next_update = X509_CRL_get_nextUpdate(*crl);
+#else
+    next_update = X509_CRL_get0_nextUpdate(*crl);
+#endif
+    if (next_update && ASN1_TIME_diff(&days, &seconds, NULL, next_update))
+        ifapi_curl_cache_expire((char *)url,
+                                time(NULL) + (time_t)days * 86400 + seconds);
+
 cleanup:
     SAFE_FREE(crl_buffer);
     CRL_DIST_POINTS_free(dist_points);
@@ -2145,3 +2224,304 @@ cleanup:
     }
     return r;
 }
+
+/** HMAC-SHA256 with the key of a random bit generator.
+ *
+ * The digest states after absorbing the padded key are kept, so each HMAC
+ * computation of the generator costs two copies of a digest context.
+ */
+typedef struct {
+    EVP_MD_CTX *inner;  /**< SHA-256 after absorbing key XOR ipad */
+    EVP_MD_CTX *outer;  /**< SHA-256 after absorbing key XOR opad */
+    EVP_MD_CTX *work;   /**< The context of the current computation */
+} IFAPI_DRBG_HMAC;
+
+static void
+drbg_hmac_free(IFAPI_DRBG_HMAC *hmac)
+{
+    if (hmac->inner)
+        EVP_MD_CTX_destroy(hmac->inner);
+    if (hmac->outer)
+        EVP_MD_CTX_destroy(hmac->outer);
+    if (hmac->work)
+        EVP_MD_CTX_destroy(hmac->work);
+}
+
+/**
+ * Allocates the digest contexts of an HMAC computation.
+ *
+ * @param[out] hmac The HMAC contexts.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_MEMORY if memory cannot be allocated.
+ */
+static TSS2_RC
+drbg_hmac_init(IFAPI_DRBG_HMAC *hmac)
+{
+    hmac->inner = EVP_MD_CTX_create();
+    hmac->outer = EVP_MD_CTX_create();
+    hmac->work = EVP_MD_CTX_create();
+    if (!hmac->inner || !hmac->outer || !hmac->work) {
+        drbg_hmac_free(hmac);
+        return_error(TSS2_FAPI_RC_MEMORY, "Out of memory");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/**
+ * Absorbs the padded HMAC key into the inner and outer digest contexts.
+ *
+ * @param[in,out] hmac The HMAC contexts.
+ * @param[in] key The key of IFAPI_DRBG_OUTLEN bytes.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+static TSS2_RC
+drbg_hmac_key(IFAPI_DRBG_HMAC *hmac, const uint8_t *key)
+{
+    uint8_t ipad[64], opad[64];
+    size_t i;
+    int ok;
+
+    memset(&ipad[0], 0x36, sizeof(ipad));
+    memset(&opad[0], 0x5c, sizeof(opad));
+    for (i = 0; i < IFAPI_DRBG_OUTLEN; i++) {
+        ipad[i] ^= key[i];
+        opad[i] ^= key[i];
+    }
+    ok = EVP_DigestInit_ex(hmac->inner, EVP_sha256(), get_engine()) &&
+        EVP_DigestUpdate(hmac->inner, &ipad[0], sizeof(ipad)) &&
+        EVP_DigestInit_ex(hmac->outer, EVP_sha256(), get_engine()) &&
+        EVP_DigestUpdate(hmac->outer, &opad[0], sizeof(opad));
+    OPENSSL_cleanse(&ipad[0], sizeof(ipad));
+    OPENSSL_cleanse(&opad[0], sizeof(opad));
+    if (!ok) {
+        return_error(TSS2_FAPI_RC_GENERAL_FAILURE, "OSSL HMAC key");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/**
+ * Computes HMAC(K, V || separator || data) with the key set by drbg_hmac_key.
+ *
+ * @param[in,out] hmac The HMAC contexts.
+ * @param[in] v The value V of IFAPI_DRBG_OUTLEN bytes.
+ * @param[in] separator The separator byte or -1 if no separator is used.
+ * @param[in] data The provided data (may be NULL if size is 0).
+ * @param[in] size The size of data.
+ * @param[out] out The HMAC of IFAPI_DRBG_OUTLEN bytes. May be v.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+static TSS2_RC
+drbg_hmac(IFAPI_DRBG_HMAC *hmac, const uint8_t *v, int separator,
+          const uint8_t *data, size_t size, uint8_t *out)
+{
+    uint8_t digest[IFAPI_DRBG_OUTLEN];
+    uint8_t sep = (uint8_t) separator;
+    unsigned int digest_size;
+
+    if (!EVP_MD_CTX_copy_ex(hmac->work, hmac->inner) ||
+        !EVP_DigestUpdate(hmac->work, v, IFAPI_DRBG_OUTLEN) ||
+        (separator >= 0 && !EVP_DigestUpdate(hmac->work, &sep, 1)) ||
+        (size > 0 && !EVP_DigestUpdate(hmac->work, data, size)) ||
+        !EVP_DigestFinal_ex(hmac->work, &digest[0], &digest_size) ||
+        !EVP_MD_CTX_copy_ex(hmac->work, hmac->outer) ||
+        !EVP_DigestUpdate(hmac->work, &digest[0], sizeof(digest)) ||
+        !EVP_DigestFinal_ex(hmac->work, out, &digest_size)) {
+        return_error(TSS2_FAPI_RC_GENERAL_FAILURE, "OSSL HMAC");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/**
+ * The HMAC_DRBG_Update function of NIST SP 800-90A. Afterwards the HMAC
+ * contexts are keyed with the new key.
+ *
+ * @param[in,out] drbg The random bit generator.
+ * @param[in,out] hmac The HMAC contexts.
+ * @param[in] data The provided data (may be NULL if size is 0).
+ * @param[in] size The size of data.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+static TSS2_RC
+drbg_update(IFAPI_DRBG *drbg, IFAPI_DRBG_HMAC *hmac, const uint8_t *data,
+            size_t size)
+{
+    TSS2_RC r;
+    int separator;
+
+    for (separator = 0; separator <= 1; separator++) {
+        r = drbg_hmac_key(hmac, &drbg->key[0]);
+        return_if_error(r, "HMAC key");
+        r = drbg_hmac(hmac, &drbg->v[0], separator, data, size, &drbg->key[0]);
+        return_if_error(r, "HMAC");
+        r = drbg_hmac_key(hmac, &drbg->key[0]);
+        return_if_error(r, "HMAC key");
+        r = drbg_hmac(hmac, &drbg->v[0], -1, NULL, 0, &drbg->v[0]);
+        return_if_error(r, "HMAC");
+        if (size == 0)
+            break;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static uint64_t
+drbg_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+/**
+ * Instantiates or reseeds the local random bit generator of Fapi_GetRandom.
+ *
+ * The generator is HMAC_DRBG with SHA-256 according to NIST SP 800-90A. The
+ * seed is used as entropy input; for the instantiation its last bytes serve
+ * as nonce.
+ *
+ * @param[in,out] drbg The random bit generator.
+ * @param[in] seed The seed, usually IFAPI_DRBG_SEED_SIZE bytes from the TPM.
+ * @param[in] seedSize The size of the seed.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if drbg or seed is NULL.
+ * @retval TSS2_FAPI_RC_MEMORY if memory cannot be allocated.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+TSS2_RC
+ifapi_drbg_seed(IFAPI_DRBG *drbg, const uint8_t *seed, size_t seedSize)
+{
+    TSS2_RC r;
+    IFAPI_DRBG_HMAC hmac;
+
+    /* Check for NULL parameters */
+    return_if_null(drbg, "drbg is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
+    return_if_null(seed, "seed is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
+
+    r = drbg_hmac_init(&hmac);
+    return_if_error(r, "HMAC init");
+
+    if (!drbg->seeded) {
+        memset(&drbg->key[0], 0x00, sizeof(drbg->key));
+        memset(&drbg->v[0], 0x01, sizeof(drbg->v));
+    }
+    r = drbg_update(drbg, &hmac, seed, seedSize);
+    drbg_hmac_free(&hmac);
+    if (r != TSS2_RC_SUCCESS) {
+        ifapi_drbg_cleanup(drbg);
+        return_error(r, "Seed random bit generator");
+    }
+
+    drbg->seeded = true;
+    drbg->bytes = 0;
+    drbg->seed_time = drbg_time();
+    drbg->pid = getpid();
+    return TSS2_RC_SUCCESS;
+}
+
+/**
+ * Returns the number of bytes the local random bit generator may produce
+ * before it has to be reseeded from the TPM.
+ *
+ * A generator that was never seeded, that was seeded by another process
+ * (i.e. before a fork), or whose seed is older than the reseed interval has
+ * to be reseeded before it is used.
+ *
+ * @param[in] drbg The random bit generator.
+ * @param[in] reseedBytes The number of bytes generated from one seed.
+ * @param[in] reseedInterval The maximal age of a seed in seconds, 0 for
+ *            no limit.
+ *
+ * @retval The number of bytes that may be generated.
+ */
+size_t
+ifapi_drbg_available(const IFAPI_DRBG *drbg, UINT32 reseedBytes,
+                     UINT32 reseedInterval)
+{
+    if (!drbg->seeded || drbg->pid != getpid() || drbg->bytes >= reseedBytes)
+        return 0;
+    if (reseedInterval && drbg_time() - drbg->seed_time >= reseedInterval)
+        return 0;
+    return reseedBytes - drbg->bytes;
+}
+
+/**
+ * Produces random bytes with the local random bit generator.
+ *
+ * Requests larger than IFAPI_DRBG_MAX_REQUEST bytes are served by several
+ * generate operations. The caller checks with ifapi_drbg_available whether
+ * the generator has to be reseeded.
+ *
+ * @param[in,out] drbg The random bit generator.
+ * @param[out] data The buffer for the random bytes.
+ * @param[in] size The number of bytes to produce.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if drbg or data is NULL.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE if the generator was not seeded.
+ * @retval TSS2_FAPI_RC_MEMORY if memory cannot be allocated.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ */
+TSS2_RC
+ifapi_drbg_generate(IFAPI_DRBG *drbg, uint8_t *data, size_t size)
+{
+    TSS2_RC r;
+    IFAPI_DRBG_HMAC hmac;
+    size_t request, i;
+
+    /* Check for NULL parameters */
+    return_if_null(drbg, "drbg is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
+    return_if_null(data, "data is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
+
+    if (!drbg->seeded) {
+        return_error(TSS2_FAPI_RC_BAD_SEQUENCE, "Random bit generator not seeded");
+    }
+
+    r = drbg_hmac_init(&hmac);
+    return_if_error(r, "HMAC init");
+
+    r = drbg_hmac_key(&hmac, &drbg->key[0]);
+    goto_if_error(r, "HMAC key", cleanup);
+
+    while (size > 0) {
+        request = size > IFAPI_DRBG_MAX_REQUEST ? IFAPI_DRBG_MAX_REQUEST : size;
+        for (i = 0; i < request; i += IFAPI_DRBG_OUTLEN) {
+            r = drbg_hmac(&hmac, &drbg->v[0], -1, NULL, 0, &drbg->v[0]);
+            goto_if_error(r, "HMAC", cleanup);
+            memcpy(&data[i], &drbg->v[0],
+                   request - i < IFAPI_DRBG_OUTLEN ? request - i : IFAPI_DRBG_OUTLEN);
+        }
+        /* Backtracking resistance: derive a new key after each request. */
+        r = drbg_update(drbg, &hmac, NULL, 0);
+        goto_if_error(r, "Update random bit generator", cleanup);
+
+        drbg->bytes += request;
+        data += request;
+        size -= request;
+    }
+
+cleanup:
+    drbg_hmac_free(&hmac);
+    if (r != TSS2_RC_SUCCESS)
+        ifapi_drbg_cleanup(drbg);
+    return r;
+}
+
+/**
+ * Erases the state of the local random bit generator.
+ *
+ * @param[in,out] drbg The random bit generator.
+ */
+void
+ifapi_drbg_cleanup(IFAPI_DRBG *drbg)
+{
+    if (drbg)
+        OPENSSL_cleanse(drbg, sizeof(*drbg));
+}
@@ -7,6 +7,7 @@
 #define FAPI_CRYPTO_H
 
 #include "fapi_int.h"
+#include "tss2-esys/esys_crypto_mb.h"
 
 TSS2_RC
 ifapi_get_profile_sig_scheme(
@@ -75,6 +76,12 @@ void
 ifapi_crypto_hash_abort(
     IFAPI_CRYPTO_CONTEXT_BLOB   **context);
 
+TSS2_RC
+ifapi_crypto_hash_batch(
+    TPM2_ALG_ID                 hashAlgorithm,
+    IESYS_CRYPTO_MB_JOB         *jobs,
+    size_t                      n_jobs);
+
 TSS2_RC
 ifapi_cert_to_pem(
     const uint8_t               *certBuffer,
@@ -123,4 +130,26 @@ ifapi_get_tpm_key_fingerprint(
     TPMI_ALG_HASH hashAlg,
     TPM2B_DIGEST *fingerprint);
 
+TSS2_RC
+ifapi_drbg_seed(
+    IFAPI_DRBG                  *drbg,
+    const uint8_t               *seed,
+    size_t                      seedSize);
+
+size_t
+ifapi_drbg_available(
+    const IFAPI_DRBG            *drbg,
+    UINT32                      reseedBytes,
+    UINT32                      reseedInterval);
+
+TSS2_RC
+ifapi_drbg_generate(
+    IFAPI_DRBG                  *drbg,
+    uint8_t                     *data,
+    size_t                      size);
+
+void
+ifapi_drbg_cleanup(
+    IFAPI_DRBG                  *drbg);
+
 #endif /* FAPI_CRYPTO_H */
@@ -227,12 +227,19 @@ typedef struct {
     IFAPI_EVENT pcr_event;       /**< Event to be added to log */
     TPML_DIGEST_VALUES digests;  /**< Digest for the event data of an extend */
     bool skip_policy_computation; /**< switch whether policy needs to be computed */
+    bool report_chunks;          /**< Pass transferred chunks to the NV chunk callback */
+    size_t chunk_idx;            /**< Offset of the chunk not yet reported */
+    size_t chunk_size;           /**< Size of the chunk not yet reported */
+    TSS2_RC chunk_rc;            /**< Error of the NV chunk callback */
 } IFAPI_NV_Cmds;
 
 /** The data structure holding internal state of Fapi_Initialize command.
  */
 typedef struct {
     TPMS_CAPABILITY_DATA *capability; /* TPM capability data to check available algs */
+    const char *snapshot_file;    /* The snapshot to use, NULL if disabled */
+    bool snapshot_loaded;         /* Config and profiles were taken from the snapshot */
+    UINT32 snapshot_nv_buffer_max; /* NV_BUFFER_MAX from the snapshot, 0 if unknown */
 } IFAPI_INITIALIZE;
 
 /** The data structure holding internal state of Fapi_PCR commands.
@@ -268,7 +275,6 @@ typedef struct {
     char const *logData;
     char *pcrLog;
     IFAPI_EVENT pcr_event;
-    json_object *event_list;
     FAPI_QUOTE_INFO fapi_quote_info;
 } IFAPI_PCR;
 
@@ -283,6 +289,28 @@ typedef struct {
     char *jso_string;              /**< JSON deserialized buffer */
 } IFAPI_Path_SetDescription;
 
+/** The output length of the local random bit generator (SHA-256). */
+#define IFAPI_DRBG_OUTLEN 32
+/** The size of the seeds requested from the TPM (entropy input and nonce). */
+#define IFAPI_DRBG_SEED_SIZE 48
+/** The maximal number of bytes produced by one generate operation. */
+#define IFAPI_DRBG_MAX_REQUEST 65536
+
+/** The state of the local random bit generator of Fapi_GetRandom.
+ *
+ * HMAC_DRBG with SHA-256 according to NIST SP 800-90A. The generator is
+ * seeded from the TPM and only used if the "random_source" of the
+ * configuration is "drbg".
+ */
+typedef struct {
+    uint8_t key[IFAPI_DRBG_OUTLEN];  /**< The HMAC key K */
+    uint8_t v[IFAPI_DRBG_OUTLEN];    /**< The chaining value V */
+    bool seeded;                     /**< Whether the generator was instantiated */
+    uint64_t bytes;                  /**< Bytes generated since the last seeding */
+    uint64_t seed_time;              /**< Monotonic time of the last seeding (s) */
+    pid_t pid;                       /**< The process which seeded the generator */
+} IFAPI_DRBG;
+
 /** The data structure holding internal state of Fapi_GetRandom.
  */
 typedef struct {
@@ -290,6 +318,8 @@ typedef struct {
     size_t idx;                   /**< Current position in output buffer.  */
     UINT16 bytesRequested;        /**< Byted currently requested from TPM */
     uint8_t *data;                /**< The buffer for the random data */
+    uint8_t seed[IFAPI_DRBG_SEED_SIZE]; /**< The seed received from the TPM */
+    size_t seed_idx;              /**< Number of seed bytes received */
 } IFAPI_GetRandom;
 
 /** The data structure holding internal state of Fapi_Key_Setcertificate.
@@ -710,7 +740,9 @@ enum _FAPI_STATE_SESSION {
 /** The states for the FAPI's get random  state */
 enum _FAPI_STATE_GET_RANDOM {
     GET_RANDOM_INIT = 0,
-    GET_RANDOM_SENT
+    GET_RANDOM_SENT,
+    GET_RANDOM_DRBG_GENERATE,
+    GET_RANDOM_DRBG_SEED_SENT
 };
 
 /** The states for flushing objects */
@@ -727,6 +759,7 @@ enum _FAPI_STATE {
     _FAPI_STATE_INTERNALERROR,     /**< A non-recoverable error occurred within the
                                       ESAPI code. */
     INITIALIZE_READ,
+    INITIALIZE_INIT_MODULES,
     INITIALIZE_INIT_TCTI,
     INITIALIZE_GET_CAP,
     INITIALIZE_WAIT_FOR_CAP,
@@ -999,6 +1032,8 @@ struct IFAPI_CALLBACKS {
     void *signData;
     Fapi_CB_PolicyAction action;
     void *actionData;
+    Fapi_CB_NvChunk nvChunk;
+    void *nvChunkData;
 };
 
 /** The data structure holding internal state information.
@@ -1032,6 +1067,7 @@ struct FAPI_CONTEXT {
                                           command */
     IFAPI_NV_Cmds nv_cmd;
     IFAPI_GetRandom get_random;
+    IFAPI_DRBG drbg;                 /**< The local random bit generator */
     IFAPI_CreatePrimary createPrimary;
     IFAPI_LoadKey loadKey;
     ESYS_TR session1;                /**< The first session used by FAPI  */
@@ -1913,6 +1913,39 @@ error:
     return r;
 }
 
+/** Pass the chunk recorded in nv_cmd to the NV chunk callback.
+ *
+ * Only the chunks of Fapi_NvRead and Fapi_NvWrite are reported. The chunk is
+ * reported at most once.
+ *
+ * @param[in,out] context for storing all state information.
+ * @param[in] buffer The buffer holding the complete NV data.
+ *
+ * @retval TSS2_RC_SUCCESS if no callback is registered or the callback
+ *         succeeded.
+ * @retval TSS2_FAPI_RC_* the error returned by the callback.
+ */
+static TSS2_RC
+ifapi_nv_report_chunk(
+    FAPI_CONTEXT  *context,
+    uint8_t const *buffer)
+{
+    TSS2_RC r;
+    IFAPI_NV_Cmds *nv_cmd = &context->nv_cmd;
+
+    if (!nv_cmd->report_chunks || !context->callbacks.nvChunk ||
+        nv_cmd->chunk_size == 0)
+        return TSS2_RC_SUCCESS;
+
+    r = context->callbacks.nvChunk(nv_cmd->nvPath, nv_cmd->chunk_idx,
+                                   &buffer[nv_cmd->chunk_idx], nv_cmd->chunk_size,
+                                   context->callbacks.nvChunkData);
+    nv_cmd->chunk_size = 0;
+    return_if_error(r, "NV chunk callback");
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** State machine to write data to the NV ram of the TPM.
  *
  * The NV object will be read from object store and the data will be
@@ -1983,6 +2016,8 @@ ifapi_nv_write(
         else
             aux_data->size = context->nv_cmd.numBytes;
         context->nv_cmd.data_idx = 0;
+        context->nv_cmd.chunk_size = 0;
+        context->nv_cmd.chunk_rc = TSS2_RC_SUCCESS;
 
         /* Use calloc to ensure zero padding for write buffer. */
         context->nv_cmd.write_data = calloc(size, 1);
@@ -2099,7 +2134,13 @@ ifapi_nv_write(
         }
         goto_if_error_reset_state(r, "FAPI NV_Write_Finish", error_cleanup);
 
+        /* The callback failed while this chunk was written. */
+        r = context->nv_cmd.chunk_rc;
+        goto_if_error_reset_state(r, "NV chunk callback", error_cleanup);
+
         context->nv_cmd.numBytes -= context->nv_cmd.bytesRequested;
+        context->nv_cmd.chunk_idx = context->nv_cmd.data_idx;
+        context->nv_cmd.chunk_size = context->nv_cmd.bytesRequested;
 
         if (context->nv_cmd.numBytes > 0) {
             /* Increment data idx with number of transmitted bytes. */
@@ -2129,9 +2170,16 @@ ifapi_nv_write(
 
             context->nv_cmd.bytesRequested = aux_data->size;
             context->nv_cmd.nv_write_state = NV2_WRITE_AUTH_SENT;
+
+            /* Report the written chunk while the TPM processes the next one.
+               An error is returned after the pending command is finished. */
+            context->nv_cmd.chunk_rc =
+                ifapi_nv_report_chunk(context, context->nv_cmd.write_data);
             return TSS2_FAPI_RC_TRY_AGAIN;
 
         }
+        r = ifapi_nv_report_chunk(context, context->nv_cmd.write_data);
+        goto_if_error_reset_state(r, "NV chunk callback", error_cleanup);
         fallthrough;
 
     statecase(context->nv_cmd.nv_write_state, NV2_WRITE_WRITE_PREPARE);
@@ -2222,6 +2270,8 @@ ifapi_nv_read(
     statecase(context->nv_cmd.nv_read_state, NV_READ_INIT);
         LOG_TRACE("NV_READ_INIT");
         context->nv_cmd.rdata = NULL;
+        context->nv_cmd.chunk_size = 0;
+        context->nv_cmd.chunk_rc = TSS2_RC_SUCCESS;
         fallthrough;
 
     statecase(context->nv_cmd.nv_read_state, NV_READ_AUTHORIZE);
@@ -2267,12 +2317,21 @@ ifapi_nv_read(
 
         goto_if_error_reset_state(r, "FAPI NV_Read_Finish", error_cleanup);
 
+        if (context->nv_cmd.chunk_rc != TSS2_RC_SUCCESS) {
+            /* The callback failed while this chunk was read. */
+            free(aux_data);
+            r = context->nv_cmd.chunk_rc;
+            goto_if_error_reset_state(r, "NV chunk callback", error_cleanup);
+        }
+
         if (aux_data->size < bytesRequested)
             *numBytes = 0;
         else
             *numBytes -= aux_data->size;
         memcpy(*data + context->nv_cmd.data_idx, &aux_data->buffer[0],
                aux_data->size);
+        context->nv_cmd.chunk_idx = context->nv_cmd.data_idx;
+        context->nv_cmd.chunk_size = aux_data->size;
         context->nv_cmd.data_idx += aux_data->size;
         free(aux_data);
         if (*numBytes > 0) {
@@ -2298,8 +2357,16 @@ ifapi_nv_read(
             goto_if_error_reset_state(r, "FAPI NV_Read", error_cleanup);
             context->nv_cmd.bytesRequested = aux_size;
             context->nv_cmd.nv_read_state = NV_READ_AUTH_SENT;
+
+            /* Deliver the received chunk while the TPM reads the next one.
+               An error is returned after the pending command is finished. */
+            context->nv_cmd.chunk_rc =
+                ifapi_nv_report_chunk(context, context->nv_cmd.rdata);
             return TSS2_FAPI_RC_TRY_AGAIN;
         } else {
+            r = ifapi_nv_report_chunk(context, context->nv_cmd.rdata);
+            goto_if_error_reset_state(r, "NV chunk callback", error_cleanup);
+
             *size = context->nv_cmd.data_idx;
             context->nv_cmd.nv_read_state = NV_READ_INIT;
             LOG_DEBUG("success");
@@ -2315,10 +2382,106 @@ error_cleanup:
 
 #define min(X,Y) (X>Y)?Y:X
 
+/** State machine to produce random data with the local random bit generator.
+ *
+ * The generator is reseeded with IFAPI_DRBG_SEED_SIZE bytes from the TPM
+ * whenever its byte or time budget is exhausted, also in the middle of a
+ * request.
+ *
+ * @param[in,out] context for storing all state information.
+ *
+ * @retval TSS2_RC_SUCCESS If random data can be computed.
+ * @retval TSS2_ESYS_RC_* possible error codes of ESAPI.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the TPM returned too many bytes.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
+ * @retval TSS2_FAPI_RC_TRY_AGAIN if an I/O operation is not finished yet and
+ *         this function needs to be called again.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE if the context has an asynchronous
+ *         operation already pending.
+ */
+static TSS2_RC
+ifapi_get_random_drbg(FAPI_CONTEXT *context)
+{
+    TSS2_RC r;
+    TPM2B_DIGEST *aux_data = NULL;
+    IFAPI_GetRandom *command = &context->get_random;
+    size_t available;
+
+    switch (context->get_random_state) {
+    statecase(context->get_random_state, GET_RANDOM_DRBG_SEED_SENT);
+        r = Esys_GetRandom_Finish(context->esys, &aux_data);
+        return_try_again(r);
+        return_if_error(r, "FAPI GetRandom_Finish");
+
+        if (aux_data->size > IFAPI_DRBG_SEED_SIZE - command->seed_idx) {
+            Esys_Free(aux_data);
+            return_error(TSS2_FAPI_RC_BAD_VALUE, "TPM returned too many bytes");
+        }
+        memcpy(&command->seed[command->seed_idx], &aux_data->buffer[0],
+               aux_data->size);
+        command->seed_idx += aux_data->size;
+        Esys_Free(aux_data);
+
+        if (command->seed_idx < IFAPI_DRBG_SEED_SIZE) {
+            /* The TPM may return less bytes than requested. */
+            r = Esys_GetRandom_Async(context->esys, context->session1,
+                                     ESYS_TR_NONE, ESYS_TR_NONE,
+                                     IFAPI_DRBG_SEED_SIZE - command->seed_idx);
+            return_if_error(r, "FAPI GetRandom");
+
+            return TSS2_FAPI_RC_TRY_AGAIN;
+        }
+
+        r = ifapi_drbg_seed(&context->drbg, &command->seed[0],
+                            IFAPI_DRBG_SEED_SIZE);
+        memset(&command->seed[0], 0, sizeof(command->seed));
+        return_if_error(r, "Seed random bit generator");
+        fallthrough;
+
+    statecase(context->get_random_state, GET_RANDOM_DRBG_GENERATE);
+        while (command->numBytes > 0) {
+            available = ifapi_drbg_available(&context->drbg,
+                                             context->config.drbg_reseed_bytes,
+                                             context->config.drbg_reseed_interval);
+            if (available == 0) {
+                /* Fetch a new seed through the encrypted session. */
+                command->seed_idx = 0;
+                r = Esys_GetRandom_Async(context->esys, context->session1,
+                                         ESYS_TR_NONE, ESYS_TR_NONE,
+                                         IFAPI_DRBG_SEED_SIZE);
+                return_if_error(r, "FAPI GetRandom");
+
+                context->get_random_state = GET_RANDOM_DRBG_SEED_SENT;
+                return TSS2_FAPI_RC_TRY_AGAIN;
+            }
+
+            available = min(available, command->numBytes);
+            r = ifapi_drbg_generate(&context->drbg, command->data + command->idx,
+                                    available);
+            return_if_error(r, "Generate random data");
+
+            command->numBytes -= available;
+            command->idx += available;
+        }
+        break;
+
+    statecasedefault(context->get_random_state);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** State machine to retrieve random data from TPM.
  *
  * If the buffer size exceeds the maximum size, several ESAPI calls are made.
  *
+ * If the configured random source is "drbg", the data is produced by a local
+ * HMAC_DRBG (NIST SP 800-90A) which is seeded from the TPM and reseeded after
+ * drbg_reseed_bytes bytes or drbg_reseed_interval seconds. Only the seeds are
+ * transferred from the TPM; the returned bytes are as unpredictable as the
+ * seeds, but the generator state is kept in the memory of the process.
+ *
  * @param[in,out] context for storing all state information.
  * @param[in] numBytes Number of random bytes to be computed.
  * @param[out] data The random data.
@@ -2347,6 +2510,14 @@ ifapi_get_random(FAPI_CONTEXT *context, size_t numBytes, uint8_t **data)
         return_if_null(context->get_random.data, "FAPI out of memory.",
                        TSS2_FAPI_RC_MEMORY);
 
+        if (context->config.random_source == IFAPI_RANDOM_SOURCE_DRBG) {
+            context->get_random_state = GET_RANDOM_DRBG_GENERATE;
+            r = ifapi_get_random_drbg(context);
+            return_try_again(r);
+            goto_if_error_reset_state(r, "FAPI GetRandom", error_cleanup);
+            break;
+        }
+
         /* Prepare the creation of random data. */
         r = Esys_GetRandom_Async(context->esys,
                                  context->session1,
@@ -2383,6 +2554,13 @@ ifapi_get_random(FAPI_CONTEXT *context, size_t numBytes, uint8_t **data)
         }
         break;
 
+    case GET_RANDOM_DRBG_GENERATE:
+    case GET_RANDOM_DRBG_SEED_SENT:
+        r = ifapi_get_random_drbg(context);
+        return_try_again(r);
+        goto_if_error_reset_state(r, "FAPI GetRandom", error_cleanup);
+        break;
+
     statecasedefault(context->get_random_state);
     }
 
@@ -3842,7 +4020,9 @@ ifapi_get_certificates(
         /* TPMA_NV_NO_DA is set for NV certificate */
         context->nv_cmd.nv_object.misc.nv.public.nvPublic.attributes = TPMA_NV_NO_DA;
 
-        /* Prepare context for nv read */
+        /* Prepare context for nv read; certificates are not reported to
+           the NV chunk callback. */
+        context->nv_cmd.report_chunks = false;
         context->nv_cmd.data_idx = 0;
         context->nv_cmd.auth_index = ESYS_TR_RH_OWNER;
         context->nv_cmd.numBytes = nvPublic->nvPublic.dataSize;
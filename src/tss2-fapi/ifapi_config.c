@@ -126,10 +126,80 @@ ifapi_json_IFAPI_CONFIG_deserialize(json_object *jso, IFAPI_CONFIG *out)
         return_if_error(r, "BAD VALUE");
     }
 
+    if (!ifapi_get_sub_object(jso, "keystore_format", &jso2)) {
+        out->keystore_format = IFAPI_KEYSTORE_FORMAT_JSON;
+    } else if (strcasecmp(json_object_get_string(jso2), "json") == 0) {
+        out->keystore_format = IFAPI_KEYSTORE_FORMAT_JSON;
+    } else if (strcasecmp(json_object_get_string(jso2), "binary") == 0) {
+        out->keystore_format = IFAPI_KEYSTORE_FORMAT_BINARY;
+    } else {
+        LOG_ERROR("Invalid keystore format %s", json_object_get_string(jso2));
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    if (!ifapi_get_sub_object(jso, "replay_threads", &jso2)) {
+        out->replay_threads = 1;
+    } else {
+        r = ifapi_json_UINT32_deserialize(jso2, &out->replay_threads);
+        return_if_error(r, "BAD VALUE");
+        if (out->replay_threads == 0 ||
+            out->replay_threads > IFAPI_EVENTLOG_MAX_REPLAY_THREADS) {
+            LOG_ERROR("Number of replay threads %"PRIu32" not in 1..%i",
+                      out->replay_threads, IFAPI_EVENTLOG_MAX_REPLAY_THREADS);
+            return TSS2_FAPI_RC_BAD_VALUE;
+        }
+    }
+
+    if (!ifapi_get_sub_object(jso, "random_source", &jso2)) {
+        out->random_source = IFAPI_RANDOM_SOURCE_TPM;
+    } else if (strcasecmp(json_object_get_string(jso2), "tpm") == 0) {
+        out->random_source = IFAPI_RANDOM_SOURCE_TPM;
+    } else if (strcasecmp(json_object_get_string(jso2), "drbg") == 0) {
+        out->random_source = IFAPI_RANDOM_SOURCE_DRBG;
+    } else {
+        LOG_ERROR("Invalid random source %s", json_object_get_string(jso2));
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    if (!ifapi_get_sub_object(jso, "drbg_reseed_bytes", &jso2)) {
+        out->drbg_reseed_bytes = IFAPI_DRBG_RESEED_BYTES;
+    } else {
+        r = ifapi_json_UINT32_deserialize(jso2, &out->drbg_reseed_bytes);
+        return_if_error(r, "BAD VALUE");
+        if (out->drbg_reseed_bytes == 0) {
+            LOG_ERROR("drbg_reseed_bytes must not be 0");
+            return TSS2_FAPI_RC_BAD_VALUE;
+        }
+    }
+
+    if (!ifapi_get_sub_object(jso, "drbg_reseed_interval", &jso2)) {
+        out->drbg_reseed_interval = IFAPI_DRBG_RESEED_INTERVAL;
+    } else {
+        r = ifapi_json_UINT32_deserialize(jso2, &out->drbg_reseed_interval);
+        return_if_error(r, "BAD VALUE");
+    }
+
     LOG_TRACE("true");
     return TSS2_RC_SUCCESS;
 }
 
+/**
+ * Returns the path of the configuration file.
+ *
+ * @retval The file given by the environment variable TSS2_FAPICONF or the
+ *         default configuration file.
+ */
+const char *
+ifapi_config_get_file(void)
+{
+    const char *configFile = getenv(ENV_FAPI_CONFIG);
+    if (!configFile) {
+        /* No config file given, falling back to the default */
+        configFile = DEFAULT_CONFIG_FILE;
+    }
+    return configFile;
+}
+
 /**
  * Starts the initialization of the FAPI configuration.
  *
@@ -148,11 +218,7 @@ ifapi_config_initialize_async(IFAPI_IO *io)
     return_if_null(io, "io is NULL", TSS2_FAPI_RC_BAD_REFERENCE);
 
     /* Determine the location of the configuration file */
-    const char *configFile = getenv(ENV_FAPI_CONFIG);
-    if (!configFile) {
-        /* No config file given, falling back to the default */
-        configFile = DEFAULT_CONFIG_FILE;
-    }
+    const char *configFile = ifapi_config_get_file();
 
     /* Start reading the config file */
     TSS2_RC r = ifapi_io_read_async(io, configFile);
@@ -246,6 +312,12 @@ ifapi_config_initialize_finish(IFAPI_IO *io, IFAPI_CONFIG *config)
     LOG_DEBUG("Configuration profile name: %s", config->profile_name);
     LOG_DEBUG("Configuration TCTI: %s", config->tcti);
     LOG_DEBUG("Configuration log directory: %s", config->log_dir);
+    LOG_DEBUG("Configuration keystore format: %s",
+              config->keystore_format == IFAPI_KEYSTORE_FORMAT_BINARY ?
+              "binary" : "json");
+    LOG_DEBUG("Configuration replay threads: %"PRIu32, config->replay_threads);
+    LOG_DEBUG("Configuration random source: %s",
+              config->random_source == IFAPI_RANDOM_SOURCE_DRBG ? "drbg" : "tpm");
 cleanup:
     SAFE_FREE(configFileContent);
     if (jso != NULL) {
@@ -11,9 +11,20 @@
 #include <string.h>
 #include "tss2_tpm2_types.h"
 #include "ifapi_io.h"
+#include "ifapi_keystore.h"
+#include "ifapi_eventlog.h"
 
 #define ENV_FAPI_CONFIG "TSS2_FAPICONF"
 
+/** The source of the random bytes returned by Fapi_GetRandom */
+typedef enum {
+    IFAPI_RANDOM_SOURCE_TPM = 0,  /**< Every byte is produced by the TPM */
+    IFAPI_RANDOM_SOURCE_DRBG      /**< A local DRBG is seeded from the TPM */
+} IFAPI_RANDOM_SOURCE;
+
+#define IFAPI_DRBG_RESEED_BYTES 1048576
+#define IFAPI_DRBG_RESEED_INTERVAL 60
+
 /**
  * Type for storing FAPI configuration
  */
@@ -40,9 +51,22 @@ typedef struct {
     TPMI_YES_NO         ek_cert_less;
     /** Certificate service for Intel TPMs */
     char                *intel_cert_service;
+    /** The format new keystore objects are written in */
+    IFAPI_KEYSTORE_FORMAT keystore_format;
+    /** The number of threads replaying event logs in quote verification */
+    UINT32               replay_threads;
+    /** The source of the random bytes of Fapi_GetRandom */
+    IFAPI_RANDOM_SOURCE  random_source;
+    /** The number of bytes the DRBG produces from one TPM seed */
+    UINT32               drbg_reseed_bytes;
+    /** The maximal age of a DRBG seed in seconds, 0 for no limit */
+    UINT32               drbg_reseed_interval;
 
 } IFAPI_CONFIG;
 
+const char *
+ifapi_config_get_file(void);
+
 TSS2_RC
 ifapi_config_initialize_async(
     IFAPI_IO            *io
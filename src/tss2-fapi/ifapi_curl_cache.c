@@ -0,0 +1,907 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <curl/curl.h>
+#include <openssl/evp.h>
+
+#include "ifapi_curl_cache.h"
+#include "ifapi_helpers.h"
+#define LOGMODULE fapi
+#include "util/log.h"
+#include "util/aux_util.h"
+#include "ifapi_macros.h"
+
+/*
+ * Certificates and CRLs downloaded for the EK certificate verification can be
+ * kept in the directory named by TSS2_FAPI_CERT_CACHE. Every object is stored
+ * once under the SHA-256 digest of its content ("obj-<digest>"). Every URL has
+ * a small index file ("url-<digest of the URL>") naming the object, its expiry
+ * time and the validators for a conditional request. Files are written to a
+ * temporary file and renamed, so concurrent processes never see partial files.
+ *
+ * The expiry time follows the HTTP caching headers of the response, the CRL
+ * code additionally limits it to the nextUpdate time of the CRL. An expired
+ * entry with an ETag or Last-Modified validator is revalidated; an expired
+ * entry is never used if the server can not be reached.
+ */
+
+/** Size of a hex encoded SHA-256 digest including the terminating zero. */
+#define CACHE_DIGEST_HEX_SIZE (2 * 32 + 1)
+
+/** Value of max-age which is treated as infinite (RFC 7234, 1.2.1). */
+#define CACHE_MAX_AGE_MAX 2147483648L
+
+struct CurlBufferStruct {
+  unsigned char *buffer;
+  size_t size;
+};
+
+/** The response headers relevant for caching. */
+typedef struct {
+    char *cache_control;
+    char *expires;
+    char *date;
+    char *age;
+    char *etag;
+    char *last_modified;
+} CURL_CACHE_HEADERS;
+
+/** The content of an index file. */
+typedef struct {
+    char *url;
+    char object[CACHE_DIGEST_HEX_SIZE];
+    time_t expires;
+    char *etag;
+    char *last_modified;
+} CURL_CACHE_ENTRY;
+
+/** Callback for copying received curl data to a buffer.
+ *
+ * The buffer will be reallocated according to the size of retrieved data.
+ *
+ * @param[in]  contents The retrieved content.
+ * @param[in]  size the block size in the content.
+ * @param[in]  nmemb The number of blocks.
+ * @retval realsize The byte size of the data.
+ */
+static size_t
+write_curl_buffer_cb(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    struct CurlBufferStruct *curl_buf = (struct CurlBufferStruct *)userp;
+
+    unsigned char *tmp_ptr = realloc(curl_buf->buffer, curl_buf->size + realsize + 1);
+    if (tmp_ptr == NULL) {
+        LOG_ERROR("Can't allocate memory in CURL callback.");
+        return 0;
+    }
+    curl_buf->buffer = tmp_ptr;
+    memcpy(&(curl_buf->buffer[curl_buf->size]), contents, realsize);
+    curl_buf->size += realsize;
+    curl_buf->buffer[curl_buf->size] = 0;
+
+    return realsize;
+}
+
+static void
+headers_cleanup(CURL_CACHE_HEADERS *headers)
+{
+    SAFE_FREE(headers->cache_control);
+    SAFE_FREE(headers->expires);
+    SAFE_FREE(headers->date);
+    SAFE_FREE(headers->age);
+    SAFE_FREE(headers->etag);
+    SAFE_FREE(headers->last_modified);
+}
+
+static bool
+header_name_is(const char *name, size_t length, const char *expected)
+{
+    return strlen(expected) == length && strncasecmp(name, expected, length) == 0;
+}
+
+/** Callback for collecting the caching headers of a response.
+ *
+ * Headers of interim responses (e.g. 100 Continue) are discarded when the
+ * next status line arrives. Repeated Cache-Control headers are joined.
+ *
+ * @param[in]  contents One header line.
+ * @param[in]  size the block size in the content.
+ * @param[in]  nmemb The number of blocks.
+ * @param[in,out] userp The CURL_CACHE_HEADERS to be filled.
+ * @retval realsize The byte size of the data.
+ * @retval 0 if memory could not be allocated.
+ */
+static size_t
+header_curl_cb(char *contents, size_t size, size_t nmemb, void *userp)
+{
+    size_t realsize = size * nmemb;
+    CURL_CACHE_HEADERS *headers = userp;
+    const char *colon, *value;
+    size_t value_length, length;
+    char **field;
+    char *tmp;
+
+    if (realsize >= 5 && strncmp(contents, "HTTP/", 5) == 0) {
+        headers_cleanup(headers);
+        return realsize;
+    }
+    colon = memchr(contents, ':', realsize);
+    if (colon == NULL)
+        return realsize;
+
+    length = colon - contents;
+    if (header_name_is(contents, length, "cache-control"))
+        field = &headers->cache_control;
+    else if (header_name_is(contents, length, "expires"))
+        field = &headers->expires;
+    else if (header_name_is(contents, length, "date"))
+        field = &headers->date;
+    else if (header_name_is(contents, length, "age"))
+        field = &headers->age;
+    else if (header_name_is(contents, length, "etag"))
+        field = &headers->etag;
+    else if (header_name_is(contents, length, "last-modified"))
+        field = &headers->last_modified;
+    else
+        return realsize;
+
+    value = colon + 1;
+    value_length = realsize - (length + 1);
+    while (value_length > 0 && (*value == ' ' || *value == '\t')) {
+        value++;
+        value_length--;
+    }
+    while (value_length > 0 && isspace((unsigned char)value[value_length - 1]))
+        value_length--;
+
+    if (*field != NULL && field == &headers->cache_control) {
+        length = strlen(*field);
+        tmp = realloc(*field, length + 2 + value_length + 1);
+        if (tmp == NULL) {
+            LOG_ERROR("Can't allocate memory in CURL callback.");
+            return 0;
+        }
+        memcpy(&tmp[length], ", ", 2);
+        memcpy(&tmp[length + 2], value, value_length);
+        tmp[length + 2 + value_length] = '\0';
+        *field = tmp;
+    } else {
+        tmp = strndup(value, value_length);
+        if (tmp == NULL) {
+            LOG_ERROR("Can't allocate memory in CURL callback.");
+            return 0;
+        }
+        free(*field);
+        *field = tmp;
+    }
+    return realsize;
+}
+
+/** Download a resource via curl.
+ *
+ * @param[in]  url The url of the resource.
+ * @param[in]  entry The cache entry whose validators are sent with the
+ *             request, or NULL for an unconditional request.
+ * @param[out] status The HTTP status code (0 for other protocols).
+ * @param[out] body The retrieved body.
+ * @param[out] headers The caching headers of the response.
+ *
+ * @retval TSS2_RC_SUCCESS if a response was received.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ * @retval TSS2_FAPI_RC_NO_CERT if the download did fail.
+ */
+static TSS2_RC
+curl_download(
+    const char *url,
+    const CURL_CACHE_ENTRY *entry,
+    long *status,
+    struct CurlBufferStruct *body,
+    CURL_CACHE_HEADERS *headers)
+{
+    TSS2_RC r = TSS2_FAPI_RC_NO_CERT;
+    struct curl_slist *request_headers = NULL, *tmp_list;
+    char *line = NULL;
+    CURL *curl;
+
+    CURLcode rc = curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (rc != CURLE_OK) {
+        LOG_ERROR("curl_global_init failed: %s", curl_easy_strerror(rc));
+        return TSS2_FAPI_RC_NO_CERT;
+    }
+
+    curl = curl_easy_init();
+    if (!curl) {
+        LOG_ERROR("curl_easy_init failed");
+        goto out_global_cleanup;
+    }
+
+    /* Ask the server to send the body only if our copy is outdated. */
+    if (entry && entry->etag) {
+        r = ifapi_asprintf(&line, "If-None-Match: %s", entry->etag);
+        goto_if_error(r, "Out of memory", out_easy_cleanup);
+        tmp_list = curl_slist_append(request_headers, line);
+        SAFE_FREE(line);
+        goto_if_null2(tmp_list, "Out of memory", r, TSS2_FAPI_RC_MEMORY,
+                      out_easy_cleanup);
+        request_headers = tmp_list;
+    }
+    if (entry && entry->last_modified) {
+        r = ifapi_asprintf(&line, "If-Modified-Since: %s", entry->last_modified);
+        goto_if_error(r, "Out of memory", out_easy_cleanup);
+        tmp_list = curl_slist_append(request_headers, line);
+        SAFE_FREE(line);
+        goto_if_null2(tmp_list, "Out of memory", r, TSS2_FAPI_RC_MEMORY,
+                      out_easy_cleanup);
+        request_headers = tmp_list;
+    }
+    r = TSS2_FAPI_RC_NO_CERT;
+
+    if (curl_easy_setopt(curl, CURLOPT_URL, url) != CURLE_OK ||
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
+                         write_curl_buffer_cb) != CURLE_OK ||
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)body) != CURLE_OK ||
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION,
+                         header_curl_cb) != CURLE_OK ||
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)headers) != CURLE_OK ||
+        (request_headers &&
+         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, request_headers) != CURLE_OK)) {
+        LOG_ERROR("curl_easy_setopt failed");
+        goto out_easy_cleanup;
+    }
+
+    if (LOGMODULE_status == LOGLEVEL_TRACE) {
+        if (CURLE_OK != curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L)) {
+            LOG_WARNING("Curl easy setopt verbose failed");
+        }
+    }
+
+    rc = curl_easy_perform(curl);
+    if (rc != CURLE_OK) {
+        LOG_ERROR("curl_easy_perform() failed: %s", curl_easy_strerror(rc));
+        goto out_easy_cleanup;
+    }
+
+    *status = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status) != CURLE_OK)
+        *status = 0;
+    r = TSS2_RC_SUCCESS;
+
+out_easy_cleanup:
+    if (r != TSS2_RC_SUCCESS) {
+        SAFE_FREE(body->buffer);
+        body->size = 0;
+        headers_cleanup(headers);
+    }
+    curl_slist_free_all(request_headers);
+    curl_easy_cleanup(curl);
+out_global_cleanup:
+    curl_global_cleanup();
+    return r;
+}
+
+/** Parse the directives of a Cache-Control header relevant for a private cache.
+ *
+ * @param[in]  value The header value, may be NULL.
+ * @param[out] no_store Set if the response must not be stored.
+ * @param[out] no_cache Set if the response must be revalidated before use.
+ * @param[out] max_age The max-age directive or -1 if there is none.
+ */
+static void
+cache_control_parse(const char *value, bool *no_store, bool *no_cache,
+                    long *max_age)
+{
+    const char *p = value, *name;
+    size_t length;
+    long number;
+    char *end;
+
+    *no_store = false;
+    *no_cache = false;
+    *max_age = -1;
+
+    while (p && *p) {
+        while (*p == ',' || isspace((unsigned char)*p))
+            p++;
+        name = p;
+        while (*p && *p != ',' && *p != '=' && !isspace((unsigned char)*p))
+            p++;
+        length = p - name;
+        while (isspace((unsigned char)*p))
+            p++;
+
+        if (header_name_is(name, length, "no-store"))
+            *no_store = true;
+        else if (header_name_is(name, length, "no-cache"))
+            *no_cache = true;
+
+        if (*p == '=') {
+            p++;
+            while (isspace((unsigned char)*p))
+                p++;
+            if (*p == '"') {
+                /* Quoted arguments may contain commas. */
+                p = strchr(p + 1, '"');
+                if (p == NULL)
+                    return;
+                p++;
+            } else if (header_name_is(name, length, "max-age")) {
+                errno = 0;
+                number = strtol(p, &end, 10);
+                if (end != p && number >= 0) {
+                    if (errno == ERANGE || number > CACHE_MAX_AGE_MAX)
+                        number = CACHE_MAX_AGE_MAX;
+                    *max_age = number;
+                }
+                p = end;
+            }
+        }
+        while (*p && *p != ',')
+            p++;
+    }
+}
+
+/** Compute the expiry time of a response from its caching headers.
+ *
+ * The lifetime is taken from max-age, Expires or, as a heuristic, from 10% of
+ * the time since Last-Modified (at most IFAPI_CURL_CACHE_HEURISTIC_MAX). The
+ * Age of the response is subtracted.
+ *
+ * @param[in]  headers The headers of the response.
+ * @param[in]  now The time the response was received.
+ * @param[out] expires The time the response becomes stale.
+ * @retval true if the response may be stored.
+ * @retval false if the response must not be stored.
+ */
+static bool
+headers_expiry(const CURL_CACHE_HEADERS *headers, time_t now, time_t *expires)
+{
+    bool no_store, no_cache;
+    long max_age, age = 0;
+    time_t date = now, lifetime = 0, t;
+
+    cache_control_parse(headers->cache_control, &no_store, &no_cache, &max_age);
+    if (no_store)
+        return false;
+
+    if (headers->date && (t = curl_getdate(headers->date, NULL)) != -1)
+        date = t;
+    if (headers->age) {
+        age = strtol(headers->age, NULL, 10);
+        if (age < 0 || age > CACHE_MAX_AGE_MAX)
+            age = 0;
+    }
+
+    if (no_cache) {
+        lifetime = 0;
+    } else if (max_age >= 0) {
+        lifetime = max_age;
+    } else if (headers->expires) {
+        /* Invalid dates like "0" mean that the response is already expired. */
+        t = curl_getdate(headers->expires, NULL);
+        lifetime = (t == -1) ? 0 : t - date;
+    } else if (headers->last_modified &&
+               (t = curl_getdate(headers->last_modified, NULL)) != -1 &&
+               t < date) {
+        lifetime = (date - t) / 10;
+        if (lifetime > IFAPI_CURL_CACHE_HEURISTIC_MAX)
+            lifetime = IFAPI_CURL_CACHE_HEURISTIC_MAX;
+    }
+
+    *expires = now + lifetime - age;
+    return true;
+}
+
+/** Only http(s) resources are cached; local files are always read again. */
+static bool
+url_is_cacheable(const char *url)
+{
+    if (strncasecmp(url, "http://", 7) != 0 && strncasecmp(url, "https://", 8) != 0)
+        return false;
+    /* The URL is stored as one line of the index file. */
+    return strpbrk(url, "\r\n") == NULL;
+}
+
+static TSS2_RC
+cache_digest(const void *data, size_t size, char hex[CACHE_DIGEST_HEX_SIZE])
+{
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_size, i;
+
+    if (!EVP_Digest(data, size, md, &md_size, EVP_sha256(), NULL) ||
+        2 * md_size + 1 != CACHE_DIGEST_HEX_SIZE) {
+        return_error(TSS2_FAPI_RC_GENERAL_FAILURE, "EVP_Digest failed.");
+    }
+    for (i = 0; i < md_size; i++)
+        sprintf(&hex[2 * i], "%02x", md[i]);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+cache_read_file(const char *dir, const char *name, unsigned char **data,
+                size_t *size)
+{
+    TSS2_RC r = TSS2_FAPI_RC_IO_ERROR;
+    char *path = NULL;
+    struct stat st;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    *data = NULL;
+    r = ifapi_asprintf(&path, "%s/%s", dir, name);
+    return_if_error(r, "Out of memory");
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_DEBUG("Cache file %s not found", path);
+        SAFE_FREE(path);
+        return TSS2_FAPI_RC_IO_ERROR;
+    }
+    r = TSS2_FAPI_RC_IO_ERROR;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        goto cleanup;
+
+    *data = malloc(st.st_size + 1);
+    goto_if_null2(*data, "Out of memory", r, TSS2_FAPI_RC_MEMORY, cleanup);
+    while (done < (size_t)st.st_size) {
+        n = read(fd, &(*data)[done], st.st_size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    if (done != (size_t)st.st_size) {
+        LOG_WARNING("Could not read cache file %s", path);
+        goto cleanup;
+    }
+    (*data)[done] = '\0';
+    *size = done;
+    r = TSS2_RC_SUCCESS;
+
+cleanup:
+    if (r != TSS2_RC_SUCCESS)
+        SAFE_FREE(*data);
+    close(fd);
+    SAFE_FREE(path);
+    return r;
+}
+
+static TSS2_RC
+cache_write_file(const char *dir, const char *name, const void *data,
+                 size_t size)
+{
+    TSS2_RC r;
+    char *tmp_path = NULL, *path = NULL;
+    const char *p = data;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    r = ifapi_asprintf(&tmp_path, "%s/.tmp-XXXXXX", dir);
+    return_if_error(r, "Out of memory");
+    r = ifapi_asprintf(&path, "%s/%s", dir, name);
+    goto_if_error(r, "Out of memory", cleanup);
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        LOG_WARNING("Could not create %s: %s", tmp_path, strerror(errno));
+        r = TSS2_FAPI_RC_IO_ERROR;
+        goto cleanup;
+    }
+    while (done < size) {
+        n = write(fd, &p[done], size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    if (close(fd) != 0 || done != size || rename(tmp_path, path) != 0) {
+        LOG_WARNING("Could not write %s: %s", path, strerror(errno));
+        unlink(tmp_path);
+        r = TSS2_FAPI_RC_IO_ERROR;
+    }
+
+cleanup:
+    SAFE_FREE(tmp_path);
+    SAFE_FREE(path);
+    return r;
+}
+
+static TSS2_RC
+cache_index_name(const char *url, char name[4 + CACHE_DIGEST_HEX_SIZE])
+{
+    memcpy(name, "url-", 4);
+    return cache_digest(url, strlen(url), &name[4]);
+}
+
+static void
+cache_entry_cleanup(CURL_CACHE_ENTRY *entry)
+{
+    SAFE_FREE(entry->url);
+    SAFE_FREE(entry->etag);
+    SAFE_FREE(entry->last_modified);
+}
+
+/** Parse an index file.
+ *
+ * The file consists of "<key> <value>" lines with the keys url, object,
+ * expires, etag and last-modified.
+ */
+static TSS2_RC
+cache_entry_parse(char *data, CURL_CACHE_ENTRY *entry)
+{
+    char *line, *next, *value;
+    bool have_expires = false;
+
+    for (line = data; line && *line; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        value = strchr(line, ' ');
+        if (value == NULL)
+            continue;
+        *value++ = '\0';
+
+        if (strcmp(line, "url") == 0) {
+            SAFE_FREE(entry->url);
+            entry->url = strdup(value);
+            return_if_null(entry->url, "Out of memory", TSS2_FAPI_RC_MEMORY);
+        } else if (strcmp(line, "object") == 0 &&
+                   strlen(value) == CACHE_DIGEST_HEX_SIZE - 1) {
+            memcpy(&entry->object[0], value, CACHE_DIGEST_HEX_SIZE);
+        } else if (strcmp(line, "expires") == 0) {
+            entry->expires = (time_t)strtoll(value, NULL, 10);
+            have_expires = true;
+        } else if (strcmp(line, "etag") == 0) {
+            SAFE_FREE(entry->etag);
+            entry->etag = strdup(value);
+            return_if_null(entry->etag, "Out of memory", TSS2_FAPI_RC_MEMORY);
+        } else if (strcmp(line, "last-modified") == 0) {
+            SAFE_FREE(entry->last_modified);
+            entry->last_modified = strdup(value);
+            return_if_null(entry->last_modified, "Out of memory",
+                           TSS2_FAPI_RC_MEMORY);
+        }
+    }
+    if (entry->url == NULL || entry->object[0] == '\0' || !have_expires)
+        return TSS2_FAPI_RC_BAD_VALUE;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+cache_entry_load(const char *dir, const char *url, CURL_CACHE_ENTRY *entry)
+{
+    TSS2_RC r;
+    char name[4 + CACHE_DIGEST_HEX_SIZE];
+    unsigned char *data = NULL;
+    size_t size;
+
+    memset(entry, 0, sizeof(*entry));
+    r = cache_index_name(url, name);
+    return_if_error(r, "Digest of url");
+    r = cache_read_file(dir, name, &data, &size);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    r = cache_entry_parse((char *)data, entry);
+    SAFE_FREE(data);
+    if (r == TSS2_RC_SUCCESS && strcmp(entry->url, url) != 0) {
+        LOG_WARNING("Cache index %s does not belong to %s", name, url);
+        r = TSS2_FAPI_RC_BAD_VALUE;
+    }
+    if (r != TSS2_RC_SUCCESS)
+        cache_entry_cleanup(entry);
+    return r;
+}
+
+static TSS2_RC
+cache_entry_store(const char *dir, const char *url, const char *object,
+                  time_t expires, const char *etag, const char *last_modified)
+{
+    TSS2_RC r;
+    char name[4 + CACHE_DIGEST_HEX_SIZE];
+    char *data = NULL;
+
+    r = cache_index_name(url, name);
+    return_if_error(r, "Digest of url");
+    r = ifapi_asprintf(&data, "url %s\nobject %s\nexpires %lld\n%s%s%s%s%s%s",
+                       url, object, (long long)expires,
+                       etag ? "etag " : "", etag ? etag : "", etag ? "\n" : "",
+                       last_modified ? "last-modified " : "",
+                       last_modified ? last_modified : "",
+                       last_modified ? "\n" : "");
+    return_if_error(r, "Out of memory");
+    r = cache_write_file(dir, name, data, strlen(data));
+    SAFE_FREE(data);
+    return r;
+}
+
+/** Read a cached object and check that it matches its digest. */
+static TSS2_RC
+cache_object_load(const char *dir, const char *object, unsigned char **buffer,
+                  size_t *buffer_size)
+{
+    TSS2_RC r;
+    char name[4 + CACHE_DIGEST_HEX_SIZE];
+    char digest[CACHE_DIGEST_HEX_SIZE];
+
+    snprintf(name, sizeof(name), "obj-%s", object);
+    r = cache_read_file(dir, name, buffer, buffer_size);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+    r = cache_digest(*buffer, *buffer_size, digest);
+    if (r == TSS2_RC_SUCCESS && strcmp(digest, object) != 0) {
+        LOG_WARNING("Cached object %s is corrupted", name);
+        r = TSS2_FAPI_RC_BAD_VALUE;
+    }
+    if (r != TSS2_RC_SUCCESS)
+        SAFE_FREE(*buffer);
+    return r;
+}
+
+static TSS2_RC
+cache_object_store(const char *dir, const unsigned char *buffer, size_t size,
+                   char object[CACHE_DIGEST_HEX_SIZE])
+{
+    TSS2_RC r;
+    char name[4 + CACHE_DIGEST_HEX_SIZE];
+    char *path = NULL;
+    struct stat st;
+    bool exists;
+
+    r = cache_digest(buffer, size, object);
+    return_if_error(r, "Digest of object");
+    snprintf(name, sizeof(name), "obj-%s", object);
+
+    /* Identical content downloaded from another URL is stored only once. */
+    r = ifapi_asprintf(&path, "%s/%s", dir, name);
+    return_if_error(r, "Out of memory");
+    exists = stat(path, &st) == 0 && (size_t)st.st_size == size;
+    SAFE_FREE(path);
+    if (exists)
+        return TSS2_RC_SUCCESS;
+    return cache_write_file(dir, name, buffer, size);
+}
+
+/** Delete an object which is no longer named by any index file. */
+static void
+cache_object_release(const char *dir, const char *object)
+{
+    CURL_CACHE_ENTRY entry;
+    struct dirent *dirent;
+    unsigned char *data;
+    char *path = NULL;
+    bool used = false;
+    size_t size;
+    DIR *dirp;
+
+    dirp = opendir(dir);
+    if (dirp == NULL)
+        return;
+    while (!used && (dirent = readdir(dirp)) != NULL) {
+        if (strncmp(dirent->d_name, "url-", 4) != 0)
+            continue;
+        if (cache_read_file(dir, dirent->d_name, &data, &size) != TSS2_RC_SUCCESS)
+            continue;
+        memset(&entry, 0, sizeof(entry));
+        if (cache_entry_parse((char *)data, &entry) == TSS2_RC_SUCCESS &&
+            strcmp(entry.object, object) == 0)
+            used = true;
+        cache_entry_cleanup(&entry);
+        SAFE_FREE(data);
+    }
+    closedir(dirp);
+
+    if (!used && ifapi_asprintf(&path, "%s/obj-%s", dir, object) == TSS2_RC_SUCCESS) {
+        LOG_DEBUG("Removing unused cache object %s", path);
+        unlink(path);
+        SAFE_FREE(path);
+    }
+}
+
+static void
+cache_entry_remove(const char *dir, const CURL_CACHE_ENTRY *entry)
+{
+    char name[4 + CACHE_DIGEST_HEX_SIZE];
+    char *path = NULL;
+
+    if (cache_index_name(entry->url, name) != TSS2_RC_SUCCESS ||
+        ifapi_asprintf(&path, "%s/%s", dir, name) != TSS2_RC_SUCCESS)
+        return;
+    unlink(path);
+    SAFE_FREE(path);
+    cache_object_release(dir, entry->object);
+}
+
+/** Store a complete response if the caching headers allow it.
+ *
+ * A response is stored if it is fresh or if it carries a validator which
+ * allows a later revalidation. Failures are only logged, the response is
+ * used in any case.
+ */
+static void
+cache_store(const char *dir, const char *url, const CURL_CACHE_ENTRY *old,
+            const CURL_CACHE_HEADERS *headers,
+            const struct CurlBufferStruct *body, time_t now)
+{
+    char object[CACHE_DIGEST_HEX_SIZE];
+    time_t expires;
+
+    if (!headers_expiry(headers, now, &expires) ||
+        (expires <= now && !headers->etag && !headers->last_modified)) {
+        LOG_DEBUG("Response for %s is not cacheable", url);
+        if (old)
+            cache_entry_remove(dir, old);
+        return;
+    }
+
+    if (cache_object_store(dir, body->buffer, body->size, object) !=
+        TSS2_RC_SUCCESS ||
+        cache_entry_store(dir, url, object, expires, headers->etag,
+                          headers->last_modified) != TSS2_RC_SUCCESS) {
+        LOG_WARNING("Could not cache %s", url);
+        return;
+    }
+    if (old && strcmp(old->object, object) != 0)
+        cache_object_release(dir, old->object);
+}
+
+/** Get the directory of the certificate cache.
+ *
+ * @retval The directory named by TSS2_FAPI_CERT_CACHE.
+ * @retval NULL if the cache is disabled.
+ */
+const char *
+ifapi_curl_cache_get_dir(void)
+{
+    const char *dir = getenv(ENV_FAPI_CERT_CACHE);
+
+    if (dir == NULL || dir[0] == '\0')
+        return NULL;
+    return dir;
+}
+
+/** Get byte buffer from file system or web via curl.
+ *
+ * If the certificate cache is enabled, http(s) resources are served from the
+ * cache as long as they are fresh. Expired entries are revalidated with a
+ * conditional request; complete responses are stored according to their
+ * caching headers.
+ *
+ * @param[in]  url The url of the resource.
+ * @param[out] buffer The buffer retrieved via the url.
+ * @param[out] buffer_size The size of the retrieved object.
+ *
+ * @retval TSS2_RC_SUCCESS if buffer could be retrieved.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if a NULL pointer was passed.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ * @retval TSS2_FAPI_RC_NO_CERT if the download did fail.
+ */
+TSS2_RC
+ifapi_curl_cache_get(
+    const char *url,
+    unsigned char **buffer,
+    size_t *buffer_size)
+{
+    TSS2_RC r;
+    CURL_CACHE_ENTRY entry;
+    CURL_CACHE_HEADERS headers = { 0 };
+    struct CurlBufferStruct body = { .size = 0, .buffer = NULL };
+    struct CurlBufferStruct object = { .size = 0, .buffer = NULL };
+    const char *dir = NULL;
+    bool cached = false;
+    long status = 0;
+    time_t now, expires;
+
+    check_not_null(url);
+    check_not_null(buffer);
+    check_not_null(buffer_size);
+
+    memset(&entry, 0, sizeof(entry));
+    if (url_is_cacheable(url))
+        dir = ifapi_curl_cache_get_dir();
+    if (dir && mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        LOG_WARNING("Could not create cache directory %s: %s", dir,
+                    strerror(errno));
+        dir = NULL;
+    }
+
+    now = time(NULL);
+    if (dir && cache_entry_load(dir, url, &entry) == TSS2_RC_SUCCESS) {
+        if (cache_object_load(dir, entry.object, &object.buffer,
+                              &object.size) == TSS2_RC_SUCCESS) {
+            cached = true;
+            if (entry.expires > now) {
+                LOG_DEBUG("Using cached copy of %s", url);
+                goto use_object;
+            }
+        }
+    }
+
+    r = curl_download(url, cached ? &entry : NULL, &status, &body, &headers);
+    goto_if_error(r, "Download resource", cleanup);
+
+    if (cached && status == 304) {
+        /* Not modified: keep the object and update the index. */
+        LOG_DEBUG("Cached copy of %s revalidated", url);
+        if (!headers_expiry(&headers, now, &expires))
+            expires = now;
+        if (cache_entry_store(dir, url, entry.object, expires,
+                              headers.etag ? headers.etag : entry.etag,
+                              headers.last_modified ? headers.last_modified
+                                                    : entry.last_modified)
+            != TSS2_RC_SUCCESS)
+            LOG_WARNING("Could not update cache entry of %s", url);
+        goto use_object;
+    }
+    if (dir && status == 200)
+        cache_store(dir, url, cached ? &entry : NULL, &headers, &body, now);
+
+    *buffer = body.buffer;
+    *buffer_size = body.size;
+    body.buffer = NULL;
+    r = TSS2_RC_SUCCESS;
+    goto cleanup;
+
+use_object:
+    *buffer = object.buffer;
+    *buffer_size = object.size;
+    object.buffer = NULL;
+    r = TSS2_RC_SUCCESS;
+
+cleanup:
+    SAFE_FREE(object.buffer);
+    SAFE_FREE(body.buffer);
+    headers_cleanup(&headers);
+    cache_entry_cleanup(&entry);
+    return r;
+}
+
+/** Limit the lifetime of a cached resource.
+ *
+ * Used for CRLs, which must be fetched again after their nextUpdate time
+ * regardless of the caching headers sent by the server.
+ *
+ * @param[in] url The url of the resource.
+ * @param[in] expires The latest time the cached copy may be used.
+ */
+void
+ifapi_curl_cache_expire(const char *url, time_t expires)
+{
+    CURL_CACHE_ENTRY entry;
+    const char *dir;
+
+    if (url == NULL || !url_is_cacheable(url))
+        return;
+    dir = ifapi_curl_cache_get_dir();
+    if (dir == NULL || cache_entry_load(dir, url, &entry) != TSS2_RC_SUCCESS)
+        return;
+
+    if (entry.expires > expires &&
+        cache_entry_store(dir, url, entry.object, expires, entry.etag,
+                          entry.last_modified) != TSS2_RC_SUCCESS)
+        LOG_WARNING("Could not update cache entry of %s", url);
+    cache_entry_cleanup(&entry);
+}
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+#ifndef IFAPI_CURL_CACHE_H
+#define IFAPI_CURL_CACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "tss2_common.h"
+
+/** Environment variable naming the directory of the certificate and CRL cache. */
+#define ENV_FAPI_CERT_CACHE "TSS2_FAPI_CERT_CACHE"
+
+/** Upper bound in seconds for a lifetime guessed from Last-Modified. */
+#define IFAPI_CURL_CACHE_HEURISTIC_MAX 86400
+
+const char *
+ifapi_curl_cache_get_dir(void);
+
+TSS2_RC
+ifapi_curl_cache_get(
+    const char *url,
+    unsigned char **buffer,
+    size_t *buffer_size);
+
+void
+ifapi_curl_cache_expire(
+    const char *url,
+    time_t expires);
+
+#endif /* IFAPI_CURL_CACHE_H */
@@ -8,11 +8,17 @@
 #include <config.h>
 #endif
 
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ifapi_helpers.h"
+#include "fapi_crypto.h"
 #include "ifapi_eventlog.h"
 #include "ifapi_json_serialize.h"
+#include "ifapi_json_deserialize.h"
+#include "ifapi_timing.h"
 
 #define LOGMODULE fapi
 #include "util/log.h"
@@ -23,6 +29,8 @@
  *
  * @param[in,out] eventlog The context area for the eventlog.
  * @param[in] log_dir The directory where to put the eventlog data.
+ * @param[in] replay_threads The number of threads, including the calling
+ *            one, used for the replay of event logs during quote verification.
  * @retval TSS2_RC_SUCCESS on success.
  * @retval TSS2_FAPI_RC_IO_ERROR if creation of log_dir failed or log_dir is not writable.
  * @retval TSS2_FAPI_RC_MEMORY if memory allocation failed.
@@ -33,7 +41,8 @@
 TSS2_RC
 ifapi_eventlog_initialize(
     IFAPI_EVENTLOG *eventlog,
-    const char *log_dir)
+    const char *log_dir,
+    size_t replay_threads)
 {
     check_not_null(eventlog);
     check_not_null(log_dir);
@@ -46,6 +55,949 @@ ifapi_eventlog_initialize(
     eventlog->log_dir = strdup(log_dir);
     return_if_null(eventlog->log_dir, "Out of memory.", TSS2_FAPI_RC_MEMORY);
 
+    eventlog->replay.n_threads = replay_threads;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static size_t
+eventlog_skip_space(const char *log, size_t size, size_t pos)
+{
+    while (pos < size && (log[pos] == ' ' || log[pos] == '\n' ||
+                          log[pos] == '\r' || log[pos] == '\t'))
+        pos++;
+    return pos;
+}
+
+/** Start walking through the elements of a serialized event log.
+ *
+ * Event logs are stored as JSON array. A log consisting of a single JSON
+ * value is treated as one element.
+ */
+static void
+eventlog_iter_start(
+    IFAPI_EVENTLOG_ITER *iter,
+    const char *log,
+    size_t size)
+{
+    memset(iter, 0, sizeof(IFAPI_EVENTLOG_ITER));
+    iter->log = log;
+    iter->size = size;
+    iter->pos = eventlog_skip_space(log, size, 0);
+    if (iter->pos < size && log[iter->pos] == '[') {
+        iter->in_array = true;
+        iter->pos += 1;
+    }
+}
+
+/** Determine the JSON text of the next element of an event log.
+ *
+ * Only the nesting of brackets and the extent of strings are tracked, the
+ * element itself is not parsed.
+ *
+ * @param[in,out] iter The iterator.
+ * @param[out] element The start of the next element or NULL if the end
+ *             of the log was reached.
+ * @param[out] length The length of the element.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the log is no valid JSON array.
+ */
+static TSS2_RC
+eventlog_iter_element(
+    IFAPI_EVENTLOG_ITER *iter,
+    const char **element,
+    size_t *length)
+{
+    const char *log = iter->log;
+    size_t size = iter->size;
+    size_t pos, start, depth = 0;
+    bool in_string = false;
+
+    *element = NULL;
+    *length = 0;
+    if (iter->done)
+        return TSS2_RC_SUCCESS;
+
+    pos = eventlog_skip_space(log, size, iter->pos);
+    if (iter->in_array && pos < size && log[pos] == ']') {
+        /* Nothing but white space may follow the log. */
+        if (eventlog_skip_space(log, size, pos + 1) < size) {
+            return_error2(TSS2_FAPI_RC_BAD_VALUE, "Invalid event log at offset %zu",
+                          pos + 1);
+        }
+        iter->done = true;
+        iter->pos = pos;
+        return TSS2_RC_SUCCESS;
+    }
+    if (!iter->in_array && (iter->separator || pos >= size)) {
+        if (pos < size) {
+            return_error2(TSS2_FAPI_RC_BAD_VALUE, "Invalid event log at offset %zu",
+                          pos);
+        }
+        iter->done = true;
+        return TSS2_RC_SUCCESS;
+    }
+    if (iter->separator) {
+        if (pos >= size || log[pos] != ',') {
+            return_error2(TSS2_FAPI_RC_BAD_VALUE, "Invalid event log at offset %zu",
+                          pos);
+        }
+        pos = eventlog_skip_space(log, size, pos + 1);
+    }
+
+    for (start = pos; pos < size; pos++) {
+        if (in_string) {
+            if (log[pos] == '\\')
+                pos++;
+            else if (log[pos] == '"')
+                in_string = false;
+        } else if (log[pos] == '"') {
+            in_string = true;
+        } else if (log[pos] == '{' || log[pos] == '[') {
+            depth++;
+        } else if (log[pos] == '}' || log[pos] == ']') {
+            if (depth == 0)
+                break;
+            if (--depth == 0) {
+                pos++;
+                break;
+            }
+        } else if (depth == 0 && (log[pos] == ',' || log[pos] == ' ' ||
+                                  log[pos] == '\n' || log[pos] == '\r' ||
+                                  log[pos] == '\t')) {
+            break;
+        }
+    }
+    if (in_string || depth > 0 || pos == start) {
+        return_error2(TSS2_FAPI_RC_BAD_VALUE, "Invalid event log at offset %zu",
+                      start);
+    }
+    *element = &log[start];
+    *length = pos - start;
+
+    /* The iterator stops directly behind the element, so the log text up to
+       pos stays the same if further events are appended to the log. */
+    iter->pos = pos;
+    iter->separator = true;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Deserialize one element of an event log.
+ *
+ * @param[in] tokener The tokener used for the element.
+ * @param[in] element The JSON text of the element.
+ * @param[in] length The length of element.
+ * @param[out] event The event. It has to be freed with ifapi_cleanup_event
+ *             by the caller.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the element is no valid event.
+ * @retval TSS2_FAPI_RC_MEMORY if memory allocation failed.
+ */
+static TSS2_RC
+eventlog_parse_element(
+    json_tokener *tokener,
+    const char *element,
+    size_t length,
+    IFAPI_EVENT *event)
+{
+    TSS2_RC r;
+    json_object *jso;
+    uint64_t start;
+
+    if (element[0] != '{' || length > INT_MAX) {
+        return_error(TSS2_FAPI_RC_BAD_VALUE, "Event is no JSON object.");
+    }
+
+    start = ifapi_timing_start();
+    json_tokener_reset(tokener);
+    jso = json_tokener_parse_ex(tokener, element, (int) length);
+    if (!jso) {
+        ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+        return_error(TSS2_FAPI_RC_BAD_VALUE, "JSON parsing error");
+    }
+
+    r = ifapi_json_IFAPI_EVENT_deserialize(jso, event);
+    json_object_put(jso);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+    return_if_error(r, "Deserialize event.");
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Initialize an iterator over the events of a serialized event log.
+ *
+ * @param[out] iter The iterator to be initialized.
+ * @param[in] log The event log in JSON format.
+ * @param[in] size The length of log.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_MEMORY if memory allocation failed.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ */
+TSS2_RC
+ifapi_eventlog_iter_init(
+    IFAPI_EVENTLOG_ITER *iter,
+    const char *log,
+    size_t size)
+{
+    check_not_null(iter);
+    check_not_null(log);
+
+    eventlog_iter_start(iter, log, size);
+    iter->tokener = json_tokener_new();
+    return_if_null(iter->tokener, "Out of memory", TSS2_FAPI_RC_MEMORY);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Deserialize the next event of an event log.
+ *
+ * Only this event is converted to JSON objects; these are released before
+ * the function returns.
+ *
+ * @param[in,out] iter The iterator.
+ * @param[out] event The next event. It has to be freed with
+ *             ifapi_cleanup_event by the caller.
+ * @param[out] done true if the end of the log was reached; event is
+ *             not set in this case.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the log or an event is invalid.
+ * @retval TSS2_FAPI_RC_MEMORY if memory allocation failed.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ */
+TSS2_RC
+ifapi_eventlog_iter_next(
+    IFAPI_EVENTLOG_ITER *iter,
+    IFAPI_EVENT *event,
+    bool *done)
+{
+    check_not_null(iter);
+    check_not_null(event);
+    check_not_null(done);
+
+    TSS2_RC r;
+    const char *element;
+    size_t length;
+
+    r = eventlog_iter_element(iter, &element, &length);
+    return_if_error(r, "Scan event log.");
+
+    if (!element) {
+        *done = true;
+        return TSS2_RC_SUCCESS;
+    }
+    *done = false;
+
+    return eventlog_parse_element(iter->tokener, element, length, event);
+}
+
+/** Free the resources of an event log iterator.
+ *
+ * @param[in,out] iter The iterator.
+ */
+void
+ifapi_eventlog_iter_finish(IFAPI_EVENTLOG_ITER *iter)
+{
+    if (iter && iter->tokener) {
+        json_tokener_free(iter->tokener);
+        iter->tokener = NULL;
+    }
+}
+
+/** Compute the SHA256 digest over a part of the event log text.
+ */
+static TSS2_RC
+eventlog_segment_digest(
+    const char *text,
+    size_t length,
+    TPM2B_DIGEST *digest)
+{
+    TSS2_RC r;
+    IFAPI_CRYPTO_CONTEXT_BLOB *cryptoContext;
+    size_t digest_size;
+
+    r = ifapi_crypto_hash_start(&cryptoContext, TPM2_ALG_SHA256);
+    return_if_error(r, "crypto hash start");
+
+    HASH_UPDATE_BUFFER(cryptoContext, text, length, r, error_cleanup);
+    r = ifapi_crypto_hash_finish(&cryptoContext, &digest->buffer[0], &digest_size);
+    return_if_error(r, "crypto hash finish");
+    digest->size = digest_size;
+
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    ifapi_crypto_hash_abort(&cryptoContext);
+    return r;
+}
+
+/** Set the PCRs replayed by a replay context.
+ *
+ * If the selection differs from the one of the last replay, the
+ * checkpoints of that replay are discarded.
+ */
+static TSS2_RC
+eventlog_replay_select(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    const TPML_PCR_SELECTION *pcr_selection)
+{
+    IFAPI_VPCR *pcrs;
+    size_t i, pcr, n_pcrs = 0;
+
+    if (pcr_selection->count > TPM2_NUM_PCR_BANKS) {
+        return_error(TSS2_FAPI_RC_BAD_VALUE, "Invalid PCR selection.");
+    }
+
+    pcrs = calloc(pcr_selection->count * TPM2_MAX_PCRS + 1, sizeof(IFAPI_VPCR));
+    return_if_null(pcrs, "Out of memory", TSS2_FAPI_RC_MEMORY);
+
+    for (i = 0; i < pcr_selection->count; i++) {
+        for (pcr = 0; pcr < TPM2_MAX_PCRS; pcr++) {
+            uint8_t byte_idx = pcr / 8;
+            uint8_t flag = 1 << (pcr % 8);
+            if (flag & pcr_selection->pcrSelections[i].pcrSelect[byte_idx]) {
+                pcrs[n_pcrs].pcr = pcr;
+                pcrs[n_pcrs].bank = pcr_selection->pcrSelections[i].hash;
+                n_pcrs += 1;
+            }
+        }
+    }
+
+    if (replay->pcrs && replay->n_pcrs == n_pcrs) {
+        for (i = 0; i < n_pcrs; i++) {
+            if (replay->pcrs[i].pcr != pcrs[i].pcr ||
+                replay->pcrs[i].bank != pcrs[i].bank)
+                break;
+        }
+        if (i == n_pcrs) {
+            free(pcrs);
+            return TSS2_RC_SUCCESS;
+        }
+    }
+
+    ifapi_eventlog_replay_cleanup(replay);
+    replay->pcrs = pcrs;
+    replay->n_pcrs = n_pcrs;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Drop the checkpoints of a replay context starting with a given index.
+ */
+static void
+eventlog_replay_truncate(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    size_t n_checkpoints)
+{
+    while (replay->n_checkpoints > n_checkpoints) {
+        replay->n_checkpoints -= 1;
+        SAFE_FREE(replay->checkpoints[replay->n_checkpoints].values);
+    }
+}
+
+/** Store the current PCR values of a replay as new checkpoint.
+ *
+ * @param[in,out] replay The replay context.
+ * @param[in] text The log text since the previous checkpoint.
+ * @param[in] length The length of text.
+ * @param[in] offset The offset of the end of text in the log.
+ * @param[in] n_events The number of events replayed so far.
+ */
+static TSS2_RC
+eventlog_replay_checkpoint(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    const char *text,
+    size_t length,
+    size_t offset,
+    size_t n_events)
+{
+    TSS2_RC r;
+    IFAPI_EVENTLOG_CHECKPOINT *checkpoints, *checkpoint;
+    size_t i, capacity;
+
+    if (replay->n_checkpoints == replay->checkpoints_capacity) {
+        capacity = replay->checkpoints_capacity ? replay->checkpoints_capacity * 2 : 16;
+        checkpoints = realloc(replay->checkpoints,
+                              capacity * sizeof(IFAPI_EVENTLOG_CHECKPOINT));
+        return_if_null(checkpoints, "Out of memory", TSS2_FAPI_RC_MEMORY);
+        replay->checkpoints = checkpoints;
+        replay->checkpoints_capacity = capacity;
+    }
+    checkpoint = &replay->checkpoints[replay->n_checkpoints];
+
+    r = eventlog_segment_digest(text, length, &checkpoint->segment);
+    return_if_error(r, "Compute segment digest.");
+
+    checkpoint->values = calloc(replay->n_pcrs + 1, sizeof(TPM2B_DIGEST));
+    return_if_null(checkpoint->values, "Out of memory", TSS2_FAPI_RC_MEMORY);
+    for (i = 0; i < replay->n_pcrs; i++)
+        checkpoint->values[i] = replay->pcrs[i].value;
+    checkpoint->offset = offset;
+    checkpoint->n_events = n_events;
+    replay->n_checkpoints += 1;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** A batch of events of a replay.
+ */
+typedef struct {
+    const char **elements;         /**< The JSON text of the events */
+    size_t *lengths;               /**< The lengths of the elements */
+    TPML_DIGEST_VALUES *digests;   /**< The digests of the events */
+    size_t n_digests;              /**< Number of events in the batch */
+    size_t offset;                 /**< End of the last event of the batch in the log */
+    size_t n_events;               /**< Number of events replayed after the batch */
+} IFAPI_EVENTLOG_BATCH;
+
+/** Barrier for the main thread and the replay threads.
+ *
+ * Unlike a pthread_barrier_t, the number of parties can be lowered after
+ * the threads were started.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t parties;                /**< Number of threads to wait for */
+    size_t waiting;                /**< Number of threads waiting */
+    unsigned long generation;      /**< Incremented each time the barrier opens */
+} IFAPI_EVENTLOG_BARRIER;
+
+struct IFAPI_EVENTLOG_POOL;
+
+/** A thread of a parallel replay.
+ */
+typedef struct {
+    pthread_t thread;
+    size_t index;                  /**< The share of the thread in a round */
+    json_tokener *tokener;         /**< Tokener for the events of the thread */
+    TSS2_RC rc;                    /**< The first error of the thread */
+    struct IFAPI_EVENTLOG_POOL *pool;
+} IFAPI_EVENTLOG_WORKER;
+
+/** The threads of a parallel replay.
+ *
+ * The calling thread takes part in every round as the last share.
+ */
+typedef struct IFAPI_EVENTLOG_POOL {
+    IFAPI_EVENTLOG_REPLAY *replay;
+    IFAPI_EVENTLOG_BARRIER barrier;
+    IFAPI_EVENTLOG_BATCH *parse;   /**< The batch deserialized in this round */
+    const IFAPI_EVENTLOG_BATCH *extend; /**< The batch extended in this round */
+    bool stop;                     /**< The threads shall terminate */
+    size_t n_workers;              /**< Number of running threads */
+    IFAPI_EVENTLOG_WORKER workers[IFAPI_EVENTLOG_MAX_REPLAY_THREADS];
+} IFAPI_EVENTLOG_POOL;
+
+static void
+eventlog_barrier_wait(IFAPI_EVENTLOG_BARRIER *barrier)
+{
+    unsigned long generation;
+
+    pthread_mutex_lock(&barrier->mutex);
+    generation = barrier->generation;
+    if (++barrier->waiting >= barrier->parties) {
+        barrier->waiting = 0;
+        barrier->generation += 1;
+        pthread_cond_broadcast(&barrier->cond);
+    } else {
+        while (generation == barrier->generation)
+            pthread_cond_wait(&barrier->cond, &barrier->mutex);
+    }
+    pthread_mutex_unlock(&barrier->mutex);
+}
+
+/** Extend a share of the PCRs of a replay by the events of a batch.
+ *
+ * The share consists of every step-th PCR starting with first. For every
+ * event, the extends of the PCRs of one bank in the share do not depend on
+ * each other, so they are computed with one call of
+ * ifapi_crypto_hash_batch(), which hashes them in parallel SIMD lanes where
+ * the bank is supported by the multi-buffer kernel.
+ *
+ * @param[in,out] replay The replay context.
+ * @param[in] extend The batch to be extended.
+ * @param[in] first The share of the thread.
+ * @param[in] step The number of shares.
+ */
+static TSS2_RC
+eventlog_replay_extend(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    const IFAPI_EVENTLOG_BATCH *extend,
+    size_t first,
+    size_t step)
+{
+    TSS2_RC r;
+    IESYS_CRYPTO_MB_JOB jobs[TPM2_MAX_PCRS];
+    uint8_t messages[TPM2_MAX_PCRS][2 * sizeof(TPMU_HA)];
+    IFAPI_VPCR *pcrs[TPM2_MAX_PCRS];
+    const TPML_DIGEST_VALUES *digests;
+    TPMI_ALG_HASH bank;
+    size_t i, d, e, k, n, digest_size;
+
+    if (extend->n_digests == 0)
+        return TSS2_RC_SUCCESS;
+
+    i = first;
+    while (i < replay->n_pcrs) {
+        /* Collect the PCRs of the share that belong to the next bank. */
+        bank = replay->pcrs[i].bank;
+        for (n = 0; i < replay->n_pcrs && replay->pcrs[i].bank == bank &&
+                 n < TPM2_MAX_PCRS; i += step)
+            pcrs[n++] = &replay->pcrs[i];
+
+        digest_size = ifapi_hash_get_digest_size(bank);
+        if (!digest_size) {
+            return_error2(TSS2_FAPI_RC_BAD_VALUE,
+                          "Unsupported hash algorithm (%"PRIu16")", bank);
+        }
+
+        for (e = 0; e < extend->n_digests; e++) {
+            digests = &extend->digests[e];
+            for (d = 0; d < digests->count; d++) {
+                if (digests->digests[d].hashAlg == bank)
+                    break;
+            }
+            if (d == digests->count) {
+                return_error2(TSS2_FAPI_RC_BAD_VALUE,
+                              "No digest for bank %"PRIu16" found in event", bank);
+            }
+
+            for (k = 0; k < n; k++) {
+                memcpy(&messages[k][0], &pcrs[k]->value.buffer[0],
+                       pcrs[k]->value.size);
+                memcpy(&messages[k][pcrs[k]->value.size],
+                       &digests->digests[d].digest, digest_size);
+                jobs[k].buffer = &messages[k][0];
+                jobs[k].size = pcrs[k]->value.size + digest_size;
+                jobs[k].digest = &pcrs[k]->value.buffer[0];
+            }
+            r = ifapi_crypto_hash_batch(bank, &jobs[0], n);
+            return_if_error2(r, "Extending vPCRs of bank %"PRIu16, bank);
+            for (k = 0; k < n; k++)
+                pcrs[k]->value.size = digest_size;
+        }
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Do the share of one thread in a round of a replay.
+ *
+ * The events of a batch are deserialized in contiguous slices, one per
+ * share. Every (PCR, bank) pair is an independent chain of extends, so
+ * the PCRs of the previous batch are extended concurrently as well; share
+ * first extends every step-th PCR starting with first, see
+ * eventlog_replay_extend().
+ *
+ * @param[in,out] replay The replay context.
+ * @param[in] tokener The tokener of the thread.
+ * @param[in,out] parse The batch to be deserialized or NULL.
+ * @param[in] extend The batch to be extended or NULL.
+ * @param[in] first The share of the thread.
+ * @param[in] step The number of shares.
+ */
+static TSS2_RC
+eventlog_replay_round(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    json_tokener *tokener,
+    IFAPI_EVENTLOG_BATCH *parse,
+    const IFAPI_EVENTLOG_BATCH *extend,
+    size_t first,
+    size_t step)
+{
+    TSS2_RC r;
+    IFAPI_EVENT event;
+    size_t e, end;
+
+    if (parse) {
+        end = parse->n_digests * (first + 1) / step;
+        for (e = parse->n_digests * first / step; e < end; e++) {
+            memset(&event, 0, sizeof(IFAPI_EVENT));
+            r = eventlog_parse_element(tokener, parse->elements[e],
+                                       parse->lengths[e], &event);
+            return_if_error(r, "Error deserialize event");
+            parse->digests[e] = event.digests;
+            ifapi_cleanup_event(&event);
+        }
+    }
+
+    if (extend) {
+        r = eventlog_replay_extend(replay, extend, first, step);
+        return_if_error(r, "Extend vPCRs.");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static void *
+eventlog_replay_worker(void *arg)
+{
+    IFAPI_EVENTLOG_WORKER *worker = arg;
+    IFAPI_EVENTLOG_POOL *pool = worker->pool;
+
+    for (;;) {
+        /* Wait for the next round. */
+        eventlog_barrier_wait(&pool->barrier);
+        if (pool->stop)
+            break;
+
+        if (worker->rc == TSS2_RC_SUCCESS)
+            worker->rc = eventlog_replay_round(pool->replay, worker->tokener,
+                                               pool->parse, pool->extend,
+                                               worker->index, pool->n_workers + 1);
+
+        /* Report the round as done. */
+        eventlog_barrier_wait(&pool->barrier);
+    }
+    return NULL;
+}
+
+/** Start the threads of a parallel replay.
+ *
+ * The threads live until eventlog_pool_stop and are reused for every batch.
+ *
+ * @retval The number of started threads. If it is 0, the replay has to be
+ *         done by the calling thread.
+ */
+static size_t
+eventlog_pool_start(
+    IFAPI_EVENTLOG_POOL *pool,
+    IFAPI_EVENTLOG_REPLAY *replay,
+    size_t n_workers)
+{
+    size_t i;
+
+    pool->replay = replay;
+    pool->stop = false;
+    pool->barrier.parties = n_workers + 1;
+    pool->barrier.waiting = 0;
+    pool->barrier.generation = 0;
+    if (pthread_mutex_init(&pool->barrier.mutex, NULL) != 0)
+        return 0;
+    if (pthread_cond_init(&pool->barrier.cond, NULL) != 0) {
+        pthread_mutex_destroy(&pool->barrier.mutex);
+        return 0;
+    }
+
+    for (i = 0; i < n_workers; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->workers[i].rc = TSS2_RC_SUCCESS;
+        pool->workers[i].tokener = json_tokener_new();
+        if (!pool->workers[i].tokener)
+            break;
+        if (pthread_create(&pool->workers[i].thread, NULL, eventlog_replay_worker,
+                           &pool->workers[i]) != 0) {
+            json_tokener_free(pool->workers[i].tokener);
+            break;
+        }
+    }
+    if (i < n_workers)
+        LOG_WARNING("Only %zu of %zu replay threads started", i, n_workers);
+
+    /* Continue with the threads that could be started. The shares are
+       only assigned by the next round, after the barrier was adjusted. */
+    pthread_mutex_lock(&pool->barrier.mutex);
+    pool->n_workers = i;
+    pool->barrier.parties = i + 1;
+    pthread_mutex_unlock(&pool->barrier.mutex);
+
+    if (i == 0) {
+        pthread_cond_destroy(&pool->barrier.cond);
+        pthread_mutex_destroy(&pool->barrier.mutex);
+    }
+    return i;
+}
+
+/** Terminate the threads of a parallel replay.
+ */
+static void
+eventlog_pool_stop(IFAPI_EVENTLOG_POOL *pool)
+{
+    size_t i;
+
+    pool->stop = true;
+    eventlog_barrier_wait(&pool->barrier);
+    for (i = 0; i < pool->n_workers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+        json_tokener_free(pool->workers[i].tokener);
+    }
+    pthread_cond_destroy(&pool->barrier.cond);
+    pthread_mutex_destroy(&pool->barrier.mutex);
+    pool->n_workers = 0;
+}
+
+/** Deserialize one batch and extend the PCRs by the previous one.
+ *
+ * With a pool, the work is shared by the threads of the pool and the
+ * calling thread.
+ */
+static TSS2_RC
+eventlog_replay_run(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    IFAPI_EVENTLOG_POOL *pool,
+    json_tokener *tokener,
+    IFAPI_EVENTLOG_BATCH *parse,
+    const IFAPI_EVENTLOG_BATCH *extend)
+{
+    TSS2_RC r;
+    size_t i;
+
+    if (pool->n_workers == 0)
+        return eventlog_replay_round(replay, tokener, parse, extend, 0, 1);
+
+    pool->parse = parse;
+    pool->extend = extend;
+    eventlog_barrier_wait(&pool->barrier);
+    r = eventlog_replay_round(replay, tokener, parse, extend,
+                              pool->n_workers, pool->n_workers + 1);
+    eventlog_barrier_wait(&pool->barrier);
+
+    for (i = 0; i < pool->n_workers && r == TSS2_RC_SUCCESS; i++)
+        r = pool->workers[i].rc;
+    return r;
+}
+
+/** Determine the JSON text of the next events of a log.
+ *
+ * A batch ends at the latest at the next multiple of
+ * IFAPI_EVENTLOG_REPLAY_BATCH events, so checkpoints fall on batch ends.
+ * Only the extent of the events is determined; they are deserialized by
+ * eventlog_replay_round.
+ *
+ * @param[in,out] iter The iterator over the log.
+ * @param[out] batch The batch. n_digests is 0 at the end of the log.
+ * @param[in] n_events The number of events replayed before the batch.
+ */
+static TSS2_RC
+eventlog_replay_scan(
+    IFAPI_EVENTLOG_ITER *iter,
+    IFAPI_EVENTLOG_BATCH *batch,
+    size_t n_events)
+{
+    TSS2_RC r;
+    const char *element;
+    size_t length;
+
+    batch->n_digests = 0;
+    batch->n_events = n_events;
+    while (batch->n_digests < IFAPI_EVENTLOG_REPLAY_BATCH) {
+        r = eventlog_iter_element(iter, &element, &length);
+        return_if_error(r, "Scan event log.");
+        if (!element)
+            break;
+
+        batch->elements[batch->n_digests] = element;
+        batch->lengths[batch->n_digests] = length;
+        batch->n_digests += 1;
+        batch->n_events += 1;
+        batch->offset = iter->pos;
+        if (batch->n_events % IFAPI_EVENTLOG_REPLAY_BATCH == 0)
+            break;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Compute the virtual PCR values for an event log.
+ *
+ * Every event is extended into every selected PCR. The values after every
+ * IFAPI_EVENTLOG_CHECKPOINT_INTERVAL events and after the last event are
+ * stored as checkpoints in the replay context. A later replay with the same
+ * PCR selection continues at the last checkpoint for which the log text up
+ * to the checkpoint has not changed. This is checked by comparing the
+ * digests of the log text between the checkpoints, so the resulting values
+ * are the same as those of a full replay.
+ *
+ * The log is processed in batches. While the events of one batch are
+ * deserialized, the PCRs are extended by the previous batch. If
+ * replay->n_threads is larger than one, both are shared by the calling
+ * thread and up to n_threads - 1 further threads.
+ *
+ * @param[in,out] replay The replay context. It has to be zero initialized
+ *                before the first use.
+ * @param[in] pcr_selection The PCRs to be computed.
+ * @param[in] log The event log in JSON format.
+ * @param[in] size The length of log.
+ * @retval TSS2_RC_SUCCESS on success. replay->pcrs contains the PCR values
+ *         in the order of pcr_selection.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the log or an event is invalid.
+ * @retval TSS2_FAPI_RC_MEMORY if memory allocation failed.
+ * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ */
+TSS2_RC
+ifapi_eventlog_replay(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    const TPML_PCR_SELECTION *pcr_selection,
+    const char *log,
+    size_t size)
+{
+    check_not_null(replay);
+    check_not_null(pcr_selection);
+    check_not_null(log);
+
+    TSS2_RC r;
+    IFAPI_EVENTLOG_ITER iter = { 0 };
+    IFAPI_EVENTLOG_CHECKPOINT *checkpoint;
+    IFAPI_EVENTLOG_BATCH batches[2], *batch, *next;
+    IFAPI_EVENTLOG_POOL pool;
+    TPM2B_DIGEST segment;
+    size_t i, n_valid, n_workers, n_events = 0, offset = 0, segment_start;
+
+    memset(&batches, 0, sizeof(batches));
+    memset(&pool, 0, sizeof(pool));
+
+    r = eventlog_replay_select(replay, pcr_selection);
+    return_if_error(r, "Select PCRs.");
+
+    /* Find the last checkpoint for which the log text did not change. */
+    for (n_valid = 0; n_valid < replay->n_checkpoints; n_valid++) {
+        checkpoint = &replay->checkpoints[n_valid];
+        if (checkpoint->offset > size)
+            break;
+        r = eventlog_segment_digest(&log[offset], checkpoint->offset - offset,
+                                    &segment);
+        goto_if_error(r, "Compute segment digest.", error_cleanup);
+        if (segment.size != checkpoint->segment.size ||
+            memcmp(&segment.buffer[0], &checkpoint->segment.buffer[0], segment.size) != 0)
+            break;
+        offset = checkpoint->offset;
+        n_events = checkpoint->n_events;
+    }
+    eventlog_replay_truncate(replay, n_valid);
+
+    /* Start from the checkpoint or from zero. */
+    for (i = 0; i < replay->n_pcrs; i++) {
+        if (n_valid > 0) {
+            replay->pcrs[i].value = replay->checkpoints[n_valid - 1].values[i];
+        } else {
+            replay->pcrs[i].value.size = ifapi_hash_get_digest_size(replay->pcrs[i].bank);
+            memset(&replay->pcrs[i].value.buffer[0], 0, sizeof(replay->pcrs[i].value.buffer));
+        }
+    }
+    /* A checkpoint after the last event of a log is replaced by the next one,
+       so only checkpoints at interval boundaries accumulate. */
+    if (n_valid > 0 && n_events % IFAPI_EVENTLOG_CHECKPOINT_INTERVAL != 0)
+        eventlog_replay_truncate(replay, n_valid - 1);
+    segment_start = replay->n_checkpoints ?
+        replay->checkpoints[replay->n_checkpoints - 1].offset : 0;
+    LOG_DEBUG("Replaying event log from event %zu", n_events);
+
+    r = ifapi_eventlog_iter_init(&iter, log, size);
+    goto_if_error(r, "Initialize event log iterator", error_cleanup);
+    if (n_events > 0) {
+        iter.pos = offset;
+        iter.separator = true;
+    }
+
+    for (i = 0; i < 2; i++) {
+        batches[i].elements = calloc(IFAPI_EVENTLOG_REPLAY_BATCH, sizeof(const char *));
+        batches[i].lengths = calloc(IFAPI_EVENTLOG_REPLAY_BATCH, sizeof(size_t));
+        batches[i].digests = calloc(IFAPI_EVENTLOG_REPLAY_BATCH,
+                                    sizeof(TPML_DIGEST_VALUES));
+        if (!batches[i].elements || !batches[i].lengths || !batches[i].digests) {
+            goto_error(r, TSS2_FAPI_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+    }
+
+    /* The calling thread takes a share of the work as well. */
+    n_workers = replay->n_threads > 0 ? replay->n_threads - 1 : 0;
+    if (n_workers > IFAPI_EVENTLOG_MAX_REPLAY_THREADS)
+        n_workers = IFAPI_EVENTLOG_MAX_REPLAY_THREADS;
+    if (n_workers > 0)
+        eventlog_pool_start(&pool, replay, n_workers);
+
+    batch = &batches[0];
+    next = &batches[1];
+    r = eventlog_replay_scan(&iter, batch, n_events);
+    goto_if_error(r, "Read events.", error_cleanup);
+    r = eventlog_replay_run(replay, &pool, iter.tokener, batch, NULL);
+    goto_if_error(r, "Replay events.", error_cleanup);
+
+    while (batch->n_digests > 0) {
+        /* Deserialize the next batch while this one is extended. */
+        r = eventlog_replay_scan(&iter, next, batch->n_events);
+        goto_if_error(r, "Read events.", error_cleanup);
+        r = eventlog_replay_run(replay, &pool, iter.tokener, next, batch);
+        goto_if_error(r, "Replay events.", error_cleanup);
+
+        n_events = batch->n_events;
+        offset = batch->offset;
+        if (n_events % IFAPI_EVENTLOG_CHECKPOINT_INTERVAL == 0) {
+            r = eventlog_replay_checkpoint(replay, &log[segment_start],
+                                           offset - segment_start, offset, n_events);
+            goto_if_error(r, "Store checkpoint.", error_cleanup);
+            segment_start = offset;
+        }
+
+        batch = next;
+        next = (batch == &batches[0]) ? &batches[1] : &batches[0];
+    }
+
+    if (n_events % IFAPI_EVENTLOG_CHECKPOINT_INTERVAL != 0) {
+        r = eventlog_replay_checkpoint(replay, &log[segment_start],
+                                       offset - segment_start, offset, n_events);
+        goto_if_error(r, "Store checkpoint.", error_cleanup);
+    }
+
+error_cleanup:
+    if (pool.n_workers > 0)
+        eventlog_pool_stop(&pool);
+    for (i = 0; i < 2; i++) {
+        SAFE_FREE(batches[i].elements);
+        SAFE_FREE(batches[i].lengths);
+        SAFE_FREE(batches[i].digests);
+    }
+    ifapi_eventlog_iter_finish(&iter);
+    if (r != TSS2_RC_SUCCESS) {
+        /* The PCR values are incomplete, don't use them for the next replay. */
+        eventlog_replay_truncate(replay, 0);
+    }
+    return r;
+}
+
+/** Free the memory of a replay context.
+ *
+ * The number of replay threads is kept.
+ *
+ * @param[in,out] replay The replay context.
+ */
+void
+ifapi_eventlog_replay_cleanup(IFAPI_EVENTLOG_REPLAY *replay)
+{
+    if (replay) {
+        eventlog_replay_truncate(replay, 0);
+        SAFE_FREE(replay->checkpoints);
+        SAFE_FREE(replay->pcrs);
+        replay->n_pcrs = 0;
+        replay->checkpoints_capacity = 0;
+    }
+}
+
+/** Append text to the log collected by ifapi_eventlog_get_finish.
+ *
+ * The log is kept zero terminated.
+ */
+static TSS2_RC
+eventlog_append_text(
+    IFAPI_EVENTLOG *eventlog,
+    const char *text,
+    size_t length)
+{
+    size_t capacity = eventlog->log_capacity;
+    char *log;
+
+    if (eventlog->log_size + length + 1 > capacity) {
+        if (capacity == 0)
+            capacity = 1024;
+        while (eventlog->log_size + length + 1 > capacity)
+            capacity *= 2;
+        log = realloc(eventlog->log, capacity);
+        return_if_null(log, "Out of memory", TSS2_FAPI_RC_MEMORY);
+        eventlog->log = log;
+        eventlog->log_capacity = capacity;
+    }
+    memcpy(&eventlog->log[eventlog->log_size], text, length);
+    eventlog->log_size += length;
+    eventlog->log[eventlog->log_size] = '\0';
+
     return TSS2_RC_SUCCESS;
 }
 
@@ -86,10 +1038,11 @@ ifapi_eventlog_get_async(
     eventlog->pcrListSize = pcrListSize;
     eventlog->pcrListIdx = 0;
 
-    eventlog->log = json_object_new_array();
-    return_if_null(eventlog->log, "Out of memory", TSS2_FAPI_RC_MEMORY);
-
-    return TSS2_RC_SUCCESS;
+    /* The events of all logs are collected in one JSON array. */
+    SAFE_FREE(eventlog->log);
+    eventlog->log_size = 0;
+    eventlog->log_capacity = 0;
+    return eventlog_append_text(eventlog, "[\n", 2);
 }
 
 /** Retrieve the eventlog for a given list of pcrs using asynchronous io.
@@ -123,19 +1076,26 @@ ifapi_eventlog_get_finish(
 
     TSS2_RC r;
     char *event_log_file, *logstr;
-    json_object *logpart, *event;
+    size_t logstr_size, length;
+    const char *element;
+    IFAPI_EVENTLOG_ITER iter;
 
     LOG_TRACE("called");
 
 loop:
-    /* If we're dune with adding all eventlogs to the json array, we can serialize it and return
+    /* If we're done with adding all eventlogs to the json array, we can close it and return
        it to the caller. */
     if (eventlog->pcrListIdx >= eventlog->pcrListSize) {
         LOG_TRACE("Done reading pcrLog");
-        *log = strdup(json_object_to_json_string_ext(eventlog->log, JSON_C_TO_STRING_PRETTY));
-        check_oom(*log);
-        json_object_put(eventlog->log);
+        if (eventlog->log_size > 2)
+            r = eventlog_append_text(eventlog, "\n]", 2);
+        else
+            r = eventlog_append_text(eventlog, "]", 1);
+        return_if_error(r, "Out of memory.");
+        *log = eventlog->log;
         eventlog->log = NULL;
+        eventlog->log_size = 0;
+        eventlog->log_capacity = 0;
         eventlog->state = IFAPI_EVENTLOG_STATE_INIT;
         return TSS2_RC_SUCCESS;
     }
@@ -167,30 +1127,29 @@ loop:
 
     statecase(eventlog->state, IFAPI_EVENTLOG_STATE_READING)
         /* Finish the reading of the eventlog file and return it directly to the output parameter */
-        r = ifapi_io_read_finish(io, (uint8_t **)&logstr, NULL);
+        r = ifapi_io_read_finish(io, (uint8_t **)&logstr, &logstr_size);
         return_try_again(r);
         return_if_error(r, "read_finish failed");
 
-        logpart = json_tokener_parse(logstr);
-        SAFE_FREE(logstr);
-        return_if_null(log, "JSON parsing error", TSS2_FAPI_RC_BAD_VALUE);
+        /* Append the events of the file to the eventlog. They are copied as
+           text, so no JSON objects are created for the log. */
+        eventlog_iter_start(&iter, logstr, logstr_size);
+        for (;;) {
+            r = eventlog_iter_element(&iter, &element, &length);
+            goto_if_error(r, "JSON parsing error", error_cleanup);
+            if (!element)
+                break;
 
-        /* Append the log-entry from logpart to the eventlog */
-        json_type jso_type = json_object_get_type(logpart);
-        if (jso_type != json_type_array) {
-            /* libjson-c does not deliver an array if array has only one element */
-            json_object_array_add(eventlog->log, logpart);
-        } else {
-            /* Iterate through the array of logpart and add each item to the eventlog */
-            /* The return type of json_object_array_length() was changed, thus the case */
-            for (int i = 0; i < (int)json_object_array_length(logpart); i++) {
-                event = json_object_array_get_idx(logpart, i);
-                /* Increment the refcount of event so it does not get freed on put(logpart) below */
-                json_object_get(event);
-                json_object_array_add(eventlog->log, event);
+            if (eventlog->log_size > 2) {
+                r = eventlog_append_text(eventlog, ",\n  ", 4);
+            } else {
+                r = eventlog_append_text(eventlog, "  ", 2);
             }
-            json_object_put(logpart);
+            goto_if_error(r, "Out of memory.", error_cleanup);
+            r = eventlog_append_text(eventlog, element, length);
+            goto_if_error(r, "Out of memory.", error_cleanup);
         }
+        SAFE_FREE(logstr);
 
         eventlog->pcrListIdx += 1;
         eventlog->state = IFAPI_EVENTLOG_STATE_INIT;
@@ -199,6 +1158,14 @@ loop:
     statecasedefault(eventlog->state);
     }
     return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    SAFE_FREE(logstr);
+    SAFE_FREE(eventlog->log);
+    eventlog->log_size = 0;
+    eventlog->log_capacity = 0;
+    eventlog->state = IFAPI_EVENTLOG_STATE_INIT;
+    return r;
 }
 
 /** Append an event to the existing event log.
@@ -241,8 +1208,8 @@ ifapi_eventlog_append_async(
     return_if_error(r, "Out of memory.");
 
     /* Initiate the reading of the eventlog file */
-    r = ifapi_io_read_async(io, event_log_file);
-    if (r) {
+    if (!ifapi_io_path_exists(event_log_file) ||
+        ifapi_io_read_async(io, event_log_file) != TSS2_RC_SUCCESS) {
         LOG_DEBUG("Eventlog file %s could not be opened, creating...", event_log_file);
         free(event_log_file);
         eventlog->state = IFAPI_EVENTLOG_STATE_APPENDING;
@@ -284,6 +1251,7 @@ ifapi_eventlog_append_finish(
     char *logstr = NULL, *event_log_file;
     const char *logstr2 = NULL;
     json_object *log, *event = NULL;
+    uint64_t start;
 
     switch (eventlog->state) {
     statecase(eventlog->state, IFAPI_EVENTLOG_STATE_READING)
@@ -295,10 +1263,14 @@ ifapi_eventlog_append_finish(
 
     statecase(eventlog->state, IFAPI_EVENTLOG_STATE_APPENDING)
         /* If a log was read, we deserialize it to JSON. Otherwise we start a new log. */
+        start = ifapi_timing_start();
         if (logstr) {
             log = json_tokener_parse(logstr);
             SAFE_FREE(logstr);
-            return_if_null(log, "JSON parsing error", TSS2_FAPI_RC_BAD_VALUE);
+            if (!log) {
+                ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+                return_error(TSS2_FAPI_RC_BAD_VALUE, "JSON parsing error");
+            }
 
              /* libjson-c does not deliver an array if array has only one element */
             json_type jso_type = json_object_get_type(log);
@@ -309,7 +1281,10 @@ ifapi_eventlog_append_finish(
             }
         } else {
             log = json_object_new_array();
-            return_if_null(log, "Out of memory", TSS2_FAPI_RC_MEMORY);
+            if (!log) {
+                ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+                return_error(TSS2_FAPI_RC_MEMORY, "Out of memory");
+            }
         }
 
         /* Extend the eventlog with the data */
@@ -317,6 +1292,7 @@ ifapi_eventlog_append_finish(
 
         r = ifapi_json_IFAPI_EVENT_serialize(&eventlog->event, &event);
         if (r) {
+            ifapi_timing_stop(IFAPI_TIMING_JSON, start);
             json_object_put(log);
             LOG_ERROR("Error serializing event data");
             return TSS2_FAPI_RC_GENERAL_FAILURE;
@@ -324,6 +1300,7 @@ ifapi_eventlog_append_finish(
 
         json_object_array_add(log, event);
         logstr2 = json_object_to_json_string_ext(log, JSON_C_TO_STRING_PRETTY);
+        ifapi_timing_stop(IFAPI_TIMING_JSON, start);
 
         /* Construct the filename for the eventlog file */
         r = ifapi_asprintf(&event_log_file, "%s/%s%i",
@@ -6,6 +6,7 @@
 #ifndef IFAPI_EVENTLOG_H
 #define IFAPI_EVENTLOG_H
 
+#include <stdbool.h>
 #include <json-c/json.h>
 
 #include "tss2_tpm2_types.h"
@@ -55,6 +56,62 @@ enum IFAPI_EVENTLOG_STATE {
     IFAPI_EVENTLOG_STATE_WRITING
 };
 
+/** Iterator over the events of a serialized event log.
+ *
+ * Only the event currently returned is held in parsed form, so the memory
+ * needed for walking a log does not depend on the number of events.
+ */
+typedef struct IFAPI_EVENTLOG_ITER {
+    const char *log;            /**< The JSON text of the event log */
+    size_t size;                /**< Length of log */
+    size_t pos;                 /**< Offset of the next unread character */
+    bool in_array;              /**< The log is a JSON array of events */
+    bool separator;             /**< A separator precedes the next element */
+    bool done;                  /**< All events have been returned */
+    json_tokener *tokener;      /**< Tokener reused for every event */
+} IFAPI_EVENTLOG_ITER;
+
+/** Number of events between two checkpoints of an event log replay */
+#define IFAPI_EVENTLOG_CHECKPOINT_INTERVAL 1024
+
+/** Number of events deserialized and extended by the replay threads in one
+    round; divides IFAPI_EVENTLOG_CHECKPOINT_INTERVAL */
+#define IFAPI_EVENTLOG_REPLAY_BATCH 256
+
+/** Upper bound for the number of replay threads */
+#define IFAPI_EVENTLOG_MAX_REPLAY_THREADS 64
+
+/** A virtual PCR computed from an event log
+ */
+typedef struct IFAPI_VPCR {
+    TPMI_ALG_HASH                                  bank;    /**< The PCR bank */
+    TPM2_HANDLE                                     pcr;    /**< PCR register */
+    TPM2B_DIGEST                                  value;    /**< The PCR value */
+} IFAPI_VPCR;
+
+/** The state of a replay after a prefix of an event log
+ */
+typedef struct IFAPI_EVENTLOG_CHECKPOINT {
+    size_t offset;              /**< End of the last replayed event in the log text */
+    size_t n_events;            /**< Number of replayed events */
+    TPM2B_DIGEST segment;       /**< SHA256 of the log text since the previous checkpoint */
+    TPM2B_DIGEST *values;       /**< The virtual PCR values after the replayed events */
+} IFAPI_EVENTLOG_CHECKPOINT;
+
+/** Replay state of an event log kept between verifications.
+ *
+ * A log that grows between two verifications is only replayed from the
+ * last checkpoint whose preceding log text is unchanged.
+ */
+typedef struct IFAPI_EVENTLOG_REPLAY {
+    IFAPI_VPCR *pcrs;           /**< The replayed PCRs in the order of the selection */
+    size_t n_pcrs;              /**< Number of entries in pcrs */
+    IFAPI_EVENTLOG_CHECKPOINT *checkpoints; /**< Checkpoints in ascending order */
+    size_t n_checkpoints;       /**< Number of used checkpoints */
+    size_t checkpoints_capacity; /**< Number of allocated checkpoints */
+    size_t n_threads;           /**< Number of threads replaying the log */
+} IFAPI_EVENTLOG_REPLAY;
+
 typedef struct IFAPI_EVENTLOG {
     enum IFAPI_EVENTLOG_STATE state;
     char *log_dir;
@@ -62,13 +119,17 @@ typedef struct IFAPI_EVENTLOG {
     TPM2_HANDLE pcrList[TPM2_MAX_PCRS];
     size_t pcrListSize;
     size_t pcrListIdx;
-    json_object *log;
+    char *log;                  /**< The concatenated log of the read PCRs */
+    size_t log_size;            /**< Length of log without terminator */
+    size_t log_capacity;        /**< Allocated size of log */
+    IFAPI_EVENTLOG_REPLAY replay; /**< Replay cache for quote verification */
 } IFAPI_EVENTLOG;
 
 TSS2_RC
 ifapi_eventlog_initialize(
     IFAPI_EVENTLOG *eventlog,
-    const char *log_dir);
+    const char *log_dir,
+    size_t replay_threads);
 
 TSS2_RC
 ifapi_eventlog_get_async(
@@ -94,6 +155,33 @@ ifapi_eventlog_append_finish(
     IFAPI_EVENTLOG *eventlog,
     IFAPI_IO *io);
 
+TSS2_RC
+ifapi_eventlog_iter_init(
+    IFAPI_EVENTLOG_ITER *iter,
+    const char *log,
+    size_t size);
+
+TSS2_RC
+ifapi_eventlog_iter_next(
+    IFAPI_EVENTLOG_ITER *iter,
+    IFAPI_EVENT *event,
+    bool *done);
+
+void
+ifapi_eventlog_iter_finish(
+    IFAPI_EVENTLOG_ITER *iter);
+
+TSS2_RC
+ifapi_eventlog_replay(
+    IFAPI_EVENTLOG_REPLAY *replay,
+    const TPML_PCR_SELECTION *pcr_selection,
+    const char *log,
+    size_t size);
+
+void
+ifapi_eventlog_replay_cleanup(
+    IFAPI_EVENTLOG_REPLAY *replay);
+
 void
 ifapi_cleanup_event(
     IFAPI_EVENT * event);
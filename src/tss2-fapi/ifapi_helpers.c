@@ -18,13 +18,13 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <dirent.h>
-#include <curl/curl.h>
 
 #include "tss2_mu.h"
 #include "fapi_util.h"
 #include "fapi_policy.h"
 #include "fapi_crypto.h"
 #include "ifapi_helpers.h"
+#include "ifapi_curl_cache.h"
 #include "ifapi_json_serialize.h"
 #include "ifapi_json_deserialize.h"
 #include "tpm_json_deserialize.h"
@@ -1984,8 +1984,7 @@ ifapi_check_nv_index(const char *path, TPM2_HANDLE nv_index)
  * @param[in,out] vpcr The old and the new PCR value.
  * @param[in] bank The bank corresponding to value of the event list
  *                 which will be used for computation.
- * @param[in] event The event list with the values which were extended
- *                  for a certain bank.
+ * @param[in] digests The digests of an event for all banks.
  * @retval TSS2_FAPI_RC_BAD_VALUE if the bank was not found in the event list.
  * @retval TSS2_FAPI_RC_GENERAL_FAILURE if an error occurs in the crypto library
  * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
@@ -1995,7 +1994,7 @@ TSS2_RC
 ifapi_extend_vpcr(
     TPM2B_DIGEST *vpcr,
     TPMI_ALG_HASH bank,
-    const IFAPI_EVENT *event)
+    const TPML_DIGEST_VALUES *digests)
 {
     TSS2_RC r;
     size_t i;
@@ -2004,18 +2003,18 @@ ifapi_extend_vpcr(
 
     LOGBLOB_TRACE(&vpcr->buffer[0], vpcr->size, "Old vpcr value");
 
-    for (i = 0; i < event->digests.count; i++) {
-        if (event->digests.digests[i].hashAlg == bank) {
-            event_size = ifapi_hash_get_digest_size(event->digests.digests[i].hashAlg);
+    for (i = 0; i < digests->count; i++) {
+        if (digests->digests[i].hashAlg == bank) {
+            event_size = ifapi_hash_get_digest_size(digests->digests[i].hashAlg);
 
-            LOGBLOB_TRACE(&event->digests.digests[i].digest.sha512[0], event_size,
+            LOGBLOB_TRACE(&digests->digests[i].digest.sha512[0], event_size,
                           "Extending with");
 
             r = ifapi_crypto_hash_start(&cryptoContext, bank);
             return_if_error(r, "crypto hash start");
 
             HASH_UPDATE_BUFFER(cryptoContext, &vpcr->buffer[0], vpcr->size, r, error_cleanup);
-            HASH_UPDATE_BUFFER(cryptoContext, &event->digests.digests[i].digest.sha512[0],
+            HASH_UPDATE_BUFFER(cryptoContext, &digests->digests[i].digest.sha512[0],
                                event_size, r, error_cleanup);
             r = ifapi_crypto_hash_finish(&cryptoContext, &vpcr->buffer[0], &size);
             return_if_error(r, "crypto hash finish");
@@ -2023,7 +2022,7 @@ ifapi_extend_vpcr(
             break;
         }
     }
-    if (i == event->digests.count) {
+    if (i == digests->count) {
         LOG_ERROR("No digest for bank %"PRIu16" found in event", bank);
         return TSS2_FAPI_RC_BAD_VALUE;
     }
@@ -2042,9 +2041,15 @@ error_cleanup:
  * to this event list. The PCR digest for these PCRs is computed and compared
  * with the attest passed with quote_info.
  *
- * @param[in]  jso_event_list The event list in JSON representation.
+ * The events are deserialized and extended one at a time, so the memory
+ * needed does not grow with the length of the event list. If a replay
+ * context is passed, only the events after its last still valid checkpoint
+ * are replayed.
+ *
+ * @param[in]  event_list The event list in JSON representation or NULL.
  * @param[in]  quote_info The information structure with the attest.
  * @param[out] pcr_digest The computed pcr_digest for the PCRs uses by FAPI.
+ * @param[in,out] replay The replay context kept between calls or NULL.
  *
  * @retval TSS2_RC_SUCCESS: If the PCR digest from the event list matches
  *         the PCR digest passed with the quote_info.
@@ -2058,22 +2063,15 @@ error_cleanup:
  */
 TSS2_RC
 ifapi_calculate_pcr_digest(
-    json_object *jso_event_list,
+    const char *event_list,
     const FAPI_QUOTE_INFO *quote_info,
-    TPM2B_DIGEST *pcr_digest)
+    TPM2B_DIGEST *pcr_digest,
+    IFAPI_EVENTLOG_REPLAY *replay)
 {
     TSS2_RC r;
     IFAPI_CRYPTO_CONTEXT_BLOB *cryptoContext = NULL;
-
-    struct {
-        TPMI_ALG_HASH bank;
-        TPM2_HANDLE pcr;
-        TPM2B_DIGEST value;
-    } pcrs[TPM2_MAX_PCRS];
-    size_t i, pcr, i_evt, hash_size, n_pcrs = 0, n_events = 0;
-
-    json_object *jso;
-    IFAPI_EVENT event;
+    IFAPI_EVENTLOG_REPLAY local_replay = { 0 };
+    size_t i, hash_size;
 
     const TPML_PCR_SELECTION *pcr_selection;
     TPMI_ALG_HASH pcr_digest_hash_alg;
@@ -2097,49 +2095,27 @@ ifapi_calculate_pcr_digest(
         return TSS2_FAPI_RC_BAD_VALUE;
     }
 
-    /* Initialize used pcrs */
-    for (i = 0; i < pcr_selection->count; i++) {
-        for (pcr = 0; pcr < TPM2_MAX_PCRS; pcr++) {
-            uint8_t byte_idx = pcr / 8;
-            uint8_t flag = 1 << (pcr % 8);
-            if (flag & pcr_selection->pcrSelections[i].pcrSelect[byte_idx]) {
-                hash_size = ifapi_hash_get_digest_size(pcr_selection->pcrSelections[i].hash);
-                pcrs[n_pcrs].pcr = pcr;
-                pcrs[n_pcrs].bank = pcr_selection->pcrSelections[i].hash;
-                pcrs[n_pcrs].value.size = hash_size;
-                memset(&pcrs[n_pcrs].value.buffer[0], 0, hash_size);
-                n_pcrs += 1;
-            }
-        }
-    }
+    if (!replay)
+        replay = &local_replay;
+    if (!event_list)
+        event_list = "";
 
     /* Compute pcr values based on event list */
-    if (jso_event_list) {
-        n_events = json_object_array_length(jso_event_list);
-        for (i_evt = 0; i_evt < n_events; i_evt++) {
-            jso = json_object_array_get_idx(jso_event_list, i_evt);
-            r = ifapi_json_IFAPI_EVENT_deserialize(jso, &event);
-            goto_if_error(r, "Error serialize policy", error_cleanup);
-
-            for (i = 0; i < n_pcrs; i++) {
-                 r = ifapi_extend_vpcr(&pcrs[i].value, pcrs[i].bank, &event);
-                 goto_if_error2(r, "Extending vpcr %"PRIu32, error_cleanup, pcrs[i].pcr);
-            }
-        }
-    }
+    r = ifapi_eventlog_replay(replay, pcr_selection, event_list, strlen(event_list));
+    goto_if_error(r, "Replay event list", error_cleanup);
 
     /* Compute digest for the used pcrs */
     r = ifapi_crypto_hash_start(&cryptoContext, pcr_digest_hash_alg);
-    return_if_error(r, "crypto hash start");
+    goto_if_error(r, "crypto hash start", error_cleanup);
 
-    for (i = 0; i < n_pcrs; i++) {
-        HASH_UPDATE_BUFFER(cryptoContext, &pcrs[i].value.buffer, pcrs[i].value.size,
-                           r, error_cleanup);
+    for (i = 0; i < replay->n_pcrs; i++) {
+        HASH_UPDATE_BUFFER(cryptoContext, &replay->pcrs[i].value.buffer,
+                           replay->pcrs[i].value.size, r, error_cleanup);
     }
     r = ifapi_crypto_hash_finish(&cryptoContext,
                                  (uint8_t *) &pcr_digest->buffer[0],
                                  &hash_size);
-    return_if_error(r, "crypto hash finish");
+    goto_if_error(r, "crypto hash finish", error_cleanup);
     pcr_digest->size = hash_size;
 
     /* Compare the digest from the event list with the digest from the attest */
@@ -2153,7 +2129,7 @@ ifapi_calculate_pcr_digest(
 error_cleanup:
     if (cryptoContext)
         ifapi_crypto_hash_abort(&cryptoContext);
-    ifapi_cleanup_event(&event);
+    ifapi_eventlog_replay_cleanup(&local_replay);
     return r;
 }
 
@@ -2436,40 +2412,10 @@ ifapi_cmp_public_key(
     }
 }
 
-struct CurlBufferStruct {
-  unsigned char *buffer;
-  size_t size;
-};
-
-/** Callback for copying received curl data to a buffer.
- *
- * The buffer will be reallocated according to the size of retrieved data.
- *
- * @param[in]  contents The retrieved content.
- * @param[in]  size the block size in the content.
- * @param[in]  nmemb The number of blocks.
- * @retval realsize The byte size of the data.
- */
-static size_t
-write_curl_buffer_cb(void *contents, size_t size, size_t nmemb, void *userp)
-{
-    size_t realsize = size * nmemb;
-    struct CurlBufferStruct *curl_buf = (struct CurlBufferStruct *)userp;
-
-    unsigned char *tmp_ptr = realloc(curl_buf->buffer, curl_buf->size + realsize + 1);
-    if (tmp_ptr == NULL) {
-        LOG_ERROR("Can't allocate memory in CURL callback.");
-        return 0;
-    }
-    curl_buf->buffer = tmp_ptr;
-    memcpy(&(curl_buf->buffer[curl_buf->size]), contents, realsize);
-    curl_buf->size += realsize;
-    curl_buf->buffer[curl_buf->size] = 0;
-
-    return realsize;
-}
-
 /** Get byte buffer from file system or web via curl.
+ *
+ * Resources retrieved via http(s) are served from and stored in the
+ * certificate cache, if it is enabled (see ifapi_curl_cache_get).
  *
  * @param[in]  url The url of the resource.
  * @param[out] buffer The buffer retrieved via the url.
@@ -2481,67 +2427,8 @@ write_curl_buffer_cb(void *contents, size_t size, size_t nmemb, void *userp)
 int
 ifapi_get_curl_buffer(unsigned char * url, unsigned char ** buffer,
                           size_t *buffer_size) {
-    int ret = -1;
-    struct CurlBufferStruct curl_buffer = { .size = 0, .buffer = NULL };
-
-    CURLcode rc = curl_global_init(CURL_GLOBAL_DEFAULT);
-    if (rc != CURLE_OK) {
-        LOG_ERROR("curl_global_init failed: %s", curl_easy_strerror(rc));
-        goto out_memory;
-    }
-
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        LOG_ERROR("curl_easy_init failed");
-        goto out_global_cleanup;
-    }
-
-    rc = curl_easy_setopt(curl, CURLOPT_URL, url);
-    if (rc != CURLE_OK) {
-        LOG_ERROR("curl_easy_setopt for CURLOPT_URL failed: %s",
-                curl_easy_strerror(rc));
-        goto out_easy_cleanup;
-    }
-
-    rc = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
-                          write_curl_buffer_cb);
-    if (rc != CURLE_OK) {
-        LOG_ERROR("curl_easy_setopt for CURLOPT_URL failed: %s",
-                curl_easy_strerror(rc));
-        goto out_easy_cleanup;
-    }
-
-    rc = curl_easy_setopt(curl, CURLOPT_WRITEDATA,
-                          (void *)&curl_buffer);
-    if (rc != CURLE_OK) {
-        LOG_ERROR("curl_easy_setopt for CURLOPT_URL failed: %s",
-                curl_easy_strerror(rc));
-        goto out_easy_cleanup;
-    }
-
-    if (LOGMODULE_status == LOGLEVEL_TRACE) {
-        if (CURLE_OK != curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L)) {
-            LOG_WARNING("Curl easy setopt verbose failed");
-        }
-    }
-
-    rc = curl_easy_perform(curl);
-    if (rc != CURLE_OK) {
-        LOG_ERROR("curl_easy_perform() failed: %s", curl_easy_strerror(rc));
-        goto out_easy_cleanup;
-    }
-
-    *buffer = curl_buffer.buffer;
-    *buffer_size = curl_buffer.size;
-
-    ret = 0;
-
-out_easy_cleanup:
-    if (ret != 0)
-        free(curl_buffer.buffer);
-    curl_easy_cleanup(curl);
-out_global_cleanup:
-    curl_global_cleanup();
-out_memory:
-    return ret;
+    if (ifapi_curl_cache_get((const char *)url, buffer, buffer_size) !=
+        TSS2_RC_SUCCESS)
+        return -1;
+    return 0;
 }
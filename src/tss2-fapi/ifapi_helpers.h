@@ -157,10 +157,17 @@ ifapi_filter_pcr_selection_by_index(
     const TPM2_HANDLE *pcr_index,
     size_t pcr_count);
 
+TSS2_RC
+ifapi_extend_vpcr(
+    TPM2B_DIGEST *vpcr,
+    TPMI_ALG_HASH bank,
+    const TPML_DIGEST_VALUES *digests);
+
 TSS2_RC ifapi_calculate_pcr_digest(
-    json_object *jso_event_list,
+    const char *event_list,
     const FAPI_QUOTE_INFO *quote_info,
-    TPM2B_DIGEST *pcr_digest);
+    TPM2B_DIGEST *pcr_digest,
+    IFAPI_EVENTLOG_REPLAY *replay);
 
 TSS2_RC
 ifapi_compute_policy_digest(
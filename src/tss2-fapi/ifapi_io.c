@@ -10,7 +10,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <poll.h>
@@ -26,64 +31,661 @@
 #include "ifapi_io.h"
 #include "ifapi_helpers.h"
 #include "ifapi_macros.h"
+#include "ifapi_timing.h"
 #define LOGMODULE fapi
 #include "util/log.h"
 #include "util/aux_util.h"
 
+/** The state of a job of the I/O worker pool. */
+typedef enum {
+    IFAPI_IO_JOB_QUEUED = 0,
+    IFAPI_IO_JOB_RUNNING,
+    IFAPI_IO_JOB_DONE
+} IFAPI_IO_JOB_STATE;
+
+/** The read or write of a complete file performed by a worker thread. */
+struct IFAPI_IO_JOB {
+    char *filename;              /**< The file to be read or written */
+    bool write;                  /**< Whether buffer is written to the file */
+    uint8_t *buffer;             /**< The data read or to be written */
+    size_t length;               /**< The number of bytes in buffer */
+    TSS2_RC rc;                  /**< The result of the job */
+    int error;                   /**< The errno value of a failed job */
+    int notify_fd;               /**< The pipe signalled upon completion */
+    IFAPI_IO_JOB_STATE state;    /**< Protected by the pool mutex */
+    bool abandoned;              /**< The job is freed by the worker */
+    IFAPI_IO_JOB *next;          /**< The next job in the queue */
+    IFAPI_IO_JOB *prefetch_next; /**< The next job in the prefetch list */
+};
+
+/** The worker pool shared by all FAPI contexts of the process.
+ *
+ * The workers are started on demand and joined after the last context using
+ * the pool was cleaned up.
+ */
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    IFAPI_IO_JOB *head;                       /**< The jobs not yet taken */
+    IFAPI_IO_JOB **tail;
+    size_t queued;                            /**< The length of the queue */
+    size_t idle;                              /**< Workers waiting for jobs */
+    size_t nthreads;
+    pthread_t threads[IFAPI_IO_THREADS];
+    IFAPI_IO_JOB *running[IFAPI_IO_THREADS];  /**< The job of each worker */
+    size_t users;                             /**< IO contexts with a pipe */
+    bool shutdown;                            /**< The workers are joined */
+} io_pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .tail = &io_pool.head,
+};
+
+static pthread_once_t io_pool_once = PTHREAD_ONCE_INIT;
+
+/** A directory visited by a walk and its modification time. */
+typedef struct {
+    char *path;
+    struct timespec mtime;
+} IFAPI_IO_DIRSTAMP;
+
+/** The regular files below a directory as found by ifapi_io_dirfiles_all. */
+typedef struct {
+    char *root;                  /**< The directory which was walked */
+    char **files;                /**< The paths of the files below root */
+    size_t num_files;
+    size_t files_capacity;
+    IFAPI_IO_DIRSTAMP *dirs;     /**< All directories visited by the walk */
+    size_t num_dirs;
+    size_t dirs_capacity;
+    struct timespec walked;      /**< The monotonic time of the walk */
+    bool racy;                   /**< A directory changed too recently */
+    TSS2_RC rc;
+} IFAPI_IO_DIRTREE;
+
+/** The trees of recent walks; a tree stays valid as long as none of its
+    directories was modified and IFAPI_IO_DIRCACHE_TTL has not passed. */
+static struct {
+    pthread_mutex_t mutex;
+    IFAPI_IO_DIRTREE *trees[IFAPI_IO_DIRCACHE_SIZE];
+} io_dircache = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void
+io_job_free(IFAPI_IO_JOB *job)
+{
+    SAFE_FREE(job->filename);
+    SAFE_FREE(job->buffer);
+    free(job);
+}
+
+/** Signal the completion of a job; a full pipe will wake up the poll anyway. */
+static void
+io_notify(int fd)
+{
+    if (write(fd, "", 1) < 0)
+        LOG_TRACE("Notification pipe not written: %i", errno);
+}
+
+/** Read a complete file in a worker thread. */
+static void
+io_job_read(IFAPI_IO_JOB *job)
+{
+    struct stat fbuffer;
+    size_t size, idx = 0;
+    ssize_t ret;
+    int fd;
+
+    job->rc = TSS2_FAPI_RC_IO_ERROR;
+    fd = open(job->filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        job->error = errno;
+        return;
+    }
+    /* Locking the file. Lock will be release upon close */
+    if ((lockf(fd, F_TLOCK, 0) == -1 && errno == EAGAIN) ||
+        fstat(fd, &fbuffer) != 0) {
+        job->error = errno;
+        close(fd);
+        return;
+    }
+
+    size = fbuffer.st_size;
+    job->buffer = malloc(size + 1);
+    if (job->buffer == NULL) {
+        job->rc = TSS2_FAPI_RC_MEMORY;
+        job->error = ENOMEM;
+        close(fd);
+        return;
+    }
+
+    while (idx < size) {
+        ret = read(fd, &job->buffer[idx], size - idx);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            job->error = errno;
+            close(fd);
+            SAFE_FREE(job->buffer);
+            return;
+        }
+        /* The file was truncated in the meantime. */
+        if (ret == 0)
+            break;
+        idx += ret;
+    }
+    close(fd);
+
+    job->buffer[idx] = '\0';
+    job->length = idx;
+    job->rc = TSS2_RC_SUCCESS;
+}
+
+/** Write a complete file in a worker thread. */
+static void
+io_job_write(IFAPI_IO_JOB *job)
+{
+    size_t idx = 0;
+    ssize_t ret;
+    int fd;
+
+    job->rc = TSS2_FAPI_RC_IO_ERROR;
+    fd = open(job->filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        job->error = errno;
+        return;
+    }
+    /* Locking the file. Lock will be release upon close */
+    if (lockf(fd, F_TLOCK, 0) == -1 && errno == EAGAIN) {
+        job->error = errno;
+        close(fd);
+        return;
+    }
+
+    while (idx < job->length) {
+        ret = write(fd, &job->buffer[idx], job->length - idx);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            job->error = errno;
+            close(fd);
+            return;
+        }
+        idx += ret;
+    }
+    if (close(fd) != 0) {
+        job->error = errno;
+        return;
+    }
+    job->rc = TSS2_RC_SUCCESS;
+}
+
+/** Perform a job and account its time to the I/O phase. */
+static void
+io_job_run(IFAPI_IO_JOB *job)
+{
+    uint64_t start = ifapi_timing_start();
+
+    if (job->write)
+        io_job_write(job);
+    else
+        io_job_read(job);
+    ifapi_timing_stop(IFAPI_TIMING_IO, start);
+}
+
+/** Mark a job as done and notify its context; called with the mutex held. */
+static void
+io_job_complete(IFAPI_IO_JOB *job)
+{
+    job->state = IFAPI_IO_JOB_DONE;
+    if (job->abandoned) {
+        io_job_free(job);
+        return;
+    }
+    io_notify(job->notify_fd);
+}
+
+/** Take the next job from the queue; called with the mutex held. */
+static IFAPI_IO_JOB *
+io_pool_take(void)
+{
+    IFAPI_IO_JOB *job = io_pool.head;
+
+    io_pool.head = job->next;
+    if (io_pool.head == NULL)
+        io_pool.tail = &io_pool.head;
+    io_pool.queued -= 1;
+    job->state = IFAPI_IO_JOB_RUNNING;
+    return job;
+}
+
+static void *
+io_worker(void *arg)
+{
+    size_t slot = (uintptr_t) arg;
+    IFAPI_IO_JOB *job;
+
+    pthread_mutex_lock(&io_pool.mutex);
+    for (;;) {
+        while (io_pool.head == NULL && !io_pool.shutdown)
+            pthread_cond_wait(&io_pool.cond, &io_pool.mutex);
+        if (io_pool.head == NULL)
+            break;
+
+        job = io_pool_take();
+        io_pool.idle -= 1;
+        io_pool.running[slot] = job;
+        pthread_mutex_unlock(&io_pool.mutex);
+
+        io_job_run(job);
+
+        pthread_mutex_lock(&io_pool.mutex);
+        io_pool.running[slot] = NULL;
+        io_pool.idle += 1;
+        io_job_complete(job);
+    }
+    io_pool.idle -= 1;
+    pthread_mutex_unlock(&io_pool.mutex);
+    return NULL;
+}
+
+/** Start a thread which does not receive any signals of the application. */
+static int
+io_thread_create(pthread_t *thread, void *(*start)(void *), void *arg)
+{
+    sigset_t all, old;
+    int rc;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    rc = pthread_create(thread, NULL, start, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return rc;
+}
+
+/** Start workers for the queued jobs; called with the mutex held. */
+static void
+io_pool_spawn(void)
+{
+    int rc;
+
+    if (io_pool.shutdown)
+        return;
+
+    while (io_pool.queued > io_pool.idle && io_pool.nthreads < IFAPI_IO_THREADS) {
+        rc = io_thread_create(&io_pool.threads[io_pool.nthreads], io_worker,
+                              (void *)(uintptr_t) io_pool.nthreads);
+        if (rc != 0) {
+            LOG_WARNING("I/O worker could not be started: %i", rc);
+            break;
+        }
+        io_pool.nthreads += 1;
+        io_pool.idle += 1;
+    }
+}
+
+static void
+io_pool_prepare_fork(void)
+{
+    pthread_mutex_lock(&io_dircache.mutex);
+    pthread_mutex_lock(&io_pool.mutex);
+}
+
+static void
+io_pool_parent_fork(void)
+{
+    pthread_mutex_unlock(&io_pool.mutex);
+    pthread_mutex_unlock(&io_dircache.mutex);
+}
+
+/** The workers do not exist in a forked child.
+ *
+ * The jobs they were running may have been done partly, e.g. a file may be
+ * half written, and are completed by the parent's workers. They fail in the
+ * child instead of being done a second time.
+ */
+static void
+io_pool_child_fork(void)
+{
+    size_t i;
+
+    for (i = 0; i < IFAPI_IO_THREADS; i++) {
+        IFAPI_IO_JOB *job = io_pool.running[i];
+
+        if (job == NULL)
+            continue;
+        io_pool.running[i] = NULL;
+        job->rc = TSS2_FAPI_RC_IO_ERROR;
+        job->error = ECANCELED;
+        if (!job->write) {
+            SAFE_FREE(job->buffer);
+            job->length = 0;
+        }
+        /* The child's context opens its own notification pipe and finds
+           the job done; writing to the parent's pipe would wake it up. */
+        job->state = IFAPI_IO_JOB_DONE;
+        if (job->abandoned)
+            io_job_free(job);
+    }
+    io_pool.nthreads = 0;
+    io_pool.idle = 0;
+    io_pool.shutdown = false;
+    pthread_cond_init(&io_pool.cond, NULL);
+    pthread_mutex_unlock(&io_pool.mutex);
+    pthread_mutex_unlock(&io_dircache.mutex);
+}
+
+static void
+io_pool_register_fork(void)
+{
+    if (pthread_atfork(io_pool_prepare_fork, io_pool_parent_fork,
+                       io_pool_child_fork) != 0)
+        LOG_WARNING("Fork handlers of the I/O workers not registered.");
+}
+
+/** Queue a job. If no worker can be started the job is performed directly. */
+static void
+io_pool_submit(IFAPI_IO_JOB *job)
+{
+    pthread_mutex_lock(&io_pool.mutex);
+    job->state = IFAPI_IO_JOB_QUEUED;
+    job->next = NULL;
+    *io_pool.tail = job;
+    io_pool.tail = &job->next;
+    io_pool.queued += 1;
+
+    io_pool_spawn();
+    if (io_pool.nthreads > 0) {
+        pthread_cond_signal(&io_pool.cond);
+        pthread_mutex_unlock(&io_pool.mutex);
+        return;
+    }
+
+    while (io_pool.head) {
+        job = io_pool_take();
+        pthread_mutex_unlock(&io_pool.mutex);
+        io_job_run(job);
+        pthread_mutex_lock(&io_pool.mutex);
+        io_job_complete(job);
+    }
+    pthread_mutex_unlock(&io_pool.mutex);
+}
+
+/** Drop a job the context is no longer interested in; called with the mutex held. */
+static void
+io_job_abandon(IFAPI_IO_JOB *job)
+{
+    IFAPI_IO_JOB **link;
+
+    switch (job->state) {
+    case IFAPI_IO_JOB_QUEUED:
+        for (link = &io_pool.head; *link != job; link = &(*link)->next);
+        *link = job->next;
+        if (io_pool.tail == &job->next)
+            io_pool.tail = link;
+        io_pool.queued -= 1;
+        io_job_free(job);
+        break;
+    case IFAPI_IO_JOB_RUNNING:
+        job->abandoned = true;
+        break;
+    default:
+        io_job_free(job);
+    }
+}
+
+/** Release the pool; the workers are joined if no context uses it anymore. */
+static void
+io_pool_release(void)
+{
+    pthread_t threads[IFAPI_IO_THREADS];
+    size_t i, n;
+
+    pthread_mutex_lock(&io_pool.mutex);
+    io_pool.users -= 1;
+    if (io_pool.users > 0 || io_pool.shutdown || io_pool.nthreads == 0) {
+        pthread_mutex_unlock(&io_pool.mutex);
+        return;
+    }
+    io_pool.shutdown = true;
+    n = io_pool.nthreads;
+    memcpy(&threads[0], &io_pool.threads[0], n * sizeof(threads[0]));
+    pthread_cond_broadcast(&io_pool.cond);
+    pthread_mutex_unlock(&io_pool.mutex);
+
+    for (i = 0; i < n; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_lock(&io_pool.mutex);
+    io_pool.nthreads = 0;
+    io_pool.shutdown = false;
+    /* Jobs of contexts which started using the pool in the meantime. */
+    io_pool_spawn();
+    pthread_mutex_unlock(&io_pool.mutex);
+}
+
+static TSS2_RC
+io_pipe_create(int fds[2])
+{
+    int i, flags;
+
+    if (pipe(fds) != 0) {
+        LOG_ERROR("Pipe could not be created: %i", errno);
+        return TSS2_FAPI_RC_IO_ERROR;
+    }
+    for (i = 0; i < 2; i++) {
+        flags = fcntl(fds[i], F_GETFL, 0);
+        if (flags < 0 || fcntl(fds[i], F_SETFL, flags | O_NONBLOCK) < 0 ||
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC) < 0) {
+            LOG_ERROR("fcntl failed with %d", errno);
+            close(fds[0]);
+            close(fds[1]);
+            return TSS2_FAPI_RC_IO_ERROR;
+        }
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Create the pipe used by the workers to signal the completion of jobs.
+ *
+ * A forked child gets its own pipe; otherwise parent and child would consume
+ * the notifications of each other.
+ */
+static TSS2_RC
+io_notify_open(IFAPI_IO *io)
+{
+    IFAPI_IO_JOB *job;
+    int fds[2];
+    pid_t pid = getpid();
+    bool forked = io->notify_open;
+    TSS2_RC r;
+
+    if (io->notify_open && io->notify_pid == pid)
+        return TSS2_RC_SUCCESS;
+
+    pthread_once(&io_pool_once, io_pool_register_fork);
+    r = io_pipe_create(fds);
+    if (r != TSS2_RC_SUCCESS) {
+        if (forked)
+            ifapi_io_cleanup(io);
+        return r;
+    }
+
+    pthread_mutex_lock(&io_pool.mutex);
+    if (forked) {
+        if (io->job)
+            io->job->notify_fd = fds[1];
+        for (job = io->prefetched; job; job = job->prefetch_next)
+            job->notify_fd = fds[1];
+    } else {
+        io_pool.users += 1;
+    }
+    pthread_mutex_unlock(&io_pool.mutex);
+
+    if (forked) {
+        close(io->notify[0]);
+        close(io->notify[1]);
+    }
+    io->notify[0] = fds[0];
+    io->notify[1] = fds[1];
+    io->notify_open = true;
+    io->notify_pid = pid;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Hand a read or write of a complete file to the worker pool. */
+static TSS2_RC
+io_job_start(
+    IFAPI_IO *io,
+    const char *filename,
+    bool write,
+    const uint8_t *buffer,
+    size_t length,
+    IFAPI_IO_JOB **job)
+{
+    TSS2_RC r;
+
+    r = io_notify_open(io);
+    return_if_error(r, "Initialize I/O context.");
+
+    *job = calloc(1, sizeof(**job));
+    return_if_null(*job, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+    (*job)->filename = strdup(filename);
+    if ((*job)->filename == NULL) {
+        SAFE_FREE(*job);
+        return_error(TSS2_FAPI_RC_MEMORY, "Out of memory.");
+    }
+    if (write) {
+        (*job)->buffer = malloc(length);
+        if ((*job)->buffer == NULL && length > 0) {
+            io_job_free(*job);
+            *job = NULL;
+            LOG_ERROR("Memory could not be allocated. %zi bytes requested", length);
+            return TSS2_FAPI_RC_MEMORY;
+        }
+        if (length > 0)
+            memcpy((*job)->buffer, buffer, length);
+        (*job)->length = length;
+    }
+    (*job)->write = write;
+    (*job)->notify_fd = io->notify[1];
+
+    io_pool_submit(*job);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Make a job the current operation of the context.
+ *
+ * A job left behind by a state machine that was not finished is dropped.
+ */
+static void
+io_set_job(IFAPI_IO *io, IFAPI_IO_JOB *job)
+{
+    if (io->job) {
+        LOG_DEBUG("Dropping unfinished I/O of %s", io->job->filename);
+        pthread_mutex_lock(&io_pool.mutex);
+        io_job_abandon(io->job);
+        pthread_mutex_unlock(&io_pool.mutex);
+    }
+    io->job = job;
+}
+
+/** Check whether the current job of the context is done.
+ *
+ * @retval TSS2_RC_SUCCESS if the job is done and was detached from the context.
+ * @retval TSS2_FAPI_RC_TRY_AGAIN if the job is still in progress.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE if no job was started.
+ */
+static TSS2_RC
+io_job_wait(IFAPI_IO *io, IFAPI_IO_JOB **job)
+{
+    char drain[16];
+    bool done;
+    TSS2_RC r;
+
+    if (io->job == NULL) {
+        LOG_ERROR("No file I/O in progress.");
+        return TSS2_FAPI_RC_BAD_SEQUENCE;
+    }
+
+    r = io_notify_open(io);
+    return_if_error(r, "Initialize I/O context.");
+
+    io->pollevents = POLLIN;
+    if (_ifapi_io_retry-- > 0) {
+        /* A poll for the simulated delay has to return. */
+        io_notify(io->notify[1]);
+        return TSS2_FAPI_RC_TRY_AGAIN;
+    } else
+        _ifapi_io_retry = _IFAPI_IO_RETRIES;
+
+    /* Drain the pipe first, so a completion after the check below will be
+       visible to the next poll. */
+    while (read(io->notify[0], &drain[0], sizeof(drain)) > 0);
+
+    pthread_mutex_lock(&io_pool.mutex);
+    done = io->job->state == IFAPI_IO_JOB_DONE;
+    if (!done)
+        /* The workers might have been lost by a fork. */
+        io_pool_spawn();
+    pthread_mutex_unlock(&io_pool.mutex);
+    if (!done)
+        return TSS2_FAPI_RC_TRY_AGAIN;
+
+    io->pollevents = 0;
+    *job = io->job;
+    io->job = NULL;
+    if ((*job)->rc != TSS2_RC_SUCCESS) {
+        LOG_ERROR("%s file \"%s\" failed: %s", (*job)->write ? "Writing" : "Reading",
+                  (*job)->filename, strerror((*job)->error));
+    }
+    return TSS2_RC_SUCCESS;
+}
+
 /** Start reading a file's complete content into memory in an asynchronous way.
+ *
+ * The file is read by a worker thread; the completion is signalled via the
+ * poll handle of the context. If the same file was passed to
+ * ifapi_io_read_prefetch before, the read already started is used;
+ * otherwise all prefetched reads are dropped.
  *
  * @param[in,out] io The input/output context being used for file I/O.
  * @param[in] filename The name of the file to be read into memory.
  * @retval TSS2_RC_SUCCESS: if the function call was a success.
- * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered; such as the file was not found.
- * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
+ * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered.
+ * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated.
  */
 TSS2_RC
 ifapi_io_read_async(
     struct IFAPI_IO *io,
     const char *filename)
 {
+    IFAPI_IO_JOB **link, *job;
+    TSS2_RC r;
+
     if (io->char_rbuffer) {
         LOG_ERROR("rbuffer still in use; maybe use of old API.");
         return TSS2_FAPI_RC_IO_ERROR;
     }
 
-    io->stream = fopen(filename, "rt");
-    if (io->stream == NULL) {
-        LOG_ERROR("File \"%s\" not found.", filename);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
-    /* Locking the file. Lock will be release upon close */
-    if (lockf(fileno(io->stream), F_TLOCK, 0) == -1 && errno == EAGAIN) {
-        LOG_ERROR("File %s currently locked.", filename);
-        fclose(io->stream);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
-
-    fseek(io->stream, 0L, SEEK_END);
-    long length = ftell(io->stream);
-    fclose(io->stream);
-
-    io->stream = fopen(filename, "rt");
-    io->char_rbuffer = malloc (length + 1);
-    if (io->char_rbuffer == NULL) {
-        fclose(io->stream);
-        io->stream = NULL;
-        LOG_ERROR("Memory could not be allocated. %li bytes requested", length + 1);
-        return TSS2_FAPI_RC_MEMORY;
-    }
-
-    int rc, flags = fcntl(fileno(io->stream), F_GETFL, 0);
-    rc = fcntl(fileno(io->stream), F_SETFL, flags | O_NONBLOCK);
-    if (rc < 0) {
-        LOG_ERROR("fcntl failed with %d", errno);
-        return TSS2_FAPI_RC_IO_ERROR;
+    for (link = &io->prefetched; *link; link = &(*link)->prefetch_next) {
+        if (strcmp((*link)->filename, filename) == 0) {
+            job = *link;
+            *link = job->prefetch_next;
+            io->n_prefetched -= 1;
+            io_set_job(io, job);
+            return TSS2_RC_SUCCESS;
+        }
     }
+    /* The prefetched files are not read in the expected order; they might
+       be outdated when they are eventually requested. */
+    ifapi_io_prefetch_cancel(io);
 
-    io->buffer_length = length;
-    io->buffer_idx = 0;
-    io->char_rbuffer[length] = '\0';
+    r = io_job_start(io, filename, false, NULL, 0, &job);
+    return_if_error2(r, "Read %s.", filename);
 
+    io_set_job(io, job);
     return TSS2_RC_SUCCESS;
 }
 
@@ -96,8 +698,10 @@ ifapi_io_read_async(
  * @param[out] length The length of the data that was read from file.
  * @retval TSS2_RC_SUCCESS: if the function call was a success.
  * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered; such as the file was not found.
+ * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
  * @retval TSS2_FAPI_RC_TRY_AGAIN: if the asynchronous operation is not yet complete.
  *         Call this function again later.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE: if no read was started.
  */
 TSS2_RC
 ifapi_io_read_finish(
@@ -105,54 +709,102 @@ ifapi_io_read_finish(
     uint8_t **buffer,
     size_t *length)
 {
-    io->pollevents = POLLIN;
-    if (_ifapi_io_retry-- > 0)
-        return TSS2_FAPI_RC_TRY_AGAIN;
-    else
-        _ifapi_io_retry = _IFAPI_IO_RETRIES;
+    IFAPI_IO_JOB *job;
+    TSS2_RC r;
 
-    ssize_t ret = read(fileno(io->stream),
-                       &io->char_rbuffer[io->buffer_idx],
-                       io->buffer_length - io->buffer_idx);
-    if (ret < 0 && (errno == EINTR || errno == EAGAIN))
-        return TSS2_FAPI_RC_TRY_AGAIN;
+    r = io_job_wait(io, &job);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
 
-    if (ret < 0) {
-        LOG_ERROR("Error reading from file: %i.", errno);
-        fclose(io->stream);
-        io->pollevents = 0;
-        SAFE_FREE(io->char_rbuffer);
-        return TSS2_FAPI_RC_IO_ERROR;
+    r = job->rc;
+    if (r != TSS2_RC_SUCCESS) {
+        io_job_free(job);
+        return r;
     }
 
-    io->pollevents = 0;
-    io->buffer_idx += ret;
-    if (io->buffer_idx < io->buffer_length)
-        return TSS2_FAPI_RC_TRY_AGAIN;
-
-    fclose(io->stream);
-
     if (!buffer) {
         LOG_WARNING("The old file read API is still being used");
+        io->char_rbuffer = (char *)job->buffer;
+    } else {
+        *buffer = job->buffer;
+        if (length)
+            *length = job->length;
+    }
+    job->buffer = NULL;
+    io_job_free(job);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Start reading a file which will probably be read next.
+ *
+ * Up to IFAPI_IO_PREFETCH_MAX files are read concurrently with the current
+ * operation of the context. Further requests are ignored.
+ *
+ * @param[in,out] io The input/output context being used for file I/O.
+ * @param[in] filename The name of the file to be read into memory.
+ * @retval TSS2_RC_SUCCESS: if the function call was a success.
+ * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered.
+ * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated.
+ */
+TSS2_RC
+ifapi_io_read_prefetch(
+    struct IFAPI_IO *io,
+    const char *filename)
+{
+    IFAPI_IO_JOB *job;
+    TSS2_RC r;
+
+    if (io->n_prefetched >= IFAPI_IO_PREFETCH_MAX)
         return TSS2_RC_SUCCESS;
+    for (job = io->prefetched; job; job = job->prefetch_next) {
+        if (strcmp(job->filename, filename) == 0)
+            return TSS2_RC_SUCCESS;
     }
-    *buffer = (uint8_t *)io->char_rbuffer;
-    io->char_rbuffer = NULL;
 
-    if (length)
-        *length = io->buffer_length;
+    r = io_job_start(io, filename, false, NULL, 0, &job);
+    return_if_error2(r, "Prefetch %s.", filename);
 
+    job->prefetch_next = io->prefetched;
+    io->prefetched = job;
+    io->n_prefetched += 1;
     return TSS2_RC_SUCCESS;
 }
 
+/** Drop all reads started by ifapi_io_read_prefetch and not used since.
+ *
+ * @param[in,out] io The input/output context being used for file I/O.
+ */
+void
+ifapi_io_prefetch_cancel(
+    struct IFAPI_IO *io)
+{
+    IFAPI_IO_JOB *job;
+
+    if (io->prefetched == NULL)
+        return;
+
+    pthread_mutex_lock(&io_pool.mutex);
+    while (io->prefetched) {
+        job = io->prefetched;
+        io->prefetched = job->prefetch_next;
+        io_job_abandon(job);
+    }
+    pthread_mutex_unlock(&io_pool.mutex);
+    io->n_prefetched = 0;
+}
+
 /** Start writing a buffer into a file in an asynchronous way.
+ *
+ * The buffer is copied and written by a worker thread. Prefetched reads are
+ * dropped because they might deliver the old content of the file.
  *
  * @param[in,out] io The input/output context being used for file I/O.
  * @param[in] filename The name of the file to be read into memory.
  * @param[in] buffer The buffer to be written.
  * @param[in] length The number of bytes to be written.
  * @retval TSS2_RC_SUCCESS: if the function call was a success.
- * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered; such as the file was not found.
+ * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered.
  * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
  */
 TSS2_RC
@@ -162,40 +814,20 @@ ifapi_io_write_async(
     const uint8_t *buffer,
     size_t length)
 {
+    IFAPI_IO_JOB *job;
+    TSS2_RC r;
+
     if (io->char_rbuffer) {
         LOG_ERROR("rbuffer still in use; maybe use of old API.");
         return TSS2_FAPI_RC_IO_ERROR;
     }
 
-    io->buffer_length = length;
-    io->buffer_idx = 0;
-    io->char_rbuffer = malloc(length);
-    if (io->char_rbuffer == NULL) {
-        LOG_ERROR("Memory could not be allocated. %zi bytes requested", length);
-        return TSS2_FAPI_RC_MEMORY;
-    }
-    memcpy(io->char_rbuffer, buffer, length);
+    ifapi_io_prefetch_cancel(io);
 
-    io->stream = fopen(filename, "wt");
-    if (io->stream == NULL) {
-        SAFE_FREE(io->char_rbuffer);
-        LOG_ERROR("Could not open file \"%s\" for writing.", filename);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
-    /* Locking the file. Lock will be release upon close */
-    if (lockf(fileno(io->stream), F_TLOCK, 0) == -1 && errno == EAGAIN) {
-        LOG_ERROR("File %s currently locked.", filename);
-        fclose(io->stream);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
+    r = io_job_start(io, filename, true, buffer, length, &job);
+    return_if_error2(r, "Write %s.", filename);
 
-    /* Use non blocking IO, so asynchronous write will be needed */
-    int rc, flags = fcntl(fileno(io->stream), F_GETFL, 0);
-    rc = fcntl(fileno(io->stream), F_SETFL, flags | O_NONBLOCK);
-    if (rc < 0) {
-        LOG_ERROR("fcntl failed with %d", errno);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
+    io_set_job(io, job);
     return TSS2_RC_SUCCESS;
 }
 
@@ -208,40 +840,52 @@ ifapi_io_write_async(
  * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered; such as the file was not found.
  * @retval TSS2_FAPI_RC_TRY_AGAIN: if the asynchronous operation is not yet complete.
  *         Call this function again later.
+ * @retval TSS2_FAPI_RC_BAD_SEQUENCE: if no write was started.
  */
 TSS2_RC
 ifapi_io_write_finish(
     struct IFAPI_IO *io)
 {
-    io->pollevents = POLLOUT;
-    if (_ifapi_io_retry-- > 0)
-        return TSS2_FAPI_RC_TRY_AGAIN;
-    else
-        _ifapi_io_retry = _IFAPI_IO_RETRIES;
-
-    ssize_t ret = write(fileno(io->stream),
-                        &io->char_rbuffer[io->buffer_idx],
-                        io->buffer_length - io->buffer_idx);
-    if (ret < 0 && (errno == EINTR || errno == EAGAIN))
-        return TSS2_FAPI_RC_TRY_AGAIN;
+    IFAPI_IO_JOB *job;
+    TSS2_RC r;
 
-    if (ret < 0) {
-        LOG_ERROR("Error writing to file: %i.", errno);
-        fclose(io->stream);
-        io->pollevents = 0;
-        SAFE_FREE(io->char_rbuffer);
-        return TSS2_FAPI_RC_IO_ERROR;
-    }
+    r = io_job_wait(io, &job);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
 
-    io->pollevents = 0;
-    io->buffer_idx += ret;
-    if (io->buffer_idx < io->buffer_length)
-        return TSS2_FAPI_RC_TRY_AGAIN;
+    r = job->rc;
+    io_job_free(job);
+    return r;
+}
 
+/** Release the resources of an input/output context.
+ *
+ * Operations still in progress are dropped; the worker threads are stopped
+ * if no other context uses them.
+ *
+ * @param[in,out] io The input/output context being used for file I/O.
+ */
+void
+ifapi_io_cleanup(IFAPI_IO *io)
+{
     SAFE_FREE(io->char_rbuffer);
-    fclose(io->stream);
+    io->pollevents = 0;
+    if (!io->notify_open)
+        return;
+
+    ifapi_io_prefetch_cancel(io);
+    if (io->job) {
+        pthread_mutex_lock(&io_pool.mutex);
+        io_job_abandon(io->job);
+        pthread_mutex_unlock(&io_pool.mutex);
+        io->job = NULL;
+    }
 
-    return TSS2_RC_SUCCESS;
+    /* Workers only write to the pipe for jobs which were not abandoned. */
+    close(io->notify[0]);
+    close(io->notify[1]);
+    io->notify_open = false;
+    io_pool_release();
 }
 
 /** Check whether a file is writeable.
@@ -459,141 +1103,418 @@ error_oom:
     return TSS2_FAPI_RC_MEMORY;
 }
 
-/** Get a linked list of files in a directory and all sub directories.
+/** Append a path to an array which is grown as needed.
  *
- * Enumerage the regular files (no directories, symlinks etc) from a given directory.
+ * The path is freed if the array cannot be grown.
+ */
+static TSS2_RC
+io_append_path(char ***paths, size_t *num, size_t *capacity, char *path)
+{
+    char **grown;
+
+    if (*num == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 16;
+        grown = realloc(*paths, *capacity * sizeof(**paths));
+        if (grown == NULL) {
+            free(path);
+            return_error(TSS2_FAPI_RC_MEMORY, "Out of memory.");
+        }
+        *paths = grown;
+    }
+    (*paths)[(*num)++] = path;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+dirtree_free(IFAPI_IO_DIRTREE *tree)
+{
+    size_t i;
+
+    if (tree == NULL)
+        return;
+    for (i = 0; i < tree->num_files; i++)
+        free(tree->files[i]);
+    for (i = 0; i < tree->num_dirs; i++)
+        free(tree->dirs[i].path);
+    SAFE_FREE(tree->files);
+    SAFE_FREE(tree->dirs);
+    SAFE_FREE(tree->root);
+    free(tree);
+}
+
+/** Record a visited directory and its modification time. */
+static TSS2_RC
+dirtree_add_dir(IFAPI_IO_DIRTREE *tree, const char *path, const struct stat *fbuffer,
+                time_t racy_after)
+{
+    IFAPI_IO_DIRSTAMP *grown;
+
+    if (tree->num_dirs == tree->dirs_capacity) {
+        tree->dirs_capacity = tree->dirs_capacity ? 2 * tree->dirs_capacity : 8;
+        grown = realloc(tree->dirs, tree->dirs_capacity * sizeof(*grown));
+        return_if_null(grown, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+        tree->dirs = grown;
+    }
+    tree->dirs[tree->num_dirs].path = strdup(path);
+    return_if_null(tree->dirs[tree->num_dirs].path, "Out of memory.",
+                   TSS2_FAPI_RC_MEMORY);
+    tree->dirs[tree->num_dirs].mtime = fbuffer->st_mtim;
+    tree->num_dirs += 1;
+
+    /* A second change within the timestamp granularity would go unnoticed. */
+    if (fbuffer->st_mtim.tv_sec >= racy_after)
+        tree->racy = true;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Collect the files below an open directory.
  *
- * @param[in]  dir_name The directory to list files from.
- * @param[out] list  The linked list with the file names.
- * @param[out] n The number of filesl
- * @retval TSS2_RC_SUCCESS if the directories were successfully removed
- * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
+ * Sub directories are opened relative to their parent; entries are only
+ * stat'ed if the file system does not report their type. Directories which
+ * cannot be opened are skipped. The descriptor is closed in any case.
  */
 static TSS2_RC
-dirfiles_all(const char *dir_name, NODE_OBJECT_T **list, size_t *n)
+dirtree_walk(IFAPI_IO_DIRTREE *tree, int fd, const char *dir_name, time_t racy_after)
 {
     DIR *dir;
     struct dirent *entry;
+    struct stat fbuffer;
     TSS2_RC r;
     char *path;
-    NODE_OBJECT_T *second;
+    bool is_dir;
+    int sub_fd;
 
-    if (!(dir = opendir(dir_name))) {
+    if (fstat(fd, &fbuffer) != 0 || !(dir = fdopendir(fd))) {
+        close(fd);
         return TSS2_RC_SUCCESS;
     }
+    r = dirtree_add_dir(tree, dir_name, &fbuffer, racy_after);
+    goto_if_error(r, "Record directory.", cleanup);
 
     /* Iterating through the list of entries inside the directory. */
     while ((entry = readdir(dir)) != NULL) {
-        path = NULL;
-        if (entry->d_type == DT_DIR) {
-            /* Recursive call for sub directories */
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-                continue;
-            r = ifapi_asprintf(&path, "%s/%s", dir_name, entry->d_name);
-            if (r)
-                closedir(dir);
-            return_if_error(r, "Out of memory");
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
 
-            LOG_TRACE("Directory: %s", path);
-            r = dirfiles_all(path, list, n);
-            SAFE_FREE(path);
-            if (r)
-                closedir(dir);
-            return_if_error(r, "get_entities");
+        is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+            is_dir = fstatat(dirfd(dir), entry->d_name, &fbuffer,
+                             AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(fbuffer.st_mode);
 
-        } else {
-            r = ifapi_asprintf(&path, "%s/%s", dir_name, entry->d_name);
-            if (r)
-                closedir(dir);
-            return_if_error(r, "Out of memory");
+        r = ifapi_asprintf(&path, "%s/%s", dir_name, entry->d_name);
+        goto_if_error(r, "Out of memory", cleanup);
 
-            NODE_OBJECT_T *file_obj = calloc(sizeof(NODE_OBJECT_T), 1);
-            if (!file_obj) {
-                LOG_ERROR("Out of memory.");
-                SAFE_FREE(path);
-                closedir(dir);
-                return TSS2_FAPI_RC_MEMORY;
-            }
-
-            *n += 1;
-            /* Add file name to linked list */
-            file_obj->object = strdup(path);
-            if (file_obj->object == NULL) {
-                LOG_ERROR("Out of memory.");
-                SAFE_FREE(file_obj);
-                SAFE_FREE(path);
-                closedir(dir);
-                return TSS2_FAPI_RC_MEMORY;
-            }
-            if (*list != NULL) {
-                second = *list;
-                file_obj->next = second;
-            }
-            *list = file_obj;
+        if (is_dir) {
+            /* Recursive call for sub directories */
+            LOG_TRACE("Directory: %s", path);
+            sub_fd = openat(dirfd(dir), entry->d_name,
+                            O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (sub_fd >= 0)
+                r = dirtree_walk(tree, sub_fd, path, racy_after);
+            free(path);
+            goto_if_error(r, "get_entities", cleanup);
+        } else {
             LOG_TRACE("File: %s", path);
-            SAFE_FREE(path);
+            r = io_append_path(&tree->files, &tree->num_files, &tree->files_capacity,
+                               path);
+            goto_if_error(r, "Add file name to list", cleanup);
         }
     }
+
+cleanup:
     closedir(dir);
+    return r;
+}
+
+/** Walk a directory tree; the signature allows running it as a thread. */
+static void *
+dirtree_build(void *arg)
+{
+    IFAPI_IO_DIRTREE *tree = arg;
+    struct timespec now;
+    int fd;
+
+    clock_gettime(CLOCK_MONOTONIC, &tree->walked);
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    fd = open(tree->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        /* The absence of a directory is not tracked by the cache. */
+        tree->racy = true;
+        tree->rc = TSS2_RC_SUCCESS;
+        return NULL;
+    }
+    tree->rc = dirtree_walk(tree, fd, tree->root, now.tv_sec - IFAPI_IO_DIRCACHE_RACY);
+    return NULL;
+}
+
+/** Check whether a cached tree still matches the file system. */
+static bool
+dirtree_valid(IFAPI_IO_DIRTREE *tree, const struct timespec *now)
+{
+    struct stat fbuffer;
+    size_t i;
+
+    if (now->tv_sec - tree->walked.tv_sec >= IFAPI_IO_DIRCACHE_TTL)
+        return false;
+
+    for (i = 0; i < tree->num_dirs; i++) {
+        if (stat(tree->dirs[i].path, &fbuffer) != 0 || !S_ISDIR(fbuffer.st_mode) ||
+            fbuffer.st_mtim.tv_sec != tree->dirs[i].mtime.tv_sec ||
+            fbuffer.st_mtim.tv_nsec != tree->dirs[i].mtime.tv_nsec)
+            return false;
+    }
+    return true;
+}
+
+/** Copy the file names of a tree. */
+static TSS2_RC
+dirtree_copy_files(IFAPI_IO_DIRTREE *tree, char ***files, size_t *num_files)
+{
+    size_t i;
+
+    *num_files = 0;
+    *files = calloc(tree->num_files + 1, sizeof(char *));
+    return_if_null(*files, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+    for (i = 0; i < tree->num_files; i++) {
+        (*files)[i] = strdup(tree->files[i]);
+        if ((*files)[i] == NULL) {
+            while (i > 0)
+                free((*files)[--i]);
+            SAFE_FREE(*files);
+            return_error(TSS2_FAPI_RC_MEMORY, "Out of memory.");
+        }
+    }
+    *num_files = tree->num_files;
     return TSS2_RC_SUCCESS;
 }
 
+/** Look up a valid cached tree; called with the cache mutex held.
+ *
+ * Trees which no longer match the file system are dropped.
+ */
+static IFAPI_IO_DIRTREE *
+dircache_lookup(const char *root)
+{
+    struct timespec now;
+    size_t i;
 
-/** Recursive enumerate the list of files in a directory.
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (i = 0; i < IFAPI_IO_DIRCACHE_SIZE; i++) {
+        if (io_dircache.trees[i] == NULL || strcmp(io_dircache.trees[i]->root, root) != 0)
+            continue;
+        if (dirtree_valid(io_dircache.trees[i], &now))
+            return io_dircache.trees[i];
+        dirtree_free(io_dircache.trees[i]);
+        io_dircache.trees[i] = NULL;
+    }
+    return NULL;
+}
+
+/** Store a walked tree in the cache.
  *
- * Enumerage the regular files (no directories, symlinks etc) from a given directory.
+ * A tree of the same directory or the oldest tree is replaced. Trees with
+ * recently changed directories are freed instead.
+ */
+static void
+dircache_store(IFAPI_IO_DIRTREE *tree)
+{
+    IFAPI_IO_DIRTREE **slot = NULL;
+    size_t i;
+
+    if (tree->racy || tree->rc != TSS2_RC_SUCCESS) {
+        dirtree_free(tree);
+        return;
+    }
+
+    pthread_mutex_lock(&io_dircache.mutex);
+    for (i = 0; i < IFAPI_IO_DIRCACHE_SIZE && !slot; i++) {
+        if (io_dircache.trees[i] && strcmp(io_dircache.trees[i]->root, tree->root) == 0)
+            slot = &io_dircache.trees[i];
+    }
+    for (i = 0; i < IFAPI_IO_DIRCACHE_SIZE && !slot; i++) {
+        if (io_dircache.trees[i] == NULL)
+            slot = &io_dircache.trees[i];
+    }
+    if (!slot) {
+        slot = &io_dircache.trees[0];
+        for (i = 1; i < IFAPI_IO_DIRCACHE_SIZE; i++) {
+            if (io_dircache.trees[i]->walked.tv_sec < (*slot)->walked.tv_sec)
+                slot = &io_dircache.trees[i];
+        }
+    }
+    dirtree_free(*slot);
+    *slot = tree;
+    pthread_mutex_unlock(&io_dircache.mutex);
+}
+
+/** Recursive enumerate the list of files in several directories.
  *
- * @param[in] searchPath The directory to list files from.
- * @param[out] pathlist The list of file names.
- * @param[out] numPaths The size of files.
- * @retval TSS2_RC_SUCCESS if the directories were successfully removed
- * @retval TSS2_FAPI_RC_IO_ERROR if an I/O error occurred
+ * Enumerage the files (no directories) below the given directories. The
+ * directories are walked concurrently; the files of each directory follow
+ * those of the previous one in the result. Walks are cached per directory
+ * and reused while no directory of the tree was modified. Directories
+ * which do not exist contribute no files.
+ *
+ * @param[in] searchPaths The directories to list files from.
+ * @param[in] numSearchPaths The number of directories.
+ * @param[out] pathlist The array of file names (callee-allocated; free each
+ *             element and the array). NULL if no file was found.
+ * @param[out] numPaths The size of pathlist.
+ * @retval TSS2_RC_SUCCESS if the directories were successfully walked.
  * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
  */
 TSS2_RC
-ifapi_io_dirfiles_all(
-    const char *searchPath,
+ifapi_io_dirfiles_all_multi(
+    const char * const *searchPaths,
+    size_t numSearchPaths,
     char ***pathlist,
     size_t *numPaths)
 {
-    TSS2_RC r;
-    size_t n;
-    NODE_OBJECT_T *head;
-
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    IFAPI_IO_DIRTREE **trees = NULL;
+    pthread_t *threads = NULL;
+    bool *started = NULL, *cached = NULL, first = true;
+    char ***files = NULL;
+    size_t *num_files = NULL, i, j, n = 0;
+
+    check_not_null(searchPaths);
+    check_not_null(pathlist);
+    check_not_null(numPaths);
+
+    *pathlist = NULL;
     *numPaths = 0;
-    char **pathlist2;
 
-    NODE_OBJECT_T *file_list = NULL;
-    r = dirfiles_all(searchPath, &file_list, numPaths);
-    goto_if_error(r, "get all sub files of directory", cleanup);
+    trees = calloc(numSearchPaths, sizeof(*trees));
+    threads = calloc(numSearchPaths, sizeof(*threads));
+    started = calloc(numSearchPaths, sizeof(*started));
+    cached = calloc(numSearchPaths, sizeof(*cached));
+    files = calloc(numSearchPaths, sizeof(*files));
+    num_files = calloc(numSearchPaths, sizeof(*num_files));
+    if (!trees || !threads || !started || !cached || !files || !num_files)
+        goto_error(r, TSS2_FAPI_RC_MEMORY, "Out of memory.", cleanup);
+
+    pthread_mutex_lock(&io_dircache.mutex);
+    for (i = 0; i < numSearchPaths && r == TSS2_RC_SUCCESS; i++) {
+        IFAPI_IO_DIRTREE *tree = dircache_lookup(searchPaths[i]);
+
+        cached[i] = tree != NULL;
+        if (tree)
+            r = dirtree_copy_files(tree, &files[i], &num_files[i]);
+    }
+    pthread_mutex_unlock(&io_dircache.mutex);
+    goto_if_error(r, "Copy cached files.", cleanup);
 
-    if (*numPaths > 0) {
-        size_t size_path_list = *numPaths * sizeof(char *);
-        pathlist2 = calloc(1, size_path_list);
-        goto_if_null2(pathlist2, "Out of memory.", r, TSS2_FAPI_RC_MEMORY,
+    /* Walk the remaining directories; all but the first one in threads. */
+    for (i = 0; i < numSearchPaths; i++) {
+        if (cached[i])
+            continue;
+        trees[i] = calloc(1, sizeof(**trees));
+        goto_if_null2(trees[i], "Out of memory.", r, TSS2_FAPI_RC_MEMORY, cleanup);
+        trees[i]->root = strdup(searchPaths[i]);
+        goto_if_null2(trees[i]->root, "Out of memory.", r, TSS2_FAPI_RC_MEMORY,
                       cleanup);
-        n = *numPaths;
-
-        /* Move file names from list to array */
-        while (n > 0 && file_list) {
-            n -= 1;
-            pathlist2[n] = file_list->object;
-            head = file_list;
-            file_list = file_list->next;
-            SAFE_FREE(head);
+        if (first) {
+            first = false;
+            continue;
         }
-        *pathlist = pathlist2;
+        started[i] = io_thread_create(&threads[i], dirtree_build, trees[i]) == 0;
+    }
+    for (i = 0; i < numSearchPaths; i++) {
+        if (!trees[i])
+            continue;
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            dirtree_build(trees[i]);
+        started[i] = false;
     }
+    for (i = 0; i < numSearchPaths; i++) {
+        if (trees[i] && trees[i]->rc != TSS2_RC_SUCCESS)
+            goto_error(r, trees[i]->rc, "Walk %s.", cleanup, searchPaths[i]);
+    }
+
+    for (i = 0; i < numSearchPaths; i++)
+        n += cached[i] ? num_files[i] : trees[i]->num_files;
+    if (n == 0)
+        goto cleanup;
+
+    /* Move the file names of all directories to one array; the trees which
+       are cached keep their own copy. */
+    *pathlist = calloc(n, sizeof(char *));
+    goto_if_null2(*pathlist, "Out of memory.", r, TSS2_FAPI_RC_MEMORY, cleanup);
+    for (i = 0; i < numSearchPaths; i++) {
+        if (cached[i]) {
+            memcpy(&(*pathlist)[*numPaths], files[i], num_files[i] * sizeof(char *));
+            *numPaths += num_files[i];
+            num_files[i] = 0;
+            continue;
+        }
+        for (j = 0; j < trees[i]->num_files; j++) {
+            if (trees[i]->racy) {
+                (*pathlist)[*numPaths] = trees[i]->files[j];
+                trees[i]->files[j] = NULL;
+            } else {
+                (*pathlist)[*numPaths] = strdup(trees[i]->files[j]);
+                goto_if_null2((*pathlist)[*numPaths], "Out of memory.", r,
+                              TSS2_FAPI_RC_MEMORY, cleanup);
+            }
+            *numPaths += 1;
+        }
+    }
+
 cleanup:
-    /* Free linked list with file names */
-    while (file_list) {
-        head = file_list;
-        file_list = file_list->next;
-        SAFE_FREE(head);
+    for (i = 0; i < numSearchPaths; i++) {
+        if (trees && trees[i]) {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            if (r == TSS2_RC_SUCCESS)
+                dircache_store(trees[i]);
+            else
+                dirtree_free(trees[i]);
+        }
+        if (files && files[i]) {
+            for (j = 0; j < num_files[i]; j++)
+                free(files[i][j]);
+            free(files[i]);
+        }
+    }
+    if (r != TSS2_RC_SUCCESS && *pathlist) {
+        for (j = 0; j < *numPaths; j++)
+            free((*pathlist)[j]);
+        SAFE_FREE(*pathlist);
+        *numPaths = 0;
     }
+    SAFE_FREE(trees);
+    SAFE_FREE(threads);
+    SAFE_FREE(started);
+    SAFE_FREE(cached);
+    SAFE_FREE(files);
+    SAFE_FREE(num_files);
     return r;
 }
 
+/** Recursive enumerate the list of files in a directory.
+ *
+ * Enumerage the files (no directories) below a given directory.
+ *
+ * @param[in] searchPath The directory to list files from.
+ * @param[out] pathlist The list of file names.
+ * @param[out] numPaths The size of files.
+ * @retval TSS2_RC_SUCCESS if the directories were successfully removed
+ * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated to hold the read data.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ */
+TSS2_RC
+ifapi_io_dirfiles_all(
+    const char *searchPath,
+    char ***pathlist,
+    size_t *numPaths)
+{
+    return ifapi_io_dirfiles_all_multi(&searchPath, 1, pathlist, numPaths);
+}
+
 /** Determine whether a path exists.
  *
  * @param[in] path The absolute path of the file.
@@ -631,7 +1552,7 @@ ifapi_io_poll(IFAPI_IO * io) {
     if (io->pollevents) {
         struct pollfd fds;
         fds.events = io->pollevents;
-        fds.fd = fileno(io->stream);
+        fds.fd = io->notify[0];
         LOG_TRACE("Waiting for fd %i with event %i", fds.fd, fds.events);
         rc = poll(&fds, 1, -1);
         if (rc < 0) {
@@ -669,7 +1590,7 @@ ifapi_io_poll_handles(IFAPI_IO *io, FAPI_POLL_HANDLE **handles, size_t *num_hand
     *handles = calloc(1, sizeof(**handles));
     check_oom(*handles);
     (*handles)->events = io->pollevents;
-    (*handles)->fd = fileno(io->stream);
+    (*handles)->fd = io->notify[0];
     *num_handles = 1;
 
     LOG_TRACE("Returning %zi poll handles for fd %i with event %i",
@@ -9,16 +9,42 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <sys/types.h>
 #include "tss2_common.h"
 #include "tss2_fapi.h"
 
+/** The number of worker threads performing the file I/O of all contexts. */
+#define IFAPI_IO_THREADS 4
+
+/** The maximum number of reads started ahead by ifapi_io_read_prefetch. */
+#define IFAPI_IO_PREFETCH_MAX 8
+
+/** The number of directory trees kept by ifapi_io_dirfiles_all. */
+#define IFAPI_IO_DIRCACHE_SIZE 8
+
+/** The seconds a cached directory tree is used without walking it again. */
+#define IFAPI_IO_DIRCACHE_TTL 5
+
+/** Trees with directories modified in the last seconds are not cached. */
+#define IFAPI_IO_DIRCACHE_RACY 2
+
+typedef struct IFAPI_IO_JOB IFAPI_IO_JOB;
+
+/** The context for the asynchronous file I/O.
+ *
+ * The reads and writes are performed by a pool of worker threads. A worker
+ * signals the completion of a job by writing to a pipe whose read end is
+ * returned as poll handle.
+ */
 typedef struct IFAPI_IO {
-    FILE *stream;
-    short pollevents;
-    const char *char_buffer;
-    char *char_rbuffer;
-    size_t buffer_length;
-    size_t buffer_idx;
+    short pollevents;          /**< The events to poll for on notify[0] */
+    char *char_rbuffer;        /**< The read data if the old API is used */
+    IFAPI_IO_JOB *job;         /**< The pending read or write operation */
+    IFAPI_IO_JOB *prefetched;  /**< Reads started by ifapi_io_read_prefetch */
+    size_t n_prefetched;       /**< The number of prefetched reads */
+    int notify[2];             /**< The pipe signalled by the workers */
+    bool notify_open;          /**< Whether the pipe was created */
+    pid_t notify_pid;          /**< The process which created the pipe */
 } IFAPI_IO;
 
 #ifdef TEST_FAPI_ASYNC
@@ -29,12 +55,6 @@ typedef struct IFAPI_IO {
 
 static int _ifapi_io_retry __attribute__((unused)) = _IFAPI_IO_RETRIES;
 
-#define IFAPI_IO_STREAM context->io.stream
-#define IFAPI_IO_BUFF context->io.char_buffer
-#define IFAPI_IO_RBUFF context->io.char_rbuffer
-#define IFAPI_IO_BUFFLEN context->io.buffer_length
-#define IFAPI_IO_BUFFIDX context->io.buffer_idx
-
 TSS2_RC
 ifapi_io_read_async(
     struct IFAPI_IO *io,
@@ -46,6 +66,15 @@ ifapi_io_read_finish(
     uint8_t **buffer,
     size_t *length);
 
+TSS2_RC
+ifapi_io_read_prefetch(
+    struct IFAPI_IO *io,
+    const char *filename);
+
+void
+ifapi_io_prefetch_cancel(
+    struct IFAPI_IO *io);
+
 TSS2_RC
 ifapi_io_write_async(
     struct IFAPI_IO *io,
@@ -85,6 +114,13 @@ ifapi_io_dirfiles_all(
     char ***pathlist,
     size_t *numPaths);
 
+TSS2_RC
+ifapi_io_dirfiles_all_multi(
+    const char * const *searchPaths,
+    size_t numSearchPaths,
+    char ***pathlist,
+    size_t *numPaths);
+
 bool
 ifapi_io_path_exists(const char *path);
 
@@ -94,4 +130,7 @@ ifapi_io_poll(IFAPI_IO * io);
 TSS2_RC
 ifapi_io_poll_handles(IFAPI_IO *io, FAPI_POLL_HANDLE **handles, size_t *num_handles);
 
+void
+ifapi_io_cleanup(IFAPI_IO *io);
+
 #endif /* IFAPI_IO_H */
@@ -895,5 +895,35 @@ ifapi_json_IFAPI_CONFIG_serialize(const IFAPI_CONFIG *in, json_object **jso)
 
      json_object_object_add(*jso, "intel_cert_service", jso2);
 
+     jso2 = json_object_new_string(
+         in->keystore_format == IFAPI_KEYSTORE_FORMAT_BINARY ? "binary" : "json");
+     return_if_null(jso2, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+
+     json_object_object_add(*jso, "keystore_format", jso2);
+
+     jso2 = NULL;
+     r = ifapi_json_UINT32_serialize(in->replay_threads, &jso2);
+     return_if_error(r, "Serialize UINT32");
+
+     json_object_object_add(*jso, "replay_threads", jso2);
+
+     jso2 = json_object_new_string(
+         in->random_source == IFAPI_RANDOM_SOURCE_DRBG ? "drbg" : "tpm");
+     return_if_null(jso2, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+
+     json_object_object_add(*jso, "random_source", jso2);
+
+     jso2 = NULL;
+     r = ifapi_json_UINT32_serialize(in->drbg_reseed_bytes, &jso2);
+     return_if_error(r, "Serialize UINT32");
+
+     json_object_object_add(*jso, "drbg_reseed_bytes", jso2);
+
+     jso2 = NULL;
+     r = ifapi_json_UINT32_serialize(in->drbg_reseed_interval, &jso2);
+     return_if_error(r, "Serialize UINT32");
+
+     json_object_object_add(*jso, "drbg_reseed_interval", jso2);
+
      return TSS2_RC_SUCCESS;
  }
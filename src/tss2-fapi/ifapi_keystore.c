@@ -12,6 +12,8 @@
 #include "ifapi_io.h"
 #include "ifapi_helpers.h"
 #include "ifapi_keystore.h"
+#include "ifapi_keystore_binary.h"
+#include "ifapi_timing.h"
 #define LOGMODULE fapi
 #include "util/log.h"
 #include "util/aux_util.h"
@@ -331,6 +333,7 @@ expand_path_to_object(
  * @param[in] config_systemdir The configured system directory.
  * @param[in] config_userdir The configured user directory.
  * @param[in] config_defaultprofile The configured profile.
+ * @param[in] format The format new objects are stored in.
  *
  * @retval TSS2_RC_SUCCESS If the keystore can be initialized.
  * @retval TSS2_FAPI_RC_IO_ERROR If the user part of the keystore can't be
@@ -345,7 +348,8 @@ ifapi_keystore_initialize(
     IFAPI_KEYSTORE *keystore,
     const char *config_systemdir,
     const char *config_userdir,
-    const char *config_defaultprofile)
+    const char *config_defaultprofile,
+    IFAPI_KEYSTORE_FORMAT format)
 {
     TSS2_RC r;
     const char *home_dir;
@@ -353,6 +357,7 @@ ifapi_keystore_initialize(
     size_t start_pos;
 
     memset(keystore, 0, sizeof(IFAPI_KEYSTORE));
+    keystore->format = format;
 
     /* Check whether usage of home directory is provided in config file */
     if (strncmp("~", config_userdir, 1) == 0) {
@@ -516,6 +521,39 @@ ifapi_keystore_load_async(
     return r;
 }
 
+/** Start reading a FAPI object which will probably be loaded next.
+ *
+ * The read is performed concurrently with the current I/O operation; a
+ * following ifapi_keystore_load_async for the same path uses its result.
+ *
+ * @param[in] keystore The key directories and default profile.
+ * @param[in] io  The input/output context being used for file I/O.
+ * @param[in] path The relative path of the object.
+ * @retval TSS2_RC_SUCCESS If the read was started or is not needed.
+ * @retval TSS2_FAPI_RC_IO_ERROR: if an I/O error was encountered.
+ * @retval TSS2_FAPI_RC_MEMORY: if memory could not be allocated.
+ * @retval TSS2_FAPI_RC_KEY_NOT_FOUND if a key was not found.
+ * @retval TSS2_FAPI_RC_PATH_NOT_FOUND if the file does not exist.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if an invalid value was passed into
+ *         the function.
+ */
+TSS2_RC
+ifapi_keystore_load_prefetch(
+    IFAPI_KEYSTORE *keystore,
+    IFAPI_IO *io,
+    const char *path)
+{
+    TSS2_RC r;
+    char *abs_path = NULL;
+
+    r = rel_path_to_abs_path(keystore, path, &abs_path);
+    return_if_error2(r, "Object %s not found.", path);
+
+    r = ifapi_io_read_prefetch(io, abs_path);
+    SAFE_FREE(abs_path);
+    return r;
+}
+
 /** Finish loading FAPI object from key store.
  *
  * This function needs to be called repeatedly until it does not return TSS2_FAPI_RC_TRY_AGAIN.
@@ -541,22 +579,36 @@ ifapi_keystore_load_finish(
     TSS2_RC r;
     json_object *jso = NULL;
     uint8_t *buffer = NULL;
+    size_t length;
+    IFAPI_TIMING_PHASE phase = IFAPI_TIMING_JSON;
+    uint64_t start = 0;
     /* Keystore parameter is used to be prepared if transmission of state information
        between async and finish will be necessary in future extensions. */
     (void)keystore;
 
-    r = ifapi_io_read_finish(io, &buffer, NULL);
+    r = ifapi_io_read_finish(io, &buffer, &length);
     return_try_again(r);
     return_if_error(r, "keystore read_finish failed");
 
-    /* If json objects can't be parse the object store is corrupted */
-    jso = json_tokener_parse((char *)buffer);
-    SAFE_FREE(buffer);
-    goto_if_null2(jso, "Keystore is corrupted (Json error).", r, TSS2_FAPI_RC_GENERAL_FAILURE,
-                  error_cleanup);
+    start = ifapi_timing_start();
 
-    r = ifapi_json_IFAPI_OBJECT_deserialize(jso, object);
-    goto_if_error(r, "Deserialize object.", error_cleanup);
+    /* Objects of both formats can be read independent of the configured one. */
+    if (ifapi_binary_object_p(buffer, length)) {
+        phase = IFAPI_TIMING_BINARY;
+        r = ifapi_binary_IFAPI_OBJECT_deserialize(buffer, length, object);
+        SAFE_FREE(buffer);
+        goto_if_error(r, "Keystore is corrupted (binary object).", error_cleanup);
+    } else {
+        /* If json objects can't be parse the object store is corrupted */
+        jso = json_tokener_parse((char *)buffer);
+        SAFE_FREE(buffer);
+        goto_if_null2(jso, "Keystore is corrupted (Json error).", r,
+                      TSS2_FAPI_RC_GENERAL_FAILURE, error_cleanup);
+
+        r = ifapi_json_IFAPI_OBJECT_deserialize(jso, object);
+        goto_if_error(r, "Deserialize object.", error_cleanup);
+    }
+    ifapi_timing_stop(phase, start);
 
     object->rel_path = keystore->rel_path;
     SAFE_FREE(buffer);
@@ -566,6 +618,7 @@ ifapi_keystore_load_finish(
     return r;
 
  error_cleanup:
+    ifapi_timing_stop(phase, start);
     SAFE_FREE(buffer);
     if (jso)
         json_object_put(jso);
@@ -603,6 +656,9 @@ ifapi_keystore_store_async(
     char *file = NULL;
     char *jso_string = NULL;
     json_object *jso = NULL;
+    uint8_t *binary = NULL;
+    size_t binary_size;
+    uint64_t start = 0;
 
     LOG_TRACE("Store object: %s", path);
 
@@ -625,6 +681,23 @@ ifapi_keystore_store_async(
     }
     goto_if_error2(r, "Object path %s could not be created.", cleanup, directory);
 
+    start = ifapi_timing_start();
+    if (keystore->format == IFAPI_KEYSTORE_FORMAT_BINARY) {
+        r = ifapi_binary_IFAPI_OBJECT_serialize(object, &binary, &binary_size);
+        /* Object types without a binary encoding are stored as JSON. */
+        if (r != TSS2_FAPI_RC_NOT_IMPLEMENTED) {
+            ifapi_timing_stop(IFAPI_TIMING_BINARY, start);
+            start = 0;
+            goto_if_error2(r, "Object for %s could not be serialized.", cleanup, file);
+
+            /* Start writing the binary object to disk */
+            r = ifapi_io_write_async(io, file, binary, binary_size);
+            free(binary);
+            goto_if_error(r, "write_async failed", cleanup);
+            goto cleanup;
+        }
+    }
+
     /* Generate JSON string to be written to store */
     r = ifapi_json_IFAPI_OBJECT_serialize(object, &jso);
     goto_if_error2(r, "Object for %s could not be serialized.", cleanup, file);
@@ -633,6 +706,8 @@ ifapi_keystore_store_async(
                                                        JSON_C_TO_STRING_PRETTY));
     goto_if_null2(jso_string, "Converting json to string", r, TSS2_FAPI_RC_MEMORY,
                   cleanup);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+    start = 0;
 
     /* Start writing the json string to disk */
     r = ifapi_io_write_async(io, file, (uint8_t *) jso_string, strlen(jso_string));
@@ -640,6 +715,7 @@ ifapi_keystore_store_async(
     goto_if_error(r, "write_async failed", cleanup);
 
 cleanup:
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
     if (jso)
         json_object_put(jso);
     SAFE_FREE(directory);
@@ -752,13 +828,10 @@ keystore_list_all_abs(
     size_t *numresults)
 {
     TSS2_RC r;
-    char *expanded_search_path = NULL, *full_search_path = NULL;
-    size_t num_paths_system, num_paths_user, i, j;
-    char **file_ary, **file_ary_system, **file_ary_user;
+    char *expanded_search_path = NULL;
+    char *full_search_paths[2] = { NULL, NULL };
 
     *numresults = 0;
-    file_ary_user = NULL;
-    file_ary_system = NULL;
 
     if (!searchpath || strcmp(searchpath, "") == 0 || strcmp(searchpath, "/") == 0) {
         /* The complete keystore will be listed, no path expansion */
@@ -768,48 +841,26 @@ keystore_list_all_abs(
         return_if_error(r, "Out of memory.");
     }
 
-    /* Get the objects from system store */
-    r = ifapi_asprintf(&full_search_path, "%s%s%s", keystore->systemdir, IFAPI_FILE_DELIM,
+    /* The objects from system store are followed by the ones from user store. */
+    r = ifapi_asprintf(&full_search_paths[0], "%s%s%s", keystore->systemdir,
+                       IFAPI_FILE_DELIM,
                        expanded_search_path ? expanded_search_path : "");
     goto_if_error(r, "Out of memory.", cleanup);
 
-    r = ifapi_io_dirfiles_all(full_search_path, &file_ary_system, &num_paths_system);
-    goto_if_error(r, "Get all files in directory.", cleanup);
-    SAFE_FREE(full_search_path);
-
-    /* Get the objects from user store */
-    r = ifapi_asprintf(&full_search_path, "%s%s%s", keystore->userdir, IFAPI_FILE_DELIM,
+    r = ifapi_asprintf(&full_search_paths[1], "%s%s%s", keystore->userdir,
+                       IFAPI_FILE_DELIM,
                        expanded_search_path ? expanded_search_path : "");
     goto_if_error(r, "Out of memory.", cleanup);
 
-    r = ifapi_io_dirfiles_all(full_search_path, &file_ary_user, &num_paths_user);
-
-    *numresults = num_paths_system + num_paths_user;
-    SAFE_FREE(full_search_path);
-
-    if (*numresults > 0) {
-
-        /* Move file names from list to combined array */
-        file_ary = calloc(*numresults, sizeof(char *));
-        goto_if_null(file_ary, "Out of memory.", TSS2_FAPI_RC_MEMORY,
-                    cleanup);
-        i = 0;
-        for (j = 0; j < num_paths_system; j++)
-            file_ary[i++] = file_ary_system[j];
-        for (j = 0; j < num_paths_user; j++)
-            file_ary[i++] = file_ary_user[j];
-
-        SAFE_FREE(file_ary_system);
-        SAFE_FREE(file_ary_user);
-        SAFE_FREE(expanded_search_path);
-        *results = file_ary;
-    }
+    /* Both stores are walked concurrently. */
+    r = ifapi_io_dirfiles_all_multi((const char * const *) &full_search_paths[0], 2,
+                                    results, numresults);
+    goto_if_error(r, "Get all files in directory.", cleanup);
 
 cleanup:
-    SAFE_FREE(file_ary_system);
-    SAFE_FREE(file_ary_user);
     SAFE_FREE(expanded_search_path);
-    SAFE_FREE(full_search_path);
+    SAFE_FREE(full_search_paths[0]);
+    SAFE_FREE(full_search_paths[1]);
     return r;
 }
 
@@ -1028,6 +1079,7 @@ keystore_search_obj(
         goto_if_error2(r, "Get entities.", cleanup);
 
         keystore->key_search.path_idx = keystore->key_search.numPaths;
+        keystore->key_search.prefetch_idx = keystore->key_search.numPaths;
         fallthrough;
 
     statecase(keystore->key_search.state, KSEARCH_SEARCH_OBJECT)
@@ -1043,6 +1095,19 @@ keystore_search_obj(
         r = ifapi_keystore_load_async(keystore, io, path);
         return_if_error2(r, "Could not open: %s", path);
 
+        /* Read the following objects concurrently. */
+        if (keystore->key_search.prefetch_idx > path_idx)
+            keystore->key_search.prefetch_idx = path_idx;
+        while (keystore->key_search.prefetch_idx > 0 &&
+               path_idx - keystore->key_search.prefetch_idx < IFAPI_IO_PREFETCH_MAX) {
+            keystore->key_search.prefetch_idx -= 1;
+            r = ifapi_keystore_load_prefetch(keystore, io,
+                    keystore->key_search.pathlist[keystore->key_search.prefetch_idx]);
+            if (r != TSS2_RC_SUCCESS)
+                LOG_DEBUG("Object %s not prefetched.",
+                          keystore->key_search.pathlist[keystore->key_search.prefetch_idx]);
+        }
+
         fallthrough;
 
     statecase(keystore->key_search.state, KSEARCH_READ)
@@ -1072,6 +1137,7 @@ keystore_search_obj(
     statecasedefault(keystore->key_search.state);
     }
 cleanup:
+    ifapi_io_prefetch_cancel(io);
     for (i = 0; i < keystore->key_search.numPaths; i++)
         free(keystore->key_search.pathlist[i]);
     free(keystore->key_search.pathlist);
@@ -13,6 +13,7 @@
 #include "tss2_tpm2_types.h"
 #include "fapi_types.h"
 #include "ifapi_policy_types.h"
+#include "ifapi_io.h"
 #include "tss2_esys.h"
 
 typedef UINT32 IFAPI_OBJECT_TYPE_CONSTANT;
@@ -104,16 +105,28 @@ enum FAPI_SEARCH_STATE {
 typedef struct {
     size_t path_idx;                /**< Index of array of objects to be searched */
     size_t numPaths;                /**< Number of all objects in data store */
+    size_t prefetch_idx;            /**< Objects below this index are not yet prefetched */
     char **pathlist;                /**< The array of all objects  in the search path */
     enum FAPI_SEARCH_STATE state;
 } IFAPI_KEY_SEARCH;
 
+/** The encodings of the objects written to the keystore.
+ *
+ * Objects of both formats can always be read, the format only selects
+ * how new or changed objects are written.
+ */
+typedef enum {
+    IFAPI_KEYSTORE_FORMAT_JSON = 0,  /**< Human readable JSON objects */
+    IFAPI_KEYSTORE_FORMAT_BINARY     /**< TPM marshalled objects */
+} IFAPI_KEYSTORE_FORMAT;
+
 typedef struct IFAPI_KEYSTORE {
     char *systemdir;
     char *userdir;
     char *defaultprofile;
     IFAPI_KEY_SEARCH key_search;
     const char* rel_path;
+    IFAPI_KEYSTORE_FORMAT format;   /**< The format used for storing objects */
 } IFAPI_KEYSTORE;
 
 
@@ -154,7 +167,8 @@ ifapi_keystore_initialize(
     IFAPI_KEYSTORE *keystore,
     const char *config_systemdir,
     const char *config_userdir,
-    const char *config_defaultprofile);
+    const char *config_defaultprofile,
+    IFAPI_KEYSTORE_FORMAT format);
 
 TSS2_RC
 ifapi_keystore_load_async(
@@ -162,6 +176,12 @@ ifapi_keystore_load_async(
     IFAPI_IO *io,
     const char *path);
 
+TSS2_RC
+ifapi_keystore_load_prefetch(
+    IFAPI_KEYSTORE *keystore,
+    IFAPI_IO *io,
+    const char *path);
+
 TSS2_RC
 ifapi_keystore_load_finish(
     IFAPI_KEYSTORE *keystore,
@@ -0,0 +1,668 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+
+#include "tss2_mu.h"
+#include "ifapi_keystore_binary.h"
+#include "ifapi_policy_json_serialize.h"
+#include "ifapi_policy_json_deserialize.h"
+#define LOGMODULE fapi
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * The binary keystore format stores the TPM structures of an object in their
+ * TPM marshalled form (Tss2_MU) and the FAPI metadata (strings and byte
+ * arrays) length prefixed, so that loading an object is a single read and a
+ * sequence of unmarshal calls instead of a JSON parse.
+ *
+ * All integers are big endian, which makes the files independent of the
+ * host they were written on. The file starts with a magic whose first byte
+ * is zero, so it can never be mistaken for a JSON object. Policies are trees
+ * of pointers and are kept in their JSON form.
+ */
+
+#define BINARY_VERSION 1
+#define BINARY_NULL UINT32_MAX
+
+static const uint8_t binary_magic[8] = { 0x00, 'T', 'S', 'S', '2', 'O', 'B', 'J' };
+
+/** A growing buffer an object is serialized into. */
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t capacity;
+} BINARY_WRITER;
+
+/** A bounds checked cursor over a serialized object. */
+typedef struct {
+    const uint8_t *buffer;
+    size_t size;
+    size_t offset;
+} BINARY_READER;
+
+/* The marshalled form of a TPM structure is never larger than the host form. */
+#define binary_put_mu(w, type, src) \
+    (binary_reserve(w, TSS2_MU_MAX_SIZE(type)) != TSS2_RC_SUCCESS ? \
+     TSS2_FAPI_RC_MEMORY : \
+     Tss2_MU_##type##_Marshal(src, (w)->buffer, (w)->capacity, &(w)->size))
+
+#define binary_get_mu(rd, type, dest) \
+    (Tss2_MU_##type##_Unmarshal((rd)->buffer, (rd)->size, &(rd)->offset, dest) != \
+     TSS2_RC_SUCCESS ? TSS2_FAPI_RC_BAD_VALUE : TSS2_RC_SUCCESS)
+
+static TSS2_RC
+binary_reserve(BINARY_WRITER *w, size_t size)
+{
+    if (w->size + size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity : 1024;
+        uint8_t *buffer;
+
+        while (w->size + size > capacity)
+            capacity *= 2;
+        buffer = realloc(w->buffer, capacity);
+        return_if_null(buffer, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+        w->buffer = buffer;
+        w->capacity = capacity;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_put_uint8(BINARY_WRITER *w, UINT8 value)
+{
+    TSS2_RC r = binary_reserve(w, sizeof(value));
+    return_if_error(r, "Write object.");
+
+    return Tss2_MU_UINT8_Marshal(value, w->buffer, w->capacity, &w->size);
+}
+
+static TSS2_RC
+binary_put_uint32(BINARY_WRITER *w, UINT32 value)
+{
+    TSS2_RC r = binary_reserve(w, sizeof(value));
+    return_if_error(r, "Write object.");
+
+    return Tss2_MU_UINT32_Marshal(value, w->buffer, w->capacity, &w->size);
+}
+
+/** Write a byte array; a NULL buffer is kept distinct from an empty one. */
+static TSS2_RC
+binary_put_bytes(BINARY_WRITER *w, const uint8_t *data, size_t size)
+{
+    TSS2_RC r;
+
+    if (data == NULL)
+        return binary_put_uint32(w, BINARY_NULL);
+    if (size >= BINARY_NULL) {
+        LOG_ERROR("Member of %zu bytes too large.", size);
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    r = binary_put_uint32(w, size);
+    return_if_error(r, "Write object.");
+    r = binary_reserve(w, size);
+    return_if_error(r, "Write object.");
+    memcpy(&w->buffer[w->size], data, size);
+    w->size += size;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Write a string; NULL is written as empty string like the JSON format does. */
+static TSS2_RC
+binary_put_string(BINARY_WRITER *w, const char *string)
+{
+    if (string == NULL)
+        string = "";
+    return binary_put_bytes(w, (const uint8_t *) string, strlen(string));
+}
+
+/** Write a string which may be NULL. */
+static TSS2_RC
+binary_put_optional_string(BINARY_WRITER *w, const char *string)
+{
+    return binary_put_bytes(w, (const uint8_t *) string,
+                            string ? strlen(string) : 0);
+}
+
+static TSS2_RC
+binary_get_uint8(BINARY_READER *rd, UINT8 *value)
+{
+    return binary_get_mu(rd, UINT8, value);
+}
+
+static TSS2_RC
+binary_get_uint32(BINARY_READER *rd, UINT32 *value)
+{
+    return binary_get_mu(rd, UINT32, value);
+}
+
+/** Read a length prefixed chunk and return a pointer into the buffer. */
+static TSS2_RC
+binary_get_chunk(BINARY_READER *rd, const uint8_t **data, UINT32 *size)
+{
+    TSS2_RC r;
+
+    r = binary_get_uint32(rd, size);
+    return_if_error(r, "Object truncated.");
+
+    if (*size == BINARY_NULL) {
+        *data = NULL;
+        return TSS2_RC_SUCCESS;
+    }
+    if (rd->size - rd->offset < *size) {
+        LOG_ERROR("Object truncated.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    *data = &rd->buffer[rd->offset];
+    rd->offset += *size;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_get_bytes(BINARY_READER *rd, UINT8_ARY *out)
+{
+    TSS2_RC r;
+    const uint8_t *data;
+    UINT32 size;
+
+    memset(out, 0, sizeof(*out));
+    r = binary_get_chunk(rd, &data, &size);
+    return_if_error(r, "Read byte array.");
+    if (data == NULL)
+        return TSS2_RC_SUCCESS;
+
+    /* An empty array still has a buffer to be distinct from a missing one. */
+    out->buffer = malloc(size ? size : 1);
+    return_if_null(out->buffer, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+    memcpy(out->buffer, data, size);
+    out->size = size;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_get_string(BINARY_READER *rd, char **string)
+{
+    TSS2_RC r;
+    const uint8_t *data;
+    UINT32 size;
+
+    *string = NULL;
+    r = binary_get_chunk(rd, &data, &size);
+    return_if_error(r, "Read string.");
+    if (data == NULL)
+        return TSS2_RC_SUCCESS;
+
+    *string = strndup((const char *) data, size);
+    return_if_null(*string, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_put_policy(BINARY_WRITER *w, const TPMS_POLICY *policy)
+{
+    TSS2_RC r;
+    json_object *jso = NULL;
+
+    if (policy == NULL)
+        return binary_put_optional_string(w, NULL);
+
+    r = ifapi_json_TPMS_POLICY_serialize(policy, &jso);
+    return_if_error(r, "Serialize policy.");
+
+    r = binary_put_string(w, json_object_to_json_string_ext(jso,
+                                                            JSON_C_TO_STRING_PLAIN));
+    json_object_put(jso);
+    return r;
+}
+
+static TSS2_RC
+binary_get_policy(BINARY_READER *rd, TPMS_POLICY **policy)
+{
+    TSS2_RC r;
+    char *string;
+    json_object *jso;
+
+    *policy = NULL;
+    r = binary_get_string(rd, &string);
+    return_if_error(r, "Read policy.");
+    if (string == NULL)
+        return TSS2_RC_SUCCESS;
+
+    jso = json_tokener_parse(string);
+    SAFE_FREE(string);
+    return_if_null(jso, "Policy is corrupted.", TSS2_FAPI_RC_BAD_VALUE);
+
+    *policy = calloc(1, sizeof(TPMS_POLICY));
+    goto_if_null2(*policy, "Out of memory.", r, TSS2_FAPI_RC_MEMORY, cleanup);
+
+    r = ifapi_json_TPMS_POLICY_deserialize(jso, *policy);
+    goto_if_error(r, "Deserialize policy.", cleanup);
+
+    json_object_put(jso);
+    return TSS2_RC_SUCCESS;
+
+cleanup:
+    SAFE_FREE(*policy);
+    json_object_put(jso);
+    return r;
+}
+
+static TSS2_RC
+binary_IFAPI_KEY_serialize(BINARY_WRITER *w, const IFAPI_KEY *in)
+{
+    TSS2_RC r;
+
+    r = binary_put_uint8(w, in->with_auth);
+    return_if_error(r, "Serialize with_auth.");
+    r = binary_put_uint32(w, in->persistent_handle);
+    return_if_error(r, "Serialize persistent_handle.");
+    r = binary_put_mu(w, TPM2B_PUBLIC, &in->public);
+    return_if_error(r, "Serialize public.");
+    r = binary_put_bytes(w, in->serialization.buffer, in->serialization.size);
+    return_if_error(r, "Serialize serialization.");
+    r = binary_put_bytes(w, in->private.buffer, in->private.size);
+    return_if_error(r, "Serialize private.");
+    r = binary_put_bytes(w, in->appData.buffer, in->appData.size);
+    return_if_error(r, "Serialize appData.");
+    r = binary_put_string(w, in->policyInstance);
+    return_if_error(r, "Serialize policyInstance.");
+
+    /* Creation data and ticket are not available for imported keys. */
+    r = binary_put_uint8(w, in->creationData.size != 0);
+    return_if_error(r, "Serialize creationData.");
+    if (in->creationData.size) {
+        r = binary_put_mu(w, TPM2B_CREATION_DATA, &in->creationData);
+        return_if_error(r, "Serialize creationData.");
+    }
+    r = binary_put_uint8(w, in->creationTicket.tag != 0);
+    return_if_error(r, "Serialize creationTicket.");
+    if (in->creationTicket.tag) {
+        r = binary_put_mu(w, TPMT_TK_CREATION, &in->creationTicket);
+        return_if_error(r, "Serialize creationTicket.");
+    }
+
+    r = binary_put_string(w, in->description);
+    return_if_error(r, "Serialize description.");
+    r = binary_put_string(w, in->certificate);
+    return_if_error(r, "Serialize certificate.");
+
+    /* Keyed hash objects do not need a signing scheme. */
+    if (in->public.publicArea.type != TPM2_ALG_KEYEDHASH) {
+        r = binary_put_mu(w, TPMT_SIG_SCHEME, &in->signing_scheme);
+        return_if_error(r, "Serialize signing_scheme.");
+    }
+    r = binary_put_mu(w, TPM2B_NAME, &in->name);
+    return_if_error(r, "Serialize name.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_KEY_deserialize(BINARY_READER *rd, IFAPI_KEY *out)
+{
+    TSS2_RC r;
+    UINT8 present;
+
+    r = binary_get_uint8(rd, &out->with_auth);
+    return_if_error(r, "Deserialize with_auth.");
+    r = binary_get_uint32(rd, &out->persistent_handle);
+    return_if_error(r, "Deserialize persistent_handle.");
+    r = binary_get_mu(rd, TPM2B_PUBLIC, &out->public);
+    return_if_error(r, "Deserialize public.");
+    r = binary_get_bytes(rd, &out->serialization);
+    return_if_error(r, "Deserialize serialization.");
+    r = binary_get_bytes(rd, &out->private);
+    return_if_error(r, "Deserialize private.");
+    r = binary_get_bytes(rd, &out->appData);
+    return_if_error(r, "Deserialize appData.");
+    r = binary_get_string(rd, &out->policyInstance);
+    return_if_error(r, "Deserialize policyInstance.");
+
+    r = binary_get_uint8(rd, &present);
+    return_if_error(r, "Deserialize creationData.");
+    if (present) {
+        r = binary_get_mu(rd, TPM2B_CREATION_DATA, &out->creationData);
+        return_if_error(r, "Deserialize creationData.");
+    }
+    r = binary_get_uint8(rd, &present);
+    return_if_error(r, "Deserialize creationTicket.");
+    if (present) {
+        r = binary_get_mu(rd, TPMT_TK_CREATION, &out->creationTicket);
+        return_if_error(r, "Deserialize creationTicket.");
+    }
+
+    r = binary_get_string(rd, &out->description);
+    return_if_error(r, "Deserialize description.");
+    r = binary_get_string(rd, &out->certificate);
+    return_if_error(r, "Deserialize certificate.");
+
+    if (out->public.publicArea.type != TPM2_ALG_KEYEDHASH) {
+        r = binary_get_mu(rd, TPMT_SIG_SCHEME, &out->signing_scheme);
+        return_if_error(r, "Deserialize signing_scheme.");
+    }
+    r = binary_get_mu(rd, TPM2B_NAME, &out->name);
+    return_if_error(r, "Deserialize name.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_NV_serialize(BINARY_WRITER *w, const IFAPI_NV *in)
+{
+    TSS2_RC r;
+
+    r = binary_put_uint8(w, in->with_auth);
+    return_if_error(r, "Serialize with_auth.");
+    r = binary_put_mu(w, TPM2B_NV_PUBLIC, &in->public);
+    return_if_error(r, "Serialize public.");
+    r = binary_put_bytes(w, in->serialization.buffer, in->serialization.size);
+    return_if_error(r, "Serialize serialization.");
+    r = binary_put_uint32(w, in->hierarchy);
+    return_if_error(r, "Serialize hierarchy.");
+    r = binary_put_string(w, in->policyInstance);
+    return_if_error(r, "Serialize policyInstance.");
+    r = binary_put_string(w, in->description);
+    return_if_error(r, "Serialize description.");
+    r = binary_put_bytes(w, in->appData.buffer, in->appData.size);
+    return_if_error(r, "Serialize appData.");
+    r = binary_put_optional_string(w, in->event_log);
+    return_if_error(r, "Serialize event_log.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_NV_deserialize(BINARY_READER *rd, IFAPI_NV *out)
+{
+    TSS2_RC r;
+
+    r = binary_get_uint8(rd, &out->with_auth);
+    return_if_error(r, "Deserialize with_auth.");
+    r = binary_get_mu(rd, TPM2B_NV_PUBLIC, &out->public);
+    return_if_error(r, "Deserialize public.");
+    r = binary_get_bytes(rd, &out->serialization);
+    return_if_error(r, "Deserialize serialization.");
+    r = binary_get_uint32(rd, &out->hierarchy);
+    return_if_error(r, "Deserialize hierarchy.");
+    r = binary_get_string(rd, &out->policyInstance);
+    return_if_error(r, "Deserialize policyInstance.");
+    r = binary_get_string(rd, &out->description);
+    return_if_error(r, "Deserialize description.");
+    r = binary_get_bytes(rd, &out->appData);
+    return_if_error(r, "Deserialize appData.");
+    r = binary_get_string(rd, &out->event_log);
+    return_if_error(r, "Deserialize event_log.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_HIERARCHY_serialize(BINARY_WRITER *w, const IFAPI_HIERARCHY *in)
+{
+    TSS2_RC r;
+
+    r = binary_put_uint8(w, in->with_auth);
+    return_if_error(r, "Serialize with_auth.");
+    r = binary_put_mu(w, TPM2B_DIGEST, &in->authPolicy);
+    return_if_error(r, "Serialize authPolicy.");
+    r = binary_put_string(w, in->description);
+    return_if_error(r, "Serialize description.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_HIERARCHY_deserialize(BINARY_READER *rd, IFAPI_HIERARCHY *out)
+{
+    TSS2_RC r;
+
+    r = binary_get_uint8(rd, &out->with_auth);
+    return_if_error(r, "Deserialize with_auth.");
+    r = binary_get_mu(rd, TPM2B_DIGEST, &out->authPolicy);
+    return_if_error(r, "Deserialize authPolicy.");
+    r = binary_get_string(rd, &out->description);
+    return_if_error(r, "Deserialize description.");
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_EXT_PUB_KEY_serialize(BINARY_WRITER *w, const IFAPI_EXT_PUB_KEY *in)
+{
+    TSS2_RC r;
+
+    r = binary_put_string(w, in->pem_ext_public);
+    return_if_error(r, "Serialize pem_ext_public.");
+    r = binary_put_optional_string(w, in->certificate);
+    return_if_error(r, "Serialize certificate.");
+
+    /* The public area is only present if it was initialized. */
+    r = binary_put_uint8(w, in->public.publicArea.type != 0);
+    return_if_error(r, "Serialize public.");
+    if (in->public.publicArea.type) {
+        r = binary_put_mu(w, TPM2B_PUBLIC, &in->public);
+        return_if_error(r, "Serialize public.");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+binary_IFAPI_EXT_PUB_KEY_deserialize(BINARY_READER *rd, IFAPI_EXT_PUB_KEY *out)
+{
+    TSS2_RC r;
+    UINT8 present;
+
+    r = binary_get_string(rd, &out->pem_ext_public);
+    return_if_error(r, "Deserialize pem_ext_public.");
+    r = binary_get_string(rd, &out->certificate);
+    return_if_error(r, "Deserialize certificate.");
+
+    r = binary_get_uint8(rd, &present);
+    return_if_error(r, "Deserialize public.");
+    if (present) {
+        r = binary_get_mu(rd, TPM2B_PUBLIC, &out->public);
+        return_if_error(r, "Deserialize public.");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free the members allocated by a failed deserialization. */
+static void
+binary_cleanup_object(IFAPI_OBJECT *object)
+{
+    switch (object->objectType) {
+    case IFAPI_KEY_OBJ:
+        SAFE_FREE(object->misc.key.serialization.buffer);
+        SAFE_FREE(object->misc.key.private.buffer);
+        SAFE_FREE(object->misc.key.appData.buffer);
+        SAFE_FREE(object->misc.key.policyInstance);
+        SAFE_FREE(object->misc.key.description);
+        SAFE_FREE(object->misc.key.certificate);
+        break;
+    case IFAPI_NV_OBJ:
+        SAFE_FREE(object->misc.nv.serialization.buffer);
+        SAFE_FREE(object->misc.nv.policyInstance);
+        SAFE_FREE(object->misc.nv.description);
+        SAFE_FREE(object->misc.nv.appData.buffer);
+        SAFE_FREE(object->misc.nv.event_log);
+        break;
+    case IFAPI_HIERARCHY_OBJ:
+        SAFE_FREE(object->misc.hierarchy.description);
+        break;
+    case IFAPI_EXT_PUB_KEY_OBJ:
+        SAFE_FREE(object->misc.ext_pub_key.pem_ext_public);
+        SAFE_FREE(object->misc.ext_pub_key.certificate);
+        break;
+    }
+    SAFE_FREE(object->policy);
+}
+
+/** Check whether a keystore file holds an object in the binary format.
+ *
+ * @param[in] buffer The content of the file.
+ * @param[in] size The size of the content.
+ * @retval true if the content starts with the binary object magic.
+ * @retval false if not, e.g. for a JSON object.
+ */
+bool
+ifapi_binary_object_p(const uint8_t *buffer, size_t size)
+{
+    return buffer != NULL && size >= sizeof(binary_magic) &&
+        memcmp(buffer, &binary_magic[0], sizeof(binary_magic)) == 0;
+}
+
+/** Serialize an IFAPI_OBJECT to the binary keystore format.
+ *
+ * @param[in] in The object to be serialized.
+ * @param[out] buffer The serialized object (callee-allocated; use free()).
+ * @param[out] size The size of the serialized object.
+ * @retval TSS2_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_FAPI_RC_NOT_IMPLEMENTED if the object type has no binary
+ *         encoding; such objects are stored as JSON.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if a member of the object can't be serialized.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ */
+TSS2_RC
+ifapi_binary_IFAPI_OBJECT_serialize(
+    const IFAPI_OBJECT *in,
+    uint8_t **buffer,
+    size_t *size)
+{
+    TSS2_RC r;
+    BINARY_WRITER w = { 0 };
+
+    return_if_null(in, "Bad reference.", TSS2_FAPI_RC_BAD_REFERENCE);
+    return_if_null(buffer, "Bad reference.", TSS2_FAPI_RC_BAD_REFERENCE);
+    return_if_null(size, "Bad reference.", TSS2_FAPI_RC_BAD_REFERENCE);
+
+    /* The duplicate objects for exports are rare and are kept as JSON. */
+    if (in->objectType == IFAPI_DUPLICATE_OBJ)
+        return TSS2_FAPI_RC_NOT_IMPLEMENTED;
+
+    r = binary_reserve(&w, sizeof(binary_magic));
+    goto_if_error(r, "Write header.", error_cleanup);
+    memcpy(w.buffer, &binary_magic[0], sizeof(binary_magic));
+    w.size = sizeof(binary_magic);
+
+    r = binary_put_uint32(&w, BINARY_VERSION);
+    goto_if_error(r, "Write header.", error_cleanup);
+    r = binary_put_uint32(&w, in->objectType);
+    goto_if_error(r, "Write header.", error_cleanup);
+    r = binary_put_uint8(&w, in->system);
+    goto_if_error(r, "Write header.", error_cleanup);
+
+    switch (in->objectType) {
+    case IFAPI_KEY_OBJ:
+        r = binary_IFAPI_KEY_serialize(&w, &in->misc.key);
+        break;
+    case IFAPI_NV_OBJ:
+        r = binary_IFAPI_NV_serialize(&w, &in->misc.nv);
+        break;
+    case IFAPI_HIERARCHY_OBJ:
+        r = binary_IFAPI_HIERARCHY_serialize(&w, &in->misc.hierarchy);
+        break;
+    case IFAPI_EXT_PUB_KEY_OBJ:
+        r = binary_IFAPI_EXT_PUB_KEY_serialize(&w, &in->misc.ext_pub_key);
+        break;
+    default:
+        goto_error(r, TSS2_FAPI_RC_GENERAL_FAILURE, "Invalid object type %"PRIu32,
+                   error_cleanup, in->objectType);
+    }
+    goto_if_error(r, "Serialize object.", error_cleanup);
+
+    r = binary_put_policy(&w, in->policy);
+    goto_if_error(r, "Serialize policy.", error_cleanup);
+
+    *buffer = w.buffer;
+    *size = w.size;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    SAFE_FREE(w.buffer);
+    return r;
+}
+
+/** Deserialize an IFAPI_OBJECT from the binary keystore format.
+ *
+ * @param[in] buffer The serialized object.
+ * @param[in] size The size of the serialized object.
+ * @param[out] out The deserialized object.
+ * @retval TSS2_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the buffer is not a valid binary object.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE a invalid null pointer is passed.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ */
+TSS2_RC
+ifapi_binary_IFAPI_OBJECT_deserialize(
+    const uint8_t *buffer,
+    size_t size,
+    IFAPI_OBJECT *out)
+{
+    TSS2_RC r;
+    UINT32 version;
+    BINARY_READER rd = { .buffer = buffer, .size = size };
+
+    return_if_null(out, "Bad reference.", TSS2_FAPI_RC_BAD_REFERENCE);
+
+    if (!ifapi_binary_object_p(buffer, size)) {
+        LOG_ERROR("No binary keystore object.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    rd.offset = sizeof(binary_magic);
+
+    r = binary_get_uint32(&rd, &version);
+    return_if_error(r, "Object truncated.");
+    if (version != BINARY_VERSION) {
+        LOG_ERROR("Unsupported binary object version %"PRIu32, version);
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    memset(&out->misc, 0, sizeof(out->misc));
+    out->rel_path = NULL;
+    out->policy = NULL;
+    r = binary_get_uint32(&rd, &out->objectType);
+    return_if_error(r, "Object truncated.");
+    r = binary_get_uint8(&rd, &out->system);
+    return_if_error(r, "Object truncated.");
+
+    switch (out->objectType) {
+    case IFAPI_KEY_OBJ:
+        r = binary_IFAPI_KEY_deserialize(&rd, &out->misc.key);
+        break;
+    case IFAPI_NV_OBJ:
+        r = binary_IFAPI_NV_deserialize(&rd, &out->misc.nv);
+        break;
+    case IFAPI_HIERARCHY_OBJ:
+        r = binary_IFAPI_HIERARCHY_deserialize(&rd, &out->misc.hierarchy);
+        break;
+    case IFAPI_EXT_PUB_KEY_OBJ:
+        r = binary_IFAPI_EXT_PUB_KEY_deserialize(&rd, &out->misc.ext_pub_key);
+        break;
+    default:
+        goto_error(r, TSS2_FAPI_RC_BAD_VALUE, "Invalid object type %"PRIu32,
+                   error_cleanup, out->objectType);
+    }
+    goto_if_error(r, "Deserialize object.", error_cleanup);
+
+    r = binary_get_policy(&rd, &out->policy);
+    goto_if_error(r, "Deserialize policy.", error_cleanup);
+
+    if (rd.offset != rd.size) {
+        goto_error(r, TSS2_FAPI_RC_BAD_VALUE, "Trailing data after object.",
+                   error_cleanup);
+    }
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    binary_cleanup_object(out);
+    out->objectType = IFAPI_OBJ_NONE;
+    return r;
+}
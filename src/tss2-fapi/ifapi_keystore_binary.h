@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+#ifndef IFAPI_KEYSTORE_BINARY_H
+#define IFAPI_KEYSTORE_BINARY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ifapi_io.h"
+#include "ifapi_keystore.h"
+
+bool
+ifapi_binary_object_p(
+    const uint8_t *buffer,
+    size_t size);
+
+TSS2_RC
+ifapi_binary_IFAPI_OBJECT_serialize(
+    const IFAPI_OBJECT *in,
+    uint8_t **buffer,
+    size_t *size);
+
+TSS2_RC
+ifapi_binary_IFAPI_OBJECT_deserialize(
+    const uint8_t *buffer,
+    size_t size,
+    IFAPI_OBJECT *out);
+
+#endif /* IFAPI_KEYSTORE_BINARY_H */
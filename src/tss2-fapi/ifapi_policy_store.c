@@ -14,6 +14,7 @@
 #include "ifapi_policy_types.h"
 #include "ifapi_policy_store.h"
 #include "ifapi_macros.h"
+#include "ifapi_timing.h"
 #define LOGMODULE fapi
 #include "util/log.h"
 #include "util/aux_util.h"
@@ -181,6 +182,7 @@ ifapi_policy_store_load_finish(
     TSS2_RC r;
     json_object *jso = NULL;
     uint8_t *buffer = NULL;
+    uint64_t start = 0;
     /* ptore parameter is used to be prepared if transmission of state information
        between async and finish will be necessary in future extensions. */
     (void)pstore;
@@ -190,14 +192,17 @@ ifapi_policy_store_load_finish(
     return_if_error(r, "keystore read_finish failed");
 
     /* If json objects can't be parse the object store is corrupted */
+    start = ifapi_timing_start();
     jso = json_tokener_parse((char *)buffer);
     SAFE_FREE(buffer);
-    return_if_null(jso, "Policy store is corrupted (Json error).", TSS2_FAPI_RC_GENERAL_FAILURE);
+    goto_if_null2(jso, "Policy store is corrupted (Json error).", r,
+                  TSS2_FAPI_RC_GENERAL_FAILURE, cleanup);
 
     r = ifapi_json_TPMS_POLICY_deserialize(jso, policy);
     goto_if_error(r, "Deserialize policy", cleanup);
 
 cleanup:
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
     SAFE_FREE(buffer);
     if (jso)
         json_object_put(jso);
@@ -233,6 +238,7 @@ ifapi_policy_store_store_async(
     char *jso_string = NULL;
     json_object *jso = NULL;
     char *abs_path = NULL;
+    uint64_t start = 0;
 
     LOG_TRACE("Store policy: %s", path);
 
@@ -241,6 +247,7 @@ ifapi_policy_store_store_async(
     goto_if_error2(r, "Path %s could not be created.", cleanup, path);
 
     /* Generate JSON string to be written to store */
+    start = ifapi_timing_start();
     r = ifapi_json_TPMS_POLICY_serialize(policy, &jso);
     goto_if_error2(r, "Policy %s could not be serialized.", cleanup, path);
 
@@ -248,6 +255,8 @@ ifapi_policy_store_store_async(
                                                        JSON_C_TO_STRING_PRETTY));
     goto_if_null2(jso_string, "Converting json to string", r, TSS2_FAPI_RC_MEMORY,
                   cleanup);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+    start = 0;
 
     /* Start writing the json string to disk */
     r = ifapi_io_write_async(io, abs_path, (uint8_t *) jso_string, strlen(jso_string));
@@ -255,6 +264,7 @@ ifapi_policy_store_store_async(
     goto_if_error(r, "write_async failed", cleanup);
 
 cleanup:
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
     if (jso)
         json_object_put(jso);
     SAFE_FREE(abs_path);
@@ -301,6 +301,12 @@ ifapi_profiles_finalize(
 
         ifapi_cleanup_policy(profile->sh_policy);
         SAFE_FREE(profile->sh_policy);
+
+        ifapi_cleanup_policy(profile->srk_policy);
+        SAFE_FREE(profile->srk_policy);
+
+        ifapi_cleanup_policy(profile->lockout_policy);
+        SAFE_FREE(profile->lockout_policy);
     }
     SAFE_FREE(profiles->profiles);
 
@@ -0,0 +1,725 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json-c/json.h>
+
+#include "ifapi_snapshot.h"
+#include "ifapi_helpers.h"
+#include "ifapi_policy_json_serialize.h"
+#include "ifapi_policy_json_deserialize.h"
+#define LOGMODULE fapi
+#include "util/log.h"
+#include "util/aux_util.h"
+#include "ifapi_macros.h"
+
+/*
+ * A snapshot holds the parsed configuration, all parsed profiles and the TPM
+ * properties queried during a Fapi_Initialize, so that later initializations
+ * can skip the JSON parsing and the capability round trips.
+ *
+ * The format is private to the library build that wrote it: the fixed size
+ * parts of IFAPI_CONFIG and IFAPI_PROFILE are stored in host layout and
+ * strings are stored length prefixed. The library version and the structure
+ * sizes are part of the header, so a snapshot written by another build is
+ * never used. Each input file is recorded with its inode, size and mtime in
+ * nanoseconds and the snapshot is discarded as soon as one of them differs.
+ * Files changed less than SNAPSHOT_RACY seconds before the snapshot was written
+ * are recorded with a stamp that never matches, since a second change within
+ * the timestamp granularity of the file system would go unnoticed.
+ */
+
+#define SNAPSHOT_MAGIC "TSS2SNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_RACY 2
+#define SNAPSHOT_NULL_STRING UINT32_MAX
+#define PROFILES_EXTENSION ".json"
+
+/* A stale snapshot is expected after every configuration change, so reading
+   one only logs at debug level where the mismatch is detected. */
+#define snapshot_return_if_error(r) \
+    if (r != TSS2_RC_SUCCESS) { \
+        return r; \
+    }
+
+/** The identity of a file the snapshot was built from. */
+typedef struct {
+    UINT64 ino;
+    INT64 mtime_sec;
+    INT64 mtime_nsec;
+    UINT64 size;
+} SNAPSHOT_STAMP;
+
+/** The fixed size header of a snapshot file. */
+typedef struct {
+    char magic[8];
+    UINT32 version;
+    UINT32 config_size;
+    UINT32 profile_size;
+    UINT32 profile_count;
+} SNAPSHOT_HEADER;
+
+/** A growing buffer the snapshot is serialized into. */
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t capacity;
+} SNAPSHOT_WRITER;
+
+/** A bounds checked cursor over a snapshot read into memory. */
+typedef struct {
+    const uint8_t *buffer;
+    size_t size;
+    size_t offset;
+} SNAPSHOT_READER;
+
+/** Determine the stamp of a file.
+ *
+ * A missing file results in a zeroed stamp, which never matches an existing
+ * file.
+ */
+static void
+snapshot_stamp(const char *path, SNAPSHOT_STAMP *stamp)
+{
+    struct stat st;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (stat(path, &st) != 0)
+        return;
+    stamp->ino = st.st_ino;
+    stamp->mtime_sec = st.st_mtim.tv_sec;
+    stamp->mtime_nsec = st.st_mtim.tv_nsec;
+    stamp->size = st.st_size;
+}
+
+static TSS2_RC
+snapshot_put(SNAPSHOT_WRITER *w, const void *data, size_t size)
+{
+    if (w->size + size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity : 4096;
+        uint8_t *buffer;
+
+        while (w->size + size > capacity)
+            capacity *= 2;
+        buffer = realloc(w->buffer, capacity);
+        return_if_null(buffer, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+        w->buffer = buffer;
+        w->capacity = capacity;
+    }
+    memcpy(&w->buffer[w->size], data, size);
+    w->size += size;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_put_string(SNAPSHOT_WRITER *w, const char *string)
+{
+    TSS2_RC r;
+    UINT32 length = string ? strlen(string) : SNAPSHOT_NULL_STRING;
+
+    r = snapshot_put(w, &length, sizeof(length));
+    return_if_error(r, "Write string length.");
+    if (string == NULL)
+        return TSS2_RC_SUCCESS;
+    return snapshot_put(w, string, length);
+}
+
+static TSS2_RC
+snapshot_put_stamp(SNAPSHOT_WRITER *w, const char *path)
+{
+    SNAPSHOT_STAMP stamp;
+    struct timespec now;
+
+    snapshot_stamp(path, &stamp);
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (stamp.mtime_sec >= now.tv_sec - SNAPSHOT_RACY) {
+        LOG_DEBUG("%s changed too recently to be recorded.", path);
+        memset(&stamp, 0, sizeof(stamp));
+    }
+    return snapshot_put(w, &stamp, sizeof(stamp));
+}
+
+static TSS2_RC
+snapshot_put_policy(SNAPSHOT_WRITER *w, const TPMS_POLICY *policy)
+{
+    TSS2_RC r;
+    json_object *jso = NULL;
+
+    if (policy == NULL)
+        return snapshot_put_string(w, NULL);
+
+    /* Policies are trees of pointers; they are kept in their JSON form. */
+    r = ifapi_json_TPMS_POLICY_serialize(policy, &jso);
+    return_if_error(r, "Serialize policy.");
+
+    r = snapshot_put_string(w, json_object_to_json_string_ext(jso,
+                                                              JSON_C_TO_STRING_PLAIN));
+    json_object_put(jso);
+    return r;
+}
+
+static TSS2_RC
+snapshot_get(SNAPSHOT_READER *r, void *data, size_t size)
+{
+    if (r->size - r->offset < size) {
+        LOG_DEBUG("Snapshot truncated.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    memcpy(data, &r->buffer[r->offset], size);
+    r->offset += size;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_get_string(SNAPSHOT_READER *r, char **string)
+{
+    TSS2_RC rc;
+    UINT32 length;
+
+    *string = NULL;
+    rc = snapshot_get(r, &length, sizeof(length));
+    snapshot_return_if_error(rc);
+    if (length == SNAPSHOT_NULL_STRING)
+        return TSS2_RC_SUCCESS;
+    if (r->size - r->offset < length) {
+        LOG_DEBUG("Snapshot truncated.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    *string = strndup((const char *) &r->buffer[r->offset], length);
+    return_if_null(*string, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+    r->offset += length;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Compare a recorded stamp with the current state of a file. */
+static TSS2_RC
+snapshot_check_stamp(SNAPSHOT_READER *r, const char *path)
+{
+    TSS2_RC rc;
+    SNAPSHOT_STAMP recorded, current;
+
+    rc = snapshot_get(r, &recorded, sizeof(recorded));
+    snapshot_return_if_error(rc);
+
+    snapshot_stamp(path, &current);
+    if (current.ino == 0 || memcmp(&recorded, &current, sizeof(current)) != 0) {
+        LOG_DEBUG("%s changed since the snapshot was written.", path);
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Compare a recorded string with the current one. */
+static TSS2_RC
+snapshot_check_string(SNAPSHOT_READER *r, const char *current)
+{
+    TSS2_RC rc;
+    char *recorded;
+    bool equal;
+
+    rc = snapshot_get_string(r, &recorded);
+    snapshot_return_if_error(rc);
+
+    if (recorded == NULL || current == NULL)
+        equal = recorded == NULL && current == NULL;
+    else
+        equal = strcmp(recorded, current) == 0;
+    SAFE_FREE(recorded);
+    if (!equal) {
+        LOG_DEBUG("Environment changed since the snapshot was written.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_get_policy(SNAPSHOT_READER *r, TPMS_POLICY **policy)
+{
+    TSS2_RC rc;
+    char *string;
+    json_object *jso;
+
+    *policy = NULL;
+    rc = snapshot_get_string(r, &string);
+    snapshot_return_if_error(rc);
+    if (string == NULL)
+        return TSS2_RC_SUCCESS;
+
+    jso = json_tokener_parse(string);
+    SAFE_FREE(string);
+    return_if_null(jso, "Snapshot policy is corrupted.", TSS2_FAPI_RC_BAD_VALUE);
+
+    *policy = calloc(1, sizeof(TPMS_POLICY));
+    goto_if_null2(*policy, "Out of memory.", rc, TSS2_FAPI_RC_MEMORY, cleanup);
+
+    rc = ifapi_json_TPMS_POLICY_deserialize(jso, *policy);
+    goto_if_error(rc, "Deserialize policy.", cleanup);
+
+    json_object_put(jso);
+    return TSS2_RC_SUCCESS;
+
+cleanup:
+    SAFE_FREE(*policy);
+    json_object_put(jso);
+    return rc;
+}
+
+/** Free the members of a configuration read from a snapshot. */
+static void
+snapshot_cleanup_config(IFAPI_CONFIG *config)
+{
+    SAFE_FREE(config->profile_dir);
+    SAFE_FREE(config->user_dir);
+    SAFE_FREE(config->keystore_dir);
+    SAFE_FREE(config->profile_name);
+    SAFE_FREE(config->tcti);
+    SAFE_FREE(config->log_dir);
+    SAFE_FREE(config->ek_cert_file);
+    SAFE_FREE(config->intel_cert_service);
+}
+
+/** Return the path of the snapshot file.
+ *
+ * @retval The file given by the environment variable TSS2_FAPI_SNAPSHOT or
+ *         NULL if no snapshot shall be used.
+ */
+const char *
+ifapi_snapshot_get_file(void)
+{
+    const char *file = getenv(ENV_FAPI_SNAPSHOT);
+
+    if (file == NULL || file[0] == '\0')
+        return NULL;
+    return file;
+}
+
+static TSS2_RC
+snapshot_read_profile(SNAPSHOT_READER *r, const char *profile_dir,
+                      IFAPI_PROFILE_ENTRY *entry)
+{
+    TSS2_RC rc;
+    char *filename = NULL;
+    IFAPI_PROFILE *profile = &entry->profile;
+
+    rc = snapshot_get_string(r, &entry->name);
+    snapshot_return_if_error(rc);
+    return_if_null(entry->name, "Snapshot is corrupted.", TSS2_FAPI_RC_BAD_VALUE);
+
+    rc = ifapi_asprintf(&filename, "%s/%s%s", profile_dir, entry->name,
+                        PROFILES_EXTENSION);
+    snapshot_return_if_error(rc);
+    rc = snapshot_check_stamp(r, filename);
+    SAFE_FREE(filename);
+    snapshot_return_if_error(rc);
+
+    rc = snapshot_get(r, profile, sizeof(*profile));
+    snapshot_return_if_error(rc);
+
+    /* The pointers were only valid in the process that wrote the snapshot. */
+    profile->srk_template = NULL;
+    profile->ek_template = NULL;
+    profile->eh_policy = NULL;
+    profile->sh_policy = NULL;
+    profile->ek_policy = NULL;
+    profile->srk_policy = NULL;
+    profile->lockout_policy = NULL;
+
+    rc = snapshot_get_string(r, &profile->srk_template);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &profile->ek_template);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_policy(r, &profile->eh_policy);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_policy(r, &profile->sh_policy);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_policy(r, &profile->ek_policy);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_policy(r, &profile->srk_policy);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_policy(r, &profile->lockout_policy);
+    snapshot_return_if_error(rc);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_read(SNAPSHOT_READER *r, const char *config_file,
+              IFAPI_CONFIG *config, IFAPI_PROFILES *profiles,
+              UINT32 *nv_buffer_max)
+{
+    TSS2_RC rc;
+    SNAPSHOT_HEADER header;
+    size_t i;
+
+    rc = snapshot_get(r, &header, sizeof(header));
+    snapshot_return_if_error(rc);
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != SNAPSHOT_VERSION ||
+            header.config_size != sizeof(IFAPI_CONFIG) ||
+            header.profile_size != sizeof(IFAPI_PROFILE) ||
+            header.profile_count == 0) {
+        LOG_DEBUG("Snapshot format not supported.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    /* Check the inputs first, so that a stale snapshot is dropped early. */
+    rc = snapshot_check_string(r, VERSION);
+    snapshot_return_if_error(rc);
+    rc = snapshot_check_string(r, config_file);
+    snapshot_return_if_error(rc);
+    rc = snapshot_check_stamp(r, config_file);
+    snapshot_return_if_error(rc);
+    /* The user directory of the configuration may be relative to $HOME */
+    rc = snapshot_check_string(r, getenv("HOME"));
+    snapshot_return_if_error(rc);
+
+    rc = snapshot_get(r, config, sizeof(*config));
+    snapshot_return_if_error(rc);
+    config->profile_dir = NULL;
+    config->user_dir = NULL;
+    config->keystore_dir = NULL;
+    config->profile_name = NULL;
+    config->tcti = NULL;
+    config->log_dir = NULL;
+    config->ek_cert_file = NULL;
+    config->intel_cert_service = NULL;
+
+    rc = snapshot_get_string(r, &config->profile_dir);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->user_dir);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->keystore_dir);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->profile_name);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->tcti);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->log_dir);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->ek_cert_file);
+    snapshot_return_if_error(rc);
+    rc = snapshot_get_string(r, &config->intel_cert_service);
+    snapshot_return_if_error(rc);
+    if (config->profile_dir == NULL || config->profile_name == NULL ||
+            config->tcti == NULL) {
+        LOG_DEBUG("Snapshot is corrupted.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    /* Adding or removing a profile changes the directory. */
+    rc = snapshot_check_stamp(r, config->profile_dir);
+    snapshot_return_if_error(rc);
+
+    profiles->default_name = strdup(config->profile_name);
+    return_if_null(profiles->default_name, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+
+    profiles->profiles = calloc(header.profile_count, sizeof(profiles->profiles[0]));
+    return_if_null(profiles->profiles, "Out of memory.", TSS2_FAPI_RC_MEMORY);
+
+    for (i = 0; i < header.profile_count; i++) {
+        /* Count the entry first so that it is freed on errors. */
+        profiles->num_profiles += 1;
+        rc = snapshot_read_profile(r, config->profile_dir, &profiles->profiles[i]);
+        snapshot_return_if_error(rc);
+    }
+    profiles->profiles_idx = profiles->num_profiles;
+
+    for (i = 0; i < profiles->num_profiles; i++) {
+        if (strcmp(profiles->default_name, profiles->profiles[i].name) == 0) {
+            profiles->default_profile = profiles->profiles[i].profile;
+            break;
+        }
+    }
+    if (i == profiles->num_profiles) {
+        LOG_DEBUG("Default profile not in snapshot.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+
+    /* The TPM properties depend on the TPM reached through config->tcti. */
+    rc = snapshot_get(r, nv_buffer_max, sizeof(*nv_buffer_max));
+    snapshot_return_if_error(rc);
+
+    if (r->offset != r->size) {
+        LOG_DEBUG("Snapshot has trailing data.");
+        return TSS2_FAPI_RC_BAD_VALUE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Load the configuration, profiles and TPM properties from a snapshot.
+ *
+ * The snapshot is read into memory and only used if it was written by
+ * this library version for the same configuration file, the same home
+ * directory and unchanged profiles. Otherwise nothing is returned and the
+ * caller has to perform a full initialization.
+ *
+ * @param[in] snapshot_file The snapshot to load.
+ * @param[in] config_file The configuration file in use.
+ * @param[out] config The configuration (members to be freed by the caller).
+ * @param[out] profiles The profiles (to be finalized by the caller).
+ * @param[out] nv_buffer_max The TPM2_PT_NV_BUFFER_MAX of the TPM, or 0 if it
+ *             is not known.
+ * @retval TSS2_RC_SUCCESS if the snapshot was loaded.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if a NULL pointer was passed.
+ * @retval TSS2_FAPI_RC_IO_ERROR if the snapshot cannot be read.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if the snapshot is stale or corrupted.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ */
+TSS2_RC
+ifapi_snapshot_load(
+    const char *snapshot_file,
+    const char *config_file,
+    IFAPI_CONFIG *config,
+    IFAPI_PROFILES *profiles,
+    UINT32 *nv_buffer_max)
+{
+    TSS2_RC r;
+    struct stat st;
+    uint8_t *buffer;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    check_not_null(snapshot_file);
+    check_not_null(config_file);
+    check_not_null(config);
+    check_not_null(profiles);
+    check_not_null(nv_buffer_max);
+
+    fd = open(snapshot_file, O_RDONLY);
+    if (fd < 0) {
+        LOG_DEBUG("No snapshot %s: %s", snapshot_file, strerror(errno));
+        return TSS2_FAPI_RC_IO_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return TSS2_FAPI_RC_IO_ERROR;
+    }
+    buffer = malloc(st.st_size);
+    if (buffer == NULL) {
+        close(fd);
+        LOG_ERROR("Out of memory.");
+        return TSS2_FAPI_RC_MEMORY;
+    }
+    while (done < (size_t) st.st_size) {
+        n = read(fd, &buffer[done], st.st_size - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if (done != (size_t) st.st_size) {
+        LOG_DEBUG("Could not read snapshot %s", snapshot_file);
+        free(buffer);
+        return TSS2_FAPI_RC_IO_ERROR;
+    }
+
+    SNAPSHOT_READER reader = { .buffer = buffer, .size = done, .offset = 0 };
+
+    memset(config, 0, sizeof(*config));
+    memset(profiles, 0, sizeof(*profiles));
+    *nv_buffer_max = 0;
+
+    r = snapshot_read(&reader, config_file, config, profiles, nv_buffer_max);
+    free(buffer);
+    if (r != TSS2_RC_SUCCESS) {
+        snapshot_cleanup_config(config);
+        ifapi_profiles_finalize(profiles);
+        *nv_buffer_max = 0;
+        return r;
+    }
+
+    LOG_DEBUG("Using snapshot %s", snapshot_file);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_write_profile(SNAPSHOT_WRITER *w, const char *profile_dir,
+                       const IFAPI_PROFILE_ENTRY *entry)
+{
+    TSS2_RC r;
+    char *filename = NULL;
+    const IFAPI_PROFILE *profile = &entry->profile;
+
+    r = snapshot_put_string(w, entry->name);
+    return_if_error(r, "Write profile.");
+
+    r = ifapi_asprintf(&filename, "%s/%s%s", profile_dir, entry->name,
+                       PROFILES_EXTENSION);
+    return_if_error(r, "Out of memory.");
+    r = snapshot_put_stamp(w, filename);
+    SAFE_FREE(filename);
+    return_if_error(r, "Write profile.");
+
+    r = snapshot_put(w, profile, sizeof(*profile));
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_string(w, profile->srk_template);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_string(w, profile->ek_template);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_policy(w, profile->eh_policy);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_policy(w, profile->sh_policy);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_policy(w, profile->ek_policy);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_policy(w, profile->srk_policy);
+    return_if_error(r, "Write profile.");
+    r = snapshot_put_policy(w, profile->lockout_policy);
+    return_if_error(r, "Write profile.");
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+snapshot_write(SNAPSHOT_WRITER *w, const char *config_file,
+               const IFAPI_CONFIG *config, const IFAPI_PROFILES *profiles,
+               UINT32 nv_buffer_max)
+{
+    TSS2_RC r;
+    SNAPSHOT_HEADER header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .config_size = sizeof(IFAPI_CONFIG),
+        .profile_size = sizeof(IFAPI_PROFILE),
+        .profile_count = profiles->num_profiles,
+    };
+    size_t i;
+
+    r = snapshot_put(w, &header, sizeof(header));
+    return_if_error(r, "Write header.");
+
+    r = snapshot_put_string(w, VERSION);
+    return_if_error(r, "Write version.");
+    r = snapshot_put_string(w, config_file);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_stamp(w, config_file);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, getenv("HOME"));
+    return_if_error(r, "Write config.");
+
+    r = snapshot_put(w, config, sizeof(*config));
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->profile_dir);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->user_dir);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->keystore_dir);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->profile_name);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->tcti);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->log_dir);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->ek_cert_file);
+    return_if_error(r, "Write config.");
+    r = snapshot_put_string(w, config->intel_cert_service);
+    return_if_error(r, "Write config.");
+
+    r = snapshot_put_stamp(w, config->profile_dir);
+    return_if_error(r, "Write config.");
+
+    for (i = 0; i < profiles->num_profiles; i++) {
+        r = snapshot_write_profile(w, config->profile_dir, &profiles->profiles[i]);
+        return_if_error(r, "Write profile.");
+    }
+
+    return snapshot_put(w, &nv_buffer_max, sizeof(nv_buffer_max));
+}
+
+/** Write a snapshot of a completed initialization.
+ *
+ * The snapshot is written to a temporary file which is then renamed, so that
+ * concurrent initializations either see the old or the new snapshot.
+ *
+ * @param[in] snapshot_file The snapshot to write.
+ * @param[in] config_file The configuration file config was read from.
+ * @param[in] config The configuration.
+ * @param[in] profiles The loaded profiles.
+ * @param[in] nv_buffer_max The TPM2_PT_NV_BUFFER_MAX of the TPM, or 0 if it
+ *            is not known.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_BAD_REFERENCE if a NULL pointer was passed.
+ * @retval TSS2_FAPI_RC_IO_ERROR if the snapshot cannot be written.
+ * @retval TSS2_FAPI_RC_MEMORY if not enough memory can be allocated.
+ * @retval TSS2_FAPI_RC_BAD_VALUE if a policy cannot be serialized.
+ */
+TSS2_RC
+ifapi_snapshot_save(
+    const char *snapshot_file,
+    const char *config_file,
+    const IFAPI_CONFIG *config,
+    const IFAPI_PROFILES *profiles,
+    UINT32 nv_buffer_max)
+{
+    TSS2_RC r;
+    SNAPSHOT_WRITER writer = { 0 };
+    char *tmp_file = NULL;
+    size_t written = 0;
+    ssize_t n;
+    int fd = -1;
+
+    check_not_null(snapshot_file);
+    check_not_null(config_file);
+    check_not_null(config);
+    check_not_null(profiles);
+
+    r = snapshot_write(&writer, config_file, config, profiles, nv_buffer_max);
+    goto_if_error(r, "Serialize snapshot.", cleanup);
+
+    r = ifapi_asprintf(&tmp_file, "%s.XXXXXX", snapshot_file);
+    goto_if_error(r, "Out of memory.", cleanup);
+
+    fd = mkstemp(tmp_file);
+    if (fd < 0) {
+        SAFE_FREE(tmp_file);
+        goto_error(r, TSS2_FAPI_RC_IO_ERROR, "Could not create snapshot %s: %s",
+                   cleanup, snapshot_file, strerror(errno));
+    }
+
+    while (written < writer.size) {
+        n = write(fd, &writer.buffer[written], writer.size - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            goto_error(r, TSS2_FAPI_RC_IO_ERROR, "Could not write %s: %s",
+                       cleanup, tmp_file, strerror(errno));
+        }
+        written += n;
+    }
+    close(fd);
+    fd = -1;
+
+    if (rename(tmp_file, snapshot_file) != 0) {
+        goto_error(r, TSS2_FAPI_RC_IO_ERROR, "Could not rename %s: %s",
+                   cleanup, tmp_file, strerror(errno));
+    }
+    LOG_DEBUG("Wrote snapshot %s", snapshot_file);
+
+cleanup:
+    if (fd >= 0)
+        close(fd);
+    if (r != TSS2_RC_SUCCESS && tmp_file != NULL)
+        unlink(tmp_file);
+    SAFE_FREE(tmp_file);
+    SAFE_FREE(writer.buffer);
+    return r;
+}
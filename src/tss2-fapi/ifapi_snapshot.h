@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+#ifndef IFAPI_SNAPSHOT_H
+#define IFAPI_SNAPSHOT_H
+
+#include "tss2_tpm2_types.h"
+#include "ifapi_config.h"
+#include "ifapi_profiles.h"
+
+/** Environment variable naming the snapshot file of a FAPI initialization. */
+#define ENV_FAPI_SNAPSHOT "TSS2_FAPI_SNAPSHOT"
+
+const char *
+ifapi_snapshot_get_file(void);
+
+TSS2_RC
+ifapi_snapshot_load(
+    const char *snapshot_file,
+    const char *config_file,
+    IFAPI_CONFIG *config,
+    IFAPI_PROFILES *profiles,
+    UINT32 *nv_buffer_max);
+
+TSS2_RC
+ifapi_snapshot_save(
+    const char *snapshot_file,
+    const char *config_file,
+    const IFAPI_CONFIG *config,
+    const IFAPI_PROFILES *profiles,
+    UINT32 nv_buffer_max);
+
+#endif /* IFAPI_SNAPSHOT_H */
@@ -0,0 +1,290 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ifapi_timing.h"
+#define LOGMODULE fapi
+#include "util/log.h"
+
+/*
+ * Timing hooks account the time spent in FAPI to I/O, JSON, binary objects,
+ * crypto and the TPM, so that a benchmark can tell them apart. They are disabled by default
+ * and then cost a single load per hook. The totals are shared by all contexts
+ * of the process and updated atomically, as file I/O runs on worker threads;
+ * time spent on a worker overlaps with the other phases.
+ *
+ * The time waited for the TPM is measured by a TCTI which wraps the TCTI of
+ * the context and forwards all calls to it, from the transmission of a command
+ * to the reception of its response.
+ */
+
+#define TCTI_TIMING_MAGIC 0x4641504954494d45ULL     /* 'FAPITIME' */
+#define TCTI_TIMING_VERSION 2
+
+/** The TCTI measuring the time from a command to its response. */
+typedef struct {
+    TSS2_TCTI_CONTEXT_COMMON_V2 common;
+    TSS2_TCTI_CONTEXT *tcti;    /**< The wrapped TCTI */
+    uint64_t sent;              /**< The time the last command was sent */
+} TCTI_TIMING;
+
+static bool timing_enabled;
+static IFAPI_TIMING timing_totals;
+
+static const char *timing_phase_names[IFAPI_TIMING_MAX] = {
+    [IFAPI_TIMING_IO] = "I/O",
+    [IFAPI_TIMING_JSON] = "JSON",
+    [IFAPI_TIMING_BINARY] = "binary",
+    [IFAPI_TIMING_CRYPTO] = "crypto",
+    [IFAPI_TIMING_TPM] = "TPM",
+};
+
+static uint64_t
+timing_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/** Enable or disable the timing hooks of all FAPI contexts.
+ *
+ * The time waited for the TPM is only measured for contexts initialized while
+ * the hooks are enabled.
+ *
+ * @param[in] enable Whether the hooks shall be enabled.
+ */
+void
+ifapi_timing_enable(bool enable)
+{
+    __atomic_store_n(&timing_enabled, enable, __ATOMIC_RELAXED);
+}
+
+/** Return whether the timing hooks are enabled. */
+bool
+ifapi_timing_enabled(void)
+{
+    return __atomic_load_n(&timing_enabled, __ATOMIC_RELAXED);
+}
+
+/** Return the accumulated times of all phases.
+ *
+ * @param[out] timing The totals since the last ifapi_timing_reset().
+ */
+void
+ifapi_timing_get(IFAPI_TIMING *timing)
+{
+    size_t i;
+
+    for (i = 0; i < IFAPI_TIMING_MAX; i++) {
+        timing->ns[i] = __atomic_load_n(&timing_totals.ns[i], __ATOMIC_RELAXED);
+        timing->count[i] = __atomic_load_n(&timing_totals.count[i],
+                                           __ATOMIC_RELAXED);
+    }
+}
+
+/** Set the accumulated times of all phases to zero. */
+void
+ifapi_timing_reset(void)
+{
+    size_t i;
+
+    for (i = 0; i < IFAPI_TIMING_MAX; i++) {
+        __atomic_store_n(&timing_totals.ns[i], 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&timing_totals.count[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+/** Return a printable name of a phase. */
+const char *
+ifapi_timing_phase_name(IFAPI_TIMING_PHASE phase)
+{
+    if (phase >= IFAPI_TIMING_MAX)
+        return "unknown";
+    return timing_phase_names[phase];
+}
+
+/** Start the measurement of a phase.
+ *
+ * @retval The start time to be passed to ifapi_timing_stop() or 0 if the
+ *         hooks are disabled.
+ */
+uint64_t
+ifapi_timing_start(void)
+{
+    if (!ifapi_timing_enabled())
+        return 0;
+    return timing_now();
+}
+
+/** Account the time since ifapi_timing_start() to a phase.
+ *
+ * Functions with several exits usually start with a start time of 0, stop
+ * the measurement in their cleanup path and reset the start time to 0 after
+ * an earlier stop, so that every measurement ends exactly once.
+ *
+ * @param[in] phase The phase of the measured code.
+ * @param[in] start The result of ifapi_timing_start(); 0 is ignored.
+ */
+void
+ifapi_timing_stop(IFAPI_TIMING_PHASE phase, uint64_t start)
+{
+    if (start == 0 || phase >= IFAPI_TIMING_MAX)
+        return;
+    __atomic_fetch_add(&timing_totals.ns[phase], timing_now() - start,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&timing_totals.count[phase], 1, __ATOMIC_RELAXED);
+}
+
+static TCTI_TIMING *
+tcti_timing_cast(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    if (tctiContext == NULL || TSS2_TCTI_MAGIC(tctiContext) != TCTI_TIMING_MAGIC)
+        return NULL;
+    return (TCTI_TIMING *) tctiContext;
+}
+
+static TSS2_RC
+tcti_timing_transmit(TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+                     const uint8_t *command)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    timing->sent = ifapi_timing_start();
+    return Tss2_Tcti_Transmit(timing->tcti, size, command);
+}
+
+static TSS2_RC
+tcti_timing_receive(TSS2_TCTI_CONTEXT *tctiContext, size_t *size,
+                    uint8_t *response, int32_t timeout)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+    TSS2_RC r;
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    r = Tss2_Tcti_Receive(timing->tcti, size, response, timeout);
+    /* A query of the size or a timeout does not end the command. */
+    if (r == TSS2_RC_SUCCESS && response != NULL) {
+        ifapi_timing_stop(IFAPI_TIMING_TPM, timing->sent);
+        timing->sent = 0;
+    }
+    return r;
+}
+
+static void
+tcti_timing_finalize(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    /* The wrapped TCTI is finalized by its owner after
+       ifapi_timing_tcti_unwrap(). */
+    (void)tctiContext;
+}
+
+static TSS2_RC
+tcti_timing_cancel(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    timing->sent = 0;
+    return Tss2_Tcti_Cancel(timing->tcti);
+}
+
+static TSS2_RC
+tcti_timing_get_poll_handles(TSS2_TCTI_CONTEXT *tctiContext,
+                             TSS2_TCTI_POLL_HANDLE *handles,
+                             size_t *num_handles)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    return Tss2_Tcti_GetPollHandles(timing->tcti, handles, num_handles);
+}
+
+static TSS2_RC
+tcti_timing_set_locality(TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    return Tss2_Tcti_SetLocality(timing->tcti, locality);
+}
+
+static TSS2_RC
+tcti_timing_make_sticky(TSS2_TCTI_CONTEXT *tctiContext, TPM2_HANDLE *handle,
+                        uint8_t sticky)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tctiContext);
+
+    if (timing == NULL)
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    return Tss2_Tcti_MakeSticky(timing->tcti, handle, sticky);
+}
+
+/** Wrap a TCTI into one measuring the time waited for the TPM.
+ *
+ * Nothing is done if the timing hooks are disabled.
+ *
+ * @param[in,out] tcti The TCTI to be wrapped; replaced by the wrapper.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_FAPI_RC_MEMORY if the wrapper cannot be allocated.
+ */
+TSS2_RC
+ifapi_timing_tcti_wrap(TSS2_TCTI_CONTEXT **tcti)
+{
+    TCTI_TIMING *timing;
+
+    if (!ifapi_timing_enabled())
+        return TSS2_RC_SUCCESS;
+
+    timing = calloc(1, sizeof(*timing));
+    if (timing == NULL) {
+        LOG_ERROR("Out of memory.");
+        return TSS2_FAPI_RC_MEMORY;
+    }
+    TSS2_TCTI_MAGIC(timing) = TCTI_TIMING_MAGIC;
+    TSS2_TCTI_VERSION(timing) = TCTI_TIMING_VERSION;
+    TSS2_TCTI_TRANSMIT(timing) = tcti_timing_transmit;
+    TSS2_TCTI_RECEIVE(timing) = tcti_timing_receive;
+    TSS2_TCTI_FINALIZE(timing) = tcti_timing_finalize;
+    TSS2_TCTI_CANCEL(timing) = tcti_timing_cancel;
+    TSS2_TCTI_GET_POLL_HANDLES(timing) = tcti_timing_get_poll_handles;
+    TSS2_TCTI_SET_LOCALITY(timing) = tcti_timing_set_locality;
+    TSS2_TCTI_MAKE_STICKY(timing) = tcti_timing_make_sticky;
+    timing->tcti = *tcti;
+    *tcti = (TSS2_TCTI_CONTEXT *) timing;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Remove the wrapper of ifapi_timing_tcti_wrap().
+ *
+ * @param[in] tcti A TCTI, wrapped or not. A wrapper is freed.
+ * @retval The wrapped TCTI or tcti if it is not a wrapper.
+ */
+TSS2_TCTI_CONTEXT *
+ifapi_timing_tcti_unwrap(TSS2_TCTI_CONTEXT *tcti)
+{
+    TCTI_TIMING *timing = tcti_timing_cast(tcti);
+
+    if (timing == NULL)
+        return tcti;
+    tcti = timing->tcti;
+    free(timing);
+    return tcti;
+}
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+#ifndef IFAPI_TIMING_H
+#define IFAPI_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tss2_tcti.h"
+
+/** The phases the time spent in FAPI is accounted to. */
+typedef enum {
+    IFAPI_TIMING_IO = 0,    /**< Reading and writing files */
+    IFAPI_TIMING_JSON,      /**< Parsing and serializing JSON */
+    IFAPI_TIMING_BINARY,    /**< Decoding and encoding binary objects */
+    IFAPI_TIMING_CRYPTO,    /**< Hashing and signature verification */
+    IFAPI_TIMING_TPM,       /**< Waiting for TPM responses */
+    IFAPI_TIMING_MAX
+} IFAPI_TIMING_PHASE;
+
+/** The accumulated time and number of measurements per phase. */
+typedef struct {
+    uint64_t ns[IFAPI_TIMING_MAX];
+    uint64_t count[IFAPI_TIMING_MAX];
+} IFAPI_TIMING;
+
+void
+ifapi_timing_enable(bool enable);
+
+bool
+ifapi_timing_enabled(void);
+
+void
+ifapi_timing_get(IFAPI_TIMING *timing);
+
+void
+ifapi_timing_reset(void);
+
+const char *
+ifapi_timing_phase_name(IFAPI_TIMING_PHASE phase);
+
+uint64_t
+ifapi_timing_start(void);
+
+void
+ifapi_timing_stop(IFAPI_TIMING_PHASE phase, uint64_t start);
+
+TSS2_RC
+ifapi_timing_tcti_wrap(TSS2_TCTI_CONTEXT **tcti);
+
+TSS2_TCTI_CONTEXT *
+ifapi_timing_tcti_unwrap(TSS2_TCTI_CONTEXT *tcti);
+
+#endif /* IFAPI_TIMING_H */
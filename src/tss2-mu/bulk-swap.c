@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "bulk-swap.h"
+#include "util/tss2_endian.h"
+
+/*
+ * The vector kernels are only built for x86 compilers that support per
+ * function target attributes. Which kernel is used is decided at runtime
+ * from the CPU feature flags, so the library still runs on CPUs without
+ * SSSE3 or AVX2.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define MU_BULK_SWAP_X86 1
+#include <immintrin.h>
+#endif
+
+static void
+bswap16_scalar(uint8_t *dest, uint8_t const *src, size_t count)
+{
+    uint16_t tmp;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&tmp, &src[i * sizeof(tmp)], sizeof(tmp));
+        tmp = HOST_TO_BE_16(tmp);
+        memcpy(&dest[i * sizeof(tmp)], &tmp, sizeof(tmp));
+    }
+}
+
+static void
+bswap32_scalar(uint8_t *dest, uint8_t const *src, size_t count)
+{
+    uint32_t tmp;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        memcpy(&tmp, &src[i * sizeof(tmp)], sizeof(tmp));
+        tmp = HOST_TO_BE_32(tmp);
+        memcpy(&dest[i * sizeof(tmp)], &tmp, sizeof(tmp));
+    }
+}
+
+#ifdef MU_BULK_SWAP_X86
+
+#define SHUFFLE_MASK_16 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+#define SHUFFLE_MASK_32 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+
+/*
+ * Swap 'bytes' bytes (a multiple of 16) with pshufb and return the number
+ * of bytes processed.
+ */
+__attribute__((target("ssse3")))
+static size_t
+bswap_ssse3(uint8_t *dest, uint8_t const *src, size_t bytes, __m128i mask)
+{
+    size_t i;
+
+    for (i = 0; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128((__m128i const *)&src[i]);
+        _mm_storeu_si128((__m128i *)&dest[i], _mm_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+bswap_avx2(uint8_t *dest, uint8_t const *src, size_t bytes, __m256i mask)
+{
+    size_t i;
+
+    for (i = 0; i + 32 <= bytes; i += 32) {
+        __m256i v = _mm256_loadu_si256((__m256i const *)&src[i]);
+        _mm256_storeu_si256((__m256i *)&dest[i], _mm256_shuffle_epi8(v, mask));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t
+bswap16_avx2(uint8_t *dest, uint8_t const *src, size_t bytes)
+{
+    return bswap_avx2(dest, src, bytes,
+                      _mm256_set_epi8(SHUFFLE_MASK_16, SHUFFLE_MASK_16));
+}
+
+__attribute__((target("avx2")))
+static size_t
+bswap32_avx2(uint8_t *dest, uint8_t const *src, size_t bytes)
+{
+    return bswap_avx2(dest, src, bytes,
+                      _mm256_set_epi8(SHUFFLE_MASK_32, SHUFFLE_MASK_32));
+}
+
+__attribute__((target("ssse3")))
+static size_t
+bswap16_ssse3(uint8_t *dest, uint8_t const *src, size_t bytes)
+{
+    return bswap_ssse3(dest, src, bytes, _mm_set_epi8(SHUFFLE_MASK_16));
+}
+
+__attribute__((target("ssse3")))
+static size_t
+bswap32_ssse3(uint8_t *dest, uint8_t const *src, size_t bytes)
+{
+    return bswap_ssse3(dest, src, bytes, _mm_set_epi8(SHUFFLE_MASK_32));
+}
+
+/*
+ * Run the widest vector kernel the CPU supports over the largest prefix of
+ * the array it can handle and return the number of bytes processed. The
+ * remaining tail is left to the scalar loop.
+ */
+static size_t
+bswap_vector(uint8_t *dest, uint8_t const *src, size_t bytes, int width)
+{
+    size_t done = 0;
+
+    /* Short lists (the common case) are not worth the dispatch. */
+    if (bytes < 16)
+        return 0;
+
+    if (__builtin_cpu_supports("avx2")) {
+        done = (width == 2) ? bswap16_avx2(dest, src, bytes)
+                            : bswap32_avx2(dest, src, bytes);
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        done += (width == 2) ? bswap16_ssse3(&dest[done], &src[done], bytes - done)
+                             : bswap32_ssse3(&dest[done], &src[done], bytes - done);
+    }
+    return done;
+}
+
+#else /* MU_BULK_SWAP_X86 */
+
+static size_t
+bswap_vector(uint8_t *dest, uint8_t const *src, size_t bytes, int width)
+{
+    (void)dest;
+    (void)src;
+    (void)bytes;
+    (void)width;
+    return 0;
+}
+
+#endif /* MU_BULK_SWAP_X86 */
+
+void
+mu_bswap16_array(uint8_t *dest, uint8_t const *src, size_t count)
+{
+    size_t done = bswap_vector(dest, src, count * sizeof(uint16_t),
+                               sizeof(uint16_t));
+
+    bswap16_scalar(&dest[done], &src[done], count - done / sizeof(uint16_t));
+}
+
+void
+mu_bswap32_array(uint8_t *dest, uint8_t const *src, size_t count)
+{
+    size_t done = bswap_vector(dest, src, count * sizeof(uint32_t),
+                               sizeof(uint32_t));
+
+    bswap32_scalar(&dest[done], &src[done], count - done / sizeof(uint32_t));
+}
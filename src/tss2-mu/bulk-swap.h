@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef BULK_SWAP_H
+#define BULK_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Copy 'count' 16 or 32 bit words from 'src' to 'dest' while converting
+ * them between host and TPM (big endian) byte order. The conversion is its
+ * own inverse, so the same kernel is used for marshalling and unmarshalling.
+ * Neither pointer needs to be aligned; the two areas must not overlap.
+ */
+void mu_bswap16_array(uint8_t *dest, uint8_t const *src, size_t count);
+void mu_bswap32_array(uint8_t *dest, uint8_t const *src, size_t count);
+
+#endif /* BULK_SWAP_H */
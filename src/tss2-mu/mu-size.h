@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef MU_SIZE_H
+#define MU_SIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tss2_mu.h"
+
+/*
+ * Size functions compute the wire size of a value from its members, without
+ * running the marshalling code. Scalars, TPMA bitfields and algorithm IDs are
+ * transmitted with their host width, so their size is their sizeof.
+ */
+#define MU_SCALAR_SIZE(src, size) (*(size) = sizeof(*(src)), TSS2_RC_SUCCESS)
+
+/*
+ * The wire size of a union is that of the member selected by the enclosing
+ * structure. These are only used by the size functions of the TPMS and TPMT
+ * types, which is why they are not part of the public API.
+ */
+#define MU_TPMU_SIZE_DECL(type) \
+TSS2_RC mu_##type##_size(type const *src, uint32_t selector, size_t *size)
+
+MU_TPMU_SIZE_DECL(TPMU_HA);
+MU_TPMU_SIZE_DECL(TPMU_CAPABILITIES);
+MU_TPMU_SIZE_DECL(TPMU_ATTEST);
+MU_TPMU_SIZE_DECL(TPMU_SYM_KEY_BITS);
+MU_TPMU_SIZE_DECL(TPMU_SYM_MODE);
+MU_TPMU_SIZE_DECL(TPMU_SIG_SCHEME);
+MU_TPMU_SIZE_DECL(TPMU_KDF_SCHEME);
+MU_TPMU_SIZE_DECL(TPMU_ASYM_SCHEME);
+MU_TPMU_SIZE_DECL(TPMU_SCHEME_KEYEDHASH);
+MU_TPMU_SIZE_DECL(TPMU_SIGNATURE);
+MU_TPMU_SIZE_DECL(TPMU_SENSITIVE_COMPOSITE);
+MU_TPMU_SIZE_DECL(TPMU_ENCRYPTED_SECRET);
+MU_TPMU_SIZE_DECL(TPMU_PUBLIC_ID);
+MU_TPMU_SIZE_DECL(TPMU_PUBLIC_PARMS);
+MU_TPMU_SIZE_DECL(TPMU_NAME);
+
+#endif /* MU_SIZE_H */
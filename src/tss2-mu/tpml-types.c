@@ -14,6 +14,7 @@
 
 #include "tss2_mu.h"
 
+#include "bulk-swap.h"
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
 #include "util/log.h"
@@ -150,32 +151,389 @@ TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
 }
 
 /*
- * These macros expand to (un)marshal functions for each of the TPML types
+ * Lists whose elements consist solely of 16 or 32 bit words have the same
+ * layout in host memory and on the wire apart from the byte order. These
+ * are converted in one go with the bulk byte swap kernels instead of going
+ * through the per-scalar marshalling functions for each word.
+ */
+#define TPML_BULK_MARSHAL(type, buf_name, width) \
+TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
+                                 size_t buffer_size, size_t *offset) \
+{ \
+    size_t  local_offset = 0; \
+    size_t  words, bytes; \
+    UINT32 count = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (offset != NULL) { \
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset); \
+        local_offset = *offset; \
+    } \
+\
+    if (src == NULL) { \
+        LOG_ERROR("src is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (buffer == NULL && offset == NULL) { \
+        LOG_ERROR("buffer and offset parameter are NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } else if (buffer_size < local_offset || \
+               buffer_size - local_offset < sizeof(count)) { \
+        LOG_WARNING(\
+             "buffer_size: %zu with offset: %zu are insufficient for object " \
+             "of size %zu", \
+             buffer_size, \
+             local_offset, \
+             sizeof(count)); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    LOG_DEBUG(\
+         "Marshalling " #type " from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR \
+         " at index 0x%zx", \
+         (uintptr_t)&src, \
+         (uintptr_t)buffer, \
+         local_offset); \
+\
+    ret = Tss2_MU_UINT32_Marshal(src->count, buffer, buffer_size, &local_offset); \
+    if (ret) \
+        return ret; \
+\
+    words = src->count * (sizeof(src->buf_name[0]) / sizeof(uint##width##_t)); \
+    bytes = words * sizeof(uint##width##_t); \
+    if (buffer != NULL) { \
+        if (buffer_size - local_offset < bytes) { \
+            LOG_WARNING(\
+                 "buffer_size: %zu with offset: %zu are insufficient for " \
+                 "list of size %zu", \
+                 buffer_size, \
+                 local_offset, \
+                 bytes); \
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+        } \
+        mu_bswap##width##_array(&buffer[local_offset], \
+                                (uint8_t const *)&src->buf_name[0], words); \
+    } \
+    local_offset += bytes; \
+\
+    if (offset != NULL) { \
+        *offset = local_offset; \
+        LOG_DEBUG("offset parameter non-NULL updated to %zu", *offset); \
+    } \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+#define TPML_BULK_UNMARSHAL(type, buf_name, width) \
+TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
+                                   size_t *offset, type *dest) \
+{ \
+    size_t  local_offset = 0; \
+    size_t  words, bytes; \
+    UINT32 count = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (offset != NULL) { \
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset); \
+        local_offset = *offset; \
+    } \
+\
+    if (buffer == NULL || (dest == NULL && offset == NULL)) { \
+        LOG_ERROR("buffer or dest and offset parameter are NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } else if (buffer_size < local_offset || \
+               sizeof(count) > buffer_size - local_offset) \
+    { \
+        LOG_WARNING(\
+             "buffer_size: %zu with offset: %zu are insufficient for object " \
+             "of size %zu", \
+             buffer_size, \
+             local_offset, \
+             sizeof(count)); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    LOG_DEBUG(\
+         "Unmarshaling " #type " from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR \
+         " at index 0x%zx", \
+         (uintptr_t)buffer, \
+         (uintptr_t)dest, \
+         local_offset); \
+\
+    ret = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &local_offset, &count); \
+    if (ret) \
+        return ret; \
+\
+    if (count > TAB_SIZE(dest->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_MALFORMED_RESPONSE; \
+    } \
+\
+    if (dest != NULL) { \
+        memset(dest, 0, sizeof(*dest)); \
+        dest->count = count; \
+    } \
+\
+    words = count * (sizeof(dest->buf_name[0]) / sizeof(uint##width##_t)); \
+    bytes = words * sizeof(uint##width##_t); \
+    if (buffer_size - local_offset < bytes) { \
+        LOG_WARNING(\
+             "buffer_size: %zu with offset: %zu are insufficient for list " \
+             "of size %zu", \
+             buffer_size, \
+             local_offset, \
+             bytes); \
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER; \
+    } \
+\
+    if (dest != NULL) \
+        mu_bswap##width##_array((uint8_t *)&dest->buf_name[0], \
+                                &buffer[local_offset], words); \
+    local_offset += bytes; \
+\
+    if (offset != NULL) { \
+        *offset = local_offset; \
+        LOG_DEBUG("offset parameter non-NULL, updated to %zu", *offset); \
+    } \
+\
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * Lists of variable size elements are sized by summing their elements.
+ */
+#define TPML_SIZE(type, size_func, buf_name) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t total = sizeof(src->count); \
+    size_t elem; \
+    TSS2_RC ret; \
+    UINT32 i; \
+\
+    if (src == NULL || size == NULL) { \
+        LOG_ERROR("src or size is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    for (i = 0; i < src->count; i++) { \
+        ret = size_func(&src->buf_name[i], &elem); \
+        if (ret) \
+            return ret; \
+        total += elem; \
+    } \
+\
+    *size = total; \
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * Lists of fixed size elements have a wire size that only depends on count.
+ */
+#define TPML_FIXED_SIZE(type, buf_name, elem_size) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    if (src == NULL || size == NULL) { \
+        LOG_ERROR("src or size is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->count > TAB_SIZE(src->buf_name)) { \
+        LOG_WARNING("count too big"); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    *size = sizeof(src->count) + src->count * (elem_size); \
+    return TSS2_RC_SUCCESS; \
+}
+
+/*
+ * These macros expand to (un)marshal and size functions for each of the TPML types
  * the specification part 2.
  */
-TPML_MARSHAL(TPML_CC, Tss2_MU_TPM2_CC_Marshal, commandCodes, VAL)
-TPML_UNMARSHAL(TPML_CC, Tss2_MU_TPM2_CC_Unmarshal, commandCodes)
-TPML_MARSHAL(TPML_CCA, Tss2_MU_TPMA_CC_Marshal, commandAttributes, VAL)
-TPML_UNMARSHAL(TPML_CCA, Tss2_MU_TPMA_CC_Unmarshal, commandAttributes)
-TPML_MARSHAL(TPML_ALG, Tss2_MU_UINT16_Marshal, algorithms, VAL)
-TPML_UNMARSHAL(TPML_ALG, Tss2_MU_UINT16_Unmarshal, algorithms)
-TPML_MARSHAL(TPML_HANDLE, Tss2_MU_UINT32_Marshal, handle, VAL)
-TPML_UNMARSHAL(TPML_HANDLE, Tss2_MU_UINT32_Unmarshal, handle)
+TPML_BULK_MARSHAL(TPML_CC, commandCodes, 32)
+TPML_BULK_UNMARSHAL(TPML_CC, commandCodes, 32)
+TPML_FIXED_SIZE(TPML_CC, commandCodes, sizeof(src->commandCodes[0]))
+TPML_BULK_MARSHAL(TPML_CCA, commandAttributes, 32)
+TPML_BULK_UNMARSHAL(TPML_CCA, commandAttributes, 32)
+TPML_FIXED_SIZE(TPML_CCA, commandAttributes, sizeof(src->commandAttributes[0]))
+TPML_BULK_MARSHAL(TPML_ALG, algorithms, 16)
+TPML_BULK_UNMARSHAL(TPML_ALG, algorithms, 16)
+TPML_FIXED_SIZE(TPML_ALG, algorithms, sizeof(src->algorithms[0]))
+TPML_BULK_MARSHAL(TPML_HANDLE, handle, 32)
+TPML_BULK_UNMARSHAL(TPML_HANDLE, handle, 32)
+TPML_FIXED_SIZE(TPML_HANDLE, handle, sizeof(src->handle[0]))
 TPML_MARSHAL(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Marshal, digests, ADDR)
 TPML_UNMARSHAL(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Unmarshal, digests)
-TPML_MARSHAL(TPML_ALG_PROPERTY, Tss2_MU_TPMS_ALG_PROPERTY_Marshal, algProperties, ADDR)
-TPML_UNMARSHAL(TPML_ALG_PROPERTY, Tss2_MU_TPMS_ALG_PROPERTY_Unmarshal, algProperties)
-TPML_MARSHAL(TPML_ECC_CURVE, Tss2_MU_UINT16_Marshal, eccCurves, VAL)
-TPML_UNMARSHAL(TPML_ECC_CURVE, Tss2_MU_UINT16_Unmarshal, eccCurves)
-TPML_MARSHAL(TPML_TAGGED_TPM_PROPERTY, Tss2_MU_TPMS_TAGGED_PROPERTY_Marshal, tpmProperty, ADDR)
-TPML_UNMARSHAL(TPML_TAGGED_TPM_PROPERTY, Tss2_MU_TPMS_TAGGED_PROPERTY_Unmarshal, tpmProperty)
+TPML_SIZE(TPML_DIGEST, Tss2_MU_TPM2B_DIGEST_Size, digests)
+TPML_BULK_MARSHAL(TPML_ECC_CURVE, eccCurves, 16)
+TPML_BULK_UNMARSHAL(TPML_ECC_CURVE, eccCurves, 16)
+TPML_FIXED_SIZE(TPML_ECC_CURVE, eccCurves, sizeof(src->eccCurves[0]))
+TPML_BULK_MARSHAL(TPML_TAGGED_TPM_PROPERTY, tpmProperty, 32)
+TPML_BULK_UNMARSHAL(TPML_TAGGED_TPM_PROPERTY, tpmProperty, 32)
+TPML_FIXED_SIZE(TPML_TAGGED_TPM_PROPERTY, tpmProperty, sizeof(src->tpmProperty[0]))
 TPML_MARSHAL(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Marshal, pcrProperty, ADDR)
 TPML_UNMARSHAL(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Unmarshal, pcrProperty)
+TPML_SIZE(TPML_TAGGED_PCR_PROPERTY, Tss2_MU_TPMS_TAGGED_PCR_SELECT_Size, pcrProperty)
 TPML_MARSHAL(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Marshal, pcrSelections, ADDR)
 TPML_UNMARSHAL(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Unmarshal, pcrSelections)
+TPML_SIZE(TPML_PCR_SELECTION, Tss2_MU_TPMS_PCR_SELECTION_Size, pcrSelections)
 TPML_MARSHAL(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Marshal, digests, ADDR)
 TPML_UNMARSHAL(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Unmarshal, digests)
-TPML_MARSHAL(TPML_INTEL_PTT_PROPERTY, Tss2_MU_UINT32_Marshal, property, VAL)
-TPML_UNMARSHAL(TPML_INTEL_PTT_PROPERTY, Tss2_MU_UINT32_Unmarshal, property)
+TPML_SIZE(TPML_DIGEST_VALUES, Tss2_MU_TPMT_HA_Size, digests)
+TPML_BULK_MARSHAL(TPML_INTEL_PTT_PROPERTY, property, 32)
+TPML_BULK_UNMARSHAL(TPML_INTEL_PTT_PROPERTY, property, 32)
+TPML_FIXED_SIZE(TPML_INTEL_PTT_PROPERTY, property, sizeof(src->property[0]))
 TPML_MARSHAL(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Marshal, acCapabilities, ADDR)
 TPML_UNMARSHAL(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Unmarshal, acCapabilities)
+TPML_SIZE(TPML_AC_CAPABILITIES, Tss2_MU_TPMS_AC_OUTPUT_Size, acCapabilities)
+
+/*
+ * TPMS_ALG_PROPERTY mixes a 16 and a 32 bit word, so its host layout is
+ * padded and differs from the packed wire layout. The list is converted
+ * in a single loop over the fixed 6 byte wire stride instead.
+ */
+#define ALG_PROPERTY_WIRE_SIZE (sizeof(TPM2_ALG_ID) + sizeof(TPMA_ALGORITHM))
+
+TSS2_RC
+Tss2_MU_TPML_ALG_PROPERTY_Marshal(
+    TPML_ALG_PROPERTY const *src,
+    uint8_t buffer[],
+    size_t buffer_size,
+    size_t *offset)
+{
+    size_t local_offset = 0;
+    size_t bytes;
+    UINT16 alg;
+    UINT32 props;
+    UINT32 i;
+    TSS2_RC ret;
+
+    if (offset != NULL) {
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset);
+        local_offset = *offset;
+    }
+
+    if (src == NULL) {
+        LOG_ERROR("src is NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+
+    if (buffer == NULL && offset == NULL) {
+        LOG_ERROR("buffer and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+
+    if (src->count > TAB_SIZE(src->algProperties)) {
+        LOG_WARNING("count too big");
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+
+    ret = Tss2_MU_UINT32_Marshal(src->count, buffer, buffer_size, &local_offset);
+    if (ret)
+        return ret;
+
+    bytes = src->count * ALG_PROPERTY_WIRE_SIZE;
+    if (buffer != NULL) {
+        if (buffer_size - local_offset < bytes) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for list of size %zu",
+                        buffer_size, local_offset, bytes);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        for (i = 0; i < src->count; i++) {
+            alg = HOST_TO_BE_16(src->algProperties[i].alg);
+            props = HOST_TO_BE_32(src->algProperties[i].algProperties);
+            memcpy(&buffer[local_offset], &alg, sizeof(alg));
+            memcpy(&buffer[local_offset + sizeof(alg)], &props, sizeof(props));
+            local_offset += ALG_PROPERTY_WIRE_SIZE;
+        }
+    } else {
+        local_offset += bytes;
+    }
+
+    if (offset != NULL) {
+        *offset = local_offset;
+        LOG_DEBUG("offset parameter non-NULL updated to %zu", *offset);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+Tss2_MU_TPML_ALG_PROPERTY_Unmarshal(
+    uint8_t const buffer[],
+    size_t buffer_size,
+    size_t *offset,
+    TPML_ALG_PROPERTY *dest)
+{
+    size_t local_offset = 0;
+    size_t bytes;
+    UINT16 alg;
+    UINT32 props;
+    UINT32 i, count = 0;
+    TSS2_RC ret;
+
+    if (offset != NULL) {
+        LOG_TRACE("offset non-NULL, initial value: %zu", *offset);
+        local_offset = *offset;
+    }
+
+    if (buffer == NULL || (dest == NULL && offset == NULL)) {
+        LOG_ERROR("buffer or dest and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+
+    ret = Tss2_MU_UINT32_Unmarshal(buffer, buffer_size, &local_offset, &count);
+    if (ret)
+        return ret;
+
+    if (count > TAB_SIZE(dest->algProperties)) {
+        LOG_WARNING("count too big");
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+    }
+
+    if (dest != NULL) {
+        memset(dest, 0, sizeof(*dest));
+        dest->count = count;
+    }
+
+    bytes = count * ALG_PROPERTY_WIRE_SIZE;
+    if (buffer_size - local_offset < bytes) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                    "for list of size %zu",
+                    buffer_size, local_offset, bytes);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+
+    if (dest != NULL) {
+        for (i = 0; i < count; i++) {
+            memcpy(&alg, &buffer[local_offset], sizeof(alg));
+            memcpy(&props, &buffer[local_offset + sizeof(alg)], sizeof(props));
+            dest->algProperties[i].alg = BE_TO_HOST_16(alg);
+            dest->algProperties[i].algProperties = BE_TO_HOST_32(props);
+            local_offset += ALG_PROPERTY_WIRE_SIZE;
+        }
+    } else {
+        local_offset += bytes;
+    }
+
+    if (offset != NULL) {
+        *offset = local_offset;
+        LOG_DEBUG("offset parameter non-NULL, updated to %zu", *offset);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TPML_FIXED_SIZE(TPML_ALG_PROPERTY, algProperties, ALG_PROPERTY_WIRE_SIZE)
@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "tss2_mu.h"
+#include "mu-size.h"
 
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
@@ -1311,3 +1312,336 @@ TPMS_MARSHAL_2(TPMS_ID_OBJECT,
 TPMS_UNMARSHAL_2(TPMS_ID_OBJECT,
                  integrityHMAC, Tss2_MU_TPM2B_DIGEST_Unmarshal,
                  encIdentity, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+
+/*
+ * The size functions add up the wire sizes of the members in the order they
+ * are marshalled: scalars are sized with MU_SCALAR_SIZE, structures with
+ * their own size function and unions with the size function of the member
+ * that the selector member picks. The _U variants name the selector.
+ */
+#define TPMS_SIZE_BEGIN(type) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = 0; \
+    size_t member_size = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    }
+
+#define TPMS_SIZE_MEMBER(m, fn) \
+    ret = fn(&src->m, &member_size); \
+    if (ret != TSS2_RC_SUCCESS) \
+        return ret; \
+    local_size += member_size;
+
+#define TPMS_SIZE_MEMBER_U(m, sel, fn) \
+    ret = fn(&src->m, src->sel, &member_size); \
+    if (ret != TSS2_RC_SUCCESS) \
+        return ret; \
+    local_size += member_size;
+
+#define TPMS_SIZE_END \
+    *size = local_size; \
+    return ret; \
+}
+
+#define TPMS_SIZE_0(type) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    *size = 0; \
+    return TSS2_RC_SUCCESS; \
+}
+
+#define TPMS_SIZE_1(type, m, fn) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m, fn) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_2(type, m1, fn1, m2, fn2) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_2_U(type, m1, fn1, m2, fn2) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER_U(m2, m1, fn2) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_3(type, m1, fn1, m2, fn2, m3, fn3) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_4(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+    TPMS_SIZE_MEMBER(m4, fn4) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_5(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4, m5, fn5) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+    TPMS_SIZE_MEMBER(m4, fn4) \
+    TPMS_SIZE_MEMBER(m5, fn5) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_7(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4, m5, fn5, \
+                    m6, fn6, m7, fn7) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+    TPMS_SIZE_MEMBER(m4, fn4) \
+    TPMS_SIZE_MEMBER(m5, fn5) \
+    TPMS_SIZE_MEMBER(m6, fn6) \
+    TPMS_SIZE_MEMBER(m7, fn7) \
+TPMS_SIZE_END
+
+/* The selector of the union m7 is m2, as in TPMS_MARSHAL_7_U. */
+#define TPMS_SIZE_7_U(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4, m5, fn5, \
+                      m6, fn6, m7, fn7) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+    TPMS_SIZE_MEMBER(m4, fn4) \
+    TPMS_SIZE_MEMBER(m5, fn5) \
+    TPMS_SIZE_MEMBER(m6, fn6) \
+    TPMS_SIZE_MEMBER_U(m7, m2, fn7) \
+TPMS_SIZE_END
+
+#define TPMS_SIZE_11(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4, m5, fn5, \
+                     m6, fn6, m7, fn7, m8, fn8, m9, fn9, m10, fn10, m11, fn11) \
+TPMS_SIZE_BEGIN(type) \
+    TPMS_SIZE_MEMBER(m1, fn1) \
+    TPMS_SIZE_MEMBER(m2, fn2) \
+    TPMS_SIZE_MEMBER(m3, fn3) \
+    TPMS_SIZE_MEMBER(m4, fn4) \
+    TPMS_SIZE_MEMBER(m5, fn5) \
+    TPMS_SIZE_MEMBER(m6, fn6) \
+    TPMS_SIZE_MEMBER(m7, fn7) \
+    TPMS_SIZE_MEMBER(m8, fn8) \
+    TPMS_SIZE_MEMBER(m9, fn9) \
+    TPMS_SIZE_MEMBER(m10, fn10) \
+    TPMS_SIZE_MEMBER(m11, fn11) \
+TPMS_SIZE_END
+
+#define TPMS_PCR_SIZE(type, firstFieldSize) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    if (src->sizeofSelect > TAB_SIZE(src->pcrSelect)) { \
+        LOG_ERROR("sizeofSelect value %"PRIu8"/%zi too big", src->sizeofSelect, \
+                  TAB_SIZE(src->pcrSelect)); \
+        return TSS2_SYS_RC_BAD_VALUE; \
+    } \
+\
+    *size = firstFieldSize + sizeof(src->sizeofSelect) + src->sizeofSelect; \
+    return TSS2_RC_SUCCESS; \
+}
+
+TPMS_PCR_SIZE(TPMS_PCR_SELECT, 0)
+
+TPMS_PCR_SIZE(TPMS_PCR_SELECTION, sizeof(src->hash))
+
+TPMS_PCR_SIZE(TPMS_TAGGED_PCR_SELECT, sizeof(src->tag))
+
+TPMS_SIZE_2(TPMS_ALG_PROPERTY,
+            alg, MU_SCALAR_SIZE,
+            algProperties, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_ALGORITHM_DESCRIPTION,
+            alg, MU_SCALAR_SIZE,
+            attributes, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_TAGGED_PROPERTY,
+            property, MU_SCALAR_SIZE,
+            value, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_TAGGED_POLICY,
+            handle, MU_SCALAR_SIZE,
+            policyHash, Tss2_MU_TPMT_HA_Size)
+
+TPMS_SIZE_4(TPMS_CLOCK_INFO,
+            clock, MU_SCALAR_SIZE,
+            resetCount, MU_SCALAR_SIZE,
+            restartCount, MU_SCALAR_SIZE,
+            safe, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_TIME_INFO,
+            time, MU_SCALAR_SIZE,
+            clockInfo, Tss2_MU_TPMS_CLOCK_INFO_Size)
+
+TPMS_SIZE_2(TPMS_TIME_ATTEST_INFO,
+            time, Tss2_MU_TPMS_TIME_INFO_Size,
+            firmwareVersion, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_CERTIFY_INFO,
+            name, Tss2_MU_TPM2B_NAME_Size,
+            qualifiedName, Tss2_MU_TPM2B_NAME_Size)
+
+TPMS_SIZE_4(TPMS_COMMAND_AUDIT_INFO,
+            auditCounter, MU_SCALAR_SIZE,
+            digestAlg, MU_SCALAR_SIZE,
+            auditDigest, Tss2_MU_TPM2B_DIGEST_Size,
+            commandDigest, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_2(TPMS_SESSION_AUDIT_INFO,
+            exclusiveSession, MU_SCALAR_SIZE,
+            sessionDigest, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_2(TPMS_CREATION_INFO,
+            objectName, Tss2_MU_TPM2B_NAME_Size,
+            creationHash, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_3(TPMS_NV_CERTIFY_INFO,
+            indexName, Tss2_MU_TPM2B_NAME_Size,
+            offset, MU_SCALAR_SIZE,
+            nvContents, Tss2_MU_TPM2B_MAX_NV_BUFFER_Size)
+
+TPMS_SIZE_4(TPMS_AUTH_COMMAND,
+            sessionHandle, MU_SCALAR_SIZE,
+            nonce, Tss2_MU_TPM2B_DIGEST_Size,
+            sessionAttributes, MU_SCALAR_SIZE,
+            hmac, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_3(TPMS_AUTH_RESPONSE,
+            nonce, Tss2_MU_TPM2B_DIGEST_Size,
+            sessionAttributes, MU_SCALAR_SIZE,
+            hmac, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_2(TPMS_SENSITIVE_CREATE,
+            userAuth, Tss2_MU_TPM2B_DIGEST_Size,
+            data, Tss2_MU_TPM2B_SENSITIVE_DATA_Size)
+
+TPMS_SIZE_1(TPMS_SCHEME_HASH,
+            hashAlg, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_SCHEME_ECDAA,
+            hashAlg, MU_SCALAR_SIZE,
+            count, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_SCHEME_XOR,
+            hashAlg, MU_SCALAR_SIZE,
+            kdf, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_ECC_POINT,
+            x, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+            y, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+
+TPMS_SIZE_2(TPMS_SIGNATURE_RSA,
+            hash, MU_SCALAR_SIZE,
+            sig, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Size)
+
+TPMS_SIZE_3(TPMS_SIGNATURE_ECC,
+            hash, MU_SCALAR_SIZE,
+            signatureR, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+            signatureS, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+
+TPMS_SIZE_2(TPMS_NV_PIN_COUNTER_PARAMETERS,
+            pinCount, MU_SCALAR_SIZE,
+            pinLimit, MU_SCALAR_SIZE)
+
+TPMS_SIZE_5(TPMS_NV_PUBLIC,
+            nvIndex, MU_SCALAR_SIZE,
+            nameAlg, MU_SCALAR_SIZE,
+            attributes, MU_SCALAR_SIZE,
+            authPolicy, Tss2_MU_TPM2B_DIGEST_Size,
+            dataSize, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_CONTEXT_DATA,
+            integrity, Tss2_MU_TPM2B_DIGEST_Size,
+            encrypted, Tss2_MU_TPM2B_CONTEXT_SENSITIVE_Size)
+
+TPMS_SIZE_4(TPMS_CONTEXT,
+            sequence, MU_SCALAR_SIZE,
+            savedHandle, MU_SCALAR_SIZE,
+            hierarchy, MU_SCALAR_SIZE,
+            contextBlob, Tss2_MU_TPM2B_CONTEXT_DATA_Size)
+
+TPMS_SIZE_2(TPMS_QUOTE_INFO,
+            pcrSelect, Tss2_MU_TPML_PCR_SELECTION_Size,
+            pcrDigest, Tss2_MU_TPM2B_DIGEST_Size)
+
+TPMS_SIZE_7(TPMS_CREATION_DATA,
+            pcrSelect, Tss2_MU_TPML_PCR_SELECTION_Size,
+            pcrDigest, Tss2_MU_TPM2B_DIGEST_Size,
+            locality, MU_SCALAR_SIZE,
+            parentNameAlg, MU_SCALAR_SIZE,
+            parentName, Tss2_MU_TPM2B_NAME_Size,
+            parentQualifiedName, Tss2_MU_TPM2B_NAME_Size,
+            outsideInfo, Tss2_MU_TPM2B_DATA_Size)
+
+TPMS_SIZE_4(TPMS_ECC_PARMS,
+            symmetric, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size,
+            scheme, Tss2_MU_TPMT_ECC_SCHEME_Size,
+            curveID, MU_SCALAR_SIZE,
+            kdf, Tss2_MU_TPMT_KDF_SCHEME_Size)
+
+TPMS_SIZE_7_U(TPMS_ATTEST,
+              magic, MU_SCALAR_SIZE,
+              type, MU_SCALAR_SIZE,
+              qualifiedSigner, Tss2_MU_TPM2B_NAME_Size,
+              extraData, Tss2_MU_TPM2B_DATA_Size,
+              clockInfo, Tss2_MU_TPMS_CLOCK_INFO_Size,
+              firmwareVersion, MU_SCALAR_SIZE,
+              attested, mu_TPMU_ATTEST_size)
+
+TPMS_SIZE_11(TPMS_ALGORITHM_DETAIL_ECC,
+             curveID, MU_SCALAR_SIZE,
+             keySize, MU_SCALAR_SIZE,
+             kdf, Tss2_MU_TPMT_KDF_SCHEME_Size,
+             sign, Tss2_MU_TPMT_ECC_SCHEME_Size,
+             p, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             a, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             b, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             gX, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             gY, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             n, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+             h, Tss2_MU_TPM2B_ECC_PARAMETER_Size)
+
+TPMS_SIZE_2_U(TPMS_CAPABILITY_DATA,
+              capability, MU_SCALAR_SIZE,
+              data, mu_TPMU_CAPABILITIES_size)
+
+TPMS_SIZE_1(TPMS_KEYEDHASH_PARMS,
+            scheme, Tss2_MU_TPMT_KEYEDHASH_SCHEME_Size)
+
+TPMS_SIZE_4(TPMS_RSA_PARMS,
+            symmetric, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size,
+            scheme, Tss2_MU_TPMT_RSA_SCHEME_Size,
+            keyBits, MU_SCALAR_SIZE,
+            exponent, MU_SCALAR_SIZE)
+
+TPMS_SIZE_1(TPMS_SYMCIPHER_PARMS,
+            sym, Tss2_MU_TPMT_SYM_DEF_OBJECT_Size)
+
+TPMS_SIZE_0(TPMS_EMPTY)
+
+TPMS_SIZE_2(TPMS_AC_OUTPUT,
+            tag, MU_SCALAR_SIZE,
+            data, MU_SCALAR_SIZE)
+
+TPMS_SIZE_2(TPMS_ID_OBJECT,
+            integrityHMAC, Tss2_MU_TPM2B_DIGEST_Size,
+            encIdentity, Tss2_MU_TPM2B_DIGEST_Size)
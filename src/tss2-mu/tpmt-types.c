@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "tss2_mu.h"
+#include "mu-size.h"
 
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
@@ -617,3 +618,143 @@ TPMT_MARSHAL_TK(TPMT_TK_HASHCHECK, tag, Tss2_MU_UINT16_Marshal,
 
 TPMT_UNMARSHAL_TK(TPMT_TK_HASHCHECK, tag, Tss2_MU_UINT16_Unmarshal,
                   hierarchy, Tss2_MU_UINT32_Unmarshal, digest, Tss2_MU_TPM2B_DIGEST_Unmarshal)
+
+/*
+ * The size functions add up the wire sizes of the members in the order they
+ * are marshalled. Union members are sized by the size function of the
+ * member their selector picks, see TPMS_SIZE_BEGIN in tpms-types.c.
+ */
+#define TPMT_SIZE_BEGIN(type) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    size_t local_size = 0; \
+    size_t member_size = 0; \
+    TSS2_RC ret = TSS2_RC_SUCCESS; \
+\
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    }
+
+#define TPMT_SIZE_MEMBER(m, fn) \
+    ret = fn(&src->m, &member_size); \
+    if (ret != TSS2_RC_SUCCESS) \
+        return ret; \
+    local_size += member_size;
+
+#define TPMT_SIZE_MEMBER_U(m, sel, fn) \
+    ret = fn(&src->m, src->sel, &member_size); \
+    if (ret != TSS2_RC_SUCCESS) \
+        return ret; \
+    local_size += member_size;
+
+#define TPMT_SIZE_END \
+    *size = local_size; \
+    return ret; \
+}
+
+#define TPMT_SIZE_2(type, m1, fn1, m2, sel, fn2) \
+TPMT_SIZE_BEGIN(type) \
+    TPMT_SIZE_MEMBER(m1, fn1) \
+    TPMT_SIZE_MEMBER_U(m2, sel, fn2) \
+TPMT_SIZE_END
+
+#define TPMT_SIZE_3(type, m1, fn1, m2, sel2, fn2, m3, sel3, fn3) \
+TPMT_SIZE_BEGIN(type) \
+    TPMT_SIZE_MEMBER(m1, fn1) \
+    TPMT_SIZE_MEMBER_U(m2, sel2, fn2) \
+    TPMT_SIZE_MEMBER_U(m3, sel3, fn3) \
+TPMT_SIZE_END
+
+#define TPMT_SIZE_4(type, m1, fn1, m2, fn2, m3, fn3, m4, sel4, fn4) \
+TPMT_SIZE_BEGIN(type) \
+    TPMT_SIZE_MEMBER(m1, fn1) \
+    TPMT_SIZE_MEMBER(m2, fn2) \
+    TPMT_SIZE_MEMBER(m3, fn3) \
+    TPMT_SIZE_MEMBER_U(m4, sel4, fn4) \
+TPMT_SIZE_END
+
+#define TPMT_SIZE_6(type, m1, fn1, m2, fn2, m3, fn3, m4, fn4, \
+                    m5, sel5, fn5, m6, sel6, fn6) \
+TPMT_SIZE_BEGIN(type) \
+    TPMT_SIZE_MEMBER(m1, fn1) \
+    TPMT_SIZE_MEMBER(m2, fn2) \
+    TPMT_SIZE_MEMBER(m3, fn3) \
+    TPMT_SIZE_MEMBER(m4, fn4) \
+    TPMT_SIZE_MEMBER_U(m5, sel5, fn5) \
+    TPMT_SIZE_MEMBER_U(m6, sel6, fn6) \
+TPMT_SIZE_END
+
+/* Tickets have no union member and are sized directly. */
+#define TPMT_SIZE_TK(type) \
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    TSS2_RC ret; \
+\
+    if (!src || !size) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    ret = Tss2_MU_TPM2B_DIGEST_Size(&src->digest, size); \
+    if (ret != TSS2_RC_SUCCESS) \
+        return ret; \
+\
+    *size += sizeof(src->tag) + sizeof(src->hierarchy); \
+    return TSS2_RC_SUCCESS; \
+}
+
+TPMT_SIZE_2(TPMT_HA, hashAlg, MU_SCALAR_SIZE,
+            digest, hashAlg, mu_TPMU_HA_size)
+
+TPMT_SIZE_3(TPMT_SYM_DEF, algorithm, MU_SCALAR_SIZE,
+            keyBits, algorithm, mu_TPMU_SYM_KEY_BITS_size,
+            mode, algorithm, mu_TPMU_SYM_MODE_size)
+
+TPMT_SIZE_3(TPMT_SYM_DEF_OBJECT, algorithm, MU_SCALAR_SIZE,
+            keyBits, algorithm, mu_TPMU_SYM_KEY_BITS_size,
+            mode, algorithm, mu_TPMU_SYM_MODE_size)
+
+TPMT_SIZE_2(TPMT_KEYEDHASH_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_SCHEME_KEYEDHASH_size)
+
+TPMT_SIZE_2(TPMT_SIG_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_SIG_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_KDF_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_KDF_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_ASYM_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_ASYM_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_RSA_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_ASYM_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_RSA_DECRYPT, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_ASYM_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_ECC_SCHEME, scheme, MU_SCALAR_SIZE,
+            details, scheme, mu_TPMU_ASYM_SCHEME_size)
+
+TPMT_SIZE_2(TPMT_SIGNATURE, sigAlg, MU_SCALAR_SIZE,
+            signature, sigAlg, mu_TPMU_SIGNATURE_size)
+
+TPMT_SIZE_4(TPMT_SENSITIVE, sensitiveType, MU_SCALAR_SIZE,
+            authValue, Tss2_MU_TPM2B_DIGEST_Size,
+            seedValue, Tss2_MU_TPM2B_DIGEST_Size,
+            sensitive, sensitiveType, mu_TPMU_SENSITIVE_COMPOSITE_size)
+
+TPMT_SIZE_6(TPMT_PUBLIC, type, MU_SCALAR_SIZE,
+            nameAlg, MU_SCALAR_SIZE,
+            objectAttributes, MU_SCALAR_SIZE,
+            authPolicy, Tss2_MU_TPM2B_DIGEST_Size,
+            parameters, type, mu_TPMU_PUBLIC_PARMS_size,
+            unique, type, mu_TPMU_PUBLIC_ID_size)
+
+TPMT_SIZE_2(TPMT_PUBLIC_PARMS, type, MU_SCALAR_SIZE,
+            parameters, type, mu_TPMU_PUBLIC_PARMS_size)
+
+TPMT_SIZE_TK(TPMT_TK_AUTH)
+TPMT_SIZE_TK(TPMT_TK_CREATION)
+TPMT_SIZE_TK(TPMT_TK_HASHCHECK)
+TPMT_SIZE_TK(TPMT_TK_VERIFIED)
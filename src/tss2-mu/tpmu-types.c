@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "tss2_mu.h"
+#include "mu-size.h"
 
 #include "util/tss2_endian.h"
 #define LOGMODULE marshal
@@ -629,3 +630,192 @@ TPMU_UNMARSHAL2(TPMU_NAME,
     sizeof(TPM2_ALG_ID) + TPM2_SHA256_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA384_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal,
     sizeof(TPM2_ALG_ID) + TPM2_SHA512_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Unmarshal)
+
+/*
+ * Size functions for the members of the TPMU_* types that are arrays of a
+ * fixed length, mirroring the marshal_* functions above.
+ */
+#define TAB_SIZE_FN(name, tab_size) \
+static TSS2_RC size_##name(BYTE const *src, size_t *size) \
+{ \
+    (void)(src); \
+    *size = tab_size; \
+    return TSS2_RC_SUCCESS; \
+}
+
+TAB_SIZE_FN(hash_sha, TPM2_SHA1_DIGEST_SIZE)
+TAB_SIZE_FN(hash_sha256, TPM2_SHA256_DIGEST_SIZE)
+TAB_SIZE_FN(hash_sha384, TPM2_SHA384_DIGEST_SIZE)
+TAB_SIZE_FN(hash_sha512, TPM2_SHA512_DIGEST_SIZE)
+TAB_SIZE_FN(sm3_256, TPM2_SM3_256_DIGEST_SIZE)
+TAB_SIZE_FN(ecc, sizeof(TPMS_ECC_POINT))
+TAB_SIZE_FN(rsa, TPM2_MAX_RSA_KEY_BYTES)
+TAB_SIZE_FN(symmetric, sizeof(TPM2B_DIGEST))
+TAB_SIZE_FN(keyedhash, sizeof(TPM2B_DIGEST))
+
+static TSS2_RC size_null(void const *src, size_t *size)
+{
+    (void)(src);
+    *size = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The TPMU_SIZE macro computes the wire size of the member picked by the
+ * selector. It takes 3-tuples of <selector, member, size function> and is
+ * padded by TPMU_SIZE2 in the same way as TPMU_MARSHAL. Like the marshal
+ * functions, an unknown selector selects no member.
+ */
+#define TPMU_SIZE(type, sel, m, fn, sel2, m2, fn2, sel3, m3, fn3, \
+                  sel4, m4, fn4, sel5, m5, fn5, sel6, m6, fn6, sel7, m7, fn7, \
+                  sel8, m8, fn8, sel9, m9, fn9, sel10, m10, fn10, \
+                  sel11, m11, fn11, ...) \
+MU_TPMU_SIZE_DECL(type) \
+{ \
+    if (src == NULL || size == NULL) { \
+        LOG_WARNING("src or size param is NULL"); \
+        return TSS2_MU_RC_BAD_REFERENCE; \
+    } \
+\
+    switch (selector) { \
+    case sel: \
+        return fn(&src->m, size); \
+    case sel2: \
+        return fn2(&src->m2, size); \
+    case sel3: \
+        return fn3(&src->m3, size); \
+    case sel4: \
+        return fn4(&src->m4, size); \
+    case sel5: \
+        return fn5(&src->m5, size); \
+    case sel6: \
+        return fn6(&src->m6, size); \
+    case sel7: \
+        return fn7(&src->m7, size); \
+    case sel8: \
+        return fn8(&src->m8, size); \
+    case sel9: \
+        return fn9(&src->m9, size); \
+    case sel10: \
+        return fn10(&src->m10, size); \
+    case sel11: \
+        return fn11(&src->m11, size); \
+    default: \
+        *size = 0; \
+        return TSS2_RC_SUCCESS; \
+    } \
+}
+
+#define TPMU_SIZE2(type, sel, m, fn, ...) \
+    TPMU_SIZE(type, sel, m, fn, __VA_ARGS__, -1, m, size_null, \
+              -2, m, size_null, -3, m, size_null, -4, m, size_null, \
+              -5, m, size_null, -6, m, size_null, -7, m, size_null, \
+              -8, m, size_null, -9, m, size_null)
+
+TPMU_SIZE2(TPMU_HA,
+    TPM2_ALG_SHA1, sha1[0], size_hash_sha,
+    TPM2_ALG_SHA256, sha256[0], size_hash_sha256,
+    TPM2_ALG_SHA384, sha384[0], size_hash_sha384,
+    TPM2_ALG_SHA512, sha512[0], size_hash_sha512,
+    TPM2_ALG_SM3_256, sm3_256[0], size_sm3_256)
+
+TPMU_SIZE2(TPMU_CAPABILITIES,
+    TPM2_CAP_ALGS, algorithms, Tss2_MU_TPML_ALG_PROPERTY_Size,
+    TPM2_CAP_HANDLES, handles, Tss2_MU_TPML_HANDLE_Size,
+    TPM2_CAP_COMMANDS, command, Tss2_MU_TPML_CCA_Size,
+    TPM2_CAP_PP_COMMANDS, ppCommands, Tss2_MU_TPML_CC_Size,
+    TPM2_CAP_AUDIT_COMMANDS, auditCommands, Tss2_MU_TPML_CC_Size,
+    TPM2_CAP_PCRS, assignedPCR, Tss2_MU_TPML_PCR_SELECTION_Size,
+    TPM2_CAP_TPM_PROPERTIES, tpmProperties, Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Size,
+    TPM2_CAP_PCR_PROPERTIES, pcrProperties, Tss2_MU_TPML_TAGGED_PCR_PROPERTY_Size,
+    TPM2_CAP_ECC_CURVES, eccCurves, Tss2_MU_TPML_ECC_CURVE_Size,
+    TPM2_CAP_VENDOR_PROPERTY, intelPttProperty, Tss2_MU_TPML_INTEL_PTT_PROPERTY_Size)
+
+TPMU_SIZE2(TPMU_ATTEST,
+    TPM2_ST_ATTEST_CERTIFY, certify, Tss2_MU_TPMS_CERTIFY_INFO_Size,
+    TPM2_ST_ATTEST_CREATION, creation, Tss2_MU_TPMS_CREATION_INFO_Size,
+    TPM2_ST_ATTEST_QUOTE, quote, Tss2_MU_TPMS_QUOTE_INFO_Size,
+    TPM2_ST_ATTEST_COMMAND_AUDIT, commandAudit, Tss2_MU_TPMS_COMMAND_AUDIT_INFO_Size,
+    TPM2_ST_ATTEST_SESSION_AUDIT, sessionAudit, Tss2_MU_TPMS_SESSION_AUDIT_INFO_Size,
+    TPM2_ST_ATTEST_TIME, time, Tss2_MU_TPMS_TIME_ATTEST_INFO_Size,
+    TPM2_ST_ATTEST_NV, nv, Tss2_MU_TPMS_NV_CERTIFY_INFO_Size)
+
+TPMU_SIZE2(TPMU_SYM_KEY_BITS,
+    TPM2_ALG_AES, aes, MU_SCALAR_SIZE,
+    TPM2_ALG_SM4, sm4, MU_SCALAR_SIZE,
+    TPM2_ALG_CAMELLIA, camellia, MU_SCALAR_SIZE,
+    TPM2_ALG_XOR, exclusiveOr, MU_SCALAR_SIZE)
+
+TPMU_SIZE2(TPMU_SYM_MODE,
+    TPM2_ALG_AES, aes, MU_SCALAR_SIZE,
+    TPM2_ALG_SM4, sm4, MU_SCALAR_SIZE,
+    TPM2_ALG_CAMELLIA, camellia, MU_SCALAR_SIZE)
+
+TPMU_SIZE2(TPMU_SIG_SCHEME,
+    TPM2_ALG_RSASSA, rsassa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSAPSS, rsapss, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDSA, ecdsa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDAA, ecdaa, Tss2_MU_TPMS_SCHEME_ECDAA_Size,
+    TPM2_ALG_SM2, sm2, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_HMAC, hmac, Tss2_MU_TPMS_SCHEME_HASH_Size)
+
+TPMU_SIZE2(TPMU_KDF_SCHEME,
+    TPM2_ALG_MGF1, mgf1, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_KDF1_SP800_56A, kdf1_sp800_56a, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_KDF1_SP800_108, kdf1_sp800_108, Tss2_MU_TPMS_SCHEME_HASH_Size)
+
+TPMU_SIZE2(TPMU_ASYM_SCHEME,
+    TPM2_ALG_ECDH, ecdh, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECMQV, ecmqv, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSASSA, rsassa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_RSAPSS, rsapss, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDSA, ecdsa, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECDAA, ecdaa, Tss2_MU_TPMS_SCHEME_ECDAA_Size,
+    TPM2_ALG_SM2, sm2, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_OAEP, oaep, Tss2_MU_TPMS_SCHEME_HASH_Size)
+
+TPMU_SIZE2(TPMU_SCHEME_KEYEDHASH,
+    TPM2_ALG_HMAC, hmac, Tss2_MU_TPMS_SCHEME_HASH_Size,
+    TPM2_ALG_XOR, exclusiveOr, Tss2_MU_TPMS_SCHEME_XOR_Size)
+
+TPMU_SIZE2(TPMU_SIGNATURE,
+    TPM2_ALG_RSASSA, rsassa, Tss2_MU_TPMS_SIGNATURE_RSA_Size,
+    TPM2_ALG_RSAPSS, rsapss, Tss2_MU_TPMS_SIGNATURE_RSA_Size,
+    TPM2_ALG_ECDSA, ecdsa, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_ECDAA, ecdaa, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_SM2, sm2, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_ECSCHNORR, ecschnorr, Tss2_MU_TPMS_SIGNATURE_ECC_Size,
+    TPM2_ALG_HMAC, hmac, Tss2_MU_TPMT_HA_Size)
+
+TPMU_SIZE2(TPMU_SENSITIVE_COMPOSITE,
+    TPM2_ALG_RSA, rsa, Tss2_MU_TPM2B_PRIVATE_KEY_RSA_Size,
+    TPM2_ALG_ECC, ecc, Tss2_MU_TPM2B_ECC_PARAMETER_Size,
+    TPM2_ALG_KEYEDHASH, bits, Tss2_MU_TPM2B_SENSITIVE_DATA_Size,
+    TPM2_ALG_SYMCIPHER, sym, Tss2_MU_TPM2B_SYM_KEY_Size)
+
+TPMU_SIZE2(TPMU_ENCRYPTED_SECRET,
+    TPM2_ALG_ECC, ecc[0], size_ecc,
+    TPM2_ALG_RSA, rsa[0], size_rsa,
+    TPM2_ALG_SYMCIPHER, symmetric[0], size_symmetric,
+    TPM2_ALG_KEYEDHASH, keyedHash[0], size_keyedhash)
+
+TPMU_SIZE2(TPMU_PUBLIC_ID,
+    TPM2_ALG_KEYEDHASH, keyedHash, Tss2_MU_TPM2B_DIGEST_Size,
+    TPM2_ALG_SYMCIPHER, sym, Tss2_MU_TPM2B_DIGEST_Size,
+    TPM2_ALG_RSA, rsa, Tss2_MU_TPM2B_PUBLIC_KEY_RSA_Size,
+    TPM2_ALG_ECC, ecc, Tss2_MU_TPMS_ECC_POINT_Size)
+
+TPMU_SIZE2(TPMU_PUBLIC_PARMS,
+    TPM2_ALG_KEYEDHASH, keyedHashDetail, Tss2_MU_TPMS_KEYEDHASH_PARMS_Size,
+    TPM2_ALG_SYMCIPHER, symDetail, Tss2_MU_TPMS_SYMCIPHER_PARMS_Size,
+    TPM2_ALG_RSA, rsaDetail, Tss2_MU_TPMS_RSA_PARMS_Size,
+    TPM2_ALG_ECC, eccDetail, Tss2_MU_TPMS_ECC_PARMS_Size)
+
+TPMU_SIZE2(TPMU_NAME,
+    sizeof(TPM2_HANDLE), handle, MU_SCALAR_SIZE,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA1_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA256_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA384_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Size,
+    sizeof(TPM2_ALG_ID) + TPM2_SHA512_DIGEST_SIZE, digest, Tss2_MU_TPMT_HA_Size)
@@ -40,12 +40,16 @@ TSS2_RC Tss2_Sys_AC_GetCapability_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_UINT32_Marshal(count, ctx->cmdBuffer,
                                   ctx->maxCmdSize,
                                   &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 0;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
@@ -58,6 +58,8 @@ TSS2_RC Tss2_Sys_ActivateCredential_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!secret) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -74,6 +76,8 @@ TSS2_RC Tss2_Sys_ActivateCredential_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -59,24 +59,32 @@ TSS2_RC Tss2_Sys_CertifyCreation_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval =  Tss2_MU_TPM2B_DIGEST_Marshal(creationHash, ctx->cmdBuffer,
                                          ctx->maxCmdSize,
                                          &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPMT_SIG_SCHEME_Marshal(inScheme, ctx->cmdBuffer,
                                            ctx->maxCmdSize,
                                            &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPMT_TK_CREATION_Marshal(creationTicket, ctx->cmdBuffer,
                                             ctx->maxCmdSize,
                                             &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -50,6 +50,8 @@ TSS2_RC Tss2_Sys_Commit_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!s2) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -65,6 +67,8 @@ TSS2_RC Tss2_Sys_Commit_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!y2) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -80,6 +84,8 @@ TSS2_RC Tss2_Sys_Commit_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -57,6 +57,8 @@ TSS2_RC Tss2_Sys_Create_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!inPublic) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -77,6 +79,8 @@ TSS2_RC Tss2_Sys_Create_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!outsideInfo) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -92,6 +96,8 @@ TSS2_RC Tss2_Sys_Create_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPML_PCR_SELECTION_Marshal(creationPCR,
                                               ctx->cmdBuffer,
                                               ctx->maxCmdSize,
@@ -99,6 +105,8 @@ TSS2_RC Tss2_Sys_Create_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
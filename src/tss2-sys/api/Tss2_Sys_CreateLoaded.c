@@ -53,12 +53,16 @@ TSS2_RC Tss2_Sys_CreateLoaded_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPM2B_TEMPLATE_Marshal(inPublic, ctx->cmdBuffer,
                                           ctx->maxCmdSize,
                                           &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -55,6 +55,8 @@ TSS2_RC Tss2_Sys_CreatePrimary_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!inPublic) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -74,6 +76,8 @@ TSS2_RC Tss2_Sys_CreatePrimary_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!outsideInfo) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -89,6 +93,8 @@ TSS2_RC Tss2_Sys_CreatePrimary_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPML_PCR_SELECTION_Marshal(creationPCR,
                                               ctx->cmdBuffer,
                                               ctx->maxCmdSize,
@@ -96,6 +102,8 @@ TSS2_RC Tss2_Sys_CreatePrimary_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
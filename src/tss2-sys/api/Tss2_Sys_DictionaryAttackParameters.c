@@ -41,17 +41,23 @@ TSS2_RC Tss2_Sys_DictionaryAttackParameters_Prepare(
                                   &ctx->nextData);
     if (rval)
         return rval;
+
+    CommonCpUpdate(ctx);
     rval = Tss2_MU_UINT32_Marshal(newRecoveryTime, ctx->cmdBuffer,
                                   ctx->maxCmdSize,
                                   &ctx->nextData);
     if (rval)
         return rval;
+
+    CommonCpUpdate(ctx);
     rval = Tss2_MU_UINT32_Marshal(lockoutRecovery, ctx->cmdBuffer,
                                   ctx->maxCmdSize,
                                   &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 0;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
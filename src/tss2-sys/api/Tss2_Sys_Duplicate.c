@@ -57,6 +57,8 @@ TSS2_RC Tss2_Sys_Duplicate_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPMT_SYM_DEF_OBJECT_Marshal(symmetricAlg,
                                                ctx->cmdBuffer,
                                                ctx->maxCmdSize,
@@ -64,6 +66,8 @@ TSS2_RC Tss2_Sys_Duplicate_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -48,6 +48,8 @@ TSS2_RC Tss2_Sys_ECDH_ZGen_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
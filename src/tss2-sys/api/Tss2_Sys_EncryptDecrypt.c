@@ -42,12 +42,16 @@ TSS2_RC Tss2_Sys_EncryptDecrypt_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_UINT16_Marshal(mode, ctx->cmdBuffer,
                                   ctx->maxCmdSize,
                                   &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!ivIn) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -63,6 +67,8 @@ TSS2_RC Tss2_Sys_EncryptDecrypt_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!inData) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -78,6 +84,8 @@ TSS2_RC Tss2_Sys_EncryptDecrypt_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 0;
     ctx->encryptAllowed = 1;
     ctx->authAllowed = 1;
@@ -42,6 +42,8 @@ TSS2_RC Tss2_Sys_FieldUpgradeData_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
@@ -56,6 +56,8 @@ TSS2_RC Tss2_Sys_FieldUpgradeStart_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPMT_SIGNATURE_Marshal(manifestSignature,
                                           ctx->cmdBuffer,
                                           ctx->maxCmdSize,
@@ -63,6 +65,8 @@ TSS2_RC Tss2_Sys_FieldUpgradeStart_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
@@ -53,12 +53,16 @@ TSS2_RC Tss2_Sys_HMAC_Start_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_UINT16_Marshal(hashAlg, ctx->cmdBuffer,
                                   ctx->maxCmdSize,
                                   &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
@@ -62,6 +62,8 @@ TSS2_RC Tss2_Sys_Initialize(
     ctx->tctiContext = tctiContext;
     InitSysContextPtrs(ctx, contextSize);
     InitSysContextFields(ctx);
+    ctx->cpCallback = NULL;
+    ctx->cpCallbackData = NULL;
     ctx->previousStage = CMD_STAGE_INITIALIZE;
 
     return TSS2_RC_SUCCESS;
@@ -54,6 +54,8 @@ TSS2_RC Tss2_Sys_NV_DefineSpace_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!publicInfo) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -69,6 +71,8 @@ TSS2_RC Tss2_Sys_NV_DefineSpace_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
@@ -40,12 +40,16 @@ TSS2_RC Tss2_Sys_PP_Commands_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_TPML_CC_Marshal(clearList, ctx->cmdBuffer,
                                    ctx->maxCmdSize,
                                    &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 0;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
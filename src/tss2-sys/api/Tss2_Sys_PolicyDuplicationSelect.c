@@ -51,6 +51,8 @@ TSS2_RC Tss2_Sys_PolicyDuplicationSelect_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!newParentName) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -66,12 +68,16 @@ TSS2_RC Tss2_Sys_PolicyDuplicationSelect_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_UINT8_Marshal(includeObject, ctx->cmdBuffer,
                                  ctx->maxCmdSize,
                                  &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
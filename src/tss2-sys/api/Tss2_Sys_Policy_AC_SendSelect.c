@@ -51,6 +51,8 @@ TSS2_RC Tss2_Sys_Policy_AC_SendSelect_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!authHandleName) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -66,6 +68,8 @@ TSS2_RC Tss2_Sys_Policy_AC_SendSelect_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     if (!acName) {
         rval = Tss2_MU_UINT16_Marshal(0, ctx->cmdBuffer,
                                       ctx->maxCmdSize,
@@ -81,11 +85,15 @@ TSS2_RC Tss2_Sys_Policy_AC_SendSelect_Prepare(
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     rval = Tss2_MU_UINT8_Marshal(includeObject, ctx->cmdBuffer,
                                  ctx->maxCmdSize, &ctx->nextData);
     if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 1;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
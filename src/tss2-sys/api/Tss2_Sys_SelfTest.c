@@ -32,6 +32,8 @@ TSS2_RC Tss2_Sys_SelfTest_Prepare(
      if (rval)
         return rval;
 
+    CommonCpUpdate(ctx);
+
     ctx->decryptAllowed = 0;
     ctx->encryptAllowed = 0;
     ctx->authAllowed = 1;
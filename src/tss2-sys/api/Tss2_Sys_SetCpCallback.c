@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************;
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ ***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "tss2_tpm2_types.h"
+#include "tss2_mu.h"
+#include "sysapi_util.h"
+
+/*
+ * Register a function that receives the command parameters while a _Prepare
+ * marshals them, e.g. to feed them into the cpHash of the command without
+ * reading the cp buffer again. It is called with consecutive parts of the cp
+ * buffer, usually one parameter at a time, starting at offset 0 for every
+ * command; a command without parameters is passed with a size of 0. The
+ * data is plain text: a caller that later replaces the first parameter with
+ * Tss2_Sys_SetDecryptParam must not rely on data derived from it. An error
+ * returned by the callback stops further calls and is returned from
+ * _Prepare. Passing a NULL callback removes it.
+ */
+TSS2_RC Tss2_Sys_SetCpCallback(
+    TSS2_SYS_CONTEXT *sysContext,
+    TSS2_SYS_CP_CALLBACK callback,
+    void *userData)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    ctx->cpCallback = callback;
+    ctx->cpCallbackData = userData;
+
+    return TSS2_RC_SUCCESS;
+}
@@ -24,6 +24,9 @@ void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx)
     ctx->decryptNull = 0;
     ctx->authAllowed = 0;
     ctx->nextData = 0;
+    ctx->cpCallbackCalled = 0;
+    ctx->cpCallbackOffset = 0;
+    ctx->cpCallbackRc = TSS2_RC_SUCCESS;
 }
 
 void InitSysContextPtrs(
@@ -95,10 +98,44 @@ TSS2_RC CommonPreparePrologue(
     return rval;
 }
 
+/*
+ * Pass the command parameters marshalled since the last call to the cp
+ * callback. The _Prepare functions call this after every parameter, so the
+ * callback sees each parameter while it is still in the cache. The first
+ * error of the callback is kept and returned by CommonPrepareEpilogue().
+ */
+void CommonCpUpdate(_TSS2_SYS_CONTEXT_BLOB *ctx)
+{
+    size_t used;
+
+    if (!ctx->cpCallback || ctx->cpCallbackRc != TSS2_RC_SUCCESS ||
+        ctx->cmdBuffer + ctx->nextData < ctx->cpBuffer)
+        return;
+
+    used = ctx->cmdBuffer + ctx->nextData - ctx->cpBuffer;
+    if (ctx->cpCallbackCalled && used == ctx->cpCallbackOffset)
+        return;
+
+    ctx->cpCallbackRc = ctx->cpCallback(ctx->commandCode,
+                                        ctx->cpCallbackOffset,
+                                        ctx->cpBuffer + ctx->cpCallbackOffset,
+                                        used - ctx->cpCallbackOffset,
+                                        ctx->cpCallbackData);
+    ctx->cpCallbackOffset = used;
+    ctx->cpCallbackCalled = 1;
+}
+
 TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
     ctx->cpBufferUsedSize = ctx->cmdBuffer + ctx->nextData - ctx->cpBuffer;
     req_header_from_cxt(ctx)->commandSize = HOST_TO_BE_32(ctx->nextData);
+
+    /* Pass what is left; a command without parameters is passed with a
+       size of 0, so the callback sees every command. */
+    CommonCpUpdate(ctx);
+    if (ctx->cpCallbackRc)
+        return ctx->cpCallbackRc;
+
     ctx->previousStage = CMD_STAGE_PREPARE;
 
     return TSS2_RC_SUCCESS;
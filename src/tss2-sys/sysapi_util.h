@@ -54,10 +54,19 @@ typedef struct {
         UINT16 encryptAllowed:1;
         UINT16 decryptNull:1;
         UINT16 authAllowed:1;
+        UINT16 cpCallbackCalled:1;
     };
 
     /* Offset to next data in command/response buffer. */
     size_t nextData;
+
+    /* Called with each command parameter right after it was marshalled. */
+    TSS2_SYS_CP_CALLBACK cpCallback;
+    void *cpCallbackData;
+    /* Size of the part of cpBuffer already passed to cpCallback. */
+    size_t cpCallbackOffset;
+    /* First error returned by cpCallback during the current prepare. */
+    TSS2_RC cpCallbackRc;
 } _TSS2_SYS_CONTEXT_BLOB;
 
 static inline _TSS2_SYS_CONTEXT_BLOB *
@@ -105,6 +114,7 @@ TSS2_RC CommonPreparePrologue(
     TPM2_CC commandCode);
 
 TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx);
+void CommonCpUpdate(_TSS2_SYS_CONTEXT_BLOB *ctx);
 bool IsAlgorithmWeak(TPM2_ALG_ID algorith, TPM2_KEY_SIZE key_size);
 TSS2_RC ValidatePublicTemplate(const TPM2B_PUBLIC *pub);
 TSS2_RC ValidateNV_Public(const TPM2B_NV_PUBLIC *nv_public_info);
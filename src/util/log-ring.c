@@ -0,0 +1,888 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define LOGMODULE log
+#include "log.h"
+#include "log-ring.h"
+
+#define likely(x)       __builtin_expect(!!(x), 1)
+#define unlikely(x)     __builtin_expect(!!(x), 0)
+
+/*
+ * The ring backend, selected with TSS2_LOG_BACKEND=ring. A message is stored
+ * as a fixed-size binary record in a ring of the logging thread: the pointers
+ * to the format and location strings, which are literals, and the arguments,
+ * with strings copied. A flusher thread formats the records and writes them
+ * to stderr, periodically and whenever a ring is half full. The logging
+ * thread never blocks; if its ring is full, the record is dropped and counted.
+ *
+ * This file is only built into libtss2-mu, which all other libraries link.
+ * The rings, the flusher and the thread key are private to it; the copies of
+ * log.c in the other libraries reach them through the functions declared in
+ * log-ring.h, so the messages of a thread are kept in order in one ring
+ * whichever library logged them.
+ */
+#define LOG_RING_RECORDS 1024           /* Default records per thread. */
+#define LOG_RING_RECORDS_MIN 16
+#define LOG_RING_RECORDS_MAX 65536
+#define LOG_RECORD_PAYLOAD 192          /* A multiple of LOG_BLOB_WIDTH. */
+#define LOG_RECORD_TEXT 1024            /* The longest formatted message. */
+#define LOG_FLUSH_INTERVAL_MS 10        /* Default interval of the flusher. */
+#define LOG_FLUSH_INTERVAL_MS_MAX 60000
+
+enum {
+    LOG_FLUSHER_NONE = 0,
+    LOG_FLUSHER_RUNNING,
+    LOG_FLUSHER_STOPPING
+};
+
+enum {
+    LOG_RECORD_MSG,                     /* A message of doLog. */
+    LOG_RECORD_BLOB_MSG,                /* The message of doLogBlob. */
+    LOG_RECORD_BLOB                     /* A part of the data of doLogBlob. */
+};
+
+typedef struct {
+    uint64_t timestamp;                 /* CLOCK_REALTIME in nanoseconds. */
+    const char *module;
+    const char *file;
+    const char *func;
+    const char *fmt;                    /* NULL for LOG_RECORD_BLOB. */
+    size_t blob;                        /* The size of the blob, or the
+                                           offset of the data in it. */
+    int line;
+    uint8_t level;
+    uint8_t type;
+    uint8_t truncated;                  /* Not all arguments were stored. */
+    uint16_t length;                    /* The bytes used of payload. */
+    union {
+        uint64_t align;
+        uint8_t bytes[LOG_RECORD_PAYLOAD];
+    } payload;
+} log_record;
+
+typedef struct log_ring log_ring;
+struct log_ring {
+    uint32_t head;                      /* Written by the owning thread. */
+    uint32_t tail;                      /* Written by the flusher. */
+    uint32_t dropped;                   /* Records dropped, the ring full. */
+    uint32_t size;                      /* The number of records, a power
+                                           of 2. */
+    int wakeup;                         /* The flusher was woken for this
+                                           ring and has not drained it yet. */
+    int orphaned;                       /* The owning thread has exited. */
+    log_ring *next;
+    log_record records[];
+};
+
+typedef struct {
+    pthread_mutex_t mutex;              /* Protects the fields below. */
+    pthread_cond_t cond;
+    log_ring *rings;
+    int flusher_state;
+    pthread_t flusher;
+    int key_created;
+    pthread_key_t key;                  /* Orphans the ring of a thread. */
+    int wakeup;                         /* A ring is half full. */
+} log_state;
+
+static log_state log_shared = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .flusher_state = LOG_FLUSHER_NONE,
+};
+static __thread log_ring *log_thread_ring;
+
+/* A conversion specification of a printf format. */
+typedef struct {
+    const char *start;                  /* The '%'. */
+    const char *modifier;               /* The length modifier or conversion. */
+    int width_star;
+    int precision;                      /* -1 if none, -2 for '*'. */
+    char length;                        /* 0, 'H' for hh, 'q' for ll or the
+                                           modifier character. */
+    char conversion;
+} log_spec;
+
+/* Set once the backend failed or the library is unloaded; the messages go to
+   stderr then. log_out is used with log_shared.mutex held. */
+static int log_disabled;
+static int log_atfork_registered;
+static char log_out[8192];
+static size_t log_out_len;
+
+/**
+ * Finds the next conversion specification of a format.
+ *
+ * @param fmt The format; advanced behind the specification.
+ * @param spec The specification found.
+ * @return 1 if a specification was found, 0 at the end of the format or at a
+ *         specification that cannot be stored in a record.
+ */
+static int
+log_next_spec(const char **fmt, log_spec *spec)
+{
+    const char *p = *fmt;
+
+    while ((p = strchr(p, '%')) != NULL && p[1] == '%')
+        p += 2;
+    if (p == NULL)
+        return 0;
+
+    spec->start = p++;
+    p += strspn(p, "-+ #0");
+    spec->width_star = *p == '*';
+    if (spec->width_star)
+        p++;
+    else
+        p += strspn(p, "0123456789");
+    spec->precision = -1;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->precision = -2;
+            p++;
+        } else {
+            spec->precision = atoi(p);
+            p += strspn(p, "0123456789");
+        }
+    }
+
+    spec->modifier = p;
+    spec->length = 0;
+    if ((p[0] == 'h' || p[0] == 'l') && p[1] == p[0]) {
+        spec->length = p[0] == 'h' ? 'H' : 'q';
+        p += 2;
+    } else if (*p != '\0' && strchr("hljztL", *p) != NULL) {
+        spec->length = *p++;
+    }
+
+    if (*p == '\0' || strchr("diouxXcsfFeEgGaAp", *p) == NULL ||
+        (spec->length == 'l' && (*p == 'c' || *p == 's')))
+        return 0;
+    spec->conversion = *p++;
+    *fmt = p;
+    return 1;
+}
+
+/** Appends an 8 byte value to the payload of a record. */
+static int
+log_put_value(log_record *record, const void *value)
+{
+    if ((size_t) record->length > LOG_RECORD_PAYLOAD - 8) {
+        record->truncated = 1;
+        return 0;
+    }
+    memcpy(&record->payload.bytes[record->length], value, 8);
+    record->length += 8;
+    return 1;
+}
+
+/**
+ * Appends a string to the payload of a record: its length as 8 byte value
+ * and its characters with a terminating zero, padded to 8 bytes. A string
+ * that does not fit is truncated.
+ */
+static int
+log_put_string(log_record *record, const char *s, int precision)
+{
+    uint64_t len;
+    size_t space;
+    int by_precision = 0;
+
+    if (s == NULL)
+        s = "(null)";
+    if ((size_t) record->length > LOG_RECORD_PAYLOAD - 8 - 1) {
+        record->truncated = 1;
+        return 0;
+    }
+    space = LOG_RECORD_PAYLOAD - record->length - 8 - 1;
+    if (precision >= 0 && (size_t) precision <= space) {
+        space = (size_t) precision;
+        by_precision = 1;
+    }
+    for (len = 0; len < space && s[len] != '\0'; len++);
+    memcpy(&record->payload.bytes[record->length], &len, 8);
+    memcpy(&record->payload.bytes[record->length + 8], s, len);
+    record->payload.bytes[record->length + 8 + len] = '\0';
+    record->length += (uint16_t) ((8 + len + 1 + 7) & ~(uint64_t) 7);
+    /* s may not be terminated behind the precision. */
+    if (!by_precision && len == space && s[len] != '\0') {
+        record->truncated = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Stores the arguments of a message in the payload of its record. Integers
+ * are stored as 64 bit values, floating point numbers as double and strings
+ * by value; the format is walked like printf does.
+ */
+static void
+log_encode_args(log_record *record, va_list ap)
+{
+    const char *fmt = record->fmt;
+    log_spec spec;
+    int64_t i;
+    uint64_t u;
+    double d;
+    int star;
+
+    while (log_next_spec(&fmt, &spec)) {
+        if (spec.width_star) {
+            i = va_arg(ap, int);
+            if (!log_put_value(record, &i))
+                return;
+        }
+        if (spec.precision == -2) {
+            star = va_arg(ap, int);
+            spec.precision = star;
+            i = star;
+            if (!log_put_value(record, &i))
+                return;
+        }
+        switch (spec.conversion) {
+        case 'd':
+        case 'i':
+            switch (spec.length) {
+            case 'H': i = (signed char) va_arg(ap, int); break;
+            case 'h': i = (short) va_arg(ap, int); break;
+            case 'l': i = va_arg(ap, long); break;
+            case 'q': i = va_arg(ap, long long); break;
+            case 'j': i = va_arg(ap, intmax_t); break;
+            case 'z': i = (ssize_t) va_arg(ap, size_t); break;
+            case 't': i = va_arg(ap, ptrdiff_t); break;
+            default: i = va_arg(ap, int); break;
+            }
+            if (!log_put_value(record, &i))
+                return;
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (spec.length) {
+            case 'H': u = (unsigned char) va_arg(ap, unsigned int); break;
+            case 'h': u = (unsigned short) va_arg(ap, unsigned int); break;
+            case 'l': u = va_arg(ap, unsigned long); break;
+            case 'q': u = va_arg(ap, unsigned long long); break;
+            case 'j': u = va_arg(ap, uintmax_t); break;
+            case 'z': u = va_arg(ap, size_t); break;
+            case 't': u = (uint64_t) va_arg(ap, ptrdiff_t); break;
+            default: u = va_arg(ap, unsigned int); break;
+            }
+            if (!log_put_value(record, &u))
+                return;
+            break;
+        case 'c':
+            i = va_arg(ap, int);
+            if (!log_put_value(record, &i))
+                return;
+            break;
+        case 'p':
+            u = (uintptr_t) va_arg(ap, void *);
+            if (!log_put_value(record, &u))
+                return;
+            break;
+        case 's':
+            if (!log_put_string(record, va_arg(ap, const char *),
+                                spec.precision))
+                return;
+            break;
+        default:
+            if (spec.length == 'L')
+                d = (double) va_arg(ap, long double);
+            else
+                d = va_arg(ap, double);
+            if (!log_put_value(record, &d))
+                return;
+            break;
+        }
+    }
+}
+
+/** Appends the text of a format between conversions, collapsing "%%". */
+static size_t
+log_put_literal(char *text, size_t pos, size_t size, const char *from,
+                const char *to)
+{
+    while (from < to && pos < size - 1) {
+        if (from[0] == '%' && from + 1 < to && from[1] == '%')
+            from++;
+        text[pos++] = *from++;
+    }
+    return pos;
+}
+
+/** Reads the next 8 byte value of the payload of a record. */
+static int
+log_get_value(const log_record *record, size_t *offset, void *value)
+{
+    if (*offset + 8 > record->length)
+        return 0;
+    memcpy(value, &record->payload.bytes[*offset], 8);
+    *offset += 8;
+    return 1;
+}
+
+#define LOG_FORMAT_VALUE(value) \
+    (stars == 0 ? snprintf(&text[pos], size - pos, format, value) : \
+     stars == 1 ? snprintf(&text[pos], size - pos, format, star[0], value) : \
+     snprintf(&text[pos], size - pos, format, star[0], star[1], value))
+
+/**
+ * Formats the message of a record with the arguments stored in its payload.
+ *
+ * @param record The record.
+ * @param text The buffer for the message.
+ * @param size The size of text.
+ * @return The length of the message.
+ */
+static size_t
+log_decode_msg(const log_record *record, char *text, size_t size)
+{
+    const char *fmt = record->fmt, *prev = record->fmt;
+    char format[32];
+    size_t pos = 0, offset = 0, flen;
+    log_spec spec;
+    int64_t i;
+    uint64_t u, len;
+    double d;
+    int star[2] = { 0, 0 }, stars, n = 0;
+
+    while (log_next_spec(&fmt, &spec)) {
+        pos = log_put_literal(text, pos, size, prev, spec.start);
+        prev = fmt;
+
+        stars = 0;
+        if (spec.width_star || spec.precision == -2) {
+            if (!log_get_value(record, &offset, &i))
+                break;
+            star[stars++] = (int) i;
+        }
+        if (spec.width_star && spec.precision == -2) {
+            if (!log_get_value(record, &offset, &i))
+                break;
+            star[stars++] = (int) i;
+        }
+
+        /* The specification without its length modifier, and the modifier
+           matching the type the argument is stored as. */
+        flen = (size_t) (spec.modifier - spec.start);
+        if (flen > sizeof(format) - 4)
+            break;
+        memcpy(format, spec.start, flen);
+        if (strchr("diouxX", spec.conversion) != NULL) {
+            format[flen++] = 'l';
+            format[flen++] = 'l';
+        }
+        format[flen++] = spec.conversion;
+        format[flen] = '\0';
+
+        switch (spec.conversion) {
+        case 'd':
+        case 'i':
+        case 'c':
+            if (!log_get_value(record, &offset, &i))
+                goto out;
+            n = spec.conversion == 'c' ? LOG_FORMAT_VALUE((int) i) :
+                LOG_FORMAT_VALUE((long long) i);
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'p':
+            if (!log_get_value(record, &offset, &u))
+                goto out;
+            n = spec.conversion == 'p' ?
+                LOG_FORMAT_VALUE((void *) (uintptr_t) u) :
+                LOG_FORMAT_VALUE((unsigned long long) u);
+            break;
+        case 's':
+            if (!log_get_value(record, &offset, &len) ||
+                offset + len >= record->length)
+                goto out;
+            n = LOG_FORMAT_VALUE((const char *) &record->payload.bytes[offset]);
+            offset = (offset + len + 1 + 7) & ~(size_t) 7;
+            break;
+        default:
+            if (!log_get_value(record, &offset, &d))
+                goto out;
+            n = LOG_FORMAT_VALUE(d);
+            break;
+        }
+        if (n < 0)
+            goto out;
+        pos += (size_t) n;
+        if (pos >= size - 1) {
+            pos = size - 1;
+            goto out;
+        }
+    }
+    if (!record->truncated)
+        pos = log_put_literal(text, pos, size, prev, prev + strlen(prev));
+out:
+    if (record->truncated && pos + 3 < size) {
+        memcpy(&text[pos], "...", 3);
+        pos += 3;
+    }
+    text[pos] = '\0';
+    return pos;
+}
+
+/** Appends to the output buffer of the flusher, writing it when full. */
+static void
+log_out_append(const char *data, size_t len)
+{
+    if (log_out_len + len > sizeof(log_out)) {
+        fwrite(log_out, 1, log_out_len, stderr);
+        log_out_len = 0;
+    }
+    if (len > sizeof(log_out)) {
+        fwrite(data, 1, len, stderr);
+        return;
+    }
+    memcpy(&log_out[log_out_len], data, len);
+    log_out_len += len;
+}
+
+/** Formats a record like the stderr backend, prefixed with its timestamp. */
+static void
+log_record_write(const log_record *record)
+{
+    char msg[LOG_RECORD_TEXT];
+    char text[LOG_RECORD_TEXT + 256];
+    char line[LOG_BLOB_LINE_LEN];
+    size_t i, n;
+    int len;
+
+    if (record->type == LOG_RECORD_BLOB) {
+        for (i = 0; i < record->length; i += n) {
+            n = record->length - i < LOG_BLOB_WIDTH ?
+                record->length - i : LOG_BLOB_WIDTH;
+            log_out_append(line, log_blob_line(line, record->blob + i,
+                                               &record->payload.bytes[i], n));
+        }
+        return;
+    }
+
+    n = log_decode_msg(record, msg, sizeof(msg));
+    if (record->type == LOG_RECORD_BLOB_MSG)
+        snprintf(&msg[n], sizeof(msg) - n, " (size=%zu):", record->blob);
+    len = snprintf(text, sizeof(text),
+                   "%" PRIu64 ".%06" PRIu64 " %s:%s:%s:%d:%s() %s \n",
+                   record->timestamp / 1000000000,
+                   record->timestamp % 1000000000 / 1000,
+                   log_strings[record->level], record->module,
+                   record->file, record->line, record->func, msg);
+    if (len > 0)
+        log_out_append(text, (size_t) len < sizeof(text) ?
+                       (size_t) len : sizeof(text) - 1);
+}
+
+/**
+ * Formats and writes the records of all rings and frees the rings of exited
+ * threads. Called with log_shared.mutex held.
+ */
+static void
+log_rings_drain(void)
+{
+    log_ring **link = &log_shared.rings, *ring;
+    uint32_t head, tail, dropped;
+    int orphaned;
+    char text[128];
+    int len;
+
+    while ((ring = *link) != NULL) {
+        /* Records committed before the thread exited are visible once
+           orphaned is. */
+        orphaned = __atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        for (tail = ring->tail; tail != head; tail++) {
+            log_record_write(&ring->records[tail & (ring->size - 1)]);
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&ring->wakeup, 0, __ATOMIC_RELAXED);
+        dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+        if (dropped > 0) {
+            len = snprintf(text, sizeof(text), "%s:%s: %" PRIu32
+                           " messages dropped, the log ring was full \n",
+                           log_strings[LOGLEVEL_WARNING], xstr(LOGMODULE),
+                           dropped);
+            log_out_append(text, (size_t) len);
+        }
+        if (orphaned) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    fwrite(log_out, 1, log_out_len, stderr);
+    log_out_len = 0;
+}
+
+/**
+ * Reads a number from the environment.
+ *
+ * @param name The name of the variable.
+ * @param def The value if the variable is not set or not a number.
+ * @param min The smallest value.
+ * @param max The largest value.
+ * @return The value, limited to min and max.
+ */
+static unsigned long
+log_env_number(const char *name, unsigned long def, unsigned long min,
+               unsigned long max)
+{
+    const char *env = getenv(name);
+    unsigned long value;
+    char *end;
+
+    if (env == NULL || *env == '\0')
+        return def;
+    value = strtoul(env, &end, 10);
+    if (*end != '\0')
+        return def;
+    return value < min ? min : value > max ? max : value;
+}
+
+/** The flusher thread. */
+static void *
+log_flush_thread(void *arg)
+{
+    struct timespec deadline;
+    unsigned long interval;
+    long nsec;
+
+    (void) arg;
+    interval = log_env_number("TSS2_LOG_FLUSH_INTERVAL", LOG_FLUSH_INTERVAL_MS,
+                              1, LOG_FLUSH_INTERVAL_MS_MAX);
+    pthread_mutex_lock(&log_shared.mutex);
+    while (log_shared.flusher_state == LOG_FLUSHER_RUNNING) {
+        log_rings_drain();
+        /* A ring that became half full while draining is drained again
+           right away. */
+        if (__atomic_exchange_n(&log_shared.wakeup, 0, __ATOMIC_RELAXED))
+            continue;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t) (interval / 1000);
+        nsec = deadline.tv_nsec + (long) (interval % 1000) * 1000000L;
+        deadline.tv_sec += nsec / 1000000000L;
+        deadline.tv_nsec = nsec % 1000000000L;
+        pthread_cond_timedwait(&log_shared.cond, &log_shared.mutex, &deadline);
+    }
+    pthread_mutex_unlock(&log_shared.mutex);
+    return NULL;
+}
+
+/**
+ * The destructor of the ring of a thread: hands it to the flusher. Messages
+ * logged by later destructors of the thread get a new ring.
+ */
+static void
+log_ring_orphan(void *ring)
+{
+    if (log_thread_ring == ring)
+        log_thread_ring = NULL;
+    __atomic_store_n(&((log_ring *) ring)->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+static void
+log_atfork_prepare(void)
+{
+    pthread_mutex_lock(&log_shared.mutex);
+}
+
+static void
+log_atfork_parent(void)
+{
+    pthread_mutex_unlock(&log_shared.mutex);
+}
+
+/*
+ * Only the forking thread exists in the child and the parent writes the
+ * pending records. The child drops them and starts a new flusher with its
+ * next message.
+ */
+static void
+log_atfork_child(void)
+{
+    log_ring *ring;
+
+    for (ring = log_shared.rings; ring != NULL; ring = ring->next) {
+        ring->tail = ring->head;
+        ring->orphaned = 1;
+    }
+    log_thread_ring = NULL;
+    if (log_shared.key_created)
+        pthread_setspecific(log_shared.key, NULL);
+    log_shared.flusher_state = LOG_FLUSHER_NONE;
+    pthread_mutex_unlock(&log_shared.mutex);
+}
+
+/**
+ * Creates the key orphaning the rings of exiting threads, if it does not
+ * exist. Called with log_shared.mutex held.
+ */
+static int
+log_key_create(void)
+{
+    if (log_shared.key_created)
+        return 1;
+    if (!log_atfork_registered) {
+        if (pthread_atfork(log_atfork_prepare, log_atfork_parent,
+                           log_atfork_child) != 0)
+            return 0;
+        log_atfork_registered = 1;
+    }
+    if (pthread_key_create(&log_shared.key, log_ring_orphan) != 0)
+        return 0;
+    log_shared.key_created = 1;
+    return 1;
+}
+
+/**
+ * Starts the flusher thread with all signals blocked, if it is not running.
+ * Called with log_shared.mutex held.
+ */
+static int
+log_flusher_start(void)
+{
+    sigset_t all, old;
+    int r;
+
+    if (log_shared.flusher_state != LOG_FLUSHER_NONE)
+        return 1;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    r = pthread_create(&log_shared.flusher, NULL, log_flush_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (r != 0)
+        return 0;
+    log_shared.flusher_state = LOG_FLUSHER_RUNNING;
+    return 1;
+}
+
+/**
+ * Allocates the ring of the calling thread and registers it with the key and
+ * the flusher, starting them if needed.
+ *
+ * @return The ring, or NULL if the ring backend is not available.
+ */
+static log_ring *
+log_ring_attach(void)
+{
+    unsigned long records;
+    uint32_t size;
+    log_ring *ring;
+
+    pthread_mutex_lock(&log_shared.mutex);
+    if (__atomic_load_n(&log_disabled, __ATOMIC_RELAXED)) {
+        /* The library is being unloaded; this message goes to stderr. */
+        pthread_mutex_unlock(&log_shared.mutex);
+        return NULL;
+    }
+    if (!log_key_create() || !log_flusher_start()) {
+        __atomic_store_n(&log_disabled, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&log_shared.mutex);
+        return NULL;
+    }
+    records = log_env_number("TSS2_LOG_RING_RECORDS", LOG_RING_RECORDS,
+                             LOG_RING_RECORDS_MIN, LOG_RING_RECORDS_MAX);
+    for (size = LOG_RING_RECORDS_MIN; size < records; size *= 2);
+    ring = calloc(1, sizeof(*ring) + size * sizeof(log_record));
+    if (ring == NULL) {
+        pthread_mutex_unlock(&log_shared.mutex);
+        return NULL;
+    }
+    ring->size = size;
+    ring->next = log_shared.rings;
+    log_shared.rings = ring;
+    log_thread_ring = ring;
+    pthread_setspecific(log_shared.key, ring);
+    pthread_mutex_unlock(&log_shared.mutex);
+    return ring;
+}
+
+/**
+ * Returns the ring of the calling thread, allocating it and starting the
+ * flusher on first use.
+ *
+ * @return The ring, or NULL if the ring backend is not available.
+ */
+static log_ring *
+log_ring_get(void)
+{
+    log_ring *ring;
+
+    if (unlikely(__atomic_load_n(&log_disabled, __ATOMIC_RELAXED)))
+        return NULL;
+    ring = log_thread_ring;
+    if (likely(ring != NULL))
+        return ring;
+    return log_ring_attach();
+}
+
+
+/**
+ * Reserves the next record of a ring.
+ *
+ * @return The record, or NULL if the ring is full.
+ */
+static log_record *
+log_ring_reserve(log_ring *ring, uint8_t type, log_level loglevel,
+                 const char *module, const char *file, const char *func,
+                 int line, const char *fmt)
+{
+    log_record *record;
+    struct timespec now;
+
+    if (ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+        ring->size) {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    record = &ring->records[ring->head & (ring->size - 1)];
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->timestamp = (uint64_t) now.tv_sec * 1000000000 +
+                        (uint64_t) now.tv_nsec;
+    record->module = module;
+    record->file = file;
+    record->func = func;
+    record->fmt = fmt;
+    record->line = line;
+    record->level = (uint8_t) loglevel;
+    record->type = type;
+    record->truncated = 0;
+    record->length = 0;
+    return record;
+}
+
+/**
+ * Hands the reserved record of a ring to the flusher and wakes the flusher
+ * once the ring is half full. The wakeup is lost if it comes while the
+ * flusher is about to wait; the ring is then drained after the interval.
+ */
+static void
+log_ring_commit(log_ring *ring)
+{
+    uint32_t head = ring->head + 1;
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) >= ring->size / 2 &&
+        !__atomic_load_n(&ring->wakeup, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&ring->wakeup, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&log_shared.wakeup, 1, __ATOMIC_RELAXED);
+        pthread_cond_signal(&log_shared.cond);
+    }
+}
+
+/**
+ * Writes the remaining records and stops the flusher when libtss2-mu is
+ * unloaded or the process exits. Later messages go to stderr directly. The
+ * rings of running threads are not freed, as they may still be written to.
+ */
+static void
+log_ring_shutdown(void) COMPILER_ATTR(destructor);
+
+static void
+log_ring_shutdown(void)
+{
+    __atomic_store_n(&log_disabled, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&log_shared.mutex);
+    if (log_shared.flusher_state == LOG_FLUSHER_RUNNING) {
+        log_shared.flusher_state = LOG_FLUSHER_STOPPING;
+        pthread_cond_signal(&log_shared.cond);
+        pthread_mutex_unlock(&log_shared.mutex);
+        pthread_join(log_shared.flusher, NULL);
+        pthread_mutex_lock(&log_shared.mutex);
+        log_shared.flusher_state = LOG_FLUSHER_NONE;
+    }
+    log_rings_drain();
+    if (log_shared.key_created) {
+        pthread_key_delete(log_shared.key);
+        log_shared.key_created = 0;
+    }
+    pthread_mutex_unlock(&log_shared.mutex);
+}
+
+int
+tss2_log_ring_vlog(log_level loglevel, const char *module, const char *file,
+                   const char *func, int line, const char *fmt, va_list ap)
+{
+    log_ring *ring = log_ring_get();
+    log_record *record;
+
+    if (ring == NULL)
+        return 0;
+    record = log_ring_reserve(ring, LOG_RECORD_MSG, loglevel, module, file,
+                              func, line, fmt);
+    if (record != NULL) {
+        log_encode_args(record, ap);
+        log_ring_commit(ring);
+    }
+    return 1;
+}
+
+int
+tss2_log_ring_vlog_blob(log_level loglevel, const char *module,
+                        const char *file, const char *func, int line,
+                        const uint8_t *blob, size_t size, const char *fmt,
+                        va_list ap)
+{
+    log_ring *ring = log_ring_get();
+    log_record *record;
+    size_t offset, n;
+
+    if (ring == NULL)
+        return 0;
+    record = log_ring_reserve(ring, LOG_RECORD_BLOB_MSG, loglevel, module,
+                              file, func, line, fmt);
+    if (record != NULL) {
+        record->blob = size;
+        log_encode_args(record, ap);
+        log_ring_commit(ring);
+    }
+    for (offset = 0; offset < size; offset += n) {
+        n = size - offset < LOG_RECORD_PAYLOAD ?
+            size - offset : LOG_RECORD_PAYLOAD;
+        record = log_ring_reserve(ring, LOG_RECORD_BLOB, loglevel, module,
+                                  file, func, line, NULL);
+        if (record == NULL)
+            continue;
+        record->blob = offset;
+        record->length = (uint16_t) n;
+        memcpy(&record->payload.bytes[0], &blob[offset], n);
+        log_ring_commit(ring);
+    }
+    return 1;
+}
+
+void
+tss2_log_ring_flush(void)
+{
+    pthread_mutex_lock(&log_shared.mutex);
+    log_rings_drain();
+    pthread_mutex_unlock(&log_shared.mutex);
+}
+#endif /* HAVE_PTHREAD */
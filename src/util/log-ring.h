@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ */
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_BLOB_WIDTH 16
+#define LOG_BLOB_LINE_LEN 80
+
+size_t
+log_blob_line(char *line, size_t offset, const uint8_t *data, size_t n);
+
+#ifdef HAVE_PTHREAD
+/*
+ * The ring backend of log.c. It is implemented in log-ring.c, which only
+ * libtss2-mu contains; the other libraries call these functions through the
+ * version script of libtss2-mu. They are internal to tpm2-tss and not part
+ * of its API.
+ */
+
+/**
+ * Stores a message of doLog in the ring of the calling thread.
+ *
+ * @return 1 if the message was stored or dropped, 0 if the ring backend is
+ *         not available and the message is to be written to stderr.
+ */
+int
+tss2_log_ring_vlog(log_level loglevel, const char *module, const char *file,
+                   const char *func, int line, const char *fmt, va_list ap);
+
+/**
+ * Stores a message of doLogBlob and its data in the ring of the calling
+ * thread.
+ *
+ * @return 1 if the message was stored or dropped, 0 if the ring backend is
+ *         not available and the message is to be written to stderr.
+ */
+int
+tss2_log_ring_vlog_blob(log_level loglevel, const char *module,
+                        const char *file, const char *func, int line,
+                        const uint8_t *blob, size_t size, const char *fmt,
+                        va_list ap);
+
+/** Writes the records of all rings to stderr. */
+void
+tss2_log_ring_flush(void);
+#endif /* HAVE_PTHREAD */
+
+#endif /* LOG_RING_H */
@@ -10,6 +10,7 @@
 
 #define LOGMODULE log
 #include "log.h"
+#include "log-ring.h"
 
 #if !defined(_MSC_VER) || defined(__INTEL_COMPILER)
 #define likely(x)       __builtin_expect(!!(x), 1)
@@ -74,6 +75,91 @@ case_insensitive_strncmp(const char *string1,
 static log_level
 getLogLevel(const char *module, log_level logdefault);
 
+/**
+ * Formats one line of the hex dump of doLogBlob: the offset, the bytes in hex
+ * and the bytes as ASCII, aligned to the right.
+ *
+ * @param line The buffer of LOG_BLOB_LINE_LEN bytes for the line.
+ * @param offset The offset of the data in the blob.
+ * @param data The data of the line.
+ * @param n The number of bytes of the line, at most LOG_BLOB_WIDTH.
+ * @return The length of the line including its newline.
+ */
+size_t
+log_blob_line(char *line, size_t offset, const uint8_t *data, size_t n)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t pos, i;
+
+    pos = (size_t) snprintf(line, LOG_BLOB_LINE_LEN, "%04zx: ", offset);
+    for (i = 0; i < n; i++) {
+        line[pos++] = hex[data[i] >> 4];
+        line[pos++] = hex[data[i] & 0xf];
+    }
+    line[pos++] = ' ';
+    line[pos++] = ' ';
+    while (pos < LOG_BLOB_WIDTH * 2 + 8)
+        line[pos++] = ' ';
+    for (i = 0; i < n; i++)
+        line[pos++] = isgraph(data[i]) ? (char) data[i] : '.';
+    line[pos++] = '\n';
+    return pos;
+}
+
+#ifdef HAVE_PTHREAD
+enum {
+    LOG_BACKEND_UNDEFINED = 0,
+    LOG_BACKEND_STDERR,
+    LOG_BACKEND_RING
+};
+
+/* The backend of the messages of this library; see log-ring.c. */
+static int log_backend = LOG_BACKEND_UNDEFINED;
+
+/** Returns whether TSS2_LOG_BACKEND selects the ring backend. */
+static int
+log_ring_selected(void)
+{
+    const char *env;
+    int backend;
+
+    backend = __atomic_load_n(&log_backend, __ATOMIC_RELAXED);
+    if (unlikely(backend == LOG_BACKEND_UNDEFINED)) {
+        env = getenv("TSS2_LOG_BACKEND");
+        backend = (env != NULL &&
+                   case_insensitive_strncmp(env, "ring", sizeof("ring")) == 0) ?
+                  LOG_BACKEND_RING : LOG_BACKEND_STDERR;
+        __atomic_store_n(&log_backend, backend, __ATOMIC_RELAXED);
+    }
+    return backend == LOG_BACKEND_RING;
+}
+
+/**
+ * Writes the records of the rings when the library is unloaded or the process
+ * exits, since they point to strings of the library. Later messages of the
+ * library go to stderr directly.
+ */
+static void
+log_ring_release(void) COMPILER_ATTR(destructor);
+
+static void
+log_ring_release(void)
+{
+    if (__atomic_exchange_n(&log_backend, LOG_BACKEND_STDERR,
+                            __ATOMIC_RELAXED) == LOG_BACKEND_RING)
+        tss2_log_ring_flush();
+}
+#endif /* HAVE_PTHREAD */
+
+void
+doLogFlush(void)
+{
+#ifdef HAVE_PTHREAD
+    if (log_ring_selected())
+        tss2_log_ring_flush();
+#endif
+}
+
 void
 doLogBlob(log_level loglevel, const char *module, log_level logdefault,
            log_level *status,
@@ -86,6 +172,21 @@ doLogBlob(log_level loglevel, const char *module, log_level logdefault,
         return;
 
     va_list vaargs;
+    size_t offset, n;
+
+#ifdef HAVE_PTHREAD
+    if (log_ring_selected()) {
+        int stored;
+
+        va_start(vaargs, fmt);
+        stored = tss2_log_ring_vlog_blob(loglevel, module, file, func, line,
+                                         blob, size, fmt, vaargs);
+        va_end(vaargs);
+        if (stored)
+            return;
+    }
+#endif
+
     va_start(vaargs, fmt);
     /* TODO: Unfortunately, vsnprintf(NULL, 0, ...) do not behave the same as
        snprintf(NULL, 0, ...). Until there is an alternative, messages on
@@ -99,51 +200,12 @@ doLogBlob(log_level loglevel, const char *module, log_level logdefault,
     doLog(loglevel, module, logdefault, status, file, func, line,
           "%s (size=%zi):", msg, size);
 
-    unsigned int i, y, x, off, off2;
-    unsigned int width = 16;
-#define LINE_LEN 64
-    char buffer[LINE_LEN];
+    char buffer[LOG_BLOB_LINE_LEN];
 
-    for (i = 1, off = 0, off2 = 0; i <= size; i++) {
-        if (i == 1) {
-            sprintf(&buffer[off], "%04x: ", i - 1);
-            off += 6;
-        }
-
-        /* data output */
-        sprintf(&buffer[off], "%02x", blob[i-1]);
-        off += 2;
-
-        /* ASCII output */
-        if ((i % width == 0 && i > 1) || i == size) {
-            sprintf(&buffer[off], "  ");
-            off += 2;
-            /* Align to the right */
-            for (x = off; x < width * 2 + 8; x++) {
-                sprintf(&buffer[off], " ");
-                off++;
-            }
-
-            /* Account for a line that is not 'full' */
-            unsigned int less = width - (i % width);
-            if (less == width)
-                less = 0;
-
-            for (y = 0; y < width - less; y++) {
-                if (isgraph(blob[off2 + y])) {
-                    sprintf(&buffer[y + off], "%c", blob[off2 + y]);
-                } else {
-                    sprintf(&buffer[y + off], "%c", '.');
-                }
-            }
-            /* print the line and restart */
-            fprintf (stderr, "%s\n", buffer);
-            off2 = i;
-            off = 0;
-            memset(buffer, '\0', LINE_LEN);
-            sprintf(&buffer[off], "%04x: ", i);
-            off += 6;
-        }
+    for (offset = 0; offset < size; offset += n) {
+        n = size - offset < LOG_BLOB_WIDTH ? size - offset : LOG_BLOB_WIDTH;
+        fwrite(buffer, 1, log_blob_line(buffer, offset, &blob[offset], n),
+               stderr);
     }
 }
 
@@ -159,6 +221,20 @@ doLog(log_level loglevel, const char *module, log_level logdefault,
     if (loglevel > *status)
         return;
 
+#ifdef HAVE_PTHREAD
+    if (log_ring_selected()) {
+        va_list vaargs;
+        int stored;
+
+        va_start(vaargs, msg);
+        stored = tss2_log_ring_vlog(loglevel, module, file, func, line, msg,
+                                    vaargs);
+        va_end(vaargs);
+        if (stored)
+            return;
+    }
+#endif
+
     int size = snprintf(NULL, 0, "%s:%s:%s:%d:%s() %s \n",
                 log_strings[loglevel], module, file, line, func, msg);
     char fmt[size+1];
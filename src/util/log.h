@@ -165,4 +165,7 @@ doLogBlob(log_level loglevel, const char *module, log_level logdefault,
           const uint8_t *buffer, size_t size, const char *msg, ...)
     COMPILER_ATTR(unused, format (printf, 10, 11));
 
+void
+doLogFlush(void);
+
 #endif /* LOG_H */
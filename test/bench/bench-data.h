@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef BENCH_DATA_H
+#define BENCH_DATA_H
+
+#include "tss2_tpm2_types.h"
+
+/* Typical structures of TPM commands, sized like the real ones. */
+
+static const TPM2B_PUBLIC bench_rsa_public = {
+    .size = 0,
+    .publicArea = {
+        .type = TPM2_ALG_RSA,
+        .nameAlg = TPM2_ALG_SHA256,
+        .objectAttributes = TPMA_OBJECT_USERWITHAUTH | TPMA_OBJECT_SIGN_ENCRYPT |
+                            TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT |
+                            TPMA_OBJECT_SENSITIVEDATAORIGIN,
+        .authPolicy = { .size = 0 },
+        .parameters.rsaDetail = {
+            .symmetric = { .algorithm = TPM2_ALG_NULL },
+            .scheme = { .scheme = TPM2_ALG_RSASSA,
+                        .details.rsassa.hashAlg = TPM2_ALG_SHA256 },
+            .keyBits = 2048,
+            .exponent = 0,
+        },
+        .unique.rsa = { .size = 256 },
+    },
+};
+
+static const TPM2B_PUBLIC bench_ecc_public = {
+    .size = 0,
+    .publicArea = {
+        .type = TPM2_ALG_ECC,
+        .nameAlg = TPM2_ALG_SHA256,
+        .objectAttributes = TPMA_OBJECT_USERWITHAUTH | TPMA_OBJECT_SIGN_ENCRYPT |
+                            TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT |
+                            TPMA_OBJECT_SENSITIVEDATAORIGIN,
+        .authPolicy = { .size = 32 },
+        .parameters.eccDetail = {
+            .symmetric = { .algorithm = TPM2_ALG_NULL },
+            .scheme = { .scheme = TPM2_ALG_ECDSA,
+                        .details.ecdsa.hashAlg = TPM2_ALG_SHA256 },
+            .curveID = TPM2_ECC_NIST_P256,
+            .kdf = { .scheme = TPM2_ALG_NULL },
+        },
+        .unique.ecc = { .x = { .size = 32 }, .y = { .size = 32 } },
+    },
+};
+
+static const TPM2B_SENSITIVE_CREATE bench_sensitive_create = {
+    .size = 0,
+    .sensitive = { .userAuth = { .size = 16 }, .data = { .size = 0 } },
+};
+
+static const TPMT_SIGNATURE bench_rsa_signature = {
+    .sigAlg = TPM2_ALG_RSASSA,
+    .signature.rsassa = { .hash = TPM2_ALG_SHA256, .sig = { .size = 256 } },
+};
+
+static const TPMT_SIGNATURE bench_ecc_signature = {
+    .sigAlg = TPM2_ALG_ECDSA,
+    .signature.ecdsa = { .hash = TPM2_ALG_SHA256,
+                         .signatureR = { .size = 32 },
+                         .signatureS = { .size = 32 } },
+};
+
+static const TPML_PCR_SELECTION bench_pcr_selection = {
+    .count = 2,
+    .pcrSelections = {
+        { .hash = TPM2_ALG_SHA1, .sizeofSelect = 3,
+          .pcrSelect = { 0xff, 0xff, 0xff } },
+        { .hash = TPM2_ALG_SHA256, .sizeofSelect = 3,
+          .pcrSelect = { 0xff, 0xff, 0xff } },
+    },
+};
+
+static const TPML_DIGEST bench_pcr_values = {
+    .count = 8,
+    .digests = {
+        { .size = 32 }, { .size = 32 }, { .size = 32 }, { .size = 32 },
+        { .size = 32 }, { .size = 32 }, { .size = 32 }, { .size = 32 },
+    },
+};
+
+static const TPMS_ATTEST bench_quote = {
+    .magic = TPM2_GENERATED_VALUE,
+    .type = TPM2_ST_ATTEST_QUOTE,
+    .qualifiedSigner = { .size = 34 },
+    .extraData = { .size = 32 },
+    .clockInfo = { .clock = 123456, .resetCount = 1, .restartCount = 2,
+                   .safe = 1 },
+    .firmwareVersion = 0x2000000000000ULL,
+    .attested.quote = {
+        .pcrSelect = {
+            .count = 1,
+            .pcrSelections = {
+                { .hash = TPM2_ALG_SHA256, .sizeofSelect = 3,
+                  .pcrSelect = { 0xff, 0xff, 0xff } },
+            },
+        },
+        .pcrDigest = { .size = 32 },
+    },
+};
+
+static const TPM2B_NV_PUBLIC bench_nv_public = {
+    .size = 0,
+    .nvPublic = {
+        .nvIndex = 0x01000000,
+        .nameAlg = TPM2_ALG_SHA256,
+        .attributes = TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD | TPMA_NV_WRITTEN,
+        .authPolicy = { .size = 0 },
+        .dataSize = 1024,
+    },
+};
+
+static const TPM2B_CREATION_DATA bench_creation_data = {
+    .size = 0,
+    .creationData = {
+        .pcrSelect = { .count = 0 },
+        .pcrDigest = { .size = 32 },
+        .locality = TPMA_LOCALITY_TPM2_LOC_ZERO,
+        .parentNameAlg = TPM2_ALG_SHA256,
+        .parentName = { .size = 34 },
+        .parentQualifiedName = { .size = 34 },
+        .outsideInfo = { .size = 0 },
+    },
+};
+
+static const TPMS_CONTEXT bench_context = {
+    .sequence = 42,
+    .savedHandle = 0x80000000,
+    .hierarchy = TPM2_RH_OWNER,
+    .contextBlob = { .size = 1024 },
+};
+
+#endif /* BENCH_DATA_H */
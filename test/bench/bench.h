@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Monotonic time in nanoseconds. */
+static inline uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Time spent during a run in helpers that are not part of the measured code,
+ * e.g. the in-process TCTI computing responses; BENCH_RUN subtracts it.
+ * Benchmarks that time themselves do not use it.
+ */
+#if defined(__GNUC__)
+static uint64_t bench_excluded_ns __attribute__((unused));
+#else
+static uint64_t bench_excluded_ns;
+#endif
+
+/*
+ * Print the mean time per iteration of a benchmark. If BENCH_JSON is set,
+ * print a JSON object with its value as "suite" instead of a line of text;
+ * 'make bench-json' collects them into bench.json.
+ */
+static inline void
+bench_report(const char *name, size_t iterations, uint64_t ns)
+{
+    const char *suite = getenv("BENCH_JSON");
+
+    if (suite != NULL)
+        printf("{\"suite\": \"%s\", \"name\": \"%s\", \"iterations\": %zu, "
+               "\"ns_per_op\": %.1f}\n", suite, name, iterations,
+               (double)ns / iterations);
+    else
+        printf("%-40s %10zu iterations %12.1f ns/op\n", name, iterations,
+               (double)ns / iterations);
+}
+
+/*
+ * Run 'body' 'iterations' times and print the mean time per iteration,
+ * without the time added to bench_excluded_ns meanwhile. 'body' is a
+ * statement; a non-zero 'rc' variable in scope aborts the run.
+ */
+#define BENCH_RUN(name, iterations, body) \
+    do { \
+        uint64_t bench_start_, bench_ns_; \
+        size_t bench_i_; \
+        bench_excluded_ns = 0; \
+        bench_start_ = bench_now_ns(); \
+        for (bench_i_ = 0; bench_i_ < (iterations); bench_i_++) { \
+            body; \
+            if (rc != 0) { \
+                fprintf(stderr, "%s failed: 0x%" PRIx32 "\n", name, rc); \
+                return 1; \
+            } \
+        } \
+        bench_ns_ = bench_now_ns() - bench_start_ - bench_excluded_ns; \
+        bench_report(name, (size_t)(iterations), bench_ns_); \
+    } while (0)
+
+#endif /* BENCH_H */
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for the rate at which ESYS contexts can be created and
+ * finalized on an existing TCTI.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include "tss2_esys.h"
+
+#include "bench.h"
+#include "tcti-canned.h"
+
+#define ITERATIONS 100000
+
+int
+main(int argc, char *argv[])
+{
+    TSS2_TCTI_CONTEXT *tcti = tcti_canned_init(NULL);
+    ESYS_CONTEXT *ectx;
+    size_t size = Esys_GetContextSize();
+    void *storage;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    (void)argc;
+    (void)argv;
+
+    storage = malloc(size);
+    if (storage == NULL)
+        return EXIT_FAILURE;
+
+    BENCH_RUN("Esys_Initialize/Esys_Finalize", ITERATIONS,
+              rc = Esys_Initialize(&ectx, tcti, NULL);
+              if (rc == TSS2_RC_SUCCESS)
+                  Esys_Finalize(&ectx));
+
+    BENCH_RUN("Esys_InitializeEx/Esys_Finalize", ITERATIONS,
+              rc = Esys_InitializeEx(&ectx, storage, size, tcti, NULL);
+              if (rc == TSS2_RC_SUCCESS)
+                  Esys_Finalize(&ectx));
+
+    free(storage);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for iesys_crypto_hash_batch(): batches of 1, 8 and 24 messages
+ * of 64 bytes, the size of a SHA-256 PCR extend, hashed at once and one
+ * after the other with the crypto backend.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+#include "esys_crypto.h"
+
+#include "bench.h"
+
+#define ITERATIONS 20000
+#define MAX_JOBS 24
+#define MESSAGE_SIZE 64
+
+static uint8_t messages[MAX_JOBS][MESSAGE_SIZE];
+static uint8_t digests[MAX_JOBS][TPM2_SHA256_DIGEST_SIZE];
+
+static TSS2_RC
+hash_sequential(IESYS_CRYPTO_MB_JOB *jobs, size_t n_jobs)
+{
+    IESYS_CRYPTO_CONTEXT_BLOB *context;
+    size_t i, size;
+    TSS2_RC rc;
+
+    for (i = 0; i < n_jobs; i++) {
+        rc = iesys_crypto_hash_start(&context, TPM2_ALG_SHA256);
+        if (rc != TSS2_RC_SUCCESS)
+            return rc;
+        rc = iesys_crypto_hash_update(context, jobs[i].buffer, jobs[i].size);
+        if (rc != TSS2_RC_SUCCESS) {
+            iesys_crypto_hash_abort(&context);
+            return rc;
+        }
+        size = TPM2_SHA256_DIGEST_SIZE;
+        rc = iesys_crypto_hash_finish(&context, jobs[i].digest, &size);
+        if (rc != TSS2_RC_SUCCESS)
+            return rc;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const size_t batches[] = { 1, 8, MAX_JOBS };
+    IESYS_CRYPTO_MB_JOB jobs[MAX_JOBS];
+    char name[64];
+    size_t b, i;
+    TSS2_RC rc;
+
+    (void)argc;
+    (void)argv;
+
+    rc = iesys_initialize_crypto();
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+
+    for (i = 0; i < MAX_JOBS; i++) {
+        memset(&messages[i][0], (int) i, MESSAGE_SIZE);
+        jobs[i].buffer = &messages[i][0];
+        jobs[i].size = MESSAGE_SIZE;
+        jobs[i].digest = &digests[i][0];
+    }
+
+    printf("# multi-buffer SHA-256 %s\n",
+           iesys_crypto_mb_supported(TPM2_ALG_SHA256) ? "available" : "not available");
+    for (b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        snprintf(name, sizeof(name), "batch of %zu", batches[b]);
+        BENCH_RUN(name, ITERATIONS,
+                  rc = iesys_crypto_hash_batch(TPM2_ALG_SHA256, &jobs[0],
+                                               batches[b]));
+        snprintf(name, sizeof(name), "sequential %zu", batches[b]);
+        BENCH_RUN(name, ITERATIONS,
+                  rc = hash_sequential(&jobs[0], batches[b]));
+    }
+    return EXIT_SUCCESS;
+}
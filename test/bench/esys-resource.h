@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef ESYS_RESOURCE_H
+#define ESYS_RESOURCE_H
+
+#include "tss2_esys.h"
+#include "esys_mu.h"
+
+/* Create an ESYS_TR from a resource without talking to the TPM. */
+static inline TSS2_RC
+load_resource(ESYS_CONTEXT *ectx, IESYS_RESOURCE *rsrc, ESYS_TR *object)
+{
+    uint8_t buffer[sizeof(IESYS_RESOURCE) + 64];
+    size_t offset = 0;
+    TSS2_RC rc;
+
+    rc = iesys_MU_IESYS_RESOURCE_Marshal(rsrc, &buffer[0], sizeof(buffer),
+                                         &offset);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    return Esys_TR_Deserialize(ectx, &buffer[0], offset, object);
+}
+
+#endif /* ESYS_RESOURCE_H */
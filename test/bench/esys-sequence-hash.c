@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for hashing a 1 MiB file in the TPM: a loop of synchronous
+ * Esys_SequenceUpdate() calls versus Esys_SequenceHashFd(), which reads the
+ * next chunk while the TPM processes the previous one. This needs a TPM or
+ * simulator, selected like in the integration tests with TPM20TEST_TCTI
+ * (default: the TCTI loader's default); without one it is skipped.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tss2_esys.h"
+#include "tss2_tctildr.h"
+
+#include "bench.h"
+
+#define ITERATIONS 5
+#define FILE_SIZE (1024 * 1024)
+
+static TSS2_RC
+hash_loop(ESYS_CONTEXT *ectx, int fd)
+{
+    TPM2B_AUTH auth = { .size = 0 };
+    TPM2B_MAX_BUFFER buffer;
+    TPM2B_DIGEST *result = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL;
+    ESYS_TR sequence;
+    ssize_t n;
+    TSS2_RC rc;
+
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        return TSS2_ESYS_RC_IO_ERROR;
+    rc = Esys_HashSequenceStart(ectx, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                &auth, TPM2_ALG_SHA256, &sequence);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    while ((n = read(fd, &buffer.buffer[0], sizeof(buffer.buffer))) > 0) {
+        buffer.size = (UINT16) n;
+        rc = Esys_SequenceUpdate(ectx, sequence, ESYS_TR_PASSWORD,
+                                 ESYS_TR_NONE, ESYS_TR_NONE, &buffer);
+        if (rc != TSS2_RC_SUCCESS)
+            return rc;
+    }
+    buffer.size = 0;
+    rc = Esys_SequenceComplete(ectx, sequence, ESYS_TR_PASSWORD,
+                               ESYS_TR_NONE, ESYS_TR_NONE, &buffer,
+                               ESYS_TR_RH_OWNER, &result, &validation);
+    Esys_Free(result);
+    Esys_Free(validation);
+    return rc;
+}
+
+static TSS2_RC
+hash_helper(ESYS_CONTEXT *ectx, int fd)
+{
+    TPM2B_DIGEST *result = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL;
+    TSS2_RC rc;
+
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        return TSS2_ESYS_RC_IO_ERROR;
+    rc = Esys_SequenceHashFd(ectx, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                             TPM2_ALG_SHA256, ESYS_TR_RH_OWNER, fd,
+                             &result, &validation);
+    Esys_Free(result);
+    Esys_Free(validation);
+    return rc;
+}
+
+static int
+bench_sequence_hash(ESYS_CONTEXT *ectx)
+{
+    char path[] = "/tmp/esys-sequence-hash-XXXXXX";
+    static uint8_t data[FILE_SIZE];
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    int fd, ret = 1;
+    size_t i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t) i;
+    fd = mkstemp(path);
+    if (fd < 0)
+        return 1;
+    unlink(path);
+    if (write(fd, &data[0], sizeof(data)) != sizeof(data))
+        goto out;
+
+    BENCH_RUN("SHA256 of 1 MiB, Esys_SequenceUpdate loop", ITERATIONS,
+              rc = hash_loop(ectx, fd));
+    BENCH_RUN("SHA256 of 1 MiB, Esys_SequenceHashFd", ITERATIONS,
+              rc = hash_helper(ectx, fd));
+    ret = 0;
+out:
+    close(fd);
+    return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx;
+    TSS2_RC rc;
+    int ret;
+
+    (void)argc;
+    (void)argv;
+
+    rc = Tss2_TctiLdr_Initialize(getenv("TPM20TEST_TCTI"), &tcti);
+    if (rc != TSS2_RC_SUCCESS) {
+        printf("No TPM available, skipped\n");
+        return EXIT_SUCCESS;
+    }
+    rc = Esys_Initialize(&ectx, tcti, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        Tss2_TctiLdr_Finalize(&tcti);
+        return EXIT_FAILURE;
+    }
+    rc = Esys_Startup(ectx, TPM2_SU_CLEAR);
+    if (rc != TSS2_RC_SUCCESS && rc != TPM2_RC_INITIALIZE) {
+        printf("No TPM available, skipped\n");
+        ret = 0;
+    } else {
+        ret = bench_sequence_hash(ectx);
+    }
+    Esys_Finalize(&ectx);
+    Tss2_TctiLdr_Finalize(&tcti);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
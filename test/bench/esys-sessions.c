@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for the client side cost of ESYS sessions: Esys_NV_Write() and
+ * Esys_NV_Read() of 1024 bytes with a password session and with one to three
+ * HMAC sessions, with and without parameter encryption. The in-process TCTI
+ * answers like a TPM would, including valid response HMACs, so that the whole
+ * path (cpHash, command HMACs, encryption, rpHash, response HMAC checks and
+ * decryption) is measured. The time the TCTI spends computing the responses
+ * is not included.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+#include "esys_crypto.h"
+
+#include "bench.h"
+#include "esys-resource.h"
+#include "tcti-canned.h"
+
+#define ITERATIONS 5000
+#define DATA_SIZE 1024
+#define NV_INDEX 0x01000000
+
+static const TPM2B_AUTH nv_auth = { .size = 8, .buffer = "password" };
+static const TPM2B_DIGEST session_key = { .size = 32, .buffer = "session" };
+static const TPM2B_NONCE nonce_tpm = { .size = 32, .buffer = { 0x54, 0x50 } };
+
+/*
+ * Answer an NV_Write or NV_Read command as the TPM does: the response
+ * parameters (random data for NV_Read) and, for each session, nonceTPM and
+ * the response HMAC. The HMAC key is the session key, followed by the auth
+ * value of the NV index for the first session, which authorizes it.
+ */
+static size_t
+respond_nv(const uint8_t *command, size_t command_size, uint8_t *response,
+           size_t response_size)
+{
+    TPM2_CC cc;
+    UINT32 auth_size;
+    TPMS_AUTH_COMMAND auth;
+    TPM2B_NONCE callers[3];
+    TPMA_SESSION attributes[3];
+    TPM2_HANDLE handles[3];
+    uint8_t cc_buffer[4], rc_buffer[4] = { 0 };
+    uint8_t rp_hash[TPM2_SHA256_DIGEST_SIZE];
+    size_t rp_hash_size = sizeof(rp_hash);
+    size_t offset = 6, auth_end, rp_start, size;
+    TPM2B_MAX_NV_BUFFER data = { .size = DATA_SIZE };
+    uint8_t key[sizeof(session_key.buffer) + sizeof(nv_auth.buffer)];
+    TPM2B_AUTH hmac;
+    int i, count = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2_CC_Unmarshal(command, command_size, &offset, &cc);
+    if (rc != TSS2_RC_SUCCESS)
+        return 0;
+    memcpy(&cc_buffer[0], &command[6], sizeof(cc_buffer));
+
+    /* Both commands have the handles authHandle and nvIndex. */
+    offset += 2 * sizeof(TPM2_HANDLE);
+    rc = Tss2_MU_UINT32_Unmarshal(command, command_size, &offset, &auth_size);
+    if (rc != TSS2_RC_SUCCESS || auth_size > command_size - offset)
+        return 0;
+    auth_end = offset + auth_size;
+    while (offset < auth_end && count < 3) {
+        rc = Tss2_MU_TPMS_AUTH_COMMAND_Unmarshal(command, auth_end, &offset,
+                                                 &auth);
+        if (rc != TSS2_RC_SUCCESS)
+            return 0;
+        handles[count] = auth.sessionHandle;
+        callers[count] = auth.nonce;
+        attributes[count] = auth.sessionAttributes;
+        count++;
+    }
+
+    /* Header, parameterSize and parameters */
+    offset = 14;
+    rp_start = offset;
+    if (cc == TPM2_CC_NV_Read) {
+        rc = Tss2_MU_TPM2B_MAX_NV_BUFFER_Marshal(&data, response,
+                                                 response_size, &offset);
+        if (rc != TSS2_RC_SUCCESS)
+            return 0;
+    }
+    size = offset - rp_start;
+    rc = Tss2_MU_UINT32_Marshal((UINT32) size, response, response_size,
+                                &(size_t){ 10 });
+    if (rc != TSS2_RC_SUCCESS)
+        return 0;
+    rc = iesys_crypto_rpHash(TPM2_ALG_SHA256, rc_buffer, cc_buffer,
+                             &response[rp_start], size, &rp_hash[0],
+                             &rp_hash_size);
+    if (rc != TSS2_RC_SUCCESS)
+        return 0;
+
+    for (i = 0; i < count; i++) {
+        TPMS_AUTH_RESPONSE rsp = { .sessionAttributes = attributes[i] };
+
+        if (handles[i] != TPM2_RS_PW) {
+            memcpy(&key[0], &session_key.buffer[0], session_key.size);
+            memcpy(&key[session_key.size], &nv_auth.buffer[0], nv_auth.size);
+            hmac.size = sizeof(hmac.buffer);
+            rc = iesys_crypto_authHmac(TPM2_ALG_SHA256, &key[0],
+                                       session_key.size +
+                                       (i == 0 ? nv_auth.size : 0),
+                                       &rp_hash[0], rp_hash_size, &nonce_tpm,
+                                       &callers[i], NULL, NULL,
+                                       attributes[i], &hmac);
+            if (rc != TSS2_RC_SUCCESS)
+                return 0;
+            rsp.nonce = nonce_tpm;
+            rsp.hmac = hmac;
+        }
+        rc = Tss2_MU_TPMS_AUTH_RESPONSE_Marshal(&rsp, response, response_size,
+                                                &offset);
+        if (rc != TSS2_RC_SUCCESS)
+            return 0;
+    }
+
+    size = 0;
+    rc = Tss2_MU_TPM2_ST_Marshal(TPM2_ST_SESSIONS, response, response_size,
+                                 &size);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Tss2_MU_UINT32_Marshal((UINT32) offset, response, response_size,
+                                    &size);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, response, response_size,
+                                    &size);
+    return rc == TSS2_RC_SUCCESS ? offset : 0;
+}
+
+/* Write and read the NV index with the given sessions. */
+static int
+bench_sessions(ESYS_CONTEXT *ectx, const char *label, ESYS_TR nv,
+               ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3)
+{
+    TPM2B_MAX_NV_BUFFER data = { .size = DATA_SIZE };
+    TPM2B_MAX_NV_BUFFER *out;
+    char name[64];
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    snprintf(name, sizeof(name), "Esys_NV_Write 1024B, %s", label);
+    BENCH_RUN(name, ITERATIONS,
+              rc = Esys_NV_Write(ectx, nv, nv, shandle1, shandle2, shandle3,
+                                 &data, 0));
+
+    snprintf(name, sizeof(name), "Esys_NV_Read 1024B, %s", label);
+    BENCH_RUN(name, ITERATIONS,
+              rc = Esys_NV_Read(ectx, nv, nv, shandle1, shandle2, shandle3,
+                                DATA_SIZE, 0, &out);
+              Esys_Free(out));
+    return 0;
+}
+
+static int
+bench_esys(ESYS_CONTEXT *ectx)
+{
+    IESYS_RESOURCE session_rsrc = {
+        .name = { .size = 4 },
+        .rsrcType = IESYSC_SESSION_RSRC,
+        .misc.rsrc_session = {
+            .symmetric = {
+                .algorithm = TPM2_ALG_AES,
+                .keyBits = { .aes = 128 },
+                .mode = { .aes = TPM2_ALG_CFB }
+            },
+            .authHash = TPM2_ALG_SHA256,
+            .sessionType = TPM2_SE_HMAC,
+            .sessionAttributes = TPMA_SESSION_CONTINUESESSION,
+            .nonceCaller = { .size = 32 },
+            .nonceTPM = { .size = 32 },
+            .sessionKey = session_key,
+        },
+    };
+    IESYS_RESOURCE nv_rsrc = {
+        .handle = NV_INDEX,
+        .name = { .size = 34, .name = { 0x00, 0x0b } },
+        .rsrcType = IESYSC_NV_RSRC,
+        .misc.rsrc_nv_pub = {
+            .size = 0,
+            .nvPublic = {
+                .nvIndex = NV_INDEX,
+                .nameAlg = TPM2_ALG_SHA256,
+                .attributes = TPMA_NV_AUTHWRITE | TPMA_NV_AUTHREAD |
+                              TPMA_NV_WRITTEN,
+                .dataSize = DATA_SIZE,
+            }
+        },
+    };
+    ESYS_TR sessions[3], nv;
+    TSS2_RC rc;
+    int i;
+
+    rc = load_resource(ectx, &nv_rsrc, &nv);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Esys_TR_SetAuth(ectx, nv, &nv_auth);
+    for (i = 0; i < 3 && rc == TSS2_RC_SUCCESS; i++) {
+        session_rsrc.handle = TPM2_HMAC_SESSION_FIRST + (TPM2_HANDLE) i;
+        session_rsrc.name.name[0] = 0x02;
+        session_rsrc.name.name[3] = (BYTE) i;
+        rc = load_resource(ectx, &session_rsrc, &sessions[i]);
+    }
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Setting up the objects failed: 0x%" PRIx32 "\n", rc);
+        return 1;
+    }
+
+    if (bench_sessions(ectx, "password", nv, ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                       ESYS_TR_NONE) != 0 ||
+        bench_sessions(ectx, "1 HMAC", nv, sessions[0], ESYS_TR_NONE,
+                       ESYS_TR_NONE) != 0 ||
+        bench_sessions(ectx, "2 HMAC", nv, sessions[0], sessions[1],
+                       ESYS_TR_NONE) != 0 ||
+        bench_sessions(ectx, "3 HMAC", nv, sessions[0], sessions[1],
+                       sessions[2]) != 0)
+        return 1;
+
+    /* Encrypt the data of NV_Write and of the NV_Read response. */
+    rc = Esys_TRSess_SetAttributes(ectx, sessions[0],
+                                   TPMA_SESSION_DECRYPT | TPMA_SESSION_ENCRYPT,
+                                   TPMA_SESSION_DECRYPT | TPMA_SESSION_ENCRYPT);
+    if (rc != TSS2_RC_SUCCESS)
+        return 1;
+
+    if (bench_sessions(ectx, "1 HMAC, encrypted", nv, sessions[0],
+                       ESYS_TR_NONE, ESYS_TR_NONE) != 0 ||
+        bench_sessions(ectx, "3 HMAC, encrypted", nv, sessions[0],
+                       sessions[1], sessions[2]) != 0)
+        return 1;
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx;
+    TSS2_RC rc;
+    int ret;
+
+    (void)argc;
+    (void)argv;
+
+    rc = iesys_initialize_crypto();
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+
+    tcti = tcti_canned_init(respond_nv);
+    rc = Esys_Initialize(&ectx, tcti, NULL);
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+    ret = bench_esys(ectx);
+    Esys_Finalize(&ectx);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,390 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+/*
+ * End-to-end benchmark of FAPI against the TPM given by TPM20TEST_TCTI,
+ * usually a simulator. A keystore is provisioned in a temporary directory
+ * and the common operations are run in loops: key creation, signing, a
+ * quote over a PCR with a large event log and its verification, NV writes
+ * and reads, listing the keystore and signing with a policy-authorized key.
+ *
+ * Besides the mean time per operation, the time spent in each phase (file
+ * I/O, JSON, binary objects, crypto and waiting for the TPM) is reported from
+ * the timing
+ * hooks of FAPI. File I/O runs on worker threads and may overlap with the
+ * other phases; "other" is the remainder of the mean time.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "tss2_esys.h"
+#include "tss2_fapi.h"
+#include "tss2_tctildr.h"
+#include "ifapi_timing.h"
+
+#include "bench.h"
+
+#define PROFILE "P_ECC"
+#define N_EVENTS 500
+#define EVENT_PCR 16
+#define NV_SIZE 1024
+#define POLICY_AUTH "benchmark"
+
+static const uint8_t digest[32] = { 0x01, 0x02, 0x03, 0x04 };
+static const uint8_t qualifying_data[20] = { 0x67, 0x68, 0x03, 0x3e };
+static uint8_t nv_data[NV_SIZE];
+
+static char *quote_info;
+static uint8_t *quote_signature;
+static size_t quote_signature_size;
+static char *quote_log;
+
+/* Provide the auth value of the policy-authorized key. */
+static TSS2_RC
+auth_callback(char const *objectPath, char const *description,
+              char const **auth, void *userData)
+{
+    (void)objectPath;
+    (void)description;
+    (void)userData;
+
+    *auth = POLICY_AUTH;
+    return TSS2_RC_SUCCESS;
+}
+
+/* Reset the PCR of the event log, which survives earlier runs in the TPM. */
+static TSS2_RC
+pcr_reset(FAPI_CONTEXT *context, UINT32 pcr)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *esys;
+    TSS2_RC rc;
+
+    rc = Fapi_GetTcti(context, &tcti);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    rc = Esys_Initialize(&esys, tcti, NULL);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    rc = Esys_PCR_Reset(esys, pcr, ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                        ESYS_TR_NONE);
+    Esys_Finalize(&esys);
+    return rc;
+}
+
+static char *
+read_file(const char *path)
+{
+    char *buffer = NULL;
+    long size;
+    FILE *file;
+
+    file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+        fseek(file, 0, SEEK_SET) == 0) {
+        buffer = calloc(1, size + 1);
+        if (buffer != NULL && fread(buffer, 1, size, file) != (size_t) size) {
+            free(buffer);
+            buffer = NULL;
+        }
+    }
+    fclose(file);
+    return buffer;
+}
+
+static TSS2_RC
+op_create_key(FAPI_CONTEXT *context, size_t i)
+{
+    char path[64];
+
+    snprintf(path, sizeof(path), "HS/SRK/bench%zu", i);
+    return Fapi_CreateKey(context, path, "sign,noDa", "", NULL);
+}
+
+static TSS2_RC
+op_sign(FAPI_CONTEXT *context, size_t i)
+{
+    uint8_t *signature;
+    size_t signature_size;
+    TSS2_RC rc;
+
+    (void)i;
+    rc = Fapi_Sign(context, "HS/SRK/benchSign", NULL, &digest[0],
+                   sizeof(digest), &signature, &signature_size, NULL, NULL);
+    Fapi_Free(signature);
+    return rc;
+}
+
+static TSS2_RC
+op_sign_policy(FAPI_CONTEXT *context, size_t i)
+{
+    uint8_t *signature;
+    size_t signature_size;
+    TSS2_RC rc;
+
+    (void)i;
+    rc = Fapi_Sign(context, "HS/SRK/benchPolicy", NULL, &digest[0],
+                   sizeof(digest), &signature, &signature_size, NULL, NULL);
+    Fapi_Free(signature);
+    return rc;
+}
+
+static TSS2_RC
+op_pcr_extend(FAPI_CONTEXT *context, size_t i)
+{
+    uint8_t data[16];
+
+    memset(&data[0], (int) (i & 0xff), sizeof(data));
+    return Fapi_PcrExtend(context, EVENT_PCR, &data[0], sizeof(data),
+                          "{ \"test\": \"benchmark\" }");
+}
+
+static TSS2_RC
+op_quote(FAPI_CONTEXT *context, size_t i)
+{
+    uint32_t pcrs[] = { EVENT_PCR };
+
+    (void)i;
+    Fapi_Free(quote_info);
+    Fapi_Free(quote_signature);
+    Fapi_Free(quote_log);
+    return Fapi_Quote(context, &pcrs[0], 1, "HS/SRK/benchSign", "TPM-Quote",
+                      &qualifying_data[0], sizeof(qualifying_data),
+                      &quote_info, &quote_signature, &quote_signature_size,
+                      &quote_log, NULL);
+}
+
+static TSS2_RC
+op_verify_quote(FAPI_CONTEXT *context, size_t i)
+{
+    (void)i;
+    return Fapi_VerifyQuote(context, "HS/SRK/benchSign",
+                            &qualifying_data[0], sizeof(qualifying_data),
+                            quote_info, quote_signature, quote_signature_size,
+                            quote_log);
+}
+
+static TSS2_RC
+op_nv_write(FAPI_CONTEXT *context, size_t i)
+{
+    nv_data[0] = (uint8_t) i;
+    return Fapi_NvWrite(context, "/nv/Owner/bench", &nv_data[0],
+                        sizeof(nv_data));
+}
+
+static TSS2_RC
+op_nv_read(FAPI_CONTEXT *context, size_t i)
+{
+    uint8_t *data;
+    size_t size;
+    TSS2_RC rc;
+
+    (void)i;
+    rc = Fapi_NvRead(context, "/nv/Owner/bench", &data, &size, NULL);
+    Fapi_Free(data);
+    return rc;
+}
+
+static TSS2_RC
+op_list(FAPI_CONTEXT *context, size_t i)
+{
+    char *list;
+    TSS2_RC rc;
+
+    (void)i;
+    rc = Fapi_List(context, "/", &list);
+    Fapi_Free(list);
+    return rc;
+}
+
+/* Run an operation and report its mean time and the time of each phase. */
+static int
+bench_op(FAPI_CONTEXT *context, const char *name, size_t iterations,
+         TSS2_RC (*op)(FAPI_CONTEXT *context, size_t i))
+{
+    IFAPI_TIMING timing;
+    uint64_t start, ns, phases = 0;
+    char label[64];
+    size_t i;
+    int phase;
+    TSS2_RC rc;
+
+    ifapi_timing_reset();
+    start = bench_now_ns();
+    for (i = 0; i < iterations; i++) {
+        rc = op(context, i);
+        if (rc != TSS2_RC_SUCCESS) {
+            fprintf(stderr, "%s failed: 0x%" PRIx32 "\n", name, rc);
+            return 1;
+        }
+    }
+    ns = bench_now_ns() - start;
+    ifapi_timing_get(&timing);
+
+    bench_report(name, iterations, ns);
+    for (phase = 0; phase < IFAPI_TIMING_MAX; phase++) {
+        snprintf(label, sizeof(label), "%s: %s", name,
+                 ifapi_timing_phase_name(phase));
+        bench_report(label, iterations, timing.ns[phase]);
+        phases += timing.ns[phase];
+    }
+    snprintf(label, sizeof(label), "%s: other", name);
+    bench_report(label, iterations, phases < ns ? ns - phases : 0);
+    return 0;
+}
+
+static int
+bench_fapi(FAPI_CONTEXT *context)
+{
+    char *policy;
+    TSS2_RC rc;
+
+    rc = Fapi_Provision(context, NULL, NULL, NULL);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Fapi_CreateKey(context, "HS/SRK/benchSign", "sign,noDa", "",
+                            NULL);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = pcr_reset(context, EVENT_PCR);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Fapi_CreateNv(context, "/nv/Owner/bench", "noda", NV_SIZE, "",
+                           "");
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Fapi_SetAuthCB(context, auth_callback, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Setting up the keystore failed: 0x%" PRIx32 "\n", rc);
+        return 1;
+    }
+
+    policy = read_file(TOP_SOURCEDIR "/test/data/fapi/policy/pol_password.json");
+    if (policy == NULL) {
+        fprintf(stderr, "Reading the policy failed\n");
+        return 1;
+    }
+    rc = Fapi_Import(context, "/policy/pol_password", policy);
+    free(policy);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Fapi_CreateKey(context, "HS/SRK/benchPolicy", "sign,noDa",
+                            "/policy/pol_password", POLICY_AUTH);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Creating the policy key failed: 0x%" PRIx32 "\n", rc);
+        return 1;
+    }
+
+    if (bench_op(context, "Fapi_CreateKey", 10, op_create_key) != 0 ||
+        bench_op(context, "Fapi_Sign", 50, op_sign) != 0 ||
+        bench_op(context, "Fapi_Sign (policy)", 20, op_sign_policy) != 0 ||
+        bench_op(context, "Fapi_PcrExtend", N_EVENTS, op_pcr_extend) != 0 ||
+        bench_op(context, "Fapi_Quote", 20, op_quote) != 0 ||
+        bench_op(context, "Fapi_VerifyQuote", 20, op_verify_quote) != 0 ||
+        bench_op(context, "Fapi_NvWrite 1024 bytes", 50, op_nv_write) != 0 ||
+        bench_op(context, "Fapi_NvRead 1024 bytes", 50, op_nv_read) != 0 ||
+        bench_op(context, "Fapi_List", 50, op_list) != 0)
+        return 1;
+
+    /* Remove the persistent objects and NV indices from the TPM. */
+    rc = Fapi_Delete(context, "/");
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Cleaning up failed: 0x%" PRIx32 "\n", rc);
+        return 1;
+    }
+    return 0;
+}
+
+/* Write a FAPI configuration using a keystore in 'dir'. */
+static int
+write_config(const char *dir, const char *tcti)
+{
+    char path[256];
+    FILE *file;
+    int size;
+
+    snprintf(path, sizeof(path), "%s/system_dir", dir);
+    if (mkdir(path, 0777) != 0)
+        return 1;
+    snprintf(path, sizeof(path), "%s/fapi-config.json", dir);
+    file = fopen(path, "w");
+    if (file == NULL)
+        return 1;
+    size = fprintf(file, "{\n"
+                   "     \"profile_name\": \"" PROFILE "\",\n"
+                   "     \"profile_dir\": \"" TOP_SOURCEDIR "/test/data/fapi/\",\n"
+                   "     \"user_dir\": \"%s/user/dir\",\n"
+                   "     \"system_dir\": \"%s/system_dir\",\n"
+                   "     \"system_pcrs\" : [],\n"
+                   "     \"log_dir\" : \"%s\",\n"
+                   "     \"tcti\": \"%s\",\n"
+                   "     \"ek_cert_less\": \"yes\",\n"
+                   "}\n", dir, dir, dir, tcti);
+    fclose(file);
+    if (size < 0)
+        return 1;
+    return setenv("TSS2_FAPICONF", path, 1) != 0;
+}
+
+/* Check whether the TPM can be reached through the TCTI. */
+static bool
+tpm_available(const char *tcti_conf)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    if (Tss2_TctiLdr_Initialize(tcti_conf, &tcti) != TSS2_RC_SUCCESS)
+        return false;
+    Tss2_TctiLdr_Finalize(&tcti);
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char template[] = "/tmp/fapi_bench.XXXXXX";
+    const char *tcti = getenv("TPM20TEST_TCTI");
+    FAPI_CONTEXT *context = NULL;
+    char command[64];
+    char *dir;
+    TSS2_RC rc;
+    int ret;
+
+    (void)argc;
+    (void)argv;
+
+    if (tcti == NULL)
+        tcti = "mssim";
+    if (!tpm_available(tcti)) {
+        printf("No TPM available, skipped\n");
+        return EXIT_SUCCESS;
+    }
+
+    dir = mkdtemp(template);
+    if (dir == NULL || write_config(dir, tcti) != 0) {
+        fprintf(stderr, "Creating the keystore failed\n");
+        return EXIT_FAILURE;
+    }
+
+    ifapi_timing_enable(true);
+    rc = Fapi_Initialize(&context, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Fapi_Initialize failed: 0x%" PRIx32 "\n", rc);
+        ret = 1;
+    } else {
+        ret = bench_fapi(context);
+        Fapi_Finalize(&context);
+    }
+    Fapi_Free(quote_info);
+    Fapi_Free(quote_signature);
+    Fapi_Free(quote_log);
+
+    snprintf(command, sizeof(command), "rm -r -f %s", dir);
+    if (system(command) != 0)
+        ret = 1;
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+/*
+ * Benchmark for decoding keystore objects in the JSON and the binary format.
+ * The file is read with a single read in both cases, so this measures the
+ * part of a keystore load that differs between the formats.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+
+#include "ifapi_keystore.h"
+#include "ifapi_keystore_binary.h"
+#include "ifapi_json_serialize.h"
+#include "ifapi_json_deserialize.h"
+
+#include "bench.h"
+
+#define ITERATIONS 20000
+
+static uint8_t private_blob[222];
+
+/* A signing key as it is stored after Fapi_CreateKey. */
+static void
+fill_key(IFAPI_OBJECT *object)
+{
+    IFAPI_KEY *key = &object->misc.key;
+    TPMT_PUBLIC *public = &key->public.publicArea;
+
+    memset(object, 0, sizeof(*object));
+    object->objectType = IFAPI_KEY_OBJ;
+
+    public->type = TPM2_ALG_RSA;
+    public->nameAlg = TPM2_ALG_SHA256;
+    public->objectAttributes = TPMA_OBJECT_SIGN_ENCRYPT | TPMA_OBJECT_USERWITHAUTH |
+        TPMA_OBJECT_SENSITIVEDATAORIGIN | TPMA_OBJECT_FIXEDTPM |
+        TPMA_OBJECT_FIXEDPARENT;
+    public->parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_NULL;
+    public->parameters.rsaDetail.scheme.scheme = TPM2_ALG_NULL;
+    public->parameters.rsaDetail.keyBits = 2048;
+    public->unique.rsa.size = 256;
+    memset(&public->unique.rsa.buffer[0], 0x5a, 256);
+
+    memset(&private_blob[0], 0xa5, sizeof(private_blob));
+    key->private.buffer = &private_blob[0];
+    key->private.size = sizeof(private_blob);
+    key->serialization.buffer = &private_blob[0];
+    key->serialization.size = 0;
+    key->policyInstance = "";
+    key->description = "Benchmark signing key";
+    key->certificate = "";
+    key->with_auth = TPM2_YES;
+    key->signing_scheme.scheme = TPM2_ALG_RSAPSS;
+    key->signing_scheme.details.rsapss.hashAlg = TPM2_ALG_SHA256;
+    key->name.size = 34;
+    memset(&key->name.name[0], 0x11, key->name.size);
+    key->creationTicket.tag = TPM2_ST_CREATION;
+    key->creationTicket.hierarchy = TPM2_RH_OWNER;
+    key->creationTicket.digest.size = 32;
+}
+
+/* Compare a decoded object by its binary encoding and free it. */
+static bool
+same_object(IFAPI_OBJECT *object, const uint8_t *binary, size_t binary_size)
+{
+    uint8_t *encoded;
+    size_t encoded_size;
+    TSS2_RC rc;
+    bool same;
+
+    rc = ifapi_binary_IFAPI_OBJECT_serialize(object, &encoded, &encoded_size);
+    ifapi_cleanup_ifapi_object(object);
+    if (rc != TSS2_RC_SUCCESS)
+        return false;
+    same = encoded_size == binary_size &&
+        memcmp(encoded, binary, binary_size) == 0;
+    free(encoded);
+    if (!same)
+        fprintf(stderr, "decoded object differs from the stored one\n");
+    return same;
+}
+
+int
+main(int argc, char *argv[])
+{
+    IFAPI_OBJECT object, decoded;
+    json_object *jso = NULL;
+    char *json_string;
+    uint8_t *binary;
+    size_t binary_size;
+    TSS2_RC rc;
+
+    (void)argc;
+    (void)argv;
+
+    fill_key(&object);
+
+    rc = ifapi_json_IFAPI_OBJECT_serialize(&object, &jso);
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+    json_string = strdup(json_object_to_json_string_ext(jso,
+                                                        JSON_C_TO_STRING_PRETTY));
+    json_object_put(jso);
+    if (json_string == NULL)
+        return EXIT_FAILURE;
+
+    rc = ifapi_binary_IFAPI_OBJECT_serialize(&object, &binary, &binary_size);
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+
+    /* Both encodings have to decode to the object that was stored. */
+    jso = json_tokener_parse(json_string);
+    rc = ifapi_json_IFAPI_OBJECT_deserialize(jso, &decoded);
+    json_object_put(jso);
+    if (rc != TSS2_RC_SUCCESS || !same_object(&decoded, binary, binary_size))
+        return EXIT_FAILURE;
+    rc = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size, &decoded);
+    if (rc != TSS2_RC_SUCCESS || !same_object(&decoded, binary, binary_size))
+        return EXIT_FAILURE;
+
+    printf("# object size: json %zu bytes, binary %zu bytes\n",
+           strlen(json_string), binary_size);
+
+    BENCH_RUN("load json key object", ITERATIONS,
+              jso = json_tokener_parse(json_string);
+              rc = ifapi_json_IFAPI_OBJECT_deserialize(jso, &object);
+              json_object_put(jso);
+              if (rc == TSS2_RC_SUCCESS)
+                  ifapi_cleanup_ifapi_object(&object));
+
+    BENCH_RUN("load binary key object", ITERATIONS,
+              rc = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size,
+                                                         &object);
+              if (rc == TSS2_RC_SUCCESS)
+                  ifapi_cleanup_ifapi_object(&object));
+
+    free(json_string);
+    free(binary);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+/*
+ * Benchmark for the replay of event logs as done by Fapi_VerifyQuote.
+ * A synthetic log with 100000 events carrying SHA1, SHA256 and SHA384
+ * digests is replayed into eight PCRs of each bank with an increasing
+ * number of replay threads, and once more from the checkpoints of a
+ * previous replay after a few events were appended. The PCR values of all
+ * runs have to match those of a single threaded full replay.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+
+#include "ifapi_eventlog.h"
+#include "ifapi_json_serialize.h"
+
+#include "bench.h"
+
+#define N_EVENTS 100000
+#define N_APPENDED 100
+
+static const TPMI_ALG_HASH banks[] = {
+    TPM2_ALG_SHA1, TPM2_ALG_SHA256, TPM2_ALG_SHA384
+};
+
+static TSS2_RC
+append_event(char **log, size_t *size, size_t *capacity, UINT32 recnum)
+{
+    IFAPI_EVENT event;
+    json_object *jso = NULL;
+    const char *text;
+    size_t i, length;
+    char *grown;
+    TSS2_RC rc;
+
+    memset(&event, 0, sizeof(event));
+    event.recnum = recnum;
+    event.pcr = recnum % 8;
+    event.type = IFAPI_TSS_EVENT_TAG;
+    event.sub_event.tss_event.data.size = 16;
+    memset(&event.sub_event.tss_event.data.buffer[0], recnum & 0xff, 16);
+    event.digests.count = sizeof(banks) / sizeof(banks[0]);
+    for (i = 0; i < event.digests.count; i++) {
+        event.digests.digests[i].hashAlg = banks[i];
+        memset(&event.digests.digests[i].digest, (recnum + i) & 0xff,
+               sizeof(event.digests.digests[i].digest));
+    }
+
+    rc = ifapi_json_IFAPI_EVENT_serialize(&event, &jso);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    text = json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PRETTY);
+    length = strlen(text);
+
+    /* Room for the separator and the closing bracket. */
+    if (*size + length + 8 > *capacity) {
+        *capacity = (*size + length + 8) * 2;
+        grown = realloc(*log, *capacity);
+        if (grown == NULL) {
+            json_object_put(jso);
+            return TSS2_FAPI_RC_MEMORY;
+        }
+        *log = grown;
+    }
+    *size += sprintf(&(*log)[*size], "%s  %s", recnum > 1 ? ",\n" : "[\n", text);
+    json_object_put(jso);
+    return TSS2_RC_SUCCESS;
+}
+
+static bool
+same_pcrs(const IFAPI_EVENTLOG_REPLAY *replay, const IFAPI_VPCR *pcrs,
+          size_t n_pcrs)
+{
+    size_t i;
+
+    if (replay->n_pcrs != n_pcrs)
+        return false;
+    for (i = 0; i < n_pcrs; i++) {
+        if (replay->pcrs[i].pcr != pcrs[i].pcr ||
+            replay->pcrs[i].bank != pcrs[i].bank ||
+            replay->pcrs[i].value.size != pcrs[i].value.size ||
+            memcmp(&replay->pcrs[i].value.buffer[0], &pcrs[i].value.buffer[0],
+                   pcrs[i].value.size) != 0)
+            return false;
+    }
+    return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+    IFAPI_EVENTLOG_REPLAY replay, full;
+    TPML_PCR_SELECTION selection;
+    IFAPI_VPCR *expected = NULL;
+    char *log = NULL;
+    size_t size = 0, capacity = 0, i, threads, n_expected = 0;
+    char name[64];
+    TSS2_RC rc;
+
+    (void)argc;
+    (void)argv;
+
+    memset(&selection, 0, sizeof(selection));
+    selection.count = sizeof(banks) / sizeof(banks[0]);
+    for (i = 0; i < selection.count; i++) {
+        selection.pcrSelections[i].hash = banks[i];
+        selection.pcrSelections[i].sizeofSelect = 3;
+        selection.pcrSelections[i].pcrSelect[0] = 0xff;
+    }
+
+    for (i = 1; i <= N_EVENTS; i++) {
+        rc = append_event(&log, &size, &capacity, i);
+        if (rc != TSS2_RC_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    strcpy(&log[size], "\n]");
+    printf("# event log: %d events, %zu bytes\n", N_EVENTS, size + 2);
+
+    for (threads = 1; threads <= 8; threads *= 2) {
+        memset(&replay, 0, sizeof(replay));
+        replay.n_threads = threads;
+        snprintf(name, sizeof(name), "full replay, %zu thread(s)", threads);
+        BENCH_RUN(name, 3,
+                  ifapi_eventlog_replay_cleanup(&replay);
+                  rc = ifapi_eventlog_replay(&replay, &selection, log, strlen(log)));
+
+        /* Every number of threads has to give the same PCR values. */
+        if (threads == 1) {
+            expected = calloc(replay.n_pcrs, sizeof(IFAPI_VPCR));
+            if (expected == NULL)
+                return EXIT_FAILURE;
+            memcpy(expected, replay.pcrs, replay.n_pcrs * sizeof(IFAPI_VPCR));
+            n_expected = replay.n_pcrs;
+        } else if (!same_pcrs(&replay, expected, n_expected)) {
+            fprintf(stderr, "%s: PCR values differ from 1 thread\n", name);
+            return EXIT_FAILURE;
+        }
+        ifapi_eventlog_replay_cleanup(&replay);
+    }
+
+    /* Replay the log once, append events and replay from the checkpoints. */
+    memset(&replay, 0, sizeof(replay));
+    replay.n_threads = 1;
+    rc = ifapi_eventlog_replay(&replay, &selection, log, strlen(log));
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+    for (i = N_EVENTS + 1; i <= N_EVENTS + N_APPENDED; i++) {
+        rc = append_event(&log, &size, &capacity, i);
+        if (rc != TSS2_RC_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    strcpy(&log[size], "\n]");
+    BENCH_RUN("replay after appending events", 1,
+              rc = ifapi_eventlog_replay(&replay, &selection, log, strlen(log)));
+
+    /* The resumed replay has to match a full replay of the grown log. */
+    memset(&full, 0, sizeof(full));
+    full.n_threads = 1;
+    rc = ifapi_eventlog_replay(&full, &selection, log, strlen(log));
+    if (rc != TSS2_RC_SUCCESS || !same_pcrs(&replay, full.pcrs, full.n_pcrs)) {
+        fprintf(stderr, "replay after appending events differs from full replay\n");
+        return EXIT_FAILURE;
+    }
+    ifapi_eventlog_replay_cleanup(&full);
+    ifapi_eventlog_replay_cleanup(&replay);
+
+    free(expected);
+    free(log);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for debug logging with TSS2_LOG=all+debug and stderr redirected
+ * to /dev/null: the stderr backend versus the ring backend. For the ring
+ * backend, the cost for the logging thread alone and the cost including the
+ * formatting by the flusher are measured. Each backend runs in a child
+ * process, as the backend is selected once per process.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tss2_common.h"
+
+#define LOGMODULE bench
+#include "util/log.h"
+
+#include "bench.h"
+
+#define ITERATIONS 100000
+#define BURST 128               /* Messages per flush, below the ring size */
+
+static const uint8_t blob[256];
+
+static int
+bench_stderr(void)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    BENCH_RUN("LOG_DEBUG, stderr", ITERATIONS,
+              LOG_DEBUG("command 0x%08x, size %zu: %s", 0x17bu,
+                        (size_t) bench_i_, "TPM2_CC_Create"));
+    BENCH_RUN("LOGBLOB_DEBUG 256 bytes, stderr", ITERATIONS / 10,
+              LOGBLOB_DEBUG(&blob[0], sizeof(blob), "command %zu",
+                            (size_t) bench_i_));
+    return 0;
+}
+
+static int
+bench_ring(void)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint64_t start, ns = 0;
+    size_t i, j;
+
+    for (i = 0; i < ITERATIONS / BURST; i++) {
+        start = bench_now_ns();
+        for (j = 0; j < BURST; j++)
+            LOG_DEBUG("command 0x%08x, size %zu: %s", 0x17bu, j,
+                      "TPM2_CC_Create");
+        ns += bench_now_ns() - start;
+        doLogFlush();
+    }
+    bench_report("LOG_DEBUG, ring (caller)", i * BURST, ns);
+
+    BENCH_RUN("LOG_DEBUG, ring (with flush)", ITERATIONS,
+              LOG_DEBUG("command 0x%08x, size %zu: %s", 0x17bu,
+                        (size_t) bench_i_, "TPM2_CC_Create");
+              if (bench_i_ % BURST == BURST - 1)
+                  doLogFlush());
+    BENCH_RUN("LOGBLOB_DEBUG 256 bytes, ring (with flush)", ITERATIONS / 10,
+              LOGBLOB_DEBUG(&blob[0], sizeof(blob), "command %zu",
+                            (size_t) bench_i_);
+              if (bench_i_ % (BURST / 4) == BURST / 4 - 1)
+                  doLogFlush());
+    return 0;
+}
+
+static int
+run_backend(const char *backend, int (*bench)(void))
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0)
+        return 1;
+    if (pid == 0) {
+        setenv("TSS2_LOG_BACKEND", backend, 1);
+        if (freopen("/dev/null", "w", stderr) == NULL)
+            _exit(EXIT_FAILURE);
+        status = bench();
+        fflush(stdout);
+        _exit(status == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return 1;
+    return WEXITSTATUS(status);
+}
+
+int
+main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    setenv("TSS2_LOG", "all+debug", 1);
+
+    if (run_backend("stderr", bench_stderr) != 0 ||
+        run_backend("ring", bench_ring) != 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
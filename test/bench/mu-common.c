@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for (un)marshalling the structures most TPM commands carry:
+ * public areas, signatures, PCR selections and values, attestations, NV
+ * public areas, creation data and contexts.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include "tss2_mu.h"
+
+#include "bench.h"
+#include "bench-data.h"
+
+#define ITERATIONS 200000
+
+static uint8_t buffer[4096];
+
+/*
+ * Marshal and unmarshal 'value' of 'type', labelled 'name'. 'reset' prepares
+ * the output before each unmarshalling; sized structures must have size 0.
+ */
+#define BENCH_MU_RESET(name, type, value, reset) \
+    do { \
+        static type out_; \
+        size_t offset_, size_; \
+        BENCH_RUN("marshal " name, ITERATIONS, \
+                  offset_ = 0; \
+                  rc = Tss2_MU_##type##_Marshal(&(value), buffer, \
+                                                sizeof(buffer), &offset_)); \
+        size_ = offset_; \
+        BENCH_RUN("unmarshal " name, ITERATIONS, \
+                  offset_ = 0; \
+                  reset; \
+                  rc = Tss2_MU_##type##_Unmarshal(buffer, size_, &offset_, \
+                                                  &out_)); \
+    } while (0)
+#define BENCH_MU(name, type, value) \
+    BENCH_MU_RESET(name, type, value, (void)0)
+#define BENCH_MU_2B(name, type, value) \
+    BENCH_MU_RESET(name, type, value, out_.size = 0)
+
+static int
+bench_mu(void)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    BENCH_MU_2B("TPM2B_PUBLIC RSA 2048", TPM2B_PUBLIC, bench_rsa_public);
+    BENCH_MU_2B("TPM2B_PUBLIC ECC P256", TPM2B_PUBLIC, bench_ecc_public);
+    BENCH_MU_2B("TPM2B_SENSITIVE_CREATE", TPM2B_SENSITIVE_CREATE,
+                bench_sensitive_create);
+    BENCH_MU("TPMT_SIGNATURE RSASSA", TPMT_SIGNATURE, bench_rsa_signature);
+    BENCH_MU("TPMT_SIGNATURE ECDSA", TPMT_SIGNATURE, bench_ecc_signature);
+    BENCH_MU("TPML_PCR_SELECTION", TPML_PCR_SELECTION, bench_pcr_selection);
+    BENCH_MU("TPML_DIGEST 8 PCRs", TPML_DIGEST, bench_pcr_values);
+    BENCH_MU("TPMS_ATTEST quote", TPMS_ATTEST, bench_quote);
+    BENCH_MU_2B("TPM2B_NV_PUBLIC", TPM2B_NV_PUBLIC, bench_nv_public);
+    BENCH_MU_2B("TPM2B_CREATION_DATA", TPM2B_CREATION_DATA,
+                bench_creation_data);
+    BENCH_MU("TPMS_CONTEXT 1024 bytes", TPMS_CONTEXT, bench_context);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    return bench_mu() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for (un)marshalling full size GetCapability responses.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_mu.h"
+
+#include "bench.h"
+
+#define ITERATIONS 100000
+
+static TPMS_CAPABILITY_DATA cap_data;
+static uint8_t buffer[sizeof(TPMS_CAPABILITY_DATA)];
+
+static void
+fill_capability(TPM2_CAP capability)
+{
+    UINT32 i;
+
+    memset(&cap_data, 0, sizeof(cap_data));
+    cap_data.capability = capability;
+    switch (capability) {
+    case TPM2_CAP_ALGS:
+        cap_data.data.algorithms.count = TPM2_MAX_CAP_ALGS;
+        for (i = 0; i < TPM2_MAX_CAP_ALGS; i++) {
+            cap_data.data.algorithms.algProperties[i].alg = (TPM2_ALG_ID)i;
+            cap_data.data.algorithms.algProperties[i].algProperties = i;
+        }
+        break;
+    case TPM2_CAP_HANDLES:
+        cap_data.data.handles.count = TPM2_MAX_CAP_HANDLES;
+        for (i = 0; i < TPM2_MAX_CAP_HANDLES; i++)
+            cap_data.data.handles.handle[i] = TPM2_PERSISTENT_FIRST + i;
+        break;
+    case TPM2_CAP_PP_COMMANDS:
+        cap_data.data.ppCommands.count = TPM2_MAX_CAP_CC;
+        for (i = 0; i < TPM2_MAX_CAP_CC; i++)
+            cap_data.data.ppCommands.commandCodes[i] = TPM2_CC_FIRST + i;
+        break;
+    case TPM2_CAP_TPM_PROPERTIES:
+        cap_data.data.tpmProperties.count = TPM2_MAX_TPM_PROPERTIES;
+        for (i = 0; i < TPM2_MAX_TPM_PROPERTIES; i++) {
+            cap_data.data.tpmProperties.tpmProperty[i].property = TPM2_PT_FIXED + i;
+            cap_data.data.tpmProperties.tpmProperty[i].value = i;
+        }
+        break;
+    }
+}
+
+static int
+bench_capability(const char *name, TPM2_CAP capability)
+{
+    char label[64];
+    size_t offset;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    fill_capability(capability);
+
+    snprintf(label, sizeof(label), "marshal %s", name);
+    BENCH_RUN(label, ITERATIONS,
+              offset = 0;
+              rc = Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&cap_data, buffer,
+                                                        sizeof(buffer), &offset));
+
+    snprintf(label, sizeof(label), "unmarshal %s", name);
+    BENCH_RUN(label, ITERATIONS,
+              offset = 0;
+              rc = Tss2_MU_TPMS_CAPABILITY_DATA_Unmarshal(buffer, sizeof(buffer),
+                                                          &offset, &cap_data));
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    if (bench_capability("TPM2_CAP_ALGS", TPM2_CAP_ALGS) ||
+        bench_capability("TPM2_CAP_HANDLES", TPM2_CAP_HANDLES) ||
+        bench_capability("TPM2_CAP_PP_COMMANDS", TPM2_CAP_PP_COMMANDS) ||
+        bench_capability("TPM2_CAP_TPM_PROPERTIES", TPM2_CAP_TPM_PROPERTIES))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
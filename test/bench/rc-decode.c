@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for decoding response codes: Tss2_RC_Decode() versus the
+ * allocation and formatting free Tss2_RC_DecodeStruct() and
+ * Tss2_RC_DecodeStrings(), over a mix of TPM format 0 and 1 and TSS codes.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include "tss2_rc.h"
+#include "tss2_tpm2_types.h"
+
+#include "bench.h"
+
+#define ITERATIONS 200000
+
+static const TSS2_RC codes[] = {
+    TPM2_RC_SUCCESS,
+    TPM2_RC_INITIALIZE,
+    TPM2_RC_RETRY,
+    TPM2_RC_HASH + TPM2_RC_P + TPM2_RC_1,
+    TPM2_RC_VALUE + TPM2_RC_H + TPM2_RC_2,
+    TPM2_RC_AUTH_FAIL + TPM2_RC_S + TPM2_RC_1,
+    TSS2_ESYS_RC_BAD_REFERENCE,
+    TSS2_SYS_RC_INSUFFICIENT_CONTEXT,
+    TSS2_TCTI_RC_TRY_AGAIN,
+    TSS2_RESMGR_TPM_RC_LAYER + TPM2_RC_LOCKOUT,
+};
+
+#define NUM_CODES (sizeof(codes) / sizeof(codes[0]))
+
+int
+main(int argc, char *argv[])
+{
+    TSS2_RC_INFO info;
+    TSS2_RC_STRINGS strings;
+    volatile size_t sink = 0;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    (void)argc;
+    (void)argv;
+
+    BENCH_RUN("Tss2_RC_Decode", ITERATIONS,
+              sink += Tss2_RC_Decode(codes[bench_i_ % NUM_CODES])[0]);
+    BENCH_RUN("Tss2_RC_DecodeStruct", ITERATIONS,
+              Tss2_RC_DecodeStruct(codes[bench_i_ % NUM_CODES], &info);
+              sink += info.base);
+    BENCH_RUN("Tss2_RC_DecodeStrings", ITERATIONS,
+              Tss2_RC_DecodeStrings(codes[bench_i_ % NUM_CODES], &strings);
+              sink += strings.prefix != NULL);
+
+    return EXIT_SUCCESS;
+}
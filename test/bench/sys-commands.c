@@ -0,0 +1,644 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+/*
+ * Benchmark for the client side cost of SAPI for 20 common commands: the
+ * _Prepare() function alone, and the one-call function, which prepares the
+ * command, executes it on an in-process TCTI answering with a canned response
+ * and unmarshals the response in _Complete().
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+
+#include "bench.h"
+#include "bench-data.h"
+#include "tcti-canned.h"
+
+#define ITERATIONS 50000
+
+typedef struct {
+    const char *name;
+    TSS2_RC (*prepare)(void);
+    TSS2_RC (*call)(void);
+    TSS2_RC (*response)(uint8_t *buffer, size_t size, size_t *offset);
+    TPM2_HANDLE handle;         /* The handle in the response, or 0. */
+    int auths;                  /* The number of (password) sessions. */
+} BENCH_COMMAND;
+
+static TSS2_SYS_CONTEXT *sys;
+
+static const TSS2L_SYS_AUTH_COMMAND cmd_auths = {
+    .count = 1,
+    .auths = { { .sessionHandle = TPM2_RS_PW,
+                 .sessionAttributes = TPMA_SESSION_CONTINUESESSION } },
+};
+static TSS2L_SYS_AUTH_RESPONSE rsp_auths;
+
+/* Inputs */
+static const TPM2B_DIGEST digest = { .size = 32 };
+static const TPM2B_DATA no_data = { .size = 0 };
+static const TPM2B_NONCE nonce = { .size = 32 };
+static const TPM2B_ENCRYPTED_SECRET no_salt = { .size = 0 };
+static const TPM2B_PRIVATE private = { .size = 222 };
+static const TPM2B_MAX_NV_BUFFER nv_data = { .size = 1024 };
+static const TPM2B_MAX_BUFFER hash_data = { .size = 1024 };
+static const TPML_DIGEST_VALUES extend_digests = {
+    .count = 1, .digests = { { .hashAlg = TPM2_ALG_SHA256 } },
+};
+static const TPMT_SIG_SCHEME null_scheme = { .scheme = TPM2_ALG_NULL };
+static const TPMT_TK_HASHCHECK null_ticket = {
+    .tag = TPM2_ST_HASHCHECK, .hierarchy = TPM2_RH_NULL,
+};
+static const TPMT_SYM_DEF aes_cfb = {
+    .algorithm = TPM2_ALG_AES, .keyBits.aes = 128, .mode.aes = TPM2_ALG_CFB,
+};
+static const TPM2B_NAME name = { .size = 34 };
+static const TPMT_TK_CREATION creation_ticket = {
+    .tag = TPM2_ST_CREATION, .hierarchy = TPM2_RH_OWNER,
+    .digest = { .size = 32 },
+};
+static const TPMT_TK_VERIFIED verified_ticket = {
+    .tag = TPM2_ST_VERIFIED, .hierarchy = TPM2_RH_OWNER,
+    .digest = { .size = 32 },
+};
+static TPMS_CAPABILITY_DATA properties = {
+    .capability = TPM2_CAP_TPM_PROPERTIES,
+    .data.tpmProperties = { .count = 16 },
+};
+static TPM2B_ATTEST quoted;
+
+/* Outputs; sized structures are reset to size 0 before each call. */
+static TPMI_YES_NO more_data;
+static TPMS_CAPABILITY_DATA out_capability;
+static TPM2B_DIGEST out_digest;
+static UINT32 out_counter;
+static TPML_PCR_SELECTION out_selection;
+static TPML_DIGEST out_values;
+static TPM2_HANDLE out_handle;
+static TPM2B_PUBLIC out_public;
+static TPM2B_CREATION_DATA out_creation_data;
+static TPMT_TK_CREATION out_creation_ticket;
+static TPM2B_NAME out_name, out_qualified_name;
+static TPM2B_PRIVATE out_private;
+static TPMT_SIGNATURE out_signature;
+static TPMT_TK_VERIFIED out_verified;
+static TPM2B_NONCE out_nonce;
+static TPM2B_MAX_NV_BUFFER out_nv_data;
+static TPM2B_NV_PUBLIC out_nv_public;
+static TPM2B_ATTEST out_quoted;
+static TPMT_TK_HASHCHECK out_hash_ticket;
+static TPMS_CONTEXT out_context;
+
+/* Marshal a list of response parameters, stopping at the first error. */
+#define MARSHAL(type, value) \
+    if (rc == TSS2_RC_SUCCESS) \
+        rc = Tss2_MU_##type##_Marshal((value), buffer, size, offset)
+
+static TSS2_RC
+getcapability_prepare(void)
+{
+    return Tss2_Sys_GetCapability_Prepare(sys, TPM2_CAP_TPM_PROPERTIES,
+                                          TPM2_PT_FIXED, 16);
+}
+
+static TSS2_RC
+getcapability_call(void)
+{
+    return Tss2_Sys_GetCapability(sys, NULL, TPM2_CAP_TPM_PROPERTIES,
+                                  TPM2_PT_FIXED, 16, &more_data,
+                                  &out_capability, NULL);
+}
+
+static TSS2_RC
+getcapability_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(UINT8, TPM2_NO);
+    MARSHAL(TPMS_CAPABILITY_DATA, &properties);
+    return rc;
+}
+
+static TSS2_RC
+getrandom_prepare(void)
+{
+    return Tss2_Sys_GetRandom_Prepare(sys, 32);
+}
+
+static TSS2_RC
+getrandom_call(void)
+{
+    return Tss2_Sys_GetRandom(sys, NULL, 32, &out_digest, NULL);
+}
+
+static TSS2_RC
+getrandom_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_DIGEST, &digest);
+    return rc;
+}
+
+static TSS2_RC
+pcr_read_prepare(void)
+{
+    return Tss2_Sys_PCR_Read_Prepare(sys, &bench_pcr_selection);
+}
+
+static TSS2_RC
+pcr_read_call(void)
+{
+    return Tss2_Sys_PCR_Read(sys, NULL, &bench_pcr_selection, &out_counter,
+                             &out_selection, &out_values, NULL);
+}
+
+static TSS2_RC
+pcr_read_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(UINT32, 42);
+    MARSHAL(TPML_PCR_SELECTION, &bench_pcr_selection);
+    MARSHAL(TPML_DIGEST, &bench_pcr_values);
+    return rc;
+}
+
+static TSS2_RC
+pcr_extend_prepare(void)
+{
+    return Tss2_Sys_PCR_Extend_Prepare(sys, 16, &extend_digests);
+}
+
+static TSS2_RC
+pcr_extend_call(void)
+{
+    return Tss2_Sys_PCR_Extend(sys, 16, &cmd_auths, &extend_digests,
+                               &rsp_auths);
+}
+
+static TSS2_RC
+createprimary_prepare(void)
+{
+    return Tss2_Sys_CreatePrimary_Prepare(sys, TPM2_RH_OWNER,
+                                          &bench_sensitive_create,
+                                          &bench_rsa_public, &no_data,
+                                          &bench_pcr_selection);
+}
+
+static TSS2_RC
+createprimary_call(void)
+{
+    out_public.size = 0;
+    out_creation_data.size = 0;
+    return Tss2_Sys_CreatePrimary(sys, TPM2_RH_OWNER, &cmd_auths,
+                                  &bench_sensitive_create, &bench_rsa_public,
+                                  &no_data, &bench_pcr_selection, &out_handle,
+                                  &out_public, &out_creation_data,
+                                  &out_digest, &out_creation_ticket,
+                                  &out_name, &rsp_auths);
+}
+
+static TSS2_RC
+createprimary_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_PUBLIC, &bench_rsa_public);
+    MARSHAL(TPM2B_CREATION_DATA, &bench_creation_data);
+    MARSHAL(TPM2B_DIGEST, &digest);
+    MARSHAL(TPMT_TK_CREATION, &creation_ticket);
+    MARSHAL(TPM2B_NAME, &name);
+    return rc;
+}
+
+static TSS2_RC
+create_prepare(void)
+{
+    return Tss2_Sys_Create_Prepare(sys, 0x80000000, &bench_sensitive_create,
+                                   &bench_ecc_public, &no_data,
+                                   &bench_pcr_selection);
+}
+
+static TSS2_RC
+create_call(void)
+{
+    out_public.size = 0;
+    out_creation_data.size = 0;
+    return Tss2_Sys_Create(sys, 0x80000000, &cmd_auths,
+                           &bench_sensitive_create, &bench_ecc_public,
+                           &no_data, &bench_pcr_selection, &out_private,
+                           &out_public, &out_creation_data, &out_digest,
+                           &out_creation_ticket, &rsp_auths);
+}
+
+static TSS2_RC
+create_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_PRIVATE, &private);
+    MARSHAL(TPM2B_PUBLIC, &bench_ecc_public);
+    MARSHAL(TPM2B_CREATION_DATA, &bench_creation_data);
+    MARSHAL(TPM2B_DIGEST, &digest);
+    MARSHAL(TPMT_TK_CREATION, &creation_ticket);
+    return rc;
+}
+
+static TSS2_RC
+load_prepare(void)
+{
+    return Tss2_Sys_Load_Prepare(sys, 0x80000000, &private,
+                                 &bench_ecc_public);
+}
+
+static TSS2_RC
+load_call(void)
+{
+    return Tss2_Sys_Load(sys, 0x80000000, &cmd_auths, &private,
+                         &bench_ecc_public, &out_handle, &out_name,
+                         &rsp_auths);
+}
+
+static TSS2_RC
+name_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_NAME, &name);
+    return rc;
+}
+
+static TSS2_RC
+sign_prepare(void)
+{
+    return Tss2_Sys_Sign_Prepare(sys, 0x80000001, &digest, &null_scheme,
+                                 &null_ticket);
+}
+
+static TSS2_RC
+sign_call(void)
+{
+    return Tss2_Sys_Sign(sys, 0x80000001, &cmd_auths, &digest, &null_scheme,
+                         &null_ticket, &out_signature, &rsp_auths);
+}
+
+static TSS2_RC
+signature_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPMT_SIGNATURE, &bench_ecc_signature);
+    return rc;
+}
+
+static TSS2_RC
+verifysignature_prepare(void)
+{
+    return Tss2_Sys_VerifySignature_Prepare(sys, 0x80000001, &digest,
+                                            &bench_rsa_signature);
+}
+
+static TSS2_RC
+verifysignature_call(void)
+{
+    return Tss2_Sys_VerifySignature(sys, 0x80000001, NULL, &digest,
+                                    &bench_rsa_signature, &out_verified,
+                                    NULL);
+}
+
+static TSS2_RC
+verifysignature_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPMT_TK_VERIFIED, &verified_ticket);
+    return rc;
+}
+
+static TSS2_RC
+readpublic_prepare(void)
+{
+    return Tss2_Sys_ReadPublic_Prepare(sys, 0x81000001);
+}
+
+static TSS2_RC
+readpublic_call(void)
+{
+    out_public.size = 0;
+    return Tss2_Sys_ReadPublic(sys, 0x81000001, NULL, &out_public, &out_name,
+                               &out_qualified_name, NULL);
+}
+
+static TSS2_RC
+readpublic_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_PUBLIC, &bench_rsa_public);
+    MARSHAL(TPM2B_NAME, &name);
+    MARSHAL(TPM2B_NAME, &name);
+    return rc;
+}
+
+static TSS2_RC
+flushcontext_prepare(void)
+{
+    return Tss2_Sys_FlushContext_Prepare(sys, 0x80000001);
+}
+
+static TSS2_RC
+flushcontext_call(void)
+{
+    return Tss2_Sys_FlushContext(sys, 0x80000001);
+}
+
+static TSS2_RC
+startauthsession_prepare(void)
+{
+    return Tss2_Sys_StartAuthSession_Prepare(sys, TPM2_RH_NULL, TPM2_RH_NULL,
+                                             &nonce, &no_salt, TPM2_SE_HMAC,
+                                             &aes_cfb, TPM2_ALG_SHA256);
+}
+
+static TSS2_RC
+startauthsession_call(void)
+{
+    return Tss2_Sys_StartAuthSession(sys, TPM2_RH_NULL, TPM2_RH_NULL, NULL,
+                                     &nonce, &no_salt, TPM2_SE_HMAC, &aes_cfb,
+                                     TPM2_ALG_SHA256, &out_handle, &out_nonce,
+                                     NULL);
+}
+
+static TSS2_RC
+startauthsession_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_NONCE, &nonce);
+    return rc;
+}
+
+static TSS2_RC
+nv_read_prepare(void)
+{
+    return Tss2_Sys_NV_Read_Prepare(sys, 0x01000000, 0x01000000, 1024, 0);
+}
+
+static TSS2_RC
+nv_read_call(void)
+{
+    return Tss2_Sys_NV_Read(sys, 0x01000000, 0x01000000, &cmd_auths, 1024, 0,
+                            &out_nv_data, &rsp_auths);
+}
+
+static TSS2_RC
+nv_read_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_MAX_NV_BUFFER, &nv_data);
+    return rc;
+}
+
+static TSS2_RC
+nv_write_prepare(void)
+{
+    return Tss2_Sys_NV_Write_Prepare(sys, 0x01000000, 0x01000000, &nv_data,
+                                     0);
+}
+
+static TSS2_RC
+nv_write_call(void)
+{
+    return Tss2_Sys_NV_Write(sys, 0x01000000, 0x01000000, &cmd_auths,
+                             &nv_data, 0, &rsp_auths);
+}
+
+static TSS2_RC
+nv_readpublic_prepare(void)
+{
+    return Tss2_Sys_NV_ReadPublic_Prepare(sys, 0x01000000);
+}
+
+static TSS2_RC
+nv_readpublic_call(void)
+{
+    out_nv_public.size = 0;
+    return Tss2_Sys_NV_ReadPublic(sys, 0x01000000, NULL, &out_nv_public,
+                                  &out_name, NULL);
+}
+
+static TSS2_RC
+nv_readpublic_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_NV_PUBLIC, &bench_nv_public);
+    MARSHAL(TPM2B_NAME, &name);
+    return rc;
+}
+
+static TSS2_RC
+quote_prepare(void)
+{
+    return Tss2_Sys_Quote_Prepare(sys, 0x80000001, &no_data, &null_scheme,
+                                  &bench_pcr_selection);
+}
+
+static TSS2_RC
+quote_call(void)
+{
+    return Tss2_Sys_Quote(sys, 0x80000001, &cmd_auths, &no_data,
+                          &null_scheme, &bench_pcr_selection, &out_quoted,
+                          &out_signature, &rsp_auths);
+}
+
+static TSS2_RC
+quote_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_ATTEST, &quoted);
+    MARSHAL(TPMT_SIGNATURE, &bench_rsa_signature);
+    return rc;
+}
+
+static TSS2_RC
+hash_prepare(void)
+{
+    return Tss2_Sys_Hash_Prepare(sys, &hash_data, TPM2_ALG_SHA256,
+                                 TPM2_RH_OWNER);
+}
+
+static TSS2_RC
+hash_call(void)
+{
+    return Tss2_Sys_Hash(sys, NULL, &hash_data, TPM2_ALG_SHA256,
+                         TPM2_RH_OWNER, &out_digest, &out_hash_ticket, NULL);
+}
+
+static TSS2_RC
+hash_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPM2B_DIGEST, &digest);
+    MARSHAL(TPMT_TK_HASHCHECK, &null_ticket);
+    return rc;
+}
+
+static TSS2_RC
+contextsave_prepare(void)
+{
+    return Tss2_Sys_ContextSave_Prepare(sys, 0x80000001);
+}
+
+static TSS2_RC
+contextsave_call(void)
+{
+    return Tss2_Sys_ContextSave(sys, 0x80000001, &out_context);
+}
+
+static TSS2_RC
+contextsave_response(uint8_t *buffer, size_t size, size_t *offset)
+{
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    MARSHAL(TPMS_CONTEXT, &bench_context);
+    return rc;
+}
+
+static TSS2_RC
+contextload_prepare(void)
+{
+    return Tss2_Sys_ContextLoad_Prepare(sys, &bench_context);
+}
+
+static TSS2_RC
+contextload_call(void)
+{
+    return Tss2_Sys_ContextLoad(sys, &bench_context, &out_handle);
+}
+
+static TSS2_RC
+evictcontrol_prepare(void)
+{
+    return Tss2_Sys_EvictControl_Prepare(sys, TPM2_RH_OWNER, 0x80000001,
+                                         0x81000001);
+}
+
+static TSS2_RC
+evictcontrol_call(void)
+{
+    return Tss2_Sys_EvictControl(sys, TPM2_RH_OWNER, 0x80000001, &cmd_auths,
+                                 0x81000001, &rsp_auths);
+}
+
+static const BENCH_COMMAND commands[] = {
+    { "GetCapability", getcapability_prepare, getcapability_call,
+      getcapability_response, 0, 0 },
+    { "GetRandom", getrandom_prepare, getrandom_call, getrandom_response,
+      0, 0 },
+    { "PCR_Read", pcr_read_prepare, pcr_read_call, pcr_read_response, 0, 0 },
+    { "PCR_Extend", pcr_extend_prepare, pcr_extend_call, NULL, 0, 1 },
+    { "CreatePrimary", createprimary_prepare, createprimary_call,
+      createprimary_response, 0x80000000, 1 },
+    { "Create", create_prepare, create_call, create_response, 0, 1 },
+    { "Load", load_prepare, load_call, name_response, 0x80000001, 1 },
+    { "Sign", sign_prepare, sign_call, signature_response, 0, 1 },
+    { "VerifySignature", verifysignature_prepare, verifysignature_call,
+      verifysignature_response, 0, 0 },
+    { "ReadPublic", readpublic_prepare, readpublic_call, readpublic_response,
+      0, 0 },
+    { "FlushContext", flushcontext_prepare, flushcontext_call, NULL, 0, 0 },
+    { "StartAuthSession", startauthsession_prepare, startauthsession_call,
+      startauthsession_response, 0x02000000, 0 },
+    { "NV_Read", nv_read_prepare, nv_read_call, nv_read_response, 0, 1 },
+    { "NV_Write", nv_write_prepare, nv_write_call, NULL, 0, 1 },
+    { "NV_ReadPublic", nv_readpublic_prepare, nv_readpublic_call,
+      nv_readpublic_response, 0, 0 },
+    { "Quote", quote_prepare, quote_call, quote_response, 0, 1 },
+    { "Hash", hash_prepare, hash_call, hash_response, 0, 0 },
+    { "ContextSave", contextsave_prepare, contextsave_call,
+      contextsave_response, 0, 0 },
+    { "ContextLoad", contextload_prepare, contextload_call, NULL,
+      0x80000002, 0 },
+    { "EvictControl", evictcontrol_prepare, evictcontrol_call, NULL, 0, 1 },
+};
+
+static int
+bench_command(const BENCH_COMMAND *command)
+{
+    uint8_t params[TCTI_CANNED_BUFFER_SIZE];
+    size_t params_size = 0;
+    char label[64];
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    if (command->response != NULL)
+        rc = command->response(params, sizeof(params), &params_size);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = tcti_canned_set_response(command->handle, params, params_size,
+                                      command->auths);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "%s: building the response failed: 0x%" PRIx32 "\n",
+                command->name, rc);
+        return 1;
+    }
+
+    snprintf(label, sizeof(label), "%s prepare", command->name);
+    BENCH_RUN(label, ITERATIONS, rc = command->prepare());
+
+    snprintf(label, sizeof(label), "%s prepare+complete", command->name);
+    BENCH_RUN(label, ITERATIONS, rc = command->call());
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t i, size, offset = 0;
+    TSS2_RC rc;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&bench_quote, &quoted.attestationData[0],
+                                     sizeof(quoted.attestationData), &offset);
+    if (rc != TSS2_RC_SUCCESS)
+        return EXIT_FAILURE;
+    quoted.size = (UINT16) offset;
+    for (i = 0; i < properties.data.tpmProperties.count; i++)
+        properties.data.tpmProperties.tpmProperty[i].property =
+            TPM2_PT_FIXED + (TPM2_PT) i;
+
+    size = Tss2_Sys_GetContextSize(0);
+    sys = calloc(1, size);
+    if (sys == NULL)
+        return EXIT_FAILURE;
+    tcti = tcti_canned_init(NULL);
+    rc = Tss2_Sys_Initialize(sys, size, tcti, &abi_version);
+    if (rc != TSS2_RC_SUCCESS) {
+        free(sys);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < sizeof(commands) / sizeof(commands[0]) && ret == 0; i++)
+        ret = bench_command(&commands[i]);
+
+    Tss2_Sys_Finalize(sys);
+    free(sys);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
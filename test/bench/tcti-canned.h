@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef TCTI_CANNED_H
+#define TCTI_CANNED_H
+
+#include <string.h>
+
+#include "tss2_mu.h"
+#include "tss2_tcti.h"
+
+#include "bench.h"
+
+/*
+ * An in-process TCTI answering every command with a response prepared by the
+ * benchmark, either a fixed one set with tcti_canned_set_response() or
+ * tcti_canned_set_error(), or one computed from the command by a callback.
+ * The time spent in the callback is excluded from the times of BENCH_RUN,
+ * so that only the cost of the client is reported.
+ */
+#define TCTI_CANNED_MAGIC 0x43414e4e45440000ULL      /* 'CANNED\0\0' */
+#define TCTI_CANNED_VERSION 0x1
+#define TCTI_CANNED_BUFFER_SIZE 4096
+
+/* Compute the response to a command; returns its size or 0 on error. */
+typedef size_t (*TCTI_CANNED_RESPOND)(const uint8_t *command,
+                                      size_t command_size, uint8_t *response,
+                                      size_t response_size);
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_COMMON_V1 common;
+    TCTI_CANNED_RESPOND respond;
+    uint8_t response[TCTI_CANNED_BUFFER_SIZE];
+    size_t response_size;
+} TCTI_CANNED;
+
+static TCTI_CANNED tcti_canned;
+
+static inline TSS2_RC
+tcti_canned_transmit(TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+                     const uint8_t *command)
+{
+    uint64_t start;
+
+    (void)tctiContext;
+
+    if (tcti_canned.respond != NULL) {
+        start = bench_now_ns();
+        tcti_canned.response_size =
+            tcti_canned.respond(command, size, &tcti_canned.response[0],
+                                sizeof(tcti_canned.response));
+        bench_excluded_ns += bench_now_ns() - start;
+        if (tcti_canned.response_size == 0)
+            return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static inline TSS2_RC
+tcti_canned_receive(TSS2_TCTI_CONTEXT *tctiContext, size_t *size,
+                    uint8_t *response, int32_t timeout)
+{
+    (void)tctiContext;
+    (void)timeout;
+
+    if (response != NULL) {
+        if (*size < tcti_canned.response_size)
+            return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+        memcpy(response, &tcti_canned.response[0], tcti_canned.response_size);
+    }
+    *size = tcti_canned.response_size;
+    return TSS2_RC_SUCCESS;
+}
+
+static inline TSS2_TCTI_CONTEXT *
+tcti_canned_init(TCTI_CANNED_RESPOND respond)
+{
+    TSS2_TCTI_MAGIC(&tcti_canned) = TCTI_CANNED_MAGIC;
+    TSS2_TCTI_VERSION(&tcti_canned) = TCTI_CANNED_VERSION;
+    TSS2_TCTI_TRANSMIT(&tcti_canned) = tcti_canned_transmit;
+    TSS2_TCTI_RECEIVE(&tcti_canned) = tcti_canned_receive;
+    tcti_canned.respond = respond;
+    return (TSS2_TCTI_CONTEXT *) &tcti_canned;
+}
+
+/*
+ * Set the response of all following commands: a successful response with
+ * the handle, if it is not 0, and the marshalled response parameters. With
+ * 'auths' > 0 it carries that many password session response areas.
+ */
+static inline TSS2_RC
+tcti_canned_set_response(TPM2_HANDLE handle, const uint8_t *params,
+                         size_t params_size, int auths)
+{
+    uint8_t *buffer = &tcti_canned.response[0];
+    size_t size = sizeof(tcti_canned.response), offset = 10;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    int i;
+
+    if (handle != 0)
+        rc = Tss2_MU_TPM2_HANDLE_Marshal(handle, buffer, size, &offset);
+    if (rc == TSS2_RC_SUCCESS && auths > 0)
+        rc = Tss2_MU_UINT32_Marshal((UINT32) params_size, buffer, size,
+                                    &offset);
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+    if (params_size > size - offset)
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    memcpy(&buffer[offset], params, params_size);
+    offset += params_size;
+    for (i = 0; i < auths && rc == TSS2_RC_SUCCESS; i++) {
+        /* Empty nonce and HMAC, continueSession. */
+        rc = Tss2_MU_UINT16_Marshal(0, buffer, size, &offset);
+        if (rc == TSS2_RC_SUCCESS)
+            rc = Tss2_MU_UINT8_Marshal(TPMA_SESSION_CONTINUESESSION, buffer,
+                                       size, &offset);
+        if (rc == TSS2_RC_SUCCESS)
+            rc = Tss2_MU_UINT16_Marshal(0, buffer, size, &offset);
+    }
+    if (rc != TSS2_RC_SUCCESS)
+        return rc;
+
+    tcti_canned.response_size = offset;
+    offset = 0;
+    rc = Tss2_MU_TPM2_ST_Marshal(auths > 0 ? TPM2_ST_SESSIONS :
+                                 TPM2_ST_NO_SESSIONS, buffer, size, &offset);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Tss2_MU_UINT32_Marshal((UINT32) tcti_canned.response_size,
+                                    buffer, size, &offset);
+    if (rc == TSS2_RC_SUCCESS)
+        rc = Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, buffer, size, &offset);
+    return rc;
+}
+
+/* Answer all following commands with the response code 'rc'. */
+static inline TSS2_RC
+tcti_canned_set_error(TSS2_RC rc)
+{
+    uint8_t *buffer = &tcti_canned.response[0];
+    size_t size = sizeof(tcti_canned.response), offset = 0;
+    TSS2_RC r;
+
+    r = Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, buffer, size, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(10, buffer, size, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        r = Tss2_MU_UINT32_Marshal(rc, buffer, size, &offset);
+    if (r == TSS2_RC_SUCCESS)
+        tcti_canned.response_size = offset;
+    return r;
+}
+
+#endif /* TCTI_CANNED_H */
@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+/*
+ * Convert the objects of a FAPI keystore between the JSON and the binary
+ * format. Objects which already have the requested format, and objects
+ * without a binary encoding, are left untouched.
+ *
+ * Usage: fapi_keystore_convert --binary|--json <keystore directory>...
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ftw.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+
+#include "fapi_int.h"
+#include "ifapi_helpers.h"
+#include "ifapi_keystore_binary.h"
+#include "ifapi_json_serialize.h"
+#include "ifapi_json_deserialize.h"
+#include "ifapi_macros.h"
+#define LOGMODULE test
+#include "util/log.h"
+#include "util/aux_util.h"
+
+static bool to_binary;
+static size_t converted, skipped, failed;
+
+static TSS2_RC
+read_file(const char *path, uint8_t **buffer, size_t *size)
+{
+    FILE *stream = fopen(path, "rb");
+    long length;
+
+    return_if_null(stream, "Open file.", TSS2_FAPI_RC_IO_ERROR);
+    if (fseek(stream, 0, SEEK_END) != 0 || (length = ftell(stream)) < 0 ||
+        fseek(stream, 0, SEEK_SET) != 0) {
+        fclose(stream);
+        return_error2(TSS2_FAPI_RC_IO_ERROR, "Size of %s.", path);
+    }
+    /* JSON objects are parsed as zero terminated string. */
+    *buffer = calloc(1, length + 1);
+    if (*buffer == NULL) {
+        fclose(stream);
+        return_error(TSS2_FAPI_RC_MEMORY, "Out of memory.");
+    }
+    if (fread(*buffer, 1, length, stream) != (size_t) length) {
+        fclose(stream);
+        SAFE_FREE(*buffer);
+        return_error2(TSS2_FAPI_RC_IO_ERROR, "Read %s.", path);
+    }
+    fclose(stream);
+    *size = length;
+    return TSS2_RC_SUCCESS;
+}
+
+/* The object is written next to the old one and renamed over it, so an
+   interrupted conversion never leaves a truncated object behind. */
+static TSS2_RC
+write_file(const char *path, const uint8_t *buffer, size_t size)
+{
+    TSS2_RC r;
+    char *tmp_path = NULL;
+    FILE *stream;
+
+    r = ifapi_asprintf(&tmp_path, "%s.tmp", path);
+    return_if_error(r, "Out of memory.");
+
+    stream = fopen(tmp_path, "wb");
+    goto_if_null2(stream, "Open %s.", r, TSS2_FAPI_RC_IO_ERROR, cleanup, tmp_path);
+
+    if (fwrite(buffer, 1, size, stream) != size) {
+        fclose(stream);
+        goto_error(r, TSS2_FAPI_RC_IO_ERROR, "Write %s.", cleanup, tmp_path);
+    }
+    if (fclose(stream) != 0 || rename(tmp_path, path) != 0) {
+        goto_error(r, TSS2_FAPI_RC_IO_ERROR, "Replace %s.", cleanup, path);
+    }
+
+cleanup:
+    if (r != TSS2_RC_SUCCESS)
+        remove(tmp_path);
+    SAFE_FREE(tmp_path);
+    return r;
+}
+
+static TSS2_RC
+convert_file(const char *path)
+{
+    TSS2_RC r;
+    IFAPI_OBJECT object = { 0 };
+    json_object *jso = NULL;
+    uint8_t *buffer = NULL, *out = NULL;
+    size_t size, out_size;
+    bool binary;
+
+    r = read_file(path, &buffer, &size);
+    return_if_error2(r, "Read %s.", path);
+
+    binary = ifapi_binary_object_p(buffer, size);
+    if (binary == to_binary) {
+        skipped++;
+        goto cleanup;
+    }
+
+    if (binary) {
+        r = ifapi_binary_IFAPI_OBJECT_deserialize(buffer, size, &object);
+        goto_if_error2(r, "Deserialize %s.", cleanup, path);
+
+        r = ifapi_json_IFAPI_OBJECT_serialize(&object, &jso);
+        goto_if_error2(r, "Serialize %s.", cleanup, path);
+
+        /* Same layout as written by the keystore. */
+        out = (uint8_t *) strdup(json_object_to_json_string_ext(jso,
+                                                                JSON_C_TO_STRING_PRETTY));
+        goto_if_null2(out, "Out of memory.", r, TSS2_FAPI_RC_MEMORY, cleanup);
+        out_size = strlen((char *) out);
+    } else {
+        jso = json_tokener_parse((char *) buffer);
+        goto_if_null2(jso, "%s is no JSON object.", r, TSS2_FAPI_RC_BAD_VALUE,
+                      cleanup, path);
+
+        r = ifapi_json_IFAPI_OBJECT_deserialize(jso, &object);
+        goto_if_error2(r, "Deserialize %s.", cleanup, path);
+
+        r = ifapi_binary_IFAPI_OBJECT_serialize(&object, &out, &out_size);
+        if (r == TSS2_FAPI_RC_NOT_IMPLEMENTED) {
+            skipped++;
+            r = TSS2_RC_SUCCESS;
+            goto cleanup;
+        }
+        goto_if_error2(r, "Serialize %s.", cleanup, path);
+    }
+
+    r = write_file(path, out, out_size);
+    goto_if_error2(r, "Write %s.", cleanup, path);
+    converted++;
+
+cleanup:
+    ifapi_cleanup_ifapi_object(&object);
+    if (jso)
+        json_object_put(jso);
+    SAFE_FREE(buffer);
+    SAFE_FREE(out);
+    return r;
+}
+
+static int
+convert_entry(const char *path, const struct stat *sb, int type, struct FTW *ftw)
+{
+    (void)sb;
+
+    if (type != FTW_F || strcmp(&path[ftw->base], IFAPI_OBJECT_FILE) != 0)
+        return 0;
+
+    if (convert_file(path) != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Could not convert %s\n", path);
+        failed++;
+    }
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int i;
+
+    if (argc < 3 ||
+        (strcmp(argv[1], "--binary") != 0 && strcmp(argv[1], "--json") != 0)) {
+        fprintf(stderr, "Usage: %s --binary|--json <keystore directory>...\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    to_binary = strcmp(argv[1], "--binary") == 0;
+
+    for (i = 2; i < argc; i++) {
+        if (nftw(argv[i], convert_entry, 16, FTW_PHYS) != 0) {
+            fprintf(stderr, "Could not walk %s\n", argv[i]);
+            failed++;
+        }
+    }
+
+    printf("%zu converted, %zu unchanged, %zu failed\n", converted, skipped,
+           failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ *******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE test
+#include "util/log.h"
+#include "util/aux_util.h"
+
+#define DATA_SIZE 3000
+
+/* The data handed out by read_data(). */
+typedef struct {
+    const uint8_t *buffer;
+    size_t size;
+    size_t offset;
+} READ_STATE;
+
+static TSS2_RC
+read_data(void *userdata, uint8_t *buffer, size_t size, size_t *bytes_read)
+{
+    READ_STATE *state = userdata;
+
+    if (size > state->size - state->offset)
+        size = state->size - state->offset;
+    memcpy(buffer, &state->buffer[state->offset], size);
+    state->offset += size;
+    *bytes_read = size;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Test the ESAPI helper Esys_SequenceHash.
+ *
+ * The digest and ticket of the helper are compared with the result of a
+ * sequence driven with the ESAPI commands.
+ *
+ * Tested ESAPI commands:
+ *  - Esys_HashSequenceStart() (M)
+ *  - Esys_SequenceComplete() (M)
+ *  - Esys_SequenceHash() (M)
+ *  - Esys_SequenceUpdate() (M)
+ *
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @retval EXIT_FAILURE
+ * @retval EXIT_SUCCESS
+ */
+
+int
+test_esys_sequence_hash(ESYS_CONTEXT * esys_context)
+{
+    TSS2_RC r;
+    uint8_t data[DATA_SIZE];
+    READ_STATE state = { .buffer = &data[0], .size = sizeof(data) };
+    TPM2B_AUTH auth = { .size = 0 };
+    TPM2B_MAX_BUFFER buffer;
+    ESYS_TR sequence = ESYS_TR_NONE;
+    TPM2B_DIGEST *result = NULL, *expected = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL, *expected_validation = NULL;
+    size_t i, offset;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t) i;
+
+    r = Esys_SequenceHash(esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          read_data, &state, &result, &validation);
+    goto_if_error(r, "Error: SequenceHash", error);
+
+    r = Esys_HashSequenceStart(esys_context,
+                               ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                               &auth, TPM2_ALG_SHA256, &sequence);
+    goto_if_error(r, "Error: HashSequenceStart", error);
+
+    for (offset = 0; sizeof(data) - offset > 1000; offset += 1000) {
+        buffer.size = 1000;
+        memcpy(&buffer.buffer[0], &data[offset], buffer.size);
+        r = Esys_SequenceUpdate(esys_context, sequence,
+                                ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE,
+                                &buffer);
+        goto_if_error(r, "Error: SequenceUpdate", error);
+    }
+    buffer.size = sizeof(data) - offset;
+    memcpy(&buffer.buffer[0], &data[offset], buffer.size);
+    r = Esys_SequenceComplete(esys_context, sequence,
+                              ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE,
+                              &buffer, ESYS_TR_RH_OWNER,
+                              &expected, &expected_validation);
+    goto_if_error(r, "Error: SequenceComplete", error);
+
+    if (result->size != expected->size ||
+        memcmp(&result->buffer[0], &expected->buffer[0], result->size) != 0) {
+        LOG_ERROR("Digest of Esys_SequenceHash differs.");
+        goto error;
+    }
+    if (validation->tag != TPM2_ST_HASHCHECK ||
+        validation->hierarchy != TPM2_RH_OWNER ||
+        validation->digest.size != expected_validation->digest.size) {
+        LOG_ERROR("Ticket of Esys_SequenceHash differs.");
+        goto error;
+    }
+
+    Esys_Free(result);
+    Esys_Free(validation);
+    Esys_Free(expected);
+    Esys_Free(expected_validation);
+    return EXIT_SUCCESS;
+
+ error:
+    Esys_Free(result);
+    Esys_Free(validation);
+    Esys_Free(expected);
+    Esys_Free(expected_validation);
+    return EXIT_FAILURE;
+}
+
+int
+test_invoke_esapi(ESYS_CONTEXT * esys_context) {
+    return test_esys_sequence_hash(esys_context);
+}
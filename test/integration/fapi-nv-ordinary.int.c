@@ -27,6 +27,30 @@
 
 static char *password;
 
+static uint8_t data_src[NV_SIZE];
+static size_t chunk_bytes;
+
+static TSS2_RC
+nv_chunk_callback(
+    char const *nvPath,
+    size_t offset,
+    uint8_t const *data,
+    size_t dataSize,
+    void *userData)
+{
+    (void)userData;
+
+    if (strcmp(nvPath, "/nv/Owner/myNV") != 0) {
+        return_error(TSS2_FAPI_RC_BAD_VALUE, "Unexpected path");
+    }
+    if (offset + dataSize > NV_SIZE ||
+        memcmp(&data_src[offset], data, dataSize) != 0) {
+        return_error(TSS2_FAPI_RC_BAD_VALUE, "Unexpected chunk");
+    }
+    chunk_bytes += dataSize;
+    return TSS2_RC_SUCCESS;
+}
+
 static TSS2_RC
 auth_callback(
     char const *objectPath,
@@ -77,6 +101,7 @@ action_callback(
  *  - Fapi_SetDescription()
  *  - Fapi_GetDescription()
  *  - Fapi_SetAuthCB()
+ *  - Fapi_SetNvChunkCB()
  *
  * Tested Policies:
  *  - PolicyAction
@@ -90,7 +115,6 @@ test_fapi_nv_ordinary(FAPI_CONTEXT *context)
 {
     TSS2_RC r;
     char *nvPathOrdinary = "/nv/Owner/myNV";
-    uint8_t data_src[NV_SIZE];
     uint8_t *data_dest = NULL;
     size_t dest_size = NV_SIZE;
     char *description1 = "nvDescription";
@@ -161,6 +185,11 @@ test_fapi_nv_ordinary(FAPI_CONTEXT *context)
     r = Fapi_CreateNv(context, nvPathOrdinary, "noda", NV_SIZE, "", "");
     goto_if_error(r, "Error Fapi_CreateNv", error);
 
+    /* Every written and read byte is passed to the chunk callback. */
+    r = Fapi_SetNvChunkCB(context, nv_chunk_callback, NULL);
+    goto_if_error(r, "Error Fapi_SetNvChunkCB", error);
+    chunk_bytes = 0;
+
     r = Fapi_NvWrite(context, nvPathOrdinary, &data_src[0], NV_SIZE);
     goto_if_error(r, "Error Fapi_NvWrite", error);
 
@@ -173,6 +202,14 @@ test_fapi_nv_ordinary(FAPI_CONTEXT *context)
         goto error;
     }
 
+    if (chunk_bytes != 2 * NV_SIZE) {
+        LOG_ERROR("Error: %zu bytes passed to the chunk callback.", chunk_bytes);
+        goto error;
+    }
+
+    r = Fapi_SetNvChunkCB(context, NULL, NULL);
+    goto_if_error(r, "Error Fapi_SetNvChunkCB", error);
+
     r = Fapi_Delete(context, nvPathOrdinary);
     goto_if_error(r, "Error Fapi_NV_Undefine", error);
     SAFE_FREE(data_dest);
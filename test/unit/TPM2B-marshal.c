@@ -425,6 +425,42 @@ tpm2b_public_rsa_unique_size_marshal_success(void **state) {
     assert_int_equal (ptr1->size, HOST_TO_BE_16(0x11a));
 }
 
+/*
+ * Size functions must agree with the number of bytes marshalled.
+ */
+static void
+tpm2b_size_matches_marshal(void **state) {
+    TPM2B_DIGEST dgst = {4, {0}};
+    TPM2B_PUBLIC pub2b = {0};
+    TPMT_PUBLIC *pub = &pub2b.publicArea;
+    uint8_t buffer[TSS2_MU_MAX_SIZE(TPM2B_PUBLIC)] = { 0 };
+    size_t offset = 0, size = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 6);
+
+    dgst.size = sizeof(dgst.buffer) + 1;
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_SIZE);
+
+    pub->type = TPM2_ALG_RSA;
+    pub->parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_AES;
+    pub->parameters.rsaDetail.symmetric.keyBits.aes = 128;
+    pub->parameters.rsaDetail.symmetric.mode.aes = TPM2_ALG_CBC;
+    pub->unique.rsa.size = 0x100;
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub2b, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPM2B_PUBLIC_Size(&pub2b, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+    assert_int_equal (size, 0x11a + 2);
+
+    rc = Tss2_MU_TPM2B_PUBLIC_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(tpm2b_marshal_success),
@@ -440,6 +476,7 @@ int main(void) {
         cmocka_unit_test(tpm2b_unmarshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test(tpm2b_public_rsa_marshal_success),
         cmocka_unit_test(tpm2b_public_rsa_unique_size_marshal_success),
+        cmocka_unit_test(tpm2b_size_matches_marshal),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
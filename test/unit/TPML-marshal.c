@@ -473,6 +473,180 @@ tpml_unmarshal_invalid_count(void **state)
     assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
 }
 
+/*
+ * Round trip of scalar lists of every length up to the maximum, at
+ * unaligned offsets, to cover both the vector kernels and the scalar tail.
+ */
+static void
+tpml_bulk_roundtrip(void **state)
+{
+    static TPML_HANDLE hndl, hndl_out;
+    static TPML_ALG alg, alg_out;
+    static uint8_t buffer[sizeof(hndl) + 3];
+    size_t offset, misalign, i;
+    UINT32 count;
+    TSS2_RC rc;
+
+    for (misalign = 0; misalign < 3; misalign++) {
+        for (count = 0; count <= TPM2_MAX_CAP_HANDLES; count++) {
+            hndl.count = count;
+            for (i = 0; i < count; i++)
+                hndl.handle[i] = 0x81000000 + (UINT32)i * 0x01020304;
+
+            offset = misalign;
+            rc = Tss2_MU_TPML_HANDLE_Marshal(&hndl, buffer, sizeof(buffer),
+                                             &offset);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (offset, misalign + 4 + count * 4);
+            for (i = 0; i < count; i++) {
+                uint8_t *p = &buffer[misalign + 4 + i * 4];
+                assert_int_equal (p[0], (uint8_t)(hndl.handle[i] >> 24));
+                assert_int_equal (p[1], (uint8_t)(hndl.handle[i] >> 16));
+                assert_int_equal (p[2], (uint8_t)(hndl.handle[i] >> 8));
+                assert_int_equal (p[3], (uint8_t)(hndl.handle[i]));
+            }
+
+            offset = misalign;
+            rc = Tss2_MU_TPML_HANDLE_Unmarshal(buffer, sizeof(buffer), &offset,
+                                               &hndl_out);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (offset, misalign + 4 + count * 4);
+            assert_int_equal (hndl_out.count, count);
+            assert_memory_equal (&hndl_out.handle[0], &hndl.handle[0],
+                                 count * sizeof(hndl.handle[0]));
+        }
+
+        for (count = 0; count <= TPM2_MAX_ALG_LIST_SIZE; count += 7) {
+            alg.count = count;
+            for (i = 0; i < count; i++)
+                alg.algorithms[i] = (TPM2_ALG_ID)(0x0102 * i + 1);
+
+            offset = misalign;
+            rc = Tss2_MU_TPML_ALG_Marshal(&alg, buffer, sizeof(buffer), &offset);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            for (i = 0; i < count; i++) {
+                uint8_t *p = &buffer[misalign + 4 + i * 2];
+                assert_int_equal (p[0], (uint8_t)(alg.algorithms[i] >> 8));
+                assert_int_equal (p[1], (uint8_t)(alg.algorithms[i]));
+            }
+
+            offset = misalign;
+            rc = Tss2_MU_TPML_ALG_Unmarshal(buffer, sizeof(buffer), &offset,
+                                            &alg_out);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (offset, misalign + 4 + count * 2);
+            assert_int_equal (alg_out.count, count);
+            assert_memory_equal (&alg_out.algorithms[0], &alg.algorithms[0],
+                                 count * sizeof(alg.algorithms[0]));
+        }
+    }
+}
+
+/*
+ * Lists of structures made of several words: tagged properties are packed
+ * on the wire like in memory, algorithm properties are not.
+ */
+static void
+tpml_property_roundtrip(void **state)
+{
+    static TPML_TAGGED_TPM_PROPERTY props, props_out;
+    static TPML_ALG_PROPERTY algs, algs_out;
+    static uint8_t buffer[sizeof(props) + sizeof(algs)];
+    size_t offset = 1;
+    UINT32 i;
+    TSS2_RC rc;
+
+    props.count = TPM2_MAX_TPM_PROPERTIES;
+    for (i = 0; i < props.count; i++) {
+        props.tpmProperty[i].property = TPM2_PT_FIXED + i;
+        props.tpmProperty[i].value = 0xa0b0c0d0 ^ i;
+    }
+    algs.count = TPM2_MAX_CAP_ALGS;
+    for (i = 0; i < algs.count; i++) {
+        algs.algProperties[i].alg = (TPM2_ALG_ID)i;
+        algs.algProperties[i].algProperties = 0x11223344 + i;
+    }
+
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Marshal(&props, buffer,
+                                                  sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 1 + 4 + props.count * 8);
+    assert_int_equal (buffer[1 + 4 + 8 + 7], 0xd0 ^ 1);
+
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Marshal(&algs, buffer, sizeof(buffer),
+                                           &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 1 + 4 + props.count * 8 + 4 + algs.count * 6);
+
+    offset = 1;
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Unmarshal(buffer, sizeof(buffer),
+                                                    &offset, &props_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (&props_out, &props, sizeof(props));
+
+    /* The algorithm list starts with its count, followed by 6 byte entries */
+    assert_int_equal (buffer[offset + 4 + 6 + 1], 1);
+    assert_int_equal (buffer[offset + 4 + 6 + 5], 0x45);
+
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Unmarshal(buffer, sizeof(buffer), &offset,
+                                             &algs_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (&algs_out, &algs, sizeof(algs));
+
+    /* Truncated list */
+    offset = 1;
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Unmarshal(buffer, 1 + 4 + 8 * 3,
+                                                    &offset, &props_out);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (offset, 1);
+}
+
+/*
+ * Size functions must agree with the number of bytes marshalled.
+ */
+static void
+tpml_size_matches_marshal(void **state)
+{
+    static TPML_ALG_PROPERTY props;
+    static TPML_PCR_SELECTION sel;
+    static TPML_DIGEST dgst;
+    static uint8_t buffer[TSS2_MU_MAX_SIZE(TPML_ALG_PROPERTY)];
+    size_t offset, size;
+    TSS2_RC rc;
+
+    props.count = TPM2_MAX_CAP_ALGS;
+    offset = 0;
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Marshal(&props, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Size(&props, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    sel.count = 2;
+    sel.pcrSelections[0].sizeofSelect = 3;
+    sel.pcrSelections[1].sizeofSelect = 4;
+    offset = 0;
+    rc = Tss2_MU_TPML_PCR_SELECTION_Marshal(&sel, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    dgst.count = 2;
+    dgst.digests[0].size = 20;
+    dgst.digests[1].size = 32;
+    offset = 0;
+    rc = Tss2_MU_TPML_DIGEST_Marshal(&dgst, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    dgst.count = TPM2_NUM_PCR_BANKS + 100;
+    rc = Tss2_MU_TPML_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpml_marshal_success),
@@ -487,6 +661,9 @@ int main(void) {
         cmocka_unit_test (tpml_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpml_unmarshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test (tpml_unmarshal_invalid_count),
+        cmocka_unit_test (tpml_bulk_roundtrip),
+        cmocka_unit_test (tpml_property_roundtrip),
+        cmocka_unit_test (tpml_size_matches_marshal),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -342,6 +342,76 @@ tpms_unmarshal_buffer_size_lt_data_nad_lt_offset(void **state)
     assert_int_equal (offset, sizeof(alg));
 }
 
+/*
+ * Size functions must agree with the number of bytes marshalled.
+ */
+static void
+tpms_size_matches_marshal(void **state)
+{
+    TPMS_CAPABILITY_DATA cap = {0};
+    TPMS_PCR_SELECTION sel = {0};
+    TPMS_CONTEXT ctx = {0};
+    TPMS_ATTEST attest = {0};
+    uint8_t buffer[TSS2_MU_MAX_SIZE(TPMS_CAPABILITY_DATA)] = { 0 };
+    size_t offset, size;
+    TSS2_RC rc;
+
+    cap.capability = TPM2_CAP_ECC_CURVES;
+    cap.data.eccCurves.count = 3;
+    offset = 0;
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&cap, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Size(&cap, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    sel.hash = TPM2_ALG_SHA256;
+    sel.sizeofSelect = 3;
+    offset = 0;
+    rc = Tss2_MU_TPMS_PCR_SELECTION_Marshal(&sel, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMS_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+    assert_int_equal (size, 6);
+
+    sel.sizeofSelect = sizeof(sel.pcrSelect) + 1;
+    rc = Tss2_MU_TPMS_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+
+    ctx.contextBlob.size = 100;
+    offset = 0;
+    rc = Tss2_MU_TPMS_CONTEXT_Marshal(&ctx, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMS_CONTEXT_Size(&ctx, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    attest.magic = TPM2_GENERATED_VALUE;
+    attest.type = TPM2_ST_ATTEST_QUOTE;
+    attest.qualifiedSigner.size = 34;
+    attest.extraData.size = 16;
+    attest.attested.quote.pcrSelect.count = 2;
+    attest.attested.quote.pcrSelect.pcrSelections[0].sizeofSelect = 3;
+    attest.attested.quote.pcrSelect.pcrSelections[1].sizeofSelect = 4;
+    attest.attested.quote.pcrDigest.size = 32;
+    offset = 0;
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMS_ATTEST_Size(&attest, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    attest.attested.quote.pcrSelect.count = TPM2_NUM_PCR_BANKS + 1;
+    rc = Tss2_MU_TPMS_ATTEST_Size(&attest, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+
+    rc = Tss2_MU_TPMS_CONTEXT_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+    rc = Tss2_MU_TPMS_CONTEXT_Size(&ctx, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpms_marshal_success),
@@ -354,6 +424,7 @@ int main(void) {
         cmocka_unit_test (tpms_unmarshal_buffer_null_offset_null),
         cmocka_unit_test (tpms_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpms_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test (tpms_size_matches_marshal),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -386,6 +386,75 @@ tpmt_unmarshal_buffer_size_lt_data_nad_lt_offset(void **state)
     assert_int_equal (offset, 5);
 }
 
+/*
+ * Size functions must agree with the number of bytes marshalled, for every
+ * member a selector can pick.
+ */
+static void
+tpmt_size_matches_marshal(void **state)
+{
+    TPMT_PUBLIC pub = {0};
+    TPMT_SIGNATURE sig = {0};
+    TPMT_SYM_DEF_OBJECT sym = {0};
+    TPMT_HA ha = {0};
+    uint8_t buffer[sizeof(TPMT_PUBLIC)] = { 0 };
+    size_t offset, size;
+    TSS2_RC rc;
+
+    pub.type = TPM2_ALG_ECC;
+    pub.nameAlg = TPM2_ALG_SHA256;
+    pub.authPolicy.size = 32;
+    pub.parameters.eccDetail.symmetric.algorithm = TPM2_ALG_AES;
+    pub.parameters.eccDetail.symmetric.keyBits.aes = 128;
+    pub.parameters.eccDetail.symmetric.mode.aes = TPM2_ALG_CFB;
+    pub.parameters.eccDetail.scheme.scheme = TPM2_ALG_ECDAA;
+    pub.parameters.eccDetail.kdf.scheme = TPM2_ALG_NULL;
+    pub.unique.ecc.x.size = 32;
+    pub.unique.ecc.y.size = 32;
+    offset = 0;
+    rc = Tss2_MU_TPMT_PUBLIC_Marshal(&pub, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMT_PUBLIC_Size(&pub, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    pub.type = TPM2_ALG_KEYEDHASH;
+    pub.parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_XOR;
+    pub.unique.keyedHash.size = 20;
+    offset = 0;
+    rc = Tss2_MU_TPMT_PUBLIC_Marshal(&pub, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMT_PUBLIC_Size(&pub, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    sig.sigAlg = TPM2_ALG_HMAC;
+    sig.signature.hmac.hashAlg = TPM2_ALG_SHA384;
+    offset = 0;
+    rc = Tss2_MU_TPMT_SIGNATURE_Marshal(&sig, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMT_SIGNATURE_Size(&sig, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+    assert_int_equal (size, 2 + 2 + TPM2_SHA384_DIGEST_SIZE);
+
+    /* TPM2_ALG_NULL selects neither key bits nor mode. */
+    sym.algorithm = TPM2_ALG_NULL;
+    rc = Tss2_MU_TPMT_SYM_DEF_OBJECT_Size(&sym, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2);
+
+    ha.hashAlg = TPM2_ALG_SHA1;
+    rc = Tss2_MU_TPMT_HA_Size(&ha, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + TPM2_SHA1_DIGEST_SIZE);
+
+    rc = Tss2_MU_TPMT_HA_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+    rc = Tss2_MU_TPMT_HA_Size(&ha, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpmt_marshal_success),
@@ -398,6 +467,7 @@ int main(void) {
         cmocka_unit_test (tpmt_unmarshal_buffer_null_offset_null),
         cmocka_unit_test (tpmt_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpmt_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test (tpmt_size_matches_marshal),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * Tests that SAPI passes every parameter to the cp callback while it is
+ * marshalled, and that the cpHashes ESAPI computes from these calls match
+ * the ones computed from the command buffer.
+ */
+
+#define TCTI_FAKE_MAGIC 0x46414b4500000000ULL        /* 'FAKE\0' */
+#define TCTI_FAKE_VERSION 0x1
+
+typedef TSS2_TCTI_CONTEXT_COMMON_V1 TSS2_TCTI_CONTEXT_FAKE;
+
+static void
+tcti_fake_finalize(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static TSS2_TCTI_CONTEXT_FAKE faketcti;
+
+/* The calls of the cp callback recorded by record_cp(). */
+static struct {
+    TPM2_CC commandCode;
+    size_t offset;
+    size_t size;
+} cp_calls[8];
+static size_t n_cp_calls;
+
+static TSS2_RC
+record_cp(TPM2_CC commandCode, size_t offset, const uint8_t *data, size_t size,
+          void *userData)
+{
+    TSS2_RC *rc = userData;
+
+    assert_true(n_cp_calls < sizeof(cp_calls) / sizeof(cp_calls[0]));
+    assert_true(size == 0 || data != NULL);
+    cp_calls[n_cp_calls].commandCode = commandCode;
+    cp_calls[n_cp_calls].offset = offset;
+    cp_calls[n_cp_calls].size = size;
+    n_cp_calls += 1;
+    return *rc;
+}
+
+static int
+esys_unit_setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+
+    TSS2_TCTI_MAGIC(&faketcti) = TCTI_FAKE_MAGIC;
+    TSS2_TCTI_VERSION(&faketcti) = TCTI_FAKE_VERSION;
+    TSS2_TCTI_TRANSMIT(&faketcti) = (void*)1;
+    TSS2_TCTI_RECEIVE(&faketcti) = (void*)1;
+    TSS2_TCTI_FINALIZE(&faketcti) = tcti_fake_finalize;
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    *state = (void *)ectx;
+    n_cp_calls = 0;
+    return 0;
+}
+
+static int
+esys_unit_teardown(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) *state;
+    Esys_Finalize(&ectx);
+    return 0;
+}
+
+static ESYS_TR
+create_session(ESYS_CONTEXT *ectx, TPMI_ALG_HASH authHash,
+               TPMA_SESSION attributes)
+{
+    RSRC_NODE_T *node;
+    ESYS_TR handle = ectx->esys_handle_cnt++;
+    TSS2_RC r;
+
+    r = esys_CreateResourceObject(ectx, handle, &node);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    node->rsrc.handle = TPM2_HMAC_SESSION_FIRST;
+    node->rsrc.rsrcType = IESYSC_SESSION_RSRC;
+    node->rsrc.misc.rsrc_session.authHash = authHash;
+    node->rsrc.misc.rsrc_session.sessionAttributes = attributes;
+    return handle;
+}
+
+static RSRC_NODE_T *
+create_nv_index(ESYS_CONTEXT *ectx)
+{
+    RSRC_NODE_T *nv;
+    TSS2_RC r;
+
+    r = esys_CreateResourceObject(ectx, ectx->esys_handle_cnt++, &nv);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    nv->rsrc.handle = TPM2_NV_INDEX_FIRST;
+    nv->rsrc.name.size = 4;
+    memcpy(&nv->rsrc.name.name[0], "\x01\x00\x00\x00", 4);
+    return nv;
+}
+
+/* Prepare a TPM2_NV_Write of a full buffer as Esys_NV_Write_Async does. */
+static void
+prepare_nv_write(ESYS_CONTEXT *ectx, RSRC_NODE_T *nv, ESYS_TR s1, ESYS_TR s2)
+{
+    TPM2B_MAX_NV_BUFFER data = { .size = sizeof(data.buffer) };
+    TSS2_RC r;
+
+    memset(&data.buffer[0], 0xa5, data.size);
+
+    r = iesys_check_sequence_async(ectx);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = init_session_tab(ectx, s1, s2, ESYS_TR_NONE);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    iesys_begin_cp_stream(ectx, nv, nv, NULL);
+    r = Tss2_Sys_NV_Write_Prepare(ectx->sys, nv->rsrc.handle, nv->rsrc.handle,
+                                  &data, 0);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static void
+test_cp_callback_per_parameter(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) *state;
+    TPM2B_MAX_NV_BUFFER data = { .size = 100 };
+    TSS2_RC cb_rc = TSS2_RC_SUCCESS;
+    TSS2_RC r;
+
+    r = Tss2_Sys_SetCpCallback(ectx->sys, record_cp, &cb_rc);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The data and the offset are passed one after the other. */
+    r = Tss2_Sys_NV_Write_Prepare(ectx->sys, TPM2_RH_OWNER,
+                                  TPM2_NV_INDEX_FIRST, &data, 7);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(n_cp_calls, 2);
+    assert_int_equal(cp_calls[0].commandCode, TPM2_CC_NV_Write);
+    assert_int_equal(cp_calls[0].offset, 0);
+    assert_int_equal(cp_calls[0].size, 2 + 100);
+    assert_int_equal(cp_calls[1].offset, 2 + 100);
+    assert_int_equal(cp_calls[1].size, 2);
+
+    /* A command without parameters is passed with a size of 0. */
+    n_cp_calls = 0;
+    r = Tss2_Sys_Clear_Prepare(ectx->sys, TPM2_RH_PLATFORM);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(n_cp_calls, 1);
+    assert_int_equal(cp_calls[0].commandCode, TPM2_CC_Clear);
+    assert_int_equal(cp_calls[0].offset, 0);
+    assert_int_equal(cp_calls[0].size, 0);
+
+    /* An error of the callback stops further calls and fails the prepare. */
+    n_cp_calls = 0;
+    cb_rc = TSS2_SYS_RC_GENERAL_FAILURE;
+    r = Tss2_Sys_NV_Write_Prepare(ectx->sys, TPM2_RH_OWNER,
+                                  TPM2_NV_INDEX_FIRST, &data, 7);
+    assert_int_equal(r, TSS2_SYS_RC_GENERAL_FAILURE);
+    assert_int_equal(n_cp_calls, 1);
+
+    r = Tss2_Sys_SetCpCallback(ectx->sys, NULL, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    n_cp_calls = 0;
+    r = Tss2_Sys_NV_Write_Prepare(ectx->sys, TPM2_RH_OWNER,
+                                  TPM2_NV_INDEX_FIRST, &data, 7);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(n_cp_calls, 0);
+}
+
+static void
+test_cp_stream_matches(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) *state;
+    HASH_TAB_ITEM streamed[3];
+    uint8_t streamed_num = 0, ccBuffer[4];
+    const uint8_t *cpBuffer;
+    size_t cpBuffer_size;
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t digest_size;
+    RSRC_NODE_T *nv;
+    TSS2_RC r;
+
+    nv = create_nv_index(ectx);
+    prepare_nv_write(ectx, nv,
+                     create_session(ectx, TPM2_ALG_SHA256, 0),
+                     create_session(ectx, TPM2_ALG_SHA1, 0));
+
+    /* The whole parameter area went through the hash contexts. */
+    r = Tss2_Sys_GetCpBuffer(ectx->sys, &cpBuffer_size, &cpBuffer);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_true(ectx->cp_stream.armed);
+    assert_int_equal(ectx->cp_stream.num, 2);
+    assert_int_equal(ectx->cp_stream.size, cpBuffer_size);
+
+    r = iesys_compute_cp_hashtab(ectx, &nv->rsrc.name, &nv->rsrc.name, NULL,
+                                 &streamed[0], &streamed_num);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_false(ectx->cp_stream.armed);
+    assert_int_equal(ectx->cp_stream.num, 0);
+
+    r = Tss2_Sys_GetCommandCode(ectx->sys, &ccBuffer[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(streamed_num, 2);
+    assert_int_equal(streamed[0].alg, TPM2_ALG_SHA256);
+    assert_int_equal(streamed[1].alg, TPM2_ALG_SHA1);
+    for (int i = 0; i < 2; i++) {
+        digest_size = sizeof(digest);
+        r = iesys_crypto_cpHash(streamed[i].alg, ccBuffer, &nv->rsrc.name,
+                                &nv->rsrc.name, NULL, cpBuffer, cpBuffer_size,
+                                &digest[0], &digest_size);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(streamed[i].size, digest_size);
+        assert_memory_equal(&streamed[i].digest[0], &digest[0], digest_size);
+    }
+}
+
+static void
+test_cp_stream_not_armed(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) *state;
+    HASH_TAB_ITEM computed[3];
+    uint8_t computed_num = 0;
+    RSRC_NODE_T *nv;
+    TSS2_RC r;
+
+    nv = create_nv_index(ectx);
+
+    /* The parameter is encrypted after the prepare, nothing is streamed. */
+    prepare_nv_write(ectx, nv,
+                     create_session(ectx, TPM2_ALG_SHA256, TPMA_SESSION_DECRYPT),
+                     ESYS_TR_NONE);
+    assert_false(ectx->cp_stream.armed);
+    assert_int_equal(ectx->cp_stream.num, 0);
+
+    /* The cpHash is then computed from the command buffer. */
+    r = iesys_compute_cp_hashtab(ectx, &nv->rsrc.name, &nv->rsrc.name, NULL,
+                                 &computed[0], &computed_num);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(computed_num, 1);
+
+    /* Without sessions there is nothing to hash. */
+    prepare_nv_write(ectx, nv, ESYS_TR_NONE, ESYS_TR_NONE);
+    assert_false(ectx->cp_stream.armed);
+
+    /* A stream left by a failed command is released by the next one. */
+    prepare_nv_write(ectx, nv, create_session(ectx, TPM2_ALG_SHA256, 0),
+                     ESYS_TR_NONE);
+    assert_int_equal(ectx->cp_stream.num, 1);
+    r = iesys_check_sequence_async(ectx);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_false(ectx->cp_stream.armed);
+    assert_int_equal(ectx->cp_stream.num, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_cp_callback_per_parameter,
+                                        esys_unit_setup, esys_unit_teardown),
+        cmocka_unit_test_setup_teardown(test_cp_stream_matches,
+                                        esys_unit_setup, esys_unit_teardown),
+        cmocka_unit_test_setup_teardown(test_cp_stream_not_armed,
+                                        esys_unit_setup, esys_unit_teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
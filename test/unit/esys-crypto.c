@@ -81,6 +81,55 @@ check_hash_functions(void **state)
     iesys_crypto_hmac_abort(&context);
 }
 
+/* Compare iesys_crypto_hash_batch() with hashing every message separately.
+ * The message lengths vary around the padding boundaries, so the lanes of
+ * the multi-buffer kernel finish at different times and are refilled. */
+static void
+check_hash_batch(void **state)
+{
+    TSS2_RC rc;
+    IESYS_CRYPTO_CONTEXT_BLOB *context;
+    static const size_t lengths[] = { 0, 1, 55, 56, 63, 64, 65, 119, 120, 200 };
+    static const TPM2_ALG_ID algs[] = {
+        TPM2_ALG_SHA1, TPM2_ALG_SHA256, TPM2_ALG_SHA384
+    };
+    IESYS_CRYPTO_MB_JOB jobs[21];
+    uint8_t message[256 + 21];
+    uint8_t digests[21][sizeof(TPMU_HA)];
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t a, i, size;
+
+    for (i = 0; i < sizeof(message); i++)
+        message[i] = (uint8_t) (i * 7 + 3);
+
+    rc = iesys_crypto_hash_batch(TPM2_ALG_SHA256, NULL, 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    rc = iesys_crypto_hash_batch(0, &jobs[0], 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    for (a = 0; a < sizeof(algs) / sizeof(algs[0]); a++) {
+        for (i = 0; i < 21; i++) {
+            jobs[i].buffer = &message[i];
+            jobs[i].size = lengths[(i * 3) % 10];
+            jobs[i].digest = &digests[i][0];
+        }
+        rc = iesys_crypto_hash_batch(algs[a], &jobs[0], 21);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+        for (i = 0; i < 21; i++) {
+            rc = iesys_crypto_hash_start(&context, algs[a]);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            rc = iesys_crypto_hash_update(context, jobs[i].buffer, jobs[i].size);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            size = sizeof(digest);
+            rc = iesys_crypto_hash_finish(&context, &digest[0], &size);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_memory_equal(&digest[0], &digests[i][0], size);
+        }
+    }
+}
+
 static void
 check_hmac_functions(void **state)
 {
@@ -241,6 +290,53 @@ check_aes_encrypt(void **state)
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 }
 
+static void
+check_aes_cfb_context(void **state)
+{
+    TSS2_RC rc;
+    uint8_t key[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                       1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16  };
+    uint8_t iv[16] = { 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+    uint8_t plain[37] = { 1, 2, 3, 4, 5 };
+    uint8_t expected[sizeof(plain)];
+    uint8_t buffer[sizeof(plain)];
+    IESYS_CRYPTO_SYM_CONTEXT_BLOB *context = NULL;
+    TPMI_AES_KEY_BITS key_bits[] = { 128, 256, 192, 192 };
+
+    rc = iesys_crypto_sym_aes_cfb(NULL, true, &key[0], 128, &buffer[0],
+                                  sizeof(buffer), &iv[0]);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
+    rc = iesys_crypto_sym_aes_cfb(&context, true, &key[0], 999, &buffer[0],
+                                  sizeof(buffer), &iv[0]);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    /* A re-keyed context yields the same results as a new one. */
+    for (size_t i = 0; i < sizeof(key_bits) / sizeof(key_bits[0]); i++) {
+        key[0] = i;
+        memcpy(&expected[0], &plain[0], sizeof(plain));
+        rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, key_bits[i],
+                                          TPM2_ALG_CFB, 16, &expected[0],
+                                          sizeof(expected), &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+        memcpy(&buffer[0], &plain[0], sizeof(plain));
+        rc = iesys_crypto_sym_aes_cfb(&context, true, &key[0], key_bits[i],
+                                      &buffer[0], sizeof(buffer), &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_non_null(context);
+        assert_memory_equal(&buffer[0], &expected[0], sizeof(buffer));
+
+        rc = iesys_crypto_sym_aes_cfb(&context, false, &key[0], key_bits[i],
+                                      &buffer[0], sizeof(buffer), &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal(&buffer[0], &plain[0], sizeof(buffer));
+    }
+
+    iesys_crypto_sym_free(&context);
+    assert_null(context);
+    iesys_crypto_sym_free(&context);
+}
+
 static void
 check_free(void **state)
 {
@@ -280,10 +376,12 @@ main(int argc, char *argv[])
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(check_hash_functions),
+        cmocka_unit_test(check_hash_batch),
         cmocka_unit_test(check_hmac_functions),
         cmocka_unit_test(check_random),
         cmocka_unit_test(check_pk_encrypt),
         cmocka_unit_test(check_aes_encrypt),
+        cmocka_unit_test(check_aes_cfb_context),
         cmocka_unit_test(check_free),
         cmocka_unit_test(check_get_sys_context),
     };
@@ -0,0 +1,346 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * This unit test runs many ESYS contexts on one executor. Each context uses a
+ * TCTI whose poll handle is the read end of a pipe; transmitting a command
+ * writes a byte into the pipe, which makes the response available.
+ */
+
+#define TCTI_PIPE_MAGIC 0x5049504500000000ULL        /* 'PIPE\0' */
+#define TCTI_PIPE_VERSION 0x1
+
+#define CONTEXTS 200
+#define COMMANDS 3
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    int fds[2];
+    bool hold;      /* Do not answer transmitted commands. */
+} TSS2_TCTI_CONTEXT_PIPE;
+
+const uint8_t get_random_response[] = {
+    0x80, 0x01,                 /* TPM_ST_NO_SESSION */
+    0x00, 0x00, 0x00, 0x10,     /* Response Size 16 */
+    0x00, 0x00, 0x00, 0x00,     /* TPM_RC_SUCCESS */
+    0x00, 0x04,                 /* randomBytes.size */
+    0x01, 0x02, 0x03, 0x04      /* randomBytes.buffer */
+};
+
+static TSS2_RC
+tcti_pipe_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                   size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_PIPE *tcti = (TSS2_TCTI_CONTEXT_PIPE *) tctiContext;
+
+    if (!tcti->hold)
+        assert_int_equal(write(tcti->fds[1], "r", 1), 1);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_pipe_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                  size_t * response_size,
+                  uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_PIPE *tcti = (TSS2_TCTI_CONTEXT_PIPE *) tctiContext;
+    char c;
+
+    assert_int_equal(timeout, 0);
+    if (response_buffer != NULL) {
+        if (read(tcti->fds[0], &c, 1) != 1)
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        memcpy(response_buffer, &get_random_response[0],
+               sizeof(get_random_response));
+    }
+    *response_size = sizeof(get_random_response);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_pipe_getpollhandles(TSS2_TCTI_CONTEXT * tctiContext,
+                         TSS2_TCTI_POLL_HANDLE * handles,
+                         size_t * num_handles)
+{
+    TSS2_TCTI_CONTEXT_PIPE *tcti = (TSS2_TCTI_CONTEXT_PIPE *) tctiContext;
+
+    if (handles != NULL) {
+        handles[0].fd = tcti->fds[0];
+        handles[0].events = POLLIN;
+    }
+    *num_handles = 1;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_nohandles_getpollhandles(TSS2_TCTI_CONTEXT * tctiContext,
+                              TSS2_TCTI_POLL_HANDLE * handles,
+                              size_t * num_handles)
+{
+    *num_handles = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_pipe_initialize(TSS2_TCTI_CONTEXT_PIPE * tcti)
+{
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) tcti;
+
+    memset(tcti, 0, sizeof(*tcti));
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_PIPE_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_PIPE_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_pipe_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_pipe_receive;
+    TSS2_TCTI_FINALIZE(tctiContext) = NULL;
+    TSS2_TCTI_CANCEL(tctiContext) = NULL;
+    TSS2_TCTI_GET_POLL_HANDLES(tctiContext) = tcti_pipe_getpollhandles;
+    TSS2_TCTI_SET_LOCALITY(tctiContext) = NULL;
+    assert_int_equal(pipe(tcti->fds), 0);
+    assert_int_equal(fcntl(tcti->fds[0], F_SETFL, O_NONBLOCK), 0);
+}
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_PIPE tcti;
+    ESYS_CONTEXT *esys_context;
+    ESYS_EXECUTOR *executor;
+    TPM2B_DIGEST *random;
+    int completed;
+} CLIENT;
+
+static TSS2_RC
+finish_get_random(ESYS_CONTEXT *esys_context, void *userdata)
+{
+    CLIENT *client = userdata;
+
+    return Esys_GetRandom_Finish(esys_context, &client->random);
+}
+
+static void
+callback_get_random(ESYS_CONTEXT *esys_context, TSS2_RC rc, void *userdata)
+{
+    CLIENT *client = userdata;
+    TSS2_RC r;
+
+    assert_int_equal(rc, TSS2_RC_SUCCESS);
+    assert_int_equal(client->random->size, 4);
+    free(client->random);
+    client->random = NULL;
+
+    /* Chain the next command of the client. */
+    if (++client->completed == COMMANDS)
+        return;
+    r = Esys_GetRandom_Async(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                             ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Executor_Submit(client->executor, esys_context, finish_get_random,
+                             callback_get_random, client);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static CLIENT *
+clients_init(ESYS_EXECUTOR *executor, size_t count)
+{
+    CLIENT *clients = calloc(count, sizeof(CLIENT));
+    TSS2_RC r;
+
+    assert_non_null(clients);
+    for (size_t i = 0; i < count; i++) {
+        tcti_pipe_initialize(&clients[i].tcti);
+        r = Esys_Initialize(&clients[i].esys_context,
+                            (TSS2_TCTI_CONTEXT *) &clients[i].tcti, NULL);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        clients[i].executor = executor;
+    }
+    return clients;
+}
+
+static void
+clients_free(CLIENT *clients, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        Esys_Finalize(&clients[i].esys_context);
+        close(clients[i].tcti.fds[0]);
+        close(clients[i].tcti.fds[1]);
+        free(clients[i].random);
+    }
+    free(clients);
+}
+
+static void
+test_executor_many_contexts(void **state)
+{
+    ESYS_EXECUTOR *executor;
+    CLIENT *clients;
+    TSS2_RC r;
+
+    r = Esys_Executor_Initialize(&executor);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    clients = clients_init(executor, CONTEXTS);
+
+    for (size_t i = 0; i < CONTEXTS; i++) {
+        r = Esys_GetRandom_Async(clients[i].esys_context, ESYS_TR_NONE,
+                                 ESYS_TR_NONE, ESYS_TR_NONE, 4);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        r = Esys_Executor_Submit(executor, clients[i].esys_context,
+                                 finish_get_random, callback_get_random,
+                                 &clients[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+
+    r = Esys_Executor_Run(executor, -1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    for (size_t i = 0; i < CONTEXTS; i++)
+        assert_int_equal(clients[i].completed, COMMANDS);
+
+    /* Nothing is pending any more. */
+    r = Esys_Executor_Run(executor, 0);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    Esys_Executor_Finalize(&executor);
+    assert_null(executor);
+    clients_free(clients, CONTEXTS);
+}
+
+static void
+test_executor_timeout(void **state)
+{
+    ESYS_EXECUTOR *executor;
+    CLIENT *clients;
+    TSS2_RC r;
+
+    r = Esys_Executor_Initialize(&executor);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    clients = clients_init(executor, 1);
+
+    clients[0].tcti.hold = true;
+    r = Esys_GetRandom_Async(clients[0].esys_context, ESYS_TR_NONE,
+                             ESYS_TR_NONE, ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Executor_Submit(executor, clients[0].esys_context,
+                             finish_get_random, callback_get_random,
+                             &clients[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    r = Esys_Executor_Run(executor, 0);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+    r = Esys_Executor_Run(executor, 10);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+    assert_int_equal(clients[0].completed, 0);
+
+    /* Release the response; the next commands are answered right away. */
+    clients[0].tcti.hold = false;
+    assert_int_equal(write(clients[0].tcti.fds[1], "r", 1), 1);
+    r = Esys_Executor_Run(executor, 1000);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(clients[0].completed, COMMANDS);
+
+    Esys_Executor_Finalize(&executor);
+    clients_free(clients, 1);
+}
+
+static void
+test_executor_submit_errors(void **state)
+{
+    ESYS_EXECUTOR *executor;
+    CLIENT *clients;
+    TSS2_RC r;
+
+    r = Esys_Executor_Initialize(NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Executor_Initialize(&executor);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    clients = clients_init(executor, 1);
+
+    r = Esys_Executor_Submit(executor, clients[0].esys_context, NULL,
+                             callback_get_random, &clients[0]);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    /* No command was sent. */
+    r = Esys_Executor_Submit(executor, clients[0].esys_context,
+                             finish_get_random, callback_get_random,
+                             &clients[0]);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+
+    clients[0].tcti.hold = true;
+    r = Esys_GetRandom_Async(clients[0].esys_context, ESYS_TR_NONE,
+                             ESYS_TR_NONE, ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Executor_Submit(executor, clients[0].esys_context,
+                             finish_get_random, callback_get_random,
+                             &clients[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* An operation of the context is already pending. */
+    r = Esys_Executor_Submit(executor, clients[0].esys_context,
+                             finish_get_random, callback_get_random,
+                             &clients[0]);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+
+    /* Pending operations are dropped. */
+    Esys_Executor_Finalize(&executor);
+    clients_free(clients, 1);
+
+    r = Esys_Executor_Initialize(&executor);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    clients = clients_init(executor, 1);
+    clients[0].tcti.getPollHandles = tcti_nohandles_getpollhandles;
+    r = Esys_GetRandom_Async(clients[0].esys_context, ESYS_TR_NONE,
+                             ESYS_TR_NONE, ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Executor_Submit(executor, clients[0].esys_context,
+                             finish_get_random, callback_get_random,
+                             &clients[0]);
+    assert_int_equal(r, TSS2_ESYS_RC_NOT_IMPLEMENTED);
+
+    Esys_Executor_Finalize(&executor);
+    clients_free(clients, 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+#ifdef HAVE_SYS_EPOLL_H
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_executor_many_contexts),
+        cmocka_unit_test(test_executor_timeout),
+        cmocka_unit_test(test_executor_submit_errors),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+#else
+    /* The executor is only available with epoll. */
+    return 77;
+#endif
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * Tests the initialization of an ESYS_CONTEXT in caller provided storage.
+ */
+
+#define TCTI_FAKE_MAGIC 0x46414b4500000000ULL        /* 'FAKE\0' */
+#define TCTI_FAKE_VERSION 0x1
+
+typedef TSS2_TCTI_CONTEXT_COMMON_V1 TSS2_TCTI_CONTEXT_FAKE;
+
+static void
+tcti_fake_finalize(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    /* The TCTI is owned by the application and must not be finalized. */
+    fail();
+}
+
+static TSS2_TCTI_CONTEXT_FAKE faketcti;
+
+static int
+tcti_fake_setup(void **state)
+{
+    TSS2_TCTI_MAGIC(&faketcti) = TCTI_FAKE_MAGIC;
+    TSS2_TCTI_VERSION(&faketcti) = TCTI_FAKE_VERSION;
+    TSS2_TCTI_TRANSMIT(&faketcti) = (void*)1;
+    TSS2_TCTI_RECEIVE(&faketcti) = (void*)1;
+    TSS2_TCTI_FINALIZE(&faketcti) = tcti_fake_finalize;
+    return 0;
+}
+
+static void
+test_initialize_ex(void **state)
+{
+    size_t size = Esys_GetContextSize();
+    uint8_t *storage = malloc(size);
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_RC r;
+
+    assert_non_null(storage);
+
+    r = Esys_InitializeEx(&ectx, storage, size,
+                          (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_ptr_equal(ectx, storage);
+
+    r = Esys_GetTcti(ectx, &tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_ptr_equal(tcti, &faketcti);
+
+    /* The storage is not freed, so it can be reused right away. */
+    Esys_Finalize(&ectx);
+    assert_null(ectx);
+
+    r = Esys_InitializeEx(&ectx, storage, size,
+                          (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    Esys_Finalize(&ectx);
+
+    free(storage);
+}
+
+static void
+test_initialize_ex_bad_params(void **state)
+{
+    size_t size = Esys_GetContextSize();
+    uint8_t *storage = malloc(size);
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) storage;
+    TSS2_RC r;
+
+    assert_non_null(storage);
+
+    r = Esys_InitializeEx(NULL, storage, size,
+                          (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_InitializeEx(&ectx, NULL, size,
+                          (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_null(ectx);
+
+    r = Esys_InitializeEx(&ectx, storage, size, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_InitializeEx(&ectx, storage, size - 1,
+                          (TSS2_TCTI_CONTEXT *) &faketcti, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_INSUFFICIENT_CONTEXT);
+    assert_null(ectx);
+
+    free(storage);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(test_initialize_ex, tcti_fake_setup),
+        cmocka_unit_test_setup(test_initialize_ex_bad_params, tcti_fake_setup),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,537 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * Tests the metadata cache of Esys_TR_FromTPMPublic. A fake TCTI answers
+ * TPM2_ReadClock, TPM2_ReadPublic, TPM2_NV_ReadPublic and TPM2_NV_UndefineSpace
+ * and counts the commands it receives.
+ */
+
+#define TCTI_MDCACHE_MAGIC 0x4d44434143484500ULL        /* 'MDCACHE\0' */
+#define TCTI_MDCACHE_VERSION 0x1
+
+#define KEY_HANDLE (TPM2_PERSISTENT_FIRST + 1)
+#define NV_HANDLE (TPM2_NV_INDEX_FIRST + 1)
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_COMMON_V1 common;
+    TPM2_CC command;               /* The last command received. */
+    size_t commands;               /* The number of commands received. */
+    size_t read_clocks;            /* The number of TPM2_ReadClock. */
+    size_t read_publics;           /* The number of (NV_)ReadPublic. */
+    TPMS_CLOCK_INFO clock_info;    /* The TPM's identity. */
+    BYTE name;                     /* The pattern of the object names. */
+} TSS2_TCTI_CONTEXT_MDCACHE;
+
+static TSS2_TCTI_CONTEXT_MDCACHE tcti;
+static char path[] = "/tmp/esys_mdcache_XXXXXX";
+
+static TSS2_RC
+tcti_mdcache_transmit(TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+                      const uint8_t *buffer)
+{
+    TSS2_TCTI_CONTEXT_MDCACHE *t = (TSS2_TCTI_CONTEXT_MDCACHE *) tctiContext;
+    size_t offset = 6;
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                              &t->command), TSS2_RC_SUCCESS);
+    t->commands++;
+    if (t->command == TPM2_CC_ReadClock)
+        t->read_clocks++;
+    if (t->command == TPM2_CC_ReadPublic || t->command == TPM2_CC_NV_ReadPublic)
+        t->read_publics++;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_mdcache_name(TPM2B_NAME *name, BYTE pattern)
+{
+    name->size = 34;
+    name->name[0] = 0x00;
+    name->name[1] = 0x0b;
+    memset(&name->name[2], pattern, name->size - 2);
+}
+
+static TSS2_RC
+tcti_mdcache_receive(TSS2_TCTI_CONTEXT *tctiContext, size_t *response_size,
+                     uint8_t *response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_MDCACHE *t = (TSS2_TCTI_CONTEXT_MDCACHE *) tctiContext;
+    uint8_t buffer[4096];
+    size_t offset = 10, size_offset = 2;
+    TPM2_ST tag = TPM2_ST_NO_SESSIONS;
+    TPMS_TIME_INFO time_info = { .time = 1, .clockInfo = t->clock_info };
+    TPM2B_PUBLIC public = { 0 };
+    TPM2B_NV_PUBLIC nv_public = { 0 };
+    TPM2B_NAME name;
+    (void) timeout;
+
+    tcti_mdcache_name(&name, t->name);
+    switch (t->command) {
+    case TPM2_CC_ReadClock:
+        assert_int_equal(Tss2_MU_TPMS_TIME_INFO_Marshal(&time_info, buffer,
+                                                        sizeof(buffer),
+                                                        &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_ReadPublic:
+        public.publicArea.type = TPM2_ALG_KEYEDHASH;
+        public.publicArea.nameAlg = TPM2_ALG_SHA256;
+        public.publicArea.parameters.keyedHashDetail.scheme.scheme =
+            TPM2_ALG_NULL;
+        public.publicArea.unique.keyedHash.size = 32;
+        memset(&public.publicArea.unique.keyedHash.buffer[0], t->name, 32);
+        assert_int_equal(Tss2_MU_TPM2B_PUBLIC_Marshal(&public, buffer,
+                                                      sizeof(buffer), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, buffer,
+                                                    sizeof(buffer), &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, buffer,
+                                                    sizeof(buffer), &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_NV_ReadPublic:
+        nv_public.nvPublic.nvIndex = NV_HANDLE;
+        nv_public.nvPublic.nameAlg = TPM2_ALG_SHA256;
+        nv_public.nvPublic.attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE;
+        nv_public.nvPublic.dataSize = t->name;
+        assert_int_equal(Tss2_MU_TPM2B_NV_PUBLIC_Marshal(&nv_public, buffer,
+                                                         sizeof(buffer),
+                                                         &offset),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_TPM2B_NAME_Marshal(&name, buffer,
+                                                    sizeof(buffer), &offset),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_NV_UndefineSpace:
+        /* No parameters and the response of the password session. */
+        tag = TPM2_ST_SESSIONS;
+        assert_int_equal(Tss2_MU_UINT32_Marshal(0, buffer, sizeof(buffer),
+                                                &offset), TSS2_RC_SUCCESS);
+        assert_int_equal(Tss2_MU_UINT16_Marshal(0, buffer, sizeof(buffer),
+                                                &offset), TSS2_RC_SUCCESS);
+        buffer[offset++] = TPMA_SESSION_CONTINUESESSION;
+        assert_int_equal(Tss2_MU_UINT16_Marshal(0, buffer, sizeof(buffer),
+                                                &offset), TSS2_RC_SUCCESS);
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, t->command);
+    }
+
+    assert_int_equal(Tss2_MU_UINT16_Marshal(tag, buffer, sizeof(buffer),
+                                            &(size_t){ 0 }), TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_UINT32_Marshal((UINT32) offset, buffer,
+                                            sizeof(buffer), &size_offset),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, buffer,
+                                            sizeof(buffer), &size_offset),
+                     TSS2_RC_SUCCESS);
+
+    if (response_buffer == NULL) {
+        *response_size = offset;
+        return TSS2_RC_SUCCESS;
+    }
+    assert_true(*response_size >= offset);
+    *response_size = offset;
+    memcpy(response_buffer, buffer, offset);
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_mdcache_finalize(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    (void) tctiContext;
+}
+
+static int
+setup(void **state)
+{
+    int fd;
+    (void) state;
+
+    memset(&tcti, 0, sizeof(tcti));
+    TSS2_TCTI_MAGIC(&tcti) = TCTI_MDCACHE_MAGIC;
+    TSS2_TCTI_VERSION(&tcti) = TCTI_MDCACHE_VERSION;
+    TSS2_TCTI_TRANSMIT(&tcti) = tcti_mdcache_transmit;
+    TSS2_TCTI_RECEIVE(&tcti) = tcti_mdcache_receive;
+    TSS2_TCTI_FINALIZE(&tcti) = tcti_mdcache_finalize;
+    tcti.clock_info.clock = 1000;
+    tcti.clock_info.resetCount = 3;
+    tcti.clock_info.restartCount = 1;
+    tcti.name = 0x11;
+
+    strcpy(path, "/tmp/esys_mdcache_XXXXXX");
+    fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    remove(path);
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    char lock_path[sizeof(path) + sizeof(".lock")];
+    (void) state;
+
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    remove(lock_path);
+    remove(path);
+    return 0;
+}
+
+static ESYS_CONTEXT *
+context(bool cached)
+{
+    ESYS_CONTEXT *ectx;
+
+    assert_int_equal(Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) &tcti, NULL),
+                     TSS2_RC_SUCCESS);
+    if (cached)
+        assert_int_equal(Esys_SetMetadataCache(ectx, path), TSS2_RC_SUCCESS);
+    return ectx;
+}
+
+/* Reads the name of a handle through a context without cache. */
+static void
+expected_name(TPM2_HANDLE handle, TPM2B_NAME *expected)
+{
+    ESYS_CONTEXT *ectx = context(false);
+    ESYS_TR object;
+    TPM2B_NAME *name;
+
+    assert_int_equal(Esys_TR_FromTPMPublic(ectx, handle, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &object), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_GetName(ectx, object, &name), TSS2_RC_SUCCESS);
+    *expected = *name;
+    free(name);
+    Esys_Finalize(&ectx);
+}
+
+/* Creates an ESYS_TR and checks the name and the number of commands sent. */
+static ESYS_TR
+from_tpm(ESYS_CONTEXT *ectx, TPM2_HANDLE handle, size_t read_clocks,
+         size_t read_publics)
+{
+    ESYS_TR object;
+    TPM2B_NAME *name, expected;
+    size_t clocks, publics;
+
+    expected_name(handle, &expected);
+    clocks = tcti.read_clocks;
+    publics = tcti.read_publics;
+    assert_int_equal(Esys_TR_FromTPMPublic(ectx, handle, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &object), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti.read_clocks - clocks, read_clocks);
+    assert_int_equal(tcti.read_publics - publics, read_publics);
+
+    assert_int_equal(Esys_TR_GetName(ectx, object, &name), TSS2_RC_SUCCESS);
+    assert_int_equal(name->size, expected.size);
+    assert_memory_equal(&name->name[0], &expected.name[0], expected.size);
+    free(name);
+    return object;
+}
+
+static void
+test_disabled(void **state)
+{
+    ESYS_CONTEXT *ectx = context(false);
+    (void) state;
+
+    from_tpm(ectx, KEY_HANDLE, 0, 1);
+    from_tpm(ectx, KEY_HANDLE, 0, 1);
+    from_tpm(ectx, NV_HANDLE, 0, 1);
+    Esys_Finalize(&ectx);
+    assert_int_equal(access(path, F_OK), -1);
+}
+
+static void
+test_hit(void **state)
+{
+    ESYS_CONTEXT *ectx = context(true);
+    ESYS_TR object;
+    TPM2_HANDLE handle;
+    (void) state;
+
+    /* The clock is read once per context. */
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+    from_tpm(ectx, NV_HANDLE, 0, 1);
+    from_tpm(ectx, KEY_HANDLE, 0, 0);
+    Esys_Finalize(&ectx);
+
+    ectx = context(true);
+    object = from_tpm(ectx, KEY_HANDLE, 1, 0);
+    assert_int_equal(Esys_TR_GetTpmHandle(ectx, object, &handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(handle, KEY_HANDLE);
+    object = from_tpm(ectx, NV_HANDLE, 0, 0);
+    assert_int_equal(Esys_TR_GetTpmHandle(ectx, object, &handle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(handle, NV_HANDLE);
+    Esys_Finalize(&ectx);
+
+    /* Transient handles are never cached. */
+    ectx = context(true);
+    from_tpm(ectx, TPM2_TRANSIENT_FIRST, 0, 1);
+    from_tpm(ectx, TPM2_TRANSIENT_FIRST, 0, 1);
+    Esys_Finalize(&ectx);
+}
+
+static void
+test_identity(void **state)
+{
+    ESYS_CONTEXT *ectx = context(true);
+    (void) state;
+
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+    Esys_Finalize(&ectx);
+
+    /* A restarted TPM invalidates the cache. */
+    tcti.clock_info.restartCount++;
+    tcti.name = 0x22;
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+    from_tpm(ectx, KEY_HANDLE, 0, 0);
+    Esys_Finalize(&ectx);
+
+    /* So does a clock that went backwards, e.g. after TPM2_Clear. */
+    tcti.clock_info.clock = 10;
+    tcti.name = 0x33;
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+    Esys_Finalize(&ectx);
+
+    tcti.clock_info.clock = 20;
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 0);
+    Esys_Finalize(&ectx);
+}
+
+static void
+test_invalidation(void **state)
+{
+    ESYS_CONTEXT *ectx = context(true);
+    ESYS_TR key, nv;
+    TPM2B_PUBLIC *public;
+    TPM2B_NAME *name, *qualified_name;
+    (void) state;
+
+    key = from_tpm(ectx, KEY_HANDLE, 1, 1);
+    nv = from_tpm(ectx, NV_HANDLE, 0, 1);
+
+    /* Reading the same name keeps the entry. */
+    assert_int_equal(Esys_ReadPublic(ectx, key, ESYS_TR_NONE, ESYS_TR_NONE,
+                                     ESYS_TR_NONE, &public, &name,
+                                     &qualified_name), TSS2_RC_SUCCESS);
+    free(public);
+    free(name);
+    free(qualified_name);
+    Esys_Finalize(&ectx);
+    ectx = context(true);
+    key = from_tpm(ectx, KEY_HANDLE, 1, 0);
+
+    /* A different name drops the entry. */
+    tcti.name = 0x44;
+    assert_int_equal(Esys_ReadPublic(ectx, key, ESYS_TR_NONE, ESYS_TR_NONE,
+                                     ESYS_TR_NONE, &public, &name,
+                                     &qualified_name), TSS2_RC_SUCCESS);
+    free(public);
+    free(name);
+    free(qualified_name);
+    Esys_Finalize(&ectx);
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+
+    /* Deleting the NV index drops its entry. */
+    tcti.name = 0x11;
+    nv = from_tpm(ectx, NV_HANDLE, 0, 0);
+    assert_int_equal(Esys_NV_UndefineSpace(ectx, ESYS_TR_RH_OWNER, nv,
+                                           ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                           ESYS_TR_NONE), TSS2_RC_SUCCESS);
+    from_tpm(ectx, NV_HANDLE, 0, 1);
+    from_tpm(ectx, NV_HANDLE, 0, 0);
+    Esys_Finalize(&ectx);
+}
+
+static void
+test_corrupted(void **state)
+{
+    ESYS_CONTEXT *ectx;
+    FILE *stream;
+    (void) state;
+
+    stream = fopen(path, "wb");
+    assert_non_null(stream);
+    fputs("EMDC garbage", stream);
+    fclose(stream);
+
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 1);
+    Esys_Finalize(&ectx);
+    ectx = context(true);
+    from_tpm(ectx, KEY_HANDLE, 1, 0);
+
+    /* Disabling the cache goes back to the TPM. */
+    assert_int_equal(Esys_SetMetadataCache(ectx, NULL), TSS2_RC_SUCCESS);
+    from_tpm(ectx, KEY_HANDLE, 0, 1);
+    Esys_Finalize(&ectx);
+}
+
+#define WRITERS 4
+#define WRITER_HANDLES 50
+
+static void
+test_concurrent(void **state)
+{
+    ESYS_CONTEXT *ectx;
+    ESYS_TR object;
+    pid_t pids[WRITERS];
+    int i, j, status;
+    (void) state;
+
+    /* Several processes add entries at the same time; none of them is lost. */
+    for (i = 0; i < WRITERS; i++) {
+        pids[i] = fork();
+        assert_true(pids[i] >= 0);
+        if (pids[i] != 0)
+            continue;
+        ectx = context(true);
+        for (j = 0; j < WRITER_HANDLES; j++) {
+            if (Esys_TR_FromTPMPublic(ectx, KEY_HANDLE + 100 * i + j,
+                                      ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                      &object) != TSS2_RC_SUCCESS)
+                _exit(1);
+        }
+        Esys_Finalize(&ectx);
+        _exit(0);
+    }
+    for (i = 0; i < WRITERS; i++) {
+        assert_int_equal(waitpid(pids[i], &status, 0), pids[i]);
+        assert_true(WIFEXITED(status));
+        assert_int_equal(WEXITSTATUS(status), 0);
+    }
+
+    ectx = context(true);
+    for (i = 0; i < WRITERS; i++) {
+        for (j = 0; j < WRITER_HANDLES; j++)
+            from_tpm(ectx, KEY_HANDLE + 100 * i + j, i == 0 && j == 0, 0);
+    }
+    Esys_Finalize(&ectx);
+}
+
+#ifdef HAVE_PTHREAD
+/* A thread adding entries through its own ESYS_CONTEXT and TCTI. */
+typedef struct {
+    pthread_t thread;
+    int index;
+    TSS2_TCTI_CONTEXT_MDCACHE tcti;
+    bool failed;
+} WRITER;
+
+static void *
+writer_thread(void *arg)
+{
+    WRITER *writer = arg;
+    ESYS_CONTEXT *ectx;
+    ESYS_TR object;
+    int j;
+
+    if (Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) &writer->tcti, NULL)
+            != TSS2_RC_SUCCESS) {
+        writer->failed = true;
+        return NULL;
+    }
+    if (Esys_SetMetadataCache(ectx, path) != TSS2_RC_SUCCESS)
+        writer->failed = true;
+    for (j = 0; j < WRITER_HANDLES && !writer->failed; j++) {
+        if (Esys_TR_FromTPMPublic(ectx, KEY_HANDLE + 100 * writer->index + j,
+                                  ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  &object) != TSS2_RC_SUCCESS)
+            writer->failed = true;
+    }
+    Esys_Finalize(&ectx);
+    return NULL;
+}
+
+static void
+test_concurrent_threads(void **state)
+{
+    ESYS_CONTEXT *ectx;
+    WRITER writers[WRITERS];
+    int i, j;
+    (void) state;
+
+    /* Several threads of one process add entries at the same time through
+       their own contexts; none of them is lost. */
+    for (i = 0; i < WRITERS; i++) {
+        writers[i].index = i;
+        writers[i].tcti = tcti;
+        writers[i].failed = false;
+        assert_int_equal(pthread_create(&writers[i].thread, NULL, writer_thread,
+                                        &writers[i]), 0);
+    }
+    for (i = 0; i < WRITERS; i++) {
+        assert_int_equal(pthread_join(writers[i].thread, NULL), 0);
+        assert_false(writers[i].failed);
+    }
+
+    ectx = context(true);
+    for (i = 0; i < WRITERS; i++) {
+        for (j = 0; j < WRITER_HANDLES; j++)
+            from_tpm(ectx, KEY_HANDLE + 100 * i + j, i == 0 && j == 0, 0);
+    }
+    Esys_Finalize(&ectx);
+}
+#endif /* HAVE_PTHREAD */
+
+int
+main(int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_disabled, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_hit, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_identity, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_invalidation, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_corrupted, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_concurrent, setup, teardown),
+#ifdef HAVE_PTHREAD
+        cmocka_unit_test_setup_teardown(test_concurrent_threads, setup, teardown),
+#endif
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -12,6 +12,10 @@
 #include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#include <poll.h>
+#endif
 
 #include <setjmp.h>
 #include <cmocka.h>
@@ -2886,6 +2890,158 @@ test_Vendor_TCG_Test(void **state)
     assert_int_equal(tcti_yielder->count, 5 /* _ESYS_MAX_SUBMISSIONS */ );
 }
 
+static uint64_t
+time_ms(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000;
+}
+
+static TSS2_RC
+tcti_yielder_get_poll_handles(TSS2_TCTI_CONTEXT * tctiContext,
+                              TSS2_TCTI_POLL_HANDLE * handles,
+                              size_t * num_handles)
+{
+    *num_handles = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+test_resubmission_policy_invalid(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *esys_context = (ESYS_CONTEXT *) * state;
+    ESYS_RESUBMISSION_POLICY policy = {
+        .maxSubmissions = 0, .backoffFactor = 1
+    };
+
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+
+    policy.maxSubmissions = 3;
+    policy.jitter = 101;
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+
+    policy.jitter = 0;
+    policy.initialDelay = 20;
+    policy.maxDelay = 10;
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+
+    r = Esys_SetResubmissionPolicy(NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_SetResubmissionPolicy(esys_context, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static void
+test_resubmission_backoff(void **state)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *esys_context = (ESYS_CONTEXT *) * state;
+    Esys_GetTcti(esys_context, &tcti);
+    TSS2_TCTI_CONTEXT_YIELDER *tcti_yielder = tcti_yielder_cast(tcti);
+    ESYS_RESUBMISSION_POLICY policy = {
+        .maxSubmissions = 4,
+        .initialDelay = 10,
+        .maxDelay = 30,
+        .backoffFactor = 2,
+    };
+    uint64_t start;
+
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    start = time_ms();
+    r = Esys_Startup(esys_context, TPM2_SU_CLEAR);
+    assert_int_equal(r, TPM2_RC_YIELDED);
+    assert_int_equal(tcti_yielder->count, 4);
+    /* Delays of 10, 20 and (capped) 30 ms. */
+    assert_true(time_ms() - start >= 60);
+}
+
+static void
+test_resubmission_deadline(void **state)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *esys_context = (ESYS_CONTEXT *) * state;
+    Esys_GetTcti(esys_context, &tcti);
+    TSS2_TCTI_CONTEXT_YIELDER *tcti_yielder = tcti_yielder_cast(tcti);
+    ESYS_RESUBMISSION_POLICY policy = {
+        .maxSubmissions = 10,
+        .initialDelay = 20,
+        .maxDelay = 1000,
+        .backoffFactor = 2,
+        .deadline = 50,
+    };
+
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The second resubmission would be due after 20 + 40 ms. */
+    r = Esys_Startup(esys_context, TPM2_SU_CLEAR);
+    assert_int_equal(r, TPM2_RC_YIELDED);
+    assert_int_equal(tcti_yielder->count, 2);
+}
+
+static void
+test_resubmission_async(void **state)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *esys_context = (ESYS_CONTEXT *) * state;
+    Esys_GetTcti(esys_context, &tcti);
+    TSS2_TCTI_CONTEXT_YIELDER *tcti_yielder = tcti_yielder_cast(tcti);
+    ESYS_RESUBMISSION_POLICY policy = {
+        .maxSubmissions = 3,
+        .initialDelay = 50,
+        .maxDelay = 50,
+        .backoffFactor = 1,
+    };
+    TSS2_TCTI_POLL_HANDLE *handles;
+    size_t count;
+
+    TSS2_TCTI_GET_POLL_HANDLES(tcti) = tcti_yielder_get_poll_handles;
+    r = Esys_SetResubmissionPolicy(esys_context, &policy);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SetTimeout(esys_context, 0);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    r = Esys_Startup_Async(esys_context, TPM2_SU_CLEAR);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The resubmission is scheduled but not sent before it is due. */
+    r = Esys_Startup_Finish(esys_context);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+    r = Esys_Startup_Finish(esys_context);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+    assert_int_equal(tcti_yielder->count, 1);
+
+    r = Esys_GetPollHandles(esys_context, &handles, &count);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+#ifdef HAVE_SYS_TIMERFD_H
+    /* The timer becomes readable once the resubmission is due. */
+    assert_int_equal(count, 1);
+    assert_int_equal(poll(handles, count, 0), 0);
+    assert_int_equal(poll(handles, count, 1000), 1);
+#else
+    assert_int_equal(count, 0);
+    r = Esys_SetTimeout(esys_context, 1000);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+#endif
+    free(handles);
+
+    r = Esys_Startup_Finish(esys_context);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+    assert_int_equal(tcti_yielder->count, 2);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -3021,6 +3177,14 @@ main(int argc, char *argv[])
         cmocka_unit_test_setup_teardown(test_NV_ChangeAuth, setup, teardown),
         cmocka_unit_test_setup_teardown(test_NV_Certify, setup, teardown),
         cmocka_unit_test_setup_teardown(test_Vendor_TCG_Test, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_resubmission_policy_invalid,
+                                        setup, teardown),
+        cmocka_unit_test_setup_teardown(test_resubmission_backoff, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_resubmission_deadline, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_resubmission_async, setup,
+                                        teardown),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
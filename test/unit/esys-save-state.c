@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "esys_mu.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * Tests the bulk serialization of the ESYS_TR objects of a context. The fake
+ * TCTI can not transmit, so the restored objects are usable without any TPM
+ * round trip.
+ */
+
+#define TCTI_FAKE_MAGIC 0x46414b4500000000ULL        /* 'FAKE\0' */
+#define TCTI_FAKE_VERSION 0x1
+
+#define N_KEYS 100
+#define N_NV 50
+#define AUTH_BYTE 0xa7
+
+typedef TSS2_TCTI_CONTEXT_COMMON_V1 TSS2_TCTI_CONTEXT_FAKE;
+
+static TSS2_TCTI_CONTEXT_FAKE faketcti;
+
+typedef struct {
+    ESYS_CONTEXT *ectx[3];
+    ESYS_TR objects[N_KEYS + N_NV + 1];
+    size_t n_objects;
+} STATE;
+
+static STATE test_state;
+
+static ESYS_TR
+add_object(ESYS_CONTEXT *ectx, IESYS_RESOURCE *rsrc)
+{
+    uint8_t buffer[sizeof(IESYS_RESOURCE)];
+    size_t offset = 0;
+    ESYS_TR object;
+
+    rsrc->name.size = 34;
+    memset(&rsrc->name.name[0], rsrc->handle & 0xff, rsrc->name.size);
+    assert_int_equal(iesys_MU_IESYS_RESOURCE_Marshal(rsrc, &buffer[0],
+                                                     sizeof(buffer), &offset),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_Deserialize(ectx, &buffer[0], offset, &object),
+                     TSS2_RC_SUCCESS);
+    return object;
+}
+
+/* Persistent keys, NV indices and a saved session, some with auth values. */
+static void
+populate(STATE *s)
+{
+    IESYS_RESOURCE rsrc;
+    TPM2B_AUTH auth = { .size = 16 };
+    TPMT_PUBLIC *public;
+    TPMS_NV_PUBLIC *nv_public;
+    IESYS_SESSION *session;
+    size_t i;
+
+    memset(&auth.buffer[0], AUTH_BYTE, auth.size);
+    for (i = 0; i < N_KEYS; i++) {
+        memset(&rsrc, 0, sizeof(rsrc));
+        rsrc.handle = TPM2_PERSISTENT_FIRST + i;
+        rsrc.rsrcType = IESYSC_KEY_RSRC;
+        public = &rsrc.misc.rsrc_key_pub.publicArea;
+        public->type = TPM2_ALG_RSA;
+        public->nameAlg = TPM2_ALG_SHA256;
+        public->objectAttributes = TPMA_OBJECT_SIGN_ENCRYPT |
+            TPMA_OBJECT_USERWITHAUTH | TPMA_OBJECT_FIXEDTPM;
+        public->parameters.rsaDetail.symmetric.algorithm = TPM2_ALG_NULL;
+        public->parameters.rsaDetail.scheme.scheme = TPM2_ALG_NULL;
+        public->parameters.rsaDetail.keyBits = 2048;
+        public->unique.rsa.size = 256;
+        memset(&public->unique.rsa.buffer[0], i, 256);
+        s->objects[s->n_objects++] = add_object(s->ectx[0], &rsrc);
+        if (i % 2 == 0)
+            assert_int_equal(Esys_TR_SetAuth(s->ectx[0],
+                                             s->objects[s->n_objects - 1],
+                                             &auth), TSS2_RC_SUCCESS);
+    }
+    for (i = 0; i < N_NV; i++) {
+        memset(&rsrc, 0, sizeof(rsrc));
+        rsrc.handle = TPM2_NV_INDEX_FIRST + i;
+        rsrc.rsrcType = IESYSC_NV_RSRC;
+        nv_public = &rsrc.misc.rsrc_nv_pub.nvPublic;
+        nv_public->nvIndex = rsrc.handle;
+        nv_public->nameAlg = TPM2_ALG_SHA256;
+        nv_public->attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE;
+        nv_public->dataSize = 32;
+        s->objects[s->n_objects++] = add_object(s->ectx[0], &rsrc);
+    }
+
+    memset(&rsrc, 0, sizeof(rsrc));
+    rsrc.handle = TPM2_HMAC_SESSION_FIRST;
+    rsrc.rsrcType = IESYSC_SESSION_RSRC;
+    session = &rsrc.misc.rsrc_session;
+    session->symmetric.algorithm = TPM2_ALG_NULL;
+    session->authHash = TPM2_ALG_SHA256;
+    session->sessionType = TPM2_SE_HMAC;
+    session->sessionKey.size = 32;
+    memset(&session->sessionKey.buffer[0], 0x5e, 32);
+    session->nonceTPM.size = 32;
+    session->nonceCaller.size = 32;
+    s->objects[s->n_objects++] = add_object(s->ectx[0], &rsrc);
+
+    assert_int_equal(Esys_TR_SetAuth(s->ectx[0], ESYS_TR_RH_OWNER, &auth),
+                     TSS2_RC_SUCCESS);
+}
+
+static bool
+contains_auth(const uint8_t *buffer, size_t size)
+{
+    uint8_t pattern[16];
+
+    memset(&pattern[0], AUTH_BYTE, sizeof(pattern));
+    for (; size >= sizeof(pattern); buffer++, size--) {
+        if (memcmp(buffer, &pattern[0], sizeof(pattern)) == 0)
+            return true;
+    }
+    return false;
+}
+
+static int
+setup(void **state)
+{
+    size_t i;
+
+    TSS2_TCTI_MAGIC(&faketcti) = TCTI_FAKE_MAGIC;
+    TSS2_TCTI_VERSION(&faketcti) = TCTI_FAKE_VERSION;
+    TSS2_TCTI_TRANSMIT(&faketcti) = (void*)1;
+    TSS2_TCTI_RECEIVE(&faketcti) = (void*)1;
+    TSS2_TCTI_FINALIZE(&faketcti) = NULL;
+
+    memset(&test_state, 0, sizeof(test_state));
+    for (i = 0; i < 3; i++) {
+        if (Esys_Initialize(&test_state.ectx[i],
+                            (TSS2_TCTI_CONTEXT *) &faketcti, NULL) !=
+            TSS2_RC_SUCCESS)
+            return -1;
+    }
+    *state = &test_state;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    STATE *s = *state;
+    size_t i;
+
+    for (i = 0; i < 3; i++)
+        Esys_Finalize(&s->ectx[i]);
+    return 0;
+}
+
+static void
+test_save_restore(void **state)
+{
+    STATE *s = *state;
+    uint8_t *blob, *blob2, *obj1, *obj2;
+    size_t size, size2, size1_obj, size2_obj, i;
+    TPM2_HANDLE handle1, handle2;
+    TPM2B_NAME *name;
+    ESYS_TR object;
+
+    populate(s);
+
+    assert_int_equal(Esys_SaveState(s->ectx[0], 0, &blob, &size),
+                     TSS2_RC_SUCCESS);
+    assert_true(contains_auth(blob, size));
+    assert_int_equal(Esys_RestoreState(s->ectx[1], blob, size),
+                     TSS2_RC_SUCCESS);
+
+    /* The objects keep their ESYS_TR numbers and metadata. */
+    for (i = 0; i < s->n_objects; i++) {
+        assert_int_equal(Esys_TR_Serialize(s->ectx[0], s->objects[i], &obj1,
+                                           &size1_obj), TSS2_RC_SUCCESS);
+        assert_int_equal(Esys_TR_Serialize(s->ectx[1], s->objects[i], &obj2,
+                                           &size2_obj), TSS2_RC_SUCCESS);
+        assert_int_equal(size1_obj, size2_obj);
+        assert_memory_equal(obj1, obj2, size1_obj);
+        free(obj1);
+        free(obj2);
+
+        assert_int_equal(Esys_TR_GetTpmHandle(s->ectx[0], s->objects[i],
+                                              &handle1), TSS2_RC_SUCCESS);
+        assert_int_equal(Esys_TR_GetTpmHandle(s->ectx[1], s->objects[i],
+                                              &handle2), TSS2_RC_SUCCESS);
+        assert_int_equal(handle1, handle2);
+    }
+    assert_int_equal(Esys_TR_GetName(s->ectx[1], s->objects[0], &name),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(name->size, 34);
+    free(name);
+
+    /* Saving the restored context yields the same state. */
+    assert_int_equal(Esys_SaveState(s->ectx[1], 0, &blob2, &size2),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(size, size2);
+    assert_memory_equal(blob, blob2, size);
+    free(blob2);
+
+    /* New objects do not reuse the restored ESYS_TR numbers. */
+    assert_int_equal(Esys_TR_Serialize(s->ectx[1], s->objects[0], &obj1,
+                                       &size1_obj), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_Deserialize(s->ectx[1], obj1, size1_obj, &object),
+                     TSS2_RC_SUCCESS);
+    free(obj1);
+    for (i = 0; i < s->n_objects; i++)
+        assert_int_not_equal(object, s->objects[i]);
+
+    /* Restoring the same objects twice fails and leaves the context as is. */
+    assert_int_equal(Esys_SaveState(s->ectx[1], 0, &blob2, &size2),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_RestoreState(s->ectx[1], blob, size),
+                     TSS2_ESYS_RC_BAD_TR);
+    free(blob);
+    assert_int_equal(Esys_SaveState(s->ectx[1], 0, &blob, &size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(size, size2);
+    assert_memory_equal(blob, blob2, size);
+    free(blob);
+    free(blob2);
+}
+
+static void
+test_save_restore_no_auth(void **state)
+{
+    STATE *s = *state;
+    uint8_t *blob, *blob_auth, *blob2;
+    size_t size, size_auth, size2;
+
+    populate(s);
+
+    assert_int_equal(Esys_SaveState(s->ectx[0], 0, &blob_auth, &size_auth),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_SaveState(s->ectx[0], ESYS_SAVE_STATE_NO_AUTH,
+                                    &blob, &size), TSS2_RC_SUCCESS);
+    assert_true(size < size_auth);
+    assert_false(contains_auth(blob, size));
+    free(blob_auth);
+
+    assert_int_equal(Esys_RestoreState(s->ectx[2], blob, size),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_SaveState(s->ectx[2], 0, &blob2, &size2),
+                     TSS2_RC_SUCCESS);
+    assert_false(contains_auth(blob2, size2));
+    free(blob2);
+    free(blob);
+}
+
+static void
+test_restore_bad_state(void **state)
+{
+    STATE *s = *state;
+    uint8_t *blob, *bad;
+    size_t size;
+
+    populate(s);
+    assert_int_equal(Esys_SaveState(s->ectx[0], 0, &blob, &size),
+                     TSS2_RC_SUCCESS);
+    bad = malloc(size + 1);
+    assert_non_null(bad);
+
+    /* Wrong magic and unknown version. */
+    memcpy(bad, blob, size);
+    bad[0] ^= 0xff;
+    assert_int_equal(Esys_RestoreState(s->ectx[1], bad, size),
+                     TSS2_ESYS_RC_BAD_VALUE);
+    memcpy(bad, blob, size);
+    bad[7] = 2;
+    assert_int_equal(Esys_RestoreState(s->ectx[1], bad, size),
+                     TSS2_ESYS_RC_BAD_VALUE);
+
+    /* Truncated and trailing data. */
+    assert_int_not_equal(Esys_RestoreState(s->ectx[1], blob, size - 1),
+                         TSS2_RC_SUCCESS);
+    memcpy(bad, blob, size);
+    bad[size] = 0;
+    assert_int_equal(Esys_RestoreState(s->ectx[1], bad, size + 1),
+                     TSS2_ESYS_RC_BAD_VALUE);
+
+    /* None of the attempts left objects behind. */
+    assert_int_equal(Esys_RestoreState(s->ectx[1], blob, size),
+                     TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_RestoreState(NULL, blob, size),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_SaveState(s->ectx[0], 0x2, &bad, &size),
+                     TSS2_ESYS_RC_BAD_VALUE);
+    free(bad);
+    free(blob);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_save_restore, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_save_restore_no_auth, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_restore_bad_state, setup,
+                                        teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,475 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * This unit test drives Esys_SequenceHash() against a TCTI that answers the
+ * capability and sequence commands and records the data of every
+ * TPM2_SequenceUpdate and TPM2_SequenceComplete command.
+ */
+
+#define TCTI_SEQUENCE_MAGIC 0x5345515500000000ULL        /* 'SEQU\0' */
+#define TCTI_SEQUENCE_VERSION 0x1
+
+#define SEQUENCE_HANDLE 0x80000001
+#define MAX_UPDATES 32
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    UINT32 input_buffer;        /* The reported TPM2_PT_INPUT_BUFFER. */
+    uint8_t response[256];
+    size_t response_size;
+    int capabilities;           /* Number of TPM2_GetCapability commands. */
+    int flushes;                /* Number of TPM2_FlushContext commands. */
+    int completes;              /* Number of TPM2_SequenceComplete commands. */
+    size_t updates;             /* Number of TPM2_SequenceUpdate commands. */
+    UINT16 update_sizes[MAX_UPDATES];
+    UINT16 complete_size;
+    uint8_t data[MAX_UPDATES * TPM2_MAX_DIGEST_BUFFER];
+    size_t data_size;           /* The data received in all commands. */
+} TSS2_TCTI_CONTEXT_SEQUENCE;
+
+static const TPM2B_DIGEST sequence_result = {
+    .size = 32,
+    .buffer = { 0xde, 0xad, 0xbe, 0xef }
+};
+
+/* Marshal the header and, for commands with sessions, the parameter size. */
+static void
+response_start(TSS2_TCTI_CONTEXT_SEQUENCE *tcti, TPM2_ST tag)
+{
+    size_t offset = 0;
+
+    assert_int_equal(Tss2_MU_TPM2_ST_Marshal(tag, &tcti->response[0],
+                     sizeof(tcti->response), &offset), TSS2_RC_SUCCESS);
+    tcti->response_size = 10;
+    if (tag == TPM2_ST_SESSIONS)
+        tcti->response_size += 4;
+}
+
+/* Append the password session response and fill in the sizes. */
+static void
+response_end(TSS2_TCTI_CONTEXT_SEQUENCE *tcti, TPM2_ST tag)
+{
+    static const uint8_t password_auth[] = { 0x00, 0x00, 0x01, 0x00, 0x00 };
+    size_t offset;
+
+    if (tag == TPM2_ST_SESSIONS) {
+        offset = 10;
+        assert_int_equal(Tss2_MU_UINT32_Marshal(tcti->response_size - 14,
+                         &tcti->response[0], sizeof(tcti->response), &offset),
+                         TSS2_RC_SUCCESS);
+        memcpy(&tcti->response[tcti->response_size], &password_auth[0],
+               sizeof(password_auth));
+        tcti->response_size += sizeof(password_auth);
+    }
+    offset = 2;
+    assert_int_equal(Tss2_MU_UINT32_Marshal(tcti->response_size,
+                     &tcti->response[0], sizeof(tcti->response), &offset),
+                     TSS2_RC_SUCCESS);
+    offset = 6;
+    assert_int_equal(Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS,
+                     &tcti->response[0], sizeof(tcti->response), &offset),
+                     TSS2_RC_SUCCESS);
+}
+
+/* Record the TPM2B_MAX_BUFFER behind the handle and auth area of a command. */
+static UINT16
+record_buffer(TSS2_TCTI_CONTEXT_SEQUENCE *tcti, const uint8_t *buffer,
+              size_t size)
+{
+    TPM2B_MAX_BUFFER data;
+    UINT32 auth_size;
+    size_t offset = 14;
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                              &auth_size), TSS2_RC_SUCCESS);
+    offset += auth_size;
+    assert_int_equal(Tss2_MU_TPM2B_MAX_BUFFER_Unmarshal(buffer, size, &offset,
+                                                        &data),
+                     TSS2_RC_SUCCESS);
+    assert_true(tcti->data_size + data.size <= sizeof(tcti->data));
+    memcpy(&tcti->data[tcti->data_size], &data.buffer[0], data.size);
+    tcti->data_size += data.size;
+    return data.size;
+}
+
+static TSS2_RC
+tcti_sequence_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                       size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_SEQUENCE *tcti =
+        (TSS2_TCTI_CONTEXT_SEQUENCE *) tctiContext;
+    TPM2_CC cc;
+    size_t offset = 6;
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset, &cc),
+                     TSS2_RC_SUCCESS);
+    switch (cc) {
+    case TPM2_CC_GetCapability:
+        tcti->capabilities++;
+        response_start(tcti, TPM2_ST_NO_SESSIONS);
+        offset = tcti->response_size;
+        assert_int_equal(Tss2_MU_UINT8_Marshal(TPM2_NO, &tcti->response[0],
+                         sizeof(tcti->response), &offset), TSS2_RC_SUCCESS);
+        TPMS_CAPABILITY_DATA capability_data = {
+            .capability = TPM2_CAP_TPM_PROPERTIES,
+            .data.tpmProperties = {
+                .count = 1,
+                .tpmProperty[0] = {
+                    .property = TPM2_PT_INPUT_BUFFER,
+                    .value = tcti->input_buffer
+                }
+            }
+        };
+        assert_int_equal(Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&capability_data,
+                         &tcti->response[0], sizeof(tcti->response), &offset),
+                         TSS2_RC_SUCCESS);
+        tcti->response_size = offset;
+        response_end(tcti, TPM2_ST_NO_SESSIONS);
+        break;
+    case TPM2_CC_HashSequenceStart:
+        response_start(tcti, TPM2_ST_NO_SESSIONS);
+        offset = tcti->response_size;
+        assert_int_equal(Tss2_MU_TPM2_HANDLE_Marshal(SEQUENCE_HANDLE,
+                         &tcti->response[0], sizeof(tcti->response), &offset),
+                         TSS2_RC_SUCCESS);
+        tcti->response_size = offset;
+        response_end(tcti, TPM2_ST_NO_SESSIONS);
+        break;
+    case TPM2_CC_SequenceUpdate:
+        assert_true(tcti->updates < MAX_UPDATES);
+        tcti->update_sizes[tcti->updates++] = record_buffer(tcti, buffer, size);
+        response_start(tcti, TPM2_ST_SESSIONS);
+        response_end(tcti, TPM2_ST_SESSIONS);
+        break;
+    case TPM2_CC_SequenceComplete:
+        tcti->completes++;
+        tcti->complete_size = record_buffer(tcti, buffer, size);
+        response_start(tcti, TPM2_ST_SESSIONS);
+        offset = tcti->response_size;
+        assert_int_equal(Tss2_MU_TPM2B_DIGEST_Marshal(&sequence_result,
+                         &tcti->response[0], sizeof(tcti->response), &offset),
+                         TSS2_RC_SUCCESS);
+        TPMT_TK_HASHCHECK validation = {
+            .tag = TPM2_ST_HASHCHECK,
+            .hierarchy = TPM2_RH_OWNER,
+            .digest = sequence_result
+        };
+        assert_int_equal(Tss2_MU_TPMT_TK_HASHCHECK_Marshal(&validation,
+                         &tcti->response[0], sizeof(tcti->response), &offset),
+                         TSS2_RC_SUCCESS);
+        tcti->response_size = offset;
+        response_end(tcti, TPM2_ST_SESSIONS);
+        break;
+    case TPM2_CC_FlushContext:
+        tcti->flushes++;
+        response_start(tcti, TPM2_ST_NO_SESSIONS);
+        response_end(tcti, TPM2_ST_NO_SESSIONS);
+        break;
+    default:
+        fail_msg("Unexpected command code 0x%" PRIx32, cc);
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_sequence_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                      size_t * response_size,
+                      uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_SEQUENCE *tcti =
+        (TSS2_TCTI_CONTEXT_SEQUENCE *) tctiContext;
+
+    if (response_buffer != NULL)
+        memcpy(response_buffer, &tcti->response[0], tcti->response_size);
+    *response_size = tcti->response_size;
+    return TSS2_RC_SUCCESS;
+}
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_SEQUENCE tcti;
+    ESYS_CONTEXT *esys_context;
+} SEQUENCE_TEST;
+
+static int
+esys_sequence_setup(void **state)
+{
+    SEQUENCE_TEST *test = calloc(1, sizeof(SEQUENCE_TEST));
+    TSS2_TCTI_CONTEXT *tctiContext = (TSS2_TCTI_CONTEXT *) &test->tcti;
+
+    assert_non_null(test);
+    TSS2_TCTI_MAGIC(tctiContext) = TCTI_SEQUENCE_MAGIC;
+    TSS2_TCTI_VERSION(tctiContext) = TCTI_SEQUENCE_VERSION;
+    TSS2_TCTI_TRANSMIT(tctiContext) = tcti_sequence_transmit;
+    TSS2_TCTI_RECEIVE(tctiContext) = tcti_sequence_receive;
+    test->tcti.input_buffer = 256;
+    assert_int_equal(Esys_Initialize(&test->esys_context, tctiContext, NULL),
+                     TSS2_RC_SUCCESS);
+    *state = test;
+    return 0;
+}
+
+static int
+esys_sequence_teardown(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+
+    Esys_Finalize(&test->esys_context);
+    free(test);
+    return 0;
+}
+
+/* The data handed out by test_reader(). */
+typedef struct {
+    size_t size;         /* Total number of bytes. */
+    size_t offset;       /* Bytes handed out so far. */
+    size_t max_read;     /* Maximum number of bytes per call. */
+    int calls;           /* Number of calls so far. */
+    int fail_call;       /* The call that fails, or 0. */
+} TEST_DATA;
+
+static uint8_t
+test_byte(size_t i)
+{
+    return (uint8_t) (i * 7 + 3);
+}
+
+static TSS2_RC
+test_reader(void *userdata, uint8_t *buffer, size_t size, size_t *bytes_read)
+{
+    TEST_DATA *data = userdata;
+    size_t i;
+
+    if (++data->calls == data->fail_call)
+        return TSS2_ESYS_RC_IO_ERROR;
+    if (size > data->max_read)
+        size = data->max_read;
+    if (size > data->size - data->offset)
+        size = data->size - data->offset;
+    for (i = 0; i < size; i++)
+        buffer[i] = test_byte(data->offset + i);
+    data->offset += size;
+    *bytes_read = size;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+check_data(SEQUENCE_TEST *test, size_t size)
+{
+    size_t i;
+
+    assert_int_equal(test->tcti.data_size, size);
+    for (i = 0; i < size; i++)
+        assert_int_equal(test->tcti.data[i], test_byte(i));
+}
+
+static void
+test_sequence_chunks(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+    TEST_DATA data = { .size = 1000, .max_read = 100 };
+    TPM2B_DIGEST *result = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL;
+    TSS2_RC r;
+
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, &result, &validation);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* TPM2_PT_INPUT_BUFFER is 256; the last chunk goes with the Complete. */
+    assert_int_equal(test->tcti.capabilities, 1);
+    assert_int_equal(test->tcti.updates, 3);
+    assert_int_equal(test->tcti.update_sizes[0], 256);
+    assert_int_equal(test->tcti.update_sizes[1], 256);
+    assert_int_equal(test->tcti.update_sizes[2], 256);
+    assert_int_equal(test->tcti.completes, 1);
+    assert_int_equal(test->tcti.complete_size, 1000 - 3 * 256);
+    assert_int_equal(test->tcti.flushes, 0);
+    check_data(test, 1000);
+
+    assert_non_null(result);
+    assert_memory_equal(result, &sequence_result, sizeof(sequence_result));
+    assert_non_null(validation);
+    assert_int_equal(validation->tag, TPM2_ST_HASHCHECK);
+    assert_int_equal(validation->hierarchy, TPM2_RH_OWNER);
+    Esys_Free(result);
+    Esys_Free(validation);
+
+    /* A multiple of the chunk size, and the chunk size is not queried again. */
+    memset(&data, 0, sizeof(data));
+    data.size = 512;
+    data.max_read = 512;
+    test->tcti.updates = 0;
+    test->tcti.data_size = 0;
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_NULL,
+                          test_reader, &data, &result, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.capabilities, 1);
+    assert_int_equal(test->tcti.updates, 1);
+    assert_int_equal(test->tcti.update_sizes[0], 256);
+    assert_int_equal(test->tcti.complete_size, 256);
+    check_data(test, 512);
+    Esys_Free(result);
+}
+
+static void
+test_sequence_max_buffer(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+    TEST_DATA data = { .size = 3000, .max_read = 3000 };
+    TPM2B_DIGEST *result = NULL;
+    TSS2_RC r;
+
+    /* The chunk size is limited to the size of a TPM2B_MAX_BUFFER. */
+    test->tcti.input_buffer = 4096;
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, &result, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.updates, 2);
+    assert_int_equal(test->tcti.update_sizes[0], TPM2_MAX_DIGEST_BUFFER);
+    assert_int_equal(test->tcti.update_sizes[1], TPM2_MAX_DIGEST_BUFFER);
+    assert_int_equal(test->tcti.complete_size, 3000 - 2 * TPM2_MAX_DIGEST_BUFFER);
+    check_data(test, 3000);
+    Esys_Free(result);
+}
+
+static void
+test_sequence_empty(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+    TEST_DATA data = { .size = 0, .max_read = 1 };
+    TPM2B_DIGEST *result = NULL;
+    TSS2_RC r;
+
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, &result, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.updates, 0);
+    assert_int_equal(test->tcti.completes, 1);
+    assert_int_equal(test->tcti.complete_size, 0);
+    Esys_Free(result);
+}
+
+static void
+test_sequence_fd(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+    uint8_t buffer[2000];
+    TPM2B_DIGEST *result = NULL;
+    int fds[2];
+    size_t i;
+    TSS2_RC r;
+
+    for (i = 0; i < sizeof(buffer); i++)
+        buffer[i] = test_byte(i);
+    assert_int_equal(pipe(fds), 0);
+    assert_int_equal(write(fds[1], &buffer[0], sizeof(buffer)),
+                     sizeof(buffer));
+    close(fds[1]);
+
+    r = Esys_SequenceHashFd(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                            TPM2_ALG_SHA256, ESYS_TR_RH_OWNER, fds[0],
+                            &result, NULL);
+    close(fds[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.updates, 7);
+    assert_int_equal(test->tcti.complete_size, 2000 - 7 * 256);
+    check_data(test, sizeof(buffer));
+    Esys_Free(result);
+
+    r = Esys_SequenceHashFd(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                            TPM2_ALG_SHA256, ESYS_TR_RH_OWNER, -1,
+                            &result, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_IO_ERROR);
+    assert_int_equal(test->tcti.flushes, 1);
+}
+
+static void
+test_sequence_errors(void **state)
+{
+    SEQUENCE_TEST *test = *state;
+    TEST_DATA data = { .size = 2000, .max_read = 256, .fail_call = 4 };
+    TPM2B_DIGEST *result = NULL;
+    TSS2_RC r;
+
+    r = Esys_SequenceHash(NULL, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, &result, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          NULL, &data, &result, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    /* A read failing while an update is in flight flushes the sequence. */
+    r = Esys_SequenceHash(test->esys_context, ESYS_TR_NONE, ESYS_TR_PASSWORD,
+                          TPM2_ALG_SHA256, ESYS_TR_RH_OWNER,
+                          test_reader, &data, &result, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_IO_ERROR);
+    assert_null(result);
+    assert_int_equal(test->tcti.updates, 2);
+    assert_int_equal(test->tcti.completes, 0);
+    assert_int_equal(test->tcti.flushes, 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sequence_chunks,
+                                        esys_sequence_setup,
+                                        esys_sequence_teardown),
+        cmocka_unit_test_setup_teardown(test_sequence_max_buffer,
+                                        esys_sequence_setup,
+                                        esys_sequence_teardown),
+        cmocka_unit_test_setup_teardown(test_sequence_empty,
+                                        esys_sequence_setup,
+                                        esys_sequence_teardown),
+        cmocka_unit_test_setup_teardown(test_sequence_fd,
+                                        esys_sequence_setup,
+                                        esys_sequence_teardown),
+        cmocka_unit_test_setup_teardown(test_sequence_errors,
+                                        esys_sequence_setup,
+                                        esys_sequence_teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,428 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "ifapi_curl_cache.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * A minimal HTTP server on the loopback interface stands in for the
+ * certificate and CRL distribution points. Each request is answered with the
+ * configured headers and body; if the request carries an If-None-Match
+ * header equal to the configured ETag, 304 Not Modified is sent instead. A
+ * status of 0 closes the connection without a response.
+ */
+
+static char dir[] = "/tmp/fapi-curl-cache-XXXXXX";
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_t thread;
+    int fd;
+    unsigned short port;
+    const char *headers;
+    const char *etag;
+    const char *body;
+    int status;
+    size_t requests;
+    char if_none_match[128];
+} server = { .mutex = PTHREAD_MUTEX_INITIALIZER, .fd = -1 };
+
+static void
+serve(int fd)
+{
+    char request[4096], response[4096], etag[160] = "";
+    size_t length = 0;
+    ssize_t n;
+    char *p, *end;
+
+    while (length < sizeof(request) - 1) {
+        n = recv(fd, &request[length], sizeof(request) - 1 - length, 0);
+        if (n <= 0)
+            return;
+        length += n;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n"))
+            break;
+    }
+
+    pthread_mutex_lock(&server.mutex);
+    server.requests++;
+    server.if_none_match[0] = '\0';
+    p = strstr(request, "If-None-Match: ");
+    if (p) {
+        p += strlen("If-None-Match: ");
+        end = strstr(p, "\r\n");
+        if (end && (size_t)(end - p) < sizeof(server.if_none_match)) {
+            memcpy(server.if_none_match, p, end - p);
+            server.if_none_match[end - p] = '\0';
+        }
+    }
+    if (server.status == 0) {
+        /* Simulate an unreachable server. */
+        pthread_mutex_unlock(&server.mutex);
+        return;
+    }
+    if (server.etag)
+        snprintf(etag, sizeof(etag), "ETag: %s\r\n", server.etag);
+    if (server.etag && strcmp(server.if_none_match, server.etag) == 0)
+        snprintf(response, sizeof(response),
+                 "HTTP/1.1 304 Not Modified\r\n%s%s"
+                 "Connection: close\r\n\r\n", server.headers, etag);
+    else
+        snprintf(response, sizeof(response),
+                 "HTTP/1.1 %d Canned\r\n%s%s"
+                 "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                 server.status, server.headers, etag, strlen(server.body),
+                 server.body);
+    pthread_mutex_unlock(&server.mutex);
+
+    length = strlen(response);
+    p = response;
+    while (length > 0 && (n = send(fd, p, length, 0)) > 0) {
+        p += n;
+        length -= n;
+    }
+}
+
+static void *
+server_thread(void *arg)
+{
+    int fd;
+
+    (void)arg;
+    while ((fd = accept(server.fd, NULL, NULL)) >= 0) {
+        serve(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+static void
+respond(int status, const char *headers, const char *etag, const char *body)
+{
+    pthread_mutex_lock(&server.mutex);
+    server.status = status;
+    server.headers = headers;
+    server.etag = etag;
+    server.body = body;
+    server.requests = 0;
+    pthread_mutex_unlock(&server.mutex);
+}
+
+static size_t
+requests(void)
+{
+    size_t n;
+
+    pthread_mutex_lock(&server.mutex);
+    n = server.requests;
+    pthread_mutex_unlock(&server.mutex);
+    return n;
+}
+
+static void
+assert_if_none_match(const char *expected)
+{
+    pthread_mutex_lock(&server.mutex);
+    assert_string_equal(server.if_none_match, expected);
+    pthread_mutex_unlock(&server.mutex);
+}
+
+static char *
+url(const char *path)
+{
+    static char buffer[2][64];
+    static int i;
+
+    i = !i;
+    snprintf(buffer[i], sizeof(buffer[i]), "http://127.0.0.1:%u%s",
+             server.port, path);
+    return buffer[i];
+}
+
+static void
+get(const char *u, const char *expected)
+{
+    unsigned char *buffer = NULL;
+    size_t size = 0;
+
+    assert_int_equal(ifapi_curl_cache_get(u, &buffer, &size), TSS2_RC_SUCCESS);
+    assert_int_equal(size, strlen(expected));
+    assert_memory_equal(buffer, expected, size);
+    free(buffer);
+}
+
+static size_t
+count_files(const char *prefix)
+{
+    struct dirent *dirent;
+    size_t n = 0;
+    DIR *dirp;
+
+    dirp = opendir(dir);
+    assert_non_null(dirp);
+    while ((dirent = readdir(dirp)) != NULL)
+        if (strncmp(dirent->d_name, prefix, strlen(prefix)) == 0)
+            n++;
+    closedir(dirp);
+    return n;
+}
+
+static int
+remove_files(void)
+{
+    struct dirent *dirent;
+    char path[sizeof(dir) + 256];
+    DIR *dirp;
+
+    dirp = opendir(dir);
+    if (dirp == NULL)
+        return -1;
+    while ((dirent = readdir(dirp)) != NULL) {
+        if (dirent->d_name[0] == '.' && (dirent->d_name[1] == '\0' ||
+                                         dirent->d_name[1] == '.'))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, dirent->d_name);
+        unlink(path);
+    }
+    closedir(dirp);
+    return 0;
+}
+
+static int
+setup(void **state)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+
+    (void)state;
+
+    if (mkdtemp(dir) == NULL)
+        return -1;
+    server.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server.fd < 0)
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(server.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server.fd, 8) != 0 ||
+        getsockname(server.fd, (struct sockaddr *)&addr, &addrlen) != 0)
+        return -1;
+    server.port = ntohs(addr.sin_port);
+    if (pthread_create(&server.thread, NULL, server_thread, NULL) != 0)
+        return -1;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    (void)state;
+
+    shutdown(server.fd, SHUT_RDWR);
+    pthread_join(server.thread, NULL);
+    close(server.fd);
+    remove_files();
+    rmdir(dir);
+    return 0;
+}
+
+/* Every test starts with an empty cache. */
+static int
+setup_test(void **state)
+{
+    (void)state;
+
+    if (remove_files() != 0)
+        return -1;
+    return setenv(ENV_FAPI_CERT_CACHE, dir, 1);
+}
+
+static void
+check_max_age(void **state)
+{
+    (void)state;
+
+    respond(200, "Cache-Control: max-age=3600\r\n", NULL, "certificate");
+    get(url("/ca.crt"), "certificate");
+    get(url("/ca.crt"), "certificate");
+    assert_int_equal(requests(), 1);
+    assert_int_equal(count_files("url-"), 1);
+    assert_int_equal(count_files("obj-"), 1);
+
+    /* Age is subtracted from the lifetime. */
+    respond(200, "Cache-Control: max-age=60\r\nAge: 120\r\n", NULL, "old");
+    get(url("/aged.crt"), "old");
+    get(url("/aged.crt"), "old");
+    assert_int_equal(requests(), 2);
+}
+
+static void
+check_no_store(void **state)
+{
+    (void)state;
+
+    respond(200, "Cache-Control: public, no-store\r\n", NULL, "crl");
+    get(url("/ca.crl"), "crl");
+    get(url("/ca.crl"), "crl");
+    assert_int_equal(requests(), 2);
+    assert_int_equal(count_files("url-"), 0);
+    assert_int_equal(count_files("obj-"), 0);
+}
+
+static void
+check_expires(void **state)
+{
+    (void)state;
+
+    respond(200, "Date: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+            "Expires: Wed, 21 Oct 2015 07:28:00 GMT\r\n", NULL, "expired");
+    get(url("/expired.crl"), "expired");
+    get(url("/expired.crl"), "expired");
+    assert_int_equal(requests(), 2);
+    assert_int_equal(count_files("url-"), 0);
+
+    respond(200, "Date: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+            "Expires: Wed, 21 Oct 2015 08:28:00 GMT\r\n", NULL, "valid");
+    get(url("/valid.crl"), "valid");
+    get(url("/valid.crl"), "valid");
+    assert_int_equal(requests(), 1);
+}
+
+static void
+check_revalidate(void **state)
+{
+    (void)state;
+
+    respond(200, "Cache-Control: no-cache\r\n", "\"v1\"", "version 1");
+    get(url("/ca.crl"), "version 1");
+    assert_int_equal(requests(), 1);
+    assert_if_none_match("");
+
+    /* The server confirms the cached copy without sending it again. */
+    get(url("/ca.crl"), "version 1");
+    assert_int_equal(requests(), 2);
+    assert_if_none_match("\"v1\"");
+
+    /* A new version replaces the cached object. */
+    respond(200, "Cache-Control: no-cache\r\n", "\"v2\"", "version 2");
+    get(url("/ca.crl"), "version 2");
+    assert_int_equal(requests(), 1);
+    assert_int_equal(count_files("obj-"), 1);
+}
+
+static void
+check_content_addressed(void **state)
+{
+    (void)state;
+
+    respond(200, "Cache-Control: max-age=3600\r\n", NULL, "same content");
+    get(url("/a.crt"), "same content");
+    get(url("/b.crt"), "same content");
+    get(url("/a.crt"), "same content");
+    get(url("/b.crt"), "same content");
+    assert_int_equal(requests(), 2);
+    assert_int_equal(count_files("url-"), 2);
+    assert_int_equal(count_files("obj-"), 1);
+}
+
+static void
+check_expire(void **state)
+{
+    (void)state;
+
+    respond(200, "Cache-Control: max-age=3600\r\n", NULL, "crl");
+    get(url("/ca.crl"), "crl");
+    ifapi_curl_cache_expire(url("/ca.crl"), time(NULL) + 60);
+    get(url("/ca.crl"), "crl");
+    assert_int_equal(requests(), 1);
+
+    /* The next update of the CRL is due. */
+    ifapi_curl_cache_expire(url("/ca.crl"), time(NULL) - 1);
+    get(url("/ca.crl"), "crl");
+    assert_int_equal(requests(), 2);
+}
+
+static void
+check_errors(void **state)
+{
+    unsigned char *buffer = NULL;
+    size_t size;
+
+    (void)state;
+
+    /* Error responses are passed through but not cached. */
+    respond(404, "Cache-Control: max-age=3600\r\n", NULL, "not found");
+    get(url("/missing.crl"), "not found");
+    get(url("/missing.crl"), "not found");
+    assert_int_equal(requests(), 2);
+    assert_int_equal(count_files("url-"), 0);
+
+    /* A stale copy is not used if the server can not be reached. */
+    respond(200, "Cache-Control: no-cache\r\n", "\"v1\"", "crl");
+    get(url("/ca.crl"), "crl");
+    respond(0, "", "\"v1\"", "");
+    assert_int_not_equal(ifapi_curl_cache_get(url("/ca.crl"), &buffer, &size),
+                         TSS2_RC_SUCCESS);
+    assert_int_equal(requests(), 1);
+    assert_null(buffer);
+}
+
+static void
+check_disabled(void **state)
+{
+    (void)state;
+
+    unsetenv(ENV_FAPI_CERT_CACHE);
+    respond(200, "Cache-Control: max-age=3600\r\n", NULL, "certificate");
+    get(url("/ca.crt"), "certificate");
+    get(url("/ca.crt"), "certificate");
+    assert_int_equal(requests(), 2);
+    assert_int_equal(count_files("url-"), 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(check_max_age, setup_test),
+        cmocka_unit_test_setup(check_no_store, setup_test),
+        cmocka_unit_test_setup(check_expires, setup_test),
+        cmocka_unit_test_setup(check_revalidate, setup_test),
+        cmocka_unit_test_setup(check_content_addressed, setup_test),
+        cmocka_unit_test_setup(check_expire, setup_test),
+        cmocka_unit_test_setup(check_errors, setup_test),
+        cmocka_unit_test_setup(check_disabled, setup_test),
+    };
+
+    (void)argc;
+    (void)argv;
+
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
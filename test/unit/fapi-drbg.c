@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "fapi_int.h"
+#include "fapi_crypto.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/* NIST CAVP HMAC_DRBG, SHA-256, no prediction resistance, COUNT = 0:
+   EntropyInput || Nonce and the ReturnedBits of the second generate call. */
+static const uint8_t seed[IFAPI_DRBG_SEED_SIZE] = {
+    0xca, 0x85, 0x19, 0x11, 0x34, 0x93, 0x84, 0xbf, 0xfe, 0x89, 0xde, 0x1c,
+    0xbd, 0xc4, 0x6e, 0x68, 0x31, 0xe4, 0x4d, 0x34, 0xa4, 0xfb, 0x93, 0x5e,
+    0xe2, 0x85, 0xdd, 0x14, 0xb7, 0x1a, 0x74, 0x88, 0x65, 0x9b, 0xa9, 0x6c,
+    0x60, 0x1d, 0xc6, 0x9f, 0xc9, 0x02, 0x94, 0x08, 0x05, 0xec, 0x0c, 0xa8
+};
+
+static const uint8_t returned_bits[128] = {
+    0xe5, 0x28, 0xe9, 0xab, 0xf2, 0xde, 0xce, 0x54, 0xd4, 0x7c, 0x7e, 0x75,
+    0xe5, 0xfe, 0x30, 0x21, 0x49, 0xf8, 0x17, 0xea, 0x9f, 0xb4, 0xbe, 0xe6,
+    0xf4, 0x19, 0x96, 0x97, 0xd0, 0x4d, 0x5b, 0x89, 0xd5, 0x4f, 0xbb, 0x97,
+    0x8a, 0x15, 0xb5, 0xc4, 0x43, 0xc9, 0xec, 0x21, 0x03, 0x6d, 0x24, 0x60,
+    0xb6, 0xf7, 0x3e, 0xba, 0xd0, 0xdc, 0x2a, 0xba, 0x6e, 0x62, 0x4a, 0xbf,
+    0x07, 0x74, 0x5b, 0xc1, 0x07, 0x69, 0x4b, 0xb7, 0x54, 0x7b, 0xb0, 0x99,
+    0x5f, 0x70, 0xde, 0x25, 0xd6, 0xb2, 0x9e, 0x2d, 0x30, 0x11, 0xbb, 0x19,
+    0xd2, 0x76, 0x76, 0xc0, 0x71, 0x62, 0xc8, 0xb5, 0xcc, 0xde, 0x06, 0x68,
+    0x96, 0x1d, 0xf8, 0x68, 0x03, 0x48, 0x2c, 0xb3, 0x7e, 0xd6, 0xd5, 0xc0,
+    0xbb, 0x8d, 0x50, 0xcf, 0x1f, 0x50, 0xd4, 0x76, 0xaa, 0x04, 0x58, 0xbd,
+    0xab, 0xa8, 0x06, 0xf4, 0x8b, 0xe9, 0xdc, 0xb8
+};
+
+static void
+check_drbg_known_answer(void **state)
+{
+    TSS2_RC r;
+    IFAPI_DRBG drbg = { 0 };
+    uint8_t data[sizeof(returned_bits)];
+
+    r = ifapi_drbg_seed(&drbg, &seed[0], sizeof(seed));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    r = ifapi_drbg_generate(&drbg, &data[0], sizeof(data));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = ifapi_drbg_generate(&drbg, &data[0], sizeof(data));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_memory_equal(&data[0], &returned_bits[0], sizeof(data));
+
+    ifapi_drbg_cleanup(&drbg);
+    assert_false(drbg.seeded);
+}
+
+static void
+check_drbg_budget(void **state)
+{
+    TSS2_RC r;
+    IFAPI_DRBG drbg = { 0 };
+    uint8_t *data;
+    size_t size = 2 * IFAPI_DRBG_MAX_REQUEST + 100;
+
+    /* An unseeded generator must be seeded first. */
+    assert_int_equal(ifapi_drbg_available(&drbg, 1000, 0), 0);
+    data = malloc(size);
+    assert_non_null(data);
+    r = ifapi_drbg_generate(&drbg, data, 16);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_SEQUENCE);
+
+    r = ifapi_drbg_seed(&drbg, &seed[0], sizeof(seed));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(ifapi_drbg_available(&drbg, size, 60), size);
+
+    /* Requests larger than one generate operation are split. */
+    r = ifapi_drbg_generate(&drbg, data, size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_memory_not_equal(data, data + IFAPI_DRBG_MAX_REQUEST, 64);
+    assert_int_equal(ifapi_drbg_available(&drbg, size, 60), 0);
+    assert_int_equal(ifapi_drbg_available(&drbg, size + 10, 60), 10);
+
+    /* A reseed restores the budget. */
+    r = ifapi_drbg_seed(&drbg, &seed[0], sizeof(seed));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(ifapi_drbg_available(&drbg, size, 60), size);
+
+    /* A seed of another process is not used. */
+    drbg.pid = drbg.pid + 1;
+    assert_int_equal(ifapi_drbg_available(&drbg, size, 60), 0);
+
+    ifapi_drbg_cleanup(&drbg);
+    free(data);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_drbg_known_answer),
+        cmocka_unit_test(check_drbg_budget),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
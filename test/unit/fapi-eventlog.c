@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <json-c/json.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "ifapi_eventlog.h"
+#include "ifapi_helpers.h"
+#include "ifapi_json_serialize.h"
+#include "fapi_crypto.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/* An event payload with brackets, braces and escaped quotes in strings. */
+static const char *nested_event =
+    "{ \"text\": \"a \\\"]}\\\" [{ \\\\\", "
+    "\"list\": [ [ 1, [ 2 ] ], { \"x\": \"}\" }, \"]\" ] }";
+
+/* Serialize an event with the given record number, digest and payload. */
+static char *
+event_text(UINT32 recnum, BYTE fill, const char *payload)
+{
+    IFAPI_EVENT event;
+    json_object *jso = NULL;
+    char *text;
+    TSS2_RC r;
+
+    memset(&event, 0, sizeof(event));
+    event.recnum = recnum;
+    event.pcr = recnum % 8;
+    event.type = IFAPI_TSS_EVENT_TAG;
+    event.sub_event.tss_event.data.size = 4;
+    memset(&event.sub_event.tss_event.data.buffer[0], recnum & 0xff, 4);
+    event.sub_event.tss_event.event = (char *)payload;
+    event.digests.count = 3;
+    event.digests.digests[0].hashAlg = TPM2_ALG_SHA256;
+    memset(&event.digests.digests[0].digest, fill, TPM2_SHA256_DIGEST_SIZE);
+    event.digests.digests[1].hashAlg = TPM2_ALG_SHA1;
+    memset(&event.digests.digests[1].digest, fill ^ 0x11, TPM2_SHA1_DIGEST_SIZE);
+    event.digests.digests[2].hashAlg = TPM2_ALG_SHA384;
+    memset(&event.digests.digests[2].digest, fill ^ 0x22, TPM2_SHA384_DIGEST_SIZE);
+
+    r = ifapi_json_IFAPI_EVENT_serialize(&event, &jso);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    text = strdup(json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PRETTY));
+    assert_non_null(text);
+    json_object_put(jso);
+    return text;
+}
+
+/* Walk a log and return the number of events or the first error. */
+static TSS2_RC
+count_events(const char *log, size_t size, size_t *n_events)
+{
+    IFAPI_EVENTLOG_ITER iter;
+    IFAPI_EVENT event;
+    bool done = false;
+    TSS2_RC r;
+
+    *n_events = 0;
+    r = ifapi_eventlog_iter_init(&iter, log, size);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+    while (true) {
+        memset(&event, 0, sizeof(event));
+        r = ifapi_eventlog_iter_next(&iter, &event, &done);
+        if (r != TSS2_RC_SUCCESS || done)
+            break;
+        assert_int_equal(event.recnum, *n_events + 1);
+        ifapi_cleanup_event(&event);
+        *n_events += 1;
+    }
+    ifapi_eventlog_iter_finish(&iter);
+    return r;
+}
+
+/* Build a log of n_events events; the digest of event changed differs. */
+static char *
+build_log(size_t n_events, size_t changed)
+{
+    char *log = NULL, *text, *grown;
+    size_t i, size = 0, length;
+
+    for (i = 1; i <= n_events; i++) {
+        text = event_text(i, i == changed ? 0xee : i & 0xff, NULL);
+        length = strlen(text);
+        grown = realloc(log, size + length + 4);
+        assert_non_null(grown);
+        log = grown;
+        size += sprintf(&log[size], "%s%s", i > 1 ? ",\n" : "[", text);
+        free(text);
+    }
+    if (log == NULL) {
+        log = malloc(4);
+        assert_non_null(log);
+        size += sprintf(&log[size], "[");
+    }
+    sprintf(&log[size], "]");
+    return log;
+}
+
+/* Replay a log and compare the result with a replay from scratch. */
+static void
+replay_matches_full(IFAPI_EVENTLOG_REPLAY *replay, const char *log)
+{
+    IFAPI_EVENTLOG_REPLAY full;
+    TPML_PCR_SELECTION selection;
+    size_t i;
+    TSS2_RC r;
+
+    memset(&selection, 0, sizeof(selection));
+    selection.count = 1;
+    selection.pcrSelections[0].hash = TPM2_ALG_SHA256;
+    selection.pcrSelections[0].sizeofSelect = 3;
+    selection.pcrSelections[0].pcrSelect[0] = 0xff;
+
+    r = ifapi_eventlog_replay(replay, &selection, log, strlen(log));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    memset(&full, 0, sizeof(full));
+    full.n_threads = 1;
+    r = ifapi_eventlog_replay(&full, &selection, log, strlen(log));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    assert_int_equal(replay->n_pcrs, 8);
+    assert_int_equal(replay->n_pcrs, full.n_pcrs);
+    for (i = 0; i < full.n_pcrs; i++) {
+        assert_int_equal(replay->pcrs[i].pcr, full.pcrs[i].pcr);
+        assert_int_equal(replay->pcrs[i].value.size, full.pcrs[i].value.size);
+        assert_memory_equal(&replay->pcrs[i].value.buffer[0],
+                            &full.pcrs[i].value.buffer[0],
+                            full.pcrs[i].value.size);
+    }
+    assert_int_equal(replay->n_checkpoints, full.n_checkpoints);
+    ifapi_eventlog_replay_cleanup(&full);
+}
+
+static void
+check_eventlog_iter_empty(void **state)
+{
+    static const char *logs[] = { "[]", "  [ \n\t]  \n", "", " \r\n\t " };
+    size_t i, n_events;
+
+    (void)state;
+
+    for (i = 0; i < sizeof(logs) / sizeof(logs[0]); i++) {
+        assert_int_equal(count_events(logs[i], strlen(logs[i]), &n_events),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(n_events, 0);
+    }
+}
+
+static void
+check_eventlog_iter_whitespace(void **state)
+{
+    char *e1 = event_text(1, 1, NULL), *e2 = event_text(2, 2, NULL);
+    char *e3 = event_text(3, 3, NULL);
+    char log[8192];
+    size_t n_events;
+
+    (void)state;
+
+    snprintf(log, sizeof(log), "\n [\n\t%s ,\r\n %s\n,%s\n]\n ", e1, e2, e3);
+    assert_int_equal(count_events(log, strlen(log), &n_events), TSS2_RC_SUCCESS);
+    assert_int_equal(n_events, 3);
+
+    /* The size limits the log, not the terminating zero. */
+    snprintf(log, sizeof(log), "[%s,%s]garbage", e1, e2);
+    assert_int_equal(count_events(log, strlen(log) - 7, &n_events),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(n_events, 2);
+
+    /* A log may consist of one event without an array. */
+    snprintf(log, sizeof(log), " %s\n", e1);
+    assert_int_equal(count_events(log, strlen(log), &n_events), TSS2_RC_SUCCESS);
+    assert_int_equal(n_events, 1);
+
+    free(e1);
+    free(e2);
+    free(e3);
+}
+
+static void
+check_eventlog_iter_nested(void **state)
+{
+    char *e1 = event_text(1, 1, nested_event), *e2 = event_text(2, 2, NULL);
+    char log[8192];
+    json_object *jso;
+    IFAPI_EVENTLOG_ITER iter;
+    IFAPI_EVENT event;
+    bool done = false;
+    TSS2_RC r;
+
+    (void)state;
+
+    snprintf(log, sizeof(log), "[%s,%s]", e1, e2);
+    r = ifapi_eventlog_iter_init(&iter, log, strlen(log));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The brackets and quotes inside the payload do not end the event. */
+    memset(&event, 0, sizeof(event));
+    r = ifapi_eventlog_iter_next(&iter, &event, &done);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_false(done);
+    assert_int_equal(event.recnum, 1);
+    jso = json_tokener_parse(nested_event);
+    assert_non_null(jso);
+    assert_string_equal(event.sub_event.tss_event.event,
+                        json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PRETTY));
+    json_object_put(jso);
+    ifapi_cleanup_event(&event);
+
+    memset(&event, 0, sizeof(event));
+    r = ifapi_eventlog_iter_next(&iter, &event, &done);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_false(done);
+    assert_int_equal(event.recnum, 2);
+    ifapi_cleanup_event(&event);
+
+    r = ifapi_eventlog_iter_next(&iter, &event, &done);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_true(done);
+    ifapi_eventlog_iter_finish(&iter);
+
+    free(e1);
+    free(e2);
+}
+
+static void
+check_eventlog_iter_truncated(void **state)
+{
+    char *e1 = event_text(1, 1, nested_event), *e2 = event_text(2, 2, NULL);
+    char log[8192];
+    size_t size, length, n_events;
+
+    (void)state;
+
+    /* Every prefix which lacks the closing bracket is rejected. */
+    length = snprintf(log, sizeof(log), "[ %s, %s ]", e1, e2);
+    for (size = 1; size < length; size++) {
+        assert_int_equal(count_events(log, size, &n_events),
+                         TSS2_FAPI_RC_BAD_VALUE);
+    }
+    assert_int_equal(count_events(log, length, &n_events), TSS2_RC_SUCCESS);
+    assert_int_equal(n_events, 2);
+
+    /* So is a single event without an array that is cut off. */
+    length = strlen(e1);
+    for (size = 1; size < length; size++) {
+        assert_int_equal(count_events(e1, size, &n_events),
+                         TSS2_FAPI_RC_BAD_VALUE);
+    }
+
+    free(e1);
+    free(e2);
+}
+
+static void
+check_eventlog_iter_invalid(void **state)
+{
+    char *e1 = event_text(1, 1, NULL), *e2 = event_text(2, 2, NULL);
+    const char *formats[] = {
+        "[%s %s]",              /* missing separator */
+        "[,%s,%s]",             /* leading separator */
+        "[%s,,%s]",             /* double separator */
+        "[%s,%s,]",             /* trailing separator */
+        "[%s,%s]}",             /* trailing data */
+        "[%s,%s",               /* missing bracket */
+        "[%s,1,%s]",            /* element which is no object */
+        "%s,%s",                /* two events without an array */
+    };
+    char log[8192];
+    size_t i, n_events;
+
+    (void)state;
+
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        snprintf(log, sizeof(log), formats[i], e1, e2);
+        assert_int_equal(count_events(log, strlen(log), &n_events),
+                         TSS2_FAPI_RC_BAD_VALUE);
+    }
+
+    free(e1);
+    free(e2);
+}
+
+static void
+check_eventlog_replay_resume(void **state)
+{
+    IFAPI_EVENTLOG_REPLAY replay;
+    char *log;
+    size_t threads;
+
+    (void)state;
+
+    for (threads = 1; threads <= 2; threads++) {
+        memset(&replay, 0, sizeof(replay));
+        replay.n_threads = threads;
+
+        /* Checkpoints after 1024 and 2048 events and at the end. */
+        log = build_log(2500, 0);
+        replay_matches_full(&replay, log);
+        assert_int_equal(replay.n_checkpoints, 3);
+        free(log);
+
+        /* Events appended to the log are replayed from the checkpoints. */
+        log = build_log(3100, 0);
+        replay_matches_full(&replay, log);
+        assert_int_equal(replay.n_checkpoints, 4);
+        free(log);
+
+        /* The same log again. */
+        log = build_log(3100, 0);
+        replay_matches_full(&replay, log);
+        free(log);
+
+        ifapi_eventlog_replay_cleanup(&replay);
+    }
+}
+
+static void
+check_eventlog_replay_changed(void **state)
+{
+    IFAPI_EVENTLOG_REPLAY replay;
+    char *log;
+
+    (void)state;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.n_threads = 1;
+
+    log = build_log(2500, 0);
+    replay_matches_full(&replay, log);
+    free(log);
+
+    /* An event rewritten before the first checkpoint invalidates all. */
+    log = build_log(2600, 10);
+    replay_matches_full(&replay, log);
+    free(log);
+
+    /* An event rewritten between the checkpoints invalidates the later ones. */
+    log = build_log(2600, 1500);
+    replay_matches_full(&replay, log);
+    free(log);
+
+    /* A log truncated behind the first checkpoint. */
+    log = build_log(1500, 1500);
+    replay_matches_full(&replay, log);
+    assert_int_equal(replay.n_checkpoints, 2);
+    free(log);
+
+    /* A log truncated before the first checkpoint. */
+    log = build_log(500, 0);
+    replay_matches_full(&replay, log);
+    assert_int_equal(replay.n_checkpoints, 1);
+    free(log);
+
+    /* An empty log. */
+    log = build_log(0, 0);
+    replay_matches_full(&replay, log);
+    free(log);
+
+    /* A log which grows again from scratch. */
+    log = build_log(2100, 0);
+    replay_matches_full(&replay, log);
+    free(log);
+
+    ifapi_eventlog_replay_cleanup(&replay);
+}
+
+/* Compare the batched extends of a replay with extending every selected
+ * PCR event by event. Several banks and more PCRs than the lanes of the
+ * multi-buffer kernel are selected. */
+static void
+check_eventlog_replay_banks(void **state)
+{
+    IFAPI_EVENTLOG_REPLAY replay;
+    TPML_PCR_SELECTION selection;
+    IFAPI_EVENTLOG_ITER iter;
+    IFAPI_EVENT event;
+    TPM2B_DIGEST expected[3 * TPM2_MAX_PCRS];
+    bool done = false;
+    size_t i, threads;
+    char *log;
+    TSS2_RC r;
+
+    (void)state;
+
+    memset(&selection, 0, sizeof(selection));
+    selection.count = 3;
+    selection.pcrSelections[0].hash = TPM2_ALG_SHA1;
+    selection.pcrSelections[0].sizeofSelect = 3;
+    selection.pcrSelections[0].pcrSelect[0] = 0x0f;
+    selection.pcrSelections[1].hash = TPM2_ALG_SHA256;
+    selection.pcrSelections[1].sizeofSelect = 3;
+    memset(&selection.pcrSelections[1].pcrSelect[0], 0xff, 3);
+    selection.pcrSelections[2].hash = TPM2_ALG_SHA384;
+    selection.pcrSelections[2].sizeofSelect = 3;
+    selection.pcrSelections[2].pcrSelect[2] = 0x81;
+
+    log = build_log(700, 0);
+
+    for (threads = 1; threads <= 3; threads++) {
+        memset(&replay, 0, sizeof(replay));
+        replay.n_threads = threads;
+        r = ifapi_eventlog_replay(&replay, &selection, log, strlen(log));
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(replay.n_pcrs, 4 + 24 + 2);
+
+        for (i = 0; i < replay.n_pcrs; i++) {
+            memset(&expected[i], 0, sizeof(expected[i]));
+            expected[i].size = ifapi_hash_get_digest_size(replay.pcrs[i].bank);
+        }
+        r = ifapi_eventlog_iter_init(&iter, log, strlen(log));
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        while (true) {
+            memset(&event, 0, sizeof(event));
+            r = ifapi_eventlog_iter_next(&iter, &event, &done);
+            assert_int_equal(r, TSS2_RC_SUCCESS);
+            if (done)
+                break;
+            for (i = 0; i < replay.n_pcrs; i++) {
+                r = ifapi_extend_vpcr(&expected[i], replay.pcrs[i].bank,
+                                      &event.digests);
+                assert_int_equal(r, TSS2_RC_SUCCESS);
+            }
+            ifapi_cleanup_event(&event);
+        }
+        ifapi_eventlog_iter_finish(&iter);
+
+        for (i = 0; i < replay.n_pcrs; i++) {
+            assert_int_equal(replay.pcrs[i].value.size, expected[i].size);
+            assert_memory_equal(&replay.pcrs[i].value.buffer[0],
+                                &expected[i].buffer[0], expected[i].size);
+        }
+        ifapi_eventlog_replay_cleanup(&replay);
+    }
+    free(log);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_eventlog_iter_empty),
+        cmocka_unit_test(check_eventlog_iter_whitespace),
+        cmocka_unit_test(check_eventlog_iter_nested),
+        cmocka_unit_test(check_eventlog_iter_truncated),
+        cmocka_unit_test(check_eventlog_iter_invalid),
+        cmocka_unit_test(check_eventlog_replay_resume),
+        cmocka_unit_test(check_eventlog_replay_changed),
+        cmocka_unit_test(check_eventlog_replay_banks),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,439 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "ifapi_io.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+#define N_FILES (IFAPI_IO_PREFETCH_MAX + 4)
+
+static char dir[] = "/tmp/fapi-io-XXXXXX";
+
+static char *
+file_name(size_t i)
+{
+    static char name[sizeof(dir) + 32];
+
+    snprintf(name, sizeof(name), "%s/file%zu", dir, i);
+    return name;
+}
+
+static void
+write_file(IFAPI_IO *io, const char *name, const char *data)
+{
+    TSS2_RC r;
+
+    r = ifapi_io_write_async(io, name, (const uint8_t *) data, strlen(data));
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    while ((r = ifapi_io_write_finish(io)) == TSS2_FAPI_RC_TRY_AGAIN)
+        assert_int_equal(ifapi_io_poll(io), TSS2_RC_SUCCESS);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static TSS2_RC
+read_file(IFAPI_IO *io, const char *name, char **data)
+{
+    TSS2_RC r;
+    size_t length;
+
+    r = ifapi_io_read_async(io, name);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    while ((r = ifapi_io_read_finish(io, (uint8_t **) data, &length)) ==
+           TSS2_FAPI_RC_TRY_AGAIN)
+        assert_int_equal(ifapi_io_poll(io), TSS2_RC_SUCCESS);
+    if (r == TSS2_RC_SUCCESS)
+        assert_int_equal(strlen(*data), length);
+    return r;
+}
+
+static int
+setup(void **state)
+{
+    (void)state;
+
+    return mkdtemp(dir) == NULL ? -1 : 0;
+}
+
+static int
+teardown(void **state)
+{
+    size_t i;
+
+    (void)state;
+
+    for (i = 0; i < N_FILES; i++)
+        unlink(file_name(i));
+    return rmdir(dir);
+}
+
+static void
+check_io_write_read(void **state)
+{
+    IFAPI_IO io = { 0 };
+    FAPI_POLL_HANDLE *handles;
+    size_t num_handles;
+    char *data;
+
+    (void)state;
+
+    /* No handle is returned while no operation is in progress. */
+    assert_int_equal(ifapi_io_poll_handles(&io, &handles, &num_handles),
+                     TSS2_FAPI_RC_NO_HANDLE);
+
+    write_file(&io, file_name(0), "first content");
+    assert_int_equal(read_file(&io, file_name(0), &data), TSS2_RC_SUCCESS);
+    assert_string_equal(data, "first content");
+    free(data);
+
+    /* The file is truncated by a shorter write. */
+    write_file(&io, file_name(0), "second");
+    assert_int_equal(read_file(&io, file_name(0), &data), TSS2_RC_SUCCESS);
+    assert_string_equal(data, "second");
+    free(data);
+
+    /* The read end of the notification pipe is used as poll handle. */
+    assert_int_equal(ifapi_io_read_async(&io, file_name(0)), TSS2_RC_SUCCESS);
+    while (ifapi_io_read_finish(&io, (uint8_t **) &data, NULL) ==
+           TSS2_FAPI_RC_TRY_AGAIN) {
+        assert_int_equal(ifapi_io_poll_handles(&io, &handles, &num_handles),
+                         TSS2_RC_SUCCESS);
+        assert_int_equal(num_handles, 1);
+        assert_int_equal(handles[0].fd, io.notify[0]);
+        free(handles);
+        assert_int_equal(ifapi_io_poll(&io), TSS2_RC_SUCCESS);
+    }
+    assert_string_equal(data, "second");
+    free(data);
+
+    ifapi_io_cleanup(&io);
+}
+
+static void
+check_io_errors(void **state)
+{
+    IFAPI_IO io = { 0 };
+    char *data = NULL;
+
+    (void)state;
+
+    /* Errors of the workers are returned by the finish function. */
+    assert_int_equal(read_file(&io, file_name(N_FILES), &data),
+                     TSS2_FAPI_RC_IO_ERROR);
+    assert_null(data);
+
+    assert_int_equal(ifapi_io_write_finish(&io), TSS2_FAPI_RC_BAD_SEQUENCE);
+    ifapi_io_cleanup(&io);
+}
+
+static void
+check_io_prefetch(void **state)
+{
+    IFAPI_IO io = { 0 };
+    char content[32], *data;
+    size_t i;
+
+    (void)state;
+
+    for (i = 0; i < N_FILES; i++) {
+        snprintf(content, sizeof(content), "content %zu", i);
+        write_file(&io, file_name(i), content);
+    }
+
+    /* Only IFAPI_IO_PREFETCH_MAX files are read ahead. */
+    for (i = 1; i < N_FILES; i++)
+        assert_int_equal(ifapi_io_read_prefetch(&io, file_name(i)), TSS2_RC_SUCCESS);
+    assert_int_equal(io.n_prefetched, IFAPI_IO_PREFETCH_MAX);
+    assert_int_equal(ifapi_io_read_prefetch(&io, file_name(1)), TSS2_RC_SUCCESS);
+    assert_int_equal(io.n_prefetched, IFAPI_IO_PREFETCH_MAX);
+
+    /* Reads of prefetched files use the reads already started. */
+    for (i = 1; i <= IFAPI_IO_PREFETCH_MAX; i++) {
+        assert_int_equal(read_file(&io, file_name(i), &data), TSS2_RC_SUCCESS);
+        snprintf(content, sizeof(content), "content %zu", i);
+        assert_string_equal(data, content);
+        free(data);
+        assert_int_equal(io.n_prefetched, IFAPI_IO_PREFETCH_MAX - i);
+    }
+
+    /* A read of another file drops the prefetched ones. */
+    assert_int_equal(ifapi_io_read_prefetch(&io, file_name(N_FILES - 1)),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(read_file(&io, file_name(0), &data), TSS2_RC_SUCCESS);
+    assert_string_equal(data, "content 0");
+    free(data);
+    assert_int_equal(io.n_prefetched, 0);
+
+    /* A write drops them as they might deliver the old content. */
+    assert_int_equal(ifapi_io_read_prefetch(&io, file_name(0)), TSS2_RC_SUCCESS);
+    write_file(&io, file_name(0), "changed");
+    assert_int_equal(io.n_prefetched, 0);
+    assert_int_equal(read_file(&io, file_name(0), &data), TSS2_RC_SUCCESS);
+    assert_string_equal(data, "changed");
+    free(data);
+
+    ifapi_io_cleanup(&io);
+}
+
+static void
+check_io_cleanup_pending(void **state)
+{
+    IFAPI_IO io1 = { 0 }, io2 = { 0 };
+    size_t i;
+
+    (void)state;
+
+    /* Jobs which are not finished are dropped by the cleanup. */
+    for (i = 0; i < N_FILES; i++)
+        assert_int_equal(ifapi_io_read_prefetch(&io1, file_name(i)), TSS2_RC_SUCCESS);
+    assert_int_equal(ifapi_io_read_async(&io1, file_name(0)), TSS2_RC_SUCCESS);
+    assert_int_equal(ifapi_io_write_async(&io2, file_name(1),
+                                          (const uint8_t *) "x", 1), TSS2_RC_SUCCESS);
+
+    ifapi_io_cleanup(&io1);
+    assert_false(io1.notify_open);
+    assert_null(io1.job);
+    ifapi_io_cleanup(&io2);
+
+    /* A context can be used again after the cleanup. */
+    write_file(&io1, file_name(1), "again");
+    ifapi_io_cleanup(&io1);
+}
+
+/* More than fits into a pipe, so the writer blocks until it is read. */
+#define FORK_WRITE_SIZE (1024 * 1024)
+
+static void
+check_io_fork(void **state)
+{
+    IFAPI_IO io = { 0 };
+    char fifo[sizeof(dir) + 32], buffer[4096];
+    struct pollfd pfd;
+    uint8_t *data;
+    size_t received = 0;
+    ssize_t ret;
+    pid_t pid;
+    int status, go[2];
+    TSS2_RC r;
+
+    (void)state;
+
+    snprintf(fifo, sizeof(fifo), "%s/fifo", dir);
+    assert_int_equal(mkfifo(fifo, 0600), 0);
+    assert_int_equal(pipe(go), 0);
+    data = malloc(FORK_WRITE_SIZE);
+    assert_non_null(data);
+    memset(data, 'x', FORK_WRITE_SIZE);
+
+    /* Start a write which blocks in the worker until the FIFO is read. */
+    r = ifapi_io_write_async(&io, fifo, data, FORK_WRITE_SIZE);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    pfd.fd = open(fifo, O_RDONLY | O_NONBLOCK);
+    assert_true(pfd.fd >= 0);
+    pfd.events = POLLIN;
+    assert_int_equal(poll(&pfd, 1, 10000), 1);
+
+    pid = fork();
+    assert_true(pid >= 0);
+    if (pid == 0) {
+        /* The write was in flight in the parent and has to fail here. Done
+           a second time, after the parent's write finished, it would block
+           on the FIFO nobody reads or succeed. */
+        alarm(10);
+        close(pfd.fd);
+        close(go[1]);
+        if (read(go[0], buffer, 1) != 1)
+            _exit(2);
+        while ((r = ifapi_io_write_finish(&io)) == TSS2_FAPI_RC_TRY_AGAIN)
+            ifapi_io_poll(&io);
+        _exit(r == TSS2_FAPI_RC_IO_ERROR ? 0 : 1);
+    }
+    close(go[0]);
+
+    /* The parent's worker is not affected by the fork. */
+    while ((r = ifapi_io_write_finish(&io)) == TSS2_FAPI_RC_TRY_AGAIN) {
+        ret = read(pfd.fd, buffer, sizeof(buffer));
+        if (ret > 0)
+            received += ret;
+        else
+            poll(&pfd, 1, 100);
+    }
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    while ((ret = read(pfd.fd, buffer, sizeof(buffer))) > 0)
+        received += ret;
+    assert_int_equal(received, FORK_WRITE_SIZE);
+
+    /* Let the child finish its copy of the write. */
+    assert_int_equal(write(go[1], "", 1), 1);
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+
+    close(go[1]);
+    close(pfd.fd);
+    ifapi_io_cleanup(&io);
+    free(data);
+    unlink(fifo);
+}
+
+static char *
+tree_path(const char *name)
+{
+    static char path[sizeof(dir) + 32];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return path;
+}
+
+/* Move the modification time of a directory out of the racy window. */
+static void
+age_dir(const char *name)
+{
+    struct timespec times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+
+    assert_int_equal(utimensat(AT_FDCWD, tree_path(name), times, 0), 0);
+}
+
+static void
+touch(const char *name)
+{
+    int fd = open(tree_path(name), O_WRONLY | O_CREAT, 0600);
+
+    assert_true(fd >= 0);
+    close(fd);
+}
+
+static bool
+listed(char **paths, size_t first, size_t last, const char *name)
+{
+    size_t i;
+
+    for (i = first; i < last; i++) {
+        if (strcmp(paths[i], tree_path(name)) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void
+free_paths(char **paths, size_t num_paths)
+{
+    size_t i;
+
+    for (i = 0; i < num_paths; i++)
+        free(paths[i]);
+    free(paths);
+}
+
+static void
+check_io_dirfiles_all(void **state)
+{
+    const char *roots[3];
+    char *root0, *root1, **paths;
+    size_t num_paths;
+    TSS2_RC r;
+
+    (void)state;
+
+    assert_int_equal(mkdir(tree_path("system"), 0700), 0);
+    assert_int_equal(mkdir(tree_path("system/sub"), 0700), 0);
+    assert_int_equal(mkdir(tree_path("system/sub/deeper"), 0700), 0);
+    assert_int_equal(mkdir(tree_path("user"), 0700), 0);
+    touch("system/a");
+    touch("system/sub/b");
+    touch("system/sub/deeper/c");
+    touch("user/d");
+    age_dir("system");
+    age_dir("system/sub");
+    age_dir("system/sub/deeper");
+    age_dir("user");
+
+    root0 = strdup(tree_path("system"));
+    root1 = strdup(tree_path("user"));
+    assert_non_null(root0);
+    assert_non_null(root1);
+    roots[0] = root0;
+    roots[1] = tree_path("missing");
+    roots[2] = root1;
+
+    /* The files of each directory follow the ones of the previous one. */
+    r = ifapi_io_dirfiles_all_multi(roots, 3, &paths, &num_paths);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(num_paths, 4);
+    assert_true(listed(paths, 0, 3, "system/a"));
+    assert_true(listed(paths, 0, 3, "system/sub/b"));
+    assert_true(listed(paths, 0, 3, "system/sub/deeper/c"));
+    assert_true(listed(paths, 3, 4, "user/d"));
+    free_paths(paths, num_paths);
+
+    /* Unchanged directories are served from the cache. A change which keeps
+       the modification time of the directory is not noticed. */
+    unlink(tree_path("system/sub/b"));
+    age_dir("system/sub");
+    r = ifapi_io_dirfiles_all(root0, &paths, &num_paths);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(num_paths, 3);
+    assert_true(listed(paths, 0, 3, "system/sub/b"));
+    free_paths(paths, num_paths);
+
+    /* A modified directory invalidates the cached tree. */
+    touch("system/sub/deeper/e");
+    r = ifapi_io_dirfiles_all(root0, &paths, &num_paths);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(num_paths, 3);
+    assert_false(listed(paths, 0, 3, "system/sub/b"));
+    assert_true(listed(paths, 0, 3, "system/sub/deeper/e"));
+    free_paths(paths, num_paths);
+
+    /* Directories which do not exist contain no files. */
+    r = ifapi_io_dirfiles_all(tree_path("missing"), &paths, &num_paths);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(num_paths, 0);
+    assert_null(paths);
+
+    unlink(tree_path("system/a"));
+    unlink(tree_path("system/sub/deeper/c"));
+    unlink(tree_path("system/sub/deeper/e"));
+    unlink(tree_path("user/d"));
+    rmdir(tree_path("system/sub/deeper"));
+    rmdir(tree_path("system/sub"));
+    rmdir(tree_path("system"));
+    rmdir(tree_path("user"));
+    free(root0);
+    free(root1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_io_write_read),
+        cmocka_unit_test(check_io_errors),
+        cmocka_unit_test(check_io_prefetch),
+        cmocka_unit_test(check_io_cleanup_pending),
+        cmocka_unit_test(check_io_fork),
+        cmocka_unit_test(check_io_dirfiles_all),
+    };
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
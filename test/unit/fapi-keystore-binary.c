@@ -0,0 +1,385 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <json-c/json.h>
+
+#include "tss2_mu.h"
+#include "ifapi_helpers.h"
+#include "ifapi_keystore.h"
+#include "ifapi_keystore_binary.h"
+#include "ifapi_json_serialize.h"
+#include "ifapi_policy_json_deserialize.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+static uint8_t blob[64] = { 0xa5, 0x5a, 0x00, 0xff };
+
+static const char *policy_json =
+    "{ \"description\": \"Description pol_auth_value\","
+    "  \"policy\": [ { \"type\": \"POLICYAUTHVALUE\" } ] }";
+
+static TPMS_POLICY *
+policy(void)
+{
+    json_object *jso = json_tokener_parse(policy_json);
+    TPMS_POLICY *policy = calloc(1, sizeof(*policy));
+
+    assert_non_null(jso);
+    assert_non_null(policy);
+    assert_int_equal(ifapi_json_TPMS_POLICY_deserialize(jso, policy),
+                     TSS2_RC_SUCCESS);
+    json_object_put(jso);
+    return policy;
+}
+
+/* Set the size of a TPM2B the way unmarshalling it would. */
+#define SET_SIZE(tpm2b, type, member) \
+    do { \
+        size_t size_; \
+        assert_int_equal(Tss2_MU_##type##_Size(&(tpm2b)->member, &size_), \
+                         TSS2_RC_SUCCESS); \
+        (tpm2b)->size = size_; \
+    } while (0)
+
+static void
+fill_public(TPM2B_PUBLIC *public, TPMI_ALG_PUBLIC type)
+{
+    TPMT_PUBLIC *area = &public->publicArea;
+
+    area->type = type;
+    area->nameAlg = TPM2_ALG_SHA256;
+    area->objectAttributes = TPMA_OBJECT_USERWITHAUTH | TPMA_OBJECT_FIXEDTPM |
+        TPMA_OBJECT_FIXEDPARENT | TPMA_OBJECT_SENSITIVEDATAORIGIN;
+    if (type == TPM2_ALG_ECC) {
+        area->objectAttributes |= TPMA_OBJECT_SIGN_ENCRYPT;
+        area->parameters.eccDetail.symmetric.algorithm = TPM2_ALG_NULL;
+        area->parameters.eccDetail.scheme.scheme = TPM2_ALG_NULL;
+        area->parameters.eccDetail.curveID = TPM2_ECC_NIST_P256;
+        area->parameters.eccDetail.kdf.scheme = TPM2_ALG_NULL;
+        area->unique.ecc.x.size = 32;
+        memset(&area->unique.ecc.x.buffer[0], 0x11, 32);
+        area->unique.ecc.y.size = 32;
+        memset(&area->unique.ecc.y.buffer[0], 0x22, 32);
+    } else {
+        area->objectAttributes |= TPMA_OBJECT_SIGN_ENCRYPT;
+        area->parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_HMAC;
+        area->parameters.keyedHashDetail.scheme.details.hmac.hashAlg =
+            TPM2_ALG_SHA256;
+        area->unique.keyedHash.size = 32;
+        memset(&area->unique.keyedHash.buffer[0], 0x33, 32);
+    }
+    SET_SIZE(public, TPMT_PUBLIC, publicArea);
+}
+
+static void
+fill_key(IFAPI_OBJECT *object, TPMI_ALG_PUBLIC type, bool full)
+{
+    IFAPI_KEY *key = &object->misc.key;
+
+    memset(object, 0, sizeof(*object));
+    object->objectType = IFAPI_KEY_OBJ;
+    object->system = TPM2_YES;
+    fill_public(&key->public, type);
+    key->persistent_handle = full ? 0x81000001 : 0;
+    key->private.buffer = &blob[0];
+    key->private.size = sizeof(blob);
+    key->serialization.buffer = &blob[0];
+    key->serialization.size = full ? 16 : 0;
+    key->appData.buffer = &blob[0];
+    key->appData.size = full ? 4 : 0;
+    key->policyInstance = "";
+    key->description = full ? "Signing key" : "";
+    key->certificate = full ? "-----BEGIN CERTIFICATE-----" : "";
+    key->with_auth = TPM2_YES;
+    if (type != TPM2_ALG_KEYEDHASH) {
+        key->signing_scheme.scheme = TPM2_ALG_ECDSA;
+        key->signing_scheme.details.ecdsa.hashAlg = TPM2_ALG_SHA256;
+    }
+    key->name.size = 34;
+    memset(&key->name.name[0], 0x44, key->name.size);
+    if (full) {
+        key->creationData.creationData.pcrSelect.count = 1;
+        key->creationData.creationData.pcrSelect.pcrSelections[0].hash =
+            TPM2_ALG_SHA256;
+        key->creationData.creationData.pcrSelect.pcrSelections[0].sizeofSelect = 3;
+        key->creationData.creationData.locality = 1;
+        key->creationData.creationData.parentNameAlg = TPM2_ALG_SHA256;
+        key->creationData.creationData.parentName.size = 4;
+        key->creationData.creationData.parentQualifiedName.size = 4;
+        SET_SIZE(&key->creationData, TPMS_CREATION_DATA, creationData);
+        key->creationTicket.tag = TPM2_ST_CREATION;
+        key->creationTicket.hierarchy = TPM2_RH_OWNER;
+        key->creationTicket.digest.size = 32;
+        object->policy = policy();
+    }
+}
+
+static void
+fill_nv(IFAPI_OBJECT *object, bool full)
+{
+    IFAPI_NV *nv = &object->misc.nv;
+
+    memset(object, 0, sizeof(*object));
+    object->objectType = IFAPI_NV_OBJ;
+    nv->public.nvPublic.nvIndex = 0x01c00002;
+    nv->public.nvPublic.nameAlg = TPM2_ALG_SHA256;
+    nv->public.nvPublic.attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE |
+        (full ? TPM2_NT_EXTEND << TPMA_NV_TPM2_NT_SHIFT : 0);
+    nv->public.nvPublic.dataSize = full ? 32 : 64;
+    SET_SIZE(&nv->public, TPMS_NV_PUBLIC, nvPublic);
+    nv->serialization.buffer = &blob[0];
+    nv->serialization.size = 8;
+    nv->hierarchy = TPM2_RH_OWNER;
+    nv->policyInstance = "";
+    nv->description = full ? "PCR like NV index" : "";
+    nv->appData.buffer = &blob[0];
+    nv->appData.size = full ? 2 : 0;
+    nv->with_auth = TPM2_NO;
+    nv->event_log = full ? "[]" : NULL;
+    if (full)
+        object->policy = policy();
+}
+
+static void
+fill_hierarchy(IFAPI_OBJECT *object)
+{
+    IFAPI_HIERARCHY *hierarchy = &object->misc.hierarchy;
+
+    memset(object, 0, sizeof(*object));
+    object->objectType = IFAPI_HIERARCHY_OBJ;
+    object->system = TPM2_YES;
+    hierarchy->with_auth = TPM2_YES;
+    hierarchy->description = "Owner hierarchy";
+    hierarchy->authPolicy.size = 32;
+    memset(&hierarchy->authPolicy.buffer[0], 0x55, 32);
+}
+
+static void
+fill_ext_pub_key(IFAPI_OBJECT *object, bool full)
+{
+    IFAPI_EXT_PUB_KEY *ext = &object->misc.ext_pub_key;
+
+    memset(object, 0, sizeof(*object));
+    object->objectType = IFAPI_EXT_PUB_KEY_OBJ;
+    ext->pem_ext_public = "-----BEGIN PUBLIC KEY-----";
+    ext->certificate = full ? "-----BEGIN CERTIFICATE-----" : NULL;
+    if (full)
+        fill_public(&ext->public, TPM2_ALG_ECC);
+}
+
+/* Free the members a fill_* function allocated. */
+static void
+free_filled(IFAPI_OBJECT *object)
+{
+    if (object->policy != NULL) {
+        ifapi_cleanup_policy(object->policy);
+        free(object->policy);
+    }
+}
+
+static char *
+json_string(const IFAPI_OBJECT *object)
+{
+    json_object *jso = NULL;
+    char *string;
+
+    assert_int_equal(ifapi_json_IFAPI_OBJECT_serialize(object, &jso),
+                     TSS2_RC_SUCCESS);
+    string = strdup(json_object_to_json_string_ext(jso, JSON_C_TO_STRING_PLAIN));
+    assert_non_null(string);
+    json_object_put(jso);
+    return string;
+}
+
+/*
+ * Serialize an object, decode it again and check that the decoded object has
+ * the same JSON encoding and the same binary encoding as the original.
+ */
+static void
+round_trip(IFAPI_OBJECT *object)
+{
+    IFAPI_OBJECT decoded;
+    uint8_t *binary, *again;
+    size_t binary_size, again_size;
+    char *expected, *actual;
+    TSS2_RC r;
+
+    r = ifapi_binary_IFAPI_OBJECT_serialize(object, &binary, &binary_size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_true(ifapi_binary_object_p(binary, binary_size));
+
+    memset(&decoded, 0xff, sizeof(decoded));
+    r = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size, &decoded);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(decoded.objectType, object->objectType);
+    assert_int_equal(decoded.system, object->system);
+    assert_null(decoded.rel_path);
+    assert_int_equal(decoded.policy == NULL, object->policy == NULL);
+
+    expected = json_string(object);
+    actual = json_string(&decoded);
+    assert_string_equal(actual, expected);
+    free(expected);
+    free(actual);
+
+    r = ifapi_binary_IFAPI_OBJECT_serialize(&decoded, &again, &again_size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(again_size, binary_size);
+    assert_memory_equal(again, binary, binary_size);
+    free(again);
+
+    /* Every truncation is rejected and leaves nothing allocated. */
+    for (size_t size = 0; size < binary_size; size++) {
+        IFAPI_OBJECT truncated;
+
+        r = ifapi_binary_IFAPI_OBJECT_deserialize(binary, size, &truncated);
+        assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    }
+
+    ifapi_cleanup_ifapi_object(&decoded);
+    free(binary);
+}
+
+static void
+check_binary_key(void **state)
+{
+    IFAPI_OBJECT object;
+
+    (void)state;
+
+    fill_key(&object, TPM2_ALG_ECC, true);
+    round_trip(&object);
+    free_filled(&object);
+
+    fill_key(&object, TPM2_ALG_ECC, false);
+    round_trip(&object);
+    free_filled(&object);
+
+    /* Keyed hash objects are stored without a signing scheme. */
+    fill_key(&object, TPM2_ALG_KEYEDHASH, false);
+    round_trip(&object);
+    free_filled(&object);
+}
+
+static void
+check_binary_nv(void **state)
+{
+    IFAPI_OBJECT object;
+
+    (void)state;
+
+    fill_nv(&object, true);
+    round_trip(&object);
+    free_filled(&object);
+
+    fill_nv(&object, false);
+    round_trip(&object);
+    free_filled(&object);
+}
+
+static void
+check_binary_hierarchy(void **state)
+{
+    IFAPI_OBJECT object;
+
+    (void)state;
+
+    fill_hierarchy(&object);
+    round_trip(&object);
+    free_filled(&object);
+}
+
+static void
+check_binary_ext_pub_key(void **state)
+{
+    IFAPI_OBJECT object;
+
+    (void)state;
+
+    fill_ext_pub_key(&object, true);
+    round_trip(&object);
+    free_filled(&object);
+
+    fill_ext_pub_key(&object, false);
+    round_trip(&object);
+    free_filled(&object);
+}
+
+static void
+check_binary_errors(void **state)
+{
+    IFAPI_OBJECT object, decoded;
+    uint8_t *binary;
+    size_t binary_size;
+    const char *json = "{ \"objectType\": 1 }";
+    TSS2_RC r;
+
+    (void)state;
+
+    /* Duplicate objects have no binary encoding and are kept as JSON. */
+    memset(&object, 0, sizeof(object));
+    object.objectType = IFAPI_DUPLICATE_OBJ;
+    r = ifapi_binary_IFAPI_OBJECT_serialize(&object, &binary, &binary_size);
+    assert_int_equal(r, TSS2_FAPI_RC_NOT_IMPLEMENTED);
+
+    object.objectType = IFAPI_OBJ_NONE;
+    r = ifapi_binary_IFAPI_OBJECT_serialize(&object, &binary, &binary_size);
+    assert_int_equal(r, TSS2_FAPI_RC_GENERAL_FAILURE);
+
+    r = ifapi_binary_IFAPI_OBJECT_serialize(NULL, &binary, &binary_size);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_REFERENCE);
+
+    /* JSON objects are never taken for binary ones. */
+    assert_false(ifapi_binary_object_p((const uint8_t *) json, strlen(json)));
+    r = ifapi_binary_IFAPI_OBJECT_deserialize((const uint8_t *) json,
+                                              strlen(json), &decoded);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+
+    /* Trailing data, an unknown version and an unknown type are rejected. */
+    fill_hierarchy(&object);
+    r = ifapi_binary_IFAPI_OBJECT_serialize(&object, &binary, &binary_size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    binary = realloc(binary, binary_size + 1);
+    assert_non_null(binary);
+    binary[binary_size] = 0;
+    r = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size + 1, &decoded);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    binary[11] += 1;
+    r = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size, &decoded);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    binary[11] -= 1;
+    binary[15] = 0x7f;
+    r = ifapi_binary_IFAPI_OBJECT_deserialize(binary, binary_size, &decoded);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    free(binary);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_binary_key),
+        cmocka_unit_test(check_binary_nv),
+        cmocka_unit_test(check_binary_hierarchy),
+        cmocka_unit_test(check_binary_ext_pub_key),
+        cmocka_unit_test(check_binary_errors),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,236 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_fapi.h"
+#include "fapi_int.h"
+#include "fapi_util.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/* The NV index read by the tests: three chunks of 8, 8 and 4 bytes. */
+#define NV_SIZE 20
+#define NV_BUFFER_MAX 8
+
+static uint8_t nv_data[NV_SIZE];
+
+/* State of the wrapped ESYS functions. */
+static size_t reads_sent;
+static UINT16 read_size, read_offset;
+
+/* The chunks received by the callback. */
+static struct {
+    size_t offset;
+    size_t size;
+    size_t reads_sent;
+} chunks[8];
+static size_t n_chunks;
+
+TSS2_RC
+__wrap_Esys_NV_Read_Async(ESYS_CONTEXT *esysContext, ESYS_TR authHandle,
+                          ESYS_TR nvIndex, ESYS_TR shandle1, ESYS_TR shandle2,
+                          ESYS_TR shandle3, UINT16 size, UINT16 offset)
+{
+    (void)esysContext;
+    (void)authHandle;
+    (void)nvIndex;
+    (void)shandle1;
+    (void)shandle2;
+    (void)shandle3;
+
+    read_size = size;
+    read_offset = offset;
+    reads_sent += 1;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+__wrap_Esys_NV_Read_Finish(ESYS_CONTEXT *esysContext, TPM2B_MAX_NV_BUFFER **data)
+{
+    (void)esysContext;
+
+    assert_true(read_offset + read_size <= NV_SIZE);
+    *data = calloc(1, sizeof(TPM2B_MAX_NV_BUFFER));
+    assert_non_null(*data);
+    (*data)->size = read_size;
+    memcpy(&(*data)->buffer[0], &nv_data[read_offset], read_size);
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+chunk_cb(char const *nvPath, size_t offset, uint8_t const *data,
+         size_t dataSize, void *userData)
+{
+    TSS2_RC *rc = userData;
+
+    assert_string_equal(nvPath, "/nv/Owner/chunks");
+    assert_true(n_chunks < sizeof(chunks) / sizeof(chunks[0]));
+    assert_memory_equal(data, &nv_data[offset], dataSize);
+    chunks[n_chunks].offset = offset;
+    chunks[n_chunks].size = dataSize;
+    chunks[n_chunks].reads_sent = reads_sent;
+    n_chunks += 1;
+    return *rc;
+}
+
+/* Prepare a context for reading the test NV index as Fapi_NvRead does. */
+static void
+init_context(FAPI_CONTEXT *context, bool report_chunks, TSS2_RC *cb_rc)
+{
+    TSS2_RC r;
+    size_t i;
+
+    for (i = 0; i < NV_SIZE; i++)
+        nv_data[i] = i + 1;
+    reads_sent = 0;
+    n_chunks = 0;
+
+    memset(context, 0, sizeof(FAPI_CONTEXT));
+    context->esys = (ESYS_CONTEXT *)context;
+    context->nv_buffer_max = NV_BUFFER_MAX;
+    context->nv_cmd.nvPath = "/nv/Owner/chunks";
+    context->nv_cmd.numBytes = NV_SIZE;
+    context->nv_cmd.esys_handle = ESYS_TR_RH_OWNER;
+    context->nv_cmd.auth_index = ESYS_TR_RH_OWNER;
+    context->nv_cmd.nv_read_state = NV_READ_INIT;
+    context->nv_cmd.report_chunks = report_chunks;
+
+    r = Fapi_SetNvChunkCB(context, chunk_cb, cb_rc);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+}
+
+static TSS2_RC
+nv_read(FAPI_CONTEXT *context, uint8_t **data, size_t *size)
+{
+    TSS2_RC r;
+
+    do {
+        r = ifapi_nv_read(context, data, size);
+    } while (r == TSS2_FAPI_RC_TRY_AGAIN);
+    return r;
+}
+
+static void
+check_nv_chunk_read(void **state)
+{
+    FAPI_CONTEXT *context;
+    TSS2_RC cb_rc = TSS2_RC_SUCCESS;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    TSS2_RC r;
+
+    (void)state;
+
+    context = malloc(sizeof(FAPI_CONTEXT));
+    assert_non_null(context);
+    init_context(context, true, &cb_rc);
+
+    r = nv_read(context, &data, &size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(size, NV_SIZE);
+    assert_memory_equal(data, nv_data, NV_SIZE);
+
+    /* Every chunk is reported once and in order; all but the last one
+       after the read of the next chunk was sent. */
+    assert_int_equal(n_chunks, 3);
+    assert_int_equal(chunks[0].offset, 0);
+    assert_int_equal(chunks[0].size, 8);
+    assert_int_equal(chunks[0].reads_sent, 2);
+    assert_int_equal(chunks[1].offset, 8);
+    assert_int_equal(chunks[1].size, 8);
+    assert_int_equal(chunks[1].reads_sent, 3);
+    assert_int_equal(chunks[2].offset, 16);
+    assert_int_equal(chunks[2].size, 4);
+    assert_int_equal(chunks[2].reads_sent, 3);
+
+    free(data);
+    free(context);
+}
+
+static void
+check_nv_chunk_not_reported(void **state)
+{
+    FAPI_CONTEXT *context;
+    TSS2_RC cb_rc = TSS2_RC_SUCCESS;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    TSS2_RC r;
+
+    (void)state;
+
+    /* Internal reads, e.g. of certificates, do not invoke the callback. */
+    context = malloc(sizeof(FAPI_CONTEXT));
+    assert_non_null(context);
+    init_context(context, false, &cb_rc);
+
+    r = nv_read(context, &data, &size);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(size, NV_SIZE);
+    assert_int_equal(reads_sent, 3);
+    assert_int_equal(n_chunks, 0);
+
+    free(data);
+    free(context);
+}
+
+static void
+check_nv_chunk_error(void **state)
+{
+    FAPI_CONTEXT *context;
+    TSS2_RC cb_rc = TSS2_FAPI_RC_GENERAL_FAILURE;
+    uint8_t *data = NULL;
+    size_t size = 0;
+    TSS2_RC r;
+
+    (void)state;
+
+    context = malloc(sizeof(FAPI_CONTEXT));
+    assert_non_null(context);
+    init_context(context, true, &cb_rc);
+
+    /* The error of the first chunk is returned after the pending read of
+       the second chunk has finished, and no further read is sent. */
+    r = nv_read(context, &data, &size);
+    assert_int_equal(r, TSS2_FAPI_RC_GENERAL_FAILURE);
+    assert_int_equal(n_chunks, 1);
+    assert_int_equal(reads_sent, 2);
+
+    /* The error of the last chunk is returned as well. */
+    free(context->nv_cmd.rdata);
+    cb_rc = TSS2_FAPI_RC_IO_ERROR;
+    init_context(context, true, &cb_rc);
+    context->nv_cmd.numBytes = NV_BUFFER_MAX;
+    r = nv_read(context, &data, &size);
+    assert_int_equal(r, TSS2_FAPI_RC_IO_ERROR);
+    assert_int_equal(n_chunks, 1);
+
+    free(context->nv_cmd.rdata);
+    free(context);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_nv_chunk_read),
+        cmocka_unit_test(check_nv_chunk_not_reported),
+        cmocka_unit_test(check_nv_chunk_error),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
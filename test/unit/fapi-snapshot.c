@@ -0,0 +1,302 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "ifapi_snapshot.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+static char dir[] = "/tmp/fapi-snapshot-XXXXXX";
+
+static char *
+path(const char *name)
+{
+    static char paths[4][sizeof(dir) + 64];
+    static size_t next;
+    char *p = paths[next++ % 4];
+
+    snprintf(p, sizeof(paths[0]), "%s/%s", dir, name);
+    return p;
+}
+
+static void
+write_data(const char *name, const char *data, size_t size)
+{
+    int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    assert_true(fd >= 0);
+    assert_int_equal(write(fd, data, size), size);
+    close(fd);
+}
+
+/* Set the mtime of a file; seconds are relative to the current time. */
+static void
+set_mtime(const char *name, time_t seconds_ago, long nsec)
+{
+    struct timespec times[2];
+
+    times[0].tv_sec = time(NULL) - seconds_ago;
+    times[0].tv_nsec = nsec;
+    times[1] = times[0];
+    assert_int_equal(utimensat(AT_FDCWD, name, times, 0), 0);
+}
+
+static void
+get_mtime(const char *name, struct timespec *mtime)
+{
+    struct stat st;
+
+    assert_int_equal(stat(name, &st), 0);
+    *mtime = st.st_mtim;
+}
+
+static void
+restore_mtime(const char *name, const struct timespec *mtime)
+{
+    struct timespec times[2] = { *mtime, *mtime };
+
+    assert_int_equal(utimensat(AT_FDCWD, name, times, 0), 0);
+}
+
+/* Create the configuration file and a profile, changed a while ago. */
+static void
+write_inputs(void)
+{
+    write_data(path("fapi-config.json"), "{ \"profile_name\": \"P_ECC\" }", 28);
+    write_data(path("profiles/P_ECC.json"), "{ \"type\": \"TPM2_ALG_ECC\" }", 26);
+    set_mtime(path("fapi-config.json"), 60, 100);
+    set_mtime(path("profiles/P_ECC.json"), 60, 200);
+    set_mtime(path("profiles"), 60, 300);
+}
+
+static void
+init_inputs(IFAPI_CONFIG *config, IFAPI_PROFILES *profiles)
+{
+    memset(config, 0, sizeof(*config));
+    config->profile_dir = path("profiles");
+    config->user_dir = "/nonexistent/user";
+    config->keystore_dir = "/nonexistent/system";
+    config->profile_name = "P_ECC";
+    config->tcti = "mssim:host=localhost";
+    config->replay_threads = 3;
+
+    memset(profiles, 0, sizeof(*profiles));
+    profiles->profiles = calloc(1, sizeof(profiles->profiles[0]));
+    assert_non_null(profiles->profiles);
+    profiles->profiles[0].name = "P_ECC";
+    profiles->profiles[0].profile.type = TPM2_ALG_ECC;
+    profiles->profiles[0].profile.srk_template = "system,restricted,decrypt";
+    profiles->num_profiles = 1;
+}
+
+static void
+free_loaded(IFAPI_CONFIG *config, IFAPI_PROFILES *profiles)
+{
+    free(config->profile_dir);
+    free(config->user_dir);
+    free(config->keystore_dir);
+    free(config->profile_name);
+    free(config->tcti);
+    free(config->log_dir);
+    free(config->ek_cert_file);
+    free(config->intel_cert_service);
+    ifapi_profiles_finalize(profiles);
+}
+
+static TSS2_RC
+load(IFAPI_CONFIG *config, IFAPI_PROFILES *profiles, UINT32 *nv_buffer_max)
+{
+    return ifapi_snapshot_load(path("snapshot"), path("fapi-config.json"),
+                               config, profiles, nv_buffer_max);
+}
+
+static void
+save(void)
+{
+    IFAPI_CONFIG config;
+    IFAPI_PROFILES profiles;
+    TSS2_RC r;
+
+    init_inputs(&config, &profiles);
+    r = ifapi_snapshot_save(path("snapshot"), path("fapi-config.json"),
+                            &config, &profiles, 2048);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    free(profiles.profiles);
+}
+
+static int
+setup(void **state)
+{
+    (void)state;
+
+    if (mkdtemp(dir) == NULL)
+        return -1;
+    return mkdir(path("profiles"), 0700);
+}
+
+static int
+teardown(void **state)
+{
+    (void)state;
+
+    unlink(path("snapshot"));
+    unlink(path("fapi-config.json"));
+    unlink(path("profiles/P_ECC.json"));
+    rmdir(path("profiles"));
+    return rmdir(dir);
+}
+
+static void
+check_snapshot_save_load(void **state)
+{
+    IFAPI_CONFIG config;
+    IFAPI_PROFILES profiles;
+    UINT32 nv_buffer_max;
+    TSS2_RC r;
+
+    (void)state;
+
+    write_inputs();
+    save();
+
+    r = load(&config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_string_equal(config.profile_dir, path("profiles"));
+    assert_string_equal(config.user_dir, "/nonexistent/user");
+    assert_string_equal(config.keystore_dir, "/nonexistent/system");
+    assert_string_equal(config.tcti, "mssim:host=localhost");
+    assert_null(config.log_dir);
+    assert_int_equal(config.replay_threads, 3);
+    assert_int_equal(nv_buffer_max, 2048);
+    assert_int_equal(profiles.num_profiles, 1);
+    assert_string_equal(profiles.default_name, "P_ECC");
+    assert_string_equal(profiles.profiles[0].name, "P_ECC");
+    assert_int_equal(profiles.profiles[0].profile.type, TPM2_ALG_ECC);
+    assert_string_equal(profiles.profiles[0].profile.srk_template,
+                        "system,restricted,decrypt");
+    assert_null(profiles.profiles[0].profile.ek_template);
+    assert_null(profiles.profiles[0].profile.eh_policy);
+    assert_int_equal(profiles.default_profile.type, TPM2_ALG_ECC);
+    free_loaded(&config, &profiles);
+}
+
+static void
+check_snapshot_stale(void **state)
+{
+    IFAPI_CONFIG config;
+    IFAPI_PROFILES profiles;
+    UINT32 nv_buffer_max;
+    struct timespec mtime;
+    TSS2_RC r;
+
+    (void)state;
+
+    write_inputs();
+    save();
+
+    /* A rewrite of the same size within the same second is detected. */
+    get_mtime(path("fapi-config.json"), &mtime);
+    write_data(path("fapi-config.json"), "{ \"profile_name\": \"P_RSA\" }", 28);
+    mtime.tv_nsec += 1;
+    restore_mtime(path("fapi-config.json"), &mtime);
+    r = load(&config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    assert_null(config.tcti);
+    assert_null(profiles.profiles);
+    assert_int_equal(nv_buffer_max, 0);
+
+    /* So is a change of the size with an unchanged mtime. */
+    write_inputs();
+    save();
+    get_mtime(path("profiles/P_ECC.json"), &mtime);
+    write_data(path("profiles/P_ECC.json"), "{ \"type\": \"TPM2_ALG_RSA\" } ", 27);
+    restore_mtime(path("profiles/P_ECC.json"), &mtime);
+    r = load(&config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+
+    /* Files changed right before the snapshot was written are not trusted. */
+    write_inputs();
+    set_mtime(path("fapi-config.json"), 0, 0);
+    save();
+    set_mtime(path("fapi-config.json"), 60, 100);
+    r = load(&config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+
+    /* Another configuration file does not match the snapshot. */
+    write_inputs();
+    save();
+    r = ifapi_snapshot_load(path("snapshot"), path("profiles/P_ECC.json"),
+                            &config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+}
+
+static void
+check_snapshot_corrupted(void **state)
+{
+    IFAPI_CONFIG config;
+    IFAPI_PROFILES profiles;
+    UINT32 nv_buffer_max;
+    struct stat st;
+    char *data;
+    int fd;
+    TSS2_RC r;
+
+    (void)state;
+
+    write_inputs();
+    save();
+
+    /* Every truncation of the snapshot is rejected. */
+    assert_int_equal(stat(path("snapshot"), &st), 0);
+    data = malloc(st.st_size);
+    assert_non_null(data);
+    fd = open(path("snapshot"), O_RDONLY);
+    assert_true(fd >= 0);
+    assert_int_equal(read(fd, data, st.st_size), st.st_size);
+    close(fd);
+    for (off_t size = 1; size < st.st_size; size += 7) {
+        write_data(path("snapshot"), data, size);
+        r = load(&config, &profiles, &nv_buffer_max);
+        assert_int_equal(r, TSS2_FAPI_RC_BAD_VALUE);
+    }
+    free(data);
+
+    unlink(path("snapshot"));
+    r = load(&config, &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_IO_ERROR);
+
+    r = ifapi_snapshot_load(NULL, path("fapi-config.json"), &config,
+                            &profiles, &nv_buffer_max);
+    assert_int_equal(r, TSS2_FAPI_RC_BAD_REFERENCE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(check_snapshot_save_load),
+        cmocka_unit_test(check_snapshot_stale),
+        cmocka_unit_test(check_snapshot_corrupted),
+    };
+    return cmocka_run_group_tests(tests, setup, teardown);
+}
@@ -0,0 +1,359 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*******************************************************************************
+ * Copyright 2026, agent
+ * All rights reserved.
+ ******************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_fapi.h"
+#include "tss2_tctildr.h"
+#include "fapi_int.h"
+#include "ifapi_timing.h"
+
+#define LOGMODULE tests
+#include "util/log.h"
+
+/*
+ * A TCTI counting the calls forwarded by the timing TCTI. Receive fails with
+ * receive_rc, if it is set.
+ */
+#define TCTI_COUNT_MAGIC 0x434f554e54000000ULL       /* 'COUNT\0\0\0' */
+#define TCTI_COUNT_VERSION 2
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_COMMON_V2 common;
+    size_t transmits;
+    size_t receives;
+    size_t cancels;
+    size_t poll_handles;
+    size_t localities;
+    size_t stickies;
+    TSS2_RC receive_rc;
+} TCTI_COUNT;
+
+static TCTI_COUNT tcti_count;
+
+/* The TCTI passed to Tss2_TctiLdr_Finalize(). */
+static TSS2_TCTI_CONTEXT *finalized;
+
+void
+__wrap_Tss2_TctiLdr_Finalize(TSS2_TCTI_CONTEXT **tctiContext)
+{
+    finalized = *tctiContext;
+    *tctiContext = NULL;
+}
+
+static TSS2_RC
+tcti_count_transmit(TSS2_TCTI_CONTEXT *tctiContext, size_t size,
+                    const uint8_t *command)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    assert_int_equal(size, 10);
+    assert_int_equal(command[0], 0x80);
+    tcti_count.transmits++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_count_receive(TSS2_TCTI_CONTEXT *tctiContext, size_t *size,
+                   uint8_t *response, int32_t timeout)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    assert_int_equal(timeout, 42);
+    tcti_count.receives++;
+    if (tcti_count.receive_rc != TSS2_RC_SUCCESS)
+        return tcti_count.receive_rc;
+    if (response != NULL)
+        memset(response, 0xab, *size);
+    *size = 10;
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_count_finalize(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    (void)tctiContext;
+    fail_msg("The wrapped TCTI must be finalized by its owner.");
+}
+
+static TSS2_RC
+tcti_count_cancel(TSS2_TCTI_CONTEXT *tctiContext)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    tcti_count.cancels++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_count_get_poll_handles(TSS2_TCTI_CONTEXT *tctiContext,
+                            TSS2_TCTI_POLL_HANDLE *handles,
+                            size_t *num_handles)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    (void)handles;
+    tcti_count.poll_handles++;
+    *num_handles = 1;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_count_set_locality(TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    assert_int_equal(locality, 3);
+    tcti_count.localities++;
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_count_make_sticky(TSS2_TCTI_CONTEXT *tctiContext, TPM2_HANDLE *handle,
+                       uint8_t sticky)
+{
+    assert_ptr_equal(tctiContext, &tcti_count);
+    assert_int_equal(*handle, 0x80000001);
+    assert_int_equal(sticky, 1);
+    tcti_count.stickies++;
+    return TSS2_RC_SUCCESS;
+}
+
+static int
+setup(void **state)
+{
+    (void)state;
+
+    memset(&tcti_count, 0, sizeof(tcti_count));
+    TSS2_TCTI_MAGIC(&tcti_count) = TCTI_COUNT_MAGIC;
+    TSS2_TCTI_VERSION(&tcti_count) = TCTI_COUNT_VERSION;
+    TSS2_TCTI_TRANSMIT(&tcti_count) = tcti_count_transmit;
+    TSS2_TCTI_RECEIVE(&tcti_count) = tcti_count_receive;
+    TSS2_TCTI_FINALIZE(&tcti_count) = tcti_count_finalize;
+    TSS2_TCTI_CANCEL(&tcti_count) = tcti_count_cancel;
+    TSS2_TCTI_GET_POLL_HANDLES(&tcti_count) = tcti_count_get_poll_handles;
+    TSS2_TCTI_SET_LOCALITY(&tcti_count) = tcti_count_set_locality;
+    TSS2_TCTI_MAKE_STICKY(&tcti_count) = tcti_count_make_sticky;
+    finalized = NULL;
+
+    ifapi_timing_enable(true);
+    ifapi_timing_reset();
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    (void)state;
+
+    ifapi_timing_enable(false);
+    return 0;
+}
+
+static void
+check_timing_phases(void **state)
+{
+    IFAPI_TIMING timing;
+    uint64_t start;
+    size_t i;
+
+    (void)state;
+
+    start = ifapi_timing_start();
+    assert_true(start != 0);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, ifapi_timing_start());
+    ifapi_timing_stop(IFAPI_TIMING_BINARY, ifapi_timing_start());
+    /* A measurement that was never started or already stopped is ignored. */
+    ifapi_timing_stop(IFAPI_TIMING_IO, 0);
+    ifapi_timing_stop(IFAPI_TIMING_MAX, ifapi_timing_start());
+
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_JSON], 2);
+    assert_int_equal(timing.count[IFAPI_TIMING_BINARY], 1);
+    assert_int_equal(timing.count[IFAPI_TIMING_IO], 0);
+    assert_int_equal(timing.count[IFAPI_TIMING_CRYPTO], 0);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 0);
+    assert_int_equal(timing.ns[IFAPI_TIMING_IO], 0);
+
+    ifapi_timing_reset();
+    ifapi_timing_get(&timing);
+    for (i = 0; i < IFAPI_TIMING_MAX; i++) {
+        assert_int_equal(timing.ns[i], 0);
+        assert_int_equal(timing.count[i], 0);
+    }
+
+    /* Disabled hooks do not measure anything. */
+    ifapi_timing_enable(false);
+    assert_false(ifapi_timing_enabled());
+    start = ifapi_timing_start();
+    assert_int_equal(start, 0);
+    ifapi_timing_stop(IFAPI_TIMING_JSON, start);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_JSON], 0);
+
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_IO), "I/O");
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_JSON), "JSON");
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_BINARY), "binary");
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_CRYPTO), "crypto");
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_TPM), "TPM");
+    assert_string_equal(ifapi_timing_phase_name(IFAPI_TIMING_MAX), "unknown");
+}
+
+static void
+check_timing_tcti_forward(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT *) &tcti_count;
+    TSS2_TCTI_POLL_HANDLE handles[1];
+    uint8_t command[10] = { 0x80, 0x01 }, response[10];
+    size_t size, num_handles = 1;
+    TPM2_HANDLE handle = 0x80000001;
+    IFAPI_TIMING timing;
+    TSS2_RC r;
+
+    (void)state;
+
+    r = ifapi_timing_tcti_wrap(&tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_ptr_not_equal(tcti, &tcti_count);
+
+    r = Tss2_Tcti_Transmit(tcti, sizeof(command), &command[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti_count.transmits, 1);
+
+    /* A query of the response size does not end the command. */
+    r = Tss2_Tcti_Receive(tcti, &size, NULL, 42);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(size, 10);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 0);
+
+    r = Tss2_Tcti_Receive(tcti, &size, &response[0], 42);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(response[9], 0xab);
+    assert_int_equal(tcti_count.receives, 2);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 1);
+
+    assert_int_equal(Tss2_Tcti_Cancel(tcti), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti_count.cancels, 1);
+    assert_int_equal(Tss2_Tcti_GetPollHandles(tcti, &handles[0],
+                                              &num_handles), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti_count.poll_handles, 1);
+    assert_int_equal(Tss2_Tcti_SetLocality(tcti, 3), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti_count.localities, 1);
+    assert_int_equal(Tss2_Tcti_MakeSticky(tcti, &handle, 1), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti_count.stickies, 1);
+
+    /* Finalizing the wrapper leaves the wrapped TCTI alone. */
+    Tss2_Tcti_Finalize(tcti);
+    tcti = ifapi_timing_tcti_unwrap(tcti);
+    assert_ptr_equal(tcti, &tcti_count);
+    assert_ptr_equal(ifapi_timing_tcti_unwrap(tcti), &tcti_count);
+
+    /* Without the hooks, the TCTI is not wrapped. */
+    ifapi_timing_enable(false);
+    r = ifapi_timing_tcti_wrap(&tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_ptr_equal(tcti, &tcti_count);
+}
+
+static void
+check_timing_tcti_error(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT *) &tcti_count;
+    uint8_t command[10] = { 0x80, 0x01 }, response[10];
+    size_t size = sizeof(response);
+    IFAPI_TIMING timing;
+    uint64_t magic;
+    TSS2_RC r;
+
+    (void)state;
+
+    r = ifapi_timing_tcti_wrap(&tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* A timeout or an error of the wrapped TCTI is returned and does not end
+       the command; the next successful reception does. */
+    r = Tss2_Tcti_Transmit(tcti, sizeof(command), &command[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    tcti_count.receive_rc = TSS2_TCTI_RC_TRY_AGAIN;
+    r = Tss2_Tcti_Receive(tcti, &size, &response[0], 42);
+    assert_int_equal(r, TSS2_TCTI_RC_TRY_AGAIN);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 0);
+
+    tcti_count.receive_rc = TSS2_RC_SUCCESS;
+    r = Tss2_Tcti_Receive(tcti, &size, &response[0], 42);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 1);
+
+    /* A response without a command, e.g. after a cancel, is not counted. */
+    assert_int_equal(Tss2_Tcti_Cancel(tcti), TSS2_RC_SUCCESS);
+    r = Tss2_Tcti_Receive(tcti, &size, &response[0], 42);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    ifapi_timing_get(&timing);
+    assert_int_equal(timing.count[IFAPI_TIMING_TPM], 1);
+
+    /* A context that is no wrapper is rejected. */
+    magic = TSS2_TCTI_MAGIC(tcti);
+    TSS2_TCTI_MAGIC(tcti) = 0;
+    r = Tss2_Tcti_Transmit(tcti, sizeof(command), &command[0]);
+    assert_int_equal(r, TSS2_TCTI_RC_BAD_CONTEXT);
+    r = Tss2_Tcti_Receive(tcti, &size, &response[0], 42);
+    assert_int_equal(r, TSS2_TCTI_RC_BAD_CONTEXT);
+    assert_int_equal(Tss2_Tcti_Cancel(tcti), TSS2_TCTI_RC_BAD_CONTEXT);
+    assert_ptr_equal(ifapi_timing_tcti_unwrap(tcti), tcti);
+    assert_int_equal(tcti_count.transmits, 1);
+    TSS2_TCTI_MAGIC(tcti) = magic;
+
+    tcti = ifapi_timing_tcti_unwrap(tcti);
+    assert_ptr_equal(tcti, &tcti_count);
+}
+
+static void
+check_timing_finalize(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti = (TSS2_TCTI_CONTEXT *) &tcti_count;
+    FAPI_CONTEXT *context;
+    TSS2_RC r;
+
+    (void)state;
+
+    r = ifapi_timing_tcti_wrap(&tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* Fapi_Finalize() removes the wrapper before finalizing the TCTI. */
+    context = calloc(1, sizeof(FAPI_CONTEXT));
+    assert_non_null(context);
+    r = Esys_Initialize(&context->esys, tcti, NULL);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    Fapi_Finalize(&context);
+    assert_null(context);
+    assert_ptr_equal(finalized, &tcti_count);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(check_timing_phases, setup, teardown),
+        cmocka_unit_test_setup_teardown(check_timing_tcti_forward, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(check_timing_tcti_error, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(check_timing_finalize, setup,
+                                        teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
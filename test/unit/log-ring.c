@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/***********************************************************************
+ * Copyright (c) 2026, agent
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+
+#define LOGMODULE test
+#include "util/log.h"
+
+static int log_fd = -1;
+static char log_text[16384];
+
+/* Read what the ring backend wrote to stderr so far. */
+static const char *
+read_written(void)
+{
+    ssize_t n;
+
+    n = pread(log_fd, log_text, sizeof(log_text) - 1, 0);
+    assert_true(n >= 0);
+    log_text[n] = '\0';
+    return log_text;
+}
+
+/* Flush the ring backend and read what it wrote to stderr. */
+static const char *
+read_log(void)
+{
+    doLogFlush();
+    return read_written();
+}
+
+static int
+setup(void **state)
+{
+    (void) state;
+
+    assert_int_equal(ftruncate(log_fd, 0), 0);
+    return 0;
+}
+
+static void
+test_formats(void **state)
+{
+    char expected[256];
+    uint64_t u64 = 0x0123456789abcdefULL;
+    const char *text;
+
+    (void) state;
+
+    LOG_ERROR("%d %i %u %x %X %o %c %s|%5.2f|%-4d|%*d|%.*s|%%|%zu|%"
+              PRIx64 "|%hhu|%lld|%e", -1, 2, 3u, 0xabu, 0xcdu, 8u, 'z',
+              "str", 3.14159, 7, 6, 42, 3, "abcdef", (size_t) 99, u64,
+              (unsigned char) 255, -5LL, 1e10);
+    snprintf(expected, sizeof(expected),
+             "%d %i %u %x %X %o %c %s|%5.2f|%-4d|%*d|%.*s|%%|%zu|%"
+             PRIx64 "|%hhu|%lld|%e", -1, 2, 3u, 0xabu, 0xcdu, 8u, 'z',
+             "str", 3.14159, 7, 6, 42, 3, "abcdef", (size_t) 99, u64,
+             (unsigned char) 255, -5LL, 1e10);
+
+    text = read_log();
+    assert_non_null(strstr(text, "ERROR:test:"));
+    assert_non_null(strstr(text, ":test_formats() "));
+    assert_non_null(strstr(text, expected));
+}
+
+static void
+test_strings(void **state)
+{
+    char unterminated[4] = { 'a', 'b', 'c', 'd' };
+    char longstr[300];
+    const char *text;
+
+    (void) state;
+
+    memset(longstr, 'x', sizeof(longstr) - 1);
+    longstr[sizeof(longstr) - 1] = '\0';
+
+    LOG_WARNING("[%.*s] [%-4s]", 4, unterminated, "ab");
+    LOG_WARNING("%s %d", longstr, 1);
+
+    text = read_log();
+    assert_non_null(strstr(text, "[abcd] [ab  ] \n"));
+    /* The long string is truncated to the record and the rest dropped. */
+    assert_non_null(strstr(text, "xxxx ... \n"));
+    assert_null(strstr(text, "x 1"));
+}
+
+static void
+test_blob(void **state)
+{
+    const char *data = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn";
+    const char *text;
+
+    (void) state;
+
+    LOGBLOB_ERROR((const uint8_t *) data, 40, "blob %d", 1);
+
+    text = read_log();
+    assert_non_null(strstr(text, "() blob 1 (size=40): \n"
+        "0000: 4142434445464748494a4b4c4d4e4f50  ABCDEFGHIJKLMNOP\n"
+        "0010: 5152535455565758595a616263646566  QRSTUVWXYZabcdef\n"
+        "0020: 6768696a6b6c6d6e                  ghijklmn\n"));
+}
+
+static void *
+log_thread(void *arg)
+{
+    LOG_ERROR("from thread %d", *(int *) arg);
+    return NULL;
+}
+
+static void
+test_thread(void **state)
+{
+    pthread_t thread;
+    int id = 7;
+
+    (void) state;
+
+    assert_int_equal(pthread_create(&thread, NULL, log_thread, &id), 0);
+    assert_int_equal(pthread_join(thread, NULL), 0);
+
+    /* The records of an exited thread are still written. */
+    assert_non_null(strstr(read_log(), "from thread 7 \n"));
+}
+
+static void *
+log_half_thread(void *arg)
+{
+    struct timespec delay = { 0, 10000000 };
+    int i;
+
+    /* Half of a ring of 16 records wakes the flusher long before its
+       interval ends. */
+    for (i = 0; i < 8; i++)
+        LOG_ERROR("half %d", i);
+    for (i = 0; i < 500 && strstr(read_written(), "half 7 \n") == NULL; i++)
+        nanosleep(&delay, NULL);
+    *(int *) arg = strstr(read_written(), "half 7 \n") != NULL;
+    return NULL;
+}
+
+static void
+test_half_full(void **state)
+{
+    pthread_t thread;
+    int written = 0;
+
+    (void) state;
+
+    setenv("TSS2_LOG_RING_RECORDS", "16", 1);
+    assert_int_equal(pthread_create(&thread, NULL, log_half_thread, &written),
+                     0);
+    assert_int_equal(pthread_join(thread, NULL), 0);
+    unsetenv("TSS2_LOG_RING_RECORDS");
+    assert_true(written);
+}
+
+static void
+test_libraries(void **state)
+{
+    uint8_t buffer[2] = { 0 };
+    size_t offset = 0;
+    UINT32 value;
+    const char *text, *before, *mu, *after;
+
+    (void) state;
+
+    /* The messages of another library share the ring of the thread and are
+       written in order by doLogFlush() of this one. */
+    LOG_ERROR("before mu");
+    assert_int_not_equal(Tss2_MU_UINT32_Unmarshal(buffer, sizeof(buffer),
+                                                  &offset, &value),
+                         TSS2_RC_SUCCESS);
+    LOG_ERROR("after mu");
+
+    text = read_log();
+    before = strstr(text, "before mu \n");
+    mu = strstr(text, ":marshal:");
+    after = strstr(text, "after mu \n");
+    assert_non_null(before);
+    assert_non_null(mu);
+    assert_non_null(after);
+    assert_true(before < mu && mu < after);
+}
+
+int
+main(int argc, char *argv[])
+{
+    char path[] = "/tmp/log-ring-XXXXXX";
+
+    (void) argc;
+    (void) argv;
+
+    setenv("TSS2_LOG", "all+trace", 1);
+    setenv("TSS2_LOG_BACKEND", "ring", 1);
+    /* Only doLogFlush() and a half full ring make the flusher write. */
+    setenv("TSS2_LOG_FLUSH_INTERVAL", "60000", 1);
+
+    /* The flusher writes to stderr; append it to a file instead. */
+    log_fd = mkstemp(path);
+    if (log_fd < 0)
+        return EXIT_FAILURE;
+    unlink(path);
+    if (fcntl(log_fd, F_SETFL, O_APPEND) != 0 ||
+        dup2(log_fd, STDERR_FILENO) < 0)
+        return EXIT_FAILURE;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(test_formats, setup),
+        cmocka_unit_test_setup(test_strings, setup),
+        cmocka_unit_test_setup(test_blob, setup),
+        cmocka_unit_test_setup(test_thread, setup),
+        cmocka_unit_test_setup(test_half_full, setup),
+        cmocka_unit_test_setup(test_libraries, setup),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
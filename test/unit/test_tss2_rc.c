@@ -142,6 +142,119 @@ test_tpm2_format_1_success(void **state)
     assert_string_equal(m, "tpm:success");
 }
 
+static void
+test_tpm_format_1_2_session(void **state)
+{
+    (void) state;
+
+    const char *m = Tss2_RC_Decode(TPM2_RC_HASH + TPM2_RC_S + TPM2_RC_2);
+    assert_string_equal(m,
+            "tpm:session(2):hash algorithm not supported or not appropriate");
+}
+
+static void
+test_tpm_format_0_vendor(void **state)
+{
+    (void) state;
+
+    const char *m = Tss2_RC_Decode(TPM2_RC_VER1 + 0x400 + 0x12);
+    assert_string_equal(m, "tpm:error(2.0): Vendor specific error: 0x12");
+}
+
+static void
+test_decode_struct(void **state)
+{
+    (void) state;
+
+    TSS2_RC_INFO info;
+
+    Tss2_RC_DecodeStruct(TPM2_RC_VALUE + TPM2_RC_P + TPM2_RC_9, &info);
+    assert_int_equal(info.layer, 0);
+    assert_int_equal(info.format, TSS2_RC_INFO_FORMAT_1);
+    assert_int_equal(info.base, TPM2_RC_VALUE);
+    assert_int_equal(info.subject, TSS2_RC_INFO_SUBJECT_PARAMETER);
+    assert_int_equal(info.index, 9);
+    assert_int_equal(info.flags, 0);
+
+    Tss2_RC_DecodeStruct(TPM2_RC_AUTH_FAIL + TPM2_RC_S + TPM2_RC_1, &info);
+    assert_int_equal(info.base, TPM2_RC_AUTH_FAIL);
+    assert_int_equal(info.subject, TSS2_RC_INFO_SUBJECT_SESSION);
+    assert_int_equal(info.index, 1);
+
+    Tss2_RC_DecodeStruct(TSS2_RESMGR_RC_LAYER | TPM2_RC_HANDLE | TPM2_RC_2,
+                         &info);
+    assert_int_equal(info.layer, 11);
+    assert_int_equal(info.base, TPM2_RC_HANDLE);
+    assert_int_equal(info.subject, TSS2_RC_INFO_SUBJECT_HANDLE);
+    assert_int_equal(info.index, 2);
+
+    Tss2_RC_DecodeStruct(TPM2_RC_LOCKOUT, &info);
+    assert_int_equal(info.format, TSS2_RC_INFO_FORMAT_0);
+    assert_int_equal(info.base, TPM2_RC_LOCKOUT);
+    assert_int_equal(info.subject, TSS2_RC_INFO_SUBJECT_NONE);
+    assert_int_equal(info.index, 0);
+    assert_int_equal(info.flags, TSS2_RC_INFO_WARNING);
+
+    Tss2_RC_DecodeStruct(TPM2_RC_VER1 + 0x400 + 0x12, &info);
+    assert_int_equal(info.flags, TSS2_RC_INFO_VENDOR);
+
+    Tss2_RC_DecodeStruct(0x12, &info);
+    assert_int_equal(info.flags, TSS2_RC_INFO_TPM12);
+
+    Tss2_RC_DecodeStruct(TPM2_RC_SUCCESS, &info);
+    assert_int_equal(info.format, TSS2_RC_INFO_FORMAT_0);
+    assert_int_equal(info.base, 0);
+    assert_int_equal(info.flags, 0);
+
+    Tss2_RC_DecodeStruct(TSS2_ESYS_RC_BAD_VALUE, &info);
+    assert_int_equal(info.layer, 7);
+    assert_int_equal(info.format, TSS2_RC_INFO_FORMAT_TSS);
+    assert_int_equal(info.base, TSS2_BASE_RC_BAD_VALUE);
+
+    Tss2_RC_DecodeStruct(TSS2_ESYS_RC_BAD_VALUE, NULL);
+}
+
+static void
+test_decode_strings(void **state)
+{
+    (void) state;
+
+    TSS2_RC_STRINGS strings, again;
+
+    Tss2_RC_DecodeStrings(TPM2_RC_HASH + TPM2_RC_5, &strings);
+    assert_string_equal(strings.layer, "tpm");
+    assert_string_equal(strings.prefix, "handle(5):");
+    assert_string_equal(strings.description,
+            "hash algorithm not supported or not appropriate");
+
+    /* The strings are constant, not rebuilt per call. */
+    Tss2_RC_DecodeStrings(TPM2_RC_HASH + TPM2_RC_5, &again);
+    assert_ptr_equal(strings.layer, again.layer);
+    assert_ptr_equal(strings.prefix, again.prefix);
+    assert_ptr_equal(strings.description, again.description);
+
+    Tss2_RC_DecodeStrings(TPM2_RC_LOCKOUT, &strings);
+    assert_string_equal(strings.prefix, "warn(2.0): ");
+    assert_string_prefix(strings.description, "authorizations for objects");
+
+    Tss2_RC_DecodeStrings(TSS2_TCTI_RC_NO_CONNECTION, &strings);
+    assert_string_equal(strings.layer, "tcti");
+    assert_string_equal(strings.prefix, "");
+    assert_string_equal(strings.description,
+            "Fails to connect to next lower layer");
+
+    Tss2_RC_DecodeStrings(TSS2_RC_LAYER(1) | 42, &strings);
+    assert_null(strings.layer);
+    assert_null(strings.description);
+
+    Tss2_RC_DecodeStrings(TSS2_SYS_RC_LAYER, &strings);
+    assert_string_equal(strings.description, "success");
+
+    Tss2_RC_DecodeStrings(TPM2_RC_NOT_USED + 0x80, &strings);
+    assert_string_equal(strings.prefix, "parameter(1):");
+    assert_null(strings.description);
+}
+
 static const char *
 custom_err_handler(TSS2_RC rc)
 {
@@ -304,6 +417,10 @@ main(int argc, char* argv[])
             cmocka_unit_test(test_tpm_format_1_5_handle),
             cmocka_unit_test(test_tpm2_format_1_unknown),
             cmocka_unit_test(test_tpm2_format_1_success),
+            cmocka_unit_test(test_tpm_format_1_2_session),
+            cmocka_unit_test(test_tpm_format_0_vendor),
+            cmocka_unit_test(test_decode_struct),
+            cmocka_unit_test(test_decode_strings),
             cmocka_unit_test(test_custom_handler),
             cmocka_unit_test(test_zero_length_name),
             cmocka_unit_test(test_over_length_name),